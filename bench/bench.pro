@@ -0,0 +1,55 @@
+# 采集 -> 转换 -> 编码 -> 封装流水线的基准测试 (无摄像头、无显示)
+# 构建: qmake bench/bench.pro && make，运行: ./pipeline_bench --help
+# 与主程序共用同一份源文件，不链接界面和 V4L2 库
+
+QT       += core gui
+QT       -= widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = pipeline_bench
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ..
+DEPENDPATH += ..
+
+SOURCES += \
+    pipelinebench.cpp \
+    ../recordingthread.cpp \
+    ../packetfanout.cpp \
+    ../substreamencoder.cpp \
+    ../bufferedfilewriter.cpp \
+    ../keyframeindex.cpp \
+    ../pipelinemetrics.cpp \
+    ../ratecontroller.cpp \
+    ../slicepool.cpp \
+    ../packetring.cpp \
+    ../motiondetector.cpp \
+    ../encoderbackend.cpp \
+    ../pixel_convert.c
+
+HEADERS += \
+    ../recordingthread.h \
+    ../framesink.h \
+    ../packetsink.h \
+    ../packetfanout.h \
+    ../substreamencoder.h \
+    ../bufferedfilewriter.h \
+    ../keyframeindex.h \
+    ../pipelinemetrics.h \
+    ../ratecontroller.h \
+    ../slicepool.h \
+    ../packetring.h \
+    ../motiondetector.h \
+    ../encoderbackend.h \
+    ../spscring.h \
+    ../pixel_convert.h
+
+unix {
+    LIBS += -lpthread
+    LIBS += -lavformat -lavcodec -lavutil -lswscale -lswresample
+}
+
+# NEON / SSE2 / AVX2 内核的编译参数与主程序相同，见 video_surveillance.pro
@@ -0,0 +1,729 @@
+/**
+ * @file pipelinebench.cpp
+ * @brief 录制流水线的基准测试程序 (pipeline_bench)。
+ *
+ * 不需要摄像头和显示器，用合成画面 (或 `--input` 给出的预先录制的原始帧) 测量两部分：
+ * - 转换内核：`pixconv_rgb565_to_rgb888()` 以及录制、预览使用的各个 `pixconv_*` 转换，
+ *   对当前 CPU 支持的每一种实现 (标量 / SSE2 / AVX2 / NEON) 分别计时。
+ * - 完整的录制路径：一个独立的 `RecordingThread` 按分辨率、像素格式、编码器预设、线程数和封装格式组合，
+ *   从 `addFrameToQueue()` 入队开始，经过转换、编码、封装，写入临时目录中的文件。
+ *   每帧的延迟为入队到编码器输出这一帧的数据包 (通过 `PacketSink` 在录制线程中取得)。
+ *
+ * 每个用例输出一行制表符分隔的结果 (帧率、延迟的 p50/p95/p99、进程 CPU 占用、峰值 RSS 等)，
+ * 列和用例顺序固定，不同版本或不同板子的结果可以直接 diff；`--compare` 与基线比较，
+ * 帧率下降超过 `--tolerance` 的用例输出到标准错误，返回码为1，可以在刷写设备前的 CI 中使用。
+ */
+
+#include "recordingthread.h"
+#include "pixel_convert.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+#include <QSize>
+#include <QMap>
+#include <QDebug>
+
+#include <sys/resource.h> // getrusage
+#include <time.h>         // clock_gettime, nanosleep
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 被测的像素格式。
+ */
+enum BenchFormat {
+    FormatRgb565,
+    FormatYuyv,
+    FormatNv12
+};
+
+const char *formatName(BenchFormat format)
+{
+    switch (format) {
+    case FormatRgb565: return "rgb565";
+    case FormatYuyv:   return "yuyv";
+    default:           return "nv12";
+    }
+}
+
+/**
+ * @brief 一帧的字节数 (每行没有填充)。
+ */
+int frameBytes(BenchFormat format, int width, int height)
+{
+    return format == FormatNv12 ? width * height + width * ((height + 1) / 2) : width * height * 2;
+}
+
+/**
+ * @brief 每行字节数 (NV12 为 Y 平面)。
+ */
+int frameStride(BenchFormat format, int width)
+{
+    return format == FormatNv12 ? width : width * 2;
+}
+
+AVPixelFormat avFormat(BenchFormat format)
+{
+    switch (format) {
+    case FormatRgb565: return AV_PIX_FMT_RGB565LE;
+    case FormatYuyv:   return AV_PIX_FMT_YUYV422;
+    default:           return AV_PIX_FMT_NV12;
+    }
+}
+
+qint64 monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 进程 (所有线程) 累计的 CPU 时间 (纳秒)。
+ */
+qint64 processCpuNs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (static_cast<qint64>(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000000LL
+            + (static_cast<qint64>(usage.ru_utime.tv_usec) + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+/**
+ * @brief 从这里开始重新统计峰值 RSS (Linux 4.0 起向 clear_refs 写入 5 重置 VmHWM)。
+ */
+void resetPeakRss()
+{
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+}
+
+/**
+ * @brief 上次 `resetPeakRss()` 以来的峰值 RSS (KiB)，读不到 VmHWM 时取进程生命期内的峰值。
+ */
+qint64 peakRssKb()
+{
+    QFile file("/proc/self/status");
+    if (file.open(QIODevice::ReadOnly)) {
+        for (const QByteArray &line : file.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief 最近秩百分位数 (纳秒)，samples 会被排序。
+ */
+qint64 percentile(std::vector<qint64> &samples, double fraction)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t rank = static_cast<size_t>(fraction * samples.size() + 0.5);
+    return samples[qBound<size_t>(1, rank, samples.size()) - 1];
+}
+
+/**
+ * @brief 生成一组合成画面：平移的斜向渐变叠加固定种子的噪声，编码器每帧都有真实的运动和细节要处理，
+ *        结果在不同机器上逐字节相同。
+ */
+QList<QByteArray> syntheticFrames(BenchFormat format, int width, int height, int count)
+{
+    QList<QByteArray> frames;
+    for (int f = 0; f < count; ++f) {
+        QByteArray frame(frameBytes(format, width, height), '\0');
+        uint8_t *data = reinterpret_cast<uint8_t *>(frame.data());
+        uint32_t seed = 0x9e3779b9u * (f + 1);
+        auto noise = [&seed]() {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; // xorshift32
+            return static_cast<int>(seed & 15) - 8;
+        };
+        const int shift = f * 4; // 每帧向右下平移4个像素
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const int base = ((x + y + shift) & 255);
+                const int luma = qBound(16, base * 219 / 255 + 16 + noise(), 235);
+                switch (format) {
+                case FormatRgb565: {
+                    const int r = qBound(0, base + noise(), 255);
+                    const int g = qBound(0, ((x - shift) * 255 / qMax(1, width - 1)) & 255, 255);
+                    const int b = qBound(0, (y * 255 / qMax(1, height - 1) + noise()), 255);
+                    const uint16_t pixel = static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+                    data[(y * width + x) * 2] = pixel & 0xff;
+                    data[(y * width + x) * 2 + 1] = pixel >> 8;
+                    break;
+                }
+                case FormatYuyv:
+                    data[(y * width + x) * 2] = static_cast<uint8_t>(luma);
+                    // 偶数像素位置存 U，奇数存 V (Y0 U Y1 V)
+                    data[(y * width + x) * 2 + 1] = static_cast<uint8_t>((x & 1) ? 128 + ((y + shift) & 63) - 32
+                                                                                 : 128 + ((x + shift) & 63) - 32);
+                    break;
+                default:
+                    data[y * width + x] = static_cast<uint8_t>(luma);
+                    if (!(y & 1) && !(x & 1)) {
+                        uint8_t *uv = data + width * height + (y / 2) * width + x;
+                        uv[0] = static_cast<uint8_t>(128 + ((x + shift) & 63) - 32);
+                        uv[1] = static_cast<uint8_t>(128 + ((y + shift) & 63) - 32);
+                    }
+                    break;
+                }
+            }
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+/**
+ * @brief 从原始帧文件中读取最多 maxFrames 帧 (例如 `v4l2-ctl --stream-to` 录下的数据)。
+ */
+QList<QByteArray> fileFrames(const QString &path, int bytes, int maxFrames)
+{
+    QList<QByteArray> frames;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开输入文件" << path << file.errorString();
+        return frames;
+    }
+    while (frames.size() < maxFrames) {
+        const QByteArray frame = file.read(bytes);
+        if (frame.size() != bytes) {
+            break;
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+/**
+ * @brief 一个用例的结果 (一行输出)。
+ */
+struct Result {
+    QString kind;       ///< "kernel" 或 "pipeline"。
+    QString name;       ///< 内核名，或实际使用的编码器名。
+    QString size;       ///< 例如 "640x480"。
+    QString format;     ///< 输入像素格式。
+    QString backend;    ///< 转换内核的实现。
+    QString preset;     ///< 编码器预设 (内核用例为 "-")。
+    QString threads;    ///< 编码线程数 (内核用例为 "-")。
+    QString container;  ///< 封装格式 (内核用例为 "-")。
+    int frames = 0;     ///< 处理的帧数。
+    int dropped = 0;    ///< 丢弃的帧数。
+    double fps = 0;     ///< 帧率。
+    qint64 p50Ns = 0, p95Ns = 0, p99Ns = 0; ///< 每帧延迟的百分位数。
+    double cpuPercent = 0; ///< 进程 CPU 占用 (100 为一个核)。
+    qint64 peakRssKb = 0;  ///< 峰值 RSS。
+    qint64 outBytes = 0;   ///< 输出文件大小 (内核用例为0)。
+
+    /**
+     * @brief 用于与基线比较的键 (除测量值外的所有列)。
+     */
+    QString key() const
+    {
+        return QStringList({kind, name, size, format, backend, preset, threads, container}).join('\t');
+    }
+};
+
+const char *const RESULT_HEADER =
+        "kind\tname\tsize\tformat\tbackend\tpreset\tthreads\tcontainer\t"
+        "frames\tdropped\tfps\tp50_ms\tp95_ms\tp99_ms\tcpu_pct\tpeak_rss_kb\tout_bytes";
+const int KEY_COLUMNS = 8; ///< 结果行中构成用例键的列数。
+const int FPS_COLUMN = 10; ///< 结果行中帧率所在的列。
+
+QString formatResult(const Result &r)
+{
+    return r.key() + '\t' + QStringList({
+        QString::number(r.frames), QString::number(r.dropped),
+        QString::number(r.fps, 'f', 1),
+        QString::number(r.p50Ns / 1e6, 'f', 3), QString::number(r.p95Ns / 1e6, 'f', 3), QString::number(r.p99Ns / 1e6, 'f', 3),
+        QString::number(r.cpuPercent, 'f', 0), QString::number(r.peakRssKb), QString::number(r.outBytes)
+    }).join('\t');
+}
+
+/**
+ * @brief 一个转换内核：把 src 的一帧转换到 dst 中的缓冲区。
+ */
+struct Kernel {
+    const char *name;
+    BenchFormat format;
+    bool vectorized; ///< 有向量化实现 (否则只在标量实现下测一次)。
+    void (*run)(const uint8_t *src, int width, int height, uint8_t *dst);
+};
+
+void runRgb565ToRgb888(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    pixconv_rgb565_to_rgb888(reinterpret_cast<const uint16_t *>(src), dst, width * height);
+}
+
+void runRgb565ToRgb32(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    pixconv_rgb565_to_rgb32(reinterpret_cast<const uint16_t *>(src), reinterpret_cast<uint32_t *>(dst), width * height);
+}
+
+void runRgb565ToI420(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    pixconv_rgb565_to_i420(src, width * 2, width, height,
+                           dst, width, dst + width * height, cw, dst + width * height + cw * ch, cw);
+}
+
+void runYuyvToI420(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    pixconv_yuyv_to_i420(src, width * 2, width, height,
+                         dst, width, dst + width * height, cw, dst + width * height + cw * ch, cw);
+}
+
+void runNv12ToI420(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    pixconv_nv12_to_i420(src, width, src + width * height, width, width, height,
+                         dst, width, dst + width * height, cw, dst + width * height + cw * ch, cw);
+}
+
+void runYuyvToRgb32(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    pixconv_yuyv_to_rgb32(src, reinterpret_cast<uint32_t *>(dst), width * height);
+}
+
+void runNv12ToRgb32(const uint8_t *src, int width, int height, uint8_t *dst)
+{
+    // NV12 的 UV 行由上下两行共用，逐行转换
+    for (int y = 0; y < height; ++y) {
+        pixconv_nv12_to_rgb32(src + y * width, src + width * height + (y / 2) * width,
+                              reinterpret_cast<uint32_t *>(dst) + y * width, width);
+    }
+}
+
+const Kernel KERNELS[] = {
+    {"rgb565_to_rgb888", FormatRgb565, true, runRgb565ToRgb888},
+    {"rgb565_to_rgb32", FormatRgb565, true, runRgb565ToRgb32},
+    {"rgb565_to_i420", FormatRgb565, true, runRgb565ToI420},
+    {"yuyv_to_i420", FormatYuyv, true, runYuyvToI420},
+    {"nv12_to_i420", FormatNv12, true, runNv12ToI420},
+    {"yuyv_to_rgb32", FormatYuyv, false, runYuyvToRgb32},
+    {"nv12_to_rgb32", FormatNv12, false, runNv12ToRgb32},
+};
+
+/**
+ * @brief 收集录制线程输出的每个数据包相对入队时刻的延迟 (在录制线程中回调)。
+ *
+ * 数据包的显示时间戳由采集时间戳换算而来 (相对第一帧，1/90000 秒)，反算即可得到这一帧的入队时刻，
+ * 不需要在两个线程之间传递逐帧的记录。
+ */
+class LatencySink : public PacketSink
+{
+public:
+    explicit LatencySink(int expectedFrames) : m_firstUs(-1), m_timeBase{1, 90000} { m_latencies.reserve(expectedFrames); }
+
+    /**
+     * @brief 记录第一帧的采集时间戳 (送入第一帧之前调用)。
+     */
+    void setFirstTimestamp(qint64 us) { m_firstUs = us; }
+
+    void streamStarted(const AVCodecParameters *, AVRational timeBase) override { m_timeBase = timeBase; }
+
+    void consumePacket(const AVPacket *packet) override
+    {
+        if (m_firstUs < 0 || packet->pts == AV_NOPTS_VALUE) {
+            return;
+        }
+        const qint64 captureUs = m_firstUs + av_rescale_q(packet->pts, m_timeBase, AVRational{1, 1000000});
+        m_latencies.push_back((PipelineMetrics::nowUs() - captureUs) * 1000);
+    }
+
+    void streamStopped() override {}
+
+    /**
+     * @brief 各帧的延迟 (纳秒)。录制线程退出后才能读取。
+     */
+    std::vector<qint64> &latencies() { return m_latencies; }
+
+private:
+    qint64 m_firstUs;
+    AVRational m_timeBase;
+    std::vector<qint64> m_latencies;
+};
+
+/**
+ * @brief 基准测试的参数。
+ */
+struct Options {
+    int frames = 300;
+    QList<QSize> sizes;
+    QList<BenchFormat> formats;
+    QStringList presets;
+    QList<int> threads;
+    QList<RecordingThread::ContainerFormat> containers;
+    QStringList encoders;
+    QString inputPath;
+    int realtimeFps = 0;
+    bool kernels = true;
+    bool pipeline = true;
+};
+
+QString containerName(RecordingThread::ContainerFormat container)
+{
+    switch (container) {
+    case RecordingThread::ContainerMp4:   return "mp4";
+    case RecordingThread::ContainerMpegTs: return "ts";
+    default:                              return "fmp4";
+    }
+}
+
+QList<QByteArray> loadFrames(const Options &options, BenchFormat format, const QSize &size)
+{
+    static const int FRAME_SET = 32; // 循环使用的不同画面数
+    const int bytes = frameBytes(format, size.width(), size.height());
+    return options.inputPath.isEmpty() ? syntheticFrames(format, size.width(), size.height(), FRAME_SET)
+                                       : fileFrames(options.inputPath, bytes, FRAME_SET * 2);
+}
+
+QList<Result> benchKernels(const Options &options)
+{
+    static const pixconv_backend BACKENDS[] = {
+        PIXCONV_BACKEND_SCALAR, PIXCONV_BACKEND_SSE2, PIXCONV_BACKEND_AVX2, PIXCONV_BACKEND_NEON
+    };
+    QList<Result> results;
+    for (const QSize &size : options.sizes) {
+        const int w = size.width(), h = size.height();
+        QByteArray dst(w * h * 4, 0); // 最大的输出为 RGB32
+        for (const Kernel &kernel : KERNELS) {
+            if (!options.formats.contains(kernel.format)) {
+                continue;
+            }
+            const QList<QByteArray> frames = loadFrames(options, kernel.format, size);
+            if (frames.isEmpty()) {
+                continue;
+            }
+            for (pixconv_backend backend : BACKENDS) {
+                if ((!kernel.vectorized && backend != PIXCONV_BACKEND_SCALAR) || pixconv_select_backend(backend) != 0) {
+                    continue; // 当前 CPU 或编译配置不支持
+                }
+                std::vector<qint64> times;
+                times.reserve(options.frames);
+                resetPeakRss();
+                const qint64 cpuStart = processCpuNs();
+                const qint64 wallStart = monotonicNs();
+                for (int i = 0; i < options.frames; ++i) {
+                    const qint64 start = monotonicNs();
+                    kernel.run(reinterpret_cast<const uint8_t *>(frames.at(i % frames.size()).constData()), w, h,
+                               reinterpret_cast<uint8_t *>(dst.data()));
+                    times.push_back(monotonicNs() - start);
+                }
+                const qint64 wall = qMax<qint64>(1, monotonicNs() - wallStart);
+
+                Result r;
+                r.kind = "kernel";
+                r.name = kernel.name;
+                r.size = QString("%1x%2").arg(w).arg(h);
+                r.format = formatName(kernel.format);
+                r.backend = pixconv_backend_name();
+                r.preset = r.threads = r.container = "-";
+                r.frames = options.frames;
+                r.fps = options.frames * 1e9 / wall;
+                r.p50Ns = percentile(times, 0.50);
+                r.p95Ns = percentile(times, 0.95);
+                r.p99Ns = percentile(times, 0.99);
+                r.cpuPercent = 100.0 * (processCpuNs() - cpuStart) / wall;
+                r.peakRssKb = peakRssKb();
+                results.append(r);
+            }
+        }
+    }
+    pixconv_select_backend(PIXCONV_BACKEND_AUTO);
+    return results;
+}
+
+/**
+ * @brief 用一个独立的录制线程跑完一个流水线用例。
+ * @return 编码器打不开或录制出错时返回 false。
+ */
+bool runPipelineCase(const Options &options, const QString &dir, BenchFormat format, const QSize &size,
+                     const QString &preset, int threads, RecordingThread::ContainerFormat container, Result *result)
+{
+    const QList<QByteArray> frames = loadFrames(options, format, size);
+    if (frames.isEmpty()) {
+        return false;
+    }
+    const QString path = QString("%1/bench_%2x%3_%4.%5").arg(dir).arg(size.width()).arg(size.height())
+            .arg(formatName(format)).arg(RecordingThread::fileSuffix(container));
+
+    RecordingThread *recorder = new RecordingThread();
+    recorder->setAutoSegmentation(false);
+    recorder->setMotionDetection(false);
+    recorder->setSubstream(false);
+    recorder->setContainerFormat(container);
+    recorder->setEncoderPreference(options.encoders);
+    recorder->setSoftwareEncoderOptions(preset, threads);
+    // 不限速时队列满了就等编码线程 (测吞吐量)；按实时帧率送帧时和设备上一样丢弃最旧的帧
+    recorder->setOverflowPolicy(options.realtimeFps > 0 ? RecordingThread::DropOldest : RecordingThread::BlockCapture);
+    QAtomicInt failed(0); // recordError 在录制线程中直接回调
+    QObject::connect(recorder, &RecordingThread::recordError, [&failed](const QString &error) {
+        qWarning() << "录制错误:" << error;
+        failed.store(1);
+    });
+    LatencySink sink(options.frames);
+    recorder->addPacketSink(&sink);
+
+    resetPeakRss();
+    const qint64 cpuStart = processCpuNs();
+    const qint64 wallStart = monotonicNs();
+    const int nominalFps = options.realtimeFps > 0 ? options.realtimeFps : 30;
+    if (!recorder->startRecording(path, size.width(), size.height(), avFormat(format), AV_CODEC_ID_RAWVIDEO, nominalFps)) {
+        recorder->removePacketSink(&sink);
+        delete recorder;
+        return false;
+    }
+    const QString encoder = recorder->encoderName();
+    const int encoderThreads = recorder->encoderThreads(); // 编码器实际打开的线程数，可能与请求的不同
+
+    const qint64 intervalNs = options.realtimeFps > 0 ? 1000000000LL / options.realtimeFps : 0;
+    const qint64 feedStart = monotonicNs();
+    for (int i = 0; i < options.frames && !failed.load(); ++i) {
+        if (intervalNs > 0) {
+            // 按实时帧率送帧：睡到这一帧的时刻
+            const qint64 due = feedStart + i * intervalNs;
+            const qint64 wait = due - monotonicNs();
+            if (wait > 0) {
+                struct timespec ts = {static_cast<time_t>(wait / 1000000000LL), static_cast<long>(wait % 1000000000LL)};
+                nanosleep(&ts, nullptr);
+            }
+        }
+        const QByteArray &frame = frames.at(i % frames.size());
+        const qint64 timestampUs = PipelineMetrics::nowUs();
+        if (i == 0) {
+            sink.setFirstTimestamp(timestampUs);
+        }
+        recorder->addFrameToQueue(reinterpret_cast<const unsigned char *>(frame.constData()), frame.size(),
+                                  frameStride(format, size.width()), timestampUs);
+    }
+    const int dropped = recorder->droppedFrames(); // 两种策略下丢弃的帧都计入
+    recorder->stopRecording();
+    recorder->removePacketSink(&sink);
+    delete recorder; // 析构时编码完剩余的帧并写入文件尾，等录制线程退出
+    const qint64 wall = qMax<qint64>(1, monotonicNs() - wallStart);
+
+    std::vector<qint64> &latencies = sink.latencies();
+    result->kind = "pipeline";
+    result->name = encoder;
+    result->size = QString("%1x%2").arg(size.width()).arg(size.height());
+    result->format = formatName(format);
+    result->backend = pixconv_backend_name();
+    result->preset = preset;
+    result->threads = QString::number(encoderThreads);
+    result->container = containerName(container);
+    result->frames = static_cast<int>(latencies.size());
+    result->dropped = dropped;
+    result->fps = latencies.size() * 1e9 / wall;
+    result->p50Ns = percentile(latencies, 0.50);
+    result->p95Ns = percentile(latencies, 0.95);
+    result->p99Ns = percentile(latencies, 0.99);
+    result->cpuPercent = 100.0 * (processCpuNs() - cpuStart) / wall;
+    result->peakRssKb = peakRssKb();
+    result->outBytes = QFileInfo(path).size();
+    QFile::remove(path);
+    QFile::remove(KeyFrameIndex::indexPath(path));
+    return !failed.load();
+}
+
+QList<Result> benchPipeline(const Options &options)
+{
+    QList<Result> results;
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning() << "无法创建临时目录";
+        return results;
+    }
+    for (const QSize &size : options.sizes) {
+        for (BenchFormat format : options.formats) {
+            for (const QString &preset : options.presets) {
+                for (int threads : options.threads) {
+                    for (RecordingThread::ContainerFormat container : options.containers) {
+                        Result r;
+                        if (runPipelineCase(options, dir.path(), format, size, preset, threads, container, &r)) {
+                            results.append(r);
+                        } else {
+                            qWarning() << "用例失败:" << size << formatName(format) << preset << threads
+                                       << containerName(container);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief 与基线结果比较帧率。
+ * @return 没有用例的帧率下降超过 tolerancePercent 时返回 true。
+ */
+bool compareWithBaseline(const QList<Result> &results, const QString &baselinePath, double tolerancePercent)
+{
+    QFile file(baselinePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "无法打开基线文件" << baselinePath << file.errorString();
+        return false;
+    }
+    QMap<QString, double> baseline;
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        const QList<QByteArray> columns = line.split('\t');
+        if (line.startsWith('#') || line.startsWith("kind\t") || columns.size() <= FPS_COLUMN) {
+            continue;
+        }
+        QStringList key;
+        for (int i = 0; i < KEY_COLUMNS; ++i) {
+            key << QString::fromUtf8(columns.at(i));
+        }
+        baseline.insert(key.join('\t'), columns.at(FPS_COLUMN).toDouble());
+    }
+
+    QTextStream err(stderr);
+    bool ok = true;
+    for (const Result &r : results) {
+        if (!baseline.contains(r.key())) {
+            continue; // 新用例
+        }
+        const double before = baseline.value(r.key());
+        if (before > 0 && r.fps < before * (1.0 - tolerancePercent / 100.0)) {
+            err << "REGRESSION\t" << r.key() << "\t" << QString::number(before, 'f', 1)
+                << " -> " << QString::number(r.fps, 'f', 1) << " fps\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool verboseLog = false;
+
+/**
+ * @brief 默认屏蔽录制线程的调试日志，结果只输出到标准输出。
+ */
+void messageHandler(QtMsgType type, const QMessageLogContext &, const QString &message)
+{
+    if (type == QtDebugMsg && !verboseLog) {
+        return;
+    }
+    QTextStream(stderr) << message << '\n';
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pipeline_bench");
+    qInstallMessageHandler(messageHandler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("采集 -> 转换 -> 编码 -> 封装流水线的基准测试 (结果为制表符分隔，可直接 diff)");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"frames", "每个用例的帧数。", "n", "300"},
+        {"sizes", "分辨率列表。", "WxH,...", "640x480,1280x720"},
+        {"formats", "输入像素格式 (rgb565, yuyv, nv12)。", "list", "rgb565,yuyv,nv12"},
+        {"presets", "软件编码器预设。", "list", "ultrafast"},
+        {"threads", "编码线程数 (0 为跟随CPU核数)。", "list", "0"},
+        {"containers", "封装格式 (fmp4, ts, mp4)。", "list", "fmp4"},
+        {"encoders", "编码器候选顺序 (为空时为默认的硬件优先顺序)。", "list", ""},
+        {"input", "预先录制的原始帧文件 (只能配合一个分辨率和一个格式)。", "file"},
+        {"realtime", "按给定帧率送帧 (默认不限速，测吞吐量)。", "fps", "0"},
+        {"kernels-only", "只测转换内核。"},
+        {"pipeline-only", "只测录制流水线。"},
+        {"output", "结果文件 (默认为标准输出)。", "file"},
+        {"compare", "与基线结果比较，帧率下降超过容差时返回1。", "file"},
+        {"tolerance", "比较的容差 (百分比)。", "percent", "10"},
+        {"verbose", "显示录制线程的日志。"},
+    });
+    parser.process(app);
+    verboseLog = parser.isSet("verbose");
+
+    Options options;
+    options.frames = qMax(1, parser.value("frames").toInt());
+    for (const QString &text : parser.value("sizes").split(',', QString::SkipEmptyParts)) {
+        const QStringList wh = text.split('x');
+        const int w = wh.value(0).toInt(), h = wh.value(1).toInt();
+        if (w < 16 || h < 16 || (w & 1) || (h & 1)) {
+            qCritical() << "无效的分辨率:" << text;
+            return 2;
+        }
+        options.sizes << QSize(w, h);
+    }
+    for (const QString &text : parser.value("formats").split(',', QString::SkipEmptyParts)) {
+        if (text == "rgb565") options.formats << FormatRgb565;
+        else if (text == "yuyv") options.formats << FormatYuyv;
+        else if (text == "nv12") options.formats << FormatNv12;
+        else { qCritical() << "未知的像素格式:" << text; return 2; }
+    }
+    options.presets = parser.value("presets").split(',', QString::SkipEmptyParts);
+    for (const QString &text : parser.value("threads").split(',', QString::SkipEmptyParts)) {
+        options.threads << qMax(0, text.toInt());
+    }
+    for (const QString &text : parser.value("containers").split(',', QString::SkipEmptyParts)) {
+        if (text == "fmp4") options.containers << RecordingThread::ContainerFragmentedMp4;
+        else if (text == "ts") options.containers << RecordingThread::ContainerMpegTs;
+        else if (text == "mp4") options.containers << RecordingThread::ContainerMp4;
+        else { qCritical() << "未知的封装格式:" << text; return 2; }
+    }
+    options.encoders = parser.value("encoders").split(',', QString::SkipEmptyParts);
+    options.inputPath = parser.value("input");
+    options.realtimeFps = qMax(0, parser.value("realtime").toInt());
+    options.kernels = !parser.isSet("pipeline-only");
+    options.pipeline = !parser.isSet("kernels-only");
+    if (!options.inputPath.isEmpty() && (options.sizes.size() != 1 || options.formats.size() != 1)) {
+        qCritical() << "--input 只能配合一个 --sizes 和一个 --formats";
+        return 2;
+    }
+    if (options.presets.isEmpty() || options.threads.isEmpty() || options.containers.isEmpty()) {
+        qCritical() << "预设、线程数和封装格式列表不能为空";
+        return 2;
+    }
+
+    QList<Result> results;
+    if (options.kernels) {
+        results += benchKernels(options);
+    }
+    if (options.pipeline) {
+        results += benchPipeline(options);
+    }
+
+    QFile outFile;
+    if (parser.isSet("output")) {
+        outFile.setFileName(parser.value("output"));
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            qCritical() << "无法写入结果文件" << outFile.fileName() << outFile.errorString();
+            return 2;
+        }
+    } else {
+        outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&outFile);
+    out << "# pipeline_bench pixconv=" << pixconv_backend_name() << " avcodec=" << LIBAVCODEC_IDENT << '\n';
+    out << RESULT_HEADER << '\n';
+    for (const Result &r : results) {
+        out << formatResult(r) << '\n';
+    }
+    out.flush();
+
+    if (parser.isSet("compare")) {
+        return compareWithBaseline(results, parser.value("compare"), parser.value("tolerance").toDouble()) ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,386 @@
+/**
+ * @file bufferedfilewriter.cpp
+ * @brief 录像文件后写缓冲写入器 (BufferedFileWriter) 的实现文件。
+ *
+ * 录制线程 (生产者) 只做内存拷贝；`pwrite()`、`fallocate()`、`fdatasync()` 和 `close()` 都在I/O线程中按提交顺序执行。
+ * 每个请求带着自己的文件描述符，分段切换文件时旧文件的请求排在新文件之前，不需要等旧文件写完。
+ */
+
+#include "bufferedfilewriter.h"
+
+#include <fcntl.h>     // open, fallocate, sync_file_range
+#include <unistd.h>    // pwrite, fdatasync, ftruncate, close
+#include <cerrno>
+#include <cstdlib>     // posix_memalign, free
+#include <cstring>     // memcpy, strerror
+
+#include <QMutexLocker>
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+BufferedFileWriter::BufferedFileWriter(QObject *parent)
+    : QThread(parent)
+    , m_avio(nullptr)
+    , m_fd(-1)
+    , m_fill(nullptr)
+    , m_position(0)
+    , m_fileSize(0)
+    , m_allocatedChunks(0)
+    , m_stopRequested(false)
+    , m_preallocatedEnd(0)
+    , m_preallocateSupported(true)
+    , m_failedFd(-1)
+    , m_failedWriteFd(-1)
+    , m_stalledWrites(0)
+{
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+    stopWriter();
+}
+
+void BufferedFileWriter::startWriter()
+{
+    if (isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = false;
+    }
+    m_stalledWrites.store(0);
+    start();
+}
+
+void BufferedFileWriter::stopWriter()
+{
+    if (!isRunning()) {
+        return;
+    }
+    closeFile(false);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_requestCondition.wakeOne();
+    }
+    wait();
+
+    // 所有请求都已执行，块都在空闲列表中
+    QMutexLocker locker(&m_mutex);
+    for (Chunk *chunk : m_freeChunks) {
+        free(chunk->data);
+        delete chunk;
+    }
+    m_freeChunks.clear();
+    m_allocatedChunks = 0;
+    if (m_stalledWrites.load() > 0) {
+        qInfo() << "BufferedFileWriter: 本次录制等待I/O线程" << m_stalledWrites.load() << "次";
+    }
+}
+
+AVIOContext *BufferedFileWriter::openFile(const QString &filePath, qint64 expectedBytes, QString *errorMsg)
+{
+    if (m_avio || !isRunning()) {
+        if (errorMsg) {
+            *errorMsg = m_avio ? "已有文件打开" : "写入线程未启动";
+        }
+        return nullptr;
+    }
+    // 创建文件很快 (只有目录项)，在录制线程中完成以便直接报告错误；预分配交给I/O线程
+    const int fd = ::open(filePath.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        if (errorMsg) {
+            *errorMsg = QString("无法打开输出文件 '%1': %2").arg(filePath).arg(strerror(errno));
+        }
+        return nullptr;
+    }
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(AVIO_BUFFER_BYTES));
+    AVIOContext *avio = buffer ? avio_alloc_context(buffer, AVIO_BUFFER_BYTES, 1, this,
+                                                    nullptr, &BufferedFileWriter::writePacket,
+                                                    &BufferedFileWriter::seekPacket)
+                               : nullptr;
+    if (!avio) {
+        av_free(buffer);
+        ::close(fd);
+        if (errorMsg) {
+            *errorMsg = "无法分配输出缓冲区";
+        }
+        return nullptr;
+    }
+
+    m_avio = avio;
+    m_fd = fd;
+    m_position = 0;
+    m_fileSize = 0;
+    m_failedWriteFd.storeRelease(-1);
+
+    Request request;
+    request.type = Request::Open;
+    request.fd = fd;
+    request.bytes = expectedBytes;
+    enqueue(request);
+    return avio;
+}
+
+void BufferedFileWriter::requestSync()
+{
+    if (!m_avio) {
+        return;
+    }
+    avio_flush(m_avio); // AVIO 缓冲区中的数据写入当前块
+    submitFill();
+    Request request;
+    request.type = Request::Sync;
+    request.fd = m_fd;
+    enqueue(request);
+}
+
+qint64 BufferedFileWriter::closeFile(bool sync)
+{
+    if (!m_avio) {
+        return 0;
+    }
+    avio_flush(m_avio);
+    submitFill();
+    const qint64 fileSize = m_fileSize;
+
+    Request request;
+    request.type = Request::Close;
+    request.fd = m_fd;
+    request.bytes = fileSize;
+    request.sync = sync;
+    enqueue(request);
+
+    av_freep(&m_avio->buffer);
+    avio_context_free(&m_avio);
+    m_fd = -1;
+    return fileSize;
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+int BufferedFileWriter::writePacket(void *opaque, const uint8_t *buf, int size)
+#else
+int BufferedFileWriter::writePacket(void *opaque, uint8_t *buf, int size)
+#endif
+{
+    return static_cast<BufferedFileWriter *>(opaque)->write(buf, size);
+}
+
+int64_t BufferedFileWriter::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    BufferedFileWriter *self = static_cast<BufferedFileWriter *>(opaque);
+    int64_t position = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return self->m_fileSize;
+    case SEEK_SET:
+        position = offset;
+        break;
+    case SEEK_CUR:
+        position = self->m_position + offset;
+        break;
+    case SEEK_END:
+        position = self->m_fileSize + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+    // 只移动位置：下一次写入发现位置不连续时提交当前块
+    self->m_position = position;
+    return position;
+}
+
+int BufferedFileWriter::write(const uint8_t *buf, int size)
+{
+    if (m_failedWriteFd.loadAcquire() == m_fd) {
+        return AVERROR(EIO); // I/O线程已报告写入失败，让封装器的写操作返回错误
+    }
+    int written = 0;
+    while (written < size) {
+        if (m_fill && m_fill->offset + m_fill->length != m_position) {
+            submitFill(); // 封装器回头改写 (或跳回末尾)：从新位置开始下一块
+        }
+        if (!m_fill) {
+            m_fill = acquireChunk();
+            if (!m_fill) {
+                return AVERROR(ENOMEM);
+            }
+            // 块的末尾对齐到 CHUNK_BYTES，之后每一块都写满一个对齐的区间
+            m_fill->offset = m_position;
+            m_fill->length = 0;
+            m_fill->capacity = CHUNK_BYTES - static_cast<int>(m_position % CHUNK_BYTES);
+        }
+        const int n = qMin(size - written, m_fill->capacity - m_fill->length);
+        memcpy(m_fill->data + m_fill->length, buf + written, n);
+        m_fill->length += n;
+        m_position += n;
+        m_fileSize = qMax(m_fileSize, m_position);
+        written += n;
+        if (m_fill->length == m_fill->capacity) {
+            submitFill();
+        }
+    }
+    return written;
+}
+
+void BufferedFileWriter::submitFill()
+{
+    if (!m_fill) {
+        return;
+    }
+    Chunk *chunk = m_fill;
+    m_fill = nullptr;
+    if (chunk->length == 0) {
+        QMutexLocker locker(&m_mutex);
+        m_freeChunks.append(chunk);
+        return;
+    }
+    Request request;
+    request.type = Request::Write;
+    request.fd = m_fd;
+    request.chunk = chunk;
+    enqueue(request);
+}
+
+BufferedFileWriter::Chunk *BufferedFileWriter::acquireChunk()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_freeChunks.isEmpty() && m_allocatedChunks < MAX_CHUNKS) {
+        void *data = nullptr;
+        if (posix_memalign(&data, PAGE_ALIGNMENT, CHUNK_BYTES) != 0) {
+            qWarning() << "BufferedFileWriter: 无法分配写入缓冲区";
+            return nullptr;
+        }
+        Chunk *chunk = new Chunk;
+        chunk->data = static_cast<uint8_t *>(data);
+        ++m_allocatedChunks;
+        return chunk;
+    }
+    if (m_freeChunks.isEmpty()) {
+        // 所有块都在排队：TF卡写入跟不上，只有这时录制线程才等待
+        m_stalledWrites.fetchAndAddRelaxed(1);
+        while (m_freeChunks.isEmpty()) {
+            m_chunkCondition.wait(&m_mutex);
+        }
+    }
+    return m_freeChunks.takeLast();
+}
+
+void BufferedFileWriter::enqueue(const Request &request)
+{
+    QMutexLocker locker(&m_mutex);
+    m_requests.enqueue(request);
+    m_requestCondition.wakeOne();
+}
+
+void BufferedFileWriter::run()
+{
+    forever {
+        Request request;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stopRequested && m_requests.isEmpty()) {
+                m_requestCondition.wait(&m_mutex);
+            }
+            if (m_requests.isEmpty()) {
+                break; // 停止请求，且排队的请求都已执行
+            }
+            request = m_requests.dequeue();
+        }
+        processRequest(request);
+    }
+}
+
+void BufferedFileWriter::processRequest(const Request &request)
+{
+    switch (request.type) {
+    case Request::Open:
+        m_preallocatedEnd = 0;
+        m_failedFd = -1;
+        preallocate(request.fd, request.bytes);
+        break;
+
+    case Request::Write: {
+        Chunk *chunk = request.chunk;
+        if (request.fd != m_failedFd) {
+            preallocate(request.fd, chunk->offset + chunk->length);
+            const uint8_t *data = chunk->data;
+            qint64 offset = chunk->offset;
+            int left = chunk->length;
+            while (left > 0) {
+                const ssize_t n = pwrite(request.fd, data, left, offset);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    failFile(request.fd, QString("写入录像文件失败: %1").arg(n < 0 ? strerror(errno) : "磁盘已满"));
+                    break;
+                }
+                data += n;
+                offset += n;
+                left -= static_cast<int>(n);
+            }
+            if (left == 0 && (chunk->offset + chunk->length) % CHUNK_BYTES == 0) {
+                // 写满了一个对齐的区间：立即开始回写这一整块，脏页不会堆积到内核集中刷新时再一起写
+                const qint64 blockStart = (chunk->offset / CHUNK_BYTES) * CHUNK_BYTES;
+                sync_file_range(request.fd, blockStart, CHUNK_BYTES, SYNC_FILE_RANGE_WRITE);
+            }
+        }
+        QMutexLocker locker(&m_mutex);
+        m_freeChunks.append(chunk);
+        m_chunkCondition.wakeOne();
+        break;
+    }
+
+    case Request::Sync:
+        if (request.fd != m_failedFd && fdatasync(request.fd) < 0) {
+            qWarning() << "BufferedFileWriter: fdatasync 失败:" << strerror(errno);
+        }
+        break;
+
+    case Request::Close:
+        if (request.sync && request.fd != m_failedFd && fdatasync(request.fd) < 0) {
+            qWarning() << "BufferedFileWriter: fdatasync 失败:" << strerror(errno);
+        }
+        // 释放文件尾之后的预分配空间
+        if (m_preallocatedEnd > request.bytes && ftruncate(request.fd, request.bytes) < 0) {
+            qWarning() << "BufferedFileWriter: 无法截断文件:" << strerror(errno);
+        }
+        ::close(request.fd);
+        break;
+    }
+}
+
+void BufferedFileWriter::preallocate(int fd, qint64 end)
+{
+    if (!m_preallocateSupported || end <= m_preallocatedEnd) {
+        return;
+    }
+    // 第一次按预计大小，之后每次多预分配 PREALLOCATE_STEP，避免每一块都调用一次
+    const qint64 newEnd = qMax(end, m_preallocatedEnd + PREALLOCATE_STEP);
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, m_preallocatedEnd, newEnd - m_preallocatedEnd) < 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            qInfo() << "BufferedFileWriter: 文件系统不支持预分配，跳过";
+            m_preallocateSupported = false;
+        }
+        // 空间不足时不报错：实际写入时才会失败，可能在那之前腾出了空间
+        return;
+    }
+    m_preallocatedEnd = newEnd;
+}
+
+void BufferedFileWriter::failFile(int fd, const QString &errorMsg)
+{
+    qWarning() << "BufferedFileWriter:" << errorMsg;
+    m_failedFd = fd;
+    m_failedWriteFd.storeRelease(fd);
+    emit writeError(errorMsg);
+}
@@ -0,0 +1,199 @@
+#ifndef BUFFEREDFILEWRITER_H
+#define BUFFEREDFILEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+/**
+ * @brief 录像文件的后写缓冲写入器 (BufferedFileWriter)
+ *
+ * 为封装器提供一个自定义的 `AVIOContext`，录制线程写出的数据只拷贝进内存中的大块缓冲区，
+ * 由本对象自己的I/O线程写入TF卡，TF卡的写入延迟尖峰 (垃圾回收、元数据更新) 不再阻塞编码：
+ * - 缓冲区按 CHUNK_BYTES (4 MiB，TF卡常见的擦除块大小) 分块，按页对齐分配；每一块对应文件中一段
+ *   以 CHUNK_BYTES 对齐的区间，写满一块才交给I/O线程，写入后立即发起这一整块的回写 (`sync_file_range()`)，
+ *   TF卡看到的是整块的顺序写入，而不是封装器零碎的小写入。
+ * - 打开文件时按预计大小 (码率 × 分段时长) 用 `fallocate()` 预分配空间 (不改变文件大小)，
+ *   写到预分配区间之外时再按 PREALLOCATE_STEP 逐步扩展，文件系统不会把几个同时写入的录像交错分配。
+ *   关闭时截断到实际大小，释放多余的预分配空间。文件系统不支持预分配时跳过。
+ * - 支持封装器回头改写 (普通 MP4 关闭时回写 mdat 的大小)：位置不连续时提交当前块，从新位置开始下一块。
+ * - `requestSync()` (流式封装的刷新周期) 把未写满的块提前提交，并在I/O线程中 `fdatasync()`，录制线程不等待。
+ * - 最多 MAX_CHUNKS 块缓冲区 (按需分配)，全部在排队时录制线程才等待I/O线程 (`stalledWrites()` 计数)。
+ *
+ * 由 `RecordingThread` 在录制会话开始时 `startWriter()`、结束时 `stopWriter()`，中间每个文件
+ * `openFile()` / `closeFile()` 一次。关闭文件只是排队，分段切换文件时不等待旧文件写完；
+ * `stopWriter()` 返回时所有数据都已写入文件。除 `stalledWrites()` 外的方法只能在录制线程中调用。
+ */
+class BufferedFileWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit BufferedFileWriter(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，关闭未关闭的文件、写完排队的数据并释放缓冲区。
+     */
+    ~BufferedFileWriter();
+
+    /**
+     * @brief 启动I/O线程。已启动时无副作用。
+     */
+    void startWriter();
+
+    /**
+     * @brief 关闭未关闭的文件 (不同步)，等I/O线程写完所有排队的数据后退出，并释放缓冲区。未启动时无副作用。
+     */
+    void stopWriter();
+
+    /**
+     * @brief 创建 (截断) 文件并返回写入它的 `AVIOContext` (须先 `startWriter()`)。
+     * @param filePath 文件路径。
+     * @param expectedBytes 预计的文件大小 (字节)，用于预分配；小于等于0时只按 PREALLOCATE_STEP 逐步预分配。
+     * @param errorMsg 失败时输出错误描述，可为 nullptr。
+     * @return 成功返回的上下文由本对象拥有，在 `closeFile()` 时释放 (封装器须设置 `AVFMT_FLAG_CUSTOM_IO`)；
+     *         已有文件打开或无法创建文件时返回 nullptr。
+     */
+    AVIOContext *openFile(const QString &filePath, qint64 expectedBytes, QString *errorMsg = nullptr);
+
+    /**
+     * @brief 是否有 `openFile()` 打开的文件。
+     */
+    bool isFileOpen() const { return m_avio != nullptr; }
+
+    /**
+     * @brief 把已写出的数据交给I/O线程，并在写入后 `fdatasync()` (不等待)。没有打开的文件时无操作。
+     */
+    void requestSync();
+
+    /**
+     * @brief 关闭当前文件并释放它的 `AVIOContext` (不等待数据写完)。没有打开的文件时无操作。
+     * @param sync 是否在关闭前 `fdatasync()`。
+     * @return 文件大小 (字节)。
+     */
+    qint64 closeFile(bool sync);
+
+    /**
+     * @brief 本次会话中录制线程因缓冲区全部排队而等待I/O线程的次数。线程安全。
+     */
+    int stalledWrites() const { return m_stalledWrites.load(); }
+
+signals:
+    /**
+     * @brief 写入失败 (例如存储空间已满、TF卡被拔出) 时发出 (在I/O线程中发出，每个文件一次)。
+     *        之后这个文件的写入都会失败，封装器的写操作返回错误。
+     * @param errorMsg 错误描述信息。
+     */
+    void writeError(const QString &errorMsg);
+
+protected:
+    /**
+     * @brief I/O线程主循环：按顺序执行排队的请求，停止时先写完所有请求。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 一块缓冲区，对应文件中 [offset, offset + length) 的数据。
+     */
+    struct Chunk {
+        uint8_t *data = nullptr; ///< CHUNK_BYTES 字节，按页对齐。
+        qint64 offset = 0;       ///< 第一个字节在文件中的位置。
+        int length = 0;          ///< 已写入的字节数。
+        int capacity = 0;        ///< 这一块最多容纳的字节数 (到下一个 CHUNK_BYTES 对齐位置为止)。
+    };
+
+    /**
+     * @brief I/O线程的请求，按提交顺序执行。
+     */
+    struct Request {
+        enum Type { Open, Write, Sync, Close };
+        Type type = Write;
+        int fd = -1;
+        Chunk *chunk = nullptr;  ///< Write：要写入的块，写完后放回空闲列表。
+        qint64 bytes = 0;        ///< Open：预计大小；Close：文件大小。
+        bool sync = false;       ///< Close：关闭前是否同步。
+    };
+
+    // AVIOContext 回调 (在录制线程中调用)
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+    static int writePacket(void *opaque, const uint8_t *buf, int size);
+#else
+    static int writePacket(void *opaque, uint8_t *buf, int size);
+#endif
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+
+    /**
+     * @brief 把数据拷贝进当前块，写满的块提交给I/O线程。
+     * @return 写入的字节数，或 FFmpeg 错误码。
+     */
+    int write(const uint8_t *buf, int size);
+
+    /**
+     * @brief 把当前块 (非空时) 交给I/O线程。
+     */
+    void submitFill();
+
+    /**
+     * @brief 取一块空闲缓冲区，必要时分配新块或等待I/O线程放回一块。
+     * @return 分配失败时返回 nullptr。
+     */
+    Chunk *acquireChunk();
+
+    /**
+     * @brief 把请求加入队列并唤醒I/O线程。
+     */
+    void enqueue(const Request &request);
+
+    // 以下在I/O线程中执行
+    void processRequest(const Request &request);
+
+    /**
+     * @brief 写到 end 之前保证 [0, end) 已预分配 (按 PREALLOCATE_STEP 向前扩展)。
+     */
+    void preallocate(int fd, qint64 end);
+
+    /**
+     * @brief 记录一次写入失败：本文件之后的写入都跳过，发出 `writeError()`。
+     */
+    void failFile(int fd, const QString &errorMsg);
+
+    static const int CHUNK_BYTES = 4 * 1024 * 1024;       ///< 缓冲块大小和写入对齐单位 (字节)。
+    static const int MAX_CHUNKS = 4;                      ///< 最多分配的缓冲块数 (16 MiB，800 kbps 时约2.7分钟的数据)。
+    static const int AVIO_BUFFER_BYTES = 64 * 1024;       ///< `AVIOContext` 自身的缓冲区大小 (字节)。
+    static const qint64 PREALLOCATE_STEP = 4LL * CHUNK_BYTES; ///< 写出预分配区间时每次扩展的字节数。
+    static const int PAGE_ALIGNMENT = 4096;               ///< 缓冲块的对齐 (字节)。
+
+    // 以下只在录制线程中访问
+    AVIOContext *m_avio;           ///< 当前文件的 AVIO 上下文，nullptr 表示没有打开的文件。
+    int m_fd;                      ///< 当前文件的描述符 (I/O线程在处理 Close 请求后关闭)。
+    Chunk *m_fill;                 ///< 正在填充的块，nullptr 表示下一次写入时再取。
+    qint64 m_position;             ///< 封装器的当前写入位置。
+    qint64 m_fileSize;             ///< 当前文件的大小 (写到过的最大位置)。
+
+    mutable QMutex m_mutex;        ///< 保护以下成员。
+    QWaitCondition m_requestCondition; ///< 有新请求或请求停止时唤醒I/O线程。
+    QWaitCondition m_chunkCondition;   ///< I/O线程放回一块时唤醒录制线程。
+    QQueue<Request> m_requests;    ///< 排队的请求。
+    QVector<Chunk *> m_freeChunks; ///< 空闲的块。
+    int m_allocatedChunks;         ///< 已分配的块数 (空闲、填充中和排队中的块)。
+    bool m_stopRequested;          ///< 请求I/O线程在写完排队的请求后退出。
+
+    // 以下只在I/O线程中访问
+    qint64 m_preallocatedEnd;      ///< 当前文件已预分配到的位置。
+    bool m_preallocateSupported;   ///< 文件系统支持 `fallocate()` (第一次失败时清除)。
+    int m_failedFd;                ///< 已写入失败的文件描述符，-1 表示无。
+
+    QAtomicInt m_failedWriteFd;    ///< 最近写入失败的文件描述符 (-1 表示无)，等于 `m_fd` 时录制线程的写回调返回错误。
+    QAtomicInt m_stalledWrites;    ///< 录制线程等待空闲块的次数。
+};
+
+#endif // BUFFEREDFILEWRITER_H
@@ -0,0 +1,388 @@
+/**
+ * @file camerachannel.cpp
+ * @brief 单路摄像头通道类 (CameraChannel) 的实现文件。
+ *
+ * 一个通道 = 一个摄像头设备 + 一个采集线程 + 一个录制线程。
+ * 通道负责把采集线程和录制线程连接起来、生成和重命名本路的录像文件，
+ * 并把两者的信号加上通道序号后转发给 `MonitorService`。
+ */
+
+#include "camerachannel.h"
+#include "capturethread.h"    // 事件驱动的摄像头采集线程 (V4L2)
+#include "recordingthread.h"  // 视频录制线程类
+#include "networkstreamer.h"  // 网络推流
+#include "recordingcatalog.h" // 录像目录索引
+#include "keyframeindex.h"    // 录像关键帧索引文件
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+CameraChannel::CameraChannel(int index, const QString &device, QObject *parent)
+    : QObject(parent)
+    , m_index(index)
+    , m_device(device)
+    , m_captureThread(nullptr)
+    , m_recorder(nullptr)
+    , m_streamer(nullptr)
+    , m_streamSource(MainStream)
+    , m_substream(false)
+    , m_catalog(nullptr)
+    , m_isRecording(false)
+    , m_preEventSeconds(0)
+    , m_motionDetection(false)
+    , m_lastFrameTime(std::chrono::steady_clock::now())
+    , m_lastFrameCount(0)
+    , m_currentFPS(0.0)
+{
+    // 必须先于录制线程创建：子对象按创建顺序析构，保证采集线程先停止，不会再回调已销毁的录制线程。
+    m_captureThread = new CaptureThread(this);
+    connect(m_captureThread, &CaptureThread::frameReady, this, [this]() {
+        emit frameReady(m_index);
+    });
+    connect(m_captureThread, &CaptureThread::captureError, this, [this](const QString &errorMsg) {
+        emit captureError(m_index, errorMsg);
+    });
+
+    m_recorder = new RecordingThread(this);
+    // 录制线程作为帧消费者注册到本路采集线程上，未在录制时会直接忽略收到的帧
+    m_captureThread->addSink(m_recorder);
+    connect(m_recorder, &RecordingThread::recordError, this, [this](const QString &errorMsg) {
+        emit recordError(m_index, errorMsg);
+    });
+    // 录制线程内部分段：上一段已写完文件尾并关闭 (信号在录制线程中发出，这里在GUI线程中排队处理)
+    connect(m_recorder, &RecordingThread::segmentFinished, this,
+            [this](const QString &filePath, const QDateTime &startTime, const QDateTime &endTime) {
+        const QString finalPath = renameToTimeRange(filePath, startTime, endTime);
+        writeThumbnail(finalPath);
+        fileRenamed(filePath, finalPath, startTime, endTime);
+        emit segmentReached(m_index, finalPath);
+    });
+    // 文件大小和关键帧数只有录制线程写完文件尾后才知道 (排队到GUI线程，分段时先于 segmentFinished 到达)
+    connect(m_recorder, &RecordingThread::fileClosed, this, &CameraChannel::fileClosed);
+    connect(m_recorder, &RecordingThread::motionStarted, this, [this]() {
+        emit motionStarted(m_index);
+    });
+    connect(m_recorder, &RecordingThread::motionStopped, this, [this]() {
+        emit motionStopped(m_index);
+    });
+}
+
+CameraChannel::~CameraChannel()
+{
+    m_captureThread->stopCapture();
+}
+
+bool CameraChannel::startCapture(const v4l2_params &params)
+{
+    if (!m_captureThread->startCapture(m_device, params)) {
+        return false; // 失败原因已由采集线程输出
+    }
+    m_lastFrameTime = std::chrono::steady_clock::now(); // 重新开始FPS统计 (采集线程的帧计数已清零)
+    m_lastFrameCount = 0;
+    m_currentFPS = 0.0;
+
+    // 启用预录时采集期间录制线程一直待命，录制开始时事件文件包含之前若干秒的画面；
+    // 移动侦测在录制线程中进行，网络推流使用录制线程编码出的数据包，同样需要待命
+    if ((m_preEventSeconds > 0 || m_motionDetection || m_streamer) && !startRecorder(QString())) {
+        qWarning() << "通道" << m_index << "无法进入待命录制，录制将不包含预录画面";
+    }
+    if (m_streamer) {
+        m_streamer->startStreaming();
+    }
+    return true;
+}
+
+void CameraChannel::stopCapture()
+{
+    if (m_isRecording) {
+        stopRecording(QDateTime::currentDateTime());
+    }
+    m_recorder->stopRecording(); // 结束待命录制 (未在待命时不执行任何操作)
+    m_captureThread->stopCapture();
+    if (m_streamer) {
+        m_streamer->stopStreaming();
+    }
+}
+
+bool CameraChannel::isCapturing() const
+{
+    return m_captureThread->isCapturing();
+}
+
+bool CameraChannel::takeLatestImage(QImage &image)
+{
+    // 信箱为空 (例如多个通知合并后已被取走) 时直接返回
+    if (!m_captureThread->takeLatestImage(image)) {
+        return false;
+    }
+    updateFps();
+    return true;
+}
+
+void CameraChannel::setRawPreview(bool enable)
+{
+    m_captureThread->setRawPreview(enable);
+}
+
+bool CameraChannel::takeLatestFrame(PreviewFrame &frame)
+{
+    if (!m_captureThread->takeLatestFrame(frame)) {
+        return false;
+    }
+    updateFps();
+    return true;
+}
+
+void CameraChannel::updateFps()
+{
+    // 按两次预览之间实际采集的帧数计算瞬时FPS (预览限速或跳帧时显示的仍是摄像头的帧率)，
+    // 并使用指数移动平均法进行平滑处理 (alpha = 0.2)
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastFrameTime).count() / 1000000.0;
+    const unsigned int frameCount = m_captureThread->capturedFrames();
+    const unsigned int frames = frameCount - m_lastFrameCount;
+    m_lastFrameTime = now;
+    m_lastFrameCount = frameCount;
+    if (elapsed > 0) { // 防止除以零
+        m_currentFPS = 0.8 * m_currentFPS + 0.2 * (frames / elapsed);
+    }
+}
+
+void CameraChannel::setPreviewRate(int fps)
+{
+    m_captureThread->setPreviewRate(fps);
+}
+
+void CameraChannel::setPreviewPaused(bool paused)
+{
+    m_captureThread->setPreviewPaused(paused);
+}
+
+bool CameraChannel::startRecording(const QString &dirPath, const QDateTime &startTime)
+{
+    if (m_isRecording) {
+        return true;
+    }
+    if (!isCapturing()) {
+        qWarning() << "通道" << m_index << "(" << m_device << ") 未在采集，跳过录制";
+        return false;
+    }
+
+    // 初始文件名格式: <目录>/record_HHmmss.<扩展名>，分段或停止录制时重命名为 HH:mm-HH:mm.<扩展名>
+    // 扩展名跟随录制线程的封装格式 (分片 MP4 / 普通 MP4 为 mp4，MPEG-TS 为 ts)
+    const QString videoFile = dirPath + "/record_" + startTime.toString("HHmmss") + "."
+            + RecordingThread::fileSuffix(m_recorder->containerFormat());
+    qDebug() << "通道" << m_index << "视频将保存至 (初始):" << videoFile;
+
+    // 待命录制中：开始一个事件，文件先写入预录缓冲区中的画面；否则启动一次普通录制
+    const bool started = m_recorder->isStandby() ? m_recorder->beginEvent(videoFile) : startRecorder(videoFile);
+    if (!started) {
+        qWarning() << "通道" << m_index << "无法启动视频录制";
+        return false;
+    }
+    m_isRecording = true;
+    return true;
+}
+
+bool CameraChannel::startRecorder(const QString &filePath)
+{
+    // 帧尺寸直接取自驱动实际生效的格式，不需要等第一帧预览到达
+    const QSize size = m_captureThread->frameSize();
+    if (size.width() <= 0 || size.height() <= 0) {
+        qWarning() << "通道" << m_index << "帧尺寸无效，无法开始录制";
+        return false;
+    }
+
+    // 录制线程直接接收摄像头协商出的原始帧 (NV12/YUYV/RGB565 直接转换，MJPEG 先解码)
+    AVPixelFormat inputFormat = AV_PIX_FMT_NONE;
+    AVCodecID inputCodec = AV_CODEC_ID_RAWVIDEO;
+    if (!RecordingThread::inputFromV4l2(m_captureThread->pixelFormat(), &inputFormat, &inputCodec)) {
+        qWarning() << "通道" << m_index << "采集格式不支持录制";
+        return false;
+    }
+    // 标称帧率只用于码率控制，时间戳取自驱动给出的每帧采集时间
+    if (filePath.isEmpty()) {
+        return m_recorder->startStandby(size.width(), size.height(), inputFormat, inputCodec,
+                                        m_captureThread->frameRate());
+    }
+    return m_recorder->startRecording(filePath, size.width(), size.height(), inputFormat, inputCodec,
+                                      m_captureThread->frameRate());
+}
+
+void CameraChannel::setPreEventSeconds(int seconds)
+{
+    m_preEventSeconds = qMax(0, seconds);
+    if (m_preEventSeconds > 0) {
+        m_recorder->setPreEventBuffer(m_preEventSeconds);
+    }
+}
+
+void CameraChannel::setMotionDetection(bool enable)
+{
+    m_motionDetection = enable;
+    m_recorder->setMotionDetection(enable);
+}
+
+void CameraChannel::setStreamUrl(const QString &url, StreamSource source)
+{
+    if (m_streamer && m_streamer->url() == url && m_streamSource == source) {
+        return;
+    }
+    if (m_streamer) {
+        // 返回后编码线程不会再回调它
+        if (m_streamSource == SubStream) {
+            m_recorder->substream()->removePacketSink(m_streamer);
+        } else {
+            m_recorder->removePacketSink(m_streamer);
+        }
+        delete m_streamer;
+        m_streamer = nullptr;
+    }
+    if (url.isEmpty()) {
+        return;
+    }
+    m_streamer = new NetworkStreamer(url, this);
+    m_streamSource = source;
+    // 推流连接建立或丢弃积压时请求 IDR：直接连接，可能在编码线程或推流线程中调用 (只设置一个原子标志)
+    if (source == SubStream) {
+        if (!m_substream) {
+            qWarning() << "通道" << m_index << "未启用子码流，推流在启用子码流之前没有数据";
+        }
+        connect(m_streamer, &NetworkStreamer::keyFrameNeeded, m_recorder->substream(),
+                &SubstreamEncoder::requestKeyFrame, Qt::DirectConnection);
+        m_recorder->substream()->addPacketSink(m_streamer);
+    } else {
+        connect(m_streamer, &NetworkStreamer::keyFrameNeeded, m_recorder, &RecordingThread::requestKeyFrame,
+                Qt::DirectConnection);
+        m_recorder->addPacketSink(m_streamer);
+    }
+    qDebug() << "通道" << m_index << "推流地址:" << url << (source == SubStream ? "(子码流)" : "(主码流)");
+}
+
+void CameraChannel::setSubstream(bool enable, const SubstreamEncoder::Settings &settings)
+{
+    m_substream = enable;
+    m_recorder->setSubstream(enable, settings);
+}
+
+QString CameraChannel::thumbnailPath(const QString &videoPath)
+{
+    const QFileInfo info(videoPath);
+    return info.dir().absolutePath() + "/.thumbs/" + info.completeBaseName() + ".jpg";
+}
+
+void CameraChannel::writeThumbnail(const QString &videoPath)
+{
+    QImage image;
+    if (!m_substream || videoPath.isEmpty() || !m_recorder->substream()->latestImage(&image)) {
+        return;
+    }
+    const QString path = thumbnailPath(videoPath);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    if (!image.save(path, "JPG", 80)) {
+        qWarning() << "无法写入缩略图:" << path;
+    }
+}
+
+bool CameraChannel::isMotionActive() const
+{
+    return m_recorder->isMotionActive();
+}
+
+QString CameraChannel::stopRecording(const QDateTime &endTime)
+{
+    if (!m_isRecording) {
+        return QString();
+    }
+    m_isRecording = false;
+    if (m_recorder->isStandby()) {
+        // 待命录制：只结束事件，录制线程继续缓冲；事件文件尚未打开 (事件极短) 时没有文件需要处理
+        if (!m_recorder->endEvent()) {
+            return QString();
+        }
+    } else if (m_recorder->cancelPendingSession()) {
+        return QString(); // 上一段录制收尾期间开始、尚未真正开始的录制：没有打开过文件
+    } else {
+        m_recorder->stopRecording();
+    }
+
+    // stopRecording() / endEvent() 返回后录制线程不会再分段，取到的就是最后一段的文件和开始时间
+    const QString filePath = m_recorder->getFilePath();
+    if (filePath.isEmpty()) {
+        return QString(); // 收尾后才开始的录制初始化失败 (已通过 recordError 报告)
+    }
+    const QDateTime startTime = m_recorder->segmentStartTime();
+    const QString finalPath = renameToTimeRange(filePath, startTime, endTime);
+    writeThumbnail(finalPath);
+    fileRenamed(filePath, finalPath, startTime, endTime);
+    return finalPath;
+}
+
+void CameraChannel::fileRenamed(const QString &originalPath, const QString &finalPath,
+                                const QDateTime &startTime, const QDateTime &endTime)
+{
+    PendingFile &file = m_pendingFiles[originalPath];
+    file.renamed = true;
+    file.finalPath = finalPath;
+    file.startTime = startTime;
+    file.endTime = endTime;
+    file.event = m_recorder->isStandby();
+    if (file.closed) {
+        finishFile(originalPath, file);
+        m_pendingFiles.remove(originalPath);
+    }
+}
+
+void CameraChannel::fileClosed(const QString &originalPath, qint64 bytes, int keyFrames, bool motion)
+{
+    PendingFile &file = m_pendingFiles[originalPath];
+    file.closed = true;
+    file.bytes = bytes;
+    file.keyFrames = keyFrames;
+    file.motion = motion;
+    if (file.renamed) {
+        finishFile(originalPath, file);
+        m_pendingFiles.remove(originalPath);
+    }
+}
+
+void CameraChannel::finishFile(const QString &originalPath, const PendingFile &file)
+{
+    // 录制线程关闭文件时按原始路径保存了关键帧索引，跟随录像文件改名
+    if (file.finalPath != originalPath) {
+        const QString indexPath = KeyFrameIndex::indexPath(file.finalPath);
+        QFile::remove(indexPath);
+        QFile::rename(KeyFrameIndex::indexPath(originalPath), indexPath);
+    }
+    if (!m_catalog) {
+        return;
+    }
+    RecordingCatalog::Entry entry;
+    entry.startMs = file.startTime.toMSecsSinceEpoch();
+    entry.endMs = file.endTime.toMSecsSinceEpoch();
+    entry.bytes = file.bytes;
+    entry.keyFrames = file.keyFrames;
+    entry.flags = (file.event ? RecordingCatalog::FlagEvent : 0u) | (file.motion ? RecordingCatalog::FlagMotion : 0u);
+    m_catalog->addFile(file.finalPath, entry);
+}
+
+QString CameraChannel::renameToTimeRange(const QString &filePath, const QDateTime &startTime, const QDateTime &endTime)
+{
+    // 根据录制的开始时间和结束时间重命名，格式: HH:mm-HH:mm.<扩展名> (例如: 14:30-15:00.mp4)
+    QFileInfo videoFileInfo(filePath);
+    QString newVideoFileName = startTime.toString("HH:mm") + "-" + endTime.toString("HH:mm") + "." + videoFileInfo.suffix();
+    QString newVideoFilePath = videoFileInfo.dir().absolutePath() + "/" + newVideoFileName;
+
+    QFile videoFile(filePath);
+    if (QFile::exists(newVideoFilePath)) {
+        qWarning() << "重命名失败：目标文件 " << newVideoFilePath << " 已存在。将使用原始文件名：" << filePath;
+    } else if (videoFile.rename(newVideoFilePath)) {
+        qInfo() << "视频文件已成功重命名为:" << newVideoFilePath;
+        return newVideoFilePath;
+    } else {
+        qWarning() << "重命名视频文件失败: 从 " << filePath << " 到 " << newVideoFilePath << ". 错误: " << videoFile.errorString();
+    }
+    return filePath;
+}
@@ -0,0 +1,311 @@
+#ifndef CAMERACHANNEL_H
+#define CAMERACHANNEL_H
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+#include <QSize>
+#include <QDateTime>
+#include <QHash>
+#include <chrono>
+
+#include "v4l2_wrapper.h" // v4l2_params
+#include "previewframe.h" // GPU 预览的原始帧
+#include "substreamencoder.h" // 子码流参数
+
+class CaptureThread;     // 摄像头采集线程类
+class RecordingThread;   // 视频录制线程类
+class NetworkStreamer;   // 网络推流 (已编码数据包消费者)
+class RecordingCatalog;  // 录像目录索引
+
+/**
+ * @brief 单路摄像头通道类 (CameraChannel)
+ *
+ * 把一个摄像头所需的全部对象组合在一起：
+ * - 一个 `CaptureThread` (独占一个 V4L2 上下文和一个采集线程)。
+ * - 一个 `RecordingThread` (作为 FrameSink 注册到采集线程上，负责本路的编码和写文件)。
+ * - 本路录像文件的命名/重命名和采集帧率统计。
+ * - 采集、录制和预览三种帧率互相独立：采集跟随摄像头，录制线程在采集线程中直接取帧 (可设置录制帧率)，
+ *   预览可以限速 (`setPreviewRate()`) 或暂停 (`setPreviewPaused()`)，界面刷新快慢不影响录制。
+ * - 启用预录 (`setPreEventSeconds()`) 时，采集期间录制线程一直处于待命录制，
+ *   `startRecording()` / `stopRecording()` 只开始和结束一个事件文件，文件以事件前的画面开头。
+ * - 启用网络推流 (`setStreamUrl()`) 时录制线程编码出的数据包同时分发给本路的 `NetworkStreamer`，
+ *   同样需要在采集期间待命；远程预览可以选择推送低分辨率子码流。
+ * - 启用子码流 (`setSubstream()`) 时每个录像文件关闭后用子码流的最近画面生成缩略图 (`thumbnailPath()`)。
+ * - 设置了录像索引 (`setCatalog()`) 时，每个录像文件关闭并重命名后登记到索引中。
+ * - 启用移动侦测 (`setMotionDetection()`) 时同样在采集期间待命，录制线程的移动开始/结束带上通道序号转发，
+ *   由 `MonitorService` 决定何时开始和结束事件。
+ *
+ * 多摄像头时 `MonitorService` 为每个设备创建一个通道，各通道之间不共享任何采集或编码状态，
+ * 因此多个摄像头可以分布在不同的CPU核上并行工作。所有信号都带上通道序号，便于页面区分来源。
+ */
+class CameraChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param index 通道序号 (从0开始)，用于界面布局和录像子目录命名。
+     * @param device 设备节点路径，例如 "/dev/video1"。
+     * @param parent 父对象指针
+     */
+    CameraChannel(int index, const QString &device, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数
+     *
+     * 先停止采集 (保证不再回调录制线程)，再由子对象析构停止录制线程。
+     */
+    ~CameraChannel();
+
+    int index() const { return m_index; }                  ///< 通道序号。
+    QString device() const { return m_device; }            ///< 设备节点路径。
+    RecordingThread *recorder() const { return m_recorder; } ///< 本路的录制线程。
+
+    /**
+     * @brief 设置预录时长，从下一次 `startCapture()` 开始生效。
+     * @param seconds 录像文件包含的录制开始前的画面时长 (秒)，0 表示不预录 (默认)。
+     *
+     * 预录需要编码器在采集期间一直工作，会持续占用编码资源，但只在录制期间写TF卡。
+     */
+    void setPreEventSeconds(int seconds);
+
+    /**
+     * @brief 启用或禁用本路的移动侦测，从下一次 `startCapture()` 开始生效。
+     *
+     * 侦测在录制线程中进行，启用后采集期间录制线程一直处于待命录制 (即使未设置预录时长)，
+     * 并在画面静止时降低编码帧率。
+     */
+    void setMotionDetection(bool enable);
+
+    /**
+     * @brief 本路当前是否检测到移动。
+     */
+    bool isMotionActive() const;
+
+    /**
+     * @brief 推流使用的码流。
+     */
+    enum StreamSource {
+        MainStream,  ///< 与本地录像相同的全分辨率码流。
+        SubStream    ///< 低分辨率子码流 (需要 `setSubstream(true)`)，适合带宽有限的远程预览。
+    };
+
+    /**
+     * @brief 设置本路的网络推流地址，从下一次 `startCapture()` 开始生效。
+     * @param url 推流地址 (见 `NetworkStreamer`)；为空时不推流 (默认)。
+     * @param source 推送主码流还是子码流。
+     *
+     * 推流直接使用录制线程 (或子码流) 编码出的数据包，不做额外的编码；推流需要编码器在采集期间一直工作，
+     * 因此启用后采集期间录制线程一直处于待命录制。
+     */
+    void setStreamUrl(const QString &url, StreamSource source = MainStream);
+
+    /**
+     * @brief 启用或禁用本路的低分辨率子码流，从下一次 `startCapture()` 开始生效。
+     * @param enable 是否启用。
+     * @param settings 子码流尺寸、帧率和码率 (默认 320 宽、5fps、100kbps)。
+     */
+    void setSubstream(bool enable, const SubstreamEncoder::Settings &settings = SubstreamEncoder::Settings());
+
+    /**
+     * @brief 录像文件的缩略图路径：同目录下隐藏的 .thumbs 子目录中的同名 JPEG 文件。
+     */
+    static QString thumbnailPath(const QString &videoPath);
+
+    /**
+     * @brief 设置录像索引 (由 `StorageManager` 拥有)，之后关闭的录像文件都登记到索引中。nullptr 表示不登记。
+     */
+    void setCatalog(RecordingCatalog *catalog) { m_catalog = catalog; }
+
+    /**
+     * @brief 打开摄像头并启动本路采集线程。
+     * @param params 期望的分辨率、像素格式和帧率，打开设备时与驱动协商。
+     * @return 成功返回 true；否则返回 false。启用预录时同时让录制线程进入待命录制 (失败只输出警告)。
+     */
+    bool startCapture(const v4l2_params &params = v4l2_params());
+
+    /**
+     * @brief 停止本路录制 (如果正在录制)、待命录制和采集，并释放摄像头资源。
+     */
+    void stopCapture();
+
+    /**
+     * @brief 查询本路是否正在采集。
+     */
+    bool isCapturing() const;
+
+    /**
+     * @brief 取出本路最新的预览图像，并更新预览帧率统计。
+     * @param image 输出参数，接收 RGB32 预览图像。
+     * @return 有新帧返回 true；否则返回 false。
+     */
+    bool takeLatestImage(QImage &image);
+
+    /**
+     * @brief 让采集线程为 GPU 预览提供原始帧 (`takeLatestFrame()`) 而不是 RGB32 图像，下一次 `startCapture()` 生效。
+     */
+    void setRawPreview(bool enable);
+
+    /**
+     * @brief 取出本路最新的原始预览帧 (启用原始预览时)，并更新预览帧率统计。
+     * @param frame 输入输出参数，与采集线程信箱中的帧交换 (见 `CaptureThread::takeLatestFrame()`)。
+     * @return 有新帧返回 true；否则返回 false。
+     */
+    bool takeLatestFrame(PreviewFrame &frame);
+
+    /**
+     * @brief 设置本路的预览帧率上限，可以在采集期间调用，立即生效。
+     * @param fps 每秒最多更新的预览帧数，0 表示跟随采集帧率。不影响采集和录制帧率。
+     */
+    void setPreviewRate(int fps);
+
+    /**
+     * @brief 暂停或恢复本路预览 (例如监控页面不可见时)，可以在采集期间调用。暂停期间录制照常进行。
+     */
+    void setPreviewPaused(bool paused);
+
+    /**
+     * @brief 获取平滑后的采集帧率 (摄像头实际输出的帧率，与预览帧率上限无关)。
+     */
+    double fps() const { return m_currentFPS; }
+
+    /**
+     * @brief 开始录制本路视频。
+     * @param dirPath 录像目录 (已存在)，文件名为 record_HHmmss.<扩展名> (见 `RecordingThread::fileSuffix()`)。
+     * @param startTime 录制开始时间，用于文件命名。
+     * @return 录制线程成功启动返回 true；否则返回 false。
+     */
+    bool startRecording(const QString &dirPath, const QDateTime &startTime);
+
+    /**
+     * @brief 停止录制本路视频，并把最后一段文件重命名为 "HH:mm-HH:mm.mp4"。
+     * @param endTime 录制结束时间，用于文件命名 (开始时间取录制线程记录的本段开始时间)。
+     * @return 最终的文件路径 (重命名失败时为原始路径)；未在录制、或待命录制中事件文件尚未打开时返回空字符串。
+     */
+    QString stopRecording(const QDateTime &endTime);
+
+    /**
+     * @brief 查询本路是否正在录制。
+     */
+    bool isRecording() const { return m_isRecording; }
+
+signals:
+    /**
+     * @brief 本路有新的预览帧可取时发出。
+     * @param index 通道序号。
+     */
+    void frameReady(int index);
+
+    /**
+     * @brief 本路采集发生不可恢复的错误时发出。
+     * @param index 通道序号。
+     * @param errorMsg 错误描述信息。
+     */
+    void captureError(int index, const QString &errorMsg);
+
+    /**
+     * @brief 本路录制线程报告错误时发出。
+     * @param index 通道序号。
+     * @param errorMsg 错误描述信息。
+     */
+    void recordError(int index, const QString &errorMsg);
+
+    /**
+     * @brief 本路录制线程自动分段、上一段文件已关闭并重命名后发出 (录制不中断)。
+     * @param index 通道序号。
+     * @param filePath 已完成的分段文件的最终路径。
+     */
+    void segmentReached(int index, const QString &filePath);
+
+    /**
+     * @brief 本路检测到移动 (由静止变为移动) 时发出。
+     * @param index 通道序号。
+     */
+    void motionStarted(int index);
+
+    /**
+     * @brief 本路移动结束 (静止超过保持时间) 时发出。
+     * @param index 通道序号。
+     */
+    void motionStopped(int index);
+
+private:
+    /**
+     * @brief 按本路协商出的帧尺寸和格式启动录制线程。
+     * @param filePath 输出文件路径；为空时进入待命录制。
+     */
+    bool startRecorder(const QString &filePath);
+
+    /**
+     * @brief 取到一帧预览后，按两次预览之间采集线程实际采集的帧数更新平滑的采集帧率。
+     */
+    void updateFps();
+
+    /**
+     * @brief 按开始和结束时间 (时:分) 把已关闭的录像文件重命名为 "HH:mm-HH:mm<扩展名>"。
+     * @return 最终的文件路径 (目标已存在或重命名失败时为原始路径)。
+     */
+    static QString renameToTimeRange(const QString &filePath, const QDateTime &startTime, const QDateTime &endTime);
+
+    /**
+     * @brief 用子码流的最近一帧画面为已关闭的录像文件生成缩略图 (未启用子码流或还没有画面时不生成)。
+     */
+    void writeThumbnail(const QString &videoPath);
+
+    /**
+     * @brief 录像文件已重命名 (GUI线程)：与录制线程的 `fileClosed()` 配对后调用 `finishFile()`。
+     * @param originalPath 录制线程打开该文件时的路径。
+     * @param finalPath 重命名后的路径。
+     */
+    void fileRenamed(const QString &originalPath, const QString &finalPath,
+                     const QDateTime &startTime, const QDateTime &endTime);
+
+    /**
+     * @brief 录制线程已关闭文件 (GUI线程处理 `RecordingThread::fileClosed()`)：与重命名配对后调用 `finishFile()`。
+     */
+    void fileClosed(const QString &originalPath, qint64 bytes, int keyFrames, bool motion);
+
+    /**
+     * @brief 一个录像文件的两半信息：重命名 (GUI线程) 和关闭 (录制线程) 的先后顺序不确定，
+     *        分段时先关闭后重命名，停止录制时先重命名后关闭，两者都到齐后才处理 (`finishFile()`)。
+     */
+    struct PendingFile {
+        bool renamed = false;
+        bool closed = false;
+        QString finalPath;
+        QDateTime startTime;
+        QDateTime endTime;
+        bool event = false;
+        qint64 bytes = 0;
+        int keyFrames = 0;
+        bool motion = false;
+    };
+
+    /**
+     * @brief 一个录像文件已关闭并重命名：关键帧索引文件跟着改名，设置了录像索引时登记。
+     * @param originalPath 录制线程打开该文件时的路径。
+     */
+    void finishFile(const QString &originalPath, const PendingFile &file);
+
+    int m_index;                       ///< 通道序号。
+    QString m_device;                  ///< 设备节点路径。
+    CaptureThread *m_captureThread;    ///< 本路采集线程 (先于录制线程创建，保证先析构)。
+    RecordingThread *m_recorder;       ///< 本路录制线程。
+    NetworkStreamer *m_streamer;       ///< 本路网络推流，未设置推流地址时为 nullptr (在录制线程之后创建，保证后析构)。
+    StreamSource m_streamSource;       ///< 推流使用的码流。
+    bool m_substream;                  ///< 是否启用子码流。
+    RecordingCatalog *m_catalog;       ///< 录像索引 (不拥有)，nullptr 表示不登记。
+    QHash<QString, PendingFile> m_pendingFiles; ///< 尚未配对完成的录像文件，键为录制线程打开时的路径。
+
+    bool m_isRecording;                ///< 本路是否正在录制 (待命录制时表示事件正在进行)。
+    int m_preEventSeconds;             ///< 预录时长 (秒)，0 表示不预录。
+    bool m_motionDetection;            ///< 是否启用移动侦测。
+
+    std::chrono::steady_clock::time_point m_lastFrameTime; ///< 上一帧预览的时间点，用于计算FPS。
+    unsigned int m_lastFrameCount;     ///< 上一帧预览时采集线程的累计帧数。
+    double m_currentFPS;               ///< 平滑后的采集帧率。
+};
+
+#endif // CAMERACHANNEL_H
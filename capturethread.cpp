@@ -0,0 +1,432 @@
+#include "capturethread.h"
+#include "pixel_convert.h" // RGB565 / YUYV / NV12 -> RGB32 预览转换
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QBuffer>
+#include <QImageReader>
+
+#include <poll.h>   // poll
+#include <unistd.h> // pipe2, read, write, close
+#include <fcntl.h>  // O_NONBLOCK, O_CLOEXEC
+#include <errno.h>  // errno, EINTR
+#include <string.h> // strerror
+#include <linux/videodev2.h> // V4L2_PIX_FMT_*
+
+/**
+ * @file capturethread.cpp
+ * @brief 摄像头采集线程类 (CaptureThread) 的实现文件。
+ *
+ * 采集线程负责 V4L2 视频流的整个读取过程：
+ * - `startCapture()` 在调用者线程中初始化设备并开始视频流，然后启动线程。
+ * - `run()` 在 `poll()` 上等待驱动完成的帧，借出缓冲区后分发给各个 `FrameSink`，
+ *   同时为 GUI 准备预览图像，最后归还缓冲区。
+ * - `stopCapture()` 通过唤醒管道打断 `poll()`，等待线程退出后停止视频流并释放资源。
+ *
+ * 每个实例独占一个 `v4l2_ctx`，多个摄像头各自在一个采集线程中并行工作，互不阻塞。
+ */
+
+// poll() 超时时间 (毫秒)。超时仅用于打印"摄像头无输出"的警告，正常情况下帧到达即被唤醒。
+static const int CAPTURE_POLL_TIMEOUT_MS = 2000;
+
+// MJPEG 预览的最大宽度。超过时利用 JPEG 的 DCT 缩放按 1/2、1/4... 解码，
+// 1080p 摄像头的预览只需解码 960x540，录制仍使用全分辨率。
+static const int MJPEG_PREVIEW_MAX_WIDTH = 1280;
+
+CaptureThread::CaptureThread(QObject *parent)
+    : QThread(parent)
+    , m_stopRequested(0)
+    , m_ctx(nullptr)
+    , m_imagePending(false)
+    , m_rawPreview(false)
+    , m_previewIntervalUs(0)
+    , m_previewPaused(0)
+    , m_nextPreviewUs(-1)
+    , m_frameCount(0)
+{
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+    // 非阻塞管道：写端不会因积压阻塞 stopCapture()，读端可以一次性清空
+    if (pipe2(m_wakePipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+        qWarning() << "创建采集线程唤醒管道失败:" << strerror(errno);
+        m_wakePipe[0] = m_wakePipe[1] = -1;
+    }
+}
+
+CaptureThread::~CaptureThread()
+{
+    stopCapture();
+
+    if (m_wakePipe[0] >= 0) close(m_wakePipe[0]);
+    if (m_wakePipe[1] >= 0) close(m_wakePipe[1]);
+}
+
+bool CaptureThread::startCapture(const QString &device, const v4l2_params &params)
+{
+    if (isRunning() || m_ctx) {
+        qWarning() << "采集线程已在运行";
+        return false;
+    }
+    if (m_wakePipe[0] < 0) {
+        qWarning() << "采集线程唤醒管道不可用，无法启动采集";
+        return false;
+    }
+
+    // 初始化V4L2摄像头设备 (以非阻塞方式打开，每个采集线程独占一个上下文)
+    // 像素格式、分辨率和帧率在 v4l2_open() 内与驱动协商
+    v4l2_ctx *ctx = v4l2_open(device.toLocal8Bit().constData(), &params);
+    if (!ctx) {
+        qWarning() << "摄像头初始化失败 (v4l2_open):" << device;
+        return false;
+    }
+
+    // 开始V4L2视频捕获流
+    if (v4l2_ctx_start_capture(ctx) < 0) {
+        qWarning() << "启动摄像头捕获失败 (v4l2_ctx_start_capture):" << device;
+        v4l2_close(ctx);
+        return false;
+    }
+    m_ctx = ctx;
+    m_device = device;
+
+    // 清空上一次会话残留的唤醒字节和预览帧
+    char drain[16];
+    while (read(m_wakePipe[0], drain, sizeof(drain)) > 0) {
+    }
+    {
+        QMutexLocker locker(&m_imageMutex);
+        m_latestImage = QImage();
+        m_latestFrame = PreviewFrame();
+        m_imagePending = false;
+    }
+
+    m_nextPreviewUs = -1; // 线程尚未启动，可以直接重置采集线程私有的状态
+    m_frameCount.store(0);
+
+    m_stopRequested.store(0);
+    start(QThread::HighPriority); // 采集线程优先于编码线程，避免驱动缓冲区耗尽
+    qDebug() << "采集线程已启动:" << device;
+    return true;
+}
+
+void CaptureThread::stopCapture()
+{
+    if (isRunning()) {
+        m_stopRequested.store(1);
+        // 写入一个字节唤醒 poll()；管道满时写入失败也无妨，说明已有待处理的唤醒
+        const char wake = 1;
+        if (write(m_wakePipe[1], &wake, 1) < 0 && errno != EAGAIN) {
+            qWarning() << "唤醒采集线程失败:" << strerror(errno);
+        }
+        wait();
+    }
+
+    // 线程已退出 (主动停止或因错误退出)，此时可以安全地停止视频流并释放资源
+    if (m_ctx) {
+        v4l2_close(m_ctx); // 内部先停止视频流，再解除映射并关闭设备
+        m_ctx = nullptr;
+        qDebug() << "采集线程已停止，摄像头资源已释放:" << m_device;
+    }
+}
+
+void CaptureThread::addSink(FrameSink *sink)
+{
+    if (!sink) return;
+    QMutexLocker locker(&m_sinkMutex);
+    if (!m_sinks.contains(sink)) {
+        m_sinks.append(sink);
+    }
+}
+
+void CaptureThread::removeSink(FrameSink *sink)
+{
+    QMutexLocker locker(&m_sinkMutex); // 等待正在进行的分发结束
+    m_sinks.removeAll(sink);
+}
+
+QSize CaptureThread::frameSize() const
+{
+    int width = 0;
+    int height = 0;
+    if (v4l2_ctx_get_format(m_ctx, &width, &height, nullptr) < 0) {
+        return QSize();
+    }
+    return QSize(width, height);
+}
+
+unsigned int CaptureThread::pixelFormat() const
+{
+    unsigned int pixelformat = 0;
+    if (v4l2_ctx_get_format(m_ctx, nullptr, nullptr, &pixelformat) < 0) {
+        return 0;
+    }
+    return pixelformat;
+}
+
+int CaptureThread::frameRate() const
+{
+    const int fps = v4l2_ctx_get_fps(m_ctx);
+    return fps > 0 ? fps : 0;
+}
+
+bool CaptureThread::takeLatestImage(QImage &image)
+{
+    QMutexLocker locker(&m_imageMutex);
+    if (!m_imagePending || m_rawPreview) {
+        return false;
+    }
+    image = m_latestImage;
+    m_imagePending = false;
+    return true;
+}
+
+void CaptureThread::setRawPreview(bool enable)
+{
+    if (isRunning()) {
+        qWarning() << "采集期间不能切换预览模式，请在 startCapture() 之前设置";
+        return; // 采集线程运行期间只读此标志
+    }
+    m_rawPreview = enable;
+}
+
+void CaptureThread::setPreviewRate(int fps)
+{
+    if (fps < 0) {
+        qWarning() << "无效的预览帧率:" << fps;
+        return;
+    }
+    m_previewIntervalUs.storeRelease(fps > 0 ? 1000000 / fps : 0);
+}
+
+void CaptureThread::setPreviewPaused(bool paused)
+{
+    m_previewPaused.storeRelease(paused ? 1 : 0);
+}
+
+bool CaptureThread::takeLatestFrame(PreviewFrame &frame)
+{
+    QMutexLocker locker(&m_imageMutex);
+    if (!m_imagePending || !m_rawPreview) {
+        return false;
+    }
+    frame.swap(m_latestFrame); // 调用者的旧帧留在信箱中，下一次交换给采集线程复用
+    m_imagePending = false;
+    return true;
+}
+
+void CaptureThread::run()
+{
+    const int camFd = v4l2_ctx_get_fd(m_ctx);
+    if (camFd < 0) {
+        emit captureError("摄像头设备未打开");
+        return;
+    }
+
+    while (!m_stopRequested.load()) {
+        struct pollfd fds[2];
+        fds[0].fd = camFd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = m_wakePipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        int ret = poll(fds, 2, CAPTURE_POLL_TIMEOUT_MS);
+        if (ret < 0) {
+            if (errno == EINTR) continue; // 被信号打断，重新等待
+            emit captureError(QString("poll 失败: %1").arg(strerror(errno)));
+            break;
+        }
+        if (ret == 0) {
+            qWarning() << "摄像头在" << CAPTURE_POLL_TIMEOUT_MS << "ms 内没有输出帧";
+            continue;
+        }
+        if (fds[1].revents) {
+            break; // stopCapture() 请求退出
+        }
+        if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            emit captureError("摄像头设备错误或已断开");
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        // 一次唤醒可能对应多帧 (例如线程被短暂抢占)：全部取出并分发给消费者，
+        // 但只有最后一帧需要转换成预览图像
+        v4l2_frame frame;
+        v4l2_frame next;
+        if (v4l2_ctx_acquire_frame(m_ctx, &frame) != 0) {
+            continue; // 伪唤醒或 EAGAIN
+        }
+        while (true) {
+            // 预先借出下一帧，以判断当前帧是否是本轮的最后一帧
+            bool haveNext = (v4l2_ctx_acquire_frame(m_ctx, &next) == 0);
+            dispatchFrame(frame, !haveNext);
+            v4l2_ctx_release_frame(m_ctx, &frame);
+            if (!haveNext) break;
+            frame = next;
+        }
+    }
+}
+
+void CaptureThread::dispatchFrame(const v4l2_frame &frame, bool updatePreview)
+{
+    // 1. 同步交给所有消费者 (录制等)，它们需要每一帧
+    {
+        QMutexLocker locker(&m_sinkMutex);
+        for (FrameSink *sink : m_sinks) {
+            sink->consumeFrame(frame);
+        }
+    }
+
+    m_frameCount.fetchAndAddRelaxed(1);
+
+    if (!updatePreview || frame.width <= 0 || frame.height <= 0 || m_previewPaused.loadAcquire()) {
+        return;
+    }
+
+    // 2. 预览限速：未到下一个预览时刻的帧直接跳过。允许提前四分之一个间隔，吸收时间戳抖动
+    const long long intervalUs = m_previewIntervalUs.loadAcquire();
+    if (intervalUs > 0 && m_nextPreviewUs >= 0 && frame.timestamp_us + intervalUs / 4 < m_nextPreviewUs) {
+        return;
+    }
+
+    // 3. GUI 还没取走上一帧预览时跳过转换，避免在界面繁忙时做无用功
+    {
+        QMutexLocker locker(&m_imageMutex);
+        if (m_imagePending) {
+            return;
+        }
+    }
+
+    // 4. 原始预览只复制一份，转换和缩放交给 GPU；否则在采集线程中转换预览图像 (-> RGB32)，GUI 线程只需缩放显示
+    if (m_rawPreview ? !copyRawPreview(frame) : !convertPreview(frame)) {
+        return;
+    }
+    if (intervalUs > 0) {
+        // 按固定间隔推进；第一帧、暂停恢复后或 GUI 长时间没有取帧时从本帧重新计时
+        if (m_nextPreviewUs < 0 || frame.timestamp_us - m_nextPreviewUs >= intervalUs) {
+            m_nextPreviewUs = frame.timestamp_us + intervalUs;
+        } else {
+            m_nextPreviewUs += intervalUs;
+        }
+    }
+
+    // 5. 放入信箱并通知 GUI 线程 (交换而不是复制，信箱中的旧图像留作下次转换的目标)
+    {
+        QMutexLocker locker(&m_imageMutex);
+        if (m_rawPreview) {
+            m_latestFrame.swap(m_workFrame);
+        } else {
+            m_latestImage.swap(m_workImage);
+        }
+        m_imagePending = true;
+    }
+    emit frameReady();
+}
+
+bool CaptureThread::copyRawPreview(const v4l2_frame &frame)
+{
+    PreviewFrame::Format format = PreviewFrame::None;
+    const int stride = static_cast<int>(frame.bytesperline);
+    int bytes = stride * frame.height;
+    switch (frame.pixelformat) {
+    case V4L2_PIX_FMT_RGB565:
+        format = PreviewFrame::Rgb565;
+        break;
+    case V4L2_PIX_FMT_YUYV:
+        format = PreviewFrame::Yuyv;
+        break;
+    case V4L2_PIX_FMT_NV12:
+        format = PreviewFrame::Nv12;
+        bytes += stride * ((frame.height + 1) / 2); // UV 平面
+        break;
+    case V4L2_PIX_FMT_MJPEG:
+        // JPEG 无法交给着色器，仍在本线程解码；解码结果与工作帧中的旧图像交换以复用缓冲区
+        if (!convertPreview(frame)) {
+            return false;
+        }
+        m_workFrame.image.swap(m_workImage);
+        m_workFrame.format = PreviewFrame::Rgb32;
+        m_workFrame.width = m_workFrame.image.width();
+        m_workFrame.height = m_workFrame.image.height();
+        m_workFrame.stride = m_workFrame.image.bytesPerLine();
+        return true;
+    default:
+        return false; // v4l2_open() 只会协商出以上格式
+    }
+    if (frame.bytesused < static_cast<unsigned int>(bytes)) {
+        return false; // 驱动给出的数据不完整，跳过本帧预览
+    }
+
+    if (m_workFrame.data.size() != bytes) {
+        m_workFrame.data.resize(bytes); // 只在第一帧或格式变化时分配
+    }
+    memcpy(m_workFrame.data.data(), frame.data, bytes);
+    m_workFrame.format = format;
+    m_workFrame.width = frame.width;
+    m_workFrame.height = frame.height;
+    m_workFrame.stride = stride;
+    return true;
+}
+
+bool CaptureThread::convertPreview(const v4l2_frame &frame)
+{
+    const uchar *src = static_cast<const uchar *>(frame.data);
+
+    if (frame.pixelformat == V4L2_PIX_FMT_MJPEG) {
+        // 直接从驱动缓冲区解码 (fromRawData 不复制数据)；大分辨率时让解码器按比例缩小
+        QByteArray jpeg = QByteArray::fromRawData(reinterpret_cast<const char *>(src), static_cast<int>(frame.bytesused));
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "JPEG");
+        int scale = 1;
+        while (frame.width / scale > MJPEG_PREVIEW_MAX_WIDTH) {
+            scale *= 2;
+        }
+        if (scale > 1) {
+            reader.setScaledSize(QSize(frame.width / scale, frame.height / scale));
+        }
+        if (!reader.read(&m_workImage)) {
+            qWarning() << "MJPEG 预览解码失败:" << reader.errorString();
+            return false; // 损坏的帧 (USB 传输中偶发)，跳过本帧预览
+        }
+        if (m_workImage.format() != QImage::Format_RGB32) {
+            m_workImage = m_workImage.convertToFormat(QImage::Format_RGB32); // 灰度 JPEG 等
+        }
+        return true;
+    }
+
+    if (m_workImage.width() != frame.width || m_workImage.height() != frame.height
+            || m_workImage.format() != QImage::Format_RGB32) {
+        m_workImage = QImage(frame.width, frame.height, QImage::Format_RGB32);
+    }
+
+    switch (frame.pixelformat) {
+    case V4L2_PIX_FMT_RGB565:
+        for (int row = 0; row < frame.height; row++) {
+            pixconv_rgb565_to_rgb32(reinterpret_cast<const uint16_t *>(src + (size_t)row * frame.bytesperline),
+                                    reinterpret_cast<uint32_t *>(m_workImage.scanLine(row)), frame.width);
+        }
+        break;
+    case V4L2_PIX_FMT_YUYV:
+        for (int row = 0; row < frame.height; row++) {
+            pixconv_yuyv_to_rgb32(src + (size_t)row * frame.bytesperline,
+                                  reinterpret_cast<uint32_t *>(m_workImage.scanLine(row)), frame.width);
+        }
+        break;
+    case V4L2_PIX_FMT_NV12: {
+        // 单平面 NV12：UV 平面紧跟在 Y 平面之后，行跨度相同
+        const uchar *uv = src + (size_t)frame.bytesperline * frame.height;
+        for (int row = 0; row < frame.height; row++) {
+            pixconv_nv12_to_rgb32(src + (size_t)row * frame.bytesperline,
+                                  uv + (size_t)(row / 2) * frame.bytesperline,
+                                  reinterpret_cast<uint32_t *>(m_workImage.scanLine(row)), frame.width);
+        }
+        break;
+    }
+    default:
+        return false; // v4l2_open() 只会协商出以上格式
+    }
+    return true;
+}
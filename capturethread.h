@@ -0,0 +1,216 @@
+#ifndef CAPTURETHREAD_H
+#define CAPTURETHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QAtomicInt>
+#include <QSize>
+
+#include "framesink.h"
+#include "previewframe.h" // GPU 预览使用的原始帧
+
+/**
+ * @brief 摄像头采集线程类
+ *
+ * 以事件驱动的方式从 V4L2 设备采集视频帧，取代 GUI 线程上的定时器轮询：
+ * - 设备以非阻塞方式打开，线程在 `poll()` 上等待驱动完成一帧，帧率和延迟跟随摄像头本身。
+ * - 每一帧先同步交给所有已注册的 `FrameSink` (如录制线程)，保证录制不丢帧。
+ * - 预览画面在本线程转换为 RGB32 (RGB565/YUYV/NV12 逐行转换，MJPEG 缩小解码) 后放入"最新帧"信箱，并通过 `frameReady()` 通知 GUI 线程；
+ *   GUI 尚未取走上一帧时不再转换新帧，界面卡顿不会拖慢采集或堆积事件。
+ * - 启用原始预览 (`setRawPreview()`) 时 RGB565/YUYV/NV12 帧只复制一份放入信箱 (`takeLatestFrame()`)，
+ *   色彩空间转换和缩放交给 GPU (`PreviewWidget`)；MJPEG 仍在本线程解码。
+ * - 预览可以限速 (`setPreviewRate()`) 或暂停 (`setPreviewPaused()`)，多余的帧直接跳过而不是排队，
+ *   录制帧率只由消费者自己决定，与界面刷新无关。
+ * - GUI 线程不再执行任何可能阻塞的 V4L2 调用。
+ * - 每个实例打开自己的 `v4l2_ctx`，多摄像头时每个摄像头一个采集线程，分布在不同CPU核上。
+ */
+class CaptureThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param parent 父对象指针
+     */
+    explicit CaptureThread(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数
+     *
+     * 如果仍在采集，先停止采集线程并释放 V4L2 资源。
+     */
+    ~CaptureThread();
+
+    /**
+     * @brief 打开摄像头并启动采集线程。
+     * @param device 设备节点路径，例如 "/dev/video0"。
+     * @param params 期望的分辨率、像素格式和帧率 (字段为0使用默认值，像素格式为0时自动协商)。
+     * @return 设备初始化、开始采集且线程启动成功返回 true；否则返回 false (已清理资源)。
+     */
+    bool startCapture(const QString &device, const v4l2_params &params = v4l2_params());
+
+    /**
+     * @brief 停止采集线程，停止视频流并释放 V4L2 资源。
+     *
+     * 会唤醒正在 `poll()` 中等待的线程并等待其退出，返回后不会再有 `FrameSink` 回调。
+     * 未在采集时调用无副作用。
+     */
+    void stopCapture();
+
+    /**
+     * @brief 查询是否正在采集。
+     */
+    bool isCapturing() const { return isRunning(); }
+
+    /**
+     * @brief 获取当前打开的设备节点路径 (最近一次 `startCapture()` 传入的值)。
+     */
+    QString device() const { return m_device; }
+
+    /**
+     * @brief 查询驱动实际输出的帧尺寸。
+     * @return 设备已打开时返回宽高；否则返回无效的 QSize。
+     */
+    QSize frameSize() const;
+
+    /**
+     * @brief 查询与驱动协商出的像素格式。
+     * @return V4L2 FourCC (NV12 / YUYV / RGB565 / MJPEG)；设备未打开时返回0。
+     */
+    unsigned int pixelFormat() const;
+
+    /**
+     * @brief 查询驱动实际生效的标称帧率。
+     * @return 帧率 (fps)；设备未打开时返回0。
+     */
+    int frameRate() const;
+
+    /**
+     * @brief 注册一个帧消费者，之后的每一帧都会在采集线程中回调其 `consumeFrame()`。
+     * @param sink 消费者指针，调用者负责其生命周期 (销毁前需调用 `removeSink()` 或先停止采集)。
+     */
+    void addSink(FrameSink *sink);
+
+    /**
+     * @brief 注销一个帧消费者。返回后保证不会再回调该消费者。
+     * @param sink 要注销的消费者指针。
+     */
+    void removeSink(FrameSink *sink);
+
+    /**
+     * @brief 取出最新的一帧预览图像 (GUI 线程在收到 `frameReady()` 后调用)。
+     * @param image 输出参数，接收 RGB32 格式的预览图像。
+     * @return 有尚未取走的新帧返回 true；否则返回 false，image 不变。
+     */
+    bool takeLatestImage(QImage &image);
+
+    /**
+     * @brief 选择预览信箱的内容：原始帧 (`takeLatestFrame()`) 或 RGB32 图像 (`takeLatestImage()`，默认)。
+     * @param enable 为 true 时采集线程不再做 RGB32 转换，`takeLatestImage()` 不再返回图像。
+     *               只能在未采集时调用，下一次 `startCapture()` 生效。
+     */
+    void setRawPreview(bool enable);
+
+    /**
+     * @brief 取出最新的一帧原始预览 (启用原始预览时，GUI 线程在收到 `frameReady()` 后调用)。
+     * @param frame 输入输出参数：与信箱中的帧交换，调用者原来持有的帧缓冲区交还给采集线程复用。
+     * @return 有尚未取走的新帧返回 true；否则返回 false，frame 不变。
+     */
+    bool takeLatestFrame(PreviewFrame &frame);
+
+    /**
+     * @brief 设置预览帧率上限。线程安全，可以在采集期间调用，立即生效。
+     * @param fps 每秒最多更新的预览帧数；0 表示跟随采集帧率 (默认)，小于0时忽略。
+     *
+     * 按采集时间戳均匀跳过多余的帧 (不转换、不排队)，录制等消费者仍然收到每一帧。
+     */
+    void setPreviewRate(int fps);
+
+    /**
+     * @brief 暂停或恢复预览。线程安全，可以在采集期间调用。
+     * @param paused 为 true 时不再转换预览帧、不再发出 `frameReady()` (例如界面不可见)，消费者不受影响。
+     */
+    void setPreviewPaused(bool paused);
+
+    /**
+     * @brief 本次采集以来从驱动取出的帧数 (回绕计数)。线程安全，用于统计采集帧率。
+     */
+    unsigned int capturedFrames() const { return static_cast<unsigned int>(m_frameCount.load()); }
+
+signals:
+    /**
+     * @brief 有新的预览帧可以通过 `takeLatestImage()` 取出时发出 (跨线程，排队连接)。
+     */
+    void frameReady();
+
+    /**
+     * @brief 采集过程中发生不可恢复的错误 (例如设备被拔出) 时发出，线程随后退出。
+     * @param errorMsg 错误描述信息。
+     */
+    void captureError(const QString &errorMsg);
+
+protected:
+    /**
+     * @brief 采集线程主循环。
+     *
+     * 在 `poll()` 上同时等待摄像头 fd 和内部唤醒管道：
+     * - 摄像头可读时，取出驱动中所有已完成的帧，依次分发给消费者并归还缓冲区，
+     *   最后一帧用于更新预览信箱。
+     * - 唤醒管道可读时 (`stopCapture()`)，退出循环。
+     * - 等待超时说明摄像头暂时没有输出，打印警告后继续等待。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 把一帧分发给所有消费者并视情况更新预览信箱。在采集线程中调用。
+     * @param frame 借出的帧。
+     * @param updatePreview 是否需要更新预览 (一次唤醒取出多帧时只有最后一帧需要)；
+     *                      预览暂停、未到下一个预览时刻或 GUI 尚未取走上一帧时同样跳过。
+     */
+    void dispatchFrame(const v4l2_frame &frame, bool updatePreview);
+
+    /**
+     * @brief 把一帧转换为 RGB32 预览图像，结果写入 `m_workImage`。在采集线程中调用。
+     *
+     * RGB565 / YUYV / NV12 按行转换；MJPEG 用 Qt 的 JPEG 解码器解码，宽度超过
+     * `MJPEG_PREVIEW_MAX_WIDTH` 时按 2 的幂缩小解码。
+     * @return 转换成功返回 true；MJPEG 帧损坏等情况返回 false，跳过本帧预览。
+     */
+    bool convertPreview(const v4l2_frame &frame);
+
+    /**
+     * @brief 把一帧复制为原始预览帧，结果写入 `m_workFrame`。在采集线程中调用。
+     *
+     * RGB565 / YUYV / NV12 只复制驱动缓冲区 (缓冲区大小不变时不重新分配)；MJPEG 经 `convertPreview()` 解码为 RGB32。
+     * @return 成功返回 true；否则跳过本帧预览。
+     */
+    bool copyRawPreview(const v4l2_frame &frame);
+
+    int m_wakePipe[2];             ///< 唤醒管道 [读端, 写端]，用于从 `stopCapture()` 打断 `poll()`。
+    QAtomicInt m_stopRequested;    ///< 停止请求标志，由 `stopCapture()` 设置，采集线程检查。
+    v4l2_ctx *m_ctx;               ///< 本线程独占的 V4L2 采集上下文，由 `startCapture()` 打开 (为空表示未打开)。
+    QString m_device;              ///< 设备节点路径。
+
+    QMutex m_sinkMutex;            ///< 保护 `m_sinks`，分发帧期间持有，保证 `removeSink()` 返回后不再回调。
+    QList<FrameSink *> m_sinks;    ///< 已注册的帧消费者列表。
+
+    QMutex m_imageMutex;           ///< 保护预览信箱 (`m_latestImage`, `m_imagePending`)。
+    QImage m_latestImage;          ///< 最新的预览图像 (RGB32)，等待 GUI 线程取走。
+    bool m_imagePending;           ///< 信箱中是否有尚未取走的新帧。
+    QImage m_workImage;            ///< 采集线程私有的转换目标图像，与信箱交换后复用，避免每帧分配。
+    bool m_rawPreview;             ///< `setRawPreview()` 的设置，采集线程运行期间只读。
+    PreviewFrame m_latestFrame;    ///< 原始预览模式下的信箱帧，由 `m_imageMutex` 保护。
+    PreviewFrame m_workFrame;      ///< 采集线程私有的原始预览帧，与信箱交换后复用。
+
+    QAtomicInt m_previewIntervalUs; ///< 预览帧间隔 (微秒)，0 表示不限速。由 `setPreviewRate()` 设置。
+    QAtomicInt m_previewPaused;    ///< 预览是否暂停。由 `setPreviewPaused()` 设置。
+    long long m_nextPreviewUs;     ///< 下一帧预览的最早采集时间戳 (微秒)，-1 表示下一帧直接预览。只在采集线程中访问。
+    QAtomicInt m_frameCount;       ///< 本次采集以来取出的帧数，由采集线程递增。
+};
+
+#endif // CAPTURETHREAD_H
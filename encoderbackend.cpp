@@ -0,0 +1,300 @@
+/**
+ * @file encoderbackend.cpp
+ * @brief H.264 编码器后端 (EncoderBackend) 的实现文件。
+ *
+ * 依次探测硬件编码器 (V4L2 M2M、VAAPI、厂商编码器)，全部不可用时退回 libx264。
+ * 每个候选都真正调用一次 `avcodec_open2()`：编码器存在于 FFmpeg 中并不代表板子上有对应的硬件，
+ * 例如 h264_v4l2m2m 需要找到一个支持 H.264 输出的 M2M 设备节点才能打开。
+ */
+
+#include "encoderbackend.h"
+
+#include <QThread>
+#include <QDebug>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+namespace {
+
+/**
+ * @brief 已知候选编码器的属性。
+ */
+struct BackendInfo {
+    const char *name;       ///< FFmpeg 编码器名称。
+    AVHWDeviceType hwType;  ///< 需要的硬件设备类型；直接接收软件帧的编码器为 NONE。
+    bool hardware;          ///< 是否为硬件编码器 (只影响日志和线程设置)。
+};
+
+const BackendInfo kBackends[] = {
+    {"h264_v4l2m2m", AV_HWDEVICE_TYPE_NONE,  true},  // V4L2 M2M，驱动内部把软件帧复制到编码器的 OUTPUT 队列
+    {"h264_vaapi",   AV_HWDEVICE_TYPE_VAAPI, true},  // VA-API，需要先上传到 VA 表面
+    {"h264_rkmpp",   AV_HWDEVICE_TYPE_NONE,  true},  // Rockchip MPP (厂商 FFmpeg 分支)
+    {"h264_omx",     AV_HWDEVICE_TYPE_NONE,  true},  // OpenMAX IL
+    {"libx264",      AV_HWDEVICE_TYPE_NONE,  false}, // 软件编码兜底
+};
+
+/**
+ * @brief 编码器自己管理线程 (例如 libx264) 的能力标志：FFmpeg 5.0 起为 OTHER_THREADS，之前为 AUTO_THREADS。
+ *        这类编码器不报告帧级/片级并行，但同样按 `thread_count` 创建线程。
+ */
+#if defined(AV_CODEC_CAP_OTHER_THREADS)
+const int kOwnThreadsCap = AV_CODEC_CAP_OTHER_THREADS;
+#elif defined(AV_CODEC_CAP_AUTO_THREADS)
+const int kOwnThreadsCap = AV_CODEC_CAP_AUTO_THREADS;
+#else
+const int kOwnThreadsCap = 0;
+#endif
+
+const BackendInfo *findBackendInfo(const QString &name)
+{
+    for (const BackendInfo &info : kBackends) {
+        if (name == QLatin1String(info.name)) {
+            return &info;
+        }
+    }
+    return nullptr; // 未知名称按直接接收软件帧的编码器处理
+}
+
+QString ffmpegError(int err)
+{
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(err, errbuf, sizeof(errbuf));
+    return QString::fromLocal8Bit(errbuf);
+}
+
+} // namespace
+
+EncoderBackend::EncoderBackend()
+    : m_preference(defaultPreference())
+    , m_codecContext(nullptr)
+    , m_codec(nullptr)
+    , m_hwDeviceContext(nullptr)
+    , m_hwFramesContext(nullptr)
+    , m_hwFrame(nullptr)
+    , m_hardware(false)
+    , m_threads(0)
+{
+}
+
+EncoderBackend::~EncoderBackend()
+{
+    close();
+}
+
+QStringList EncoderBackend::defaultPreference()
+{
+    QStringList names;
+    for (const BackendInfo &info : kBackends) {
+        names << QLatin1String(info.name);
+    }
+    return names;
+}
+
+void EncoderBackend::setPreference(const QStringList &names)
+{
+    m_preference = names.isEmpty() ? defaultPreference() : names;
+}
+
+bool EncoderBackend::open(const Settings &settings, QString *errorMsg)
+{
+    close();
+
+    for (const QString &name : m_preference) {
+        const AVCodec *codec = avcodec_find_encoder_by_name(name.toLatin1().constData());
+        if (!codec) {
+            continue; // 当前 FFmpeg 未编译该编码器
+        }
+        if (tryOpen(name, codec, settings)) {
+            return true;
+        }
+    }
+
+    // 候选名称全部不可用 (例如 FFmpeg 只带了 openh264)：退回 FFmpeg 默认的 H.264 编码器
+    const AVCodec *fallback = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (fallback && !m_preference.contains(QLatin1String(fallback->name))
+            && tryOpen(QLatin1String(fallback->name), fallback, settings)) {
+        return true;
+    }
+
+    if (errorMsg) {
+        *errorMsg = QString("无法打开任何 H.264 编码器 (已尝试: %1)").arg(m_preference.join(", "));
+    }
+    return false;
+}
+
+bool EncoderBackend::tryOpen(const QString &name, const AVCodec *codec, const Settings &settings)
+{
+    const BackendInfo *info = findBackendInfo(name);
+    const AVHWDeviceType hwType = info ? info->hwType : AV_HWDEVICE_TYPE_NONE;
+    const bool hardware = info ? info->hardware : false;
+
+    // 直接接收软件帧的编码器必须支持 YUV420P (编码输入统一为 YUV420P)
+    if (hwType == AV_HWDEVICE_TYPE_NONE && codec->pix_fmts) {
+        bool supported = false;
+        for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+            supported = supported || (*p == AV_PIX_FMT_YUV420P);
+        }
+        if (!supported) {
+            qDebug() << "EncoderBackend:" << name << "不接受 YUV420P 输入，跳过";
+            return false;
+        }
+    }
+
+    m_codecContext = avcodec_alloc_context3(codec);
+    if (!m_codecContext) {
+        return false;
+    }
+    m_codecContext->width = settings.width;
+    m_codecContext->height = settings.height;
+    m_codecContext->time_base = settings.timeBase;
+    m_codecContext->framerate = settings.frameRate;
+    m_codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+    m_codecContext->bit_rate = settings.bitRate; // 目标比特率，影响视频质量和文件大小
+    if (settings.gopSize > 0) {
+        m_codecContext->gop_size = settings.gopSize; // 流式封装按刷新周期要求关键帧间隔
+    }
+    // 必须在 avcodec_open2() 之前设置，编码器才会把 SPS/PPS 放进 extradata 供封装器写入
+    if (settings.globalHeader) {
+        m_codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (hwType != AV_HWDEVICE_TYPE_NONE) {
+        if (!initHardwareFrames(hwType, settings)) {
+            qDebug() << "EncoderBackend:" << name << "硬件设备不可用，跳过";
+            close();
+            return false;
+        }
+        m_codecContext->pix_fmt = AV_PIX_FMT_VAAPI;
+        m_codecContext->hw_frames_ctx = av_buffer_ref(m_hwFramesContext);
+    }
+
+    AVDictionary *codec_opts = nullptr;
+    int requestedThreads = 0;
+    if (!hardware) {
+        // 软件编码：线程数默认跟随 CPU 核数，不再固定为4 (单核板子上多线程只会增加调度开销)
+        const int threads = settings.threads > 0 ? settings.threads : qMax(1, QThread::idealThreadCount());
+        if (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS) {
+            m_codecContext->thread_count = threads;
+            m_codecContext->thread_type = FF_THREAD_FRAME; // 帧级并行
+        } else if (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
+            m_codecContext->thread_count = threads;
+            m_codecContext->thread_type = FF_THREAD_SLICE; // 片级并行
+        } else if ((codec->capabilities & kOwnThreadsCap) || name == "libx264") {
+            // libx264 自己创建线程 (i_threads 取自 thread_count)，thread_type 保持默认，由它选择帧级并行
+            m_codecContext->thread_count = threads;
+        } else {
+            m_codecContext->thread_count = 1; // 编码器不支持多线程
+        }
+        requestedThreads = m_codecContext->thread_count;
+        // 默认最快的编码速度；基准测试可以比较其它预设的画质/CPU 代价
+        const QByteArray preset = settings.preset.isEmpty() ? QByteArray("ultrafast") : settings.preset.toLatin1();
+        av_dict_set(&codec_opts, "preset", preset.constData(), 0);
+        av_dict_set(&codec_opts, "tune", "zerolatency", 0);  // 低延迟，禁用B帧等
+        av_dict_set(&codec_opts, "forced-idr", "1", 0);      // 强制关键帧 (自动分段) 编码为IDR帧，新文件可独立解码
+    } else {
+        m_codecContext->max_b_frames = 0; // 硬件编码器同样不使用B帧，保持低延迟
+    }
+
+    int ret = avcodec_open2(m_codecContext, codec, &codec_opts);
+    av_dict_free(&codec_opts);
+    if (ret < 0) {
+        qDebug() << "EncoderBackend: 无法打开" << name << ":" << ffmpegError(ret);
+        close();
+        return false;
+    }
+
+    m_codec = codec;
+    m_name = name;
+    m_hardware = hardware;
+    m_threads = requestedThreads;
+    qDebug() << "EncoderBackend: 使用编码器" << m_name << (m_hardware ? "(硬件)" : "(软件)")
+             << "线程数:" << m_codecContext->thread_count;
+    return true;
+}
+
+bool EncoderBackend::initHardwareFrames(AVHWDeviceType type, const Settings &settings)
+{
+    // 打开默认设备 (VAAPI 为 /dev/dri/renderD128)
+    if (av_hwdevice_ctx_create(&m_hwDeviceContext, type, nullptr, nullptr, 0) < 0) {
+        return false;
+    }
+
+    m_hwFramesContext = av_hwframe_ctx_alloc(m_hwDeviceContext);
+    if (!m_hwFramesContext) {
+        return false;
+    }
+    AVHWFramesContext *frames = reinterpret_cast<AVHWFramesContext *>(m_hwFramesContext->data);
+    frames->format = AV_PIX_FMT_VAAPI;
+    frames->sw_format = AV_PIX_FMT_NV12; // 编码表面格式；上传时由驱动从 YUV420P 转换
+    frames->width = settings.width;
+    frames->height = settings.height;
+    frames->initial_pool_size = 8;
+    if (av_hwframe_ctx_init(m_hwFramesContext) < 0) {
+        return false;
+    }
+
+    m_hwFrame = av_frame_alloc();
+    return m_hwFrame != nullptr;
+}
+
+void EncoderBackend::close()
+{
+    if (m_codecContext) {
+        avcodec_free_context(&m_codecContext); // 同时释放其持有的 hw_frames_ctx 引用
+    }
+    if (m_hwFrame) {
+        av_frame_free(&m_hwFrame);
+    }
+    if (m_hwFramesContext) {
+        av_buffer_unref(&m_hwFramesContext);
+    }
+    if (m_hwDeviceContext) {
+        av_buffer_unref(&m_hwDeviceContext);
+    }
+    m_codec = nullptr;
+    m_name.clear();
+    m_hardware = false;
+    m_threads = 0;
+}
+
+bool EncoderBackend::setBitRate(int64_t bitRate)
+{
+    if (!m_codecContext || m_name != QLatin1String("libx264") || bitRate <= 0) {
+        return false;
+    }
+    m_codecContext->bit_rate = bitRate;
+    return true;
+}
+
+int EncoderBackend::sendFrame(const AVFrame *frame)
+{
+    if (!m_codecContext) {
+        return AVERROR(EINVAL);
+    }
+    if (!frame || !m_hwFramesContext) {
+        return avcodec_send_frame(m_codecContext, frame);
+    }
+
+    // VAAPI：从帧池取一个表面，上传软件帧
+    av_frame_unref(m_hwFrame);
+    int ret = av_hwframe_get_buffer(m_hwFramesContext, m_hwFrame, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = av_hwframe_transfer_data(m_hwFrame, frame, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    av_frame_copy_props(m_hwFrame, frame); // pts 等时间信息
+    return avcodec_send_frame(m_codecContext, m_hwFrame);
+}
+
+int EncoderBackend::receivePacket(AVPacket *packet)
+{
+    if (!m_codecContext) {
+        return AVERROR(EINVAL);
+    }
+    return avcodec_receive_packet(m_codecContext, packet);
+}
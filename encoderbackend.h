@@ -0,0 +1,144 @@
+#ifndef ENCODERBACKEND_H
+#define ENCODERBACKEND_H
+
+#include <QString>
+#include <QStringList>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+}
+
+/**
+ * @brief H.264 编码器后端 (EncoderBackend)
+ *
+ * 按优先级依次尝试打开可用的 H.264 编码器，第一个成功打开的即为本次录制使用的后端：
+ * - `h264_v4l2m2m`：V4L2 Memory-to-Memory 硬件编码器 (Hantro / Coda / Venus 等 SoC 编码单元)。
+ * - `h264_vaapi`：VA-API 硬件编码器 (x86 调试机上的核显)，帧先上传到 VA 表面再编码。
+ * - `h264_rkmpp` / `h264_omx`：厂商编码器 (Rockchip MPP、OpenMAX IL)，FFmpeg 编译时启用才存在。
+ * - `libx264`：软件编码器，作为兜底，保留原来的 ultrafast / zerolatency 参数。
+ *
+ * 无论选中哪个后端，调用者始终向 `sendFrame()` 送入软件 YUV420P 帧；
+ * 需要硬件表面的后端 (VAAPI) 在内部完成上传。打开失败 (设备节点不存在、驱动不支持该分辨率等)
+ * 时自动退回下一个候选，因此同一份程序可以在有无硬件编码单元的板子上运行。
+ */
+class EncoderBackend
+{
+public:
+    /**
+     * @brief 编码参数，所有后端共用。
+     */
+    struct Settings {
+        int width = 0;                   ///< 图像宽度 (像素)。
+        int height = 0;                  ///< 图像高度 (像素)。
+        AVRational timeBase = {1, 90000}; ///< 编码器时间基 (帧的 pts 按采集时间戳换算，可变帧率)。
+        AVRational frameRate = {30, 1};   ///< 标称帧率，供码率控制参考。
+        int64_t bitRate = 800000;        ///< 目标比特率 (bps)。
+        int gopSize = 0;                 ///< 关键帧间隔 (帧)，0 表示使用编码器默认值。
+        bool globalHeader = false;       ///< 封装格式需要全局头 (MP4 的 SPS/PPS 放在 extradata) 时为 true。
+        int threads = 0;                 ///< 软件编码器的线程数，0 表示跟随 CPU 核数。
+        QString preset;                  ///< 软件编码器 (libx264) 的预设，为空时使用 "ultrafast"。
+    };
+
+    EncoderBackend();
+
+    /**
+     * @brief 析构函数，释放编码器和硬件设备上下文。
+     */
+    ~EncoderBackend();
+
+    /**
+     * @brief 默认的候选编码器顺序：硬件编码器优先，libx264 兜底。
+     */
+    static QStringList defaultPreference();
+
+    /**
+     * @brief 设置候选编码器顺序 (FFmpeg 编码器名称)，下一次 `open()` 生效。
+     * @param names 编码器名称列表，例如 {"h264_v4l2m2m", "libx264"}。为空时恢复默认顺序。
+     */
+    void setPreference(const QStringList &names);
+
+    /**
+     * @brief 按候选顺序打开第一个可用的编码器。
+     * @param settings 编码参数。
+     * @param errorMsg 全部失败时输出错误描述，可为 nullptr。
+     * @return 成功返回 true；所有候选 (包括 FFmpeg 默认的 H.264 编码器) 都无法打开时返回 false。
+     */
+    bool open(const Settings &settings, QString *errorMsg = nullptr);
+
+    /**
+     * @brief 释放编码器上下文和硬件资源。可重复调用。
+     */
+    void close();
+
+    /**
+     * @brief 已打开的编码器上下文 (未打开时为 nullptr)，由本对象拥有。
+     */
+    AVCodecContext *context() const { return m_codecContext; }
+
+    /**
+     * @brief 已打开的编码器，用于创建输出流。
+     */
+    const AVCodec *codec() const { return m_codec; }
+
+    /**
+     * @brief 实际使用的编码器名称 (例如 "h264_v4l2m2m")，用于日志。
+     */
+    QString name() const { return m_name; }
+
+    /**
+     * @brief 当前后端是否为硬件编码器。
+     */
+    bool isHardware() const { return m_hardware; }
+
+    /**
+     * @brief 打开软件编码器时请求的线程数 (设置到 `thread_count` 的值，不支持多线程的编码器为1)，硬件编码器为0。
+     *        编码器打开后线程数不能修改，自适应控制据此决定下一次打开时的线程数。
+     */
+    int threadCount() const { return m_threads; }
+
+    /**
+     * @brief 修改已打开编码器的目标码率，从下一次 `sendFrame()` 开始生效。
+     *
+     * 只有 libx264 (ABR 码率控制) 在 FFmpeg 中支持运行中修改码率 (编码器在下一帧调用 `x264_encoder_reconfig()`)；
+     * 硬件编码器的码率在打开时固定。
+     * @return 编码器支持并已修改时返回 true。
+     */
+    bool setBitRate(int64_t bitRate);
+
+    /**
+     * @brief 送入一帧待编码的 YUV420P 图像，语义同 `avcodec_send_frame()`。
+     * @param frame 软件帧；VAAPI 后端会先上传到硬件表面 (复制时间戳等属性)。传入 nullptr 表示刷新编码器。
+     * @return FFmpeg 错误码，0 表示成功。
+     */
+    int sendFrame(const AVFrame *frame);
+
+    /**
+     * @brief 取出一个编码后的数据包，语义同 `avcodec_receive_packet()`。
+     */
+    int receivePacket(AVPacket *packet);
+
+private:
+    /**
+     * @brief 尝试打开一个指定名称的编码器。
+     * @return 成功返回 true，失败时已释放本次尝试分配的全部资源。
+     */
+    bool tryOpen(const QString &name, const AVCodec *codec, const Settings &settings);
+
+    /**
+     * @brief 为 VAAPI 后端创建硬件设备和帧池 (表面格式 NV12，由 YUV420P 上传)。
+     */
+    bool initHardwareFrames(AVHWDeviceType type, const Settings &settings);
+
+    QStringList m_preference;         ///< 候选编码器名称，按优先级排列。
+    AVCodecContext *m_codecContext;   ///< 已打开的编码器上下文。
+    const AVCodec *m_codec;           ///< 已打开的编码器。
+    AVBufferRef *m_hwDeviceContext;   ///< 硬件设备上下文 (仅 VAAPI)。
+    AVBufferRef *m_hwFramesContext;   ///< 硬件帧池 (仅 VAAPI)。
+    AVFrame *m_hwFrame;               ///< 上传目标硬件帧 (仅 VAAPI)。
+    QString m_name;                   ///< 实际使用的编码器名称。
+    bool m_hardware;                  ///< 是否为硬件编码器。
+    int m_threads;                    ///< 请求的软件编码线程数，硬件编码器为0。
+};
+
+#endif // ENCODERBACKEND_H
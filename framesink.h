@@ -0,0 +1,26 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include "v4l2_wrapper.h" // v4l2_frame
+
+/**
+ * @brief 帧消费者接口
+ *
+ * 由采集线程 (CaptureThread) 在每一帧到达时同步调用。实现者（如 RecordingThread）
+ * 通过此接口直接拿到驱动借出的原始缓冲区：
+ * - `consumeFrame()` 在采集线程中执行，必须尽快返回，不能阻塞等待其它线程。
+ * - `frame.data` 仅在调用期间有效，返回后缓冲区会被立即归还驱动；需要保留数据时自行复制。
+ */
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    /**
+     * @brief 处理一帧原始图像。
+     * @param frame 借出的帧信息 (数据指针、尺寸、行跨度、序号、时间戳等)。
+     */
+    virtual void consumeFrame(const v4l2_frame &frame) = 0;
+};
+
+#endif // FRAMESINK_H
@@ -0,0 +1,129 @@
+/**
+ * @file headlessrecorder.cpp
+ * @brief 无界面录制模式 (HeadlessRecorder) 的实现文件。
+ */
+
+#include "headlessrecorder.h"
+#include "monitorservice.h"  // 常驻的采集和录制流水线
+#include "camerachannel.h"   // isCapturing
+
+#include <QCoreApplication>
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int HeadlessRecorder::s_signalFds[2] = { -1, -1 };
+
+HeadlessRecorder::HeadlessRecorder(const MonitorConfig &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_service(new MonitorService(config, this))
+    , m_retryTimer(new QTimer(this))
+    , m_signalNotifier(nullptr)
+{
+    connect(m_retryTimer, &QTimer::timeout, this, &HeadlessRecorder::recover);
+
+    // 没有界面提示，状态变化只写日志
+    connect(m_service, &MonitorService::recordingStarted, this, [](int channelCount) {
+        qInfo() << "无界面模式: 连续录制已开始，摄像头数量:" << channelCount;
+    });
+    connect(m_service, &MonitorService::recordingStopped, this, [](const QStringList &savedFiles) {
+        qInfo() << "无界面模式: 连续录制已结束，录像:" << savedFiles;
+    });
+    connect(m_service, &MonitorService::lowStorageSpace, this,
+            [](qint64 availableBytes, qint64 totalBytes, double percent) {
+        qWarning() << "无界面模式: 存储空间不足" << availableBytes << "/" << totalBytes
+                   << "字节 (" << percent << "%)，已请求淘汰旧录像";
+    });
+}
+
+/**
+ * @brief 析构函数：先恢复默认的信号处理，再由监控服务 (子对象) 结束录制并停止采集。
+ */
+HeadlessRecorder::~HeadlessRecorder()
+{
+    if (m_signalNotifier) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        ::close(s_signalFds[0]);
+        ::close(s_signalFds[1]);
+        s_signalFds[0] = s_signalFds[1] = -1;
+    }
+}
+
+void HeadlessRecorder::start()
+{
+    // SIGINT / SIGTERM -> socketpair -> 事件循环中退出；安装失败时进程仍可被信号直接终止 (录像文件不收尾)
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_signalFds) == 0) {
+        m_signalNotifier = new QSocketNotifier(s_signalFds[1], QSocketNotifier::Read, this);
+        connect(m_signalNotifier, &QSocketNotifier::activated, this, &HeadlessRecorder::handleSignal);
+
+        struct sigaction action = {};
+        action.sa_handler = &HeadlessRecorder::signalHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+    } else {
+        qWarning() << "无界面模式: 创建信号通知管道失败，退出时录像文件可能无法正常收尾";
+    }
+
+    if (!m_service->startCapture()) {
+        qWarning() << "无界面模式: 没有可用的摄像头，每" << m_config.retryIntervalMs << "ms 重试";
+    } else if (m_config.recordOnStart) {
+        QString errorMsg;
+        if (!m_service->startRecording(&errorMsg)) {
+            qWarning() << "无界面模式: 无法开始录制:" << errorMsg;
+        }
+    }
+    m_retryTimer->start(m_config.retryIntervalMs);
+}
+
+/**
+ * @brief 周期恢复：打开不可用的摄像头，恢复被错误中断的连续录制。
+ *
+ * 连续录制进行中才打开的摄像头不会加入当前录制 (避免截断其它通道的文件)，
+ * 在下一次开始录制时加入；在此之前它只做移动录制。
+ */
+void HeadlessRecorder::recover()
+{
+    bool allCapturing = true;
+    for (CameraChannel *channel : m_service->channels()) {
+        if (!channel->isCapturing()) {
+            allCapturing = false;
+            break;
+        }
+    }
+    if (!allCapturing && !m_service->startCapture()) {
+        return; // 仍然没有可用的摄像头
+    }
+    if (m_config.recordOnStart && !m_service->isRecording()) {
+        QString errorMsg;
+        if (!m_service->startRecording(&errorMsg)) {
+            qWarning() << "无界面模式: 无法恢复录制:" << errorMsg;
+        }
+    }
+}
+
+void HeadlessRecorder::handleSignal()
+{
+    m_signalNotifier->setEnabled(false);
+    char signum = 0;
+    if (::read(s_signalFds[1], &signum, sizeof(signum)) != sizeof(signum)) {
+        signum = 0;
+    }
+    qInfo() << "无界面模式: 收到信号" << int(signum) << "，结束录制并退出";
+    m_retryTimer->stop();
+    QCoreApplication::quit();
+}
+
+void HeadlessRecorder::signalHandler(int signum)
+{
+    const char byte = char(signum);
+    ssize_t ret = ::write(s_signalFds[0], &byte, sizeof(byte));
+    (void)ret;
+}
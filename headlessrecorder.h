@@ -0,0 +1,74 @@
+#ifndef HEADLESSRECORDER_H
+#define HEADLESSRECORDER_H
+
+#include <QObject>
+
+#include "monitorconfig.h" // 流水线配置
+
+class MonitorService;  // 常驻的采集和录制流水线
+class QTimer;
+class QSocketNotifier;
+
+/**
+ * @brief 无界面录制模式 (HeadlessRecorder)
+ *
+ * 在 `QCoreApplication` 下运行采集、录制、存储淘汰和计量汇报，不创建任何界面对象：
+ * - 不加载样式表、`QMediaPlayer` 和各个页面，各路预览始终暂停，采集线程不做任何预览转换。
+ * - `start()` 立即打开摄像头；`MonitorConfig::recordOnStart` 为 true 时随即开始连续录制，否则只做移动录制。
+ * - 每 `MonitorConfig::retryIntervalMs` 重新打开不可用的摄像头 (例如稍后才插入)，
+ *   采集或录制出错中断的连续录制也在这里恢复。
+ * - 收到 SIGINT / SIGTERM 时退出事件循环；对象随后销毁，录像文件正常收尾并按时间段重命名。
+ *
+ * 信号处理函数只向 socketpair 写一个字节，由 `QSocketNotifier` 在事件循环中处理 (Qt 文档推荐的做法)。
+ * 进程内只能有一个实例。
+ */
+class HeadlessRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数：创建监控服务 (不打开摄像头)。
+     * @param config 采集、录制、存储和无界面模式的参数。
+     * @param parent 父对象指针
+     */
+    explicit HeadlessRecorder(const MonitorConfig &config, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数：恢复默认的信号处理，结束录制并停止采集 (由监控服务完成)。
+     */
+    ~HeadlessRecorder();
+
+    /**
+     * @brief 安装信号处理，打开摄像头并按配置开始录制，启动重试定时器。
+     *
+     * 摄像头暂时全部不可用时不视为失败，重试定时器会继续尝试。
+     */
+    void start();
+
+private slots:
+    /**
+     * @brief 打开尚未在采集的摄像头；需要连续录制但当前未在录制时重新开始录制。
+     */
+    void recover();
+
+    /**
+     * @brief 从 socketpair 读出收到的信号，退出事件循环。
+     */
+    void handleSignal();
+
+private:
+    /**
+     * @brief SIGINT / SIGTERM 的处理函数，只调用异步信号安全的 `write()`。
+     */
+    static void signalHandler(int signum);
+
+    static int s_signalFds[2]; ///< 信号处理函数写入 [0]，`m_signalNotifier` 监听 [1]。
+
+    MonitorConfig m_config;            ///< 无界面模式的参数 (连续录制、重试周期)。
+    MonitorService *m_service;         ///< 采集和录制流水线。
+    QTimer *m_retryTimer;              ///< 周期调用 `recover()`。
+    QSocketNotifier *m_signalNotifier; ///< 监听信号处理函数写入的字节。
+};
+
+#endif // HEADLESSRECORDER_H
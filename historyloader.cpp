@@ -0,0 +1,257 @@
+/**
+ * @file historyloader.cpp
+ * @brief 历史浏览后台加载线程 (HistoryLoader) 的实现文件。
+ *
+ * 目录扫描使用 `QDirIterator` (只读取目录项，不排序，不对每一项调用 stat 之外的操作)，
+ * 排序由模型在插入时完成；缩略图用 `QImageReader::setScaledSize()` 解码，JPEG 可以直接按缩小后的尺寸解码。
+ */
+
+#include "historyloader.h"
+#include "camerachannel.h" // CameraChannel::thumbnailPath()
+
+#include <QMutexLocker>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QDebug>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+HistoryLoader::HistoryLoader(QObject *parent)
+    : QThread(parent)
+    , m_stopRequested(false)
+    , m_hasScan(false)
+    , m_scanGeneration(0)
+    , m_thumbnailSize(96, 72)
+    , m_activeGeneration(-1)
+{
+}
+
+HistoryLoader::~HistoryLoader()
+{
+    stopLoader();
+}
+
+void HistoryLoader::startLoader()
+{
+    if (isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = false;
+    }
+    start(QThread::LowPriority);
+}
+
+void HistoryLoader::stopLoader()
+{
+    if (!isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_condition.wakeOne();
+    }
+    m_activeGeneration.storeRelease(-1); // 中止正在进行的扫描
+    wait();
+}
+
+void HistoryLoader::setThumbnailSize(const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_thumbnailSize = size;
+}
+
+void HistoryLoader::scanDirectory(int generation, const QString &dirPath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_scanGeneration = generation;
+    m_scanPath = dirPath;
+    m_hasScan = true;
+    m_activeGeneration.storeRelease(generation);
+    m_condition.wakeOne();
+}
+
+void HistoryLoader::cancelScan()
+{
+    QMutexLocker locker(&m_mutex);
+    m_hasScan = false;
+    m_activeGeneration.storeRelease(-1);
+}
+
+void HistoryLoader::requestThumbnail(const QString &videoPath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_thumbnailRequests.removeOne(videoPath);
+    m_thumbnailRequests.append(videoPath);
+    while (m_thumbnailRequests.size() > MAX_PENDING_THUMBNAILS) {
+        m_thumbnailRequests.removeFirst(); // 早已滚出可见区域的行
+    }
+    m_condition.wakeOne();
+}
+
+void HistoryLoader::clearThumbnailRequests()
+{
+    QMutexLocker locker(&m_mutex);
+    m_thumbnailRequests.clear();
+}
+
+void HistoryLoader::run()
+{
+    forever {
+        bool hasScan = false;
+        int generation = 0;
+        QString path;
+        QSize size;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stopRequested && !m_hasScan && m_thumbnailRequests.isEmpty()) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_stopRequested) {
+                break;
+            }
+            if (m_hasScan) {
+                hasScan = true;
+                generation = m_scanGeneration;
+                path = m_scanPath;
+                m_hasScan = false;
+            } else {
+                path = m_thumbnailRequests.takeLast(); // 后进先出：最近请求的行最可能仍然可见
+                size = m_thumbnailSize;
+            }
+        }
+
+        if (hasScan) {
+            scan(generation, path);
+            continue;
+        }
+        const QImage image = loadThumbnail(path, size);
+        if (image.isNull()) {
+            emit thumbnailFailed(path);
+        } else {
+            emit thumbnailReady(path, image);
+        }
+    }
+}
+
+void HistoryLoader::scan(int generation, const QString &dirPath)
+{
+    QStringList dirs;
+    QStringList files;
+    // 不含隐藏的缩略图目录 (.thumbs)
+    QDirIterator it(dirPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            dirs.append(info.fileName());
+        } else {
+            files.append(info.fileName());
+        }
+        if (dirs.size() + files.size() >= SCAN_BATCH) {
+            if (m_activeGeneration.loadAcquire() != generation) {
+                return; // 已切换到别的目录
+            }
+            emit directoryBatch(generation, dirs, files, false);
+            dirs.clear();
+            files.clear();
+        }
+    }
+    if (m_activeGeneration.loadAcquire() == generation) {
+        emit directoryBatch(generation, dirs, files, true);
+    }
+}
+
+QImage HistoryLoader::loadThumbnail(const QString &videoPath, const QSize &size)
+{
+    const QString thumbPath = CameraChannel::thumbnailPath(videoPath);
+    QImageReader reader(thumbPath);
+    if (reader.canRead()) {
+        const QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            reader.setScaledSize(imageSize.scaled(size, Qt::KeepAspectRatio)); // JPEG 按缩小后的尺寸解码
+        }
+        const QImage image = reader.read();
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+
+    // 没有缩略图 (未启用子码流时录制，或升级前的录像)：从第一个关键帧生成一次，之后直接读取
+    const QImage image = decodeKeyFrame(videoPath, size);
+    if (image.isNull()) {
+        return QImage();
+    }
+    QDir().mkpath(QFileInfo(thumbPath).absolutePath());
+    if (!image.save(thumbPath, "JPG", THUMBNAIL_QUALITY)) {
+        qWarning() << "HistoryLoader: 无法写入缩略图:" << thumbPath;
+    }
+    return image;
+}
+
+QImage HistoryLoader::decodeKeyFrame(const QString &videoPath, const QSize &size)
+{
+    AVFormatContext *formatContext = nullptr;
+    if (avformat_open_input(&formatContext, videoPath.toLocal8Bit().constData(), nullptr, nullptr) < 0) {
+        return QImage();
+    }
+    QImage result;
+    AVCodecContext *decoder = nullptr;
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    // 录像文件自带完整的流参数 (MP4 的 avcC / TS 的 SPS)，不需要 avformat_find_stream_info() 预读
+    const int streamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    const AVCodec *codec = streamIndex >= 0
+            ? avcodec_find_decoder(formatContext->streams[streamIndex]->codecpar->codec_id) : nullptr;
+    if (codec && packet && frame) {
+        decoder = avcodec_alloc_context3(codec);
+    }
+    if (decoder && avcodec_parameters_to_context(decoder, formatContext->streams[streamIndex]->codecpar) >= 0) {
+        decoder->thread_count = 1; // 只解码一帧，不需要帧级线程带来的延迟
+        if (avcodec_open2(decoder, codec, nullptr) >= 0) {
+            bool started = false;
+            bool gotFrame = false;
+            for (int i = 0; i < MAX_DECODE_PACKETS && !gotFrame; ++i) {
+                if (av_read_frame(formatContext, packet) < 0) {
+                    avcodec_send_packet(decoder, nullptr); // 文件结束：取出解码器中缓存的帧
+                    gotFrame = avcodec_receive_frame(decoder, frame) >= 0;
+                    break;
+                }
+                if (packet->stream_index == streamIndex && (started || (packet->flags & AV_PKT_FLAG_KEY))) {
+                    started = true;
+                    if (avcodec_send_packet(decoder, packet) >= 0) {
+                        gotFrame = avcodec_receive_frame(decoder, frame) >= 0;
+                    }
+                }
+                av_packet_unref(packet);
+            }
+            if (gotFrame && frame->width > 0 && frame->height > 0) {
+                const QSize target = QSize(frame->width, frame->height).scaled(size, Qt::KeepAspectRatio);
+                SwsContext *sws = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                                 target.width(), target.height(), AV_PIX_FMT_RGB32,
+                                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+                if (sws) {
+                    QImage image(target, QImage::Format_RGB32);
+                    uint8_t *dst[1] = {image.bits()};
+                    int dstStrides[1] = {image.bytesPerLine()};
+                    sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, dstStrides);
+                    sws_freeContext(sws);
+                    result.swap(image);
+                }
+            }
+        }
+    }
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&decoder);
+    avformat_close_input(&formatContext);
+    return result;
+}
@@ -0,0 +1,136 @@
+#ifndef HISTORYLOADER_H
+#define HISTORYLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QImage>
+#include <QSize>
+
+/**
+ * @brief 历史浏览的后台加载线程 (HistoryLoader)
+ *
+ * 由 `RecordingListModel` 拥有，把历史浏览中所有访问TF卡的操作移出GUI线程：
+ * - `scanDirectory()`：不在录像索引中的目录用 `QDirIterator` 逐项扫描，每 SCAN_BATCH 项发出一次
+ *   `directoryBatch()`，列表边扫描边显示。新的扫描请求会中止正在进行的扫描 (按 generation 区分)。
+ * - `requestThumbnail()`：读取录像的缩略图 (`CameraChannel::thumbnailPath()` 隐藏目录中的 JPEG，按显示尺寸解码)；
+ *   没有缩略图时 (未启用子码流时录制的文件) 解码录像的第一个关键帧生成一次并保存，之后直接读取。
+ *   请求按后进先出处理并且最多保留 MAX_PENDING_THUMBNAILS 个，快速滚动时优先加载当前可见的行。
+ * 扫描优先于缩略图。所有方法都是线程安全的。
+ */
+class HistoryLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryLoader(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止线程。
+     */
+    ~HistoryLoader();
+
+    /**
+     * @brief 启动加载线程 (低优先级)。已启动时无副作用。
+     */
+    void startLoader();
+
+    /**
+     * @brief 停止加载线程，正在解码的缩略图完成后返回。
+     */
+    void stopLoader();
+
+    /**
+     * @brief 设置缩略图的最大尺寸 (保持宽高比缩小到不超过它)，之后的请求生效。
+     */
+    void setThumbnailSize(const QSize &size);
+
+    /**
+     * @brief 开始扫描一个目录，中止正在进行的扫描。
+     * @param generation 调用者的列表编号，随 `directoryBatch()` 返回，用于丢弃过期的结果。
+     * @param dirPath 目录的绝对路径。
+     */
+    void scanDirectory(int generation, const QString &dirPath);
+
+    /**
+     * @brief 中止正在进行或尚未开始的扫描。
+     */
+    void cancelScan();
+
+    /**
+     * @brief 请求一个录像文件的缩略图，结果通过 `thumbnailReady()` 或 `thumbnailFailed()` 返回。
+     * @param videoPath 录像文件的绝对路径。已在队列中时移到队首。
+     */
+    void requestThumbnail(const QString &videoPath);
+
+    /**
+     * @brief 丢弃尚未处理的缩略图请求 (切换目录时调用)。
+     */
+    void clearThumbnailRequests();
+
+signals:
+    /**
+     * @brief 扫描到一批目录项 (在加载线程中发出)。
+     * @param generation `scanDirectory()` 的编号。
+     * @param dirs 子目录名，未排序。
+     * @param files 文件名，未排序。
+     * @param finished 是否为这个目录的最后一批。
+     */
+    void directoryBatch(int generation, const QStringList &dirs, const QStringList &files, bool finished);
+
+    /**
+     * @brief 缩略图已加载 (在加载线程中发出)。
+     * @param videoPath 录像文件的绝对路径。
+     * @param image 缩小到 `setThumbnailSize()` 以内的图像。
+     */
+    void thumbnailReady(const QString &videoPath, const QImage &image);
+
+    /**
+     * @brief 无法读取也无法生成缩略图 (例如普通 MP4 还在写入、文件已损坏)，在加载线程中发出。
+     */
+    void thumbnailFailed(const QString &videoPath);
+
+protected:
+    /**
+     * @brief 线程主循环：先处理扫描请求，再处理缩略图请求。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 扫描一个目录，generation 过期时中止。
+     */
+    void scan(int generation, const QString &dirPath);
+
+    /**
+     * @brief 读取 (必要时生成) 一个录像文件的缩略图。
+     * @return 失败时返回空图像。
+     */
+    QImage loadThumbnail(const QString &videoPath, const QSize &size);
+
+    /**
+     * @brief 用 FFmpeg 解码录像中第一个关键帧，缩小到 size 以内。
+     * @return 失败时返回空图像。
+     */
+    static QImage decodeKeyFrame(const QString &videoPath, const QSize &size);
+
+    static const int SCAN_BATCH = 200;             ///< 扫描时每批发出的目录项数。
+    static const int MAX_PENDING_THUMBNAILS = 64;  ///< 最多保留的缩略图请求数 (超出时丢弃最早的)。
+    static const int MAX_DECODE_PACKETS = 64;      ///< 生成缩略图时最多读取的数据包数。
+    static const int THUMBNAIL_QUALITY = 80;       ///< 生成的缩略图的 JPEG 质量。
+
+    mutable QMutex m_mutex;        ///< 保护以下成员。
+    QWaitCondition m_condition;    ///< 有新请求或停止时唤醒线程。
+    bool m_stopRequested;          ///< 停止请求。
+    bool m_hasScan;                ///< 有尚未开始的扫描请求。
+    int m_scanGeneration;          ///< 尚未开始的扫描请求的编号。
+    QString m_scanPath;            ///< 尚未开始的扫描请求的目录。
+    QStringList m_thumbnailRequests; ///< 缩略图请求，最新的在末尾。
+    QSize m_thumbnailSize;         ///< 缩略图的最大尺寸。
+
+    QAtomicInt m_activeGeneration; ///< 最新的扫描编号 (-1 表示已取消)，扫描中每批检查一次。
+};
+
+#endif // HISTORYLOADER_H
@@ -3,15 +3,18 @@
  * @brief 历史记录页面类的实现文件
  * 
  * 本文件实现了视频监控系统的历史记录功能，包括：
- * - 显示指定目录下录制的视频文件列表（支持文件夹和MP4文件）。
- * - 提供文件和文件夹的浏览功能，双击文件夹可进入，双击MP4文件可播放。
+ * - 显示指定目录下录制的视频文件列表（支持文件夹和MP4 / MPEG-TS 录像文件）。
+ * - 提供文件和文件夹的浏览功能，双击文件夹可进入，双击录像文件可播放。
  * - 提供返回上一级目录或返回首页的功能。
  * - 显示当前目录下的项目数量。
+ * - 列表数据由 `RecordingListModel` 提供：存储根目录下的目录内容优先从录像索引 (`RecordingCatalog`) 查询，
+ *   其它目录由后台线程扫描，录像文件的缩略图只为可见行加载，浏览时GUI线程不读取TF卡。
  * - 定期更新并显示TF卡的存储容量信息（总容量和可用容量）。
  */
 
 #include "historypage.h"
 #include "mainwindow.h"
+#include "recordinglistmodel.h" // 文件列表模型
 
 #include <QVBoxLayout>   // 垂直布局类
 #include <QHBoxLayout>   // 水平布局类
@@ -30,7 +33,8 @@ HistoryPage::HistoryPage(MainWindow *parent)
     : QWidget(parent)                                 // 调用父类QWidget的构造函数
     , m_mainWindow(parent)                            // 初始化主窗口指针
     , m_historyLabel(nullptr)                         // 初始化历史记录标签为空指针
-    , m_fileListWidget(nullptr)                       // 初始化文件列表控件为空指针
+    , m_fileListView(nullptr)                         // 初始化文件列表视图为空指针
+    , m_fileModel(nullptr)                            // 初始化文件列表模型为空指针
     , m_refreshButton(nullptr)                        // 初始化刷新按钮为空指针
     , m_backButton(nullptr)                           // 初始化返回按钮为空指针
     , m_fileInfoLabel(nullptr)                        // 初始化文件信息标签为空指针
@@ -89,89 +93,31 @@ void HistoryPage::setupUI()
     topLayout->addWidget(m_historyLabel, 1, Qt::AlignCenter);             // 添加标题标签，居中对齐，拉伸因子为1（占据更多空间）
     topLayout->addWidget(m_backButton, 0, Qt::AlignRight);                // 添加返回按钮，右对齐，拉伸因子为0
     
-    // 创建文件列表控件
-    m_fileListWidget = new QListWidget();                                 // 创建QListWidget对象
-    m_fileListWidget->setSelectionMode(QAbstractItemView::SingleSelection); // 设置选择模式为单选(一次只能选择列表中的一个项目)
+    // 创建文件列表模型和视图
+    m_fileModel = new RecordingListModel(this);                           // 模型拥有后台扫描/缩略图加载线程
+    m_fileModel->setThumbnailSize(QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT));
+    m_fileListView = new QListView();                                     // 创建QListView对象
+    m_fileListView->setObjectName("m_fileListView");                      // 设置对象名称，用于样式表选择
+    m_fileListView->setModel(m_fileModel);
+    m_fileListView->setSelectionMode(QAbstractItemView::SingleSelection); // 设置选择模式为单选(一次只能选择列表中的一个项目)
+    m_fileListView->setEditTriggers(QAbstractItemView::NoEditTriggers);   // 列表只读
+    // 所有行一样高：视图不需要为每一行计算尺寸，只为可见的行取数据 (缩略图也只为可见行加载)
+    m_fileListView->setUniformItemSizes(true);
+    m_fileListView->setLayoutMode(QListView::Batched);                    // 几千行时分批布局，不阻塞事件循环
     
-    // 设置文件列表项的图标大小
-    QSize itemSize = m_fileListWidget->iconSize();                        // 获取默认图标大小
-    m_fileListWidget->setIconSize(itemSize * 12);                         // 将图标尺寸增大为原来的12倍，使图标更清晰
+    // 设置文件列表项的图标 (缩略图) 大小
+    m_fileListView->setIconSize(QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT));
     
-    // 项目高度已在style.qss中通过 `QListWidget::item { min-height: 40px; }` 
-    // 或 `#m_fileListWidget QListWidget::item { height: 50px; }` 进行设置
+    // 项目高度已在style.qss中通过 `#m_fileListView::item { min-height: 80px; }` 进行设置
     
     // 设置文件列表项的字体大小
-    QFont font = m_fileListWidget->font();                                // 获取当前字体
+    QFont font = m_fileListView->font();                                  // 获取当前字体
     font.setPointSize(26);                                              // 设置字体大小为26磅
-    m_fileListWidget->setFont(font);                                      // 应用新字体
+    m_fileListView->setFont(font);                                        // 应用新字体
     
-    // 连接文件列表项双击信号到Lambda表达式，处理文件/文件夹打开逻辑
-    connect(m_fileListWidget, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem *item) {
-        if (!item) return; // 如果item为空指针，则直接返回
-        
-        // 获取存储在列表项中的文件/文件夹完整路径
-        QString filePath = item->data(Qt::UserRole).toString(); // UserRole用于存储自定义数据
-        QFileInfo fileInfo(filePath);                           // 创建QFileInfo对象以获取文件信息
-        
-        // 判断双击的是文件夹还是文件
-        if (fileInfo.isDir()) { // 如果是文件夹
-            // 保存当前文件夹路径
-            QString currentPath = fileInfo.absoluteFilePath(); // 获取文件夹的绝对路径
-            
-            // 更新当前视频目录变量，记录用户进入的文件夹
-            m_currentVideoDir = currentPath;
-            
-            // 清空文件列表控件中的所有项，准备显示新文件夹内容
-            m_fileListWidget->clear();
-            
-            // 创建QDir对象，用于操作指定路径的文件夹
-            QDir dir(currentPath);
-            
-            // 如果当前路径不是TF卡根目录，则添加 "..." 项用于返回上一级目录
-            if (currentPath != "/mnt/TFcard") {
-                // 创建 "..." 列表项，并设置文件夹图标
-                QListWidgetItem *parentItem = new QListWidgetItem(QIcon(":/images/folder.png"), "...");
-                // 将上一级目录的路径存储到UserRole中
-                parentItem->setData(Qt::UserRole, dir.absolutePath() + "/.."); 
-                m_fileListWidget->addItem(parentItem); // 将 "..." 项添加到列表控件
-            }
-            
-            // 获取目录中的所有文件和文件夹条目列表
-            // QDir::AllEntries: 包括文件、目录、符号链接等
-            // QDir::NoDotAndDotDot: 排除 "." 和 ".." 条目
-            // QDir::DirsFirst: 文件夹优先显示
-            // QDir::Name: 按名称排序
-            QFileInfoList entryList = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::DirsFirst | QDir::Name);
-            
-            // 遍历获取到的所有条目，并添加到文件列表控件中
-            for (const QFileInfo &entryInfo : entryList) {
-                QString entryName = entryInfo.fileName(); // 获取文件名或文件夹名
-                QIcon icon;                               // 用于存储条目图标
-                
-                if (entryInfo.isDir()) { // 如果是文件夹
-                    entryName += "/";    // 在文件夹名称后添加 "/" 以示区分
-                    icon = QIcon(":/images/folder.png"); // 设置文件夹图标
-                } else if (entryInfo.suffix().toLower() == "mp4") { // 如果是MP4文件（忽略后缀大小写）
-                    icon = QIcon(":/images/mp4.png");   // 设置MP4文件图标
-                }
-                // else { continue; } // 如果需要只显示文件夹和MP4文件，可以取消此行注释
-
-                // 创建新的列表项，并设置图标和名称
-                QListWidgetItem *newItem = new QListWidgetItem(icon, entryName);
-                // 将文件/文件夹的绝对路径存储到UserRole中
-                newItem->setData(Qt::UserRole, entryInfo.absoluteFilePath());
-                m_fileListWidget->addItem(newItem); // 添加到列表控件
-            }
-            
-            // 更新底部文件信息标签，显示当前目录下的项目总数
-            m_fileInfoLabel->setText(QString("共找到 %1 个项目").arg(entryList.size()));
-            m_fileInfoLabel->setAlignment(Qt::AlignCenter); // 文本居中对齐
-        }
-        // 如果双击的是MP4文件，则调用主窗口的showVideoPage方法播放视频
-        else if (fileInfo.suffix().toLower() == "mp4") {
-            m_mainWindow->showVideoPage(filePath); // 通知主窗口切换到视频播放页面并播放该文件
-        }
-    });
+    // 双击列表项：进入文件夹或播放录像文件；列表全部列出后更新项目数
+    connect(m_fileListView, &QListView::doubleClicked, this, &HistoryPage::handleItemActivated);
+    connect(m_fileModel, &RecordingListModel::listingFinished, this, &HistoryPage::onListingFinished);
     
     // 创建文件信息标签（位于底部布局左侧）
     m_fileInfoLabel = new QLabel("请选择一个文件查看详细信息"); // 创建QLabel对象并设置初始文本
@@ -194,7 +140,7 @@ void HistoryPage::setupUI()
     
     // 将顶部布局、文件列表控件和底部布局添加到主垂直布局中
     historyLayout->addLayout(topLayout);                  // 添加顶部布局
-    historyLayout->addWidget(m_fileListWidget);           // 添加文件列表控件
+    historyLayout->addWidget(m_fileListView);             // 添加文件列表视图
     historyLayout->addLayout(bottomLayout);               // 添加底部布局
     
     // 连接各个按钮的点击信号到相应的槽函数
@@ -225,19 +171,25 @@ QString HistoryPage::getCurrentVideoDir() const
     return m_currentVideoDir; // 返回成员变量m_currentVideoDir的值
 }
 
+/**
+ * @brief 设置录像索引
+ * @param catalog 录像索引，为 nullptr 时列出目录
+ */
+void HistoryPage::setCatalog(const RecordingCatalog *catalog)
+{
+    m_fileModel->setCatalog(catalog);
+}
+
 /**
  * @brief 刷新历史记录页面的文件列表
  * 
- * 该函数首先清空现有的文件列表，然后根据`m_currentVideoDir`重新扫描目录，
- * 获取文件和文件夹信息，并更新到`m_fileListWidget`中。
+ * 该函数让文件列表模型切换到`m_currentVideoDir` (位于录像索引的根目录下时查询索引，
+ * 否则在后台线程中扫描目录，分批显示)，立即返回；全部列出后由`onListingFinished()`更新项目数。
  * 如果`m_currentVideoDir`为空，则默认使用"/mnt/TFcard"作为根目录。
  * 同时，如果当前目录不是根目录，会自动添加一个返回上级目录的 "..." 项。
  */
 void HistoryPage::refreshFileList()
 {
-    // 清空文件列表控件中的所有项
-    m_fileListWidget->clear();
-    
     // 如果当前视频目录路径为空，则默认设置为TF卡的根目录
     if (m_currentVideoDir.isEmpty()) {
         m_currentVideoDir = "/mnt/TFcard";
@@ -248,54 +200,55 @@ void HistoryPage::refreshFileList()
     
     // 检查指定的目录是否存在
     if (!tfDir.exists()) {
-        // 如果目录不存在，则在文件信息标签处显示错误信息，并返回
+        // 如果目录不存在，则清空列表，在文件信息标签处显示错误信息，并返回
+        m_fileModel->setDirectory(QString(), false);
         m_fileInfoLabel->setText(QString("错误: 无法访问%1目录").arg(m_currentVideoDir));
         return;
     }
     
-    // 获取目录中的所有文件和文件夹条目列表
-    // QDir::Files: 包含文件
-    // QDir::Dirs: 包含目录
-    // QDir::NoDotAndDotDot: 排除 "." 和 ".." 条目
-    // QDir::DirsFirst: 文件夹优先显示
-    // QDir::Name: 按名称排序
-    QFileInfoList fileList = tfDir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::DirsFirst | QDir::Name);
+    // 如果当前目录不是TF卡的根目录，则第一行是返回上级目录的 "..." 项
+    m_fileInfoLabel->setText("正在读取目录...");
+    m_fileModel->setDirectory(tfDir.absolutePath(), m_currentVideoDir != "/mnt/TFcard");
+}
+
+/**
+ * @brief 处理文件列表项的双击事件
+ * @param index 被双击的列表项
+ *
+ * 双击文件夹 (包括 "..." 项) 时进入该目录，双击录像文件 (MP4 / MPEG-TS) 时切换到视频播放页面。
+ */
+void HistoryPage::handleItemActivated(const QModelIndex &index)
+{
+    if (!index.isValid()) return; // 如果索引无效，则直接返回
     
-    // 检查获取到的文件列表是否为空
-    if (fileList.isEmpty()) {
-        // 如果列表为空，则在文件信息标签处显示目录中没有文件，并返回
-        m_fileInfoLabel->setText(QString("%1目录中没有文件").arg(m_currentVideoDir));
-        return;
-    }
+    // 获取存储在列表项中的文件/文件夹完整路径
+    const QString filePath = index.data(RecordingListModel::PathRole).toString();
     
-    // 如果当前目录不是TF卡的根目录，则添加一个返回上级目录的列表项 "..."
-    if (m_currentVideoDir != "/mnt/TFcard") {
-        QListWidgetItem *parentItem = new QListWidgetItem(QIcon(":/images/folder.png"), "..."); // 创建 "..." 项，并设置文件夹图标
-        parentItem->setData(Qt::UserRole, tfDir.absolutePath() + "/..");                      // 将上一级目录的路径存储到UserRole中
-        m_fileListWidget->addItem(parentItem);                                                 // 添加到列表控件
+    // 判断双击的是文件夹还是文件 (由模型给出，不访问TF卡)
+    if (index.data(RecordingListModel::IsDirRole).toBool()) { // 如果是文件夹
+        // 更新当前视频目录变量 ("..." 项的路径以 "/.." 结尾，规范化后即上一级目录)，然后刷新列表
+        m_currentVideoDir = QDir::cleanPath(filePath);
+        refreshFileList();
     }
-    
-    // 遍历获取到的所有文件和文件夹条目
-    for (const QFileInfo &fileInfo : fileList) {
-        QString displayName = fileInfo.fileName(); // 获取文件名或文件夹名
-        QIcon icon;                                // 用于存储条目图标
-        
-        if (fileInfo.isDir()) { // 如果是文件夹
-            displayName += "/"; // 在文件夹名称后添加 "/" 以示区分
-            icon = QIcon(":/images/folder.png"); // 设置文件夹图标
-        } else if (fileInfo.suffix().toLower() == "mp4") { // 如果是MP4文件（忽略后缀大小写）
-            icon = QIcon(":/images/mp4.png");   // 设置MP4文件图标
-        }
-        // else { continue; } // 如果需要只显示文件夹和MP4，可以取消此行注释
+    // 如果双击的是录像文件 (MP4 / MPEG-TS)，则调用主窗口的showVideoPage方法播放视频
+    else if (index.data(RecordingListModel::IsVideoRole).toBool()) {
+        m_mainWindow->showVideoPage(filePath); // 通知主窗口切换到视频播放页面并播放该文件
+    }
+}
 
-        // 创建新的列表项，并设置图标和名称
-        QListWidgetItem *item = new QListWidgetItem(icon, displayName);
-        item->setData(Qt::UserRole, fileInfo.absoluteFilePath()); // 将文件/文件夹的绝对路径存储到UserRole中
-        m_fileListWidget->addItem(item);                          // 添加到列表控件
+/**
+ * @brief 当前目录已全部列出
+ * @param itemCount 目录中的项目数 (不含 "..." 项)
+ */
+void HistoryPage::onListingFinished(int itemCount)
+{
+    if (itemCount == 0) {
+        // 如果列表为空，则在文件信息标签处显示目录中没有文件
+        m_fileInfoLabel->setText(QString("%1目录中没有文件").arg(m_currentVideoDir));
+        return;
     }
-    
     // 更新底部文件信息标签，显示当前目录下的项目总数
-    m_fileInfoLabel->setText(QString("共找到 %1 个项目").arg(fileList.size()));
+    m_fileInfoLabel->setText(QString("共找到 %1 个项目").arg(itemCount));
     m_fileInfoLabel->setAlignment(Qt::AlignCenter); // 文本居中对齐
 }
 
@@ -392,4 +345,4 @@ void HistoryPage::updateStorageInfo()
     
     // 更新存储信息标签的文本
     m_storageInfoLabel->setText(storageText);
-}
\ No newline at end of file
+}
@@ -4,22 +4,27 @@
 #include <QWidget>         // QWidget 基类
 #include <QLabel>          // 标签控件
 #include <QPushButton>     // 按钮控件
-#include <QListWidget>     // 列表控件
+#include <QListView>       // 列表视图 (数据来自 RecordingListModel)
 #include <QDateTime>       // 日期时间类 (在此文件中未直接使用，但可能被包含的头文件间接依赖或为未来扩展预留)
 #include <QTimer>          // 定时器类
 #include <QStorageInfo>    // 存储信息类
+#include <QFileInfo>       // 文件信息类
 
 // 前向声明，避免循环包含头文件问题
 class MainWindow;        // 主窗口类
-class QListWidgetItem;   // 列表控件项类
+class RecordingCatalog;  // 录像索引 (StorageManager 维护)
+class RecordingListModel; // 历史浏览的目录列表模型
 
 /**
  * @brief 历史记录页面类 (HistoryPage)
  * 
  * 该类继承自 QWidget，用于实现视频监控系统的历史记录浏览功能。
  * 主要功能包括：
- * - 显示指定目录下录制的视频文件列表（支持文件夹和MP4文件）。
+ * - 显示指定目录下录制的视频文件列表（支持文件夹和MP4 / MPEG-TS 录像文件）。
  * - 提供文件和文件夹的浏览功能，允许用户通过双击导航。
+ * - 列表由 `RecordingListModel` 提供：设置了录像索引时，存储根目录下的目录内容从索引查询，
+ *   其它目录在后台线程中扫描并分批显示，GUI线程不读取TF卡目录。
+ * - 录像文件显示缩略图，只加载可见行的缩略图 (后台线程读取缩略图文件，没有时从第一个关键帧生成一次)。
  * - 提供返回上一级目录或返回主页面的功能。
  * - 定期更新并显示存储设备（如TF卡）的容量信息。
  */
@@ -53,12 +58,18 @@ public:
      */
     QString getCurrentVideoDir() const;
 
+    /**
+     * @brief 设置录像索引。设置后存储根目录下的文件列表从索引查询 (只列出有录像的目录和已完成的录像文件)。
+     * @param catalog 录像索引 (由 StorageManager 拥有)，为 nullptr 时列出目录。
+     */
+    void setCatalog(const RecordingCatalog *catalog);
+
 public slots:
     /**
      * @brief 公共槽函数：刷新文件列表。
      * 
      * 当需要更新文件列表显示时（例如，目录更改或外部请求刷新），调用此槽函数。
-     * 它会重新扫描当前目录并更新列表控件。
+     * 它会重新查询 (或在后台扫描) 当前目录并更新列表，立即返回。
      */
     void refreshFileList();
     
@@ -86,12 +97,23 @@ private slots: // Qt 5 以后 private slots 和普通 private 成员函数在信
      */
     void updateStorageInfo();
 
+    /**
+     * @brief 私有槽函数：列表项被双击，进入目录或播放录像文件。
+     */
+    void handleItemActivated(const QModelIndex &index);
+
+    /**
+     * @brief 私有槽函数：当前目录已全部列出 (`RecordingListModel::listingFinished`)，更新项目数。
+     */
+    void onListingFinished(int itemCount);
+
 private:
     MainWindow *m_mainWindow;       ///< 指向主窗口的指针，用于页面切换等交互操作。
     
     // UI 组件指针
     QLabel *m_historyLabel;         ///< 显示 "监控历史记录" 标题的标签。
-    QListWidget *m_fileListWidget;  ///< 用于显示文件和文件夹列表的控件。
+    QListView *m_fileListView;      ///< 用于显示文件和文件夹列表的视图。
+    RecordingListModel *m_fileModel; ///< 文件列表模型 (后台扫描和缩略图加载)。
     QPushButton *m_refreshButton;   ///< 刷新文件列表的按钮。
     QPushButton *m_backButton;      ///< 返回上一级或主页的按钮。
     QLabel *m_fileInfoLabel;        ///< 显示当前目录下项目数量或提示信息的标签。
@@ -99,6 +121,9 @@ private:
     QTimer *m_storageTimer;         ///< 定时器，用于定期调用 `updateStorageInfo()` 更新存储信息。
     
     QString m_currentVideoDir;      ///< 存储当前文件列表显示的目录的绝对路径。
+
+    static const int THUMBNAIL_WIDTH = 96;  ///< 列表中缩略图的宽度 (像素)。
+    static const int THUMBNAIL_HEIGHT = 72; ///< 列表中缩略图的高度 (像素)，与 OV5640 的 4:3 画面一致。
 };
 
 #endif // HISTORYPAGE_H
@@ -0,0 +1,93 @@
+/**
+ * @file keyframeindex.cpp
+ * @brief 录像关键帧索引 (KeyFrameIndex) 的实现文件。
+ */
+
+#include "keyframeindex.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+QString KeyFrameIndex::indexPath(const QString &videoPath)
+{
+    const QFileInfo info(videoPath);
+    return info.dir().absolutePath() + "/.thumbs/" + info.completeBaseName() + ".kfi";
+}
+
+void KeyFrameIndex::append(qint64 ptsMs, qint64 offset)
+{
+    Entry entry;
+    entry.ptsMs = ptsMs;
+    entry.offset = offset;
+    m_entries.append(entry);
+}
+
+int KeyFrameIndex::floorIndex(qint64 positionMs) const
+{
+    if (m_entries.isEmpty()) {
+        return -1;
+    }
+    // 第一个晚于 positionMs 的条目的前一个
+    const QVector<Entry>::const_iterator it = std::upper_bound(m_entries.constBegin(), m_entries.constEnd(), positionMs,
+            [](qint64 value, const Entry &entry) { return value < entry.ptsMs; });
+    return qMax(0, static_cast<int>(it - m_entries.constBegin()) - 1);
+}
+
+int KeyFrameIndex::nearestIndex(qint64 positionMs) const
+{
+    const int floor = floorIndex(positionMs);
+    if (floor < 0 || floor + 1 >= m_entries.size()) {
+        return floor;
+    }
+    const qint64 before = positionMs - m_entries.at(floor).ptsMs;
+    const qint64 after = m_entries.at(floor + 1).ptsMs - positionMs;
+    return (after < before) ? floor + 1 : floor;
+}
+
+bool KeyFrameIndex::save(const QString &path) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "KeyFrameIndex: 无法写入" << path << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out << MAGIC << static_cast<quint32>(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        out << static_cast<quint32>(entry.ptsMs) << static_cast<quint64>(entry.offset);
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+bool KeyFrameIndex::load(const QString &path)
+{
+    m_entries.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 count = 0;
+    in >> magic >> count;
+    if (magic != MAGIC || count > MAX_ENTRIES) {
+        return false;
+    }
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        quint32 ptsMs = 0;
+        quint64 offset = 0;
+        in >> ptsMs >> offset;
+        if (in.status() != QDataStream::Ok) {
+            m_entries.clear(); // 文件被截断
+            return false;
+        }
+        append(ptsMs, static_cast<qint64>(offset));
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QVector>
+#include <QString>
+
+/**
+ * @brief 录像文件的关键帧索引 (KeyFrameIndex)
+ *
+ * 录制线程在写入每个关键帧时记录它的时间 (相对文件开头的毫秒数，与 `QMediaPlayer::position()` 一致)
+ * 和在文件中的字节位置，文件关闭时保存为缩略图目录中的 `.kfi` 文件 (`indexPath()`)，随录像重命名和删除。
+ * 播放页用它把拖动进度条吸附到关键帧 (解码器不需要从上一个关键帧解码到目标位置)、
+ * 生成进度条下方的缩略图条和只解码关键帧的快进。
+ *
+ * 文件格式 (QDataStream，大端)：魔数 `KFI1`、条目数，之后每个条目为 quint32 毫秒 + quint64 字节位置 (12 字节)，
+ * 30 分钟、每秒一个关键帧的录像约 21 KB。
+ */
+class KeyFrameIndex
+{
+public:
+    /**
+     * @brief 一个关键帧。
+     */
+    struct Entry {
+        qint64 ptsMs = 0;   ///< 显示时间，相对文件开头 (毫秒)。
+        qint64 offset = -1; ///< 关键帧所在 GOP 在文件中的起始字节位置，-1 表示未知 (只按时间定位)。
+    };
+
+    /**
+     * @brief 录像文件对应的索引文件路径 (与缩略图同在 `.thumbs` 隐藏目录中)。
+     */
+    static QString indexPath(const QString &videoPath);
+
+    void clear() { m_entries.clear(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int size() const { return m_entries.size(); }
+    const Entry &at(int i) const { return m_entries.at(i); }
+
+    /**
+     * @brief 追加一个关键帧 (时间不早于上一个条目)。
+     */
+    void append(qint64 ptsMs, qint64 offset);
+
+    /**
+     * @brief 最后一个不晚于 positionMs 的关键帧的下标 (早于第一个关键帧时为 0)，索引为空时返回 -1。
+     */
+    int floorIndex(qint64 positionMs) const;
+
+    /**
+     * @brief 与 positionMs 最接近的关键帧的下标，索引为空时返回 -1。
+     */
+    int nearestIndex(qint64 positionMs) const;
+
+    /**
+     * @brief 保存到文件 (覆盖)。
+     * @return 写入失败时返回 false。
+     */
+    bool save(const QString &path) const;
+
+    /**
+     * @brief 从文件读取，替换当前内容。
+     * @return 文件不存在或格式不正确时返回 false (内容被清空)。
+     */
+    bool load(const QString &path);
+
+private:
+    static const quint32 MAGIC = 0x4B464931; ///< "KFI1"
+    static const quint32 MAX_ENTRIES = 1 << 20; ///< 读取时的条目数上限 (防止损坏的文件导致大量分配)。
+
+    QVector<Entry> m_entries; ///< 按时间升序。
+};
+
+#endif // KEYFRAMEINDEX_H
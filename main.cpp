@@ -1,37 +1,92 @@
 #include "mainwindow.h" // 包含主窗口类的头文件
+#include "headlessrecorder.h" // 无界面录制模式
+#include "monitorconfig.h"    // 流水线配置
 
 #include <QApplication>    // Qt应用程序核心类
+#include <QCoreApplication> // 无界面模式使用的应用程序类
+#include <cstring>
+
+/**
+ * @brief 在命令行参数中查找选项的值。
+ * @param name 选项名，例如 "--config"。支持 "--config <值>" 和 "--config=<值>" 两种写法。
+ * @return 选项的值；未指定时返回 defaultValue。
+ *
+ * 界面模式和无界面模式要创建不同的应用程序对象，所以必须在创建之前解析，不能使用 `QCommandLineParser`。
+ */
+static QString argumentValue(int argc, char *argv[], const char *name, const QString &defaultValue)
+{
+    const size_t nameLength = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0 && i + 1 < argc) {
+            return QString::fromLocal8Bit(argv[i + 1]);
+        }
+        if (strncmp(argv[i], name, nameLength) == 0 && argv[i][nameLength] == '=') {
+            return QString::fromLocal8Bit(argv[i] + nameLength + 1);
+        }
+    }
+    return defaultValue;
+}
+
+/**
+ * @brief 命令行参数中是否有某个开关选项。
+ */
+static bool hasArgument(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
 
 /**
  * @brief 主函数 (main)
  * @param argc 命令行参数个数
  * @param argv 命令行参数数组
  * @return 应用程序退出状态码
- * 
+ *
  * 这是Qt应用程序的入口点。
- * 它执行以下操作：
+ * 命令行选项：
+ * - `--config <文件>`：采集、录制和存储参数的配置文件 (INI 格式，默认 `/etc/video_surveillance.conf`，不存在时使用默认参数)。
+ * - `--headless`：无界面模式，只运行采集、录制、存储淘汰和计量汇报，适用于没有显示器的设备。
+ *
+ * 界面模式执行以下操作：
  * 1. 创建一个 QApplication 对象 `a`，它是管理GUI应用程序控制流和主要设置所必需的。
  * 2. 创建一个 MainWindow 对象 `w`，这是应用程序的主窗口。
  * 3. 调用 `w.show()` 来显示主窗口。
  * 4. 调用 `a.exec()` 进入Qt事件循环，应用程序将在此处等待和处理用户交互及其他事件，
  *    直到应用程序退出（例如，关闭主窗口）。
  * 5. `a.exec()` 的返回值将作为程序的退出状态码。
+ *
+ * 无界面模式只创建 `QCoreApplication` 和 `HeadlessRecorder`，不加载样式表、多媒体播放器和任何页面，
+ * 直到收到 SIGINT / SIGTERM 才退出。
  */
 int main(int argc, char *argv[])
 {
+    const QString configPath = argumentValue(argc, argv, "--config", MonitorConfig::DEFAULT_PATH);
+
+    if (hasArgument(argc, argv, "--headless")) {
+        // 无界面模式：没有 GUI 事件循环和窗口系统连接，摄像头打开后立即开始录制
+        QCoreApplication a(argc, argv);
+        HeadlessRecorder recorder(MonitorConfig::load(configPath));
+        recorder.start();
+        return a.exec(); // 返回后 recorder 先于 a 销毁，录像文件在此收尾
+    }
+
     // 1. 创建 QApplication 对象
     // QApplication 管理着整个应用程序的事件循环和全局设置。
     // argc 和 argv 是从命令行传递给应用程序的参数。
     QApplication a(argc, argv);
-    
+
     // 2. 创建 MainWindow 对象
     // MainWindow 是我们应用程序的主窗口，定义在 "mainwindow.h" 中。
-    MainWindow w;
-    
+    MainWindow w(MonitorConfig::load(configPath));
+
     // 3. 显示主窗口
     //调用 show() 方法使主窗口在屏幕上可见。
     w.show();
-    
+
     // 4. 进入 Qt 事件循环并返回退出状态码
     // a.exec() 启动了 Qt 的事件处理机制。程序会在这里暂停，
     // 响应用户的操作（如点击按钮、窗口移动等）以及其他系统事件。
@@ -10,7 +10,8 @@
  *   历史记录页面 (`HistoryPage`) 和视频播放页面 (`VideoPage`)。
  * - 提供公共槽函数来响应页面切换的请求，例如从首页导航到监控页或历史页，
  *   从历史页导航到视频播放页，以及从视频播放页返回历史页。
- * - 在页面切换时执行必要的逻辑，如开始/停止视频采集、刷新文件列表等。
+ * - 持有常驻的监控服务 (`MonitorService`)，启动时即开始采集，页面切换不再停止/重新打开摄像头。
+ * - 在页面切换时执行必要的逻辑，如重试打开不可用的摄像头、刷新文件列表等。
  */
 
 #include "mainwindow.h"       // MainWindow类的头文件
@@ -19,11 +20,14 @@
 #include "monitorpage.h"      // 监控页面类头文件
 #include "historypage.h"      // 历史记录页面类头文件
 #include "videopage.h"        // 视频播放页面类头文件
+#include "storagemanager.h"   // 存储管理类 (录像索引)
+#include "monitorservice.h"   // 常驻的采集和录制流水线
 
 #include <QFile>             // QFile类，用于文件操作（如此处用于读取样式表）
 #include <QStackedWidget>    // QStackedWidget类，用于管理多个页面层叠显示 (在.h中已包含，此处为清晰可省略)
 #include <QFileInfo>         // QFileInfo类，用于获取文件信息 (在.h中已包含，此处为清晰可省略)
 #include <QDir>              // QDir类，用于目录操作 (在.h中已包含，此处为清晰可省略)
+#include <QDebug>            // QDebug类，用于调试输出
 
 /**
  * @brief MainWindow 类的构造函数。
@@ -36,12 +40,15 @@
  * 4. 加载并应用全局样式表 `style.qss`。
  * 5. 设置主窗口的标题和初始大小。
  * 6. 创建一个 `QStackedWidget` 作为中心部件，用于管理和切换不同的功能页面。
- * 7. 实例化所有功能页面 (`HomePage`, `MonitorPage`, `HistoryPage`, `VideoPage`)，并将它们添加到 `QStackedWidget` 中。
- * 8. 默认显示首页 (`HomePage`)。
+ * 7. 按配置创建监控服务 (`MonitorService`，探测摄像头、创建各路通道和存储管理器)。
+ * 8. 实例化所有功能页面 (`HomePage`, `MonitorPage`, `HistoryPage`, `VideoPage`)，并将它们添加到 `QStackedWidget` 中。
+ *    监控页面在这里决定预览方式，因此服务在页面创建之后才开始采集。
+ * 9. 启动服务的采集 (摄像头、缓冲区和待命录制的编码器从此一直保持工作)，默认显示首页 (`HomePage`)。
  */
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const MonitorConfig &config, QWidget *parent)
     : QMainWindow(parent)               // 调用父类 QMainWindow 的构造函数
     , ui(new Ui::MainWindow)            // 创建 Ui::MainWindow 的实例，用于访问 .ui 文件中定义的控件
+    , m_monitorService(nullptr)         // 初始化监控服务指针为空
     , m_homePage(nullptr)               // 初始化首页指针为空
     , m_monitorPage(nullptr)            // 初始化监控页面指针为空
     , m_historyPage(nullptr)            // 初始化历史记录页面指针为空
@@ -68,11 +75,20 @@ MainWindow::MainWindow(QWidget *parent)
     m_stackedWidget = new QStackedWidget(this); // 创建QStackedWidget实例，this作为其父对象
     setCentralWidget(m_stackedWidget);          // 将m_stackedWidget设置为主窗口的中心部件
     
+    // 创建常驻的监控服务 (先于监控页面创建，页面只引用其中的通道)
+    m_monitorService = new MonitorService(config, this);
+
     // 创建各个功能页面的实例
     m_homePage = new HomePage(this);            // 创建首页实例，this作为其父对象
-    m_monitorPage = new MonitorPage(this);      // 创建监控页面实例
+    m_monitorPage = new MonitorPage(this, m_monitorService); // 创建监控页面实例
     m_historyPage = new HistoryPage(this);      // 创建历史记录页面实例
     m_videoPage = new VideoPage(this);          // 创建视频播放页面实例
+
+    // 历史和回放页面从监控服务的存储管理器维护的录像索引查询目录内容
+    m_historyPage->setCatalog(m_monitorService->storageManager()->catalog());
+    m_videoPage->setCatalog(m_monitorService->storageManager()->catalog());
+    // 回放页面的时间段导出使用存储管理器的导出线程 (导出期间来源录像不会被淘汰)
+    m_videoPage->setExporter(m_monitorService->storageManager()->exporter(), config.exportDir());
     
     // 将创建的各个页面添加到堆叠部件中
     // addWidget()会返回页面的索引，但这里我们不需要使用它
@@ -81,6 +97,11 @@ MainWindow::MainWindow(QWidget *parent)
     m_stackedWidget->addWidget(m_historyPage);  // 添加历史记录页面
     m_stackedWidget->addWidget(m_videoPage);    // 添加视频播放页面
     
+    // 启动时即开始采集 (预览暂停，录制线程待命)，之后进入监控页面不再需要打开设备和编码器
+    if (!m_monitorService->startCapture()) {
+        qWarning() << "启动时没有可用的摄像头，进入监控页面时重试";
+    }
+
     // 初始化时，默认显示首页
     m_stackedWidget->setCurrentWidget(m_homePage);
 }
@@ -89,30 +110,28 @@ MainWindow::MainWindow(QWidget *parent)
  * @brief MainWindow 类的析构函数。
  * 
  * 负责释放在构造函数中通过 `new` 分配的 `ui` 对象。
+ * 先析构监控页面 (它引用服务的通道和信号)，再析构监控服务 (结束录制并停止采集)。
  * Qt的父子对象机制会自动处理其他通过 `new` 创建并指定了父对象的 `QWidget` 派生类
- * (如 `m_homePage`, `m_monitorPage` 等) 的释放。
+ * (如 `m_homePage`, `m_historyPage` 等) 的释放。
  */
 MainWindow::~MainWindow()
 {
+    delete m_monitorPage;    // 页面引用服务的通道，先于服务销毁
+    m_monitorPage = nullptr;
+    delete m_monitorService; // 结束录制 (文件按时间段重命名)、停止采集并释放摄像头
+    m_monitorService = nullptr;
     delete ui; // 释放由Qt Designer生成的ui类实例所占用的内存
-               // m_homePage, m_monitorPage等由于设置了this作为parent，会被Qt自动管理和释放
+               // m_homePage等由于设置了this作为parent，会被Qt自动管理和释放
 }
 
 /**
  * @brief 公共槽函数：切换到并显示首页。
  * 
  * 当需要返回或显示首页时调用此函数。
- * 如果当前页面是监控页面 (`m_monitorPage`)，则在切换前会先调用 `m_monitorPage->stopCapture()`
- * 来停止视频采集，以释放摄像头资源并停止相关处理。
+ * 离开监控页面时采集和录制都不停止：页面隐藏后只暂停预览，摄像头和编码器保持工作。
  */
 void MainWindow::showHomePage()
 {
-    // 检查当前显示的页面是否是监控页面
-    if (m_stackedWidget->currentWidget() == m_monitorPage) {
-        // 如果是监控页面，则调用其 stopCapture 方法停止视频采集
-        m_monitorPage->stopCapture();
-    }
-    
     // 将堆叠部件的当前显示页面设置为首页
     m_stackedWidget->setCurrentWidget(m_homePage);
 }
@@ -121,20 +140,20 @@ void MainWindow::showHomePage()
  * @brief 公共槽函数：切换到并显示监控页面。
  * 
  * 当需要显示实时监控画面时调用此函数。
- * 切换到监控页面后，会尝试调用 `m_monitorPage->startCapture()` 来开始视频采集。
- * 如果视频采集启动失败（例如，摄像头无法打开），则会自动切回首页。
+ * 服务已在后台采集，切换后页面立即恢复预览；只有不可用的摄像头 (例如启动后才插入) 会在这里重新尝试打开。
+ * 如果没有任何一路能够采集（例如，摄像头无法打开），则会自动切回首页。
  */
 void MainWindow::showMonitorPage()
 {
-    // 将堆叠部件的当前显示页面设置为监控页面
-    m_stackedWidget->setCurrentWidget(m_monitorPage);
-    
-    // 尝试启动监控页面的视频采集功能
-    if (!m_monitorPage->startCapture()) {
-        // 如果启动视频采集失败 (例如，摄像头未连接或权限问题)
-        // 则调用 showHomePage() 方法，将界面切换回首页
+    // 已在采集的通道不受影响，只重试不可用的通道
+    if (!m_monitorService->startCapture()) {
+        // 如果没有可用的摄像头 (例如，摄像头未连接或权限问题)，停留在首页
         showHomePage();
+        return;
     }
+
+    // 将堆叠部件的当前显示页面设置为监控页面 (showEvent 恢复各路预览)
+    m_stackedWidget->setCurrentWidget(m_monitorPage);
 }
 
 /**
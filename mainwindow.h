@@ -14,6 +14,8 @@ class HomePage;          // 首页类
 class MonitorPage;       // 监控页面类
 class HistoryPage;       // 历史记录页面类
 class VideoPage;         // 视频播放页面类
+class MonitorService;    // 常驻的采集和录制流水线
+struct MonitorConfig;    // 流水线配置
 class QListWidgetItem;   // QListWidget的列表项类 (虽然在此头文件中MainWindow不直接使用，但可能子页面会使用，或为未来扩展)
 
 // Qt Designer 生成的 UI 类在 Ui 命名空间中
@@ -29,6 +31,8 @@ QT_END_NAMESPACE
  * 并提供在这些页面之间进行切换的接口和逻辑。
  * 主要功能包括：
  * - 作为应用程序的主框架，承载所有其他UI组件。
+ * - 持有常驻的监控服务 (`MonitorService`)：启动时即打开摄像头并开始采集，切换页面不停止采集和录制，
+ *   进入监控页面时立即有画面。
  * - 使用 QStackedWidget 实现多页面管理和切换。
  * - 提供槽函数以响应来自各页面的导航请求。
  */
@@ -39,10 +43,11 @@ class MainWindow : public QMainWindow
 public:
     /**
      * @brief 构造函数
+     * @param config 监控服务使用的采集、录制和存储配置 (由 `main()` 从配置文件读取)。
      * @param parent 父窗口部件指针。对于主窗口，通常为 nullptr。
      *               `explicit` 关键字防止构造函数的隐式类型转换。
      */
-    explicit MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const MonitorConfig &config, QWidget *parent = nullptr);
     
     /**
      * @brief 析构函数
@@ -66,6 +71,7 @@ private:
                         ///< 通过它可以访问在 `.ui` 文件中定义的控件。
     
     // 堆叠部件和各个功能页面的指针成员变量
+    MonitorService *m_monitorService; ///< 常驻的采集和录制流水线，生命周期与主窗口相同。
     QStackedWidget *m_stackedWidget; ///< QStackedWidget实例，用于管理和显示不同的功能页面。
     HomePage *m_homePage;            ///< 指向首页 (HomePage) 实例的指针。
     MonitorPage *m_monitorPage;      ///< 指向监控页面 (MonitorPage) 实例的指针。
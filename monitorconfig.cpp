@@ -0,0 +1,108 @@
+/**
+ * @file monitorconfig.cpp
+ * @brief 流水线配置 (MonitorConfig) 的实现文件。
+ */
+
+#include "monitorconfig.h"
+
+#include <QSettings>
+#include <QFileInfo>
+#include <QDebug>
+
+const char *const MonitorConfig::DEFAULT_PATH = "/etc/video_surveillance.conf";
+
+MonitorConfig::MonitorConfig()
+    : captureWidth(640)
+    , captureHeight(480)
+    , captureFps(30)
+    , maxCameras(MAX_CAMERAS)
+    , recordingPath("/mnt/TFcard")
+    , recordFps(0)
+    , preEventSeconds(5)
+    , motionRecording(true)
+    , adaptiveRateControl(true)
+    , substream(true)
+    , timeLapseIntervalMs(0)
+    , timeLapseIntraOnly(false)
+    , timeLapseFullRateOnMotion(true)
+    , minFreeSpacePercent(10)
+    , storageCheckIntervalMs(600000)
+    , metricsIntervalMs(1000)
+    , metricsDumpPath("/tmp/video_surveillance.prom")
+    , recordOnStart(true)
+    , retryIntervalMs(5000)
+{
+}
+
+/**
+ * @brief 读取配置文件，每一项缺失时保留默认值。
+ *
+ * 数值项按 `QSettings::value().toInt()` 解析，无法解析或超出范围时回退到默认值并输出警告，
+ * 错误的配置不会阻止录制启动。
+ */
+MonitorConfig MonitorConfig::load(const QString &path)
+{
+    MonitorConfig config;
+    if (!QFileInfo::exists(path)) {
+        qInfo() << "配置文件" << path << "不存在，使用默认配置";
+        return config;
+    }
+
+    QSettings settings(path, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        qWarning() << "配置文件" << path << "格式错误，使用默认配置";
+        return config;
+    }
+
+    // 读取整数项：解析失败或小于 minValue 时保留默认值
+    auto readInt = [&settings](const char *key, int defaultValue, int minValue) {
+        bool ok = false;
+        const int value = settings.value(key, defaultValue).toInt(&ok);
+        if (!ok || value < minValue) {
+            qWarning() << "配置项" << key << "无效:" << settings.value(key).toString() << "，使用默认值" << defaultValue;
+            return defaultValue;
+        }
+        return value;
+    };
+
+    config.captureWidth = readInt("capture/width", config.captureWidth, 1);
+    config.captureHeight = readInt("capture/height", config.captureHeight, 1);
+    config.captureFps = readInt("capture/fps", config.captureFps, 1);
+    config.maxCameras = qMin(readInt("capture/max_cameras", config.maxCameras, 1), int(MAX_CAMERAS));
+
+    config.recordingPath = settings.value("record/path", config.recordingPath).toString();
+    config.recordFps = readInt("record/fps", config.recordFps, 0);
+    config.preEventSeconds = readInt("record/pre_event_seconds", config.preEventSeconds, 0);
+    config.motionRecording = settings.value("record/motion", config.motionRecording).toBool();
+    config.adaptiveRateControl = settings.value("record/adaptive_rate_control", config.adaptiveRateControl).toBool();
+    config.substream = settings.value("record/substream", config.substream).toBool();
+    config.timeLapseIntervalMs = readInt("record/timelapse_interval_ms", config.timeLapseIntervalMs, 0);
+    config.timeLapseIntraOnly = settings.value("record/timelapse_intra_only", config.timeLapseIntraOnly).toBool();
+    config.timeLapseFullRateOnMotion = settings.value("record/timelapse_motion_full_rate",
+                                                      config.timeLapseFullRateOnMotion).toBool();
+
+    config.minFreeSpacePercent = qMin(readInt("storage/min_free_percent", config.minFreeSpacePercent, 0), 99);
+    config.storageCheckIntervalMs = readInt("storage/check_interval_ms", config.storageCheckIntervalMs, 1000);
+
+    config.streamUrlTemplate = settings.value("stream/url_template", config.streamUrlTemplate).toString();
+
+    config.exportPath = settings.value("export/path", config.exportPath).toString();
+
+    config.metricsIntervalMs = readInt("metrics/interval_ms", config.metricsIntervalMs, 100);
+    config.metricsDumpPath = settings.value("metrics/dump_path", config.metricsDumpPath).toString();
+
+    config.recordOnStart = settings.value("headless/record_on_start", config.recordOnStart).toBool();
+    config.retryIntervalMs = readInt("headless/retry_interval_ms", config.retryIntervalMs, 100);
+
+    if (config.recordingPath.isEmpty()) {
+        qWarning() << "配置项 record/path 为空，使用默认值 /mnt/TFcard";
+        config.recordingPath = MonitorConfig().recordingPath;
+    }
+    qInfo() << "已读取配置文件" << path;
+    return config;
+}
+
+QString MonitorConfig::exportDir() const
+{
+    return exportPath.isEmpty() ? recordingPath + "/.export" : exportPath;
+}
@@ -0,0 +1,104 @@
+#ifndef MONITORCONFIG_H
+#define MONITORCONFIG_H
+
+#include <QString>
+
+/**
+ * @brief 采集和录制流水线的配置 (MonitorConfig)
+ *
+ * 原来写死在监控页面中的采集、录制、存储、推流和计量参数。默认值与原来的常量相同，
+ * `load()` 从 INI 格式的配置文件中覆盖，文件不存在或某一项缺失时使用默认值。
+ * 界面模式和无界面 (headless) 模式使用同一份配置。
+ *
+ * 配置文件示例：
+ * @code
+ * [capture]
+ * width=640
+ * height=480
+ * fps=30
+ * max_cameras=4
+ *
+ * [record]
+ * path=/mnt/TFcard
+ * fps=0
+ * pre_event_seconds=5
+ * motion=true
+ * adaptive_rate_control=true
+ * substream=true
+ * timelapse_interval_ms=0
+ * timelapse_intra_only=false
+ * timelapse_motion_full_rate=true
+ *
+ * [storage]
+ * min_free_percent=10
+ * check_interval_ms=600000
+ *
+ * [stream]
+ * url_template=rtsp://192.168.1.10:8554/cam%1
+ *
+ * [export]
+ * path=/mnt/usb
+ *
+ * [metrics]
+ * interval_ms=1000
+ * dump_path=/tmp/video_surveillance.prom
+ *
+ * [headless]
+ * record_on_start=true
+ * retry_interval_ms=5000
+ * @endcode
+ */
+struct MonitorConfig
+{
+    static const int MAX_CAMERAS = 4; ///< 最多同时使用的摄像头数量 (界面为 2x2 网格)。
+    static const char *const DEFAULT_PATH; ///< 默认的配置文件路径 ("/etc/video_surveillance.conf")。
+
+    // 期望的采集参数，打开每个摄像头时与驱动协商 (像素格式自动选择，分辨率/帧率取驱动支持的最接近值)
+    int captureWidth;      ///< 期望的采集宽度 (像素)，默认 640。
+    int captureHeight;     ///< 期望的采集高度 (像素)，默认 480。
+    int captureFps;        ///< 期望的采集帧率，默认 30。
+    int maxCameras;        ///< 使用的摄像头数量上限 (1 ~ MAX_CAMERAS)，默认 MAX_CAMERAS。
+
+    QString recordingPath; ///< 录像文件保存的根目录，默认 "/mnt/TFcard"。
+    int recordFps;         ///< 每路录制的帧率上限，0 表示录制采集到的每一帧。
+    int preEventSeconds;   ///< 录像文件包含的录制开始前的画面时长 (秒)，0 表示不预录。默认 5。
+    bool motionRecording;  ///< 是否在检测到移动时自动录制对应的摄像头，默认 true。
+    bool adaptiveRateControl; ///< 负载过高时自动降码率/帧率，画面静止时降码率并拉长关键帧间隔。默认 true。
+    bool substream;        ///< 每路同时编码 320x240@5fps 子码流 (缩略图、远程预览)，默认 true。
+    int timeLapseIntervalMs; ///< 延时录制的采样间隔 (毫秒，例如 1000 或 60000)，0 表示正常录制 (默认)。
+    bool timeLapseIntraOnly; ///< 延时录制的每个采样帧都编码为关键帧，默认 false。
+    bool timeLapseFullRateOnMotion; ///< 延时录制时检测到移动期间恢复正常帧率 (需要 motion=true)，默认 true。
+
+    int minFreeSpacePercent; ///< 可用空间低于该百分比时淘汰最早的录像，默认 10。
+    int storageCheckIntervalMs; ///< 自动检查存储空间的周期 (毫秒)，默认 600000 (10分钟)。
+
+    QString streamUrlTemplate; ///< 每路的推流地址，%1 替换为通道序号；为空时不推流 (默认)。
+
+    QString exportPath;      ///< 时间段导出文件的保存目录；为空时 (默认) 使用 `exportDir()` 的默认目录。
+
+    int metricsIntervalMs;   ///< 流水线计量的汇报周期 (毫秒)，默认 1000。
+    QString metricsDumpPath; ///< 计量导出文件 (Prometheus 文本格式)；为空时不导出。默认 "/tmp/video_surveillance.prom"。
+
+    bool recordOnStart;      ///< 无界面模式：摄像头打开后立即开始连续录制 (否则只做移动录制)。默认 true。
+    int retryIntervalMs;     ///< 无界面模式：重新打开不可用的摄像头、恢复中断的连续录制的周期 (毫秒)，默认 5000。
+
+    /**
+     * @brief 构造函数，所有参数取默认值。
+     */
+    MonitorConfig();
+
+    /**
+     * @brief 从 INI 格式的配置文件读取配置。
+     * @param path 配置文件路径。文件不存在时返回默认配置。
+     * @return 读取到的配置，超出范围的数值已修正为合法值。
+     */
+    static MonitorConfig load(const QString &path);
+
+    /**
+     * @brief 时间段导出文件的保存目录：`exportPath`，为空时为录像根目录下的隐藏目录 ".export"
+     *        (不会被录像索引收录，也不会被后台淘汰删除)。
+     */
+    QString exportDir() const;
+};
+
+#endif // MONITORCONFIG_H
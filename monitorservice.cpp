@@ -0,0 +1,383 @@
+/**
+ * @file monitorservice.cpp
+ * @brief 监控服务类 (MonitorService) 的实现文件。
+ *
+ * 常驻的采集和录制流水线：
+ * - 探测所有摄像头 (最多4个)，每个摄像头一个通道 (`CameraChannel`)，应用启动后即开始采集，
+ *   切换页面时摄像头和待命的编码器保持工作。
+ * - 手动录制和移动录制：录制文件按日期 (yyyyMMdd) 和时间 (HHmmss) 自动分文件夹和文件命名，
+ *   多摄像头时每一路写入日期目录下各自的 camN 子目录；各路录制线程在内部自动分段。
+ * - 集成存储管理 (`StorageManager`)，在开始录制前检查存储空间，空间不足时请求后台淘汰旧录像。
+ * - 流水线计量 (`TelemetryReporter`) 定期导出。
+ */
+
+#include "monitorservice.h"
+#include "camerachannel.h"     // 单路摄像头通道 (采集线程 + 录制线程)
+#include "recordingthread.h"   // 视频录制线程类 (录制帧率、自适应控制、写入统计)
+#include "storagemanager.h"    // 存储管理类
+#include "telemetryreporter.h" // 流水线计量的定期汇报
+#include "v4l2_wrapper.h"      // v4l2_enum_capture_devices
+
+#include <QDir>
+#include <QDebug>
+
+/**
+ * @brief MonitorService 的构造函数。
+ *
+ * 创建各路通道、存储管理器 (默认每10分钟自动检查一次空间) 和计量汇报。摄像头在 `startCapture()` 时才打开。
+ */
+MonitorService::MonitorService(const MonitorConfig &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_storageManager(nullptr)
+    , m_telemetry(nullptr)
+    , m_isRecording(false)
+    , m_recordingStartTime(QDateTime::currentDateTime())
+{
+    initCameraChannels();
+
+    // 初始化存储管理器 (StorageManager)
+    m_storageManager = new StorageManager(m_config.recordingPath, this);
+    m_storageManager->setMinFreeSpacePercent(m_config.minFreeSpacePercent); // 最小可用磁盘空间百分比阈值 (默认10%)
+    for (CameraChannel *channel : m_channels) {
+        channel->setCatalog(m_storageManager->catalog()); // 每个录像文件关闭并重命名后记入录像索引
+        // 录制线程报告写入的字节数 (估算剩余空间) 和正在写入的文件 (后台淘汰不会删除它)
+        RecordingThread *recorder = channel->recorder();
+        connect(recorder, &RecordingThread::bytesWritten, m_storageManager, &StorageManager::accountWrittenBytes);
+        connect(recorder, &RecordingThread::fileOpened, m_storageManager,
+                &StorageManager::recordingFileOpened, Qt::DirectConnection);
+        connect(recorder, &RecordingThread::fileClosed, m_storageManager,
+                &StorageManager::recordingFileClosed, Qt::DirectConnection);
+    }
+    // 空间不足时请求后台淘汰最早的录像 (淘汰线程忙时只更新目标)，再通知界面
+    connect(m_storageManager, &StorageManager::lowStorageSpace, this,
+            [this](qint64 availableBytes, qint64 totalBytes, double percent) {
+        qInfo() << "由于空间不足，请求后台清理最早的视频文件...";
+        m_storageManager->requestCleanup();
+        emit lowStorageSpace(availableBytes, totalBytes, percent);
+    });
+    connect(m_storageManager, &StorageManager::cleanupCompleted, this, &MonitorService::cleanupCompleted);
+    m_storageManager->startAutoCheck(m_config.storageCheckIntervalMs); // 默认每600000毫秒（10分钟）检查一次
+
+    // 流水线计量：每个周期汇总各路录制线程的计量，导出到文件 (Prometheus 文本格式，供 node_exporter 的 textfile collector 抓取)
+    m_telemetry = new TelemetryReporter(this);
+    for (CameraChannel *channel : m_channels) {
+        m_telemetry->addSource(channel->index(), channel->recorder()->metrics());
+    }
+    m_telemetry->setDumpPath(m_config.metricsDumpPath); // 为空时不导出
+    m_telemetry->start(m_config.metricsIntervalMs);
+}
+
+/**
+ * @brief 析构函数：应用退出时结束录制 (文件按时间段重命名) 并停止采集。
+ *
+ * 此时界面可能已开始销毁，不再发出任何信号。
+ */
+MonitorService::~MonitorService()
+{
+    blockSignals(true);
+    stopCapture();
+    m_telemetry->clearSources(); // 计量来源属于通道，通道随后作为子对象销毁
+}
+
+void MonitorService::setRawPreview(bool enable)
+{
+    for (CameraChannel *channel : m_channels) {
+        channel->setRawPreview(enable);
+    }
+}
+
+/**
+ * @brief 打开尚未在采集的摄像头并启动采集。
+ *
+ * 对每个未在采集的通道调用 `CameraChannel::startCapture()`：以非阻塞方式打开该通道的摄像头设备，
+ * 按配置的 `captureWidth` x `captureHeight` @ `captureFps` 协商像素格式、分辨率和帧率，开始视频流的捕获，
+ * 并让录制线程进入待命录制。某一路失败时其它摄像头照常工作，下一次调用时重试。
+ */
+bool MonitorService::startCapture()
+{
+    // 像素格式为0：由 v4l2_open() 在 NV12/YUYV/RGB565/MJPEG 中选出代价最低的格式
+    v4l2_params params = v4l2_params();
+    params.width = m_config.captureWidth;
+    params.height = m_config.captureHeight;
+    params.fps = m_config.captureFps;
+
+    int capturingCount = 0;
+    for (CameraChannel *channel : m_channels) {
+        if (channel->isCapturing() || channel->startCapture(params)) {
+            capturingCount++;
+        }
+    }
+    if (capturingCount == 0) {
+        return false; // 失败原因已由采集线程输出
+    }
+    qDebug() << "摄像头捕获已启动 (事件驱动采集线程)，摄像头数量:" << capturingCount << "/" << m_channels.size();
+    return true;
+}
+
+/**
+ * @brief 停止所有采集：先结束手动录制，再由各通道结束移动录制、待命录制并释放摄像头。
+ */
+void MonitorService::stopCapture()
+{
+    if (m_isRecording) {
+        qDebug() << "停止捕获时检测到正在录制，将先停止录制。";
+        stopRecording();
+    }
+    for (CameraChannel *channel : m_channels) {
+        channel->stopCapture(); // 同时结束该路的移动录制
+    }
+    if (!m_motionChannels.isEmpty()) {
+        m_motionChannels.clear();
+        emit motionRecordingChanged(0);
+    }
+    qDebug() << "摄像头捕获已停止并清理资源。";
+}
+
+/**
+ * @brief 探测摄像头并初始化每个摄像头的通道。
+ *
+ * 一个摄像头也找不到时 (例如摄像头稍后才插入) 退回 "/dev/video0"，保持单摄像头时的原有行为。
+ * 预览默认暂停，监控页面显示时才恢复。
+ */
+void MonitorService::initCameraChannels()
+{
+    char paths[MonitorConfig::MAX_CAMERAS][V4L2_DEVICE_PATH_MAX];
+    QStringList devices;
+    int found = v4l2_enum_capture_devices(paths, qBound(1, m_config.maxCameras, int(MonitorConfig::MAX_CAMERAS)));
+    for (int i = 0; i < found; i++) {
+        devices << QString::fromLocal8Bit(paths[i]);
+    }
+    if (devices.isEmpty()) {
+        devices << "/dev/video0";
+    }
+
+    for (int i = 0; i < devices.size(); i++) {
+        // 创建该路的通道 (采集线程 + 录制线程)
+        CameraChannel *channel = new CameraChannel(i, devices.at(i), this);
+        channel->setPreEventSeconds(m_config.preEventSeconds); // 采集期间待命，录像包含按下录制前的画面
+        channel->setMotionDetection(m_config.motionRecording); // 检测到移动时自动录制
+        channel->setPreviewPaused(true);                       // 没有页面显示时 (以及无界面模式) 不转换预览帧
+        channel->recorder()->setRecordFrameRate(m_config.recordFps); // 录制帧率与预览帧率互相独立
+        channel->recorder()->setAdaptiveRateControl(m_config.adaptiveRateControl); // 队列积压前先降码率和帧率，不丢帧
+        channel->setSubstream(m_config.substream); // 子码流: 录像缩略图和远程预览
+        if (m_config.timeLapseIntervalMs > 0) {
+            // 延时录制：只录采样帧，移动期间恢复全帧率 (移动录制的事件文件以采样画面开头)
+            RecordingThread::TimeLapseSettings lapse;
+            lapse.intervalMs = m_config.timeLapseIntervalMs;
+            lapse.intraOnly = m_config.timeLapseIntraOnly;
+            lapse.fullRateOnMotion = m_config.timeLapseFullRateOnMotion;
+            channel->recorder()->setTimeLapse(true, lapse);
+        }
+        // 推流直接复用录制线程 (或子码流) 编码出的数据包；远程预览默认推送低分辨率子码流以节省上行带宽
+        if (!m_config.streamUrlTemplate.isEmpty()) {
+            channel->setStreamUrl(m_config.streamUrlTemplate.arg(i),
+                                  m_config.substream ? CameraChannel::SubStream : CameraChannel::MainStream);
+        }
+        m_channels.append(channel);
+
+        connect(channel, &CameraChannel::captureError, this, [this](int index, const QString &errorMsg) {
+            qWarning() << "摄像头采集错误 (通道" << index << "):" << errorMsg;
+            emit captureError(index, errorMsg);
+            if (m_isRecording) {
+                stopRecording(); // 采集已中断，结束当前录制文件
+            }
+            onMotionStopped(index);
+        });
+        // 录制出错时停止当前的录制过程
+        connect(channel, &CameraChannel::recordError, this, [this](int index, const QString &errorString) {
+            qWarning() << "视频录制错误 (通道" << index << "):" << errorString;
+            emit recordError(index, errorString);
+            stopRecording();
+            onMotionStopped(index);
+        });
+        // 录制线程在内部完成自动分段后发出此信号 (录制不中断)
+        connect(channel, &CameraChannel::segmentReached, this, [](int index, const QString &filePath) {
+            qInfo() << "自动分段 (通道" << index << "): 已完成" << filePath;
+        });
+        // 移动开始/结束 -> 开始/结束该路的事件录制
+        connect(channel, &CameraChannel::motionStarted, this, &MonitorService::onMotionStarted);
+        connect(channel, &CameraChannel::motionStopped, this, &MonitorService::onMotionStopped);
+    }
+    qDebug() << "摄像头通道初始化完成:" << devices;
+}
+
+/**
+ * @brief 检查存储空间，不足时请求后台淘汰最早的录像文件。
+ * @return 空间足够，或者有可以淘汰的旧录像 (淘汰在后台进行，录制不等待) 时返回 true。
+ */
+bool MonitorService::ensureStorageSpace()
+{
+    if (m_storageManager->checkStorageSpace()) { // checkStorageSpace 返回false表示空间不足
+        return true;
+    }
+    qDebug() << "存储空间不足，请求后台清理旧文件...";
+    m_storageManager->requestCleanup();
+    // 没有可以删除的旧录像时空间不会再增加
+    if (!m_storageManager->canFreeSpace()) {
+        qWarning() << "存储空间不足且没有可以清理的旧录像，无法开始录制。";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 生成 (并创建) 某一路在 startTime 开始的录像目录。
+ *
+ * 目录为 <根目录>/yyyyMMdd；单摄像头时文件直接放在日期目录下，多摄像头时每一路使用 camN 子目录，
+ * 避免同一秒开始的文件重名，也便于在历史页面按摄像头浏览。初始文件名 record_HHmmss 由通道根据开始时间生成。
+ */
+QString MonitorService::channelRecordingDir(const CameraChannel *channel, const QDateTime &startTime)
+{
+    const QString dateDirName = startTime.toString("yyyyMMdd"); // 日期目录，格式：年年月月日日
+
+    // 确保根录制路径存在
+    QDir recordRootDir(m_config.recordingPath);
+    if (!recordRootDir.exists()) {
+        qInfo() << "根录制目录 " << m_config.recordingPath << " 不存在，尝试创建。";
+        recordRootDir.mkpath("."); // mkpath会创建所有必需的父目录
+    }
+
+    // 确保日期子目录存在，如果不存在则创建它
+    QDir dateDir(m_config.recordingPath + "/" + dateDirName);
+    if (!dateDir.exists()) {
+        qInfo() << "日期子目录 " << dateDirName << " 不存在，尝试创建。";
+        recordRootDir.mkdir(dateDirName); // 在根录制目录下创建日期子目录
+    }
+
+    QString dirPath = dateDir.absolutePath();
+    if (m_channels.size() > 1) {
+        const QString camDirName = QString("cam%1").arg(channel->index());
+        dateDir.mkpath(camDirName);
+        dirPath += "/" + camDirName;
+    }
+    return dirPath;
+}
+
+/**
+ * @brief 某一路检测到移动：未在手动录制时开始该路的事件录制。
+ * @param index 通道序号。
+ *
+ * 通道处于待命录制，事件文件以预录缓冲区中移动开始前的画面开头。
+ * 手动录制期间所有通道都已在录制，移动不再单独处理。存储空间不足时只输出警告。
+ */
+void MonitorService::onMotionStarted(int index)
+{
+    CameraChannel *channel = m_channels.value(index);
+    if (!channel || m_isRecording || channel->isRecording() || !channel->isCapturing()) {
+        return;
+    }
+    if (!ensureStorageSpace()) {
+        qWarning() << "通道" << index << "检测到移动，但存储空间不足，跳过录制";
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    if (channel->startRecording(channelRecordingDir(channel, now), now)) {
+        qInfo() << "通道" << index << "检测到移动，开始录制";
+        m_motionChannels.insert(index);
+        emit motionRecordingChanged(m_motionChannels.size());
+    }
+}
+
+/**
+ * @brief 某一路移动结束 (或出错)：结束由移动触发的该路录制，并按时间段重命名文件。
+ * @param index 通道序号。不是由移动触发的录制 (手动录制) 不受影响。
+ */
+void MonitorService::onMotionStopped(int index)
+{
+    if (!m_motionChannels.remove(index)) {
+        return;
+    }
+    if (CameraChannel *channel = m_channels.value(index)) {
+        const QString savedFile = channel->stopRecording(QDateTime::currentDateTime());
+        qInfo() << "通道" << index << "移动结束，录像已保存:" << savedFile;
+    }
+    emit motionRecordingChanged(m_motionChannels.size());
+}
+
+/**
+ * @brief 开始手动录制。
+ *
+ * 1. 已在录制中时直接返回 true。
+ * 2. 检查存储空间，不足且没有可以淘汰的旧录像时返回 false。
+ * 3. 为每个正在采集的通道在 `channelRecordingDir()` 下创建 record_HHmmss.mp4 并开始录制；
+ *    帧尺寸由通道从驱动实际生效的格式取得。各路录制线程在内部自动分段 (默认30分钟)。
+ * 4. 正在进行移动录制的通道直接沿用当前文件，之后由手动录制管理。
+ */
+bool MonitorService::startRecording(QString *errorMsg)
+{
+    if (m_isRecording) {
+        qDebug() << "尝试开始录制，但已处于录制状态。";
+        return true;
+    }
+
+    qDebug() << "请求开始录制视频...";
+    if (!ensureStorageSpace()) {
+        if (errorMsg) {
+            *errorMsg = "TF卡存储空间不足，无法开始录制。\n没有可以清理的旧视频文件。";
+        }
+        return false;
+    }
+
+    m_recordingStartTime = QDateTime::currentDateTime();
+    int startedCount = 0;
+    for (CameraChannel *channel : m_channels) {
+        if (!channel->isCapturing()) {
+            continue;
+        }
+        // 每一路录制线程各自在关键帧处分段；各路同时开始且分段时长相同，文件时间段保持一致
+        if (channel->startRecording(channelRecordingDir(channel, m_recordingStartTime), m_recordingStartTime)) {
+            startedCount++;
+        }
+    }
+    const bool hadMotion = !m_motionChannels.isEmpty();
+    m_motionChannels.clear();
+    if (hadMotion) {
+        emit motionRecordingChanged(0);
+    }
+
+    if (startedCount == 0) {
+        qWarning() << "无法启动视频录制。";
+        if (errorMsg) {
+            *errorMsg = "无法开始录制视频。请检查日志获取更多信息。";
+        }
+        return false;
+    }
+    qInfo() << "视频录制已成功启动，摄像头数量:" << startedCount;
+    m_isRecording = true;
+    emit recordingStarted(startedCount);
+    return true;
+}
+
+/**
+ * @brief 结束手动录制。
+ *
+ * 通知每一路录制线程完成当前文件的写入，并根据录制开始和结束时间（时:分）把文件重命名为 "HH:mm-HH:mm.mp4"。
+ * 手动录制结束时仍在移动的通道立即开始移动录制，不必等到下一次移动开始。
+ */
+void MonitorService::stopRecording()
+{
+    if (!m_isRecording) {
+        qDebug() << "尝试停止录制，但当前未在录制状态。";
+        return;
+    }
+    qInfo() << "请求停止视频录制...";
+
+    const QDateTime recordingEndTime = QDateTime::currentDateTime();
+    QStringList savedFiles;
+    for (CameraChannel *channel : m_channels) {
+        const QString savedFile = channel->stopRecording(recordingEndTime);
+        if (!savedFile.isEmpty()) {
+            savedFiles << savedFile;
+        }
+    }
+    m_isRecording = false;
+    emit recordingStopped(savedFiles);
+
+    for (CameraChannel *channel : m_channels) {
+        if (channel->isMotionActive()) {
+            onMotionStarted(channel->index());
+        }
+    }
+    qInfo() << "录制流程已停止。视频已保存到:" << savedFiles;
+}
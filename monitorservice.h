@@ -0,0 +1,191 @@
+#ifndef MONITORSERVICE_H
+#define MONITORSERVICE_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include "monitorconfig.h" // 流水线配置
+
+class CameraChannel;     // 单路摄像头通道类，组合一个采集线程和一个录制线程
+class StorageManager;    // 存储管理类，负责监控和管理录像文件的存储空间
+class TelemetryReporter; // 流水线计量的定期汇报 (叠加层、导出文件)
+
+/**
+ * @brief 监控服务类 (MonitorService)
+ *
+ * 采集和录制流水线的常驻部分，由 `MainWindow` 创建并持有，生命周期与应用程序相同：
+ * - 探测摄像头，为每个摄像头创建一个 `CameraChannel` (采集线程 + 录制线程)，`startCapture()` 后一直采集，
+ *   录制线程在采集期间保持待命 (编码器已打开)。切换页面不再关闭摄像头和编码器，
+ *   进入监控页面时不需要重新打开设备、申请缓冲区和打开编码器。
+ * - 手动录制、移动录制、存储空间检查和流水线计量都在这里进行，离开监控页面后录制照常继续。
+ * - `MonitorPage` 只是一个视图：显示时恢复各路预览、隐藏时暂停 (`CameraChannel::setPreviewPaused()`)，
+ *   通过本类的接口开始/停止录制，并根据本类的信号更新界面。
+ *
+ * 本类不依赖任何界面类，错误和状态变化都通过信号报告，由界面决定如何提示。
+ * 无界面模式 (`HeadlessRecorder`) 在 `QCoreApplication` 下直接使用本类，预览始终保持暂停。
+ */
+class MonitorService : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数：探测摄像头并创建各路通道、存储管理器和计量汇报 (不打开摄像头)。
+     * @param config 采集、录制、存储、推流和计量参数。
+     * @param parent 父对象指针
+     */
+    explicit MonitorService(const MonitorConfig &config, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数：结束录制并停止所有采集 (不再发出信号)。
+     */
+    ~MonitorService();
+
+    /**
+     * @brief 让各路采集线程为 GPU 预览提供原始帧，须在 `startCapture()` 之前调用。
+     */
+    void setRawPreview(bool enable);
+
+    /**
+     * @brief 打开尚未在采集的摄像头并启动采集 (待命录制一并启动)。可以重复调用，已在采集的通道不受影响。
+     * @return 至少有一路正在采集时返回 true；否则返回 false。
+     */
+    bool startCapture();
+
+    /**
+     * @brief 结束录制，停止所有通道的采集并释放摄像头资源。
+     */
+    void stopCapture();
+
+    /**
+     * @brief 开始手动录制：每个正在采集的通道各写一个文件 (正在进行的移动录制改由手动录制管理)。
+     * @param errorMsg 失败时接收错误描述，可以为 nullptr。
+     * @return 至少有一路开始录制时返回 true。成功后发出 `recordingStarted()`。
+     */
+    bool startRecording(QString *errorMsg = nullptr);
+
+    /**
+     * @brief 结束手动录制，各路文件按时间段重命名。未在手动录制时不执行任何操作。
+     *        结束后发出 `recordingStopped()`；仍在移动的通道随即开始移动录制。
+     */
+    void stopRecording();
+
+    /**
+     * @brief 构造时使用的配置。
+     */
+    const MonitorConfig &config() const { return m_config; }
+
+    /**
+     * @brief 是否正在手动录制。
+     */
+    bool isRecording() const { return m_isRecording; }
+
+    /**
+     * @brief 当前手动录制的开始时间。
+     */
+    QDateTime recordingStartTime() const { return m_recordingStartTime; }
+
+    /**
+     * @brief 正在进行移动录制 (由移动触发、非手动) 的通道数。
+     */
+    int motionRecordingCount() const { return m_motionChannels.size(); }
+
+    /**
+     * @brief 所有通道，按通道序号排列。通道由本对象拥有。
+     */
+    const QList<CameraChannel *> &channels() const { return m_channels; }
+
+    /**
+     * @brief 存储管理器，历史和回放页面通过它查询录像索引。
+     */
+    StorageManager *storageManager() const { return m_storageManager; }
+
+    /**
+     * @brief 流水线计量汇报，界面可以连接 `TelemetryReporter::sampled()` 显示叠加层。
+     */
+    TelemetryReporter *telemetry() const { return m_telemetry; }
+
+signals:
+    /**
+     * @brief 手动录制已开始。
+     * @param channelCount 开始录制的通道数。
+     */
+    void recordingStarted(int channelCount);
+
+    /**
+     * @brief 手动录制已结束 (用户停止、采集或录制出错)。
+     * @param savedFiles 各路最终的文件路径。
+     */
+    void recordingStopped(const QStringList &savedFiles);
+
+    /**
+     * @brief 正在进行的移动录制的通道数发生变化。
+     */
+    void motionRecordingChanged(int channelCount);
+
+    /**
+     * @brief 某一路采集发生不可恢复的错误，随后结束正在进行的录制。
+     */
+    void captureError(int index, const QString &errorMsg);
+
+    /**
+     * @brief 某一路录制线程报告错误，随后结束正在进行的录制。
+     */
+    void recordError(int index, const QString &errorMsg);
+
+    /**
+     * @brief 存储空间低于阈值 (已请求后台淘汰旧录像)，参数同 `StorageManager::lowStorageSpace()`。
+     */
+    void lowStorageSpace(qint64 availableBytes, qint64 totalBytes, double percent);
+
+    /**
+     * @brief 后台淘汰完成，参数同 `StorageManager::cleanupCompleted()`。
+     */
+    void cleanupCompleted(const QString &path, qint64 freedBytes);
+
+private:
+    /**
+     * @brief 探测摄像头并为每个摄像头创建一个通道。
+     *
+     * 通过 `v4l2_enum_capture_devices()` 枚举采集设备 (最多 `MonitorConfig::maxCameras` 个，找不到时退回 "/dev/video0")，
+     * 按本类的采集、录制参数配置通道，并连接通道的错误、分段和移动信号。
+     */
+    void initCameraChannels();
+
+    /**
+     * @brief 检查存储空间，不足时请求后台淘汰最早的录像 (不等待)。
+     * @return 空间足够或有可以淘汰的旧录像时返回 true。
+     */
+    bool ensureStorageSpace();
+
+    /**
+     * @brief 生成并创建某一路在 startTime 开始录制时使用的目录。
+     * @return 目录的绝对路径 (<根目录>/yyyyMMdd，多摄像头时再加 /camN)。
+     */
+    QString channelRecordingDir(const CameraChannel *channel, const QDateTime &startTime);
+
+    /**
+     * @brief 某一路检测到移动，未在手动录制时开始该路的移动录制。
+     */
+    void onMotionStarted(int index);
+
+    /**
+     * @brief 某一路移动结束 (或出错)，停止由移动触发的该路录制。
+     */
+    void onMotionStopped(int index);
+
+    MonitorConfig m_config;            ///< 采集、录制、存储、推流和计量参数。
+    QList<CameraChannel *> m_channels; ///< 每个摄像头一个通道 (采集线程 + 录制线程)，按通道序号排列。
+    StorageManager *m_storageManager;  ///< 存储管理器。
+    TelemetryReporter *m_telemetry;    ///< 定期读取各路录制线程的计量并导出。
+
+    bool m_isRecording;                ///< 是否正在手动录制。
+    QDateTime m_recordingStartTime;    ///< 当前手动录制的开始时间。
+    QSet<int> m_motionChannels;        ///< 正在进行移动录制 (由移动触发、非手动) 的通道序号。
+};
+
+#endif // MONITORSERVICE_H
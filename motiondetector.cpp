@@ -0,0 +1,85 @@
+/**
+ * @file motiondetector.cpp
+ * @brief 移动侦测 (MotionDetector) 的实现文件。
+ *
+ * 缩小和块 SAD 内核在 pixel_convert.c 中实现 (运行时选择标量 / SSE2 / NEON)，
+ * 这里只负责区域判断和移动状态的迟滞。
+ */
+
+#include "motiondetector.h"
+#include "pixel_convert.h" // 亮度平面缩小和块 SAD 内核
+
+#include <QtGlobal>         // qMax
+
+MotionDetector::MotionDetector()
+    : m_current(ANALYSIS_WIDTH * ANALYSIS_HEIGHT)
+    , m_reference(ANALYSIS_WIDTH * ANALYSIS_HEIGHT)
+    , m_zoneSads(ZONE_COLUMNS * ZONE_ROWS)
+    , m_hasReference(false)
+    , m_motion(false)
+    , m_activeFrames(0)
+    , m_activeZones(0)
+    , m_lastMotionUs(0)
+{
+}
+
+void MotionDetector::configure(const Settings &settings)
+{
+    m_settings = settings;
+    reset();
+}
+
+void MotionDetector::reset()
+{
+    m_hasReference = false;
+    m_motion = false;
+    m_activeFrames = 0;
+    m_activeZones = 0;
+}
+
+MotionDetector::Change MotionDetector::analyze(const uint8_t *luma, int stride, int width, int height, long long timestampUs)
+{
+    if (!luma || width < ANALYSIS_WIDTH || height < ANALYSIS_HEIGHT) {
+        return NoChange;
+    }
+
+    pixconv_downscale_luma(luma, stride, width, height,
+                           m_current.data(), ANALYSIS_WIDTH, ANALYSIS_WIDTH, ANALYSIS_HEIGHT);
+    if (!m_hasReference) {
+        m_reference.swap(m_current); // 第一帧只建立参考图
+        m_hasReference = true;
+        return NoChange;
+    }
+
+    pixconv_block_sad16(m_current.constData(), m_reference.constData(), ANALYSIS_WIDTH,
+                        ANALYSIS_WIDTH, ANALYSIS_HEIGHT, ZONE_ROWS, m_zoneSads.data());
+    m_reference.swap(m_current); // 下一帧与本帧比较
+
+    // 区域 SAD 与 "平均每像素差 x 区域像素数" 比较，避免逐像素除法
+    const uint32_t zonePixels = 16 * (ANALYSIS_HEIGHT / ZONE_ROWS);
+    const uint32_t zoneThreshold = (uint32_t)qMax(0, m_settings.pixelThreshold) * zonePixels;
+    const bool masked = m_settings.zoneMask.size() == m_zoneSads.size();
+    int active = 0;
+    for (int i = 0; i < m_zoneSads.size(); i++) {
+        if ((!masked || m_settings.zoneMask.at(i)) && m_zoneSads.at(i) > zoneThreshold) {
+            active++;
+        }
+    }
+    m_activeZones = active;
+
+    if (active >= qMax(1, m_settings.minActiveZones)) {
+        m_lastMotionUs = timestampUs;
+        if (!m_motion && ++m_activeFrames >= START_FRAMES) {
+            m_motion = true;
+            return MotionStarted;
+        }
+        return NoChange;
+    }
+
+    m_activeFrames = 0;
+    if (m_motion && timestampUs - m_lastMotionUs >= (long long)m_settings.holdMs * 1000) {
+        m_motion = false;
+        return MotionStopped;
+    }
+    return NoChange;
+}
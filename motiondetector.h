@@ -0,0 +1,95 @@
+#ifndef MOTIONDETECTOR_H
+#define MOTIONDETECTOR_H
+
+#include <QVector>
+#include <stdint.h>
+
+/**
+ * @brief 低开销移动侦测 (MotionDetector)
+ *
+ * 直接分析录制线程已经转换好的 YUV420P 亮度平面，不额外做整帧转换：
+ * - 先把 Y 平面按整数倍块平均缩小为 ANALYSIS_WIDTH x ANALYSIS_HEIGHT (160x120)，块平均同时抑制传感器噪声。
+ * - 与上一幅缩小图逐块计算绝对差之和 (SAD，`pixconv_block_sad16()`，SSE2 / NEON 向量化)，
+ *   画面划分为 ZONE_COLUMNS x ZONE_ROWS 个区域 (每个 16x15 像素)。
+ * - 平均每像素亮度差超过阈值的区域为活动区域，屏蔽区域 (例如窗外摇动的树) 不参与判断；
+ *   活动区域数达到下限即为本帧有移动。
+ * - 连续 START_FRAMES 帧有移动才报告移动开始，最后一次有移动后静止 holdMs 毫秒才报告移动结束，
+ *   避免短暂的噪声或停顿让录像频繁开关。
+ *
+ * 640x480 输入时每帧只读取一遍 Y 平面 (约300KB) 并处理约19KB的缩小图。只在录制线程中使用，不是线程安全的。
+ */
+class MotionDetector
+{
+public:
+    /**
+     * @brief 侦测参数。
+     */
+    struct Settings {
+        int pixelThreshold = 6;   ///< 区域内平均每像素亮度差 (0~255) 超过该值时为活动区域。
+        int minActiveZones = 2;   ///< 一帧中至少多少个活动区域才算有移动。
+        int holdMs = 5000;        ///< 最后一次检测到移动后保持 "移动中" 的时间 (毫秒)。
+        QVector<bool> zoneMask;   ///< 按行优先排列的 ZONE_COLUMNS x ZONE_ROWS 个区域，false 表示屏蔽；为空时全部参与。
+    };
+
+    /**
+     * @brief `analyze()` 的结果：移动状态是否发生变化。
+     */
+    enum Change {
+        NoChange,      ///< 状态不变。
+        MotionStarted, ///< 由静止变为移动。
+        MotionStopped  ///< 由移动变为静止。
+    };
+
+    static const int ANALYSIS_WIDTH = 160;  ///< 缩小图宽度 (16 的倍数)。
+    static const int ANALYSIS_HEIGHT = 120; ///< 缩小图高度。
+    static const int ZONE_COLUMNS = ANALYSIS_WIDTH / 16; ///< 区域列数 (块 SAD 的块宽为16像素)。
+    static const int ZONE_ROWS = 8;         ///< 区域行数。
+
+    MotionDetector();
+
+    /**
+     * @brief 设置侦测参数并清除当前状态 (下一帧重新建立参考图)。
+     */
+    void configure(const Settings &settings);
+
+    /**
+     * @brief 清除参考图和移动状态，例如开始新的录制会话时。
+     */
+    void reset();
+
+    /**
+     * @brief 分析一帧亮度平面。
+     * @param luma Y 平面 (例如 `AVFrame::data[0]`)。
+     * @param stride Y 平面行跨度 (字节)。
+     * @param width 图像宽度，小于 ANALYSIS_WIDTH 时不做侦测。
+     * @param height 图像高度，小于 ANALYSIS_HEIGHT 时不做侦测。
+     * @param timestampUs 采集时间戳 (微秒)，用于计算保持时间。
+     * @return 移动状态的变化。
+     */
+    Change analyze(const uint8_t *luma, int stride, int width, int height, long long timestampUs);
+
+    /**
+     * @brief 当前是否处于 "移动中" 状态。
+     */
+    bool isMotion() const { return m_motion; }
+
+    /**
+     * @brief 最近一帧的活动区域数 (用于调试和调参)。
+     */
+    int activeZones() const { return m_activeZones; }
+
+private:
+    static const int START_FRAMES = 2; ///< 连续多少帧有移动才报告移动开始。
+
+    Settings m_settings;            ///< 侦测参数。
+    QVector<uint8_t> m_current;     ///< 当前帧的缩小图。
+    QVector<uint8_t> m_reference;   ///< 上一帧的缩小图。
+    QVector<uint32_t> m_zoneSads;   ///< 每个区域的 SAD。
+    bool m_hasReference;            ///< 参考图是否有效。
+    bool m_motion;                  ///< 是否处于 "移动中" 状态。
+    int m_activeFrames;             ///< 连续有移动的帧数。
+    int m_activeZones;              ///< 最近一帧的活动区域数。
+    long long m_lastMotionUs;       ///< 最后一次检测到移动的采集时间戳 (微秒)。
+};
+
+#endif // MOTIONDETECTOR_H
@@ -0,0 +1,401 @@
+/**
+ * @file networkstreamer.cpp
+ * @brief 网络推流 (NetworkStreamer) 的实现文件。
+ *
+ * 录制线程侧 (`PacketSink` 回调) 只在互斥锁下操作队列，所有连接、握手和发送都在推流线程中完成。
+ */
+
+#include "networkstreamer.h"
+
+#include <QDebug>
+#include <chrono>
+
+extern "C" {
+#include <libavutil/dict.h>
+}
+
+/**
+ * @brief 当前 steady_clock 时刻 (毫秒)。
+ */
+static long long steadyNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 把 FFmpeg 错误码转换为可读的字符串。
+ */
+static QString ffmpegError(int errnum)
+{
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(errnum, errbuf, sizeof(errbuf));
+    return QString::fromUtf8(errbuf);
+}
+
+/**
+ * @brief 按推流地址的协议选择封装格式。
+ */
+static const char *muxerForUrl(const QString &url)
+{
+    if (url.startsWith("rtsp://")) {
+        return "rtsp";
+    }
+    if (url.startsWith("rtp://")) {
+        return "rtp";
+    }
+    // srt:// udp:// tcp:// 等字节流协议使用 MPEG-TS (SPS/PPS 由封装器插入到每个关键帧前)
+    return "mpegts";
+}
+
+NetworkStreamer::NetworkStreamer(const QString &url, QObject *parent)
+    : QThread(parent)
+    , m_url(url)
+    , m_stopRequested(0)
+    , m_droppedPackets(0)
+    , m_queueLimit(DEFAULT_QUEUE_PACKETS)
+    , m_waitKeyFrame(true)
+    , m_pendingParams(nullptr)
+    , m_pendingTimeBase({1, 90000})
+    , m_streamEnded(false)
+    , m_params(nullptr)
+    , m_timeBase({1, 90000})
+    , m_output(nullptr)
+    , m_tsOffset(AV_NOPTS_VALUE)
+    , m_lastDts(AV_NOPTS_VALUE)
+    , m_ioDeadlineMs(0)
+    , m_retryAtMs(0)
+    , m_closing(false)
+    , m_keyFrameAsked(false)
+{
+}
+
+NetworkStreamer::~NetworkStreamer()
+{
+    stopStreaming();
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_queue.isEmpty()) {
+        AVPacket *packet = m_queue.dequeue();
+        av_packet_free(&packet);
+    }
+    avcodec_parameters_free(&m_pendingParams);
+    avcodec_parameters_free(&m_params);
+}
+
+void NetworkStreamer::setQueueLimit(int packets)
+{
+    if (packets < 1) {
+        qWarning() << "无效的推流队列上限:" << packets;
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_queueLimit = packets;
+}
+
+void NetworkStreamer::startStreaming()
+{
+    if (isRunning()) {
+        return;
+    }
+    m_stopRequested.store(0);
+    m_retryAtMs = 0; // 线程尚未启动，可以直接重置推流线程的状态
+    start();
+    qDebug() << "推流线程已启动:" << m_url;
+}
+
+void NetworkStreamer::stopStreaming()
+{
+    if (!isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested.storeRelease(1); // 中断回调随即让正在进行的网络操作返回
+        m_condition.wakeAll();
+    }
+    wait();
+    qDebug() << "推流线程已停止:" << m_url;
+}
+
+void NetworkStreamer::streamStarted(const AVCodecParameters *parameters, AVRational timeBase)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_pendingParams) {
+        m_pendingParams = avcodec_parameters_alloc();
+    }
+    if (!m_pendingParams || avcodec_parameters_copy(m_pendingParams, parameters) < 0) {
+        avcodec_parameters_free(&m_pendingParams);
+        qWarning() << "推流: 无法复制编码参数";
+        return;
+    }
+    m_pendingTimeBase = timeBase;
+    m_streamEnded = false;
+    dropQueueLocked(); // 上一次编码残留的数据包不能接在新参数之后发送
+    m_condition.wakeAll();
+}
+
+void NetworkStreamer::consumePacket(const AVPacket *packet)
+{
+    const bool keyPacket = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    bool needKeyFrame = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_waitKeyFrame && !keyPacket) {
+            m_droppedPackets.fetchAndAddRelaxed(1);
+            return; // 不是从关键帧开始的数据包无法解码
+        }
+        if (m_queue.size() >= m_queueLimit) {
+            // 客户端跟不上：整个队列作废，从下一个关键帧重新开始，不让积压的延迟越来越大
+            dropQueueLocked();
+            needKeyFrame = true;
+            if (!keyPacket) {
+                m_droppedPackets.fetchAndAddRelaxed(1);
+            }
+        }
+        if (!m_waitKeyFrame || keyPacket) {
+            AVPacket *ref = av_packet_clone(packet); // 只增加缓冲区引用，不复制压缩数据
+            if (ref) {
+                m_queue.enqueue(ref);
+                m_waitKeyFrame = false;
+                m_condition.wakeOne();
+            }
+        }
+    }
+    if (needKeyFrame) {
+        emit keyFrameNeeded();
+    }
+}
+
+void NetworkStreamer::streamStopped()
+{
+    QMutexLocker locker(&m_mutex);
+    m_streamEnded = true;
+    m_condition.wakeAll();
+}
+
+void NetworkStreamer::dropQueueLocked()
+{
+    m_droppedPackets.fetchAndAddRelaxed(m_queue.size());
+    while (!m_queue.isEmpty()) {
+        AVPacket *packet = m_queue.dequeue();
+        av_packet_free(&packet);
+    }
+    m_waitKeyFrame = true;
+}
+
+int NetworkStreamer::interruptCallback(void *opaque)
+{
+    NetworkStreamer *self = static_cast<NetworkStreamer *>(opaque);
+    // 断开连接时不因停止请求中断，让流尾 (RTSP 的 TEARDOWN) 有机会在短超时内发出
+    if (!self->m_closing && self->m_stopRequested.loadAcquire()) {
+        return 1;
+    }
+    return steadyNowMs() > self->m_ioDeadlineMs ? 1 : 0;
+}
+
+void NetworkStreamer::armIoTimeout()
+{
+    m_ioDeadlineMs = steadyNowMs() + IO_TIMEOUT_MS;
+}
+
+/**
+ * @brief 推流线程主循环。
+ *
+ * 1. 在 `m_condition` 上等待数据包、编码参数变化或停止请求。
+ * 2. 编码参数变化 (新的录制会话) 或编码器关闭时断开当前连接。
+ * 3. 未连接且已到重连时刻时连接并写入流头；连接失败则丢弃队列，到下一个重连时刻再试。
+ * 4. 发送数据包；发送失败时断开并等待重连。
+ */
+void NetworkStreamer::run()
+{
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        emit streamError("推流: 无法分配数据包");
+        return;
+    }
+
+    while (!m_stopRequested.loadAcquire()) {
+        bool havePacket = false;
+        bool disconnect = false;
+        bool streamEnded = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stopRequested.loadAcquire() && m_queue.isEmpty() && !m_pendingParams
+                   && !(m_streamEnded && m_output)) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_stopRequested.loadAcquire()) {
+                break;
+            }
+            if (m_pendingParams) {
+                // 新的录制会话 (编码参数可能变化)：取走参数，重新连接
+                avcodec_parameters_free(&m_params);
+                m_params = m_pendingParams;
+                m_pendingParams = nullptr;
+                m_timeBase = m_pendingTimeBase;
+                disconnect = true;
+            }
+            streamEnded = m_streamEnded;
+            if (!m_queue.isEmpty()) {
+                AVPacket *queued = m_queue.dequeue();
+                av_packet_move_ref(packet, queued);
+                av_packet_free(&queued);
+                havePacket = true;
+            }
+        }
+
+        if ((disconnect || streamEnded) && m_output) {
+            closeOutput(true);
+            qDebug() << "推流已断开:" << m_url;
+        }
+        if (!havePacket) {
+            continue;
+        }
+
+        const bool keyPacket = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+        if (keyPacket) {
+            m_keyFrameAsked = false;
+        }
+        if (!m_output) {
+            // 只在关键帧处连接，观看端从第一包就能解码；未到重连时刻时丢弃
+            const bool canConnect = m_params && !streamEnded && steadyNowMs() >= m_retryAtMs;
+            QString errorMsg;
+            if (!canConnect || !keyPacket || !openOutput(&errorMsg)) {
+                av_packet_unref(packet);
+                m_droppedPackets.fetchAndAddRelaxed(1);
+                {
+                    QMutexLocker locker(&m_mutex);
+                    dropQueueLocked(); // 队列中剩下的数据包依赖刚丢弃的这一包
+                }
+                if (!errorMsg.isEmpty()) {
+                    qWarning() << "推流连接失败:" << m_url << errorMsg;
+                    m_retryAtMs = steadyNowMs() + RECONNECT_INTERVAL_MS;
+                    emit streamError(errorMsg);
+                } else if (canConnect && !m_keyFrameAsked) {
+                    m_keyFrameAsked = true; // 可以连接了，请求编码器尽快给出关键帧
+                    emit keyFrameNeeded();
+                }
+                continue;
+            }
+            qDebug() << "推流已连接:" << m_url;
+        }
+
+        if (!sendPacket(packet)) {
+            const QString errorMsg = QString("推流发送失败: %1").arg(m_url);
+            qWarning() << errorMsg;
+            closeOutput(false);
+            m_retryAtMs = steadyNowMs() + RECONNECT_INTERVAL_MS;
+            {
+                QMutexLocker locker(&m_mutex);
+                dropQueueLocked();
+            }
+            emit streamError(errorMsg);
+        }
+    }
+
+    closeOutput(true);
+    av_packet_free(&packet);
+}
+
+bool NetworkStreamer::openOutput(QString *errorMsg)
+{
+    const char *formatName = muxerForUrl(m_url);
+    const QByteArray url = m_url.toUtf8();
+    int ret = avformat_alloc_output_context2(&m_output, nullptr, formatName, url.constData());
+    if (ret < 0 || !m_output) {
+        *errorMsg = QString("无法创建推流输出 (%1): %2").arg(formatName).arg(ffmpegError(ret));
+        m_output = nullptr;
+        return false;
+    }
+    // 连接和发送都可能在网络异常时长时间阻塞：用中断回调实现超时和立即停止
+    m_output->interrupt_callback.callback = interruptCallback;
+    m_output->interrupt_callback.opaque = this;
+
+    AVStream *stream = avformat_new_stream(m_output, nullptr);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, m_params) < 0) {
+        *errorMsg = "无法创建推流视频流";
+        closeOutput(false);
+        return false;
+    }
+    stream->codecpar->codec_tag = 0; // 由封装器选择 (MP4 的标签不适用于 RTSP / MPEG-TS)
+    stream->time_base = m_timeBase;
+
+    AVDictionary *options = nullptr;
+    if (m_url.startsWith("rtsp://")) {
+        av_dict_set(&options, "rtsp_transport", "tcp", 0); // 经过 NAT / 丢包网络时比 UDP 可靠
+    } else if (m_url.startsWith("udp://")) {
+        av_dict_set(&options, "pkt_size", "1316", 0);      // 每个 UDP 包正好 7 个 TS 包
+    }
+
+    if (!(m_output->oformat->flags & AVFMT_NOFILE)) {
+        armIoTimeout();
+        ret = avio_open2(&m_output->pb, url.constData(), AVIO_FLAG_WRITE, &m_output->interrupt_callback, &options);
+        if (ret < 0) {
+            *errorMsg = QString("无法连接: %1").arg(ffmpegError(ret));
+            av_dict_free(&options);
+            closeOutput(false);
+            return false;
+        }
+    }
+    armIoTimeout();
+    ret = avformat_write_header(m_output, &options); // RTSP 在这里完成 ANNOUNCE / SETUP / RECORD
+    av_dict_free(&options);
+    if (ret < 0) {
+        *errorMsg = QString("无法写入流头: %1").arg(ffmpegError(ret));
+        closeOutput(false);
+        return false;
+    }
+
+    m_tsOffset = AV_NOPTS_VALUE;
+    m_lastDts = AV_NOPTS_VALUE;
+    return true;
+}
+
+void NetworkStreamer::closeOutput(bool writeTrailer)
+{
+    if (!m_output) {
+        return;
+    }
+    m_closing = true;
+    m_ioDeadlineMs = steadyNowMs() + CLOSE_TIMEOUT_MS;
+    if (writeTrailer) {
+        av_write_trailer(m_output);
+    }
+    if (!(m_output->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&m_output->pb);
+    }
+    m_closing = false;
+    avformat_free_context(m_output);
+    m_output = nullptr;
+}
+
+bool NetworkStreamer::sendPacket(AVPacket *packet)
+{
+    // 每次连接的时间戳从0开始
+    if (m_tsOffset == AV_NOPTS_VALUE) {
+        m_tsOffset = (packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts;
+    }
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= m_tsOffset;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= m_tsOffset;
+    }
+    av_packet_rescale_ts(packet, m_timeBase, m_output->streams[0]->time_base);
+    if (packet->dts != AV_NOPTS_VALUE) {
+        if (m_lastDts != AV_NOPTS_VALUE && packet->dts <= m_lastDts) {
+            packet->dts = m_lastDts + 1; // 换算后时间戳相同时保持严格递增，否则封装器会拒绝该包
+            if (packet->pts != AV_NOPTS_VALUE && packet->pts < packet->dts) {
+                packet->pts = packet->dts;
+            }
+        }
+        m_lastDts = packet->dts;
+    }
+    packet->stream_index = 0;
+
+    armIoTimeout();
+    const int ret = av_write_frame(m_output, packet); // 单路视频流不需要交织缓冲
+    av_packet_unref(packet);
+    return ret >= 0;
+}
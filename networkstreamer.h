@@ -0,0 +1,159 @@
+#ifndef NETWORKSTREAMER_H
+#define NETWORKSTREAMER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QString>
+#include <QAtomicInt>
+
+#include "packetsink.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * @brief 网络推流 (NetworkStreamer)
+ *
+ * 作为 `PacketSink` 注册到录制线程上，把本地录像使用的同一份 H.264 码流推送到网络，不做第二次编码：
+ * - `rtsp://` 以 ANNOUNCE/RECORD 方式推送到 RTSP 服务器 (例如 NVR 或 mediamtx)，默认使用 TCP 传输；
+ *   `srt://`、`udp://`、`tcp://` 推送 MPEG-TS；`rtp://` 推送裸 RTP。
+ * - 录制线程只把数据包的引用放进本对象自己的有界队列 (不复制压缩数据，不做网络 I/O)，
+ *   由本对象的线程负责连接和发送，网络慢或断开不会拖慢录制。
+ * - 队列满 (客户端跟不上) 时丢弃整个队列，等下一个关键帧再继续，并请求编码器尽快输出 IDR (`keyFrameNeeded()`)，
+ *   观看端只会跳过一段画面而不会花屏；连接失败或中断后每隔 RECONNECT_INTERVAL_MS 毫秒重连。
+ * - 所有阻塞的网络操作都有超时 (IO_TIMEOUT_MS)，`stopStreaming()` 会立即打断正在进行的连接或发送。
+ */
+class NetworkStreamer : public QThread, public PacketSink
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param url 推流地址，例如 "rtsp://192.168.1.10:8554/cam0" 或 "srt://192.168.1.10:9000"。
+     * @param parent 父对象指针
+     */
+    explicit NetworkStreamer(const QString &url, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止推流线程并释放排队的数据包。
+     */
+    ~NetworkStreamer();
+
+    /**
+     * @brief 推流地址。
+     */
+    QString url() const { return m_url; }
+
+    /**
+     * @brief 设置队列上限 (数据包个数)，超过时丢弃整个队列并等待下一个关键帧。
+     * @param packets 最多排队的数据包个数，小于1时忽略。默认为 DEFAULT_QUEUE_PACKETS。
+     */
+    void setQueueLimit(int packets);
+
+    /**
+     * @brief 启动推流线程。收到编码参数后才连接，之后断线自动重连。
+     */
+    void startStreaming();
+
+    /**
+     * @brief 停止推流线程并断开连接 (打断正在进行的网络操作)。未启动时调用无副作用。
+     */
+    void stopStreaming();
+
+    /**
+     * @brief 因队列溢出或未连接而丢弃的数据包总数。线程安全。
+     */
+    int droppedPackets() const { return m_droppedPackets.load(); }
+
+    // PacketSink 接口：在录制线程中调用，只操作队列
+    void streamStarted(const AVCodecParameters *parameters, AVRational timeBase) override;
+    void consumePacket(const AVPacket *packet) override;
+    void streamStopped() override;
+
+signals:
+    /**
+     * @brief 需要编码器尽快输出一个 IDR 帧 (连接建立或丢弃队列后)。可能在录制线程或推流线程中发出。
+     */
+    void keyFrameNeeded();
+
+    /**
+     * @brief 连接或发送失败时发出 (之后自动重连)。
+     * @param errorMsg 错误描述信息。
+     */
+    void streamError(const QString &errorMsg);
+
+protected:
+    /**
+     * @brief 推流线程主循环：等待数据包，必要时 (重新) 连接，然后发送。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 按当前编码参数打开输出 (连接服务器并写入流头)。
+     * @param errorMsg 失败时输出错误描述。
+     * @return 成功返回 true。
+     */
+    bool openOutput(QString *errorMsg);
+
+    /**
+     * @brief 关闭输出。writeTrailer 为 true 时先写入流尾 (RTSP 发送 TEARDOWN)。
+     */
+    void closeOutput(bool writeTrailer);
+
+    /**
+     * @brief 发送一个数据包 (编码器时间基)：减去本次连接的时间零点并换算到输出流时间基。
+     * @return 发送失败返回 false。
+     */
+    bool sendPacket(AVPacket *packet);
+
+    /**
+     * @brief 丢弃队列中的所有数据包，之后从下一个关键帧开始排队。需持有 `m_mutex`。
+     */
+    void dropQueueLocked();
+
+    /**
+     * @brief FFmpeg 阻塞操作的中断回调：请求停止或本次操作超时时返回1。
+     */
+    static int interruptCallback(void *opaque);
+
+    /**
+     * @brief 为下一次阻塞的网络操作设置超时时刻。
+     */
+    void armIoTimeout();
+
+    static const int DEFAULT_QUEUE_PACKETS = 90;      ///< 默认队列上限 (数据包)，30fps 时约3秒。
+    static const int RECONNECT_INTERVAL_MS = 3000;    ///< 连接失败或中断后的重连间隔 (毫秒)。
+    static const int IO_TIMEOUT_MS = 5000;            ///< 单次连接或发送的超时 (毫秒)。
+    static const int CLOSE_TIMEOUT_MS = 1000;         ///< 断开连接 (写流尾) 的超时 (毫秒)，停止时也会等待。
+
+    QString m_url;                  ///< 推流地址。
+    QAtomicInt m_stopRequested;     ///< 停止请求标志，中断回调和主循环检查。
+    QAtomicInt m_droppedPackets;    ///< 丢弃的数据包总数。
+
+    QMutex m_mutex;                 ///< 保护以下队列和编码参数 (录制线程与推流线程共享)。
+    QWaitCondition m_condition;     ///< 有新数据包、编码参数变化或停止时唤醒推流线程。
+    QQueue<AVPacket *> m_queue;     ///< 等待发送的数据包 (拥有引用)。
+    int m_queueLimit;               ///< 队列上限 (数据包)。
+    bool m_waitKeyFrame;            ///< 丢弃非关键帧直到下一个关键帧 (队列总是从关键帧开始)。
+    AVCodecParameters *m_pendingParams; ///< 录制线程给出的编码参数，推流线程取走后置空。
+    AVRational m_pendingTimeBase;   ///< 与 `m_pendingParams` 对应的数据包时间基。
+    bool m_streamEnded;             ///< 编码器已关闭，推流线程应断开连接。
+
+    // 以下只在推流线程中访问
+    AVCodecParameters *m_params;    ///< 当前使用的编码参数。
+    AVRational m_timeBase;          ///< 当前数据包的时间基。
+    AVFormatContext *m_output;      ///< 输出上下文，未连接时为 nullptr。
+    int64_t m_tsOffset;             ///< 本次连接的时间零点 (第一个数据包的 dts，编码器时间基)。
+    int64_t m_lastDts;              ///< 上一个发送的数据包的 dts (输出流时间基)，保持严格递增。
+    long long m_ioDeadlineMs;       ///< 当前网络操作的超时时刻 (steady_clock 毫秒)。
+    long long m_retryAtMs;          ///< 下一次允许重连的时刻 (steady_clock 毫秒)。
+    bool m_closing;                 ///< 正在断开连接，中断回调只检查超时。
+    bool m_keyFrameAsked;           ///< 已为下一次连接请求过关键帧，收到关键帧前不再重复请求。
+};
+
+#endif // NETWORKSTREAMER_H
@@ -0,0 +1,90 @@
+/**
+ * @file packetfanout.cpp
+ * @brief 已编码数据包分发器 (PacketFanout) 的实现文件。
+ */
+
+#include "packetfanout.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+PacketFanout::PacketFanout()
+    : m_sinkCount(0)
+    , m_params(nullptr)
+    , m_timeBase({1, 90000})
+    , m_active(false)
+{
+}
+
+PacketFanout::~PacketFanout()
+{
+    avcodec_parameters_free(&m_params);
+}
+
+bool PacketFanout::addSink(PacketSink *sink)
+{
+    if (!sink) {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (m_sinks.contains(sink)) {
+        return false;
+    }
+    m_sinks.append(sink);
+    m_sinkCount.storeRelease(m_sinks.size());
+    if (m_active) {
+        sink->streamStarted(m_params, m_timeBase);
+    }
+    return m_active;
+}
+
+void PacketFanout::removeSink(PacketSink *sink)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sinks.removeAll(sink);
+    m_sinkCount.storeRelease(m_sinks.size());
+}
+
+void PacketFanout::start(const AVCodecContext *codecContext)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_params) {
+        m_params = avcodec_parameters_alloc();
+    }
+    if (!m_params || avcodec_parameters_from_context(m_params, codecContext) < 0) {
+        qWarning() << "无法复制编码参数，本次编码不向数据包消费者分发";
+        m_active = false;
+        return;
+    }
+    m_timeBase = codecContext->time_base;
+    m_active = true;
+    for (PacketSink *sink : m_sinks) {
+        sink->streamStarted(m_params, m_timeBase);
+    }
+}
+
+void PacketFanout::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_active) {
+        return;
+    }
+    m_active = false;
+    for (PacketSink *sink : m_sinks) {
+        sink->streamStopped();
+    }
+}
+
+void PacketFanout::dispatch(const AVPacket *packet)
+{
+    if (m_sinkCount.load() == 0) {
+        return; // 没有消费者时不加锁
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!m_active) {
+        return;
+    }
+    for (PacketSink *sink : m_sinks) {
+        sink->consumePacket(packet);
+    }
+}
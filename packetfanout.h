@@ -0,0 +1,72 @@
+#ifndef PACKETFANOUT_H
+#define PACKETFANOUT_H
+
+#include <QMutex>
+#include <QList>
+#include <QAtomicInt>
+
+#include "packetsink.h"
+
+/**
+ * @brief 已编码数据包分发器 (PacketFanout)
+ *
+ * 一个编码器的输出分发给多个 `PacketSink`，主码流 (`RecordingThread`) 和子码流 (`SubstreamEncoder`) 各有一个：
+ * - 消费者列表由互斥锁保护，分发期间持有同一把锁，`removeSink()` 返回后不会再回调该消费者。
+ * - 保存当前编码参数，编码期间注册的消费者立即收到 `streamStarted()`。
+ * - 没有消费者时 `dispatch()` 只读取一个原子变量，不加锁。
+ */
+class PacketFanout
+{
+public:
+    PacketFanout();
+
+    /**
+     * @brief 析构函数，释放保存的编码参数。
+     */
+    ~PacketFanout();
+
+    /**
+     * @brief 注册一个消费者 (重复注册时忽略)。
+     * @return 编码器正在工作 (已立即回调 `streamStarted()`) 时返回 true，调用者应请求一个关键帧。
+     */
+    bool addSink(PacketSink *sink);
+
+    /**
+     * @brief 注销一个消费者。返回后保证不会再回调它。
+     */
+    void removeSink(PacketSink *sink);
+
+    /**
+     * @brief 是否有已注册的消费者。线程安全，不加锁。
+     */
+    bool hasSinks() const { return m_sinkCount.load() > 0; }
+
+    /**
+     * @brief 编码器已打开：保存编码参数并回调所有消费者的 `streamStarted()`。
+     * @param codecContext 已打开的编码器上下文。
+     */
+    void start(const AVCodecContext *codecContext);
+
+    /**
+     * @brief 编码器即将关闭：回调所有消费者的 `streamStopped()`。未调用过 `start()` 时不执行任何操作。
+     */
+    void stop();
+
+    /**
+     * @brief 把一个编码器输出的数据包交给所有消费者。
+     */
+    void dispatch(const AVPacket *packet);
+
+private:
+    PacketFanout(const PacketFanout &) = delete;
+    PacketFanout &operator=(const PacketFanout &) = delete;
+
+    QMutex m_mutex;                ///< 保护消费者列表和编码参数。
+    QList<PacketSink *> m_sinks;   ///< 已注册的消费者。
+    QAtomicInt m_sinkCount;        ///< 已注册的消费者个数。
+    AVCodecParameters *m_params;   ///< 当前编码参数。由 `m_mutex` 保护。
+    AVRational m_timeBase;         ///< 当前数据包的时间基。由 `m_mutex` 保护。
+    bool m_active;                 ///< 编码器已打开且已通知消费者。由 `m_mutex` 保护。
+};
+
+#endif // PACKETFANOUT_H
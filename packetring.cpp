@@ -0,0 +1,110 @@
+/**
+ * @file packetring.cpp
+ * @brief 预录缓冲区 (PacketRing) 的实现文件。
+ *
+ * 待命录制时录制线程把编码后的数据包按 GOP 保存在这里，事件开始时先把它们写入事件文件，
+ * 使录像包含事件发生前的若干秒画面。
+ */
+
+#include "packetring.h"
+
+PacketRing::PacketRing()
+    : m_readIndex(0)
+    , m_bytes(0)
+    , m_maxDuration(0)
+    , m_maxBytes(0)
+    , m_newestPts(AV_NOPTS_VALUE)
+{
+}
+
+PacketRing::~PacketRing()
+{
+    clear();
+}
+
+void PacketRing::setLimits(int64_t maxDuration, int maxBytes)
+{
+    m_maxDuration = maxDuration;
+    m_maxBytes = maxBytes;
+    if (m_maxDuration <= 0) {
+        clear();
+    }
+}
+
+void PacketRing::push(const AVPacket *packet)
+{
+    if (m_maxDuration <= 0 || packet->pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (!key && m_gops.isEmpty()) {
+        return; // 缓冲区必须从关键帧开始
+    }
+
+    AVPacket *copy = av_packet_clone(packet); // 只增加缓冲区引用
+    if (!copy) {
+        return;
+    }
+    if (key) {
+        m_gops.append(Gop());
+        m_gops.last().bytes = 0;
+    }
+    m_gops.last().packets.append(copy);
+    m_gops.last().bytes += copy->size;
+    m_bytes += copy->size;
+    m_newestPts = copy->pts;
+
+    // 去掉最旧的 GOP 后仍覆盖设定时长，或字节数超限：丢弃最旧的 GOP (至少保留正在写入的最新 GOP)
+    while (m_gops.size() > 1) {
+        const int64_t secondStart = m_gops.at(1).packets.at(0)->pts;
+        if (m_newestPts - secondStart < m_maxDuration && m_bytes <= m_maxBytes) {
+            break;
+        }
+        dropOldestGop();
+    }
+}
+
+bool PacketRing::takeOldest(AVPacket *packet)
+{
+    if (m_gops.isEmpty()) {
+        return false;
+    }
+    Gop &gop = m_gops.first();
+    AVPacket *oldest = gop.packets.at(m_readIndex);
+    gop.packets[m_readIndex] = nullptr;
+    m_bytes -= oldest->size;
+    gop.bytes -= oldest->size;
+    av_packet_move_ref(packet, oldest);
+    av_packet_free(&oldest);
+
+    if (++m_readIndex == gop.packets.size()) {
+        m_gops.removeFirst();
+        m_readIndex = 0;
+    }
+    return true;
+}
+
+void PacketRing::clear()
+{
+    while (!m_gops.isEmpty()) {
+        dropOldestGop();
+    }
+    m_bytes = 0;
+    m_newestPts = AV_NOPTS_VALUE;
+}
+
+int64_t PacketRing::oldestPts() const
+{
+    return m_gops.isEmpty() ? AV_NOPTS_VALUE : m_gops.at(0).packets.at(m_readIndex)->pts;
+}
+
+void PacketRing::dropOldestGop()
+{
+    Gop &gop = m_gops.first();
+    for (int i = m_readIndex; i < gop.packets.size(); i++) {
+        av_packet_free(&gop.packets[i]);
+    }
+    m_bytes -= gop.bytes;
+    m_gops.removeFirst();
+    m_readIndex = 0;
+}
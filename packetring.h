@@ -0,0 +1,94 @@
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <QList>
+#include <QVector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief 预录缓冲区：按 GOP 保存最近一段时间的已编码数据包 (PacketRing)
+ *
+ * 待命录制时编码器持续工作，但不写文件，编码后的 `AVPacket` 放进这里：
+ * - 以 GOP (从一个关键帧到下一个关键帧之前) 为单位保存，缓冲区总是从关键帧开始，事件文件可以直接从第一包开始解码。
+ * - 同时按时长和字节数限制：最旧的 GOP 在去掉它之后仍覆盖设定时长、或总字节数超限时被丢弃；
+ *   正在写入的最新 GOP 不会被丢弃。
+ * - 数据包通过 `av_packet_ref()` 共享编码器输出的缓冲区，不复制压缩数据。
+ *
+ * 与保存原始帧相比，每秒占用的内存约为原来的百分之一 (800 kbps 的码流每秒约100KB，
+ * 而 640x480 的 YUYV 原始帧每秒约18MB)。只在录制线程中使用，不是线程安全的。
+ */
+class PacketRing
+{
+public:
+    PacketRing();
+
+    /**
+     * @brief 析构函数，释放所有缓冲的数据包。
+     */
+    ~PacketRing();
+
+    /**
+     * @brief 设置缓冲区上限。
+     * @param maxDuration 至少保留的时长 (数据包时间基)，小于等于0表示不缓冲。
+     * @param maxBytes 压缩数据总字节数的上限。
+     */
+    void setLimits(int64_t maxDuration, int maxBytes);
+
+    /**
+     * @brief 追加一个编码后的数据包 (内部增加引用，调用者仍拥有 packet)。
+     *
+     * 关键帧包开始一个新的 GOP；缓冲区为空时到达的非关键帧包无法独立解码，直接丢弃。
+     * 追加后按时长和字节数丢弃最旧的 GOP。
+     */
+    void push(const AVPacket *packet);
+
+    /**
+     * @brief 取出最旧的一个数据包。
+     * @param packet 输出参数，数据包的引用移动到其中 (调用者负责 `av_packet_unref()`)。
+     * @return 缓冲区为空时返回 false。
+     */
+    bool takeOldest(AVPacket *packet);
+
+    /**
+     * @brief 丢弃所有缓冲的数据包。
+     */
+    void clear();
+
+    bool isEmpty() const { return m_gops.isEmpty(); } ///< 缓冲区是否为空。
+    int bytes() const { return m_bytes; }              ///< 当前缓冲的压缩数据字节数。
+    int gopCount() const { return m_gops.size(); }     ///< 当前缓冲的 GOP 个数。
+
+    /**
+     * @brief 最旧数据包 (一定是关键帧) 的显示时间戳，缓冲区为空时为 AV_NOPTS_VALUE。
+     */
+    int64_t oldestPts() const;
+
+private:
+    /**
+     * @brief 一个 GOP：关键帧及其后的非关键帧。
+     */
+    struct Gop {
+        QVector<AVPacket *> packets; ///< 数据包 (拥有所有权)，第一个为关键帧。
+        int bytes;                   ///< 本 GOP 压缩数据的字节数。
+    };
+
+    /**
+     * @brief 丢弃最旧的一个 GOP。
+     */
+    void dropOldestGop();
+
+    PacketRing(const PacketRing &) = delete;
+    PacketRing &operator=(const PacketRing &) = delete;
+
+    QList<Gop> m_gops;      ///< 从旧到新排列的 GOP。
+    int m_readIndex;        ///< `takeOldest()` 在最旧 GOP 中的读取位置。
+    int m_bytes;            ///< 所有 GOP 的字节数之和。
+    int64_t m_maxDuration;  ///< 至少保留的时长 (数据包时间基)。
+    int m_maxBytes;         ///< 字节数上限。
+    int64_t m_newestPts;    ///< 最新数据包的显示时间戳。
+};
+
+#endif // PACKETRING_H
@@ -0,0 +1,41 @@
+#ifndef PACKETSINK_H
+#define PACKETSINK_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief 已编码数据包消费者接口
+ *
+ * 由录制线程 (RecordingThread，或子码流的 SubstreamEncoder) 在编码器每输出一个数据包时同步调用，
+ * 实现者（如 NetworkStreamer）与本地文件封装器共享同一次编码的结果：
+ * - 所有回调都在编码线程中执行 (`streamStarted()` 也可能在开始录制的线程中执行)，必须尽快返回，
+ *   不能做网络 I/O 或等待其它线程；需要保留数据包时用 `av_packet_ref()` 增加引用，不复制压缩数据。
+ * - 数据包的时间戳以 `streamStarted()` 给出的时间基表示，从编码器原样转发，尚未减去任何文件的时间零点。
+ */
+class PacketSink
+{
+public:
+    virtual ~PacketSink() {}
+
+    /**
+     * @brief 编码器已打开 (或消费者在编码期间注册)，之后的数据包使用这些参数。
+     * @param parameters 编码参数 (编码器、分辨率、SPS/PPS 等 extradata)，仅在调用期间有效，需要时自行复制。
+     * @param timeBase 数据包时间戳的时间基。
+     */
+    virtual void streamStarted(const AVCodecParameters *parameters, AVRational timeBase) = 0;
+
+    /**
+     * @brief 处理一个编码后的数据包。
+     * @param packet 引用计数的数据包，仅在调用期间有效，调用者返回后会继续修改或释放它。
+     */
+    virtual void consumePacket(const AVPacket *packet) = 0;
+
+    /**
+     * @brief 编码器已关闭 (录制会话结束)，在下一次 `streamStarted()` 之前不会再有数据包。
+     */
+    virtual void streamStopped() = 0;
+};
+
+#endif // PACKETSINK_H
@@ -0,0 +1,168 @@
+/**
+ * @file pipelinemetrics.cpp
+ * @brief 录制流水线计量 (PipelineMetrics) 的实现文件。
+ */
+
+#include "pipelinemetrics.h"
+
+#include <cstring>
+
+PipelineMetrics::Snapshot::Snapshot()
+{
+    memset(buckets, 0, sizeof(buckets));
+    memset(samples, 0, sizeof(samples));
+    memset(sumUs, 0, sizeof(sumUs));
+    memset(maxUs, 0, sizeof(maxUs));
+}
+
+qint64 PipelineMetrics::Snapshot::percentileUs(Stage stage, double fraction) const
+{
+    const quint32 total = samples[stage];
+    if (total == 0) {
+        return 0;
+    }
+    // 第一个累计次数达到 fraction 的桶
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(total * fraction + 0.5));
+    quint64 cumulative = 0;
+    for (int i = 0; i < BUCKET_COUNT - 1; ++i) {
+        cumulative += buckets[stage][i];
+        if (cumulative >= rank) {
+            return qMin(bucketUpperUs(i), qMax<qint64>(maxUs[stage], 1));
+        }
+    }
+    return maxUs[stage];
+}
+
+PipelineMetrics::Snapshot PipelineMetrics::Snapshot::since(const Snapshot &previous) const
+{
+    Snapshot delta = *this;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        for (int i = 0; i < BUCKET_COUNT; ++i) {
+            delta.buckets[s][i] -= previous.buckets[s][i];
+        }
+        delta.samples[s] -= previous.samples[s];
+        delta.sumUs[s] -= previous.sumUs[s];
+    }
+    delta.framesQueued -= previous.framesQueued;
+    delta.framesDropped -= previous.framesDropped;
+    delta.framesEncoded -= previous.framesEncoded;
+    delta.bytesWritten -= previous.bytesWritten;
+    delta.encoderCpuUs = (encoderCpuUs >= 0 && previous.encoderCpuUs >= 0 && encoderCpuUs >= previous.encoderCpuUs)
+            ? encoderCpuUs - previous.encoderCpuUs : -1;
+    return delta;
+}
+
+PipelineMetrics::PipelineMetrics()
+    : m_framesQueued(0)
+    , m_framesDropped(0)
+    , m_framesEncoded(0)
+    , m_bytesWritten(0)
+    , m_queueDepth(0)
+    , m_queueHighWater(0)
+    , m_queueCapacity(0)
+    , m_encoderClockValid(0)
+    , m_encoderClock(CLOCK_MONOTONIC)
+{
+}
+
+const char *PipelineMetrics::stageName(Stage stage)
+{
+    switch (stage) {
+    case StageCapture: return "capture";
+    case StageQueue:   return "queue";
+    case StageConvert: return "convert";
+    case StageEncode:  return "encode";
+    case StageWrite:   return "write";
+    case StageTotal:   return "total";
+    default:           return "unknown";
+    }
+}
+
+qint64 PipelineMetrics::bucketUpperUs(int bucket)
+{
+    if (bucket < 0 || bucket >= BUCKET_COUNT - 1) {
+        return -1;
+    }
+    return static_cast<qint64>(FIRST_BUCKET_US) << bucket;
+}
+
+qint64 PipelineMetrics::nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void PipelineMetrics::recordLatency(Stage stage, qint64 us)
+{
+    if (us < 0) {
+        us = 0;
+    }
+    // 最多比较 15 次，比求前导零的可移植写法更直观；每帧只有几次
+    int bucket = 0;
+    qint64 upper = FIRST_BUCKET_US;
+    while (bucket < BUCKET_COUNT - 1 && us > upper) {
+        upper <<= 1;
+        ++bucket;
+    }
+    Histogram &histogram = m_stages[stage];
+    histogram.buckets[bucket].fetchAndAddRelaxed(1);
+    histogram.samples.fetchAndAddRelaxed(1);
+    histogram.sumUs.fetchAndAddRelaxed(us);
+    // 每个阶段只有一个写入线程，读-比较-写不会丢失更新 (与 snapshot() 的清零交错时最多少记一个区间的最大值)
+    if (us > histogram.maxUs.load()) {
+        histogram.maxUs.store(us);
+    }
+}
+
+void PipelineMetrics::setQueueDepth(int depth)
+{
+    m_queueDepth.store(depth);
+    if (depth > m_queueHighWater.load()) {
+        m_queueHighWater.store(depth);
+    }
+}
+
+void PipelineMetrics::setEncoderThread()
+{
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) == 0) {
+        m_encoderClock = clock;
+        m_encoderClockValid.storeRelease(1);
+    }
+}
+
+void PipelineMetrics::clearEncoderThread()
+{
+    m_encoderClockValid.storeRelease(0);
+}
+
+PipelineMetrics::Snapshot PipelineMetrics::snapshot()
+{
+    Snapshot snap;
+    snap.timeUs = nowUs();
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        Histogram &histogram = m_stages[s];
+        for (int i = 0; i < BUCKET_COUNT; ++i) {
+            snap.buckets[s][i] = static_cast<quint32>(histogram.buckets[i].load());
+        }
+        snap.samples[s] = static_cast<quint32>(histogram.samples.load());
+        snap.sumUs[s] = histogram.sumUs.load();
+        snap.maxUs[s] = histogram.maxUs.fetchAndStoreOrdered(0);
+    }
+    snap.framesQueued = static_cast<quint32>(m_framesQueued.load());
+    snap.framesDropped = static_cast<quint32>(m_framesDropped.load());
+    snap.framesEncoded = static_cast<quint32>(m_framesEncoded.load());
+    snap.bytesWritten = m_bytesWritten.load();
+    snap.queueDepth = m_queueDepth.load();
+    // 下一个区间的高水位从当前深度开始
+    snap.queueHighWater = qMax(m_queueHighWater.fetchAndStoreOrdered(snap.queueDepth), snap.queueDepth);
+    snap.queueCapacity = m_queueCapacity.load();
+    if (m_encoderClockValid.loadAcquire()) {
+        struct timespec ts;
+        if (clock_gettime(m_encoderClock, &ts) == 0) {
+            snap.encoderCpuUs = static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        }
+    }
+    return snap;
+}
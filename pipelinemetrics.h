@@ -0,0 +1,154 @@
+#ifndef PIPELINEMETRICS_H
+#define PIPELINEMETRICS_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QtGlobal>
+
+#include <pthread.h> // pthread_getcpuclockid
+#include <time.h>    // clockid_t, clock_gettime
+
+/**
+ * @brief 一路录制流水线的各阶段计量 (PipelineMetrics)
+ *
+ * 由 `RecordingThread` 拥有，采集线程和编码线程在每帧路径上只做几次无锁的原子加法，不加锁、不分配内存、
+ * 不做系统调用 (除了读取 CLOCK_MONOTONIC，在 Linux 上由 vDSO 完成)：
+ * - 各阶段的耗时直方图：桶的上界按 2 的幂从 128 微秒到约 2 秒，外加一个溢出桶，并记录次数、总和与最大值。
+ *   阶段见 `Stage`，采集时间戳 (驱动 DQBUF 的时间戳，CLOCK_MONOTONIC) 是整条流水线的起点。
+ * - 计数器：入队、丢弃、编码的帧数，写出的字节数。从对象创建起单调递增，跨录制会话累计，由读取方求差得到速率。
+ * - 队列深度及两次 `snapshot()` 之间的高水位。
+ * - 编码线程的 CPU 时间 (`pthread_getcpuclockid()`，可以在其它线程中读取)。
+ *
+ * 每个直方图只由一个线程写入 (采集阶段由采集线程，其余由编码线程)，读取方 (GUI 线程的 `TelemetryReporter`)
+ * 随时调用 `snapshot()`。快照中各字段分别原子读取，不是同一时刻的一致视图，相差至多一两帧，对监控没有影响。
+ */
+class PipelineMetrics
+{
+public:
+    /**
+     * @brief 流水线阶段。
+     */
+    enum Stage {
+        StageCapture = 0, ///< 采集：驱动 DQBUF 时间戳 -> 复制进帧槽入队 (包括采集线程分发给其它消费者的时间)。
+        StageQueue,       ///< 排队：入队 -> 编码线程取出。
+        StageConvert,     ///< 转换：像素格式转换为 I420 (MJPEG 输入包括解码)。
+        StageEncode,      ///< 编码：送入编码器并取出数据包 (不包括写文件)。
+        StageWrite,       ///< 写入：一个数据包交给封装器 (写入后写缓冲区)。
+        StageTotal,       ///< 全程：驱动 DQBUF 时间戳 -> 这一帧的数据包全部写出。
+        STAGE_COUNT
+    };
+
+    static const int BUCKET_COUNT = 16;     ///< 直方图桶数 (最后一个为溢出桶)。
+    static const int FIRST_BUCKET_US = 128; ///< 第一个桶的上界 (微秒)，之后每个桶翻倍。
+
+    /**
+     * @brief 某一时刻的计量读数 (`snapshot()` 返回)。
+     */
+    struct Snapshot {
+        qint64 timeUs = 0;                          ///< 读取时刻 (微秒，CLOCK_MONOTONIC)。
+        quint32 buckets[STAGE_COUNT][BUCKET_COUNT]; ///< 各阶段各桶的次数 (不累加)。
+        quint32 samples[STAGE_COUNT];               ///< 各阶段的样本数。
+        qint64 sumUs[STAGE_COUNT];                  ///< 各阶段耗时总和 (微秒)。
+        qint64 maxUs[STAGE_COUNT];                  ///< 两次快照之间各阶段的最大耗时 (微秒)。
+        quint32 framesQueued = 0;                   ///< 累计入队的帧数。
+        quint32 framesDropped = 0;                  ///< 累计因队列已满丢弃的帧数。
+        quint32 framesEncoded = 0;                  ///< 累计送入编码器的帧数。
+        qint64 bytesWritten = 0;                    ///< 累计写出的字节数。
+        int queueDepth = 0;                         ///< 当前队列深度。
+        int queueHighWater = 0;                     ///< 两次快照之间队列深度的最大值。
+        int queueCapacity = 0;                      ///< 当前队列容量。
+        qint64 encoderCpuUs = -1;                   ///< 编码线程累计的 CPU 时间 (微秒)，编码线程未运行时为 -1。
+
+        Snapshot();
+
+        /**
+         * @brief 估算某阶段耗时的百分位数 (取所在桶的上界，溢出桶取最大值)。
+         * @param fraction 0 到 1 之间，例如 0.95。
+         * @return 微秒，没有样本时为 0。
+         */
+        qint64 percentileUs(Stage stage, double fraction) const;
+
+        /**
+         * @brief 本快照相对上一个快照的增量：直方图和计数器相减，队列深度、高水位、最大耗时等保持本快照的值。
+         *        百分位数应在增量上计算 (最近一个区间的分布)。
+         */
+        Snapshot since(const Snapshot &previous) const;
+    };
+
+    PipelineMetrics();
+
+    /**
+     * @brief 阶段名 (用于导出的标签，例如 "capture")。
+     */
+    static const char *stageName(Stage stage);
+
+    /**
+     * @brief 第 i 个桶的上界 (微秒)，溢出桶返回 -1。
+     */
+    static qint64 bucketUpperUs(int bucket);
+
+    /**
+     * @brief 当前的 CLOCK_MONOTONIC 时间 (微秒)，与 V4L2 采集时间戳同一时钟。
+     */
+    static qint64 nowUs();
+
+    /**
+     * @brief 记录一个阶段的耗时。只能由该阶段的写入线程调用。
+     * @param us 耗时 (微秒)，负数 (时钟异常) 按 0 计。
+     */
+    void recordLatency(Stage stage, qint64 us);
+
+    void addQueued() { m_framesQueued.fetchAndAddRelaxed(1); }
+    void addDropped() { m_framesDropped.fetchAndAddRelaxed(1); }
+    void addEncoded() { m_framesEncoded.fetchAndAddRelaxed(1); }
+    void addBytes(qint64 bytes) { m_bytesWritten.fetchAndAddRelaxed(bytes); }
+
+    /**
+     * @brief 更新队列深度 (由采集线程在入队后调用)，同时更新高水位。
+     */
+    void setQueueDepth(int depth);
+
+    /**
+     * @brief 设置队列容量 (重建队列时调用)。
+     */
+    void setQueueCapacity(int capacity) { m_queueCapacity.store(capacity); }
+
+    /**
+     * @brief 把调用线程登记为编码线程，之后 `snapshot()` 读取它的 CPU 时间。须在编码线程中调用。
+     */
+    void setEncoderThread();
+
+    /**
+     * @brief 取消编码线程的登记 (编码线程退出前调用)。
+     */
+    void clearEncoderThread();
+
+    /**
+     * @brief 读取当前计量，同时开始下一个高水位和最大耗时的统计区间。线程安全，但只应有一个读取方。
+     */
+    Snapshot snapshot();
+
+private:
+    /**
+     * @brief 一个阶段的耗时直方图。
+     */
+    struct Histogram {
+        QAtomicInt buckets[BUCKET_COUNT];
+        QAtomicInt samples;
+        QAtomicInteger<qint64> sumUs;
+        QAtomicInteger<qint64> maxUs;
+    };
+
+    Histogram m_stages[STAGE_COUNT];        ///< 各阶段的直方图。
+    QAtomicInt m_framesQueued;              ///< 累计入队的帧数。
+    QAtomicInt m_framesDropped;             ///< 累计丢弃的帧数。
+    QAtomicInt m_framesEncoded;             ///< 累计编码的帧数。
+    QAtomicInteger<qint64> m_bytesWritten;  ///< 累计写出的字节数。
+    QAtomicInt m_queueDepth;                ///< 当前队列深度。
+    QAtomicInt m_queueHighWater;            ///< 本区间队列深度的最大值。
+    QAtomicInt m_queueCapacity;             ///< 当前队列容量。
+    QAtomicInt m_encoderClockValid;         ///< `m_encoderClock` 有效时为1。
+    clockid_t m_encoderClock;               ///< 编码线程的 CPU 时钟 (在 `m_encoderClockValid` 置1之前写入)。
+};
+
+#endif // PIPELINEMETRICS_H
@@ -0,0 +1,990 @@
+/**
+ * @file pixel_convert.c
+ * @brief 像素格式转换模块的实现文件
+ *
+ * 本文件实现了采集链路上的像素格式转换内核，并在运行时根据 CPU 能力选择实现：
+ * - 标量实现：逐像素处理，作为所有平台的兜底，也是其它实现的正确性基准。
+ * - x86：SSE2 (x86_64 基线指令集)、SSSE3 (RGB888 交织需要 pshufb) 和 AVX2。
+ * - ARM：NEON (STM32MP1 / i.MX / RK 等 Cortex-A 平台)。
+ *
+ * 所有实现使用完全相同的整数算法 (BT.601 有限范围系数、相同的舍入方式)，
+ * 因此输出逐字节一致，可以在不同实现之间自由切换和互相校验。
+ *
+ * RGB565 -> I420 是融合内核：一次读取摄像头原始数据，同时写出 Y/U/V 三个平面，
+ * 录制线程可直接把结果写入 AVFrame，省去 RGB565 -> RGB888 -> swscale 两趟整帧内存读写。
+ *
+ * 摄像头直接输出 YUV 时不需要色彩空间转换：YUYV -> I420 只做解交织和色度垂直平均，
+ * NV12 -> I420 只复制 Y 平面并拆分交织的 UV 平面。
+ * YUV -> RGB32 仅用于界面预览 (且预览帧在GUI繁忙时会被跳过)，目前只有标量实现。
+ *
+ * 移动侦测使用两个亮度平面内核：整数倍块平均缩小 (标量，每个源像素只读一次) 和
+ * 按 16 像素宽块累加的绝对差之和 (SAD，SSE2 的 psadbw / NEON 的 vabd + 逐级成对相加)。
+ */
+#include "pixel_convert.h"
+
+#include <stddef.h>     // size_t
+#include <string.h>     // memcpy，NV12 的 Y 平面按行复制
+#include <pthread.h>    // pthread_once，保证自动选择只执行一次且线程安全
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXCONV_HAVE_X86 1
+#include <immintrin.h>  // SSE2 / SSSE3 / AVX2 intrinsics
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXCONV_HAVE_NEON 1
+#include <arm_neon.h>   // NEON intrinsics
+#if defined(__arm__)
+#include <sys/auxv.h>   // getauxval，ARMv7 上运行时检测 NEON
+#include <asm/hwcap.h>  // HWCAP_NEON
+#endif
+#endif
+
+/**
+ * @brief I420 行对转换函数类型。
+ *
+ * 一次处理两行源像素 (s0, s1)，写出两行亮度 (y0, y1) 和一行色度 (u, v)。
+ * 图像高度为奇数时最后一行以 s1 == s0、y1 == NULL 调用。
+ */
+typedef void (*i420_rows_fn)(const uint16_t *s0, const uint16_t *s1, int width,
+                             uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v);
+
+/**
+ * @brief YUYV -> I420 行对转换函数类型，参数含义同 `i420_rows_fn` (源为 YUYV 字节流)。
+ */
+typedef void (*yuyv_rows_fn)(const uint8_t *s0, const uint8_t *s1, int width,
+                             uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v);
+
+/**
+ * @brief 一组转换内核实现。
+ */
+typedef struct pixconv_ops {
+    const char *name;                                                  /**< 实现名称，用于日志。 */
+    void (*rgb888)(const uint16_t *src, uint8_t *dst, int pixels);     /**< RGB565 -> RGB888。 */
+    void (*rgb32)(const uint16_t *src, uint32_t *dst, int pixels);     /**< RGB565 -> RGB32。 */
+    i420_rows_fn i420_rows;                                            /**< RGB565 -> I420 (两行)。 */
+    yuyv_rows_fn yuyv_rows;                                            /**< YUYV -> I420 (两行)。 */
+    void (*uv_split)(const uint8_t *uv, uint8_t *u, uint8_t *v, int pairs); /**< NV12 UV 行拆分。 */
+    void (*sad16_row)(const uint8_t *a, const uint8_t *b, int blocks, uint32_t *sads); /**< 一行的 16 像素块 SAD 累加。 */
+    void (*half_row)(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width); /**< 两行 2x2 块平均为一行。 */
+} pixconv_ops;
+
+static pixconv_ops g_ops;                                  // 当前生效的实现
+static pthread_once_t g_ops_once = PTHREAD_ONCE_INIT;      // 自动选择只执行一次
+
+// ---------------------------------------------------------------------------
+// 标量实现
+// ---------------------------------------------------------------------------
+
+// 从RGB565提取RGB分量并扩展到8位 (高位复制到低位，保持色彩的相对强度)
+#define RGB565_R8(p) ((((p) >> 11) & 0x1F) << 3 | (((p) >> 11) & 0x1F) >> 2)
+#define RGB565_G8(p) ((((p) >> 5) & 0x3F) << 2 | (((p) >> 5) & 0x3F) >> 4)
+#define RGB565_B8(p) (((p) & 0x1F) << 3 | ((p) & 0x1F) >> 2)
+
+// BT.601 有限范围 (与 swscale 对 YUV420P 的默认输出一致) 的整数近似
+#define RGB_TO_Y(r, g, b) ((uint8_t)((((66 * (r) + 129 * (g) + 25 * (b) + 128) >> 8)) + 16))
+#define RGB_TO_U(r, g, b) ((uint8_t)((((-38 * (r) - 74 * (g) + 112 * (b) + 128) >> 8)) + 128))
+#define RGB_TO_V(r, g, b) ((uint8_t)((((112 * (r) - 94 * (g) - 18 * (b) + 128) >> 8)) + 128))
+
+// BT.601 有限范围 YUV -> RGB 的整数近似 (c = Y-16, d = U-128, e = V-128)
+#define CLAMP_U8(x) ((uint32_t)((x) < 0 ? 0 : ((x) > 255 ? 255 : (x))))
+#define YUV_TO_RGB32(c, d, e) (0xFF000000u \
+    | CLAMP_U8((298 * (c) + 409 * (e) + 128) >> 8) << 16 \
+    | CLAMP_U8((298 * (c) - 100 * (d) - 208 * (e) + 128) >> 8) << 8 \
+    | CLAMP_U8((298 * (c) + 516 * (d) + 128) >> 8))
+
+/**
+ * @brief 标量 RGB565 -> RGB888。
+ */
+static void rgb888_c(const uint16_t *src, uint8_t *dst, int pixels)
+{
+    int i;
+    for (i = 0; i < pixels; i++) {
+        unsigned int p = src[i];
+        dst[i * 3 + 0] = (uint8_t)RGB565_R8(p);
+        dst[i * 3 + 1] = (uint8_t)RGB565_G8(p);
+        dst[i * 3 + 2] = (uint8_t)RGB565_B8(p);
+    }
+}
+
+/**
+ * @brief 标量 RGB565 -> RGB32 (0xffRRGGBB)。
+ */
+static void rgb32_c(const uint16_t *src, uint32_t *dst, int pixels)
+{
+    int i;
+    for (i = 0; i < pixels; i++) {
+        unsigned int p = src[i];
+        dst[i] = 0xFF000000u | (uint32_t)RGB565_R8(p) << 16 | (uint32_t)RGB565_G8(p) << 8 | (uint32_t)RGB565_B8(p);
+    }
+}
+
+/**
+ * @brief 标量 I420 行对转换，从第 x 列 (必须为偶数) 处理到行尾。
+ *
+ * 向量化实现处理完整的块之后，调用此函数处理剩余的尾部像素。
+ */
+static void i420_rows_tail_c(const uint16_t *s0, const uint16_t *s1, int x, int width,
+                             uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    for (; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x; // 宽度为奇数时复制最后一列
+        unsigned int p00 = s0[x], p01 = s0[x1], p10 = s1[x], p11 = s1[x1];
+        int r00 = RGB565_R8(p00), g00 = RGB565_G8(p00), b00 = RGB565_B8(p00);
+        int r01 = RGB565_R8(p01), g01 = RGB565_G8(p01), b01 = RGB565_B8(p01);
+        int r10 = RGB565_R8(p10), g10 = RGB565_G8(p10), b10 = RGB565_B8(p10);
+        int r11 = RGB565_R8(p11), g11 = RGB565_G8(p11), b11 = RGB565_B8(p11);
+        int r, g, b;
+
+        y0[x] = RGB_TO_Y(r00, g00, b00);
+        if (x1 != x) y0[x1] = RGB_TO_Y(r01, g01, b01);
+        if (y1) {
+            y1[x] = RGB_TO_Y(r10, g10, b10);
+            if (x1 != x) y1[x1] = RGB_TO_Y(r11, g11, b11);
+        }
+
+        // 色度取 2x2 块的平均值 (四舍五入)
+        r = (r00 + r01 + r10 + r11 + 2) >> 2;
+        g = (g00 + g01 + g10 + g11 + 2) >> 2;
+        b = (b00 + b01 + b10 + b11 + 2) >> 2;
+        u[x >> 1] = RGB_TO_U(r, g, b);
+        v[x >> 1] = RGB_TO_V(r, g, b);
+    }
+}
+
+/**
+ * @brief 标量 I420 行对转换。
+ */
+static void i420_rows_c(const uint16_t *s0, const uint16_t *s1, int width,
+                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    i420_rows_tail_c(s0, s1, 0, width, y0, y1, u, v);
+}
+
+/**
+ * @brief 标量 YUYV -> I420 行对转换，从第 x 列 (必须为偶数) 处理到行尾。
+ *
+ * 每4字节 (Y0 U Y1 V) 描述两个像素；色度取上下两行的平均值 ((a + b + 1) >> 1)。
+ */
+static void yuyv_rows_tail_c(const uint8_t *s0, const uint8_t *s1, int x, int width,
+                             uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    for (; x < width; x += 2) {
+        const uint8_t *p0 = s0 + x * 2, *p1 = s1 + x * 2;
+        int has_odd = (x + 1 < width); // 宽度为奇数时最后一个宏像素只取左像素
+        y0[x] = p0[0];
+        if (has_odd) y0[x + 1] = p0[2];
+        if (y1) {
+            y1[x] = p1[0];
+            if (has_odd) y1[x + 1] = p1[2];
+        }
+        u[x >> 1] = (uint8_t)((p0[1] + p1[1] + 1) >> 1);
+        v[x >> 1] = (uint8_t)((p0[3] + p1[3] + 1) >> 1);
+    }
+}
+
+static void yuyv_rows_c(const uint8_t *s0, const uint8_t *s1, int width,
+                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    yuyv_rows_tail_c(s0, s1, 0, width, y0, y1, u, v);
+}
+
+/**
+ * @brief 标量 UV 交织行拆分 (U0 V0 U1 V1 ... -> U 行 + V 行)。
+ */
+static void uv_split_c(const uint8_t *uv, uint8_t *u, uint8_t *v, int pairs)
+{
+    int i;
+    for (i = 0; i < pairs; i++) {
+        u[i] = uv[i * 2];
+        v[i] = uv[i * 2 + 1];
+    }
+}
+
+/**
+ * @brief 标量块 SAD：把一行中每 16 个像素的绝对差之和累加到 sads[块序号]。
+ */
+static void sad16_row_c(const uint8_t *a, const uint8_t *b, int blocks, uint32_t *sads)
+{
+    int i, k;
+    for (i = 0; i < blocks; i++) {
+        uint32_t sum = 0;
+        for (k = 0; k < 16; k++) {
+            int d = a[i * 16 + k] - b[i * 16 + k];
+            sum += (uint32_t)(d < 0 ? -d : d);
+        }
+        sads[i] += sum;
+    }
+}
+
+/**
+ * @brief 标量 2x2 块平均：两行源像素缩小为一行，四舍五入。
+ */
+static void half_row_c(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width)
+{
+    int i;
+    for (i = 0; i < dst_width; i++) {
+        dst[i] = (uint8_t)((s0[i * 2] + s0[i * 2 + 1] + s1[i * 2] + s1[i * 2 + 1] + 2) >> 2);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// x86 实现 (SSE2 / SSSE3 / AVX2)
+// ---------------------------------------------------------------------------
+#ifdef PIXCONV_HAVE_X86
+
+#define PIXCONV_SSE2  __attribute__((target("sse2")))
+#define PIXCONV_SSSE3 __attribute__((target("ssse3")))
+#define PIXCONV_AVX2  __attribute__((target("avx2")))
+
+/**
+ * @brief 把8个RGB565像素展开为三个 16 位通道 (每通道值 0-255)。
+ */
+static inline PIXCONV_SSE2 void sse2_unpack(__m128i p, __m128i *r, __m128i *g, __m128i *b)
+{
+    __m128i r5 = _mm_srli_epi16(p, 11);
+    __m128i g6 = _mm_and_si128(_mm_srli_epi16(p, 5), _mm_set1_epi16(0x3F));
+    __m128i b5 = _mm_and_si128(p, _mm_set1_epi16(0x1F));
+    *r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+    *g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+    *b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+}
+
+/**
+ * @brief 计算8个像素的亮度 (16 位通道)。中间结果最大 56228，按无符号 16 位处理不会溢出。
+ */
+static inline PIXCONV_SSE2 __m128i sse2_luma(__m128i r, __m128i g, __m128i b)
+{
+    __m128i y = _mm_mullo_epi16(r, _mm_set1_epi16(66));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    y = _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(y, _mm_set1_epi16(16));
+}
+
+/**
+ * @brief 由平均后的RGB计算色度 (有符号 16 位通道，结果范围 16-240)。
+ */
+static inline PIXCONV_SSE2 __m128i sse2_chroma(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb)
+{
+    __m128i c = _mm_mullo_epi16(r, _mm_set1_epi16(cr));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+    c = _mm_srai_epi16(_mm_add_epi16(c, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(c, _mm_set1_epi16(128));
+}
+
+/**
+ * @brief 16 个像素的水平相邻像素对求和，得到 8 个 16 位和。
+ */
+static inline PIXCONV_SSE2 __m128i sse2_pairsum(__m128i lo, __m128i hi)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    return _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+}
+
+/**
+ * @brief SSE2 RGB565 -> RGB32，每次处理8个像素。
+ */
+static PIXCONV_SSE2 void rgb32_sse2(const uint16_t *src, uint32_t *dst, int pixels)
+{
+    const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i r, g, b;
+        sse2_unpack(_mm_loadu_si128((const __m128i *)(src + i)), &r, &g, &b);
+        // 内存顺序 B,G,R,A (小端下即 0xffRRGGBB)
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i ra = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+    rgb32_c(src + i, dst + i, pixels - i);
+}
+
+/**
+ * @brief SSSE3 RGB565 -> RGB888，每次处理8个像素 (24 字节输出)，使用 pshufb 交织。
+ */
+static PIXCONV_SSSE3 void rgb888_ssse3(const uint16_t *src, uint8_t *dst, int pixels)
+{
+    // 输出字节 i 属于像素 i/3 的第 i%3 个分量；-128 表示该位置填0，由另一个寄存器提供
+    const __m128i rb_lo = _mm_setr_epi8(0, -128, 8, 1, -128, 9, 2, -128, 10, 3, -128, 11, 4, -128, 12, 5);
+    const __m128i g_lo  = _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128);
+    const __m128i rb_hi = _mm_setr_epi8(-128, 13, 6, -128, 14, 7, -128, 15, -128, -128, -128, -128, -128, -128, -128, -128);
+    const __m128i g_hi  = _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+    const __m128i m5 = _mm_set1_epi16(0x1F), m6 = _mm_set1_epi16(0x3F);
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i r5 = _mm_srli_epi16(p, 11);
+        __m128i g6 = _mm_and_si128(_mm_srli_epi16(p, 5), m6);
+        __m128i b5 = _mm_and_si128(p, m5);
+        __m128i r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+        __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+        __m128i b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+        __m128i rb = _mm_packus_epi16(r, b); // r0..r7 b0..b7
+        __m128i gg = _mm_packus_epi16(g, g); // g0..g7 g0..g7
+        __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(rb, rb_lo), _mm_shuffle_epi8(gg, g_lo));
+        __m128i out1 = _mm_or_si128(_mm_shuffle_epi8(rb, rb_hi), _mm_shuffle_epi8(gg, g_hi));
+        _mm_storeu_si128((__m128i *)(dst + i * 3), out0);
+        _mm_storel_epi64((__m128i *)(dst + i * 3 + 16), out1);
+    }
+    rgb888_c(src + i, dst + i * 3, pixels - i);
+}
+
+/**
+ * @brief SSE2 I420 行对转换，每次处理 16 列。
+ */
+static PIXCONV_SSE2 void i420_rows_sse2(const uint16_t *s0, const uint16_t *s1, int width,
+                                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i r0l, g0l, b0l, r0h, g0h, b0h, r1l, g1l, b1l, r1h, g1h, b1h;
+        __m128i rs, gs, bs;
+        sse2_unpack(_mm_loadu_si128((const __m128i *)(s0 + x)), &r0l, &g0l, &b0l);
+        sse2_unpack(_mm_loadu_si128((const __m128i *)(s0 + x + 8)), &r0h, &g0h, &b0h);
+        sse2_unpack(_mm_loadu_si128((const __m128i *)(s1 + x)), &r1l, &g1l, &b1l);
+        sse2_unpack(_mm_loadu_si128((const __m128i *)(s1 + x + 8)), &r1h, &g1h, &b1h);
+
+        _mm_storeu_si128((__m128i *)(y0 + x),
+                         _mm_packus_epi16(sse2_luma(r0l, g0l, b0l), sse2_luma(r0h, g0h, b0h)));
+        if (y1) {
+            _mm_storeu_si128((__m128i *)(y1 + x),
+                             _mm_packus_epi16(sse2_luma(r1l, g1l, b1l), sse2_luma(r1h, g1h, b1h)));
+        }
+
+        // 2x2 块求和后取平均 ((sum + 2) >> 2)
+        rs = _mm_add_epi16(sse2_pairsum(r0l, r0h), sse2_pairsum(r1l, r1h));
+        gs = _mm_add_epi16(sse2_pairsum(g0l, g0h), sse2_pairsum(g1l, g1h));
+        bs = _mm_add_epi16(sse2_pairsum(b0l, b0h), sse2_pairsum(b1l, b1h));
+        rs = _mm_srli_epi16(_mm_add_epi16(rs, _mm_set1_epi16(2)), 2);
+        gs = _mm_srli_epi16(_mm_add_epi16(gs, _mm_set1_epi16(2)), 2);
+        bs = _mm_srli_epi16(_mm_add_epi16(bs, _mm_set1_epi16(2)), 2);
+
+        __m128i uu = sse2_chroma(rs, gs, bs, -38, -74, 112);
+        __m128i vv = sse2_chroma(rs, gs, bs, 112, -94, -18);
+        _mm_storel_epi64((__m128i *)(u + (x >> 1)), _mm_packus_epi16(uu, uu));
+        _mm_storel_epi64((__m128i *)(v + (x >> 1)), _mm_packus_epi16(vv, vv));
+    }
+    i420_rows_tail_c(s0, s1, x, width, y0, y1, u, v);
+}
+
+/**
+ * @brief SSE2 YUYV -> I420 行对转换，每次处理 16 列 (每行读取32字节)。
+ */
+static PIXCONV_SSE2 void yuyv_rows_sse2(const uint8_t *s0, const uint8_t *s1, int width,
+                                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    const __m128i lo8 = _mm_set1_epi16(0x00FF);
+    const __m128i lo16 = _mm_set1_epi32(0x0000FFFF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(s0 + x * 2));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(s0 + x * 2 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(s1 + x * 2));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(s1 + x * 2 + 16));
+        __m128i c0, c1, uu, vv;
+
+        // 偶数字节为亮度
+        _mm_storeu_si128((__m128i *)(y0 + x), _mm_packus_epi16(_mm_and_si128(a0, lo8), _mm_and_si128(a1, lo8)));
+        if (y1) {
+            _mm_storeu_si128((__m128i *)(y1 + x), _mm_packus_epi16(_mm_and_si128(b0, lo8), _mm_and_si128(b1, lo8)));
+        }
+
+        // 奇数字节为 U V U V ...，pavgw 即 (a + b + 1) >> 1
+        c0 = _mm_avg_epu16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+        c1 = _mm_avg_epu16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+        uu = _mm_packs_epi32(_mm_and_si128(c0, lo16), _mm_and_si128(c1, lo16));
+        vv = _mm_packs_epi32(_mm_srli_epi32(c0, 16), _mm_srli_epi32(c1, 16));
+        _mm_storel_epi64((__m128i *)(u + (x >> 1)), _mm_packus_epi16(uu, uu));
+        _mm_storel_epi64((__m128i *)(v + (x >> 1)), _mm_packus_epi16(vv, vv));
+    }
+    yuyv_rows_tail_c(s0, s1, x, width, y0, y1, u, v);
+}
+
+/**
+ * @brief SSE2 UV 行拆分，每次处理 16 对。
+ */
+static PIXCONV_SSE2 void uv_split_sse2(const uint8_t *uv, uint8_t *u, uint8_t *v, int pairs)
+{
+    const __m128i lo8 = _mm_set1_epi16(0x00FF);
+    int i = 0;
+    for (; i + 16 <= pairs; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(uv + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i *)(uv + i * 2 + 16));
+        _mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(_mm_and_si128(a, lo8), _mm_and_si128(b, lo8)));
+        _mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    uv_split_c(uv + i * 2, u + i, v + i, pairs - i);
+}
+
+/**
+ * @brief SSE2 块 SAD：psadbw 一次得到 16 字节中前后各 8 字节的差值和 (各不超过 2040)。
+ */
+static PIXCONV_SSE2 void sad16_row_sse2(const uint8_t *a, const uint8_t *b, int blocks, uint32_t *sads)
+{
+    int i;
+    for (i = 0; i < blocks; i++) {
+        __m128i s = _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(a + i * 16)),
+                                 _mm_loadu_si128((const __m128i *)(b + i * 16)));
+        sads[i] += (uint32_t)(_mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4));
+    }
+}
+
+/**
+ * @brief SSE2 2x2 块平均：偶数/奇数字节拆成 16 位后求和，每次输出 16 个像素，结果与标量实现一致。
+ */
+static PIXCONV_SSE2 void half_row_sse2(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i two = _mm_set1_epi16(2);
+    int i = 0;
+    for (; i + 16 <= dst_width; i += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(s0 + i * 2));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(s0 + i * 2 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(s1 + i * 2));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(s1 + i * 2 + 16));
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, mask), _mm_srli_epi16(a0, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b0, mask), _mm_srli_epi16(b0, 8)));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, mask), _mm_srli_epi16(a1, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b1, mask), _mm_srli_epi16(b1, 8)));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    half_row_c(s0 + i * 2, s1 + i * 2, dst + i, dst_width - i);
+}
+
+static inline PIXCONV_AVX2 void avx2_unpack(__m256i p, __m256i *r, __m256i *g, __m256i *b)
+{
+    __m256i r5 = _mm256_srli_epi16(p, 11);
+    __m256i g6 = _mm256_and_si256(_mm256_srli_epi16(p, 5), _mm256_set1_epi16(0x3F));
+    __m256i b5 = _mm256_and_si256(p, _mm256_set1_epi16(0x1F));
+    *r = _mm256_or_si256(_mm256_slli_epi16(r5, 3), _mm256_srli_epi16(r5, 2));
+    *g = _mm256_or_si256(_mm256_slli_epi16(g6, 2), _mm256_srli_epi16(g6, 4));
+    *b = _mm256_or_si256(_mm256_slli_epi16(b5, 3), _mm256_srli_epi16(b5, 2));
+}
+
+static inline PIXCONV_AVX2 __m256i avx2_luma(__m256i r, __m256i g, __m256i b)
+{
+    __m256i y = _mm256_mullo_epi16(r, _mm256_set1_epi16(66));
+    y = _mm256_add_epi16(y, _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+    y = _mm256_add_epi16(y, _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+    y = _mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8);
+    return _mm256_add_epi16(y, _mm256_set1_epi16(16));
+}
+
+static inline PIXCONV_AVX2 __m256i avx2_chroma(__m256i r, __m256i g, __m256i b, short cr, short cg, short cb)
+{
+    __m256i c = _mm256_mullo_epi16(r, _mm256_set1_epi16(cr));
+    c = _mm256_add_epi16(c, _mm256_mullo_epi16(g, _mm256_set1_epi16(cg)));
+    c = _mm256_add_epi16(c, _mm256_mullo_epi16(b, _mm256_set1_epi16(cb)));
+    c = _mm256_srai_epi16(_mm256_add_epi16(c, _mm256_set1_epi16(128)), 8);
+    return _mm256_add_epi16(c, _mm256_set1_epi16(128));
+}
+
+/**
+ * @brief 32 个像素的水平像素对求和，结果按列顺序排列为 16 个 16 位和。
+ *
+ * AVX2 的 pack 指令在两个 128 位通道内分别进行，需要 permute 恢复顺序。
+ */
+static inline PIXCONV_AVX2 __m256i avx2_pairsum(__m256i lo, __m256i hi)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i s = _mm256_packs_epi32(_mm256_madd_epi16(lo, ones), _mm256_madd_epi16(hi, ones));
+    return _mm256_permute4x64_epi64(s, 0xD8);
+}
+
+/**
+ * @brief 把两个 16 位通道寄存器打包为按顺序排列的 32 个字节。
+ */
+static inline PIXCONV_AVX2 __m256i avx2_pack_u8(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+/**
+ * @brief AVX2 I420 行对转换，每次处理 32 列，剩余部分交给 SSE2 / 标量实现。
+ */
+static PIXCONV_AVX2 void i420_rows_avx2(const uint16_t *s0, const uint16_t *s1, int width,
+                                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i r0l, g0l, b0l, r0h, g0h, b0h, r1l, g1l, b1l, r1h, g1h, b1h;
+        __m256i rs, gs, bs, uu, vv;
+        avx2_unpack(_mm256_loadu_si256((const __m256i *)(s0 + x)), &r0l, &g0l, &b0l);
+        avx2_unpack(_mm256_loadu_si256((const __m256i *)(s0 + x + 16)), &r0h, &g0h, &b0h);
+        avx2_unpack(_mm256_loadu_si256((const __m256i *)(s1 + x)), &r1l, &g1l, &b1l);
+        avx2_unpack(_mm256_loadu_si256((const __m256i *)(s1 + x + 16)), &r1h, &g1h, &b1h);
+
+        _mm256_storeu_si256((__m256i *)(y0 + x),
+                            avx2_pack_u8(avx2_luma(r0l, g0l, b0l), avx2_luma(r0h, g0h, b0h)));
+        if (y1) {
+            _mm256_storeu_si256((__m256i *)(y1 + x),
+                                avx2_pack_u8(avx2_luma(r1l, g1l, b1l), avx2_luma(r1h, g1h, b1h)));
+        }
+
+        rs = _mm256_add_epi16(avx2_pairsum(r0l, r0h), avx2_pairsum(r1l, r1h));
+        gs = _mm256_add_epi16(avx2_pairsum(g0l, g0h), avx2_pairsum(g1l, g1h));
+        bs = _mm256_add_epi16(avx2_pairsum(b0l, b0h), avx2_pairsum(b1l, b1h));
+        rs = _mm256_srli_epi16(_mm256_add_epi16(rs, _mm256_set1_epi16(2)), 2);
+        gs = _mm256_srli_epi16(_mm256_add_epi16(gs, _mm256_set1_epi16(2)), 2);
+        bs = _mm256_srli_epi16(_mm256_add_epi16(bs, _mm256_set1_epi16(2)), 2);
+
+        uu = avx2_chroma(rs, gs, bs, -38, -74, 112);
+        vv = avx2_chroma(rs, gs, bs, 112, -94, -18);
+        _mm_storeu_si128((__m128i *)(u + (x >> 1)), _mm256_castsi256_si128(avx2_pack_u8(uu, uu)));
+        _mm_storeu_si128((__m128i *)(v + (x >> 1)), _mm256_castsi256_si128(avx2_pack_u8(vv, vv)));
+    }
+    if (x < width) {
+        // 余下不足32列的部分 (偏移保持偶数)
+        i420_rows_sse2(s0 + x, s1 + x, width - x, y0 + x, y1 ? y1 + x : NULL, u + (x >> 1), v + (x >> 1));
+    }
+}
+
+#endif // PIXCONV_HAVE_X86
+
+// ---------------------------------------------------------------------------
+// ARM NEON 实现
+// ---------------------------------------------------------------------------
+#ifdef PIXCONV_HAVE_NEON
+
+static inline void neon_unpack(uint16x8_t p, uint16x8_t *r, uint16x8_t *g, uint16x8_t *b)
+{
+    uint16x8_t r5 = vshrq_n_u16(p, 11);
+    uint16x8_t g6 = vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3F));
+    uint16x8_t b5 = vandq_u16(p, vdupq_n_u16(0x1F));
+    *r = vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2));
+    *g = vorrq_u16(vshlq_n_u16(g6, 2), vshrq_n_u16(g6, 4));
+    *b = vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2));
+}
+
+static inline uint8x8_t neon_luma(uint16x8_t r, uint16x8_t g, uint16x8_t b)
+{
+    uint16x8_t y = vmulq_n_u16(r, 66);
+    y = vmlaq_n_u16(y, g, 129);
+    y = vmlaq_n_u16(y, b, 25);
+    y = vaddq_u16(y, vdupq_n_u16(128));
+    return vadd_u8(vshrn_n_u16(y, 8), vdup_n_u8(16));
+}
+
+static inline uint8x8_t neon_chroma(uint16x8_t r, uint16x8_t g, uint16x8_t b, int16_t cr, int16_t cg, int16_t cb)
+{
+    int16x8_t c = vmulq_n_s16(vreinterpretq_s16_u16(r), cr);
+    c = vmlaq_n_s16(c, vreinterpretq_s16_u16(g), cg);
+    c = vmlaq_n_s16(c, vreinterpretq_s16_u16(b), cb);
+    c = vshrq_n_s16(vaddq_s16(c, vdupq_n_s16(128)), 8);
+    return vqmovun_s16(vaddq_s16(c, vdupq_n_s16(128)));
+}
+
+/**
+ * @brief 16 个像素的水平像素对求和 (ARMv7 与 AArch64 通用写法)。
+ */
+static inline uint16x8_t neon_pairsum(uint16x8_t lo, uint16x8_t hi)
+{
+    return vcombine_u16(vpadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+                        vpadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+}
+
+static void rgb888_neon(const uint16_t *src, uint8_t *dst, int pixels)
+{
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        uint16x8_t r, g, b;
+        uint8x8x3_t out;
+        neon_unpack(vld1q_u16(src + i), &r, &g, &b);
+        out.val[0] = vmovn_u16(r);
+        out.val[1] = vmovn_u16(g);
+        out.val[2] = vmovn_u16(b);
+        vst3_u8(dst + i * 3, out); // 交织存储 R,G,B
+    }
+    rgb888_c(src + i, dst + i * 3, pixels - i);
+}
+
+static void rgb32_neon(const uint16_t *src, uint32_t *dst, int pixels)
+{
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        uint16x8_t r, g, b;
+        uint8x8x4_t out;
+        neon_unpack(vld1q_u16(src + i), &r, &g, &b);
+        out.val[0] = vmovn_u16(b); // 小端内存顺序 B,G,R,A
+        out.val[1] = vmovn_u16(g);
+        out.val[2] = vmovn_u16(r);
+        out.val[3] = vdup_n_u8(0xFF);
+        vst4_u8((uint8_t *)(dst + i), out);
+    }
+    rgb32_c(src + i, dst + i, pixels - i);
+}
+
+static void i420_rows_neon(const uint16_t *s0, const uint16_t *s1, int width,
+                           uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t r0l, g0l, b0l, r0h, g0h, b0h, r1l, g1l, b1l, r1h, g1h, b1h;
+        uint16x8_t rs, gs, bs;
+        neon_unpack(vld1q_u16(s0 + x), &r0l, &g0l, &b0l);
+        neon_unpack(vld1q_u16(s0 + x + 8), &r0h, &g0h, &b0h);
+        neon_unpack(vld1q_u16(s1 + x), &r1l, &g1l, &b1l);
+        neon_unpack(vld1q_u16(s1 + x + 8), &r1h, &g1h, &b1h);
+
+        vst1q_u8(y0 + x, vcombine_u8(neon_luma(r0l, g0l, b0l), neon_luma(r0h, g0h, b0h)));
+        if (y1) {
+            vst1q_u8(y1 + x, vcombine_u8(neon_luma(r1l, g1l, b1l), neon_luma(r1h, g1h, b1h)));
+        }
+
+        // vrshr 即 (sum + 2) >> 2
+        rs = vrshrq_n_u16(vaddq_u16(neon_pairsum(r0l, r0h), neon_pairsum(r1l, r1h)), 2);
+        gs = vrshrq_n_u16(vaddq_u16(neon_pairsum(g0l, g0h), neon_pairsum(g1l, g1h)), 2);
+        bs = vrshrq_n_u16(vaddq_u16(neon_pairsum(b0l, b0h), neon_pairsum(b1l, b1h)), 2);
+
+        vst1_u8(u + (x >> 1), neon_chroma(rs, gs, bs, -38, -74, 112));
+        vst1_u8(v + (x >> 1), neon_chroma(rs, gs, bs, 112, -94, -18));
+    }
+    i420_rows_tail_c(s0, s1, x, width, y0, y1, u, v);
+}
+
+/**
+ * @brief NEON YUYV -> I420 行对转换，vld4 一次把 16 个像素拆成 Y0 / U / Y1 / V 四路。
+ */
+static void yuyv_rows_neon(const uint8_t *s0, const uint8_t *s1, int width,
+                           uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x4_t a = vld4_u8(s0 + x * 2);
+        uint8x8x4_t b = vld4_u8(s1 + x * 2);
+        uint8x8x2_t ya, yb;
+        ya.val[0] = a.val[0];
+        ya.val[1] = a.val[2];
+        vst2_u8(y0 + x, ya); // 重新交织偶数/奇数列亮度
+        if (y1) {
+            yb.val[0] = b.val[0];
+            yb.val[1] = b.val[2];
+            vst2_u8(y1 + x, yb);
+        }
+        // vrhadd 即 (a + b + 1) >> 1
+        vst1_u8(u + (x >> 1), vrhadd_u8(a.val[1], b.val[1]));
+        vst1_u8(v + (x >> 1), vrhadd_u8(a.val[3], b.val[3]));
+    }
+    yuyv_rows_tail_c(s0, s1, x, width, y0, y1, u, v);
+}
+
+static void uv_split_neon(const uint8_t *uv, uint8_t *u, uint8_t *v, int pairs)
+{
+    int i = 0;
+    for (; i + 16 <= pairs; i += 16) {
+        uint8x16x2_t p = vld2q_u8(uv + i * 2);
+        vst1q_u8(u + i, p.val[0]);
+        vst1q_u8(v + i, p.val[1]);
+    }
+    uv_split_c(uv + i * 2, u + i, v + i, pairs - i);
+}
+
+static void sad16_row_neon(const uint8_t *a, const uint8_t *b, int blocks, uint32_t *sads)
+{
+    int i;
+    for (i = 0; i < blocks; i++) {
+        uint8x16_t d = vabdq_u8(vld1q_u8(a + i * 16), vld1q_u8(b + i * 16));
+        uint64x2_t s = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(d))); // 逐级成对相加到两个 64 位和
+        sads[i] += (uint32_t)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+    }
+}
+
+/**
+ * @brief NEON 2x2 块平均：vpaddl 成对相加，vrshrn 带舍入右移，每次输出 8 个像素。
+ */
+static void half_row_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, int dst_width)
+{
+    int i = 0;
+    for (; i + 8 <= dst_width; i += 8) {
+        uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(s0 + i * 2)), vpaddlq_u8(vld1q_u8(s1 + i * 2)));
+        vst1_u8(dst + i, vrshrn_n_u16(sum, 2));
+    }
+    half_row_c(s0 + i * 2, s1 + i * 2, dst + i, dst_width - i);
+}
+
+#endif // PIXCONV_HAVE_NEON
+
+// ---------------------------------------------------------------------------
+// 运行时分派
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief 检查某种实现在当前 CPU / 编译配置下是否可用。
+ */
+static int backend_available(pixconv_backend backend)
+{
+    switch (backend) {
+    case PIXCONV_BACKEND_SCALAR:
+        return 1;
+#ifdef PIXCONV_HAVE_X86
+    case PIXCONV_BACKEND_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case PIXCONV_BACKEND_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef PIXCONV_HAVE_NEON
+    case PIXCONV_BACKEND_NEON:
+#if defined(__arm__)
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        return 1; // AArch64 上 NEON 是必备特性
+#endif
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 按实现类型填充函数表。调用前需确认 backend_available()。
+ */
+static void fill_ops(pixconv_backend backend, pixconv_ops *ops)
+{
+    ops->name = "scalar";
+    ops->rgb888 = rgb888_c;
+    ops->rgb32 = rgb32_c;
+    ops->i420_rows = i420_rows_c;
+    ops->yuyv_rows = yuyv_rows_c;
+    ops->uv_split = uv_split_c;
+    ops->sad16_row = sad16_row_c;
+    ops->half_row = half_row_c;
+
+    switch (backend) {
+#ifdef PIXCONV_HAVE_X86
+    case PIXCONV_BACKEND_AVX2:
+    case PIXCONV_BACKEND_SSE2:
+        ops->name = (backend == PIXCONV_BACKEND_AVX2) ? "avx2" : "sse2";
+        ops->rgb32 = rgb32_sse2;
+        ops->i420_rows = (backend == PIXCONV_BACKEND_AVX2) ? i420_rows_avx2 : i420_rows_sse2;
+        ops->yuyv_rows = yuyv_rows_sse2; // 纯搬运内核受内存带宽限制，AVX2 没有明显收益
+        ops->uv_split = uv_split_sse2;
+        ops->sad16_row = sad16_row_sse2;
+        ops->half_row = half_row_sse2;
+        if (__builtin_cpu_supports("ssse3")) {
+            ops->rgb888 = rgb888_ssse3; // RGB888 的字节交织需要 pshufb
+        }
+        break;
+#endif
+#ifdef PIXCONV_HAVE_NEON
+    case PIXCONV_BACKEND_NEON:
+        ops->name = "neon";
+        ops->rgb888 = rgb888_neon;
+        ops->rgb32 = rgb32_neon;
+        ops->i420_rows = i420_rows_neon;
+        ops->yuyv_rows = yuyv_rows_neon;
+        ops->uv_split = uv_split_neon;
+        ops->sad16_row = sad16_row_neon;
+        ops->half_row = half_row_neon;
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 自动选择当前 CPU 上最快的实现。由 pthread_once 保证只执行一次。
+ */
+static void auto_select(void)
+{
+    static const pixconv_backend order[] = {
+        PIXCONV_BACKEND_NEON, PIXCONV_BACKEND_AVX2, PIXCONV_BACKEND_SSE2, PIXCONV_BACKEND_SCALAR
+    };
+    size_t i;
+    for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        if (backend_available(order[i])) {
+            fill_ops(order[i], &g_ops);
+            return;
+        }
+    }
+}
+
+static inline const pixconv_ops *ops(void)
+{
+    pthread_once(&g_ops_once, auto_select);
+    return &g_ops;
+}
+
+int pixconv_select_backend(pixconv_backend backend)
+{
+    pthread_once(&g_ops_once, auto_select);
+    if (backend == PIXCONV_BACKEND_AUTO) {
+        auto_select();
+        return 0;
+    }
+    if (!backend_available(backend)) {
+        return -1;
+    }
+    fill_ops(backend, &g_ops);
+    return 0;
+}
+
+const char *pixconv_backend_name(void)
+{
+    return ops()->name;
+}
+
+void pixconv_rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, int pixels)
+{
+    ops()->rgb888(src, dst, pixels);
+}
+
+void pixconv_rgb565_to_rgb32(const uint16_t *src, uint32_t *dst, int pixels)
+{
+    ops()->rgb32(src, dst, pixels);
+}
+
+void pixconv_rgb565_to_i420(const uint8_t *src, int src_stride, int width, int height,
+                            uint8_t *dst_y, int stride_y,
+                            uint8_t *dst_u, int stride_u,
+                            uint8_t *dst_v, int stride_v)
+{
+    i420_rows_fn rows = ops()->i420_rows;
+    int row;
+
+    for (row = 0; row < height; row += 2) {
+        const uint16_t *s0 = (const uint16_t *)(src + (size_t)row * src_stride);
+        int last = (row + 1 >= height); // 高度为奇数时最后一行单独处理
+        const uint16_t *s1 = last ? s0 : (const uint16_t *)(src + (size_t)(row + 1) * src_stride);
+        rows(s0, s1, width,
+             dst_y + (size_t)row * stride_y,
+             last ? NULL : dst_y + (size_t)(row + 1) * stride_y,
+             dst_u + (size_t)(row >> 1) * stride_u,
+             dst_v + (size_t)(row >> 1) * stride_v);
+    }
+}
+
+void pixconv_yuyv_to_i420(const uint8_t *src, int src_stride, int width, int height,
+                          uint8_t *dst_y, int stride_y,
+                          uint8_t *dst_u, int stride_u,
+                          uint8_t *dst_v, int stride_v)
+{
+    yuyv_rows_fn rows = ops()->yuyv_rows;
+    int row;
+
+    for (row = 0; row < height; row += 2) {
+        const uint8_t *s0 = src + (size_t)row * src_stride;
+        int last = (row + 1 >= height); // 高度为奇数时最后一行单独处理
+        const uint8_t *s1 = last ? s0 : src + (size_t)(row + 1) * src_stride;
+        rows(s0, s1, width,
+             dst_y + (size_t)row * stride_y,
+             last ? NULL : dst_y + (size_t)(row + 1) * stride_y,
+             dst_u + (size_t)(row >> 1) * stride_u,
+             dst_v + (size_t)(row >> 1) * stride_v);
+    }
+}
+
+void pixconv_nv12_to_i420(const uint8_t *src_y, int src_stride_y,
+                          const uint8_t *src_uv, int src_stride_uv,
+                          int width, int height,
+                          uint8_t *dst_y, int stride_y,
+                          uint8_t *dst_u, int stride_u,
+                          uint8_t *dst_v, int stride_v)
+{
+    void (*split)(const uint8_t *, uint8_t *, uint8_t *, int) = ops()->uv_split;
+    const int chroma_w = (width + 1) / 2, chroma_h = (height + 1) / 2;
+    int row;
+
+    // Y 平面格式完全相同，只需按行复制 (行跨度可能不同)
+    for (row = 0; row < height; row++) {
+        memcpy(dst_y + (size_t)row * stride_y, src_y + (size_t)row * src_stride_y, (size_t)width);
+    }
+    for (row = 0; row < chroma_h; row++) {
+        split(src_uv + (size_t)row * src_stride_uv,
+              dst_u + (size_t)row * stride_u,
+              dst_v + (size_t)row * stride_v, chroma_w);
+    }
+}
+
+void pixconv_downscale_luma(const uint8_t *src, int src_stride, int width, int height,
+                            uint8_t *dst, int dst_stride, int dst_width, int dst_height)
+{
+    const int fx = width / dst_width;
+    const int fy = height / dst_height;
+    const uint32_t area = (uint32_t)(fx * fy);
+    int x, y, r, k;
+
+    if (fx <= 0 || fy <= 0) {
+        return;
+    }
+    if (fx == 2 && fy == 2) {
+        // 最常见的 2 倍缩小 (640x480 -> 320x240) 使用向量化内核
+        void (*half)(const uint8_t *, const uint8_t *, uint8_t *, int) = ops()->half_row;
+        for (y = 0; y < dst_height; y++) {
+            const uint8_t *s0 = src + (size_t)y * 2 * src_stride;
+            half(s0, s0 + src_stride, dst + (size_t)y * dst_stride, dst_width);
+        }
+        return;
+    }
+    for (y = 0; y < dst_height; y++) {
+        const uint8_t *block_row = src + (size_t)y * fy * src_stride;
+        for (x = 0; x < dst_width; x++) {
+            // fy 个源行的 fx 个像素求和 (源块的各行在同一组缓存行中，按行读取)
+            uint32_t sum = 0;
+            for (r = 0; r < fy; r++) {
+                const uint8_t *p = block_row + (size_t)r * src_stride + x * fx;
+                for (k = 0; k < fx; k++) {
+                    sum += p[k];
+                }
+            }
+            dst[(size_t)y * dst_stride + x] = (uint8_t)((sum + area / 2) / area);
+        }
+    }
+}
+
+void pixconv_downscale_i420(const uint8_t *src_y, int src_stride_y,
+                            const uint8_t *src_u, int src_stride_u,
+                            const uint8_t *src_v, int src_stride_v,
+                            int width, int height,
+                            uint8_t *dst_y, int dst_stride_y,
+                            uint8_t *dst_u, int dst_stride_u,
+                            uint8_t *dst_v, int dst_stride_v,
+                            int dst_width, int dst_height)
+{
+    pixconv_downscale_luma(src_y, src_stride_y, width, height, dst_y, dst_stride_y, dst_width, dst_height);
+    pixconv_downscale_luma(src_u, src_stride_u, width / 2, height / 2, dst_u, dst_stride_u, dst_width / 2, dst_height / 2);
+    pixconv_downscale_luma(src_v, src_stride_v, width / 2, height / 2, dst_v, dst_stride_v, dst_width / 2, dst_height / 2);
+}
+
+void pixconv_block_sad16(const uint8_t *a, const uint8_t *b, int stride, int width, int height,
+                         int block_rows, uint32_t *sads)
+{
+    void (*row_sad)(const uint8_t *, const uint8_t *, int, uint32_t *) = ops()->sad16_row;
+    const int blocks = width / 16;
+    int y;
+
+    memset(sads, 0, sizeof(uint32_t) * (size_t)(blocks * block_rows));
+    for (y = 0; y < height; y++) {
+        const size_t offset = (size_t)y * stride;
+        row_sad(a + offset, b + offset, blocks, sads + (y * block_rows / height) * blocks);
+    }
+}
+
+void pixconv_yuyv_to_rgb32(const uint8_t *src, uint32_t *dst, int pixels)
+{
+    int i;
+    for (i = 0; i < pixels; i += 2) {
+        const uint8_t *p = src + i * 2;
+        int d = p[1] - 128, e = p[3] - 128;
+        dst[i] = YUV_TO_RGB32(p[0] - 16, d, e);
+        if (i + 1 < pixels) {
+            dst[i + 1] = YUV_TO_RGB32(p[2] - 16, d, e);
+        }
+    }
+}
+
+void pixconv_nv12_to_rgb32(const uint8_t *src_y, const uint8_t *src_uv, uint32_t *dst, int pixels)
+{
+    int i;
+    for (i = 0; i < pixels; i++) {
+        const uint8_t *c = src_uv + (i & ~1); // 每两个像素共用一对 U/V
+        dst[i] = YUV_TO_RGB32(src_y[i] - 16, c[0] - 128, c[1] - 128);
+    }
+}
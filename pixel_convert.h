@@ -0,0 +1,188 @@
+/**
+ * @file pixel_convert.h
+ * @brief 像素格式转换模块的头文件
+ *
+ * 此头文件声明了采集链路上使用的像素格式转换函数：
+ * - RGB565 -> RGB888 (兼容旧的 v4l2_get_frame 接口)。
+ * - RGB565 -> RGB32  (Qt 的 QImage::Format_RGB32，用于界面预览)。
+ * - RGB565 -> I420 (YUV420P)，直接写入 AVFrame 的三个平面，录制时无需再经过 swscale。
+ * - YUYV / NV12 -> I420，摄像头直接输出 YUV 时只需解交织，不做色彩空间转换。
+ * - YUYV / NV12 -> RGB32，用于界面预览 (仅标量实现)。
+ * - 亮度平面缩小和块 SAD，用于移动侦测 (见 `MotionDetector`)。
+ *
+ * 除 YUV -> RGB32 外，每个函数都有标量实现和向量化实现 (x86 上为 SSE2/SSSE3/AVX2，ARM 上为 NEON)，
+ * 首次调用时根据 CPU 能力自动选择最快的实现 (运行时分派)。
+ * 所有实现的输出逐字节一致，因此可以互相替换。
+ * 设计为纯C接口，以便于C和C++项目调用。
+ */
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 可选的转换内核实现。
+ */
+typedef enum pixconv_backend {
+    PIXCONV_BACKEND_AUTO = 0,  /**< 根据 CPU 能力自动选择 (默认)。 */
+    PIXCONV_BACKEND_SCALAR,    /**< 逐像素标量实现，所有平台可用。 */
+    PIXCONV_BACKEND_SSE2,      /**< x86 SSE2 (RGB888 部分使用 SSSE3)。 */
+    PIXCONV_BACKEND_AVX2,      /**< x86 AVX2。 */
+    PIXCONV_BACKEND_NEON       /**< ARM NEON (ARMv7 需要 -mfpu=neon，AArch64 默认支持)。 */
+} pixconv_backend;
+
+/**
+ * @brief 强制选择某一种内核实现 (主要用于基准测试和对比)。
+ *
+ * @param backend 期望的实现。传入 PIXCONV_BACKEND_AUTO 恢复自动选择。
+ * @return 成功返回0；当前 CPU 或编译配置不支持该实现时返回-1，原有选择保持不变。
+ */
+int pixconv_select_backend(pixconv_backend backend);
+
+/**
+ * @brief 获取当前生效的内核实现名称 (例如 "neon", "avx2", "scalar")，用于日志输出。
+ */
+const char *pixconv_backend_name(void);
+
+/**
+ * @brief 将RGB565像素转换为RGB888 (内存顺序 R,G,B)。
+ *
+ * @param src 源RGB565数据。
+ * @param dst 目标缓冲区，大小至少为 pixels * 3 字节。
+ * @param pixels 要转换的像素数量。
+ */
+void pixconv_rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, int pixels);
+
+/**
+ * @brief 将RGB565像素转换为32位 0xffRRGGBB (与 QImage::Format_RGB32 一致)。
+ *
+ * @param src 源RGB565数据。
+ * @param dst 目标缓冲区，大小至少为 pixels 个 uint32_t。
+ * @param pixels 要转换的像素数量。
+ */
+void pixconv_rgb565_to_rgb32(const uint16_t *src, uint32_t *dst, int pixels);
+
+/**
+ * @brief 将一帧RGB565图像直接转换为I420 (YUV420P，BT.601 有限范围)。
+ *
+ * 亮度逐像素计算，色度取 2x2 像素块的平均值后计算。宽高为奇数时边缘像素会被复制。
+ * 目标平面可以直接是 AVFrame 的 data[0..2] / linesize[0..2]。
+ *
+ * @param src 源RGB565图像起始地址。
+ * @param src_stride 源图像每行字节数。
+ * @param width 图像宽度 (像素)。
+ * @param height 图像高度 (像素)。
+ * @param dst_y Y 平面起始地址，dst_u / dst_v 为色度平面 (尺寸为 (width+1)/2 x (height+1)/2)。
+ * @param stride_y Y 平面每行字节数，stride_u / stride_v 同理。
+ */
+void pixconv_rgb565_to_i420(const uint8_t *src, int src_stride, int width, int height,
+                            uint8_t *dst_y, int stride_y,
+                            uint8_t *dst_u, int stride_u,
+                            uint8_t *dst_v, int stride_v);
+
+/**
+ * @brief 将一帧 YUYV (YUV 4:2:2 打包) 图像转换为 I420。
+ *
+ * 亮度直接复制，色度取上下两行的平均值 (四舍五入)。高度为奇数时最后一行色度直接复制。
+ * 参数含义同 `pixconv_rgb565_to_i420()`。
+ */
+void pixconv_yuyv_to_i420(const uint8_t *src, int src_stride, int width, int height,
+                          uint8_t *dst_y, int stride_y,
+                          uint8_t *dst_u, int stride_u,
+                          uint8_t *dst_v, int stride_v);
+
+/**
+ * @brief 将一帧 NV12 (Y 平面 + 交织 UV 平面) 图像转换为 I420。
+ *
+ * Y 平面按行复制，UV 平面拆分为 U、V 两个平面，不做任何数值运算。
+ *
+ * @param src_y 源 Y 平面起始地址，src_stride_y 为其每行字节数。
+ * @param src_uv 源 UV 平面起始地址 (V4L2 单平面 NV12 中紧跟在 Y 平面之后)，src_stride_uv 为其每行字节数。
+ * @param width 图像宽度 (像素)。
+ * @param height 图像高度 (像素)。
+ * @param dst_y 目标平面及行跨度含义同 `pixconv_rgb565_to_i420()`。
+ */
+void pixconv_nv12_to_i420(const uint8_t *src_y, int src_stride_y,
+                          const uint8_t *src_uv, int src_stride_uv,
+                          int width, int height,
+                          uint8_t *dst_y, int stride_y,
+                          uint8_t *dst_u, int stride_u,
+                          uint8_t *dst_v, int stride_v);
+
+/**
+ * @brief 将一行 YUYV 像素转换为 RGB32 (0xffRRGGBB，BT.601 有限范围)。
+ *
+ * @param src 源 YUYV 数据 (每两个像素4字节)。
+ * @param dst 目标缓冲区，大小至少为 pixels 个 uint32_t。
+ * @param pixels 要转换的像素数量。
+ */
+void pixconv_yuyv_to_rgb32(const uint8_t *src, uint32_t *dst, int pixels);
+
+/**
+ * @brief 将一行 NV12 像素转换为 RGB32 (0xffRRGGBB，BT.601 有限范围)。
+ *
+ * @param src_y 本行亮度数据。
+ * @param src_uv 本行对应的交织色度数据 (第 row/2 行 UV)。
+ * @param dst 目标缓冲区，大小至少为 pixels 个 uint32_t。
+ * @param pixels 要转换的像素数量。
+ */
+void pixconv_nv12_to_rgb32(const uint8_t *src_y, const uint8_t *src_uv, uint32_t *dst, int pixels);
+
+/**
+ * @brief 把一个 8 位平面 (亮度或色度) 按整数倍块平均缩小。
+ *
+ * 缩小倍数为 width / dst_width 和 height / dst_height (向下取整)，不能整除时丢弃右侧和底部多余的像素。
+ * 水平和垂直都是 2 倍时使用 SSE2 / NEON 内核，其它倍数为标量实现；所有实现输出一致。
+ *
+ * @param src 源亮度平面 (例如录制线程 AVFrame 的 data[0])。
+ * @param src_stride 源行跨度 (字节)。
+ * @param width 源图像宽度，不能小于 dst_width。
+ * @param height 源图像高度，不能小于 dst_height。
+ * @param dst 目标缓冲区。
+ * @param dst_stride 目标行跨度 (字节)。
+ * @param dst_width 目标宽度。
+ * @param dst_height 目标高度。
+ */
+void pixconv_downscale_luma(const uint8_t *src, int src_stride, int width, int height,
+                            uint8_t *dst, int dst_stride, int dst_width, int dst_height);
+
+/**
+ * @brief 把一帧 I420 (YUV420P) 图像按整数倍块平均缩小，三个平面分别调用 `pixconv_downscale_luma()`。
+ *
+ * 用于从录制线程转换好的主码流帧直接得到子码流帧，不需要再次做色彩空间转换。
+ * 色度平面的尺寸为亮度的一半 (向下取整)，dst_width / dst_height 应为偶数。
+ */
+void pixconv_downscale_i420(const uint8_t *src_y, int src_stride_y,
+                            const uint8_t *src_u, int src_stride_u,
+                            const uint8_t *src_v, int src_stride_v,
+                            int width, int height,
+                            uint8_t *dst_y, int dst_stride_y,
+                            uint8_t *dst_u, int dst_stride_u,
+                            uint8_t *dst_v, int dst_stride_v,
+                            int dst_width, int dst_height);
+
+/**
+ * @brief 计算两幅同尺寸亮度图按块划分后每块的绝对差之和 (SAD)。
+ *
+ * 块宽固定为 16 像素，共 width / 16 列；图像在垂直方向均分为 block_rows 行块。
+ *
+ * @param a 第一幅图像。
+ * @param b 第二幅图像 (与 a 行跨度相同)。
+ * @param stride 行跨度 (字节)。
+ * @param width 图像宽度，应为 16 的倍数 (多余的像素不参与计算)。
+ * @param height 图像高度。
+ * @param block_rows 行块数，不大于 height。
+ * @param sads 输出，大小至少为 (width / 16) * block_rows，按行块优先排列。
+ */
+void pixconv_block_sad16(const uint8_t *a, const uint8_t *b, int stride, int width, int height,
+                         int block_rows, uint32_t *sads);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // PIXEL_CONVERT_H
@@ -0,0 +1,54 @@
+#ifndef PREVIEWFRAME_H
+#define PREVIEWFRAME_H
+
+#include <QByteArray>
+#include <QImage>
+
+/**
+ * @brief 一帧待显示的预览画面 (PreviewFrame)
+ *
+ * GPU 预览 (`PreviewWidget`) 使用的原始帧：采集线程只把驱动缓冲区复制一份，不做色彩空间转换和缩放，
+ * 由着色器在GPU上完成 YUV -> RGB 转换和缩放。MJPEG 仍在采集线程中解码，以 RGB32 图像的形式给出。
+ *
+ * 采集线程、信箱、GUI 线程和预览控件之间通过交换 (`swap()`) 传递帧，而不是复制，
+ * 各自持有的缓冲区引用计数始终为1，稳态预览时不分配内存。
+ */
+struct PreviewFrame {
+    /**
+     * @brief 像素格式。
+     */
+    enum Format {
+        None,   ///< 无效帧。
+        Rgb565, ///< RGB565 小端 (`data`)。
+        Yuyv,   ///< YUYV 4:2:2 打包 (`data`)。
+        Nv12,   ///< NV12：Y 平面后紧跟交织的 UV 平面，行跨度相同 (`data`)。
+        Rgb32   ///< QImage::Format_RGB32 (`image`，MJPEG 解码结果)。
+    };
+
+    Format format = None; ///< 像素格式。
+    int width = 0;        ///< 图像宽度 (像素)。
+    int height = 0;       ///< 图像高度 (像素)。
+    int stride = 0;       ///< `data` 每行字节数 (Rgb32 时为 `image.bytesPerLine()`)。
+    QByteArray data;      ///< 原始像素数据 (Rgb565 / Yuyv / Nv12)。
+    QImage image;         ///< 解码后的图像 (Rgb32)。
+
+    /**
+     * @brief 与另一帧交换全部内容 (不复制像素数据)。
+     */
+    void swap(PreviewFrame &other)
+    {
+        qSwap(format, other.format);
+        qSwap(width, other.width);
+        qSwap(height, other.height);
+        qSwap(stride, other.stride);
+        data.swap(other.data);
+        image.swap(other.image);
+    }
+
+    /**
+     * @brief 是否为有效帧。
+     */
+    bool isValid() const { return format != None && width > 0 && height > 0; }
+};
+
+#endif // PREVIEWFRAME_H
@@ -0,0 +1,225 @@
+/**
+ * @file previewwidget.cpp
+ * @brief GPU 预览控件 (PreviewWidget) 的实现文件。
+ *
+ * GUI 线程每帧的工作只剩一次 (或两次) 纹理上传和一次四边形绘制，
+ * 不再有 QPixmap::fromImage() 的格式转换、scaled() 的软件缩放以及每帧的图像分配。
+ */
+
+#include "previewwidget.h"
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLContext>
+#include <QPainter>
+#include <QDebug>
+
+// 顶点着色器：全视口四边形，纹理坐标的 y 轴向下 (图像第一行在上)
+static const char *const VERTEX_SHADER =
+    "attribute vec2 position;\n"
+    "attribute vec2 texCoord;\n"
+    "varying vec2 vTexCoord;\n"
+    "void main() {\n"
+    "    vTexCoord = texCoord;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+// 片段着色器：mode 0 = RGB 纹理；1 = RGBA 纹理保存的 BGRX (QImage RGB32)；
+// 2 = YUV，tex0.r 为 Y，tex1.g / tex1.a 为 U / V (亮度+Alpha 纹理的 g 等于亮度)。
+// BT.601 有限范围，系数与 pixel_convert.c 的软件转换一致。
+static const char *const FRAGMENT_SHADER =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D tex0;\n"
+    "uniform sampler2D tex1;\n"
+    "uniform int mode;\n"
+    "varying vec2 vTexCoord;\n"
+    "void main() {\n"
+    "    vec4 c = texture2D(tex0, vTexCoord);\n"
+    "    if (mode == 0) {\n"
+    "        gl_FragColor = vec4(c.rgb, 1.0);\n"
+    "    } else if (mode == 1) {\n"
+    "        gl_FragColor = vec4(c.bgr, 1.0);\n"
+    "    } else {\n"
+    "        vec4 uv = texture2D(tex1, vTexCoord);\n"
+    "        float y = 1.164 * (c.r - 0.0627);\n"
+    "        float u = uv.g - 0.502;\n"
+    "        float v = uv.a - 0.502;\n"
+    "        gl_FragColor = vec4(y + 1.596 * v, y - 0.813 * v - 0.391 * u, y + 2.018 * u, 1.0);\n"
+    "    }\n"
+    "}\n";
+
+// 着色器转换模式
+static const int MODE_RGB = 0;
+static const int MODE_BGRX = 1;
+static const int MODE_YUV = 2;
+
+PreviewWidget::PreviewWidget(QWidget *parent)
+    : QOpenGLWidget(parent)
+    , m_program(nullptr)
+    , m_programReady(false)
+    , m_frameDirty(false)
+    , m_mode(MODE_RGB)
+{
+}
+
+PreviewWidget::~PreviewWidget()
+{
+    // 纹理和着色器属于本控件的 GL 上下文，释放前先切换到它
+    makeCurrent();
+    for (Plane &plane : m_planes) {
+        if (plane.texture) {
+            glDeleteTextures(1, &plane.texture);
+        }
+    }
+    delete m_program;
+    doneCurrent();
+}
+
+bool PreviewWidget::isSupported()
+{
+    QOpenGLContext context;
+    return context.create();
+}
+
+void PreviewWidget::setFrame(PreviewFrame &frame)
+{
+    m_frame.swap(frame);
+    m_frameDirty = true;
+    m_message.clear();
+    update(); // 合并到下一次重绘，GUI 繁忙时只上传最新的一帧
+}
+
+void PreviewWidget::setMessage(const QString &text)
+{
+    m_message = text;
+    m_frame.format = PreviewFrame::None; // 保留缓冲区，只让画面不再显示
+    update();
+}
+
+void PreviewWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    m_program = new QOpenGLShaderProgram(this);
+    m_programReady = m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER)
+            && m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER)
+            && m_program->link();
+    if (!m_programReady) {
+        qWarning() << "预览着色器编译失败:" << m_program->log();
+    }
+
+    for (Plane &plane : m_planes) {
+        glGenTextures(1, &plane.texture);
+        glBindTexture(GL_TEXTURE_2D, plane.texture);
+        // 线性过滤完成缩放；ES 2.0 的非2的幂纹理只支持 CLAMP_TO_EDGE 且不能使用 mipmap
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    m_frameDirty = true; // 上下文重建 (例如控件换了顶层窗口) 后纹理内容需要重新上传
+}
+
+void PreviewWidget::uploadPlane(Plane &plane, GLenum format, GLenum type, int width, int height,
+                                const uchar *data, int stride, int bytesPerTexel)
+{
+    glBindTexture(GL_TEXTURE_2D, plane.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (plane.width != width || plane.height != height || plane.format != format || plane.type != type) {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, type, nullptr);
+        plane.width = width;
+        plane.height = height;
+        plane.format = format;
+        plane.type = type;
+    }
+    if (stride == width * bytesPerTexel) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, data);
+    } else {
+        for (int row = 0; row < height; row++) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, 1, format, type, data + (size_t)row * stride);
+        }
+    }
+}
+
+int PreviewWidget::uploadFrame()
+{
+    const uchar *data = reinterpret_cast<const uchar *>(m_frame.data.constData());
+    const int w = m_frame.width;
+    const int h = m_frame.height;
+
+    switch (m_frame.format) {
+    case PreviewFrame::Rgb565:
+        uploadPlane(m_planes[0], GL_RGB, GL_UNSIGNED_SHORT_5_6_5, w, h, data, m_frame.stride, 2);
+        return MODE_RGB;
+    case PreviewFrame::Yuyv:
+        // 亮度+Alpha 纹理：每个纹素 (Y, U 或 V)，取 r 得到全分辨率的 Y；
+        // RGBA 半宽纹理：每个纹素 (Y0, U, Y1, V)，取 g / a 得到 U / V
+        uploadPlane(m_planes[0], GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, w, h, data, m_frame.stride, 2);
+        uploadPlane(m_planes[1], GL_RGBA, GL_UNSIGNED_BYTE, w / 2, h, data, m_frame.stride, 4);
+        return MODE_YUV;
+    case PreviewFrame::Nv12:
+        uploadPlane(m_planes[0], GL_LUMINANCE, GL_UNSIGNED_BYTE, w, h, data, m_frame.stride, 1);
+        uploadPlane(m_planes[1], GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, (w + 1) / 2, (h + 1) / 2,
+                    data + (size_t)m_frame.stride * h, m_frame.stride, 2);
+        return MODE_YUV;
+    case PreviewFrame::Rgb32:
+        uploadPlane(m_planes[0], GL_RGBA, GL_UNSIGNED_BYTE, w, h, m_frame.image.constBits(), m_frame.stride, 4);
+        return MODE_BGRX;
+    default:
+        return MODE_RGB;
+    }
+}
+
+void PreviewWidget::paintGL()
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (m_programReady && m_frame.isValid()) {
+        if (m_frameDirty) {
+            m_mode = uploadFrame();
+            m_frameDirty = false;
+        }
+
+        // 保持宽高比居中显示 (相当于 Qt::KeepAspectRatio)，缩放由纹理过滤完成
+        const int dpr = devicePixelRatio();
+        const int viewW = width() * dpr;
+        const int viewH = height() * dpr;
+        int drawW = viewW;
+        int drawH = (int)((qint64)viewW * m_frame.height / m_frame.width);
+        if (drawH > viewH) {
+            drawH = viewH;
+            drawW = (int)((qint64)viewH * m_frame.width / m_frame.height);
+        }
+        glViewport((viewW - drawW) / 2, (viewH - drawH) / 2, drawW, drawH);
+        glDisable(GL_BLEND);       // QPainter 绘制提示文字后可能留下混合状态
+        glDisable(GL_DEPTH_TEST);
+
+        static const GLfloat positions[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        static const GLfloat texCoords[] = { 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+
+        m_program->bind();
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_planes[1].texture);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_planes[0].texture);
+        m_program->setUniformValue("tex0", 0);
+        m_program->setUniformValue("tex1", 1);
+        m_program->setUniformValue("mode", m_mode);
+        m_program->enableAttributeArray("position");
+        m_program->enableAttributeArray("texCoord");
+        m_program->setAttributeArray("position", positions, 2);
+        m_program->setAttributeArray("texCoord", texCoords, 2);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_program->disableAttributeArray("position");
+        m_program->disableAttributeArray("texCoord");
+        m_program->release();
+    }
+
+    if (!m_message.isEmpty()) {
+        QPainter painter(this); // 在 GL 绘制之后叠加文字，QPainter 会自行设置视口
+        painter.setPen(Qt::white);
+        painter.drawText(rect(), Qt::AlignCenter, m_message);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef PREVIEWWIDGET_H
+#define PREVIEWWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QString>
+
+#include "previewframe.h"
+
+class QOpenGLShaderProgram;
+
+/**
+ * @brief GPU 预览控件 (PreviewWidget)
+ *
+ * 取代 "QImage -> QPixmap::fromImage() -> scaled() -> QLabel::setPixmap()" 的软件预览路径：
+ * - 每帧只把采集线程复制出的原始数据上传为纹理 (`glTexSubImage2D`)，不在CPU上做色彩空间转换或缩放。
+ * - RGB565 直接上传为 GL_UNSIGNED_SHORT_5_6_5 纹理；NV12 上传 Y (亮度) 和 UV (亮度+Alpha) 两个纹理；
+ *   YUYV 同一份数据分别以亮度+Alpha (取Y) 和 RGBA 半宽 (取U/V) 上传；MJPEG 解码出的 RGB32 以 RGBA 上传后交换通道。
+ *   YUV -> RGB 在片段着色器中按 BT.601 有限范围计算，与 pixel_convert 的软件实现系数相同。
+ * - 按宽高比居中缩放 (黑边)，由GPU的纹理过滤完成。
+ * - 只使用 OpenGL ES 2.0 的功能 (GLSL ES 1.00、客户端顶点数组)，在嵌入式 GPU 和桌面 OpenGL 上都能运行。
+ *
+ * 控件与同一布局中叠在其上的普通控件 (帧率、录制状态等覆盖层) 正常合成。
+ * 平台没有 OpenGL 时 (`isSupported()` 返回 false) 调用者应退回软件预览。
+ */
+class PreviewWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewWidget(QWidget *parent = nullptr);
+
+    /**
+     * @brief 析构函数，在控件的 GL 上下文中释放纹理和着色器。
+     */
+    ~PreviewWidget();
+
+    /**
+     * @brief 当前平台能否创建 OpenGL (ES) 上下文。需要在 QApplication 创建之后调用。
+     */
+    static bool isSupported();
+
+    /**
+     * @brief 显示一帧新画面 (GUI 线程)，在下一次重绘时上传。
+     * @param frame 输入输出参数：与控件当前持有的帧交换，返回后 frame 中是上一帧的缓冲区，
+     *              调用者可以把它交还给采集线程复用 (见 `CaptureThread::takeLatestFrame()`)。
+     *
+     * 设置新帧会清除 `setMessage()` 显示的提示文字。
+     */
+    void setFrame(PreviewFrame &frame);
+
+    /**
+     * @brief 清除画面并在控件中央显示提示文字 (例如 "摄像头不可用")；text 为空时只清除画面。
+     */
+    void setMessage(const QString &text);
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    /**
+     * @brief 一个纹理及其当前分配的尺寸和格式。
+     */
+    struct Plane {
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        GLenum format = 0;
+        GLenum type = 0;
+    };
+
+    /**
+     * @brief 把一个平面上传到纹理，尺寸或格式变化时重新分配纹理存储。
+     * @param plane 目标纹理。
+     * @param format 纹理格式 (GL_LUMINANCE / GL_LUMINANCE_ALPHA / GL_RGB / GL_RGBA)。
+     * @param type 像素数据类型 (GL_UNSIGNED_BYTE / GL_UNSIGNED_SHORT_5_6_5)。
+     * @param width 纹理宽度 (纹素)。
+     * @param height 纹理高度 (纹素)。
+     * @param data 第一行数据。
+     * @param stride 源数据每行字节数；与紧密排列的行宽不一致时逐行上传 (ES 2.0 没有 GL_UNPACK_ROW_LENGTH)。
+     * @param bytesPerTexel 每纹素字节数。
+     */
+    void uploadPlane(Plane &plane, GLenum format, GLenum type, int width, int height,
+                     const uchar *data, int stride, int bytesPerTexel);
+
+    /**
+     * @brief 按当前帧的格式上传所有平面。
+     * @return 着色器的转换模式 (见片段着色器中的 mode)。
+     */
+    int uploadFrame();
+
+    QOpenGLShaderProgram *m_program; ///< YUV/RGB -> RGB 着色器程序，`initializeGL()` 中创建。
+    bool m_programReady;             ///< 着色器是否编译链接成功。
+    Plane m_planes[2];               ///< 纹理单元0 (Y 或 RGB) 和纹理单元1 (UV)。
+    PreviewFrame m_frame;            ///< 当前显示的帧。
+    bool m_frameDirty;               ///< 当前帧尚未上传。
+    int m_mode;                      ///< 已上传帧的着色器转换模式。
+    QString m_message;               ///< 提示文字，为空时不显示。
+};
+
+#endif // PREVIEWWIDGET_H
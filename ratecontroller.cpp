@@ -0,0 +1,128 @@
+/**
+ * @file ratecontroller.cpp
+ * @brief 编码自适应控制器 (RateController) 的实现文件。
+ */
+
+#include "ratecontroller.h"
+
+#include <QtGlobal>
+
+// 先降码率 (对能运行中修改码率的编码器立即生效，CPU 开销略降)，再降帧率 (直接减少转换和编码的帧数)
+const RateController::Level RateController::LEVELS[RateController::LEVEL_COUNT] = {
+    {100, 1},
+    {80, 1},
+    {65, 2},
+    {50, 3},
+};
+
+RateController::RateController()
+    : m_baseBitRate(0)
+    , m_frameIntervalUs(0)
+    , m_level(0)
+    , m_frameCounter(0)
+    , m_processUs(-1)
+    , m_lastChangeUs(-1)
+    , m_calmSinceUs(-1)
+    , m_lastMotionUs(-1)
+    , m_lowMotion(false)
+    , m_loadLimited(false)
+{
+}
+
+void RateController::configure(const Settings &settings, int64_t baseBitRate, int64_t frameIntervalUs)
+{
+    m_settings = settings;
+    m_settings.lowMotionGopFactor = qMax(1, settings.lowMotionGopFactor);
+    m_baseBitRate = baseBitRate;
+    m_frameIntervalUs = qMax<int64_t>(1, frameIntervalUs);
+    reset();
+}
+
+void RateController::reset()
+{
+    m_level = 0;
+    m_frameCounter = 0;
+    m_processUs = -1;
+    m_lastChangeUs = -1;
+    m_calmSinceUs = -1;
+    m_lastMotionUs = -1;
+    m_lowMotion = false;
+    m_loadLimited = false;
+}
+
+bool RateController::acceptFrame()
+{
+    const int divisor = frameDivisor();
+    if (divisor <= 1) {
+        m_frameCounter = 0;
+        return true;
+    }
+    return m_frameCounter++ % divisor == 0;
+}
+
+int64_t RateController::bitRate() const
+{
+    int64_t rate = m_baseBitRate * LEVELS[m_level].bitRatePercent / 100;
+    if (m_lowMotion) {
+        rate = rate * m_settings.lowMotionBitRatePercent / 100;
+    }
+    return rate;
+}
+
+void RateController::setLevel(int level, long long timestampUs)
+{
+    m_level = level;
+    m_lastChangeUs = timestampUs;
+    m_calmSinceUs = -1;
+    m_frameCounter = 0;
+}
+
+bool RateController::update(long long timestampUs, int queueDepth, int queueCapacity, int64_t processUs,
+                            bool motionKnown, bool motion)
+{
+    const int oldLevel = m_level;
+    const bool oldLowMotion = m_lowMotion;
+
+    // 处理时间按 1/8 的权重平滑，单帧的关键帧或调度抖动不会触发降级
+    m_processUs = m_processUs < 0 ? processUs : m_processUs + (processUs - m_processUs) / 8;
+
+    // 负载：处理一帧的时间占每个编码帧可用时间 (帧间隔 x 分频) 的比例
+    const int queuePercent = queueCapacity > 0 ? queueDepth * 100 / queueCapacity : 0;
+    const int64_t loadPercent = m_processUs * 100 / (m_frameIntervalUs * frameDivisor());
+    if (m_lastChangeUs < 0) {
+        m_lastChangeUs = timestampUs; // 会话开始的 degradeMs 内不降级 (编码器第一帧通常较慢)
+    }
+    const bool sinceChange = timestampUs - m_lastChangeUs >= (long long)m_settings.degradeMs * 1000;
+
+    if ((queuePercent > m_settings.highQueuePercent || loadPercent > m_settings.highLoadPercent)
+            && m_level < LEVEL_COUNT - 1 && sinceChange) {
+        if (loadPercent > m_settings.highLoadPercent) {
+            m_loadLimited = true;
+        }
+        setLevel(m_level + 1, timestampUs);
+    } else if (m_level > 0) {
+        // 恢复前按上一级的分频估算负载，避免恢复帧率后立刻又超载 (来回振荡)
+        const int64_t nextLoadPercent = m_processUs * 100 / (m_frameIntervalUs * LEVELS[m_level - 1].frameDivisor);
+        if (queuePercent < m_settings.lowQueuePercent && nextLoadPercent < m_settings.lowLoadPercent) {
+            if (m_calmSinceUs < 0) {
+                m_calmSinceUs = timestampUs;
+            } else if (timestampUs - m_calmSinceUs >= (long long)m_settings.recoverMs * 1000) {
+                setLevel(m_level - 1, timestampUs);
+            }
+        } else {
+            m_calmSinceUs = -1;
+        }
+    }
+
+    // 低运动模式：静止足够久才进入，检测到移动立即退出
+    if (!motionKnown) {
+        m_lowMotion = false;
+    } else if (motion || m_lastMotionUs < 0) {
+        m_lastMotionUs = timestampUs; // 会话的第一帧也从这里开始计算静止时间
+        m_lowMotion = false;
+    } else if (timestampUs - m_lastMotionUs >= (long long)m_settings.staticMs * 1000) {
+        m_lowMotion = true;
+    }
+
+    return m_level != oldLevel || m_lowMotion != oldLowMotion;
+}
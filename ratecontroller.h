@@ -0,0 +1,139 @@
+#ifndef RATECONTROLLER_H
+#define RATECONTROLLER_H
+
+#include <stdint.h>
+
+/**
+ * @brief 编码自适应控制器 (RateController)
+ *
+ * 录制线程每处理完一帧调用一次 `update()`，按帧队列占用和每帧处理时间 (转换 + 编码 + 封装) 判断压力：
+ * - 队列占用超过 highQueuePercent，或处理时间超过当前帧间隔的 highLoadPercent 时降一级；
+ *   两次降级至少间隔 degradeMs，等上一级生效后再判断。
+ * - 队列占用低于 lowQueuePercent，且按上一级的帧间隔估算的负载低于 lowLoadPercent，持续 recoverMs 后升一级。
+ * 各级依次降低目标码率 (只对支持运行中修改码率的编码器生效，见 `EncoderBackend::setBitRate()`)
+ * 和编码帧率 (录制线程按 `acceptFrame()` 抽帧，时间戳取自采集时间，跳过的帧只让帧间隔变大)。
+ *
+ * 低运动模式：移动侦测报告静止超过 staticMs 后，目标码率再乘以 lowMotionBitRatePercent，
+ * 关键帧间隔放大 lowMotionGopFactor 倍；检测到移动立即退出。
+ *
+ * 所有时间按采集时间戳计算，不读系统时钟。只在录制线程中使用，不是线程安全的。
+ */
+class RateController
+{
+public:
+    /**
+     * @brief 控制参数。
+     */
+    struct Settings {
+        int highQueuePercent = 50;   ///< 队列占用 (%) 超过该值时降级。
+        int lowQueuePercent = 15;    ///< 队列占用 (%) 低于该值才允许升级。
+        int highLoadPercent = 90;    ///< 每帧处理时间占帧间隔的比例 (%) 超过该值时降级。
+        int lowLoadPercent = 70;     ///< 升级后的预计负载 (%) 低于该值才允许升级。
+        int degradeMs = 500;         ///< 两次降级之间的最短间隔 (毫秒)。
+        int recoverMs = 3000;        ///< 低压力持续多久升一级 (毫秒)。
+        int staticMs = 10000;        ///< 静止多久进入低运动模式 (毫秒)。
+        int lowMotionBitRatePercent = 50; ///< 低运动模式的码率比例 (%)。
+        int lowMotionGopFactor = 4;  ///< 低运动模式的关键帧间隔倍数。
+    };
+
+    /**
+     * @brief 一个降级等级。
+     */
+    struct Level {
+        int bitRatePercent; ///< 目标码率占基准码率的比例 (%)。
+        int frameDivisor;   ///< 编码帧率分频 (每 N 帧编码一帧)。
+    };
+
+    static const int LEVEL_COUNT = 4; ///< 等级数，0 为不降级。
+
+    RateController();
+
+    /**
+     * @brief 设置参数并回到最高等级 (会话开始时调用)。
+     * @param settings 控制参数。
+     * @param baseBitRate 基准目标码率 (bps)。
+     * @param frameIntervalUs 标称帧间隔 (微秒)。
+     */
+    void configure(const Settings &settings, int64_t baseBitRate, int64_t frameIntervalUs);
+
+    /**
+     * @brief 回到最高等级并清除负载估计和静止计时。
+     */
+    void reset();
+
+    /**
+     * @brief 按当前帧率分频决定是否处理这一帧 (每个出队的帧调用一次)。
+     * @return 需要转换、编码时返回 true；返回 false 时直接丢弃。
+     */
+    bool acceptFrame();
+
+    /**
+     * @brief 报告一帧的处理结果，必要时调整等级或低运动模式。
+     * @param timestampUs 这一帧的采集时间戳 (微秒)。
+     * @param queueDepth 取出这一帧后队列中剩余的帧数。
+     * @param queueCapacity 队列容量。
+     * @param processUs 这一帧的转换、编码和封装耗时 (微秒)。
+     * @param motionKnown 本次会话是否做移动侦测 (否则不进入低运动模式)。
+     * @param motion 移动侦测当前是否为 "移动中"。
+     * @return 目标码率、帧率分频或关键帧间隔发生变化时返回 true。
+     */
+    bool update(long long timestampUs, int queueDepth, int queueCapacity, int64_t processUs,
+                bool motionKnown, bool motion);
+
+    /**
+     * @brief 当前等级 (0 ~ LEVEL_COUNT-1)。
+     */
+    int level() const { return m_level; }
+
+    /**
+     * @brief 当前目标码率 (bps)。
+     */
+    int64_t bitRate() const;
+
+    /**
+     * @brief 当前编码帧率分频。
+     */
+    int frameDivisor() const { return LEVELS[m_level].frameDivisor; }
+
+    /**
+     * @brief 当前关键帧间隔倍数 (低运动模式时为 lowMotionGopFactor，否则为1)。
+     */
+    int gopFactor() const { return m_lowMotion ? m_settings.lowMotionGopFactor : 1; }
+
+    /**
+     * @brief 是否处于低运动模式。
+     */
+    bool isLowMotion() const { return m_lowMotion; }
+
+    /**
+     * @brief 本次会话是否因为处理时间 (而不只是队列占用) 降过级，即编码器算力不足。
+     */
+    bool wasLoadLimited() const { return m_loadLimited; }
+
+    /**
+     * @brief 由参数中允许的最大倍数决定的关键帧间隔上限倍数 (打开编码器时使用)。
+     */
+    int maxGopFactor() const { return m_settings.lowMotionGopFactor; }
+
+private:
+    static const Level LEVELS[LEVEL_COUNT]; ///< 各等级的码率比例和帧率分频。
+
+    /**
+     * @brief 切换到指定等级。
+     */
+    void setLevel(int level, long long timestampUs);
+
+    Settings m_settings;        ///< 控制参数。
+    int64_t m_baseBitRate;      ///< 基准目标码率 (bps)。
+    int64_t m_frameIntervalUs;  ///< 标称帧间隔 (微秒)。
+    int m_level;                ///< 当前等级。
+    int m_frameCounter;         ///< 出队帧计数，用于分频。
+    int64_t m_processUs;        ///< 每帧处理时间的指数滑动平均 (微秒)，-1 表示还没有样本。
+    long long m_lastChangeUs;   ///< 上一次切换等级 (或会话第一帧) 的采集时间戳，-1 表示还没有帧。
+    long long m_calmSinceUs;    ///< 低压力开始的采集时间戳，-1 表示当前压力不低。
+    long long m_lastMotionUs;   ///< 最后一次 "移动中" 的采集时间戳，-1 表示还没有帧。
+    bool m_lowMotion;           ///< 是否处于低运动模式。
+    bool m_loadLimited;         ///< 本次会话是否因处理时间过长降过级。
+};
+
+#endif // RATECONTROLLER_H
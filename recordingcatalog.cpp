@@ -0,0 +1,629 @@
+/**
+ * @file recordingcatalog.cpp
+ * @brief 录像目录索引 (RecordingCatalog) 的实现文件。
+ *
+ * 索引文件格式 (全部为大端序)：
+ * - 文件头：8 字节魔数 "VSCATLG1"。
+ * - 之后是若干条记录，每条为 quint32 负载长度 + quint16 负载校验和 (qChecksum) + 负载。
+ * - 负载以 quint8 记录类型开头：
+ *   OpAdd    = 相对路径 (UTF-8 QByteArray) + qint64 开始毫秒 + qint64 结束毫秒 + qint64 字节数 + qint32 关键帧数 + quint32 标志；
+ *   OpRemove = 相对路径前缀 (UTF-8 QByteArray)；
+ *   OpClean  = 无内容，`close()` 时写在文件末尾，`open()` 读到后截掉 (之后断电时文件末尾不会再有标记)。
+ *
+ * 每天每路只有几十条记录 (默认30分钟一段)，几个月的录像也只有几百KB，打开时整体读入内存。
+ * 末尾有正常关闭标记时索引与文件系统一致，打开时不遍历目录；断电或崩溃后只有最后正在写入的文件
+ * (在最新的日期目录中) 没有登记，打开时只扫描最新的几个日期目录，整个根目录的扫描由调用者放到后台进行。
+ */
+
+#include "recordingcatalog.h"
+
+#include <QMutexLocker>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSet>
+#include <QDebug>
+
+#include <algorithm> // std::sort
+#include <unistd.h>  // fdatasync
+#include <cstdio>    // rename
+
+namespace {
+
+const char CATALOG_FILE_NAME[] = ".catalog";     ///< 索引文件名 (隐藏文件，不出现在历史页面中)。
+const char CATALOG_MAGIC[] = "VSCATLG1";         ///< 文件头魔数 (8 字节，不含结尾的 '\0')。
+const int MAGIC_SIZE = 8;
+const int RECORD_HEADER_SIZE = 6;                ///< quint32 长度 + quint16 校验和。
+const quint32 MAX_PAYLOAD_SIZE = 64 * 1024;      ///< 单条记录负载上限，超过视为损坏。
+
+/**
+ * @brief 给一条负载加上长度和校验和。
+ */
+QByteArray frameRecord(const QByteArray &payload)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out << quint32(payload.size()) << quint16(qChecksum(payload.constData(), payload.size()));
+    record.append(payload);
+    return record;
+}
+
+/**
+ * @brief 把缓冲区写入文件并落盘。
+ */
+bool writeAndSync(QFile &file, const QByteArray &data)
+{
+    if (file.write(data) != data.size() || !file.flush()) {
+        return false;
+    }
+    ::fdatasync(file.handle()); // 索引每段只写一次，代价很小；断电后不会丢失已关闭文件的记录
+    return true;
+}
+
+} // namespace
+
+RecordingCatalog::RecordingCatalog()
+    : m_totalBytes(0)
+    , m_fileRecords(0)
+    , m_needsFullRescan(false)
+{
+}
+
+RecordingCatalog::~RecordingCatalog()
+{
+    close();
+}
+
+bool RecordingCatalog::open(const QString &rootPath)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        closeFileLocked();
+        m_entries.clear();
+        m_totalBytes = 0;
+        m_fileRecords = 0;
+        m_needsFullRescan = false;
+        m_root = QDir(rootPath).absolutePath();
+        m_file.setFileName(m_root + "/" + CATALOG_FILE_NAME);
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            qWarning() << "RecordingCatalog: 无法打开索引文件" << m_file.fileName() << m_file.errorString();
+            return false;
+        }
+        bool clean = false;
+        if (!loadLocked(&clean)) {
+            m_file.close();
+            return false;
+        }
+        if (clean) {
+            qInfo() << "RecordingCatalog: 已加载" << m_entries.size() << "个录像文件 (上次正常关闭，不扫描)，共"
+                    << m_totalBytes / (1024.0 * 1024.0) << "MB";
+            return true;
+        }
+        m_needsFullRescan = true;
+    }
+
+    // 上次没有正常关闭：断电前正在写入的文件在最新的日期目录中，只扫描这几个目录，其余的留给后台的完整扫描
+    QStringList days = QDir(m_root).entryList(QStringList() << "????????", QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (int i = days.size() - 1; i >= 0; --i) {
+        if (!QDate::fromString(days.at(i), "yyyyMMdd").isValid()) {
+            days.removeAt(i);
+        }
+    }
+    const int firstDay = qMax(0, days.size() - RECOVERY_SCAN_DAYS);
+    int changes = 0;
+    for (int i = firstDay; i < days.size(); ++i) {
+        changes += rescan(m_root + "/" + days.at(i));
+    }
+    qInfo() << "RecordingCatalog: 已加载" << count() << "个录像文件 (上次未正常关闭，恢复扫描最新"
+            << days.size() - firstDay << "天，修正" << changes << "条)，共"
+            << totalBytes() / (1024.0 * 1024.0) << "MB";
+    return true;
+}
+
+void RecordingCatalog::close()
+{
+    QMutexLocker locker(&m_mutex);
+    closeFileLocked();
+    m_needsFullRescan = false;
+    m_entries.clear();
+    m_totalBytes = 0;
+    m_fileRecords = 0;
+}
+
+bool RecordingCatalog::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen();
+}
+
+QString RecordingCatalog::rootPath() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_root;
+}
+
+bool RecordingCatalog::addFile(const QString &filePath, const Entry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    Entry e = entry;
+    e.path = relativeLocked(filePath);
+    if (e.path.isEmpty()) {
+        qWarning() << "RecordingCatalog: 文件不在存储根目录下，不记录:" << filePath;
+        return false;
+    }
+    applyAddLocked(e);
+    return appendLocked(QVector<QByteArray>() << encodeAdd(e));
+}
+
+int RecordingCatalog::removePath(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen()) {
+        return 0;
+    }
+    const QString rel = relativeLocked(path);
+    const int removed = applyRemoveLocked(rel);
+    if (removed > 0) {
+        appendLocked(QVector<QByteArray>() << encodeRemove(rel));
+    }
+    return removed;
+}
+
+void RecordingCatalog::listDir(const QString &dirPath, QStringList *subdirs, QVector<Entry> *entries) const
+{
+    QMutexLocker locker(&m_mutex);
+    const QString rel = relativeLocked(dirPath);
+    if (rel.isNull()) {
+        return; // 不在根目录下
+    }
+    const QString prefix = rel.isEmpty() ? QString() : rel + "/";
+    auto it = prefixBeginLocked(prefix);
+    while (it != m_entries.constEnd() && it.key().startsWith(prefix)) {
+        const QString rest = it.key().mid(prefix.size());
+        const int slash = rest.indexOf('/');
+        if (slash < 0) {
+            if (entries) {
+                entries->append(it.value());
+            }
+            ++it;
+        } else {
+            // 子目录：记下名称后直接跳过它的全部记录 ('0' 是 '/' 之后的下一个字符)
+            const QString name = rest.left(slash);
+            if (subdirs) {
+                subdirs->append(name);
+            }
+            it = m_entries.lowerBound(prefix + name + "0");
+        }
+    }
+}
+
+bool RecordingCatalog::findFile(const QString &filePath, Entry *entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(relativeLocked(filePath));
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    if (entry) {
+        *entry = it.value();
+    }
+    return true;
+}
+
+QString RecordingCatalog::absolutePath(const Entry &entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_root + "/" + entry.path;
+}
+
+qint64 RecordingCatalog::totalBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+qint64 RecordingCatalog::bytesUnder(const QString &dirPath) const
+{
+    QMutexLocker locker(&m_mutex);
+    const QString rel = relativeLocked(dirPath);
+    if (rel.isNull()) {
+        return 0;
+    }
+    if (rel.isEmpty()) {
+        return m_totalBytes;
+    }
+    const QString prefix = rel + "/";
+    qint64 bytes = 0;
+    for (auto it = prefixBeginLocked(prefix); it != m_entries.constEnd() && it.key().startsWith(prefix); ++it) {
+        bytes += it.value().bytes;
+    }
+    return bytes;
+}
+
+QString RecordingCatalog::oldestDay() const
+{
+    QStringList days;
+    listDir(rootPath(), &days, nullptr);
+    // 记录按路径排序，第一个合法的日期目录就是最早的一天
+    for (const QString &day : days) {
+        if (QDate::fromString(day, "yyyyMMdd").isValid()) {
+            return day;
+        }
+    }
+    return QString();
+}
+
+QVector<RecordingCatalog::Entry> RecordingCatalog::oldestDayEntries(QString *day) const
+{
+    const QString oldest = oldestDay();
+    if (day) {
+        *day = oldest;
+    }
+    QVector<Entry> entries;
+    if (oldest.isEmpty()) {
+        return entries;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        const QString prefix = oldest + "/";
+        for (auto it = prefixBeginLocked(prefix); it != m_entries.constEnd() && it.key().startsWith(prefix); ++it) {
+            entries.append(it.value());
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.startMs < b.startMs;
+    });
+    return entries;
+}
+
+QVector<RecordingCatalog::Entry> RecordingCatalog::entriesInRange(const QString &cameraDir, qint64 startMs, qint64 endMs) const
+{
+    QVector<Entry> entries;
+    if (endMs <= startMs) {
+        return entries;
+    }
+    const QDate lastDay = QDateTime::fromMSecsSinceEpoch(endMs - 1).date();
+    {
+        QMutexLocker locker(&m_mutex);
+        for (QDate day = QDateTime::fromMSecsSinceEpoch(startMs).date().addDays(-1); day <= lastDay; day = day.addDays(1)) {
+            const QString prefix = day.toString("yyyyMMdd") + "/" + (cameraDir.isEmpty() ? QString() : cameraDir + "/");
+            for (auto it = prefixBeginLocked(prefix); it != m_entries.constEnd() && it.key().startsWith(prefix); ++it) {
+                // 单摄像头布局下跳过子目录中的文件 (例如后来改为多摄像头后的 camN)
+                if (it.key().indexOf('/', prefix.size()) >= 0) {
+                    continue;
+                }
+                const Entry &entry = it.value();
+                if (entry.endMs > startMs && entry.startMs < endMs) {
+                    entries.append(entry);
+                }
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.startMs < b.startMs;
+    });
+    return entries;
+}
+
+int RecordingCatalog::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+bool RecordingCatalog::needsFullRescan() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_needsFullRescan;
+}
+
+int RecordingCatalog::rescan(const QString &dirPath, bool includeUnfinished)
+{
+    QString root;
+    QString prefix; // 扫描范围内的记录的相对路径前缀 (整个根目录时为空)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_file.isOpen()) {
+            return 0;
+        }
+        root = m_root;
+        if (!dirPath.isEmpty()) {
+            const QString rel = relativeLocked(dirPath);
+            if (rel.isNull()) {
+                return 0; // 不在根目录下
+            }
+            prefix = rel.isEmpty() ? QString() : rel + "/";
+        }
+    }
+
+    // 遍历文件系统时不持有锁 (可能需要几秒)，期间新增的记录不会被当作失效记录删除
+    QMap<QString, QFileInfo> found;
+    QStringList filters;
+    filters << "*.mp4" << "*.MP4" << "*.ts" << "*.TS";
+    QDirIterator it(root + "/" + prefix, filters, QDir::Files, QDirIterator::Subdirectories); // 不含隐藏目录 (.thumbs)
+    while (it.hasNext()) {
+        it.next();
+        if (!includeUnfinished && it.fileName().startsWith("record_")) {
+            continue; // 可能正在写入，关闭并重命名后由 CameraChannel 登记
+        }
+        const QString rel = QDir::cleanPath(it.filePath()).mid(root.size() + 1);
+        found.insert(rel, it.fileInfo());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen() || m_root != root) {
+        return 0; // 扫描期间关闭或切换了根目录
+    }
+    QVector<QByteArray> payloads;
+    for (auto f = found.constBegin(); f != found.constEnd(); ++f) {
+        auto existing = m_entries.constFind(f.key());
+        if (existing != m_entries.constEnd() && existing.value().bytes == f.value().size()) {
+            continue;
+        }
+        Entry e;
+        if (existing != m_entries.constEnd()) {
+            e = existing.value(); // 大小不一致 (例如写入过程中断电)：保留时间和标志，更新大小
+        } else {
+            const qint64 mtime = f.value().lastModified().toMSecsSinceEpoch();
+            e.path = f.key();
+            e.endMs = mtime;
+            e.startMs = guessStartMs(f.key(), mtime);
+            e.flags = FlagRecovered;
+        }
+        e.bytes = f.value().size();
+        applyAddLocked(e);
+        payloads.append(encodeAdd(e));
+    }
+    QStringList missing;
+    for (auto e = prefixBeginLocked(prefix); e != m_entries.constEnd() && e.key().startsWith(prefix); ++e) {
+        if (!found.contains(e.key()) && !QFileInfo::exists(root + "/" + e.key())) {
+            missing.append(e.key());
+        }
+    }
+    for (const QString &rel : missing) {
+        applyRemoveLocked(rel);
+        payloads.append(encodeRemove(rel));
+    }
+    if (!payloads.isEmpty()) {
+        appendLocked(payloads);
+    }
+    if (prefix.isEmpty()) {
+        m_needsFullRescan = false;
+    }
+    return payloads.size();
+}
+
+QString RecordingCatalog::relativeLocked(const QString &path) const
+{
+    const QString absolute = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+    if (absolute == m_root) {
+        return QString(""); // 根目录本身：空字符串 (非 null)
+    }
+    if (m_root.isEmpty() || !absolute.startsWith(m_root + "/")) {
+        return QString(); // null 表示不在根目录下
+    }
+    return absolute.mid(m_root.size() + 1);
+}
+
+bool RecordingCatalog::loadLocked(bool *clean)
+{
+    *clean = false;
+    const QByteArray data = m_file.readAll();
+    if (data.size() < MAGIC_SIZE || !data.startsWith(QByteArray(CATALOG_MAGIC, MAGIC_SIZE))) {
+        if (!data.isEmpty()) {
+            qWarning() << "RecordingCatalog: 索引文件格式无法识别，重新建立";
+        }
+        // 新建 (或无法识别) 的索引：写入文件头，记录由恢复扫描重建
+        if (!m_file.resize(0) || !m_file.seek(0) || !writeAndSync(m_file, QByteArray(CATALOG_MAGIC, MAGIC_SIZE))) {
+            qWarning() << "RecordingCatalog: 无法写入索引文件" << m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    int offset = MAGIC_SIZE;
+    int lastOffset = offset; // 最后一条完整记录的位置
+    quint8 lastOp = 0;
+    while (offset + RECORD_HEADER_SIZE <= data.size()) {
+        QDataStream header(data.mid(offset, RECORD_HEADER_SIZE));
+        header.setByteOrder(QDataStream::BigEndian);
+        quint32 length = 0;
+        quint16 checksum = 0;
+        header >> length >> checksum;
+        if (length == 0 || length > MAX_PAYLOAD_SIZE || offset + RECORD_HEADER_SIZE + (int)length > data.size()) {
+            break; // 断电时未写完的最后一条记录
+        }
+        const QByteArray payload = data.mid(offset + RECORD_HEADER_SIZE, length);
+        if (qChecksum(payload.constData(), payload.size()) != checksum) {
+            break;
+        }
+
+        QDataStream in(payload);
+        in.setByteOrder(QDataStream::BigEndian);
+        quint8 op = 0;
+        QByteArray path;
+        in >> op >> path;
+        if (op == OpAdd) {
+            Entry e;
+            qint32 keyFrames = 0;
+            in >> e.startMs >> e.endMs >> e.bytes >> keyFrames >> e.flags;
+            e.path = QString::fromUtf8(path);
+            e.keyFrames = keyFrames;
+            if (in.status() == QDataStream::Ok) {
+                applyAddLocked(e);
+            }
+        } else if (op == OpRemove) {
+            applyRemoveLocked(QString::fromUtf8(path));
+        }
+        m_fileRecords++;
+        lastOffset = offset;
+        lastOp = op;
+        offset += RECORD_HEADER_SIZE + length;
+    }
+
+    if (offset < data.size()) {
+        qWarning() << "RecordingCatalog: 截掉索引文件末尾损坏的" << data.size() - offset << "字节";
+        m_file.resize(offset);
+    } else if (lastOp == OpClean) {
+        // 去掉标记并落盘：这次运行中断电时文件末尾不能还留着上次的标记
+        if (m_file.resize(lastOffset) && ::fdatasync(m_file.handle()) == 0) {
+            *clean = true;
+            m_fileRecords--;
+            offset = lastOffset;
+        }
+    }
+    m_file.seek(offset);
+    return true;
+}
+
+void RecordingCatalog::closeFileLocked()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_file.seek(m_file.size());
+    if (!writeAndSync(m_file, frameRecord(encodeClean()))) {
+        qWarning() << "RecordingCatalog: 无法写入正常关闭标记:" << m_file.errorString();
+    }
+    m_file.close();
+}
+
+bool RecordingCatalog::appendLocked(const QVector<QByteArray> &payloads)
+{
+    QByteArray data;
+    for (const QByteArray &payload : payloads) {
+        data.append(frameRecord(payload));
+    }
+    m_file.seek(m_file.size());
+    if (!writeAndSync(m_file, data)) {
+        qWarning() << "RecordingCatalog: 写入索引文件失败:" << m_file.errorString();
+        return false;
+    }
+    m_fileRecords += payloads.size();
+
+    // 失效记录比有效记录多时重写，索引文件大小与录像文件数成正比
+    if (m_fileRecords > COMPACT_MIN_RECORDS && m_fileRecords > 2 * m_entries.size()) {
+        compactLocked();
+    }
+    return true;
+}
+
+bool RecordingCatalog::compactLocked()
+{
+    QByteArray data(CATALOG_MAGIC, MAGIC_SIZE);
+    for (const Entry &e : m_entries) {
+        data.append(frameRecord(encodeAdd(e)));
+    }
+
+    const QString tmpPath = m_file.fileName() + ".tmp";
+    QFile tmp(tmpPath);
+    if (!tmp.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeAndSync(tmp, data)) {
+        qWarning() << "RecordingCatalog: 无法写入临时索引文件" << tmpPath << tmp.errorString();
+        tmp.remove();
+        return false;
+    }
+    tmp.close();
+
+    // rename 是原子的：断电后要么是旧索引，要么是新索引
+    m_file.close();
+    if (::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(m_file.fileName()).constData()) != 0) {
+        qWarning() << "RecordingCatalog: 无法替换索引文件";
+        QFile::remove(tmpPath);
+    } else {
+        m_fileRecords = m_entries.size();
+    }
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "RecordingCatalog: 无法重新打开索引文件" << m_file.errorString();
+        return false;
+    }
+    m_file.seek(m_file.size());
+    return true;
+}
+
+int RecordingCatalog::applyRemoveLocked(const QString &rel)
+{
+    int removed = 0;
+    if (rel.isNull()) {
+        return 0;
+    }
+    // 文件本身
+    auto exact = m_entries.find(rel);
+    if (exact != m_entries.end()) {
+        m_totalBytes -= exact.value().bytes;
+        m_entries.erase(exact);
+        removed++;
+    }
+    // 目录下的全部文件 (rel 为空表示根目录)
+    const QString prefix = rel.isEmpty() ? QString() : rel + "/";
+    auto it = prefix.isEmpty() ? m_entries.begin() : m_entries.lowerBound(prefix);
+    while (it != m_entries.end() && it.key().startsWith(prefix)) {
+        m_totalBytes -= it.value().bytes;
+        it = m_entries.erase(it);
+        removed++;
+    }
+    return removed;
+}
+
+void RecordingCatalog::applyAddLocked(const Entry &entry)
+{
+    auto it = m_entries.find(entry.path);
+    if (it != m_entries.end()) {
+        m_totalBytes -= it.value().bytes;
+        it.value() = entry;
+    } else {
+        m_entries.insert(entry.path, entry);
+    }
+    m_totalBytes += entry.bytes;
+}
+
+QMap<QString, RecordingCatalog::Entry>::const_iterator RecordingCatalog::prefixBeginLocked(const QString &prefix) const
+{
+    return prefix.isEmpty() ? m_entries.constBegin() : m_entries.lowerBound(prefix);
+}
+
+QByteArray RecordingCatalog::encodeAdd(const Entry &entry)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out << quint8(OpAdd) << entry.path.toUtf8() << entry.startMs << entry.endMs << entry.bytes
+        << qint32(entry.keyFrames) << entry.flags;
+    return payload;
+}
+
+QByteArray RecordingCatalog::encodeRemove(const QString &rel)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out << quint8(OpRemove) << rel.toUtf8();
+    return payload;
+}
+
+QByteArray RecordingCatalog::encodeClean()
+{
+    return QByteArray(1, char(OpClean));
+}
+
+qint64 RecordingCatalog::guessStartMs(const QString &rel, qint64 fallbackMs)
+{
+    const QDate day = QDate::fromString(rel.section('/', 0, 0), "yyyyMMdd");
+    if (!day.isValid()) {
+        return fallbackMs;
+    }
+    const QString baseName = QFileInfo(rel).completeBaseName();
+    QTime time = QTime::fromString(baseName.left(5), "HH:mm");                  // 已重命名: HH:mm-HH:mm
+    if (!time.isValid() && baseName.startsWith("record_")) {
+        time = QTime::fromString(baseName.mid(7, 6), "HHmmss");                // 未重命名: record_HHmmss
+    }
+    if (!time.isValid()) {
+        return fallbackMs;
+    }
+    return QDateTime(day, time).toMSecsSinceEpoch();
+}
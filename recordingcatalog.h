@@ -0,0 +1,242 @@
+#ifndef RECORDINGCATALOG_H
+#define RECORDINGCATALOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QFile>
+#include <QMutex>
+
+/**
+ * @brief 录像目录索引 (RecordingCatalog)
+ *
+ * 在存储根目录下维护一个只追加的二进制索引文件 (`.catalog`)，每个录像文件关闭并重命名后追加一条记录
+ * (相对路径、开始/结束时间、大小、关键帧数、事件标志)，删除时追加一条按路径前缀删除的记录：
+ * - 每条记录带长度和校验和，断电后只可能丢失最后一条未写完的记录，打开时截掉损坏的尾部。
+ * - 全部记录在内存中按路径排序 (`QMap`)，按天清理、空间统计和历史浏览都是内存查询，不再遍历TF卡目录。
+ * - 失效记录 (被覆盖或删除) 超过有效记录时重写索引文件 (先写临时文件再 rename，任何时刻都有一份完整的索引)。
+ * - `close()` 时追加一条正常关闭标记，`open()` 读到末尾的标记时直接信任索引，不扫描目录 (打开后立即去掉标记)。
+ *   没有标记 (断电或崩溃) 时只对最新的 RECOVERY_SCAN_DAYS 个日期目录做恢复扫描 (`rescan()`)：补上断电前尚未关闭的
+ *   record_HHmmss.* 等索引中缺少的文件，去掉已不存在的文件，纠正大小不一致的记录。
+ *   整个根目录的扫描 (`needsFullRescan()`) 由调用者在录制开始后放到后台线程中进行，不阻塞启动。
+ *
+ * 所有公共函数线程安全。路径参数和目录参数都是绝对路径，必须位于根目录之下。
+ */
+class RecordingCatalog
+{
+public:
+    /**
+     * @brief 录像文件的标志位。
+     */
+    enum Flag {
+        FlagEvent = 0x1,     ///< 待命录制中的事件文件 (以预录画面开头)。
+        FlagMotion = 0x2,    ///< 文件期间检测到移动。
+        FlagRecovered = 0x4  ///< 恢复扫描补录：时间取自文件名和修改时间，关键帧数未知。
+    };
+
+    /**
+     * @brief 一个录像文件的索引记录。
+     */
+    struct Entry {
+        QString path;          ///< 相对根目录的路径，例如 "20240115/cam0/14:30-15:00.mp4"。
+        qint64 startMs = 0;    ///< 开始时间 (自 1970 年起的毫秒数)。
+        qint64 endMs = 0;      ///< 结束时间 (自 1970 年起的毫秒数)。
+        qint64 bytes = 0;      ///< 文件大小 (字节)。
+        int keyFrames = 0;     ///< 关键帧数 (可随机访问的位置数)，未知时为0。
+        quint32 flags = 0;     ///< `Flag` 的组合。
+    };
+
+    RecordingCatalog();
+
+    /**
+     * @brief 析构函数，关闭索引文件。
+     */
+    ~RecordingCatalog();
+
+    /**
+     * @brief 打开 (或创建) 根目录下的索引文件并加载全部记录；上次没有正常关闭时扫描最新的几个日期目录。
+     * @param rootPath 存储根目录 (例如 "/mnt/TFcard")。已打开其他根目录时先正常关闭它。
+     * @return 索引文件无法打开或创建时返回 false，此时所有查询都返回空结果。
+     */
+    bool open(const QString &rootPath);
+
+    /**
+     * @brief 写入正常关闭标记，关闭索引文件并清空内存中的记录。
+     */
+    void close();
+
+    /**
+     * @brief 索引文件是否已打开。
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief 存储根目录。
+     */
+    QString rootPath() const;
+
+    /**
+     * @brief 记录一个已关闭的录像文件；同一路径已有记录时覆盖。
+     * @param filePath 录像文件的绝对路径。
+     * @param entry 文件信息，`entry.path` 被忽略 (由 filePath 计算)。
+     * @return 文件不在根目录下或写入索引失败时返回 false。
+     */
+    bool addFile(const QString &filePath, const Entry &entry);
+
+    /**
+     * @brief 删除一个文件或一个目录 (及其所有子目录) 下的全部记录。
+     * @param path 文件或目录的绝对路径。
+     * @return 删除的记录数。
+     */
+    int removePath(const QString &path);
+
+    /**
+     * @brief 列出一个目录的直接内容 (只包括有录像的子目录)。
+     * @param dirPath 目录的绝对路径。
+     * @param subdirs 输出按名称排序的子目录名，可为 nullptr。
+     * @param entries 输出按名称排序的录像文件记录，可为 nullptr。
+     */
+    void listDir(const QString &dirPath, QStringList *subdirs, QVector<Entry> *entries) const;
+
+    /**
+     * @brief 查询一个录像文件的记录。
+     * @return 没有记录时返回 false。
+     */
+    bool findFile(const QString &filePath, Entry *entry) const;
+
+    /**
+     * @brief 记录的绝对路径。
+     */
+    QString absolutePath(const Entry &entry) const;
+
+    /**
+     * @brief 全部录像文件的总大小 (字节)。
+     */
+    qint64 totalBytes() const;
+
+    /**
+     * @brief 一个目录 (及其所有子目录) 下录像文件的总大小 (字节)。
+     */
+    qint64 bytesUnder(const QString &dirPath) const;
+
+    /**
+     * @brief 有录像的最早的日期目录名 ("yyyyMMdd")，没有时返回空字符串。
+     */
+    QString oldestDay() const;
+
+    /**
+     * @brief 最早一天 (`oldestDay()`) 的全部录像文件记录，按开始时间排序 (各路摄像头的文件交错排列)。
+     * @param day 输出日期目录名，可为 nullptr。没有录像时为空字符串。
+     */
+    QVector<Entry> oldestDayEntries(QString *day) const;
+
+    /**
+     * @brief 一路摄像头与 [startMs, endMs) 有重叠的全部录像文件记录，按开始时间排序 (导出时间段)。
+     * @param cameraDir 日期目录下该路的子目录名 ("camN")；单摄像头布局 (文件直接在日期目录下) 时为空字符串。
+     * @param startMs 开始时间 (自 1970 年起的毫秒数)。
+     * @param endMs 结束时间 (不含)。
+     *
+     * 只查询开始前一天到结束当天的日期目录 (跨零点的文件记在开始那一天)。
+     */
+    QVector<Entry> entriesInRange(const QString &cameraDir, qint64 startMs, qint64 endMs) const;
+
+    /**
+     * @brief 录像文件的个数。
+     */
+    int count() const;
+
+    /**
+     * @brief 恢复扫描：遍历一个目录 (不含隐藏目录) 下的录像文件，使这部分索引与文件系统一致。
+     * @param dirPath 要扫描的目录的绝对路径，为空字符串时扫描整个根目录 (完成后 `needsFullRescan()` 返回 false)。
+     * @param includeUnfinished 是否登记未重命名的 record_HHmmss.* 文件。录制开始后扫描时必须为 false，
+     *        否则会把正在写入的文件登记进来 (断电前未关闭的文件已由 `open()` 的恢复扫描登记)。
+     * @return 新增、更新和删除的记录总数。
+     *
+     * 遍历目录时不持有锁，可能需要几秒，应在后台线程中调用。
+     */
+    int rescan(const QString &dirPath = QString(), bool includeUnfinished = true);
+
+    /**
+     * @brief 打开时的索引不能确定与文件系统一致 (上次没有正常关闭或索引是新建的)，需要扫描整个根目录。
+     */
+    bool needsFullRescan() const;
+
+private:
+    RecordingCatalog(const RecordingCatalog &) = delete;
+    RecordingCatalog &operator=(const RecordingCatalog &) = delete;
+
+    /**
+     * @brief 索引文件中的记录类型。
+     */
+    enum Op {
+        OpAdd = 1,    ///< 新增或覆盖一个文件的记录。
+        OpRemove = 2, ///< 删除一个路径 (文件或目录前缀) 下的记录。
+        OpClean = 3   ///< 正常关闭标记 (没有内容)，只会出现在索引文件末尾。
+    };
+
+    /**
+     * @brief 绝对路径转换为相对根目录的路径；不在根目录下时返回空字符串。需持有 `m_mutex`。
+     */
+    QString relativeLocked(const QString &path) const;
+
+    /**
+     * @brief 读取索引文件并重放全部记录，截掉损坏的尾部和末尾的正常关闭标记。需持有 `m_mutex`。
+     * @param clean 输出索引文件是否以正常关闭标记结尾。
+     */
+    bool loadLocked(bool *clean);
+
+    /**
+     * @brief 写入正常关闭标记并关闭索引文件 (不清空记录)。需持有 `m_mutex`。
+     */
+    void closeFileLocked();
+
+    /**
+     * @brief 把若干条已编码的记录一次写入索引文件并 `fdatasync()`，必要时随后重写索引。需持有 `m_mutex`。
+     */
+    bool appendLocked(const QVector<QByteArray> &payloads);
+
+    /**
+     * @brief 只保留有效记录，重写索引文件。需持有 `m_mutex`。
+     */
+    bool compactLocked();
+
+    /**
+     * @brief 在内存中删除 rel 本身及以 rel + "/" 开头的记录。需持有 `m_mutex`。
+     * @return 删除的记录数。
+     */
+    int applyRemoveLocked(const QString &rel);
+
+    /**
+     * @brief 在内存中新增或覆盖一条记录。需持有 `m_mutex`。
+     */
+    void applyAddLocked(const Entry &entry);
+
+    /**
+     * @brief 以 rel 为前缀的记录范围的起点 (rel 为空时为全部记录)。需持有 `m_mutex`。
+     */
+    QMap<QString, Entry>::const_iterator prefixBeginLocked(const QString &prefix) const;
+
+    static QByteArray encodeAdd(const Entry &entry);
+    static QByteArray encodeRemove(const QString &rel);
+    static QByteArray encodeClean();
+
+    /**
+     * @brief 为恢复扫描补录的文件推算开始时间：日期取自日期目录，时刻取自文件名 ("HH:mm-HH:mm" 或 "record_HHmmss")。
+     * @return 无法推算时返回 fallbackMs。
+     */
+    static qint64 guessStartMs(const QString &rel, qint64 fallbackMs);
+
+    static const int COMPACT_MIN_RECORDS = 256; ///< 索引文件少于这么多条记录时不重写。
+    static const int RECOVERY_SCAN_DAYS = 2;    ///< 没有正常关闭时 `open()` 扫描的最新日期目录数 (录制可能跨过零点)。
+
+    mutable QMutex m_mutex;            ///< 保护以下全部成员。
+    QString m_root;                    ///< 存储根目录 (绝对路径，不带结尾的 '/')。
+    QFile m_file;                      ///< 索引文件。
+    QMap<QString, Entry> m_entries;    ///< 全部录像文件记录，按相对路径排序 (日期目录名即时间顺序)。
+    qint64 m_totalBytes;               ///< 全部记录的大小之和。
+    int m_fileRecords;                 ///< 索引文件中的记录条数 (包括已失效的)。
+    bool m_needsFullRescan;            ///< 打开后还没有完成整个根目录的扫描，且上次没有正常关闭。
+};
+
+#endif // RECORDINGCATALOG_H
@@ -0,0 +1,445 @@
+/**
+ * @file recordingexporter.cpp
+ * @brief 录像时间段导出线程 (RecordingExporter) 的实现文件。
+ *
+ * 时间计算：来源文件中一个数据包的绝对时间 (微秒) = 文件开始时间 (索引记录) + 时间戳 - 文件的开始时间戳，
+ * 与播放页和关键帧索引使用的文件内位置一致。导出时间轴 = 绝对时间 - m_shiftUs，第一个数据包为0。
+ */
+
+#include "recordingexporter.h"
+#include "keyframeindex.h" // 定位到开始时间之前的关键帧
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <cstring>       // memcmp
+#include <fcntl.h>       // open, posix_fadvise
+#include <unistd.h>      // close, syscall
+#include <sys/syscall.h> // SYS_ioprio_set
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * @brief 把 FFmpeg 错误码转换为可读的字符串。
+ */
+static QString ffmpegError(int errnum)
+{
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(errnum, errbuf, sizeof(errbuf));
+    return QString::fromUtf8(errbuf);
+}
+
+/**
+ * @brief 把调用线程的 I/O 优先级降为尽力而为类 (best-effort) 中的最低一级 (7)。
+ *
+ * 不使用空闲类 (idle)：录制线程一直在写入，空闲类的请求可能长时间得不到调度。
+ * 只对支持 I/O 优先级的调度器 (BFQ、CFQ) 有效，失败时忽略。
+ */
+static void lowerIoPriority()
+{
+#ifdef SYS_ioprio_set
+    const int whoProcess = 1;             // IOPRIO_WHO_PROCESS，id 为0表示调用线程
+    const int priority = (2 << 13) | 7;   // IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT | 级别
+    if (syscall(SYS_ioprio_set, whoProcess, 0, priority) < 0) {
+        qDebug() << "RecordingExporter: 无法降低 I/O 优先级";
+    }
+#endif
+}
+
+/**
+ * @brief 把读过的来源文件从页缓存中丢弃，导出不会挤掉录制和播放用到的缓存。
+ */
+static void dropPageCache(const QString &filePath)
+{
+    const int fd = ::open(filePath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+/**
+ * @brief 两个视频流的编码参数是否相同 (可以拼接到同一个流中)。
+ */
+static bool sameStreamParameters(const AVCodecParameters *a, const AVCodecParameters *b)
+{
+    return a->codec_id == b->codec_id && a->width == b->width && a->height == b->height
+            && a->extradata_size == b->extradata_size
+            && (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+}
+
+RecordingExporter::RecordingExporter(const RecordingCatalog *catalog, QObject *parent)
+    : QThread(parent)
+    , m_catalog(catalog)
+    , m_cancelRequested(0)
+    , m_startMs(0)
+    , m_endMs(0)
+    , m_expectedBytes(0)
+    , m_output(nullptr)
+    , m_outputParams(nullptr)
+    , m_incompatible(false)
+    , m_shiftUs(0)
+    , m_firstUs(AV_NOPTS_VALUE)
+    , m_lastDtsUs(AV_NOPTS_VALUE)
+    , m_lastEndUs(AV_NOPTS_VALUE)
+    , m_frameUs(0)
+    , m_lastOutDts(AV_NOPTS_VALUE)
+    , m_lastPercent(-1)
+{
+    // 写入器在自己的I/O线程中报告错误，之后的写入都会失败；这里只记下原因
+    connect(&m_writer, &BufferedFileWriter::writeError, this, [this](const QString &errorMsg) {
+        QMutexLocker locker(&m_writeErrorMutex);
+        if (m_writeError.isEmpty()) {
+            m_writeError = errorMsg;
+        }
+    }, Qt::DirectConnection);
+}
+
+RecordingExporter::~RecordingExporter()
+{
+    cancelExport();
+    wait();
+}
+
+bool RecordingExporter::startExport(const QString &cameraDir, qint64 startMs, qint64 endMs, const QString &outputPath)
+{
+    if (isRunning() || endMs <= startMs || outputPath.isEmpty()) {
+        return false;
+    }
+    m_cameraDir = cameraDir;
+    m_startMs = startMs;
+    m_endMs = endMs;
+    m_outputPath = outputPath;
+    m_cancelRequested.storeRelease(0);
+    start(QThread::LowPriority);
+    return true;
+}
+
+void RecordingExporter::cancelExport()
+{
+    m_cancelRequested.storeRelease(1);
+}
+
+void RecordingExporter::run()
+{
+    lowerIoPriority();
+
+    m_writeError.clear();
+    m_incompatible = false;
+    m_shiftUs = 0;
+    m_firstUs = AV_NOPTS_VALUE;
+    m_lastDtsUs = AV_NOPTS_VALUE;
+    m_lastEndUs = AV_NOPTS_VALUE;
+    m_frameUs = 0;
+    m_lastOutDts = AV_NOPTS_VALUE;
+    m_lastPercent = -1;
+
+    const QVector<RecordingCatalog::Entry> entries = m_catalog->entriesInRange(m_cameraDir, m_startMs, m_endMs);
+    if (entries.isEmpty()) {
+        emit exportFailed("该时间段没有已保存的录像");
+        return;
+    }
+
+    // 导出期间来源文件不能被后台淘汰删除；按时间段内的比例估算导出文件大小 (用于预分配)
+    QStringList sources;
+    m_expectedBytes = 0;
+    for (const RecordingCatalog::Entry &entry : entries) {
+        sources << m_catalog->absolutePath(entry);
+        emit sourceOpened(sources.last());
+        const qint64 durationMs = entry.endMs - entry.startMs;
+        if (durationMs > 0) {
+            const qint64 coveredMs = qMin(entry.endMs, m_endMs) - qMax(entry.startMs, m_startMs);
+            m_expectedBytes += entry.bytes * coveredMs / durationMs;
+        }
+    }
+
+    const QString partPath = m_outputPath + ".part"; // 完成后才重命名，中途失败不会留下不完整的导出文件
+    QDir().mkpath(QFileInfo(m_outputPath).absolutePath());
+    m_writer.startWriter();
+
+    QString errorMsg;
+    bool ok = true;
+    for (const RecordingCatalog::Entry &entry : entries) {
+        if (m_incompatible || (m_lastEndUs != AV_NOPTS_VALUE && m_lastEndUs >= m_endMs * 1000)) {
+            break;
+        }
+        if (!exportFile(entry, &errorMsg)) {
+            ok = false;
+            break;
+        }
+    }
+
+    qint64 bytes = -1;
+    if (ok && m_firstUs == AV_NOPTS_VALUE) {
+        errorMsg = "该时间段的录像无法读取";
+        ok = false;
+    }
+    if (ok) {
+        bytes = closeOutput(true);
+        m_writer.stopWriter(); // 返回时所有数据都已写入文件
+        QMutexLocker locker(&m_writeErrorMutex);
+        if (bytes < 0 || !m_writeError.isEmpty()) {
+            errorMsg = m_writeError.isEmpty() ? QString("写入导出文件尾失败") : m_writeError;
+            ok = false;
+        }
+    } else {
+        closeOutput(false);
+        m_writer.stopWriter();
+    }
+    if (ok) {
+        QFile::remove(m_outputPath);
+        if (!QFile::rename(partPath, m_outputPath)) {
+            errorMsg = "无法重命名导出文件: " + m_outputPath;
+            ok = false;
+        }
+    }
+    if (!ok) {
+        QFile::remove(partPath);
+    }
+
+    for (const QString &source : sources) {
+        emit sourceClosed(source);
+    }
+
+    if (!ok) {
+        qWarning() << "RecordingExporter: 导出失败:" << errorMsg;
+        emit exportFailed(errorMsg);
+        return;
+    }
+    if (m_incompatible) {
+        qWarning() << "RecordingExporter: 后续录像的编码参数不同，只导出到"
+                   << QDateTime::fromMSecsSinceEpoch(m_lastEndUs / 1000).toString("yyyy-MM-dd HH:mm:ss");
+    }
+    emit exportProgress(100);
+    emit exportFinished(m_outputPath, m_firstUs / 1000, m_lastEndUs / 1000, bytes);
+}
+
+bool RecordingExporter::exportFile(const RecordingCatalog::Entry &entry, QString *errorMsg)
+{
+    const QString path = m_catalog->absolutePath(entry);
+    AVFormatContext *input = nullptr;
+    if (avformat_open_input(&input, path.toLocal8Bit().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "RecordingExporter: 无法打开录像，跳过:" << path;
+        return true;
+    }
+    const int streamIndex = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        qWarning() << "RecordingExporter: 录像中没有视频流，跳过:" << path;
+        avformat_close_input(&input);
+        return true;
+    }
+    AVStream *stream = input->streams[streamIndex];
+    if (stream->codecpar->extradata_size == 0) {
+        // MPEG-TS 把 SPS/PPS 放在码流中：预读一段取得编码参数 (导出为 MP4 时需要，也用于检查能否拼接)
+        avformat_find_stream_info(input, nullptr);
+    }
+
+    const int64_t fileUs = entry.startMs * 1000;
+    const int64_t startTime = (input->start_time != AV_NOPTS_VALUE) ? input->start_time : 0;
+    const AVRational microseconds = {1, AV_TIME_BASE};
+
+    // 本文件从请求的开始时间或已导出部分的结尾 (相邻文件重叠时) 开始，在文件开头之后时先定位到之前的关键帧
+    int64_t fromUs = m_startMs * 1000;
+    if (m_lastEndUs != AV_NOPTS_VALUE) {
+        fromUs = qMax(fromUs, m_lastEndUs);
+    }
+    int64_t keyFloorUs = AV_NOPTS_VALUE; // 早于定位到的关键帧的关键帧不导出 (不能定位、从头读取时)
+    if (fromUs > fileUs) {
+        KeyFrameIndex index;
+        const int frame = index.load(KeyFrameIndex::indexPath(path)) ? index.floorIndex((fromUs - fileUs) / 1000) : -1;
+        int ret = -1;
+        if (frame >= 0) {
+            const KeyFrameIndex::Entry &key = index.at(frame);
+            keyFloorUs = fileUs + key.ptsMs * 1000 - 1000; // 索引中的时间按毫秒取整
+            if (key.offset >= 0 && !(input->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+                ret = av_seek_frame(input, -1, key.offset, AVSEEK_FLAG_BYTE);
+            }
+            if (ret < 0) {
+                const int64_t target = av_rescale_q(key.ptsMs * 1000 + startTime, microseconds, stream->time_base);
+                ret = av_seek_frame(input, streamIndex, target, AVSEEK_FLAG_BACKWARD);
+            }
+        } else {
+            // 没有关键帧索引：按时间戳定位，封装器 (MP4 的样本表) 返回之前最近的关键帧
+            const int64_t target = av_rescale_q(fromUs - fileUs + startTime, microseconds, stream->time_base);
+            ret = av_seek_frame(input, streamIndex, target, AVSEEK_FLAG_BACKWARD);
+        }
+        if (ret < 0) {
+            qDebug() << "RecordingExporter: 无法定位，从文件开头读取:" << path;
+        }
+    }
+
+    const int64_t endUs = m_endMs * 1000;
+    const int64_t rangeUs = endUs - m_startMs * 1000;
+    AVPacket *packet = av_packet_alloc();
+    bool waitingKeyFrame = true; // 每个文件都从关键帧开始 (上一个文件的参考帧不能用于这个文件)
+    bool ok = packet != nullptr;
+    if (!ok) {
+        *errorMsg = "内存不足";
+    }
+    while (ok) {
+        if (m_cancelRequested.loadAcquire()) {
+            *errorMsg = "导出已取消";
+            ok = false;
+            break;
+        }
+        const int ret = av_read_frame(input, packet);
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                qWarning() << "RecordingExporter: 读取录像中断 (" << ffmpegError(ret) << ")，继续下一个文件:" << path;
+            }
+            break;
+        }
+        const int64_t dts = (packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts;
+        if (packet->stream_index != streamIndex || dts == AV_NOPTS_VALUE) {
+            av_packet_unref(packet);
+            continue;
+        }
+        const int64_t pts = (packet->pts != AV_NOPTS_VALUE) ? packet->pts : dts;
+        const int64_t dtsUs = fileUs + av_rescale_q(dts, stream->time_base, microseconds) - startTime;
+        const int64_t ptsUs = fileUs + av_rescale_q(pts, stream->time_base, microseconds) - startTime;
+        if (dtsUs >= endUs) {
+            av_packet_unref(packet); // 之后的数据包都在时间段之后 (显示时间不早于解码时间)
+            break;
+        }
+
+        if (waitingKeyFrame) {
+            const bool skip = !(packet->flags & AV_PKT_FLAG_KEY)
+                    || (keyFloorUs != AV_NOPTS_VALUE && ptsUs < keyFloorUs)
+                    || (m_lastDtsUs != AV_NOPTS_VALUE && dtsUs <= m_lastDtsUs);
+            if (skip) {
+                av_packet_unref(packet);
+                continue;
+            }
+            // 从这个关键帧开始写入本文件：输出按第一个文件的流参数创建，之后的文件参数必须相同
+            if (!m_output) {
+                if (!openOutput(stream, errorMsg)) {
+                    ok = false;
+                    break;
+                }
+            } else if (!sameStreamParameters(m_outputParams, stream->codecpar)) {
+                m_incompatible = true;
+                av_packet_unref(packet);
+                break;
+            }
+            waitingKeyFrame = false;
+            if (m_firstUs == AV_NOPTS_VALUE) {
+                m_firstUs = ptsUs;
+                m_shiftUs = dtsUs;
+            } else if (dtsUs - m_lastDtsUs > MAX_GAP_MS * 1000) {
+                m_shiftUs += dtsUs - m_lastDtsUs - m_frameUs; // 两段录像之间没有画面：接在上一帧之后
+            }
+        }
+
+        const int64_t durationUs = (packet->duration > 0)
+                ? av_rescale_q(packet->duration, stream->time_base, microseconds) : m_frameUs;
+        if (durationUs > 0) {
+            m_frameUs = durationUs;
+        }
+        m_lastDtsUs = dtsUs;
+        m_lastEndUs = (m_lastEndUs == AV_NOPTS_VALUE) ? ptsUs + durationUs : qMax(m_lastEndUs, ptsUs + durationUs);
+        if (!writePacket(packet, dtsUs - m_shiftUs, ptsUs - m_shiftUs, durationUs, errorMsg)) {
+            ok = false;
+            break;
+        }
+
+        const int percent = int(qBound<int64_t>(0, (m_lastEndUs - m_startMs * 1000) * 100 / rangeUs, 99));
+        if (percent != m_lastPercent) {
+            m_lastPercent = percent;
+            emit exportProgress(percent);
+        }
+    }
+    av_packet_free(&packet);
+    avformat_close_input(&input);
+    dropPageCache(path);
+    return ok;
+}
+
+bool RecordingExporter::openOutput(const AVStream *stream, QString *errorMsg)
+{
+    // 封装格式由导出文件的扩展名决定 (实际写入 .part 临时文件)
+    int ret = avformat_alloc_output_context2(&m_output, nullptr, nullptr, m_outputPath.toLocal8Bit().constData());
+    if (ret < 0 || !m_output) {
+        *errorMsg = QString("不支持的导出文件格式: %1").arg(QFileInfo(m_outputPath).suffix());
+        m_output = nullptr;
+        return false;
+    }
+    AVStream *outStream = avformat_new_stream(m_output, nullptr);
+    m_outputParams = avcodec_parameters_alloc();
+    if (!outStream || !m_outputParams || avcodec_parameters_copy(outStream->codecpar, stream->codecpar) < 0
+            || avcodec_parameters_copy(m_outputParams, stream->codecpar) < 0) {
+        *errorMsg = "无法创建导出文件的视频流";
+        closeOutput(false);
+        return false;
+    }
+    outStream->codecpar->codec_tag = 0; // 由封装器选择 (MPEG-TS 导出为 MP4 时标签不同)
+    outStream->time_base = stream->time_base;
+    m_frameUs = (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0)
+            ? av_rescale_q(1, av_inv_q(stream->avg_frame_rate), AVRational{1, AV_TIME_BASE})
+            : AV_TIME_BASE / 25;
+
+    // 数据经后写缓冲区按大块顺序写入 (预分配空间)，普通 MP4 关闭时回写文件头也由它处理
+    m_output->pb = m_writer.openFile(m_outputPath + ".part", m_expectedBytes, errorMsg);
+    if (!m_output->pb) {
+        closeOutput(false);
+        return false;
+    }
+    m_output->flags |= AVFMT_FLAG_CUSTOM_IO; // AVIO 上下文由 m_writer 拥有和释放
+    ret = avformat_write_header(m_output, nullptr);
+    if (ret < 0) {
+        *errorMsg = QString("无法写入导出文件头: %1").arg(ffmpegError(ret));
+        closeOutput(false);
+        return false;
+    }
+    return true;
+}
+
+qint64 RecordingExporter::closeOutput(bool writeTrailer)
+{
+    if (!m_output) {
+        return 0;
+    }
+    const int ret = writeTrailer ? av_write_trailer(m_output) : 0;
+    qint64 bytes = 0;
+    if (m_output->pb) {
+        bytes = m_writer.closeFile(writeTrailer);
+        m_output->pb = nullptr;
+    }
+    avformat_free_context(m_output);
+    m_output = nullptr;
+    avcodec_parameters_free(&m_outputParams);
+    return ret < 0 ? -1 : bytes;
+}
+
+bool RecordingExporter::writePacket(AVPacket *packet, int64_t dtsUs, int64_t ptsUs, int64_t durationUs, QString *errorMsg)
+{
+    const AVRational microseconds = {1, AV_TIME_BASE};
+    const AVRational timeBase = m_output->streams[0]->time_base;
+    packet->dts = av_rescale_q(dtsUs, microseconds, timeBase);
+    packet->pts = av_rescale_q(ptsUs, microseconds, timeBase);
+    packet->duration = av_rescale_q(durationUs, microseconds, timeBase);
+    if (m_lastOutDts != AV_NOPTS_VALUE && packet->dts <= m_lastOutDts) {
+        packet->dts = m_lastOutDts + 1; // 换算后时间戳相同时保持严格递增，否则封装器会拒绝该包
+        if (packet->pts < packet->dts) {
+            packet->pts = packet->dts;
+        }
+    }
+    m_lastOutDts = packet->dts;
+    packet->stream_index = 0;
+    packet->pos = -1;
+
+    const int ret = av_write_frame(m_output, packet); // 单路视频流不需要交织缓冲
+    av_packet_unref(packet);
+    if (ret < 0) {
+        QMutexLocker locker(&m_writeErrorMutex);
+        *errorMsg = m_writeError.isEmpty() ? QString("写入导出文件失败: %1").arg(ffmpegError(ret)) : m_writeError;
+        return false;
+    }
+    return true;
+}
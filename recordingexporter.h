@@ -0,0 +1,165 @@
+#ifndef RECORDINGEXPORTER_H
+#define RECORDINGEXPORTER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <QAtomicInt>
+
+#include "recordingcatalog.h"   // 录像索引 (Entry)
+#include "bufferedfilewriter.h" // 导出文件的后写缓冲写入器
+
+struct AVFormatContext;
+struct AVStream;
+struct AVCodecParameters;
+struct AVPacket;
+
+/**
+ * @brief 录像时间段导出线程 (RecordingExporter)
+ *
+ * 由 `StorageManager` 拥有，把一路摄像头 [开始, 结束) 时间段内的录像合并导出为一个文件，只做转封装，不解码也不编码：
+ * - 覆盖时间段的录像文件取自录像索引 (`RecordingCatalog::entriesInRange()`)，按开始时间依次读取。
+ * - 第一个文件用关键帧索引 (`KeyFrameIndex`) 定位到开始时间之前最近的关键帧 (支持时按字节定位)，
+ *   导出文件从这个关键帧开始，开头可以直接解码；读到结束时间的数据包为止。
+ * - 分段之间的时间戳保持连续；相邻文件有重叠 (事件文件的预录画面) 时跳过已导出的部分，
+ *   从下一个文件中第一个更晚的关键帧继续。两段录像之间的空档超过 MAX_GAP_MS 时压缩为一帧的间隔。
+ * - 后面的文件编码参数不同 (分辨率或编码器改变) 时无法拼接，导出到此为止 (结果中的结束时间为实际导出到的时间)。
+ * - 导出期间来源文件标记为使用中 (`sourceOpened()` / `sourceClosed()`)，后台淘汰不会删除它们。
+ * - 线程为低优先级，I/O 优先级设为尽力而为类中的最低一级，数据经 `BufferedFileWriter` 按大块顺序写入，
+ *   读过的来源文件从页缓存中丢弃，不会挤占录制线程的写入和缓存。导出一小时的录像只需要顺序读写一遍文件。
+ *
+ * 只导出已关闭并登记到索引的录像文件，正在写入的文件要等它分段或录制结束后才能导出。
+ * 同一时间只进行一个导出；`cancelExport()` 在下一个数据包处中止并删除未完成的文件。
+ */
+class RecordingExporter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param catalog 录像索引 (线程安全)，必须在本对象停止之前一直有效。
+     * @param parent 父对象指针
+     */
+    explicit RecordingExporter(const RecordingCatalog *catalog, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，中止正在进行的导出并等待线程结束。
+     */
+    ~RecordingExporter();
+
+    /**
+     * @brief 开始导出 (在后台线程中进行，立即返回)。
+     * @param cameraDir 日期目录下该路的子目录名 ("camN")，单摄像头布局时为空字符串。
+     * @param startMs 开始时间 (自 1970 年起的毫秒数)。
+     * @param endMs 结束时间 (不含)。
+     * @param outputPath 导出文件路径，封装格式由扩展名决定 (例如 .mp4、.ts)。目录不存在时创建。
+     * @return 已有导出正在进行或时间段为空时返回 false，不发出任何信号。
+     */
+    bool startExport(const QString &cameraDir, qint64 startMs, qint64 endMs, const QString &outputPath);
+
+    /**
+     * @brief 中止正在进行的导出 (不等待)，随后发出 `exportFailed()`。没有导出时无副作用。线程安全。
+     */
+    void cancelExport();
+
+    /**
+     * @brief 是否有导出正在进行。
+     */
+    bool isExporting() const { return isRunning(); }
+
+signals:
+    /**
+     * @brief 导出进度 (在导出线程中发出，百分比变化时才发出)。
+     * @param percent 已导出的时间占整个时间段的百分比 (0 ~ 100)。
+     */
+    void exportProgress(int percent);
+
+    /**
+     * @brief 导出完成 (在导出线程中发出)。
+     * @param outputPath 导出文件路径。
+     * @param startMs 实际导出的第一帧的时间 (从开始时间之前的关键帧开始，或时间段内第一个文件的开头)。
+     * @param endMs 实际导出的最后一帧的结束时间。
+     * @param bytes 导出文件大小 (字节)。
+     */
+    void exportFinished(const QString &outputPath, qint64 startMs, qint64 endMs, qint64 bytes);
+
+    /**
+     * @brief 导出失败或被中止 (在导出线程中发出)，未完成的文件已删除。
+     * @param errorMsg 错误描述信息。
+     */
+    void exportFailed(const QString &errorMsg);
+
+    /**
+     * @brief 开始使用一个来源文件，结束前不能删除 (在导出线程中发出，以 `Qt::DirectConnection` 连接)。
+     * @param filePath 文件的绝对路径。
+     */
+    void sourceOpened(const QString &filePath);
+
+    /**
+     * @brief 不再使用一个来源文件 (在导出线程中发出，以 `Qt::DirectConnection` 连接)。
+     */
+    void sourceClosed(const QString &filePath);
+
+protected:
+    /**
+     * @brief 导出线程：查询索引，依次转封装各个来源文件，完成后把临时文件重命名为导出文件。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 把一个来源文件中属于时间段的数据包写入导出文件 (写入第一个数据包前按这个文件的流参数创建输出)。
+     *
+     * 要导出的部分从开始时间 (或已导出部分的结尾) 之后才开始时，先定位到它之前最近的关键帧。
+     * @param entry 来源文件的索引记录。
+     * @param errorMsg 失败时输出错误描述。
+     * @return 失败或中止返回 false；文件无法打开时跳过它并返回 true。编码参数不同时置位 m_incompatible 并返回 true。
+     */
+    bool exportFile(const RecordingCatalog::Entry &entry, QString *errorMsg);
+
+    /**
+     * @brief 按第一个来源文件的视频流创建导出文件并写入文件头。
+     */
+    bool openOutput(const AVStream *stream, QString *errorMsg);
+
+    /**
+     * @brief 写入文件尾并关闭导出文件。
+     * @return 文件大小 (字节)，失败时返回 -1。
+     */
+    qint64 closeOutput(bool writeTrailer);
+
+    /**
+     * @brief 把一个数据包的时间戳 (导出时间轴上的微秒数) 换算到输出流的时间基并写入，写入后释放数据包的引用。
+     */
+    bool writePacket(AVPacket *packet, int64_t dtsUs, int64_t ptsUs, int64_t durationUs, QString *errorMsg);
+
+    static const int MAX_GAP_MS = 2000; ///< 相邻两段录像之间超过这个空档 (毫秒) 时压缩为一帧的间隔。
+
+    const RecordingCatalog *m_catalog; ///< 录像索引。
+    QAtomicInt m_cancelRequested;      ///< 中止请求，每个数据包检查一次。
+
+    // 以下在 `startExport()` 中设置，导出线程只读
+    QString m_cameraDir;               ///< 导出的摄像头子目录。
+    qint64 m_startMs;                  ///< 请求的开始时间。
+    qint64 m_endMs;                    ///< 请求的结束时间 (不含)。
+    QString m_outputPath;              ///< 导出文件路径。
+
+    // 以下只在导出线程中访问
+    BufferedFileWriter m_writer;       ///< 导出文件的后写缓冲区和I/O线程。
+    QMutex m_writeErrorMutex;          ///< 保护 m_writeError (写入器在自己的I/O线程中报告错误)。
+    QString m_writeError;              ///< 写入器报告的第一个错误。
+    qint64 m_expectedBytes;            ///< 预计的导出文件大小 (来源文件在时间段内的部分)，用于预分配。
+    AVFormatContext *m_output;         ///< 导出文件的封装上下文，为 nullptr 表示尚未创建。
+    AVCodecParameters *m_outputParams; ///< 创建输出时的来源流参数 (拷贝)，用于检查后续文件能否拼接。
+    bool m_incompatible;               ///< 遇到编码参数不同的文件，导出到此为止。
+    int64_t m_shiftUs;                 ///< 来源绝对时间 (微秒) 减去它得到导出时间轴上的时间。
+    int64_t m_firstUs;                 ///< 导出的第一个数据包的绝对时间 (微秒)，AV_NOPTS_VALUE 表示尚未写入。
+    int64_t m_lastDtsUs;               ///< 最后写入的数据包的绝对解码时间 (微秒)。
+    int64_t m_lastEndUs;               ///< 最后写入的数据包的绝对显示结束时间 (微秒)。
+    int64_t m_frameUs;                 ///< 最近一个数据包的时长 (微秒)，压缩空档时使用。
+    int64_t m_lastOutDts;              ///< 最后写入的输出时间戳 (输出流时间基)，保持严格递增。
+    int m_lastPercent;                 ///< 最近发出的进度。
+};
+
+#endif // RECORDINGEXPORTER_H
@@ -0,0 +1,232 @@
+/**
+ * @file recordinglistmodel.cpp
+ * @brief 历史浏览目录列表模型 (RecordingListModel) 的实现文件。
+ *
+ * 视图 (`QListView`，统一行高) 只为可见的行调用 `data()`，因此缩略图在 `data(Qt::DecorationRole)` 中按需请求，
+ * 一个目录中有几千个录像文件时也只加载屏幕上的几张。
+ */
+
+#include "recordinglistmodel.h"
+#include "recordingcatalog.h" // 录像索引
+#include "historyloader.h"    // 后台扫描和缩略图加载
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <algorithm>
+
+RecordingListModel::RecordingListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_catalog(nullptr)
+    , m_loader(new HistoryLoader(this))
+    , m_hasParentEntry(false)
+    , m_generation(0)
+    , m_scanning(false)
+    , m_folderIcon(":/images/folder.png")
+    , m_videoIcon(":/images/mp4.png")
+    , m_thumbnails(THUMBNAIL_CACHE_SIZE)
+{
+    // 加载线程发出的信号排队到GUI线程处理
+    connect(m_loader, &HistoryLoader::directoryBatch, this, &RecordingListModel::onDirectoryBatch);
+    connect(m_loader, &HistoryLoader::thumbnailReady, this, &RecordingListModel::onThumbnailReady);
+    connect(m_loader, &HistoryLoader::thumbnailFailed, this, &RecordingListModel::onThumbnailFailed);
+    m_loader->startLoader();
+}
+
+RecordingListModel::~RecordingListModel()
+{
+    m_loader->stopLoader();
+}
+
+void RecordingListModel::setCatalog(const RecordingCatalog *catalog)
+{
+    m_catalog = catalog;
+}
+
+void RecordingListModel::setThumbnailSize(const QSize &size)
+{
+    m_loader->setThumbnailSize(size);
+    m_thumbnails.clear();
+    m_failedThumbnails.clear();
+}
+
+void RecordingListModel::setDirectory(const QString &dirPath, bool withParentEntry)
+{
+    ++m_generation;
+    m_loader->cancelScan();
+    m_loader->clearThumbnailRequests(); // 上一个目录中尚未加载的缩略图不再需要
+    m_requestedThumbnails.clear();
+
+    beginResetModel();
+    m_items.clear();
+    m_dirPath = dirPath;
+    m_hasParentEntry = withParentEntry;
+    m_scanning = false;
+    if (withParentEntry) {
+        Item parentItem;
+        parentItem.name = "...";
+        parentItem.path = dirPath + "/.."; // 规范化后即上一级目录
+        parentItem.isDir = true;
+        m_items.append(parentItem);
+    }
+
+    // 位于录像索引的根目录下时查询索引 (只有有录像的子目录和已完成的录像文件，均已按名称排序)
+    const QString catalogRoot = m_catalog ? m_catalog->rootPath() : QString();
+    const bool indexed = m_catalog && m_catalog->isOpen()
+            && (dirPath == catalogRoot || dirPath.startsWith(catalogRoot + "/"));
+    if (indexed) {
+        QStringList subdirs;
+        QVector<RecordingCatalog::Entry> entries;
+        m_catalog->listDir(dirPath, &subdirs, &entries);
+        m_items.reserve(m_items.size() + subdirs.size() + entries.size());
+        for (const QString &name : subdirs) {
+            Item item;
+            item.name = name + "/";
+            item.path = dirPath + "/" + name;
+            item.isDir = true;
+            m_items.append(item);
+        }
+        for (const RecordingCatalog::Entry &entry : entries) {
+            Item item;
+            item.name = QFileInfo(entry.path).fileName();
+            item.path = m_catalog->absolutePath(entry);
+            item.isVideo = isVideoFile(item.name);
+            item.toolTip = entryToolTip(entry.startMs, entry.endMs, entry.bytes, entry.flags);
+            m_items.append(item);
+        }
+    }
+    endResetModel();
+
+    if (indexed) {
+        emit listingFinished(itemCount());
+    } else if (!dirPath.isEmpty()) {
+        m_scanning = true;
+        m_loader->scanDirectory(m_generation, dirPath);
+    }
+}
+
+bool RecordingListModel::isVideoFile(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    return suffix == "mp4" || suffix == "ts"; // 分片 MP4 仍使用 .mp4 扩展名
+}
+
+int RecordingListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_items.size();
+}
+
+QVariant RecordingListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_items.size()) {
+        return QVariant();
+    }
+    const Item &item = m_items.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return item.name;
+    case Qt::ToolTipRole:
+        return item.toolTip.isEmpty() ? QVariant() : QVariant(item.toolTip);
+    case PathRole:
+        return item.path;
+    case IsDirRole:
+        return item.isDir;
+    case IsVideoRole:
+        return item.isVideo;
+    case Qt::DecorationRole:
+        if (item.isDir) {
+            return m_folderIcon;
+        }
+        if (!item.isVideo) {
+            return QVariant();
+        }
+        if (QPixmap *thumbnail = m_thumbnails.object(item.path)) {
+            return *thumbnail;
+        }
+        // 这一行可见：请求缩略图 (加载线程后进先出，最近可见的行先加载)
+        if (!m_failedThumbnails.contains(item.path) && !m_requestedThumbnails.contains(item.path)) {
+            m_requestedThumbnails.insert(item.path);
+            m_loader->requestThumbnail(item.path);
+        }
+        return m_videoIcon;
+    default:
+        return QVariant();
+    }
+}
+
+void RecordingListModel::onDirectoryBatch(int generation, const QStringList &dirs, const QStringList &files, bool finished)
+{
+    if (generation != m_generation) {
+        return; // 已切换到别的目录
+    }
+    for (const QString &name : dirs) {
+        Item item;
+        item.name = name + "/";
+        item.path = m_dirPath + "/" + name;
+        item.isDir = true;
+        insertSorted(item);
+    }
+    for (const QString &name : files) {
+        Item item;
+        item.name = name;
+        item.path = m_dirPath + "/" + name;
+        item.isVideo = isVideoFile(name);
+        insertSorted(item);
+    }
+    if (finished) {
+        m_scanning = false;
+        emit listingFinished(itemCount());
+    }
+}
+
+void RecordingListModel::onThumbnailReady(const QString &videoPath, const QImage &image)
+{
+    // 请求可能来自上一个目录 (切换目录前已在解码)：同样缓存，返回这个目录时直接显示
+    m_requestedThumbnails.remove(videoPath);
+    m_thumbnails.insert(videoPath, new QPixmap(QPixmap::fromImage(image)));
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (m_items.at(row).path == videoPath) {
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed, QVector<int>() << Qt::DecorationRole);
+            break;
+        }
+    }
+}
+
+void RecordingListModel::onThumbnailFailed(const QString &videoPath)
+{
+    m_requestedThumbnails.remove(videoPath);
+    m_failedThumbnails.insert(videoPath);
+}
+
+bool RecordingListModel::itemLessThan(const Item &a, const Item &b)
+{
+    if (a.isDir != b.isDir) {
+        return a.isDir; // 目录在前 (与 QDir::DirsFirst 一致)
+    }
+    return a.name < b.name;
+}
+
+void RecordingListModel::insertSorted(const Item &item)
+{
+    const QVector<Item>::iterator begin = m_items.begin() + (m_hasParentEntry ? 1 : 0);
+    const QVector<Item>::iterator pos = std::lower_bound(begin, m_items.end(), item, &RecordingListModel::itemLessThan);
+    const int row = static_cast<int>(pos - m_items.begin());
+    beginInsertRows(QModelIndex(), row, row);
+    m_items.insert(row, item);
+    endInsertRows();
+}
+
+QString RecordingListModel::entryToolTip(qint64 startMs, qint64 endMs, qint64 bytes, quint32 flags)
+{
+    QString text = QString("%1 - %2\n%3 MB")
+            .arg(QDateTime::fromMSecsSinceEpoch(startMs).toString("yyyy-MM-dd HH:mm:ss"))
+            .arg(QDateTime::fromMSecsSinceEpoch(endMs).toString("HH:mm:ss"))
+            .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    if (flags & RecordingCatalog::FlagEvent) {
+        text += "\n事件录像";
+    }
+    if (flags & RecordingCatalog::FlagMotion) {
+        text += "\n检测到移动";
+    }
+    return text;
+}
@@ -0,0 +1,156 @@
+#ifndef RECORDINGLISTMODEL_H
+#define RECORDINGLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QSet>
+#include <QCache>
+#include <QPixmap>
+#include <QIcon>
+#include <QStringList>
+
+class RecordingCatalog; // 录像索引 (StorageManager 维护)
+class HistoryLoader;    // 后台扫描和缩略图加载线程
+
+/**
+ * @brief 历史浏览的目录列表模型 (RecordingListModel)
+ *
+ * 供 `HistoryPage` 的 `QListView` 使用，取代每个目录项一个 `QListWidgetItem` 的列表控件：
+ * - 位于录像索引根目录之下的目录直接查询索引 (内存查询)，一次性填充；其它目录交给 `HistoryLoader`
+ *   在后台扫描，按批插入，GUI线程不读取目录。列表始终按 "目录在前、名称升序" 排序。
+ * - 录像文件的图标是缩略图：只有视图请求某一行的图标 (即这一行可见) 时才向 `HistoryLoader` 请求加载，
+ *   加载完成前显示默认图标。最近的 THUMBNAIL_CACHE_SIZE 张缩略图缓存在内存中。
+ * - 索引中的录像文件带工具提示 (起止时间、大小、事件/移动标志)。
+ */
+class RecordingListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 自定义数据角色。
+     */
+    enum Roles {
+        PathRole = Qt::UserRole, ///< 绝对路径 (QString)；返回上一级的 "..." 项为 "<目录>/.."。
+        IsDirRole,               ///< 是否为目录 (bool)。
+        IsVideoRole              ///< 是否为录像文件 (bool)。
+    };
+
+    explicit RecordingListModel(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止后台加载线程。
+     */
+    ~RecordingListModel();
+
+    /**
+     * @brief 设置录像索引，下一次 `setDirectory()` 生效。
+     * @param catalog 录像索引 (由 StorageManager 拥有)，为 nullptr 时所有目录都在后台扫描。
+     */
+    void setCatalog(const RecordingCatalog *catalog);
+
+    /**
+     * @brief 设置缩略图尺寸 (应与视图的 `iconSize()` 一致)，清空缩略图缓存。
+     */
+    void setThumbnailSize(const QSize &size);
+
+    /**
+     * @brief 切换到一个目录：清空列表，从索引填充或开始后台扫描。
+     * @param dirPath 目录的绝对路径，为空时只清空列表。
+     * @param withParentEntry 是否在第一行加入返回上一级的 "..." 项。
+     *
+     * 列表填充完成时发出 `listingFinished()` (使用索引时在返回之前发出)。
+     */
+    void setDirectory(const QString &dirPath, bool withParentEntry);
+
+    /**
+     * @brief 当前目录的绝对路径。
+     */
+    QString directory() const { return m_dirPath; }
+
+    /**
+     * @brief 是否正在后台扫描当前目录。
+     */
+    bool isScanning() const { return m_scanning; }
+
+    /**
+     * @brief 当前目录中已列出的项目数 (不含 "..." 项)。
+     */
+    int itemCount() const { return m_items.size() - (m_hasParentEntry ? 1 : 0); }
+
+    /**
+     * @brief 判断文件是否为录像文件 (扩展名为 mp4 或 ts，忽略大小写)。
+     */
+    static bool isVideoFile(const QString &fileName);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+signals:
+    /**
+     * @brief 当前目录已全部列出。
+     * @param itemCount 项目数 (不含 "..." 项)。
+     */
+    void listingFinished(int itemCount);
+
+private slots:
+    /**
+     * @brief 后台扫描到一批目录项 (排队连接)：按排序位置插入，过期的批次丢弃。
+     */
+    void onDirectoryBatch(int generation, const QStringList &dirs, const QStringList &files, bool finished);
+
+    /**
+     * @brief 缩略图已加载 (排队连接)：缓存并通知视图重绘这一行。
+     */
+    void onThumbnailReady(const QString &videoPath, const QImage &image);
+
+    /**
+     * @brief 缩略图加载失败 (排队连接)：这个文件不再请求，一直显示默认图标。
+     */
+    void onThumbnailFailed(const QString &videoPath);
+
+private:
+    /**
+     * @brief 列表中的一项。
+     */
+    struct Item {
+        QString name;          ///< 显示名称 (目录名后加 "/")。
+        QString path;          ///< 绝对路径。
+        bool isDir = false;    ///< 是否为目录。
+        bool isVideo = false;  ///< 是否为录像文件。
+        QString toolTip;       ///< 工具提示 (索引中的录像文件)，可为空。
+    };
+
+    /**
+     * @brief 排序规则：目录在前，名称升序；"..." 项始终在第一行。
+     */
+    static bool itemLessThan(const Item &a, const Item &b);
+
+    /**
+     * @brief 按排序位置插入一项 (发出 rowsInserted)。
+     */
+    void insertSorted(const Item &item);
+
+    /**
+     * @brief 索引记录的工具提示文本。
+     */
+    static QString entryToolTip(qint64 startMs, qint64 endMs, qint64 bytes, quint32 flags);
+
+    static const int THUMBNAIL_CACHE_SIZE = 256; ///< 内存中缓存的缩略图张数。
+
+    const RecordingCatalog *m_catalog; ///< 录像索引，可为 nullptr。
+    HistoryLoader *m_loader;           ///< 后台扫描和缩略图加载线程 (子对象)。
+    QVector<Item> m_items;             ///< 当前目录的列表项，已排序。
+    QString m_dirPath;                 ///< 当前目录的绝对路径。
+    bool m_hasParentEntry;             ///< 第一行是 "..." 项。
+    int m_generation;                  ///< 列表编号，每次 `setDirectory()` 加一，用于丢弃过期的扫描结果。
+    bool m_scanning;                   ///< 正在后台扫描当前目录。
+
+    QIcon m_folderIcon;                ///< 目录图标。
+    QIcon m_videoIcon;                 ///< 录像文件的默认图标 (缩略图加载前或无法生成缩略图时)。
+    QCache<QString, QPixmap> m_thumbnails;   ///< 已加载的缩略图 (按录像文件路径)。
+    mutable QSet<QString> m_requestedThumbnails; ///< 已请求、尚未返回的缩略图 (`data()` 中请求)。
+    QSet<QString> m_failedThumbnails;  ///< 无法加载的缩略图，不再请求。
+};
+
+#endif // RECORDINGLISTMODEL_H
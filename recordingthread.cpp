@@ -1,4 +1,8 @@
 #include "recordingthread.h"
+#include "pixel_convert.h" // RGB565 / YUYV / NV12 -> I420 转换内核
+#include "slicepool.h"     // 720p 及以上的分条带并行转换
+
+#include <linux/videodev2.h> // V4L2_PIX_FMT_*
 
 #include <QDebug>
 #include <QDir>
@@ -9,37 +13,129 @@
  * @brief 视频录制线程类 (RecordingThread) 的实现文件。
  * 
  * 本文件负责实现一个独立的线程，用于从摄像头捕获的原始图像帧数据
- * 进行H.264视频编码，并将编码后的数据写入MP4文件。
+ * 进行H.264视频编码，并将编码后的数据写入MP4 (或分片 MP4 / MPEG-TS) 文件。
  * 主要功能包括：
  * - 使用 FFmpeg 库进行视频编码和文件封装。
  * - 管理一个帧数据队列，主线程（如 MonitorPage）将捕获到的帧添加到此队列。
  * - 录制线程从队列中取出帧进行处理。
  * - 支持开始录制、停止录制操作。
  * - 支持视频的自动分段录制（例如每30分钟一段）。
+ * - 支持待命录制：只在事件期间写文件，事件文件包含预录缓冲区中事件前的画面。
+ * - 支持延时录制：只编码按采样间隔抽取的帧，移动期间恢复全帧率。
  * - 在录制出错时通过信号通知主线程。
  * - 计算并输出录制视频的平均帧率。
  */
 
+/**
+ * @brief 采集线程按固定间隔抽帧：判断一帧是否到了录制时刻。
+ * @param timestampUs 这一帧的采集时间戳 (微秒)。
+ * @param intervalUs 抽帧间隔 (微秒)。
+ * @param slackUs 允许提前的时间，采集时间戳的抖动不会让本应录制的帧被跳过。
+ * @param nextUs 下一个录制时刻，-1 表示下一帧直接录制；选中时推进一个间隔，
+ *               长时间没有帧 (或第一帧) 时从本帧重新计时。
+ * @return 这一帧应当录制时返回 true。
+ */
+static bool frameDue(long long timestampUs, long long intervalUs, long long slackUs, long long *nextUs)
+{
+    if (*nextUs >= 0 && timestampUs + slackUs < *nextUs) {
+        return false;
+    }
+    if (*nextUs < 0 || timestampUs - *nextUs >= intervalUs) {
+        *nextUs = timestampUs + intervalUs;
+    } else {
+        *nextUs += intervalUs;
+    }
+    return true;
+}
+
 RecordingThread::RecordingThread(QObject *parent)
     : QThread(parent)
-    , m_isRecording(false)
-    , m_shouldExit(false)
+    , m_state(StateIdle)
+    , m_shouldExit(0)
+    , m_sessionPending(false)
     , m_frameCount(0)
     , m_width(0)
     , m_height(0)
+    , m_inputFormat(AV_PIX_FMT_RGB24)
+    , m_inputCodec(AV_CODEC_ID_RAWVIDEO)
+    , m_frameRate(DEFAULT_FRAME_RATE)
+    , m_firstTimestampUs(-1)
+    , m_lastPts(AV_NOPTS_VALUE)
+    , m_producerBusy(0)
+    , m_queueCapacity(0)
+    , m_requestedCapacity(DEFAULT_QUEUE_CAPACITY)
+    , m_overflowPolicy(DropOldest)
+    , m_droppedFrames(0)
+    , m_queueHighWater(0)
     , m_formatContext(nullptr)
+    , m_encoderThreads(0)
+    , m_adaptiveThreads(0)
+    , m_encoderThreadCount(0)
     , m_codecContext(nullptr)
     , m_swsContext(nullptr)
-    , m_frame(nullptr)
+    , m_sessionProducerConvert(false)
+    , m_convertSlices(1)
     , m_packet(nullptr)
+    , m_decoderContext(nullptr)
+    , m_decodedFrame(nullptr)
+    , m_decodePacket(nullptr)
     , m_startTime(std::chrono::steady_clock::now())  // 初始化开始时间
     , m_lastFrameTime(std::chrono::steady_clock::now())  // 初始化上一帧时间
     , m_totalFrames(0)  // 总帧数
     , m_totalTime(0.0)  // 总时间（秒）
-    , m_segmentTimer(nullptr)
     , m_autoSegmentation(true) // 默认启用自动分段
-    , m_maxRecordingMinutes(30) // 默认30分钟自动分段
+    , m_segmentSeconds(DEFAULT_SEGMENT_SECONDS) // 默认30分钟自动分段
+    , m_segmentLengthPts(0)
+    , m_segmentStartPts(0)
+    , m_rotatePts(0)
+    , m_rotatePending(false)
+    , m_muxerTsOffset(0)
+    , m_containerFormat(ContainerFragmentedMp4) // 默认使用断电安全的分片 MP4
+    , m_flushIntervalMs(DEFAULT_FLUSH_INTERVAL_MS)
+    , m_sessionContainer(ContainerFragmentedMp4)
+    , m_flushIntervalPts(0)
+    , m_lastFlushPts(0)
+    , m_fileKeyFrames(0)
+    , m_fileMotion(false)
+    , m_reportedBytes(0)
+    , m_standby(false)
+    , m_preEventSeconds(DEFAULT_PRE_EVENT_SECONDS)
+    , m_preEventBytes(DEFAULT_PRE_EVENT_BYTES)
+    , m_eventOpenPending(false)
+    , m_eventFileOpen(false)
+    , m_eventClosePending(false)
+    , m_eventRequests(0)
+    , m_forceKeyFrame(false)
+    , m_motionEnabled(false)
+    , m_idleFrameDivisor(DEFAULT_IDLE_FRAME_DIVISOR)
+    , m_sessionMotion(false)
+    , m_sessionIdleDivisor(1)
+    , m_idleFrameCounter(0)
+    , m_keyFrameRequested(0)
+    , m_substreamEnabled(false)
+    , m_adaptiveEnabled(false)
+    , m_sessionAdaptive(false)
+    , m_sessionGopPts(0)
+    , m_lastKeyPts(AV_NOPTS_VALUE)
+    , m_sessionEncoderThreads(0)
+    , m_recordFrameRate(0)
+    , m_sessionFrameIntervalUs(0)
+    , m_nextFrameUs(-1)
+    , m_timeLapseEnabled(false)
+    , m_sessionLapseIntervalUs(0)
+    , m_sessionLapseProbeUs(0)
+    , m_sessionLapseMotionSwitch(false)
+    , m_sessionLapseIntraOnly(false)
+    , m_sessionLapseGopPts(0)
+    , m_nextSampleUs(-1)
+    , m_producerFullRate(false)
+    , m_lastFrameSampled(false)
+    , m_motionActive(0)
 {
+    // I/O线程写入失败 (存储空间已满、TF卡被拔出) 时报告具体原因，封装器随后的写操作也会失败
+    connect(&m_fileWriter, &BufferedFileWriter::writeError, this, &RecordingThread::recordError);
+    // 录制线程收尾结束后，回到本对象所在的线程开始收尾期间请求的会话
+    connect(this, &RecordingThread::sessionIdle, this, &RecordingThread::startPendingSession, Qt::QueuedConnection);
 }
 
 RecordingThread::~RecordingThread()
@@ -47,95 +143,187 @@ RecordingThread::~RecordingThread()
     // 确保停止录制并清理资源
     stopRecording();
     
-    // 等待线程结束
-    m_shouldExit = true;
-    m_condition.wakeAll();
+    // 等待线程结束 (线程会先编码完剩余的帧并写入文件尾)
+    m_shouldExit.storeRelease(1);
+    m_frameWaker.wake();
     wait();
     
-    // 清空帧队列
-    QMutexLocker locker(&m_queueMutex);
-    while (!m_frameQueue.isEmpty()) {
-        delete m_frameQueue.dequeue();
-    }
-    
-    // 清理分段定时器
-    if (m_segmentTimer) {
-        m_segmentTimer->stop();
-        delete m_segmentTimer;
-        m_segmentTimer = nullptr;
-    }
+    // 释放所有帧槽 (线程已退出，采集线程已在 CameraChannel 中先停止，不会再有帧槽被占用)
+    qDeleteAll(m_framePool);
+    m_framePool.clear();
 }
 
 /**
  * @brief 开始一个新的视频录制会话。
- * @param filePath 要保存的MP4视频文件的完整路径。
+ * @param filePath 要保存的视频文件的完整路径。
  * @param width 视频帧的宽度 (像素)。
  * @param height 视频帧的高度 (像素)。
+ * @param inputFormat 送入队列的原始帧像素格式 (RGB24 / RGB565LE / YUYV422 / NV12 等)。
+ * @param inputCodec 送入数据的编码方式 (RAWVIDEO 或 MJPEG)。
  * @return 如果成功初始化并开始录制，则返回 true；否则返回 false。
  * 
  * 此函数执行以下操作：
- * 1. 检查是否已在录制中，如果是则直接返回 false。
- * 2. 保存传入的文件路径、宽度和高度到成员变量。
+ * 1. 检查是否已在录制中，如果是则直接返回 false；上一段录制仍在收尾 (停止中) 时只记下参数并返回 true，
+ *    编码线程写完文件尾回到空闲后由 `startPendingSession()` 从第2步开始执行 (调用线程不等待)。
+ * 2. 调用 `ensureFramePool()` 按分辨率和输入格式预分配帧槽和每个帧槽的YUV420P图像帧，然后保存传入的文件路径、宽度、高度、输入像素格式和编码方式到成员变量。
  * 3. 重置帧计数器、总帧数、总时间，并记录当前时间为录制开始时间。
  * 4. 确保输出文件所在的目录存在，如果不存在则尝试创建它。
  * 5. 调用 `initRecorder()` 初始化FFmpeg编码器和相关上下文。
  * 6. 如果初始化失败，则返回 false。
- * 7. 设置 `m_isRecording` 标志为 true。
- * 8. 如果启用了自动分段 (`m_autoSegmentation`)，则初始化并启动分段定时器 `m_segmentTimer`。
- *    该定时器会在达到 `m_maxRecordingMinutes` 分钟后触发 `recordingTimeReached30Minutes` 信号。
+ * 7. 把录制状态设置为 `StateRecording`。
+ * 8. 如果启用了自动分段 (`m_autoSegmentation`)，把分段时长换算为显示时间戳的长度，
+ *    由录制线程在帧的时间戳跨过分段点时自行切换文件 (见 `rotateSegment()`)。
  * 9. 如果线程尚未运行，则调用 `start()` 启动线程的 `run()` 方法；否则，唤醒已在运行的线程。
+ *
+ * 编码器在录制状态为空闲时才初始化，因此不会与编码线程中上一段录制的 `cleanupRecorder()` 同时操作 FFmpeg 上下文。
  */
-bool RecordingThread::startRecording(const QString &filePath, int width, int height)
+bool RecordingThread::startRecording(const QString &filePath, int width, int height,
+                                     AVPixelFormat inputFormat, AVCodecID inputCodec, int frameRate)
 {
-    QMutexLocker locker(&m_mutex);
+    if (filePath.isEmpty()) {
+        return false; // 不写文件的录制请使用 startStandby()
+    }
+    return startSession(filePath, width, height, inputFormat, inputCodec, frameRate);
+}
+
+bool RecordingThread::startStandby(int width, int height, AVPixelFormat inputFormat, AVCodecID inputCodec, int frameRate)
+{
+    return startSession(QString(), width, height, inputFormat, inputCodec, frameRate);
+}
 
-    if (m_isRecording) {
+bool RecordingThread::startSession(const QString &filePath, int width, int height,
+                                   AVPixelFormat inputFormat, AVCodecID inputCodec, int frameRate)
+{
+    if (isRecording()) {
         return false; // 已经在录制中
     }
+    {
+        // 停止后立即重新开始录制时 (stopRecording() 后紧接着调用本函数)：编码线程还在编码剩余的帧、
+        // 写上一段的文件尾 (fdatasync 和排空写入缓冲区可能要几秒)。不在调用线程中等待，收尾结束后再开始。
+        // finishSession() 在 m_mutex 下回到空闲并检查请求，不会错过。
+        QMutexLocker locker(&m_mutex);
+        if (m_sessionPending) {
+            return false; // 已有等待开始的会话
+        }
+        if (m_state.loadAcquire() == StateStopping) {
+            m_pendingSession.filePath = filePath;
+            m_pendingSession.width = width;
+            m_pendingSession.height = height;
+            m_pendingSession.inputFormat = inputFormat;
+            m_pendingSession.inputCodec = inputCodec;
+            m_pendingSession.frameRate = frameRate;
+            m_sessionPending = true;
+            return true;
+        }
+    }
+
+    // 预分配帧槽：原始格式输入由采集线程直接转换进帧槽的图像帧，不需要数据缓冲区；
+    // MJPEG 按 YUYV 大小预留压缩数据缓冲区，足以容纳绝大多数JPEG帧。
+    // 此时录制状态为空闲，编码线程不会访问帧槽和队列。
+    const bool producerConvert = (inputCodec == AV_CODEC_ID_RAWVIDEO);
+    if (!ensureFramePool(producerConvert ? 0 : width * height * 2, width, height)) {
+        emit recordError("无法分配视频帧缓冲区");
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
 
     m_filePath = filePath;
     m_width = width;
     m_height = height;
+    m_inputFormat = inputFormat;
+    m_inputCodec = inputCodec;
+    // 原始格式由采集线程转换；720p 及以上按线程池的线程数 (含采集线程) 分条带并行
+    m_sessionProducerConvert = producerConvert;
+    m_convertSlices = (producerConvert && width * height >= PARALLEL_CONVERT_MIN_PIXELS)
+            ? SlicePool::instance()->workerCount() + 1 : 1;
+    m_frameRate = frameRate > 0 ? frameRate : DEFAULT_FRAME_RATE;
+    // 录制帧率低于采集帧率时由生产者抽帧，编码器按录制帧率做码率控制。
+    // 此时录制状态为空闲，采集线程不会读写抽帧状态。
+    if (m_recordFrameRate > 0 && m_recordFrameRate < m_frameRate) {
+        m_frameRate = m_recordFrameRate;
+        m_sessionFrameIntervalUs = 1000000LL / m_recordFrameRate;
+    } else {
+        m_sessionFrameIntervalUs = 0;
+    }
+    m_nextFrameUs = -1;
+    // 延时录制：移动期间恢复全帧率需要本次会话做移动侦测，此时采样之间以不超过1秒的间隔送入侦测帧
+    m_sessionLapseIntervalUs = m_timeLapseEnabled ? (long long)m_timeLapseSettings.intervalMs * 1000 : 0;
+    m_sessionLapseMotionSwitch = m_sessionLapseIntervalUs > 0 && m_timeLapseSettings.fullRateOnMotion && m_motionEnabled;
+    m_sessionLapseProbeUs = m_sessionLapseMotionSwitch
+            ? qMin(m_sessionLapseIntervalUs, (long long)LAPSE_PROBE_INTERVAL_MS * 1000) : m_sessionLapseIntervalUs;
+    m_sessionLapseIntraOnly = m_timeLapseSettings.intraOnly;
+    m_sessionLapseGopPts = (int64_t)qMax((long long)m_timeLapseSettings.intervalMs,
+                                         qMin((long long)m_timeLapseSettings.intervalMs * LAPSE_GOP_SAMPLES,
+                                              (long long)LAPSE_MAX_GOP_MS)) * PTS_CLOCK_RATE / 1000;
+    m_nextSampleUs = -1;
+    m_producerFullRate = false;
+    m_lastFrameSampled = false;
+    m_firstTimestampUs = -1; // 每次录制的时间戳从0开始 (分段后的文件由封装器时间戳偏移归零)
+    m_lastPts = AV_NOPTS_VALUE;
+    m_segmentStartTime = QDateTime::currentDateTime();
+    m_segmentLengthPts = m_autoSegmentation ? (int64_t)m_segmentSeconds * PTS_CLOCK_RATE : 0;
+    m_segmentStartPts = 0;
+    m_rotatePending = false;
+    m_muxerTsOffset = 0;
+    m_sessionContainer = m_containerFormat;
+    m_flushIntervalPts = (m_sessionContainer == ContainerMp4) ? 0 : (int64_t)m_flushIntervalMs * PTS_CLOCK_RATE / 1000;
+    m_lastFlushPts = 0;
+    m_standby = filePath.isEmpty();
+    m_eventOpenPending = false;
+    m_eventFileOpen = false;
+    m_eventClosePending = false;
+    m_eventRequests.store(0);
+    m_forceKeyFrame = false;
+    // 预录缓冲区只在待命录制时使用；此时录制线程空闲，可以直接修改
+    m_preEventRing.clear();
+    m_preEventRing.setLimits(m_standby ? (int64_t)m_preEventSeconds * PTS_CLOCK_RATE : 0, m_preEventBytes);
+    // 移动侦测每次会话从静止开始，第一帧只建立参考图
+    m_sessionMotion = m_motionEnabled;
+    m_sessionIdleDivisor = (m_sessionMotion && m_standby) ? m_idleFrameDivisor : 1;
+    m_sessionAdaptive = m_adaptiveEnabled; // 控制器在 initRecorder() 打开编码器后按实际码率配置
+    m_lastKeyPts = AV_NOPTS_VALUE;
+    m_idleFrameCounter = 0;
+    m_motionDetector.configure(m_motionSettings);
+    m_motionActive.storeRelease(0);
     m_frameCount = 0;
     m_totalFrames = 0;  // 重置总帧数
     m_totalTime = 0.0;  // 重置总时间
     m_startTime = std::chrono::steady_clock::now();  // 记录开始时间
     m_lastFrameTime = m_startTime;  // 初始化上一帧时间
-    m_shouldExit = false;
 
-    // 确保输出目录存在
+    // 确保输出目录存在 (待命录制的事件文件目录由调用者创建)
     QDir dir = QFileInfo(m_filePath).dir();
-    if (!dir.exists()) {
+    if (!m_standby && !dir.exists()) {
         dir.mkpath(".");
     }
 
-    // 初始化录制器
+    // 初始化录制器 (文件写入线程先启动，initRecorder() 中打开第一个文件)
+    m_fileWriter.startWriter();
     if (!initRecorder()) {
+        m_fileWriter.stopWriter();
         return false;
     }
-
-    m_isRecording = true;
-    
-    // 初始化并启动分段录制定时器
-    if (m_autoSegmentation) {
-        if (!m_segmentTimer) {
-            m_segmentTimer = new QTimer(this);
-            connect(m_segmentTimer, &QTimer::timeout, this, [this]() {
-                // 发送录制时间达到30分钟的信号
-                emit recordingTimeReached30Minutes(m_filePath);
-            });
-        }
-        
-        // 设置定时器为30分钟（1800000毫秒）
-        m_segmentTimer->start(m_maxRecordingMinutes * 60 * 1000);
+    m_encoderName = m_encoder.name();
+    m_encoderThreadCount = m_codecContext->thread_count;
+    m_packetFanout.start(m_codecContext); // 网络推流等数据包消费者从这次编码的第一个数据包开始接收
+    if (m_substreamEnabled) {
+        // 此时录制线程空闲，不会同时提交帧
+        QString substreamError;
+        m_substream.setSettings(m_substreamSettings);
+        if (!m_substream.startEncoding(m_width, m_height, &substreamError)) {
+            qWarning() << "子码流不可用，只录制主码流:" << substreamError;
+        }
     }
+
+    m_state.storeRelease(StateRecording); // 之后采集线程开始送帧
     
     // 启动线程
     if (!isRunning()) {
         start();
     } else {
         // 唤醒线程
-        m_condition.wakeAll();
+        m_frameWaker.wake();
     }
     
     return true;
@@ -145,11 +333,11 @@ bool RecordingThread::startRecording(const QString &filePath, int width, int hei
  * @brief 请求停止当前的视频录制会话。
  * 
  * 此函数执行以下操作：
- * 1. 检查是否未在录制，如果是则直接返回。
- * 2. 设置 `m_isRecording` 标志为 false。
- * 3. 如果分段定时器 `m_segmentTimer` 正在运行，则停止它。
- * 4. 唤醒录制线程 (`run()` 方法中的等待)，使其能够检测到 `m_isRecording` 变为 false，
- *    从而执行清理工作 (如 `cleanupRecorder()`) 并结束当前录制段。
+ * 1. 把录制状态从 `StateRecording` 切换为 `StateStopping`；未在录制时直接返回。
+ *    此后采集线程不再送帧。
+ *    状态切换与录制线程的分段切换都在 `m_mutex` 下进行，返回后 `getFilePath()` 即为最后一段的文件。
+ * 2. 唤醒录制线程 (`run()` 方法中的等待) 和 BlockCapture 策略下等待帧槽的采集线程。
+ *    录制线程编码完队列中剩余的帧后执行 `cleanupRecorder()` 结束当前录制段，状态回到空闲。
  * 
  * 注意：此函数只是设置标志并唤醒线程，实际的编码和文件关闭操作在 `run()` 方法中异步完成。
  */
@@ -157,444 +345,1351 @@ void RecordingThread::stopRecording()
 {
     QMutexLocker locker(&m_mutex);
 
-    if (!m_isRecording) {
+    m_sessionPending = false; // 上一段收尾期间请求的会话不再开始
+    if (!m_state.testAndSetOrdered(StateRecording, StateStopping)) {
         return; // 未在录制状态
     }
-
-    m_isRecording = false;
-    
-    // 停止分段定时器
-    if (m_segmentTimer && m_segmentTimer->isActive()) {
-        m_segmentTimer->stop();
-    }
+    m_eventOpenPending = false; // 待命录制时尚未打开的事件不再打开；已打开的事件文件在收尾时关闭
     
-    // 唤醒可能因等待新帧或等待开始录制而阻塞的 run() 循环
-    // 这样 run() 可以检查到 m_isRecording 变为 false，并执行后续的清理和退出逻辑
-    m_condition.wakeAll();
+    // 唤醒可能停放在空队列上的 run() 循环，使其执行收尾逻辑
+    m_frameWaker.wake();
+    m_slotWaker.wake(); // BlockCapture 策略下等待空闲帧槽的采集线程立即返回
 }
 
-/**
- * @brief 将一帧原始图像数据添加到待处理队列中。
- * @param frameData 指向包含原始图像数据（例如RGB888格式）的缓冲区的指针。
- * @param size 图像数据的总字节大小。
- * @return 如果成功将帧数据添加到队列，则返回 true；否则返回 false。
- * 
- * 此函数由主线程（例如 `MonitorPage`）调用，用于将从摄像头捕获到的视频帧
- * 传递给录制线程进行编码。
- * 
- * 执行逻辑：
- * 1. 检查当前是否正在录制，以及传入的帧数据和大小是否有效。如果无效，则直接返回 false。
- * 2. 创建一个新的 `FrameData` 对象，将传入的 `frameData` 和 `size` 复制到其中。
- *    (`FrameData` 内部会分配内存并复制数据，以确保数据的生命周期由录制线程管理)。
- * 3. 将创建的 `FrameData` 对象添加到帧队列 `m_frameQueue` 的末尾。
- * 4. 唤醒录制线程 (`run()` 方法中的等待)，通知其有新的帧数据需要处理。
- */
-bool RecordingThread::addFrameToQueue(const unsigned char *frameData, int size)
+bool RecordingThread::cancelPendingSession()
 {
-    if (!m_isRecording || !frameData || size <= 0) {
-        return false;
-    }
-
-    // 创建帧数据副本并添加到队列
-    QMutexLocker locker(&m_queueMutex);
-    m_frameQueue.enqueue(new FrameData(frameData, size));
-    
-    // 唤醒线程处理新帧
-    m_condition.wakeOne();
-    
-    return true;
+    QMutexLocker locker(&m_mutex);
+    const bool pending = m_sessionPending;
+    m_sessionPending = false;
+    return pending;
 }
 
-/**
- * @brief 录制线程的主执行函数 (QThread::run() 的重写)。
- * 
- * 此函数是录制线程的入口点，在一个循环中运行，直到 `m_shouldExit` 标志被设置为 true。
- * 主要逻辑：
- * 1. 循环从帧队列 `m_frameQueue` 中获取待处理的帧数据 (`FrameData`)。
- * 2. 如果队列为空：
- *    - 检查 `m_isRecording` 状态。如果不再录制，则调用 `cleanupRecorder()` 清理FFmpeg资源，
- *      计算并输出平均帧率，然后线程进入等待状态，直到下一次 `startRecording()` 被调用或 `m_shouldExit` 为 true。
- *    - 如果仍在录制但队列为空，则线程进入等待状态，直到有新帧被添加到队列或 `m_isRecording` 变为 false。
- * 3. 如果成功从队列中获取到一帧数据：
- *    - 再次检查 `m_isRecording` 状态。如果仍在录制，则调用 `processFrame()` 处理该帧（进行颜色空间转换和编码）。
- *    - 删除已处理的 `FrameData` 对象以释放内存。
- * 4. 当 `m_shouldExit` 为 true 时，循环结束，在退出前调用 `cleanupRecorder()` 确保所有资源被释放。
- */
-void RecordingThread::run()
+void RecordingThread::startPendingSession()
 {
-    while (!m_shouldExit) {
-        FrameData *frameData = nullptr;
-        
-        // 从队列获取帧
-        {
-            QMutexLocker locker(&m_queueMutex);
-            if (m_frameQueue.isEmpty()) {
-                // 如果队列为空，等待新帧或停止信号
-                m_mutex.lock();
-                bool isRecording = m_isRecording;
-                m_mutex.unlock();
-                
-                if (!isRecording) {
-                    // 如果不再录制，清理资源并退出循环
-                    cleanupRecorder();
-                    
-                    // 计算并输出平均帧率
-                    if (m_totalFrames > 0) {
-                        double averageFPS = m_totalFrames / m_totalTime;
-                        qDebug() << "平均帧率:" << averageFPS << "FPS";
-                    } else {
-                        qDebug() << "未录制任何帧";
-                    }
-                    
-                    // 等待下一次录制开始
-                    m_mutex.lock();
-                    m_condition.wait(&m_mutex);
-                    m_mutex.unlock();
-                    continue;
-                }
-                
-                // 等待新帧
-                m_condition.wait(&m_queueMutex);
-                
-                // 再次检查队列
-                if (m_frameQueue.isEmpty()) {
-                    continue;
-                }
-            }
-            
-            frameData = m_frameQueue.dequeue();
-        }
-        
-        // 处理帧
-        if (frameData) {
-            m_mutex.lock();
-            bool isRecording = m_isRecording;
-            m_mutex.unlock();
-            
-            if (isRecording) {
-                processFrame(frameData);
-            }
-            
-            delete frameData;
+    PendingSession session;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_sessionPending || m_state.loadAcquire() != StateIdle) {
+            return; // 已取消
         }
+        session = m_pendingSession;
+        m_sessionPending = false;
+    }
+    if (!startSession(session.filePath, session.width, session.height,
+                      session.inputFormat, session.inputCodec, session.frameRate)) {
+        // 原因已通过 recordError 报告；没有打开文件，调用者停止录制时不再处理上一段的文件
+        QMutexLocker locker(&m_mutex);
+        m_filePath.clear();
     }
-    
-    // 线程退出前清理资源
-    cleanupRecorder();
 }
 
 /**
- * @brief 初始化FFmpeg录制器相关的组件。
- * @return 如果所有组件成功初始化，则返回 true；否则返回 false。
- *
- * 此函数负责为一次新的录制会话（或一个新的分段）设置FFmpeg。
- * 主要步骤：
- * 1. 使用 `avformat_alloc_output_context2()` 根据输出文件路径和格式（MP4）分配封装格式上下文 (`m_formatContext`)。
- * 2. 使用 `avcodec_find_encoder()` 查找H.264编码器。
- * 3. 使用 `avcodec_alloc_context3()` 分配编码器上下文 (`m_codecContext`)。
- * 4. 设置编码器参数，如视频宽度、高度、时间基、帧率、像素格式 (YUV420P)、比特率等。
- *    - 为了提高性能，启用多线程编码 (4个线程，帧级并行)。
- *    - 设置编码预设为 "ultrafast" 和调优为 "zerolatency" 以追求更快的编码速度和低延迟。
- * 5. 使用 `avcodec_open2()` 打开编码器。
- * 6. 使用 `avformat_new_stream()` 在封装格式上下文中创建一个新的视频流。
- * 7. 使用 `avcodec_parameters_from_context()` 将编码器上下文的参数复制到视频流的参数中。
- * 8. 如果输出格式的标志包含 `AVFMT_GLOBALHEADER`，则请求编码器写入全局头信息。
- * 9. 使用 `avio_open()` 打开输出文件以供写入。
- * 10. 使用 `avformat_write_header()` 写入输出文件的头部信息。
- * 11. 分配 `AVFrame` (`m_frame`) 用于存储转换后的YUV420P图像数据，并为其分配图像缓冲区。
- * 12. 分配 `AVPacket` (`m_packet`) 用于存储编码后的H.264数据。
- * 13. 初始化SwsContext (`m_swsContext`) 用于将输入的RGB888帧数据转换为编码器所需的YUV420P格式。
+ * @brief 把摄像头协商出的 V4L2 像素格式映射为录制输入参数。
  *
- * 如果任何步骤失败，会通过 `recordError` 信号发送错误信息，并返回 false。
+ * RGB565 / YUYV / NV12 原始帧由 pixel_convert 内核直接转换为 YUV420P；
+ * MJPEG 帧交给 FFmpeg 的 JPEG 解码器。
  */
-bool RecordingThread::initRecorder()
+bool RecordingThread::inputFromV4l2(unsigned int v4l2PixelFormat, AVPixelFormat *inputFormat, AVCodecID *inputCodec)
 {
-    // 初始化 FFmpeg 输出上下文
-    avformat_alloc_output_context2(&m_formatContext, nullptr, nullptr, m_filePath.toStdString().c_str());
-    if (!m_formatContext) {
-        emit recordError("无法创建输出上下文");
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    AVCodecID codec = AV_CODEC_ID_RAWVIDEO;
+    switch (v4l2PixelFormat) {
+    case V4L2_PIX_FMT_RGB565: format = AV_PIX_FMT_RGB565LE; break;
+    case V4L2_PIX_FMT_YUYV:   format = AV_PIX_FMT_YUYV422;  break;
+    case V4L2_PIX_FMT_NV12:   format = AV_PIX_FMT_NV12;     break;
+    case V4L2_PIX_FMT_MJPEG:  codec = AV_CODEC_ID_MJPEG;    break;
+    default:
         return false;
     }
+    if (inputFormat) *inputFormat = format;
+    if (inputCodec) *inputCodec = codec;
+    return true;
+}
 
-    // 查找 H.264 编码器
-    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    if (!codec) {
-        emit recordError("无法找到 H.264 编码器");
-        avformat_free_context(m_formatContext);
-        return false;
-    }
+QString RecordingThread::getFilePath() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_filePath; // 自动分段时由录制线程更新
+}
 
-    // 创建编码器上下文
-    m_codecContext = avcodec_alloc_context3(codec);
-    if (!m_codecContext) {
-        emit recordError("无法创建编码器上下文");
-        avformat_free_context(m_formatContext);
-        return false;
-    }
+QDateTime RecordingThread::segmentStartTime() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_segmentStartTime;
+}
 
-    // 设置编码参数
-    m_codecContext->width = m_width;
-    m_codecContext->height = m_height;
-    m_codecContext->time_base = {1, 8};
-    m_codecContext->framerate = {8, 1};
-    m_codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
-    m_codecContext->bit_rate = 800000; // 目标比特率 (800 kbps)，影响视频质量和文件大小
-    
-    // 启用多线程编码以提高性能
-    if (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS) {
-        m_codecContext->thread_count = 4; // 尝试使用4个线程进行编码
-        m_codecContext->thread_type = FF_THREAD_FRAME; // 帧级并行
-        qDebug() << "RecordingThread: H.264编码器启用帧级多线程，线程数:" << m_codecContext->thread_count;
-    } else if (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
-        m_codecContext->thread_count = 4; // 尝试使用4个线程进行编码
-        m_codecContext->thread_type = FF_THREAD_SLICE; // 片级并行
-        qDebug() << "RecordingThread: H.264编码器启用片级多线程，线程数:" << m_codecContext->thread_count;
-    } else {
-        m_codecContext->thread_count = 1; // 编码器不支持多线程或仅支持单线程
-        qDebug() << "RecordingThread: H.264编码器使用单线程编码。";
-    }
-    
-    // 设置编码速度预设和调优参数 (H.264特有，通过AVDictionary传递)
-    AVDictionary *codec_opts = nullptr;
-    av_dict_set(&codec_opts, "preset", "ultrafast", 0); // "ultrafast" 提供最快的编码速度，但质量最低
-                                                     // 其他可选值: "superfast", "veryfast", "faster", "fast", "medium" (默认), "slow", "slower", "veryslow", "placebo"
-    av_dict_set(&codec_opts, "tune", "zerolatency", 0);  // "zerolatency" 针对低延迟场景优化，禁用B帧等
-    // av_dict_set(&codec_opts, "crf", "23", 0); // 可选：恒定速率因子 (Constant Rate Factor)，值越小质量越高，范围0-51，默认23
-    // 如果设置了bit_rate，CRF通常会被忽略或表现不同。这里以bit_rate为主。
-
-    // 打开编码器
-    int ret = avcodec_open2(m_codecContext, codec, &codec_opts);
-    av_dict_free(&codec_opts); // 释放AVDictionary
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        QString errorMsg = QString("无法打开H.264编码器: %1").arg(errbuf);
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-        return false;
-    }
+/**
+ * @brief 启用或禁用自动分段。
+ * @param enable true 表示启用。
+ *
+ * 下一次 `startRecording()` 时生效。每一路录制线程独立分段，
+ * 各路同时开始录制且分段时长相同，因此文件时间段基本一致 (切换点各自对齐到本路的关键帧)。
+ */
+void RecordingThread::setAutoSegmentation(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_autoSegmentation = enable;
+}
 
-    // 创建视频流
-    AVStream *stream = avformat_new_stream(m_formatContext, codec);
-    if (!stream) {
-        QString errorMsg = "无法创建新的视频流";
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-        return false;
+/**
+ * @brief 设置自动分段时长。
+ * @param seconds 分段时长 (秒)，小于等于0时忽略。下一次 `startRecording()` 时生效。
+ */
+void RecordingThread::setSegmentDuration(int seconds)
+{
+    if (seconds <= 0) {
+        qWarning() << "无效的自动分段时长:" << seconds;
+        return;
     }
-    stream->id = m_formatContext->nb_streams - 1; // 设置流ID
-    stream->time_base = m_codecContext->time_base; // 设置流的时间基与编码器一致
+    QMutexLocker locker(&m_mutex);
+    m_segmentSeconds = seconds;
+}
 
-    // 将编码器上下文的参数复制到视频流的编解码器参数 (AVCodecParameters) 中
-    ret = avcodec_parameters_from_context(stream->codecpar, m_codecContext);
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        QString errorMsg = QString("无法从编码器上下文复制参数到流: %1").arg(errbuf);
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        // 此处 stream 是 m_formatContext 的一部分，avformat_free_context 会处理它
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-        return false;
-    }
+void RecordingThread::setMaxRecordingMinutes(int minutes)
+{
+    setSegmentDuration(minutes * 60);
+}
 
-    // 某些封装格式需要全局头信息 (例如 MP4 中的 SPS/PPS NAL单元)
-    // 如果 AVFMT_GLOBALHEADER 标志被设置，则编码器需要能够提供这些信息。
-    // FFmpeg的H.264编码器 (libx264) 通常会将SPS/PPS放在 extradata 中，avformat_write_header 会处理。
-    if (m_formatContext->oformat->flags & AVFMT_GLOBALHEADER) {
-        m_codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    }
+void RecordingThread::setContainerFormat(ContainerFormat format)
+{
+    QMutexLocker locker(&m_mutex);
+    m_containerFormat = format;
+}
 
-    // 打开输出文件以供写入
-    if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&m_formatContext->pb, m_filePath.toStdString().c_str(), AVIO_FLAG_WRITE);
-        if (ret < 0) {
-            char errbuf[AV_ERROR_MAX_STRING_SIZE];
-            av_strerror(ret, errbuf, sizeof(errbuf));
-            QString errorMsg = QString("无法打开输出文件 '%1': %2").arg(m_filePath).arg(errbuf);
-            qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-            emit recordError(errorMsg);
-            avcodec_close(m_codecContext);
-            avcodec_free_context(&m_codecContext);
-            avformat_free_context(m_formatContext); // avformat_free_context 会处理 pb (如果已分配)
-            m_formatContext = nullptr;
-            return false;
-        }
-    }
+RecordingThread::ContainerFormat RecordingThread::containerFormat() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_containerFormat;
+}
 
-    // 写入输出文件的头部信息 (例如 MP4的moov box等)
-    ret = avformat_write_header(m_formatContext, nullptr); // 第二个参数是 AVDictionary** options
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        QString errorMsg = QString("写入文件头失败: %1 (文件: %2)").arg(errbuf).arg(m_filePath);
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
-            avio_closep(&m_formatContext->pb); // 关闭已打开的文件IO上下文
-        }
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-        return false;
-    }
+QString RecordingThread::fileSuffix(ContainerFormat format)
+{
+    return format == ContainerMpegTs ? QString("ts") : QString("mp4");
+}
 
-    // 分配 AVFrame 用于存储待编码的YUV图像数据
-    m_frame = av_frame_alloc();
-    if (!m_frame) {
-        QString errorMsg = "无法分配AVFrame";
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) avio_closep(&m_formatContext->pb);
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext); m_formatContext = nullptr;
-        return false;
+/**
+ * @brief 设置流式封装格式的刷新周期。
+ * @param milliseconds 周期 (毫秒)，小于等于0时忽略。下一次 `startRecording()` 时生效。
+ */
+void RecordingThread::setFlushInterval(int milliseconds)
+{
+    if (milliseconds <= 0) {
+        qWarning() << "无效的刷新周期:" << milliseconds;
+        return;
     }
-    m_frame->format = m_codecContext->pix_fmt; // YUV420P
-    m_frame->width = m_width;
-    m_frame->height = m_height;
-    // 为 m_frame 分配图像数据缓冲区
-    ret = av_frame_get_buffer(m_frame, 0); // 第二个参数 align, 0表示默认对齐
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        QString errorMsg = QString("无法为AVFrame分配缓冲区: %1").arg(errbuf);
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        av_frame_free(&m_frame); // m_frame 已分配，需要释放
-        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) avio_closep(&m_formatContext->pb);
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext); m_formatContext = nullptr;
+    QMutexLocker locker(&m_mutex);
+    m_flushIntervalMs = milliseconds;
+}
+
+/**
+ * @brief 待命录制时开始一个事件。
+ * @param filePath 事件文件路径。
+ * @return 未处于待命录制或已有事件进行中时返回 false。
+ *
+ * 只记录请求：文件由录制线程在下一个数据包处打开 (见 `handleEventRequests()`)，
+ * 此时才能确定预录画面的开始时间，并用它修正 `m_segmentStartTime`。
+ */
+bool RecordingThread::beginEvent(const QString &filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_standby || m_state.loadAcquire() != StateRecording || m_eventOpenPending || m_eventFileOpen) {
         return false;
     }
+    m_filePath = filePath;
+    m_segmentStartTime = QDateTime::currentDateTime();
+    m_eventOpenPending = true;
+    m_eventRequests.storeRelease(1);
+    return true;
+}
 
-    // 分配 AVPacket 用于存储编码后的H.264数据
-    m_packet = av_packet_alloc();
-    if (!m_packet) {
-        QString errorMsg = "无法分配AVPacket";
-        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
-        emit recordError(errorMsg);
-        av_frame_free(&m_frame); // 清理 m_frame
-        if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) avio_closep(&m_formatContext->pb);
-        avcodec_close(m_codecContext);
-        avcodec_free_context(&m_codecContext);
-        avformat_free_context(m_formatContext); m_formatContext = nullptr;
+/**
+ * @brief 结束当前事件。
+ * @return 事件文件已打开时返回 true。
+ *
+ * 与 `stopRecording()` 相同，返回后录制线程不会再为这个事件分段，`getFilePath()` 就是最后一段的文件，
+ * 调用者可以立即重命名它 (录制线程仍持有打开的文件描述符，写入文件尾不受影响)。
+ */
+bool RecordingThread::endEvent()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_eventOpenPending) {
+        m_eventOpenPending = false; // 录制线程尚未打开文件：直接取消
         return false;
     }
-
-    // 初始化 SwsContext 用于将输入的RGB帧转换为编码器所需的YUV420P格式
-    m_swsContext = sws_getContext(m_width, m_height, AV_PIX_FMT_RGB24,     // 输入: 宽度, 高度, 像素格式 (RGB888)
-                                  m_width, m_height, AV_PIX_FMT_YUV420P, // 输出: 宽度, 高度, 像素格式 (YUV420P)
-    // 初始化 swscale 上下文，用于 RGB 到 YUV 的转换，使用更快的算法
-    m_swsContext = sws_getContext(m_width, m_height, AV_PIX_FMT_RGB24,
-                                  m_width, m_height, AV_PIX_FMT_YUV420P,
-                                  SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
-    if (!m_swsContext) {
-        emit recordError("无法创建 swscale 上下文");
-        av_packet_free(&m_packet);
-        av_frame_free(&m_frame);
-        avio_closep(&m_formatContext->pb);
-        avformat_free_context(m_formatContext);
+    if (!m_eventFileOpen) {
         return false;
     }
-
+    m_eventFileOpen = false;
+    m_eventClosePending = true;
+    m_eventRequests.storeRelease(1);
     return true;
 }
 
-void RecordingThread::cleanupRecorder()
+bool RecordingThread::isStandby() const
 {
-    // 刷新编码器以处理剩余帧
-    if (m_codecContext && m_formatContext) {
-        encodeFrame(nullptr);
+    QMutexLocker locker(&m_mutex);
+    return m_standby && isRecording();
+}
 
-        // 写入 MP4 文件尾
-        av_write_trailer(m_formatContext);
+bool RecordingThread::isEventActive() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_eventOpenPending || m_eventFileOpen;
+}
 
-        // 关闭输出文件
-        avio_closep(&m_formatContext->pb);
+/**
+ * @brief 设置预录缓冲区大小。
+ * @param seconds 预录时长 (秒)，小于0时按0处理。
+ * @param maxBytes 缓冲区字节数上限，小于等于0时忽略此次设置。
+ */
+void RecordingThread::setPreEventBuffer(int seconds, int maxBytes)
+{
+    if (maxBytes <= 0) {
+        qWarning() << "无效的预录缓冲区大小:" << maxBytes;
+        return;
     }
+    QMutexLocker locker(&m_mutex);
+    m_preEventSeconds = qMax(0, seconds);
+    m_preEventBytes = maxBytes;
+}
 
-    // 释放资源
-    if (m_swsContext) {
-        sws_freeContext(m_swsContext);
-        m_swsContext = nullptr;
-    }
-    
-    if (m_packet) {
-        av_packet_free(&m_packet);
-        m_packet = nullptr;
-    }
-    
-    if (m_frame) {
-        av_frame_free(&m_frame);
-        m_frame = nullptr;
-    }
-    
-    if (m_codecContext) {
-        avcodec_free_context(&m_codecContext);
-        m_codecContext = nullptr;
-    }
-    
-    if (m_formatContext) {
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
+/**
+ * @brief 启用或禁用移动侦测。
+ * @param enable 是否侦测。
+ * @param settings 侦测参数，区域屏蔽的大小与区域数不一致时忽略屏蔽。
+ */
+void RecordingThread::setMotionDetection(bool enable, const MotionDetector::Settings &settings)
+{
+    if (!settings.zoneMask.isEmpty()
+            && settings.zoneMask.size() != MotionDetector::ZONE_COLUMNS * MotionDetector::ZONE_ROWS) {
+        qWarning() << "移动侦测区域屏蔽大小无效:" << settings.zoneMask.size() << "，将使用全部区域";
     }
+    QMutexLocker locker(&m_mutex);
+    m_motionEnabled = enable;
+    m_motionSettings = settings;
 }
 
-bool RecordingThread::processFrame(FrameData *frameData)
+/**
+ * @brief 设置静止时的编码帧率分频。
+ * @param divisor 分频，小于1时忽略此次设置。
+ */
+void RecordingThread::setIdleFrameDivisor(int divisor)
 {
-    if (!m_isRecording || !frameData || !frameData->data || frameData->size <= 0) {
-        return false;
+    if (divisor < 1) {
+        qWarning() << "无效的静止帧率分频:" << divisor;
+        return;
     }
+    QMutexLocker locker(&m_mutex);
+    m_idleFrameDivisor = divisor;
+}
 
-    // 记录当前时间
-    auto now = std::chrono::steady_clock::now();
-    double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastFrameTime).count() / 1000000.0;  // 转换为秒
-    m_lastFrameTime = now;
-
-    // 更新总时间和帧数
-    m_totalTime += elapsed;
-    m_totalFrames++;
-
-    // 计算瞬时帧率，但不每帧都输出日志（仅每30帧输出一次）
-    double currentFPS = 1.0 / elapsed;
-    if (m_totalFrames % 30 == 0) {
-        qDebug() << "当前帧率:" << currentFPS << "FPS";
+/**
+ * @brief 设置录制帧率。
+ * @param fps 每秒最多录制的帧数，0 表示不限，小于0时忽略此次设置。
+ */
+void RecordingThread::setRecordFrameRate(int fps)
+{
+    if (fps < 0) {
+        qWarning() << "无效的录制帧率:" << fps;
+        return;
     }
+    QMutexLocker locker(&m_mutex);
+    m_recordFrameRate = fps;
+}
 
-    // 将 RGB888 转换为 YUV420P
-    const uint8_t *srcSlice[1] = {frameData->data};
-    int srcStride[1] = {3 * m_width};
-    sws_scale(m_swsContext, srcSlice, srcStride, 0, m_height, m_frame->data, m_frame->linesize);
-
-    // 设置帧的 pts（呈现时间戳）
-    m_frame->pts = m_frameCount++;
-
-    // 编码并写入帧
-    if (!encodeFrame(m_frame)) {
-        return false;
+/**
+ * @brief 设置延时录制。
+ * @param enable 是否启用；settings.intervalMs 小于等于0时忽略此次设置。
+ */
+void RecordingThread::setTimeLapse(bool enable, const TimeLapseSettings &settings)
+{
+    if (enable && settings.intervalMs <= 0) {
+        qWarning() << "无效的延时录制采样间隔:" << settings.intervalMs;
+        return;
     }
+    QMutexLocker locker(&m_mutex);
+    m_timeLapseEnabled = enable;
+    m_timeLapseSettings = settings;
+}
 
-    return true;
+void RecordingThread::setAdaptiveRateControl(bool enable, const RateController::Settings &settings)
+{
+    QMutexLocker locker(&m_mutex);
+    m_adaptiveEnabled = enable;
+    m_adaptiveSettings = settings;
 }
 
-bool RecordingThread::encodeFrame(AVFrame *frame)
+void RecordingThread::setSubstream(bool enable, const SubstreamEncoder::Settings &settings)
 {
-    // 发送帧到编码器
-    int ret = avcodec_send_frame(m_codecContext, frame);
+    if (enable && (settings.maxWidth < 16 || settings.frameRate <= 0 || settings.bitRate <= 0)) {
+        qWarning() << "无效的子码流参数:" << settings.maxWidth << settings.frameRate << settings.bitRate;
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_substreamEnabled = enable;
+    m_substreamSettings = settings;
+}
+
+/**
+ * @brief 注册数据包消费者；编码器已打开时立即通知其编码参数。
+ */
+void RecordingThread::addPacketSink(PacketSink *sink)
+{
+    if (m_packetFanout.addSink(sink)) {
+        m_keyFrameRequested.storeRelease(1); // 中途加入的消费者尽快从关键帧开始
+    }
+}
+
+/**
+ * @brief 注销数据包消费者。分发期间持有同一把锁，返回后不会再回调该消费者。
+ */
+void RecordingThread::removePacketSink(PacketSink *sink)
+{
+    m_packetFanout.removeSink(sink);
+}
+
+/**
+ * @brief 请求下一帧编码为 IDR。
+ */
+void RecordingThread::requestKeyFrame()
+{
+    m_keyFrameRequested.storeRelease(1);
+}
+
+/**
+ * @brief 设置 H.264 编码器的候选顺序。
+ * @param names FFmpeg 编码器名称列表，为空时恢复默认顺序。
+ *
+ * 编码器在 `startRecording()` 中 (持有 `m_mutex`) 打开，因此加锁后修改，下一次录制生效。
+ */
+void RecordingThread::setEncoderPreference(const QStringList &names)
+{
+    QMutexLocker locker(&m_mutex);
+    m_encoder.setPreference(names);
+}
+
+void RecordingThread::setSoftwareEncoderOptions(const QString &preset, int threads)
+{
+    QMutexLocker locker(&m_mutex);
+    m_encoderPreset = preset;
+    m_encoderThreads = qMax(0, threads);
+    m_adaptiveThreads = 0; // 线程数由调用者重新指定，之前的自动调整作废
+}
+
+QString RecordingThread::encoderName() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_encoderName; // 编码器可能正在录制线程中关闭，返回打开时记录的名称
+}
+
+int RecordingThread::encoderThreads() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_encoderThreadCount;
+}
+
+/**
+ * @brief 将一帧原始图像数据复制到空闲帧槽并放入待编码队列。
+ * @param frameData 指向包含原始图像数据的缓冲区的指针。
+ * @param size 图像数据的总字节大小。
+ * @param stride 每行字节数，为0时按 size / height 推算。
+ * @return 如果成功将帧数据添加到队列，则返回 true；否则 (未在录制、数据无效、帧被丢弃) 返回 false。
+ * 
+ * 此函数在采集线程中调用 (见 `consumeFrame()`)，是帧队列唯一的生产者，全程不加锁。
+ * 
+ * 执行逻辑：
+ * 1. 检查当前是否正在录制，以及传入的帧数据和大小是否有效。如果无效，则直接返回 false。
+ * 2. 设置了录制帧率时按采集时间戳抽帧，未到下一个录制时刻的帧直接返回 false。
+ * 3. 从 `m_freeFrames` 取一个空闲帧槽。队列已满时按 `m_overflowPolicy` 处理：
+ *    - DropOldest：从 `m_frameRing` 窃取最旧的一帧作为新帧槽；
+ *    - DropNewest：直接丢弃新帧；
+ *    - BlockCapture：在 `m_slotWaker` 上停放等待编码线程归还帧槽，最多 BLOCK_TIMEOUT_MS 毫秒，超时后丢弃新帧。
+ *    丢弃的帧计入 `m_droppedFrames`。
+ * 4. 原始格式输入直接转换进帧槽的 YUV420P 图像帧 (`convertIntoFrame()`，720p 及以上分条带并行)，
+ *    MJPEG 输入把压缩数据复制进帧槽；然后追加到 `m_frameRing` 末尾，并更新高水位。
+ * 5. 编码线程已停放时通过 eventfd 唤醒它；没有停放时不做任何系统调用。
+ */
+bool RecordingThread::addFrameToQueue(const unsigned char *frameData, int size, int stride, long long timestampUs)
+{
+    if (!frameData || size <= 0) {
+        return false;
+    }
+
+    // 先声明进入，再检查状态 (全屏障，防止写标志和读状态重排)：
+    // ensureFramePool() 在空闲状态下等本标志清零后才重建队列
+    m_producerBusy.fetchAndStoreOrdered(1);
+    if (!isRecording()) {
+        m_producerBusy.storeRelease(0);
+        return false;
+    }
+    if (stride <= 0 && m_height > 0) {
+        stride = size / m_height; // 单平面打包格式：兼容驱动的行尾填充
+    }
+    // 采集线程转换时直接读取这块数据，先确认它足够一整帧 (NV12 为 Y 平面 + 半高的 UV 平面)
+    if (m_sessionProducerConvert) {
+        const int frameBytes = (m_inputFormat == AV_PIX_FMT_NV12) ? stride * m_height + stride * ((m_height + 1) / 2)
+                                                                  : stride * m_height;
+        if (size < frameBytes) {
+            qWarning() << "原始帧数据不完整，跳过:" << size << "<" << frameBytes;
+            m_producerBusy.storeRelease(0);
+            return false;
+        }
+    }
+    const bool captureTimestamp = (timestampUs >= 0);
+    if (timestampUs < 0) {
+        // 调用者没有采集时间戳：用入队时刻 (steady_clock 在 Linux 上即 CLOCK_MONOTONIC)
+        timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 延时录制：没有移动 (或不需要切换) 时按采样期间的送帧间隔抽帧；
+    // 移动状态由录制线程的侦测结果决定，切换时两种间隔都从本帧重新计时
+    FrameRole role = FrameNormal;
+    long long intervalUs = m_sessionFrameIntervalUs;
+    if (m_sessionLapseIntervalUs > 0) {
+        const bool fullRate = m_sessionLapseMotionSwitch && m_motionActive.loadAcquire() != 0;
+        if (fullRate != m_producerFullRate) {
+            m_producerFullRate = fullRate;
+            m_nextFrameUs = -1;
+            m_nextSampleUs = -1;
+        }
+        if (!fullRate) {
+            intervalUs = m_sessionLapseProbeUs;
+            role = FrameMotionProbe;
+        }
+    }
+
+    // 按录制帧率 (或延时录制的送帧间隔) 抽帧：早于下一个录制时刻的帧直接跳过，不占用帧槽。
+    // 允许提前四分之一个间隔，采集时间戳的抖动不会让本应录制的帧被跳过。
+    if (intervalUs > 0 && !frameDue(timestampUs, intervalUs, intervalUs / 4, &m_nextFrameUs)) {
+        m_producerBusy.storeRelease(0);
+        return false;
+    }
+    // 送入的帧中到了采样时刻的才编码，其余只做移动侦测 (不需要侦测帧时每一帧都是采样帧)
+    if (role == FrameMotionProbe
+            && (m_sessionLapseProbeUs == m_sessionLapseIntervalUs
+                || frameDue(timestampUs, m_sessionLapseIntervalUs, m_sessionLapseProbeUs / 2, &m_nextSampleUs))) {
+        role = FrameLapseSample;
+    }
+
+    FrameData *slot = nullptr;
+    if (!takeFreeFrame(slot)) {
+        switch (m_overflowPolicy.loadAcquire()) {
+        case DropOldest:
+            // 回收最旧的待编码帧 (编码线程可能同时取走它，此时再取一次空闲帧槽)
+            if (m_frameRing.tryStealOldest(slot) || takeFreeFrame(slot)) {
+                m_droppedFrames.fetchAndAddRelaxed(1);
+                m_metrics.addDropped();
+            }
+            break;
+        case BlockCapture:
+            // 停放等待编码线程归还帧槽；停止录制时 stopRecording() 会唤醒这里
+            while (isRecording()) {
+                m_slotWaker.prepareWait();
+                if (takeFreeFrame(slot)) {
+                    m_slotWaker.cancelWait();
+                    break;
+                }
+                if (!m_slotWaker.wait(BLOCK_TIMEOUT_MS)) {
+                    takeFreeFrame(slot); // 超时，最后再试一次
+                    break;
+                }
+            }
+            break;
+        default: // DropNewest
+            break;
+        }
+        if (!slot) {
+            m_droppedFrames.fetchAndAddRelaxed(1);
+            m_metrics.addDropped();
+            m_producerBusy.storeRelease(0);
+            return false; // 丢弃新帧
+        }
+    }
+
+    // 转换 (或复制) 到帧槽并追加到队列末尾 (只有队列有空位或刚窃取一帧时才拿到帧槽，入队一定成功)。
+    // 帧槽只能经由编码线程归还空闲队列，转换失败的帧槽标记为无效后照常入队，由编码线程丢弃
+    if (m_sessionProducerConvert) {
+        const qint64 convertStartUs = PipelineMetrics::nowUs();
+        slot->converted = convertIntoFrame(slot, frameData, stride);
+        slot->size = slot->converted ? size : 0;
+        slot->stride = stride;
+        slot->timestampUs = timestampUs;
+        slot->enqueueUs = PipelineMetrics::nowUs();
+        if (slot->converted) {
+            m_metrics.recordLatency(PipelineMetrics::StageConvert, slot->enqueueUs - convertStartUs);
+        }
+    } else {
+        slot->assign(frameData, size, stride, timestampUs);
+        slot->enqueueUs = PipelineMetrics::nowUs();
+    }
+    slot->role = role;
+    m_frameRing.tryPush(slot);
+    const int depth = static_cast<int>(m_frameRing.size());
+    if (depth > m_queueHighWater.load()) {
+        m_queueHighWater.store(depth);
+    }
+    // 采集阶段：驱动 DQBUF 时间戳到入队 (没有采集时间戳时无意义)
+    if (captureTimestamp) {
+        m_metrics.recordLatency(PipelineMetrics::StageCapture, slot->enqueueUs - timestampUs);
+    }
+    m_metrics.addQueued();
+    m_metrics.setQueueDepth(depth);
+    m_producerBusy.storeRelease(0);
+
+    // 只在编码线程停放时唤醒它
+    m_frameWaker.notify();
+    
+    return true;
+}
+
+bool RecordingThread::takeFreeFrame(FrameData *&slot)
+{
+    // 队列长度只有本线程会增加，这里看到有空位，入队时一定仍有空位
+    return m_frameRing.size() < m_frameRing.capacity() && m_freeFrames.tryPop(slot);
+}
+
+void RecordingThread::releaseFrame(FrameData *frameData)
+{
+    m_freeFrames.tryPush(frameData); // 容量等于帧槽总数，不会失败
+    m_slotWaker.notify();            // 只有 BlockCapture 下采集线程已停放时才写 eventfd
+}
+
+void RecordingThread::sliceRows(int slice, int *firstRow, int *rows) const
+{
+    // 每条行数取偶数，色度平面 (半高) 的条带边界与亮度平面对齐；最后一条取剩余的行
+    const int rowsPerSlice = ((m_height / m_convertSlices) + 1) & ~1;
+    *firstRow = slice * rowsPerSlice;
+    *rows = qMax(0, qMin(rowsPerSlice, m_height - *firstRow));
+}
+
+bool RecordingThread::convertIntoFrame(FrameData *slot, const unsigned char *src, int stride)
+{
+    AVFrame *frame = slot->frame;
+    // 编码器可能仍引用这个帧槽上一次的缓冲区，写入前确保可写 (必要时重新分配)
+    if (av_frame_make_writable(frame) < 0) {
+        qWarning() << "无法获取可写的视频帧缓冲区，跳过该帧";
+        return false;
+    }
+
+    // 行跨度由驱动给出，兼容每行末尾的填充字节。各条带只写入自己的行，可以同时执行
+    const auto convertSlice = [this, frame, src, stride](int slice) {
+        int y0, rows;
+        sliceRows(slice, &y0, &rows);
+        if (rows <= 0) {
+            return;
+        }
+        const unsigned char *s = src + (size_t)y0 * stride;
+        uint8_t *dst[3] = {frame->data[0] + (size_t)y0 * frame->linesize[0],
+                           frame->data[1] + (size_t)(y0 / 2) * frame->linesize[1],
+                           frame->data[2] + (size_t)(y0 / 2) * frame->linesize[2]};
+        if (m_inputFormat == AV_PIX_FMT_RGB565LE) {
+            // 融合内核: 一次读取源数据，直接写出 Y/U/V 三个平面
+            pixconv_rgb565_to_i420(s, stride, m_width, rows, dst[0], frame->linesize[0],
+                                   dst[1], frame->linesize[1], dst[2], frame->linesize[2]);
+        } else if (m_inputFormat == AV_PIX_FMT_YUYV422) {
+            // 只做解交织和色度垂直平均，没有色彩空间转换
+            pixconv_yuyv_to_i420(s, stride, m_width, rows, dst[0], frame->linesize[0],
+                                 dst[1], frame->linesize[1], dst[2], frame->linesize[2]);
+        } else if (m_inputFormat == AV_PIX_FMT_NV12) {
+            // Y 平面复制，UV 平面 (紧跟在 Y 平面之后) 拆分
+            const unsigned char *uv = src + (size_t)stride * m_height + (size_t)(y0 / 2) * stride;
+            pixconv_nv12_to_i420(s, stride, uv, stride, m_width, rows, dst[0], frame->linesize[0],
+                                 dst[1], frame->linesize[1], dst[2], frame->linesize[2]);
+        } else {
+            // 每个条带有自己的 swscale 上下文 (高度为条带行数)，上下文不能在线程间共用
+            const uint8_t *srcSlice[1] = {s};
+            int srcStrides[1] = {stride};
+            sws_scale(m_swsSlices[slice], srcSlice, srcStrides, 0, rows, dst, frame->linesize);
+        }
+    };
+    SlicePool::instance()->run(m_convertSlices, convertSlice);
+    return true;
+}
+
+/**
+ * @brief 准备本次录制使用的帧槽和队列。
+ * @param frameBytes 每个帧槽的压缩数据缓冲区字节数 (原始格式输入为0)。
+ * @param width 图像宽度。
+ * @param height 图像高度。
+ * @return 图像帧分配失败时返回 false。
+ *
+ * 在 `startRecording()` 中、录制状态为空闲时调用：编码线程已编码完上一段的全部帧并归还帧槽，
+ * 采集线程看到空闲状态后不会再访问队列，因此只需等它离开 `addFrameToQueue()`。
+ */
+bool RecordingThread::ensureFramePool(int frameBytes, int width, int height)
+{
+    while (m_producerBusy.loadAcquire()) {
+        QThread::usleep(100); // 采集线程正在复制最后一帧，马上就会退出
+    }
+
+    int capacity;
+    {
+        QMutexLocker locker(&m_mutex);
+        capacity = m_requestedCapacity;
+    }
+
+    // 队列容量 + 1 个帧槽：编码线程处理一帧的同时，队列仍可排满
+    m_queueCapacity = capacity;
+    while (m_framePool.size() < m_queueCapacity + 1) {
+        m_framePool.append(new FrameData(frameBytes));
+    }
+    // 分辨率变大时帧槽重新分配，避免录制过程中逐个扩容；
+    // 图像帧按本次分辨率分配 (所有编码器后端的输入都是软件 YUV420P，VAAPI 在送入时上传)
+    for (FrameData *slot : m_framePool) {
+        if (slot->capacity < frameBytes) {
+            delete[] slot->data;
+            slot->data = new unsigned char[frameBytes];
+            slot->capacity = frameBytes;
+        }
+        if (slot->frame && (slot->frame->width != width || slot->frame->height != height)) {
+            av_frame_free(&slot->frame);
+        }
+        if (!slot->frame) {
+            slot->frame = av_frame_alloc();
+            if (!slot->frame) {
+                return false;
+            }
+            slot->frame->format = AV_PIX_FMT_YUV420P;
+            slot->frame->width = width;
+            slot->frame->height = height;
+            const int ret = av_frame_get_buffer(slot->frame, 0); // 第二个参数 align, 0表示默认对齐
+            if (ret < 0) {
+                char errbuf[AV_ERROR_MAX_STRING_SIZE];
+                av_strerror(ret, errbuf, sizeof(errbuf));
+                qWarning() << "无法为AVFrame分配缓冲区:" << errbuf;
+                av_frame_free(&slot->frame);
+                return false;
+            }
+        }
+    }
+
+    // 重建两个队列：所有帧槽都放回空闲队列
+    m_frameRing.reset(static_cast<unsigned>(m_queueCapacity));
+    m_freeFrames.reset(static_cast<unsigned>(m_framePool.size()));
+    for (FrameData *slot : m_framePool) {
+        m_freeFrames.tryPush(slot);
+    }
+
+    m_droppedFrames.store(0);
+    m_queueHighWater.store(0);
+    m_metrics.setQueueCapacity(m_queueCapacity);
+    qDebug() << "RecordingThread: 帧队列容量" << m_queueCapacity << "帧，单帧预分配" << frameBytes << "字节 +"
+             << width << "x" << height << "YUV420P";
+    return true;
+}
+
+/**
+ * @brief 设置帧队列容量 (帧)。
+ * @param frames 容量，小于1时忽略。下一次 `startRecording()` 时生效。
+ */
+void RecordingThread::setQueueCapacity(int frames)
+{
+    if (frames < 1) {
+        qWarning() << "无效的帧队列容量:" << frames;
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_requestedCapacity = frames;
+}
+
+void RecordingThread::setOverflowPolicy(OverflowPolicy policy)
+{
+    m_overflowPolicy.storeRelease(policy);
+}
+
+int RecordingThread::droppedFrames() const
+{
+    return m_droppedFrames.load();
+}
+
+int RecordingThread::queueHighWaterMark() const
+{
+    return m_queueHighWater.load();
+}
+
+void RecordingThread::consumeFrame(const v4l2_frame &frame)
+{
+    // 在采集线程中执行：原始格式在这里转换入队 (MJPEG 只复制)，编码在本线程中异步完成
+    if (!isRecording() || !frame.data) {
+        return;
+    }
+    const unsigned char *data = static_cast<const unsigned char *>(frame.data);
+    const int stride = static_cast<int>(frame.bytesperline);
+    switch (frame.pixelformat) {
+    case V4L2_PIX_FMT_MJPEG:
+        // 压缩数据，长度以驱动给出的有效字节数为准
+        addFrameToQueue(data, static_cast<int>(frame.bytesused), 0, frame.timestamp_us);
+        break;
+    case V4L2_PIX_FMT_NV12:
+        // Y 平面 + 半高的 UV 平面，两者行跨度相同
+        addFrameToQueue(data, stride * frame.height + stride * ((frame.height + 1) / 2), stride, frame.timestamp_us);
+        break;
+    default:
+        addFrameToQueue(data, stride * frame.height, stride, frame.timestamp_us);
+        break;
+    }
+}
+
+/**
+ * @brief 录制线程的主执行函数 (QThread::run() 的重写)。
+ * 
+ * 此函数是录制线程的入口点，是帧队列唯一的消费者，按录制状态循环处理：
+ * 1. 空闲：不访问任何队列 (`startRecording()` 此时会重建队列)，在 `m_frameWaker` 上停放直到开始录制；
+ *    如果 `m_shouldExit` 已被设置，则退出循环。
+ * 2. 录制中 / 停止中：从无锁队列 `m_frameRing` 中取出待处理的帧槽 (`FrameData`)，
+ *    调用 `processFrame()` 编码该帧，再调用 `releaseFrame()` 把帧槽归还 `m_freeFrames` (不释放内存)。
+ *    停止中时队列里剩余的帧仍属于当前录像文件，同样编码。
+ * 3. 队列为空时：
+ *    - 停止中：调用 `finishSession()` 写入文件尾、清理FFmpeg资源并输出统计，状态回到空闲。
+ *    - 录制中：在 `m_frameWaker` 上停放。停放前先声明、再复查一次队列和状态，
+ *      因此采集线程只有在本线程真正停放时才需要写 eventfd，不会丢失唤醒。
+ * 4. 循环结束后调用 `cleanupRecorder()` 确保所有资源被释放。析构函数先停止录制再设置 `m_shouldExit`，
+ *    因此退出前总会先编码完剩余的帧并写入文件尾。
+ */
+void RecordingThread::run()
+{
+    m_metrics.setEncoderThread(); // 计量读取本线程的 CPU 时间
+    for (;;) {
+        const int state = m_state.loadAcquire();
+        if (state == StateIdle) {
+            if (m_shouldExit.loadAcquire()) {
+                break;
+            }
+            m_frameWaker.prepareWait();
+            if (m_state.loadAcquire() != StateIdle || m_shouldExit.loadAcquire()) {
+                m_frameWaker.cancelWait();
+                continue;
+            }
+            m_frameWaker.wait(-1);
+            continue;
+        }
+
+        FrameData *frameData = nullptr;
+        if (m_frameRing.tryPop(frameData)) {
+            processFrame(frameData);
+            releaseFrame(frameData);
+            continue;
+        }
+
+        // 队列已取空：停止中则结束当前录制段
+        if (state == StateStopping) {
+            finishSession();
+            continue;
+        }
+
+        // 停放，直到新帧到达或录制状态变化
+        m_frameWaker.prepareWait();
+        if (!m_frameRing.isEmpty() || m_state.loadAcquire() != StateRecording) {
+            m_frameWaker.cancelWait();
+            continue;
+        }
+        m_frameWaker.wait(-1);
+    }
+    
+    // 线程退出前清理资源
+    cleanupRecorder();
+    m_metrics.clearEncoderThread();
+}
+
+void RecordingThread::finishSession()
+{
+    // 采集线程可能还在转换最后一帧 (看到停止状态前已进入 addFrameToQueue())，
+    // 它仍在使用条带的 swscale 上下文，等它离开后再释放
+    while (m_producerBusy.loadAcquire()) {
+        QThread::usleep(100);
+    }
+    cleanupRecorder();
+
+    // 计算并输出平均帧率和队列统计
+    if (m_totalFrames > 0) {
+        double averageFPS = m_totalFrames / m_totalTime;
+        qDebug() << "平均帧率:" << averageFPS << "FPS"
+                 << "丢帧:" << m_droppedFrames.load()
+                 << "队列高水位:" << m_queueHighWater.load() << "/" << m_queueCapacity;
+        m_totalFrames = 0;
+    }
+    m_metrics.setQueueDepth(0); // 队列已取空，采集线程此时不再入队
+
+    // 本次会话软件编码器算力不足：下一次打开编码器时多用一个线程 (编码器打开后线程数不能修改)
+    if (m_sessionAdaptive && m_rateController.wasLoadLimited() && m_sessionEncoderThreads > 0
+            && m_sessionEncoderThreads < QThread::idealThreadCount()) {
+        QMutexLocker locker(&m_mutex);
+        m_adaptiveThreads = m_sessionEncoderThreads + 1;
+        qDebug() << "自适应控制: 编码负载过高，下一次录制使用" << m_adaptiveThreads << "个编码线程";
+    }
+
+    // 之后 startRecording() 才能重建队列、初始化新的编码器；在 m_mutex 下切换，与 startSession() 记下请求互斥
+    {
+        QMutexLocker locker(&m_mutex);
+        m_state.testAndSetOrdered(StateStopping, StateIdle);
+    }
+    emit sessionIdle(); // 收尾期间请求了新会话时由本对象所在的线程开始它
+}
+
+/**
+ * @brief 初始化FFmpeg录制器相关的组件。
+ * @return 如果所有组件成功初始化，则返回 true；否则返回 false。
+ *
+ * 此函数负责为一次新的录制会话（或一个新的分段）设置FFmpeg。
+ * 主要步骤：
+ * 1. 使用 `av_guess_format()` 按本次录制的封装格式 (`m_sessionContainer`) 查找输出格式。
+ * 2. 通过 `EncoderBackend::open()` 按候选顺序打开H.264编码器 (`m_codecContext` 由 `m_encoder` 拥有)：
+ *    - 硬件编码器优先 (h264_v4l2m2m、h264_vaapi、厂商编码器)，都不可用时退回 libx264。
+ *    - 设置视频宽度、高度、时间基、帧率、比特率；输出格式要求 `AVFMT_GLOBALHEADER` 时在打开前请求全局头。
+ *    - 软件编码时线程数默认跟随CPU核数、预设默认为 "ultrafast" (`setSoftwareEncoderOptions()`)，调优为 "zerolatency"。
+ *    - 流式封装格式 (分片 MP4 / MPEG-TS) 把关键帧间隔设为一个刷新周期，保证每个分片都从关键帧开始。
+ * 3. 调用 `openMuxer()`：分配封装格式上下文 (`m_formatContext`)，创建视频流并复制编码器参数，
+ *    打开输出文件并写入文件头。自动分段时只重复这一步 (见 `rotateSegment()`)。
+ * 4. 分配 `AVPacket` (`m_packet`) 用于存储编码后的H.264数据 (YUV420P 图像帧在帧槽中，由 `ensureFramePool()` 分配)。
+ * 5. 输入为RGB565 / YUYV / NV12时由采集线程用 pixel_convert 内核直接转换，不创建SwsContext；
+ *    输入为MJPEG时打开JPEG解码器，SwsContext (`m_swsContext`) 在解码出第一帧后按实际输出格式创建；
+ *    其它输入格式 (如RGB888) 为每个转换条带初始化一个SwsContext (`m_swsSlices`)，由采集线程转换为YUV420P格式。
+ *
+ * 如果任何步骤失败，会通过 `recordError` 信号发送错误信息，并返回 false。
+ */
+bool RecordingThread::initRecorder()
+{
+    // 打开编码器前需要知道封装格式是否要求全局头 (MP4 要求，MPEG-TS 把 SPS/PPS 放在码流中)
+    const AVOutputFormat *oformat = av_guess_format(m_sessionContainer == ContainerMpegTs ? "mpegts" : "mp4",
+                                                    nullptr, nullptr);
+    if (!oformat) {
+        emit recordError("无法创建输出上下文");
+        return false;
+    }
+
+    // 按候选顺序打开 H.264 编码器：硬件编码器 (V4L2 M2M / VAAPI / 厂商) 优先，libx264 兜底
+    EncoderBackend::Settings settings;
+    settings.width = m_width;
+    settings.height = m_height;
+    // 显示时间戳来自采集时间戳 (可变帧率)，时间基取 1/90000 秒；标称帧率只供码率控制参考
+    settings.timeBase = {1, PTS_CLOCK_RATE};
+    settings.frameRate = {m_frameRate, 1};
+    settings.bitRate = 800000; // 目标比特率 (800 kbps)，影响视频质量和文件大小
+    // 某些封装格式需要全局头信息 (例如 MP4 中的 SPS/PPS NAL单元)，必须在打开编码器前告知编码器
+    settings.globalHeader = (oformat->flags & AVFMT_GLOBALHEADER) != 0;
+    settings.preset = m_encoderPreset;   // 软件编码器的预设和线程数 (默认 ultrafast、跟随CPU核数)
+    // 指定了线程数、且上一次自适应会话算力不足时多用线程 (0 已经是全部核心)
+    settings.threads = m_encoderThreads > 0 ? qMax(m_encoderThreads, m_adaptiveThreads) : 0;
+    // 流式封装：每个刷新周期一个关键帧，断电后文件最多在最后一个不完整的 GOP 处截断
+    if (m_flushIntervalPts > 0) {
+        settings.gopSize = qMax(1, (int)(m_frameRate * m_flushIntervalPts / PTS_CLOCK_RATE));
+    }
+    // 自适应控制：关键帧改由 processFrame() 按时间强制 (普通 MP4 也按默认刷新周期)，
+    // 编码器自己的间隔放宽到低运动模式的上限
+    m_sessionGopPts = 0;
+    if (m_sessionAdaptive) {
+        m_sessionGopPts = m_flushIntervalPts > 0 ? m_flushIntervalPts
+                                                 : (int64_t)DEFAULT_FLUSH_INTERVAL_MS * PTS_CLOCK_RATE / 1000;
+        settings.gopSize = qMax(1, (int)(m_frameRate * m_sessionGopPts / PTS_CLOCK_RATE))
+                * qMax(1, m_adaptiveSettings.lowMotionGopFactor);
+    }
+    QString encoderError;
+    if (!m_encoder.open(settings, &encoderError)) {
+        qWarning() << "RecordingThread::initRecorder: " << encoderError;
+        emit recordError(encoderError);
+        return false;
+    }
+    m_codecContext = m_encoder.context();
+    // 编码器按指定的线程数打开时 (libx264 也按 thread_count 创建线程) 自适应控制才能在下一次打开时增加它；
+    // 线程数跟随核数、硬件编码器或不支持多线程的编码器为0
+    m_sessionEncoderThreads = (settings.threads > 0 && m_encoder.threadCount() == settings.threads) ? settings.threads : 0;
+    if (m_sessionAdaptive) {
+        m_rateController.configure(m_adaptiveSettings, settings.bitRate, 1000000LL / m_frameRate);
+    }
+    // 创建封装器：视频流、输出文件和文件头 (自动分段时对每个新文件重复这一步，编码器不变)。
+    // 待命录制时在事件开始后才打开文件
+    QString muxerError;
+    if (!m_standby && !openMuxer(m_filePath, &muxerError)) {
+        qWarning() << "RecordingThread::initRecorder: " << muxerError;
+        emit recordError(muxerError);
+        m_encoder.close();
+        m_codecContext = nullptr;
+        return false;
+    }
+
+    // 分配 AVPacket 用于存储编码后的H.264数据
+    m_packet = av_packet_alloc();
+    if (!m_packet) {
+        QString errorMsg = "无法分配AVPacket";
+        qWarning() << "RecordingThread::initRecorder: " << errorMsg;
+        emit recordError(errorMsg);
+        closeMuxer(false);
+        m_encoder.close();
+        m_codecContext = nullptr;
+        return false;
+    }
+
+    // MJPEG 输入：打开 JPEG 解码器，解码结果再经 swscale 转换 (解码器输出格式要等第一帧才知道)
+    if (m_inputCodec == AV_CODEC_ID_MJPEG) {
+        const AVCodec *decoder = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+        m_decoderContext = decoder ? avcodec_alloc_context3(decoder) : nullptr;
+        if (m_decoderContext) {
+            m_decoderContext->thread_count = 1; // 帧内编码，单线程无额外延迟；编码器已占用多个核
+        }
+        if (!m_decoderContext || avcodec_open2(m_decoderContext, decoder, nullptr) < 0) {
+            emit recordError("无法打开 MJPEG 解码器");
+            cleanupRecorder(); // 此时尚未写入任何帧，写入文件尾后释放所有资源
+            return false;
+        }
+        m_decodedFrame = av_frame_alloc();
+        m_decodePacket = av_packet_alloc();
+        if (!m_decodedFrame || !m_decodePacket) {
+            emit recordError("无法分配 MJPEG 解码缓冲区");
+            cleanupRecorder();
+            return false;
+        }
+        qDebug() << "MJPEG 输入: 解码后转换为 YUV420P";
+        return true;
+    }
+
+    // RGB565 / YUYV / NV12 输入由采集线程用 pixel_convert 内核直接转换为 YUV420P，不需要 swscale
+    if (m_inputFormat == AV_PIX_FMT_RGB565LE || m_inputFormat == AV_PIX_FMT_YUYV422
+            || m_inputFormat == AV_PIX_FMT_NV12) {
+        qDebug() << av_get_pix_fmt_name(m_inputFormat) << "-> YUV420P 使用 pixel_convert 内核:" << pixconv_backend_name()
+                 << "条带数:" << m_convertSlices;
+        return true;
+    }
+
+    // 其它输入格式 (如RGB888) 仍使用 swscale 转换为编码器所需的YUV420P格式，使用更快的算法。
+    // 每个条带一个上下文，尺寸为整行宽度 x 条带行数 (不缩放，条带之间互不依赖)
+    for (int slice = 0; slice < m_convertSlices; ++slice) {
+        int firstRow, rows;
+        sliceRows(slice, &firstRow, &rows);
+        SwsContext *context = nullptr;
+        if (rows > 0) {
+            context = sws_getContext(m_width, rows, m_inputFormat,        // 输入: 宽度, 条带高度, 像素格式
+                                     m_width, rows, AV_PIX_FMT_YUV420P,  // 输出: 宽度, 条带高度, 像素格式 (YUV420P)
+                                     SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+            if (!context) {
+                emit recordError("无法创建 swscale 上下文");
+                cleanupRecorder();
+                return false;
+            }
+        }
+        m_swsSlices.append(context);
+    }
+
+    return true;
+}
+
+bool RecordingThread::openMuxer(const QString &filePath, QString *errorMsg)
+{
+    const char *formatName = (m_sessionContainer == ContainerMpegTs) ? "mpegts" : "mp4";
+    int ret = avformat_alloc_output_context2(&m_formatContext, nullptr, formatName, filePath.toStdString().c_str());
+    if (!m_formatContext) {
+        *errorMsg = "无法创建输出上下文";
+        return false;
+    }
+
+    // 创建视频流
+    AVStream *stream = avformat_new_stream(m_formatContext, m_encoder.codec());
+    if (!stream) {
+        *errorMsg = "无法创建新的视频流";
+        closeMuxer(false);
+        return false;
+    }
+    stream->id = m_formatContext->nb_streams - 1; // 设置流ID
+    stream->time_base = m_codecContext->time_base; // 设置流的时间基与编码器一致
+
+    // 将编码器上下文的参数 (包括 SPS/PPS extradata) 复制到视频流的编解码器参数 (AVCodecParameters) 中
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    ret = avcodec_parameters_from_context(stream->codecpar, m_codecContext);
+    if (ret < 0) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        *errorMsg = QString("无法从编码器上下文复制参数到流: %1").arg(errbuf);
+        closeMuxer(false); // stream 是 m_formatContext 的一部分，一并释放
+        return false;
+    }
+
+    // 打开输出文件以供写入：数据经 m_fileWriter 的后写缓冲区由I/O线程写入，编码不等待TF卡。
+    // 按码率和分段时长预分配文件空间 (多预留1/8，关闭时截断到实际大小)
+    if (!(m_formatContext->oformat->flags & AVFMT_NOFILE)) {
+        const qint64 expectedBytes = m_segmentLengthPts > 0
+                ? m_codecContext->bit_rate / 8 * m_segmentLengthPts / PTS_CLOCK_RATE * 9 / 8
+                : 0;
+        m_formatContext->pb = m_fileWriter.openFile(filePath, expectedBytes, errorMsg);
+        if (!m_formatContext->pb) {
+            closeMuxer(false);
+            return false;
+        }
+        m_formatContext->flags |= AVFMT_FLAG_CUSTOM_IO; // AVIO 上下文由 m_fileWriter 拥有和释放
+    }
+
+    AVDictionary *muxerOpts = nullptr;
+    if (m_sessionContainer == ContainerFragmentedMp4) {
+        // 文件头写入空的 moov，之后每个关键帧开始一个自带索引的 moof+mdat 分片；
+        // frag_duration 兜底：编码器不遵守关键帧间隔 (部分硬件编码器) 时也按两个周期切分片
+        av_dict_set(&muxerOpts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+        av_dict_set_int(&muxerOpts, "frag_duration", m_flushIntervalPts * 2 * 1000000 / PTS_CLOCK_RATE, 0);
+    }
+
+    // 写入输出文件的头部信息 (例如 MP4的ftyp box等)
+    ret = avformat_write_header(m_formatContext, &muxerOpts);
+    av_dict_free(&muxerOpts);
+    if (ret < 0) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        *errorMsg = QString("写入文件头失败: %1 (文件: %2)").arg(errbuf).arg(filePath);
+        closeMuxer(false);
+        return false;
+    }
+
+    m_muxerPath = filePath;
+    m_fileKeyFrames = 0;
+    m_fileIndex.clear();
+    m_fileMotion = m_motionDetector.isMotion();
+    m_reportedBytes = 0;
+    emit fileOpened(filePath);
+    return true;
+}
+
+void RecordingThread::flushOutput(int64_t pts)
+{
+    m_lastFlushPts = pts;
+    // 封装器已输出的分片 / TS 包交给I/O线程写入并 fdatasync，录制线程不等待
+    m_fileWriter.requestSync();
+}
+
+void RecordingThread::closeMuxer(bool writeTrailer)
+{
+    if (!m_formatContext) {
+        return;
+    }
+    if (writeTrailer) {
+        av_write_trailer(m_formatContext); // 写入文件尾 (普通 MP4 的 moov；分片 MP4 的最后一个分片)
+    }
+    reportWrittenBytes(); // 文件尾 (以及尚未报告的最后一个 GOP)
+    qint64 fileBytes = m_reportedBytes; // 出错关闭：文件不完整，大小取已写出的位置
+    if (m_fileWriter.isFileOpen()) {
+        // 关闭输出文件：只是排队，I/O线程写完剩余数据后同步 (分段或停止时最后一部分数据也落盘) 并关闭
+        const qint64 closedBytes = m_fileWriter.closeFile(writeTrailer);
+        if (writeTrailer) {
+            fileBytes = closedBytes;
+        }
+        m_formatContext->pb = nullptr;
+    }
+    avformat_free_context(m_formatContext);
+    m_formatContext = nullptr;
+    // 关键帧索引按打开时的路径保存 (几十 KB，写入页缓存)，CameraChannel 在文件重命名后跟着重命名
+    if (!m_fileIndex.isEmpty()) {
+        m_fileIndex.save(KeyFrameIndex::indexPath(m_muxerPath));
+        m_fileIndex.clear();
+    }
+    emit fileClosed(m_muxerPath, fileBytes, m_fileKeyFrames, m_fileMotion);
+}
+
+/**
+ * @brief 自动分段：在关键帧处切换到新文件。
+ *
+ * 由 `encodeFrame()` 在分段待切换、且收到不早于强制 IDR 帧的关键帧包时调用，此时该包尚未写入。
+ * 1. 在 `m_mutex` 下确认仍在录制 (待命录制时事件仍在进行)，生成新文件路径并更新 `m_filePath` / `m_segmentStartTime`
+ *    (与 `stopRecording()` / `endEvent()` 互斥，停止中时不切换)。
+ * 2. 仍在锁内写入旧文件的文件尾并关闭，按新路径打开封装器；编码器、帧和转换器保持不变。
+ * 3. 以该关键帧包的时间戳作为新文件的时间零点，发出 `segmentFinished()` 通知接收者处理旧文件。
+ */
+bool RecordingThread::rotateSegment()
+{
+    m_rotatePending = false;
+
+    const QDateTime now = QDateTime::currentDateTime();
+    QString finishedPath;
+    QDateTime finishedStart;
+    QString nextPath;
+    QString errorMsg;
+    bool opened;
+    {
+        // 新文件在锁内创建：stopRecording() / endEvent() 返回后调用者重命名 getFilePath() 时文件一定已存在
+        QMutexLocker locker(&m_mutex);
+        if (m_state.loadAcquire() != StateRecording || (m_standby && !m_eventFileOpen)) {
+            return true; // 已请求停止 (或事件已结束)：剩余的帧写入当前文件
+        }
+        finishedPath = m_filePath;
+        finishedStart = m_segmentStartTime;
+        nextPath = nextSegmentPath(now);
+        m_filePath = nextPath;
+        m_segmentStartTime = now;
+
+        closeMuxer(true);
+        opened = openMuxer(nextPath, &errorMsg);
+    }
+    emit segmentFinished(finishedPath, finishedStart, now);
+
+    if (!opened) {
+        qWarning() << "RecordingThread::rotateSegment: " << errorMsg;
+        emit recordError(errorMsg);
+        return false;
+    }
+    // 新文件从这个关键帧开始，时间戳从0开始 (以 dts 为准，保证 dts 不为负)
+    m_muxerTsOffset = (m_packet->dts != AV_NOPTS_VALUE) ? m_packet->dts : m_packet->pts;
+    qInfo() << "自动分段：" << finishedPath << "已完成，继续写入" << nextPath;
+    return true;
+}
+
+QString RecordingThread::nextSegmentPath(const QDateTime &now) const
+{
+    const QFileInfo info(m_filePath);
+    QString dirPath = info.absolutePath();
+
+    // 跨过零点：<根目录>/旧日期[/camN] -> <根目录>/新日期[/camN]，与 StorageManager 按天清理的目录结构一致
+    const QString oldDate = m_segmentStartTime.toString("yyyyMMdd");
+    const QString newDate = now.toString("yyyyMMdd");
+    if (oldDate != newDate) {
+        QDir dateDir(dirPath);
+        QString camDir;
+        if (dateDir.dirName() != oldDate) {
+            camDir = dateDir.dirName();
+            dateDir.cdUp();
+        }
+        if (dateDir.dirName() == oldDate && dateDir.cdUp()) {
+            dirPath = dateDir.absoluteFilePath(newDate);
+            if (!camDir.isEmpty()) {
+                dirPath += "/" + camDir;
+            }
+            QDir().mkpath(dirPath);
+        }
+    }
+    return dirPath + "/record_" + now.toString("HHmmss") + "." + info.suffix();
+}
+
+void RecordingThread::cleanupRecorder()
+{
+    m_substream.stopEncoding(); // 子码流编码完已提交的帧后关闭 (未启用时无操作)
+
+    // 刷新编码器以处理剩余帧，然后写入文件尾并关闭输出文件
+    if (m_codecContext && m_formatContext) {
+        encodeFrame(nullptr);
+    }
+    closeMuxer(true);
+    m_fileWriter.stopWriter(); // 等I/O线程把所有文件写完，之后重命名、播放都看到完整的文件
+    m_preEventRing.clear(); // 待命录制：未写入的预录画面直接丢弃
+
+    // 释放资源
+    if (m_decodePacket) {
+        av_packet_free(&m_decodePacket);
+    }
+    if (m_decodedFrame) {
+        av_frame_free(&m_decodedFrame);
+    }
+    if (m_decoderContext) {
+        avcodec_free_context(&m_decoderContext);
+    }
+
+    if (m_swsContext) {
+        sws_freeContext(m_swsContext);
+        m_swsContext = nullptr;
+    }
+    for (SwsContext *context : m_swsSlices) {
+        sws_freeContext(context); // 空指针时无操作
+    }
+    m_swsSlices.clear();
+    
+    if (m_packet) {
+        av_packet_free(&m_packet);
+        m_packet = nullptr;
+    }
+    
+    if (m_codecContext) {
+        m_packetFanout.stop();
+        m_encoder.close(); // 释放编码器及硬件设备上下文
+        m_codecContext = nullptr;
+    }
+    
+}
+
+bool RecordingThread::processFrame(FrameData *frameData)
+{
+    // 采集线程转换失败的帧槽 size 为0，直接丢弃
+    if (m_state.loadAcquire() == StateIdle || !frameData || frameData->size <= 0
+            || (!frameData->converted && !frameData->data)) {
+        return false;
+    }
+    AVFrame *frame = frameData->frame;
+
+    // 排队阶段：入队到本线程取出
+    const qint64 dequeueUs = PipelineMetrics::nowUs();
+    m_metrics.recordLatency(PipelineMetrics::StageQueue, dequeueUs - frameData->enqueueUs);
+
+    // 自适应控制降低了编码帧率：在转换之前跳过，队列尽快排空 (时间戳取自采集时间，跳过的帧只让帧间隔变大)。
+    // 延时录制送入的帧已经很稀疏，不再分频
+    if (m_sessionAdaptive && frameData->role == FrameNormal && !m_rateController.acceptFrame()) {
+        return true;
+    }
+
+    // 记录当前时间
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastFrameTime).count() / 1000000.0;  // 转换为秒
+    m_lastFrameTime = now;
+
+    // 更新总时间和帧数
+    m_totalTime += elapsed;
+    m_totalFrames++;
+
+    // 计算瞬时帧率，但不每帧都输出日志（仅每30帧输出一次）
+    double currentFPS = 1.0 / elapsed;
+    if (m_totalFrames % 30 == 0) {
+        qDebug() << "当前帧率:" << currentFPS << "FPS";
+    }
+
+    // 原始格式已由采集线程转换 (转换阶段在 addFrameToQueue() 中计量)；MJPEG 在这里解码并转换为 YUV420P
+    if (!frameData->converted) {
+        if (!decodeMjpegFrame(frameData)) {
+            return false; // 损坏的帧直接丢弃，不中断录制
+        }
+        m_metrics.recordLatency(PipelineMetrics::StageConvert, PipelineMetrics::nowUs() - dequeueUs);
+    }
+
+    // 子码流：按子码流帧率抽取转换好的帧缩小，编码在子码流线程中进行
+    m_substream.submitFrame(frame, frameData->timestampUs);
+
+    // 移动侦测：直接使用刚转换好的 Y 平面，不需要额外的整帧转换
+    if (m_sessionMotion) {
+        const MotionDetector::Change change = m_motionDetector.analyze(frame->data[0], frame->linesize[0],
+                                                                       m_width, m_height, frameData->timestampUs);
+        if (change == MotionDetector::MotionStarted) {
+            m_motionActive.storeRelease(1);
+            emit motionStarted();
+        } else if (change == MotionDetector::MotionStopped) {
+            m_motionActive.storeRelease(0);
+            emit motionStopped();
+        }
+        if (change == MotionDetector::MotionStarted && m_formatContext) {
+            m_fileMotion = true;
+        }
+
+        // 待命、画面静止且没有事件文件时降低编码帧率 (时间戳取自采集时间，跳过的帧只是让帧间隔变大)
+        if (m_sessionIdleDivisor > 1 && frameData->role == FrameNormal && !m_motionDetector.isMotion() && !m_formatContext
+                && m_eventRequests.load() == 0 && !m_packetFanout.hasSinks()) {
+            if (m_idleFrameCounter++ % m_sessionIdleDivisor != 0) {
+                return true;
+            }
+        } else {
+            m_idleFrameCounter = 0;
+        }
+    }
+
+    // 延时录制两次采样之间的帧只用于移动侦测
+    if (frameData->role == FrameMotionProbe) {
+        return true;
+    }
+    const bool sampled = (frameData->role == FrameLapseSample);
+
+    // 设置帧的 pts（呈现时间戳）：相对本段第一帧的采集时间，换算到 1/90000 秒。
+    // 丢帧或传感器降帧时时间轴保持真实间隔，回放速度不受影响。
+    if (m_firstTimestampUs < 0) {
+        m_firstTimestampUs = frameData->timestampUs;
+    }
+    int64_t pts = av_rescale_q(frameData->timestampUs - m_firstTimestampUs,
+                               AVRational{1, 1000000}, AVRational{1, PTS_CLOCK_RATE});
+    if (m_lastPts != AV_NOPTS_VALUE && pts <= m_lastPts) {
+        pts = m_lastPts + 1; // 时间戳相同或回退 (驱动异常) 时保持严格递增，否则封装器会拒绝该帧
+    }
+    m_lastPts = pts;
+    frame->pts = pts;
+    m_frameCount++;
+
+    // 自动分段：本段时长已到，强制这一帧编码为 IDR，新文件从它开始 (encodeFrame() 收到关键帧包时切换)
+    // 待命录制只在事件文件打开期间分段；事件开始时缓冲区为空则强制 IDR，让事件文件尽快开始
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+    if (m_keyFrameRequested.loadAcquire() && m_keyFrameRequested.testAndSetOrdered(1, 0)) {
+        m_forceKeyFrame = true; // 数据包消费者 (例如新连接的远程观看者) 请求的 IDR
+    }
+    // 延时录制因移动切换到全帧率：移动开始处放一个 IDR，回放定位到移动开始处不需要解码稀疏的采样帧
+    if (m_lastFrameSampled && !sampled) {
+        m_forceKeyFrame = true;
+    }
+    m_lastFrameSampled = sampled;
+    if (m_forceKeyFrame) {
+        frame->pict_type = AV_PICTURE_TYPE_I;
+        m_forceKeyFrame = false;
+    }
+    if (sampled) {
+        // 延时录制：全部为 IDR，或按采样时间间隔插入关键帧 (编码器按帧数的关键帧间隔对稀疏的采样帧过长)
+        if (m_sessionLapseIntraOnly || m_lastKeyPts == AV_NOPTS_VALUE || pts - m_lastKeyPts >= m_sessionLapseGopPts) {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+        }
+    } else if (m_sessionGopPts > 0 && m_lastKeyPts != AV_NOPTS_VALUE
+            && pts - m_lastKeyPts >= m_sessionGopPts * m_rateController.gopFactor()) {
+        // 自适应控制：按时间插入关键帧，低运动模式下间隔放大 (编码器自己插入的关键帧同样重新计时)
+        frame->pict_type = AV_PICTURE_TYPE_I;
+    }
+    if (m_segmentLengthPts > 0 && m_formatContext && !m_rotatePending
+            && pts - m_segmentStartPts >= m_segmentLengthPts) {
+        frame->pict_type = AV_PICTURE_TYPE_I;
+        m_rotatePending = true;
+        m_rotatePts = pts;
+        m_segmentStartPts = pts;
+    }
+    if (frame->pict_type == AV_PICTURE_TYPE_I) {
+        m_lastKeyPts = pts; // 编码器有延迟时关键帧包稍后才出来，期间不重复强制
+    }
+
+    // 编码并写入帧
+    if (!encodeFrame(frame)) {
+        return false;
+    }
+    // 全程：采集时间戳到这一帧的数据包全部交给封装器
+    const qint64 doneUs = PipelineMetrics::nowUs();
+    m_metrics.recordLatency(PipelineMetrics::StageTotal, doneUs - frameData->timestampUs);
+
+    // 自适应控制：按取出这一帧后的队列占用和这一帧的处理时间调整下一帧的参数
+    if (m_sessionAdaptive) {
+        const bool wasLowMotion = m_rateController.isLowMotion();
+        if (m_rateController.update(frameData->timestampUs, static_cast<int>(m_frameRing.size()), m_queueCapacity,
+                                    doneUs - dequeueUs, m_sessionMotion, m_motionDetector.isMotion())) {
+            applyRateDecision(wasLowMotion);
+        }
+    }
+
+    return true;
+}
+
+bool RecordingThread::decodeMjpegFrame(FrameData *frameData)
+{
+    // 编码器可能仍引用这个帧槽上一次的缓冲区，写入前确保可写 (必要时重新分配)
+    if (av_frame_make_writable(frameData->frame) < 0) {
+        qWarning() << "无法获取可写的视频帧缓冲区，跳过该帧";
+        return false;
+    }
+
+    // 解码输入包直接指向队列中的数据 (非引用计数，解码器内部按需复制)
+    m_decodePacket->data = frameData->data;
+    m_decodePacket->size = frameData->size;
+    int ret = avcodec_send_packet(m_decoderContext, m_decodePacket);
+    m_decodePacket->data = nullptr;
+    m_decodePacket->size = 0;
+    if (ret >= 0) {
+        ret = avcodec_receive_frame(m_decoderContext, m_decodedFrame);
+    }
+    if (ret < 0) {
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        qWarning() << "MJPEG 帧解码失败，跳过:" << errbuf;
+        return false;
+    }
+
+    // 解码器输出格式 (YUVJ422P / YUVJ420P 等) 和尺寸不变时 sws_getCachedContext 直接复用原上下文
+    m_swsContext = sws_getCachedContext(m_swsContext,
+                                        m_decodedFrame->width, m_decodedFrame->height,
+                                        static_cast<AVPixelFormat>(m_decodedFrame->format),
+                                        m_width, m_height, AV_PIX_FMT_YUV420P,
+                                        SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (!m_swsContext) {
+        qWarning() << "无法为 MJPEG 解码输出创建 swscale 上下文";
+        av_frame_unref(m_decodedFrame);
+        return false;
+    }
+    sws_scale(m_swsContext, m_decodedFrame->data, m_decodedFrame->linesize, 0, m_decodedFrame->height,
+              frameData->frame->data, frameData->frame->linesize);
+    av_frame_unref(m_decodedFrame);
+    return true;
+}
+
+bool RecordingThread::encodeFrame(AVFrame *frame)
+{
+    // 发送帧到编码器 (编码阶段只计送入和取出，不包括分发和写文件)
+    qint64 startUs = PipelineMetrics::nowUs();
+    int ret = m_encoder.sendFrame(frame); // 硬件后端在内部完成上传
+    qint64 encodeUs = PipelineMetrics::nowUs() - startUs;
     if (ret < 0) {
         emit recordError("发送帧失败");
         return false;
@@ -602,7 +1697,9 @@ bool RecordingThread::encodeFrame(AVFrame *frame)
 
     // 接收编码后的数据包
     while (ret >= 0) {
-        ret = avcodec_receive_packet(m_codecContext, m_packet);
+        startUs = PipelineMetrics::nowUs();
+        ret = m_encoder.receivePacket(m_packet);
+        encodeUs += PipelineMetrics::nowUs() - startUs;
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break; // 需要更多帧或编码结束
         } else if (ret < 0) {
@@ -610,15 +1707,186 @@ bool RecordingThread::encodeFrame(AVFrame *frame)
             return false;
         }
 
-        // 调整时间戳并写入数据包
-        av_packet_rescale_ts(m_packet, m_codecContext->time_base, m_formatContext->streams[0]->time_base);
-        m_packet->stream_index = 0;
-        if (av_interleaved_write_frame(m_formatContext, m_packet) < 0) {
-            emit recordError("写入数据包失败");
+        // 编码器自己插入的关键帧 (场景切换等) 也重新开始自适应控制的关键帧计时
+        if ((m_packet->flags & AV_PKT_FLAG_KEY) && m_packet->pts != AV_NOPTS_VALUE
+                && (m_lastKeyPts == AV_NOPTS_VALUE || m_packet->pts > m_lastKeyPts)) {
+            m_lastKeyPts = m_packet->pts;
+        }
+
+        // 同一次编码的结果先按引用分发给网络推流等消费者，再写文件 (writePacket() 会就地修改时间戳)
+        m_packetFanout.dispatch(m_packet);
+
+        // 待命录制：开始 / 结束事件文件
+        if (m_standby && m_eventRequests.loadAcquire() && !handleEventRequests()) {
+            av_packet_unref(m_packet);
+            return false;
+        }
+
+        // 自动分段：从强制 IDR 帧 (或编码器不支持强制时其后的第一个关键帧) 开始写入新文件
+        if (m_rotatePending && (m_packet->flags & AV_PKT_FLAG_KEY) && m_packet->pts >= m_rotatePts) {
+            if (!rotateSegment()) {
+                av_packet_unref(m_packet);
+                return false;
+            }
+        }
+        if (!m_formatContext) {
+            // 待命录制：没有事件文件时放进预录缓冲区；否则是新分段文件打开失败 (已报告错误)，丢弃直到停止录制
+            if (m_standby) {
+                m_preEventRing.push(m_packet);
+            }
+            av_packet_unref(m_packet);
+            continue;
+        }
+        if (!writePacket(m_packet)) {
             return false;
         }
-        av_packet_unref(m_packet);
     }
 
+    if (frame) { // 排空编码器 (frame 为空) 不计入
+        m_metrics.recordLatency(PipelineMetrics::StageEncode, encodeUs);
+        m_metrics.addEncoded();
+    }
+    return true;
+}
+
+void RecordingThread::applyRateDecision(bool wasLowMotion)
+{
+    const bool bitRateApplied = m_encoder.setBitRate(m_rateController.bitRate());
+    if (wasLowMotion && !m_rateController.isLowMotion()) {
+        m_forceKeyFrame = true; // 画面开始变化：尽快插入关键帧，回放定位到移动开始处不需要解码很长的 GOP
+    }
+    qDebug() << "自适应控制: 等级" << m_rateController.level()
+             << "码率" << m_rateController.bitRate() / 1000 << "kbps" << (bitRateApplied ? "" : "(编码器不支持修改)")
+             << "帧率分频" << m_rateController.frameDivisor()
+             << (m_rateController.isLowMotion() ? "低运动模式" : "");
+}
+
+bool RecordingThread::writePacket(AVPacket *packet)
+{
+    // 调整时间戳 (减去本文件的时间零点) 并写入数据包
+    const int64_t packetPts = packet->pts;
+    const bool keyPacket = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= m_muxerTsOffset;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= m_muxerTsOffset;
+    }
+    const int64_t fileMs = (packet->pts != AV_NOPTS_VALUE)
+            ? av_rescale_q(packet->pts, m_codecContext->time_base, AVRational{1, 1000}) : -1;
+    av_packet_rescale_ts(packet, m_codecContext->time_base, m_formatContext->streams[0]->time_base);
+    packet->stream_index = 0;
+    int64_t keyOffset = keyPacket ? avio_tell(m_formatContext->pb) : -1;
+    const qint64 writeStartUs = PipelineMetrics::nowUs();
+    if (av_interleaved_write_frame(m_formatContext, packet) < 0) {
+        av_packet_unref(packet);
+        emit recordError("写入数据包失败");
+        return false;
+    }
+    m_metrics.recordLatency(PipelineMetrics::StageWrite, PipelineMetrics::nowUs() - writeStartUs);
+    av_packet_unref(packet);
+    if (keyPacket) {
+        m_fileKeyFrames++; // 录像索引记录每个文件的可随机访问位置数
+        if (m_sessionContainer == ContainerFragmentedMp4) {
+            // 关键帧开始新的分片：上一个分片在这次写入时才输出，写入后的位置才是本分片 (moof) 的起点
+            keyOffset = avio_tell(m_formatContext->pb);
+        }
+        if (fileMs >= 0) {
+            m_fileIndex.append(fileMs, keyOffset);
+        }
+        reportWrittenBytes(); // 每个 GOP 报告一次，存储管理据此估算剩余空间
+    }
+
+    // 流式封装：关键帧处上一个分片 (GOP) 已完整输出，落盘；没有关键帧时最多等两个周期
+    if (m_flushIntervalPts > 0 && packetPts != AV_NOPTS_VALUE
+            && (keyPacket || packetPts - m_lastFlushPts >= 2 * m_flushIntervalPts)) {
+        flushOutput(packetPts);
+    }
+    return true;
+}
+
+void RecordingThread::reportWrittenBytes()
+{
+    if (!m_formatContext || !m_formatContext->pb) {
+        return;
+    }
+    // 输出位置包含 AVIO 缓冲区中尚未写入文件的数据，很快就会占用存储空间
+    const int64_t position = avio_tell(m_formatContext->pb);
+    if (position > m_reportedBytes) {
+        m_metrics.addBytes(position - m_reportedBytes);
+        emit bytesWritten(position - m_reportedBytes);
+        m_reportedBytes = position;
+    }
+}
+
+bool RecordingThread::handleEventRequests()
+{
+    QString errorMsg;
+    int64_t firstPts = AV_NOPTS_VALUE;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_eventClosePending) {
+            // 调用者已在 endEvent() 返回后重命名文件，这里只写文件尾并关闭
+            m_eventClosePending = false;
+            closeMuxer(true);
+            qInfo() << "事件录制结束，恢复预录缓冲";
+        }
+        if (m_eventOpenPending && !m_formatContext) {
+            const bool keyPacket = (m_packet->flags & AV_PKT_FLAG_KEY) != 0;
+            if (m_preEventRing.isEmpty() && !keyPacket) {
+                m_forceKeyFrame = true; // 没有可以开始的关键帧：下一帧强制为 IDR
+                return true;
+            }
+            m_eventOpenPending = false;
+            firstPts = m_preEventRing.isEmpty() ? m_packet->pts : m_preEventRing.oldestPts();
+            // 文件从预录画面开始，开始时间相应提前 (用于重命名)
+            m_segmentStartTime = m_segmentStartTime.addMSecs(-(m_packet->pts - firstPts) * 1000 / PTS_CLOCK_RATE);
+            if (openMuxer(m_filePath, &errorMsg)) {
+                m_eventFileOpen = true;
+            } else {
+                firstPts = AV_NOPTS_VALUE;
+            }
+        }
+        m_eventRequests.storeRelease((m_eventOpenPending || m_eventClosePending) ? 1 : 0);
+    }
+
+    if (!errorMsg.isEmpty()) {
+        m_preEventRing.clear();
+        qWarning() << "RecordingThread::handleEventRequests: " << errorMsg;
+        emit recordError(errorMsg);
+        return false;
+    }
+    if (firstPts == AV_NOPTS_VALUE) {
+        return true; // 没有打开新的事件文件
+    }
+
+    // 新的事件文件：时间零点取最旧的关键帧，自动分段从这里开始计时
+    m_segmentStartPts = firstPts;
+    m_rotatePending = false;
+    m_lastFlushPts = firstPts;
+    AVPacket *buffered = av_packet_alloc();
+    if (!buffered) {
+        m_preEventRing.clear();
+        m_muxerTsOffset = (m_packet->dts != AV_NOPTS_VALUE) ? m_packet->dts : m_packet->pts;
+        return true;
+    }
+    bool first = true;
+    while (m_preEventRing.takeOldest(buffered)) {
+        if (first) {
+            m_muxerTsOffset = (buffered->dts != AV_NOPTS_VALUE) ? buffered->dts : buffered->pts;
+            first = false;
+        }
+        if (!writePacket(buffered)) {
+            m_preEventRing.clear();
+            av_packet_free(&buffered);
+            return false;
+        }
+    }
+    av_packet_free(&buffered);
+    if (first) {
+        // 缓冲区为空，文件从当前关键帧开始
+        m_muxerTsOffset = (m_packet->dts != AV_NOPTS_VALUE) ? m_packet->dts : m_packet->pts;
+    }
+    qInfo() << "事件录制开始:" << getFilePath() << "预录" << (m_packet->pts - firstPts) / PTS_CLOCK_RATE << "秒";
     return true;
 }
\ No newline at end of file
@@ -3,11 +3,24 @@
 
 #include <QThread>
 #include <QMutex>
-#include <QQueue>
-#include <QWaitCondition>
+#include <QVector>
+#include <QList>
+#include <QAtomicInt>
 #include <QString>
+#include <QDateTime>
 #include <chrono>
-#include <QTimer>
+
+#include "framesink.h"
+#include "packetfanout.h"   // 已编码数据包分发给网络推流等消费者
+#include "encoderbackend.h" // H.264 编码器后端 (硬件优先，libx264 兜底)
+#include "spscring.h"      // 采集线程 -> 编码线程的无锁帧队列
+#include "packetring.h"    // 待命录制的预录缓冲区 (已编码数据包)
+#include "motiondetector.h" // 基于已转换亮度平面的移动侦测
+#include "substreamencoder.h" // 低分辨率子码流 (远程预览、缩略图)
+#include "bufferedfilewriter.h" // 录像文件的后写缓冲区和I/O线程
+#include "keyframeindex.h"   // 每个录像文件的关键帧索引 (播放页快速定位)
+#include "pipelinemetrics.h" // 各阶段耗时、队列深度、丢帧和编码线程CPU的计量
+#include "ratecontroller.h"  // 按队列压力和编码负载调整码率、帧率和关键帧间隔
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -19,11 +32,24 @@ extern "C" {
  * @brief 视频录制线程类
  * 
  * 实现视频监控系统的视频录制功能：
- * - 将v4l2采集的视频帧保存为MP4文件
+ * - 将v4l2采集的视频帧保存为MP4文件 (普通 MP4、分片 MP4 或 MPEG-TS，见 `ContainerFormat`)
  * - 在单独的线程中运行，不阻塞UI
- * - 使用线程安全的帧队列机制
+ * - 采集线程和编码线程之间使用无锁的单生产者/单消费者有界帧队列，帧缓冲区在开始录制时一次性预分配，
+ *   稳态录制既不加锁也不做堆分配，只在编码线程真正停放时才通过 eventfd 唤醒
+ * - 实现 FrameSink 接口，可直接注册到 CaptureThread 上接收每一帧
+ * - 支持待命录制 (`startStandby()`)：编码器持续工作，最近若干秒的已编码数据包保存在预录缓冲区中，
+ *   只有事件期间 (`beginEvent()` 到 `endEvent()`) 才写文件，事件文件以事件前的预录画面开头
+ * - 支持移动侦测 (`setMotionDetection()`)：直接分析转换后的 Y 平面，发出 `motionStarted()` / `motionStopped()`；
+ *   待命且画面静止时按 `setIdleFrameDivisor()` 降低编码帧率
+ * - 支持延时录制 (`setTimeLapse()`)：采集线程按采样间隔抽帧，只编码采样帧 (可全部为 IDR)，
+ *   移动期间自动恢复全帧率录制
+ * - 支持数据包分发 (`addPacketSink()`)：编码器输出的每个数据包在写文件之前按引用分发给所有 `PacketSink`
+ *   (例如 `NetworkStreamer` 推流)，一次编码同时供本地录像和多个远程观看使用
+ * - 支持低分辨率子码流 (`setSubstream()`)：转换好的每一帧同时交给 `SubstreamEncoder` 缩小并在另一个线程中编码
+ * - 封装器通过 `BufferedFileWriter` 的自定义 AVIO 写文件：数据按 4 MiB 对齐的整块由单独的I/O线程写入并预分配文件空间，
+ *   TF卡的写入延迟尖峰不会阻塞编码
  */
-class RecordingThread : public QThread
+class RecordingThread : public QThread, public FrameSink
 {
     Q_OBJECT
 
@@ -33,6 +59,29 @@ public:
      * @param parent 父对象指针
      */
     explicit RecordingThread(QObject *parent = nullptr);
+
+    /**
+     * @brief 帧队列已满 (编码跟不上采集) 时的处理策略。
+     */
+    enum OverflowPolicy {
+        DropOldest,   ///< 丢弃队列中最旧的一帧，为新帧腾出位置 (默认，录像尽量贴近实时)。
+        DropNewest,   ///< 丢弃新到达的帧，保留已排队的帧。
+        BlockCapture  ///< 阻塞采集线程等待空闲帧槽 (最多 BLOCK_TIMEOUT_MS 毫秒，超时后丢弃新帧)，预览也会随之变慢。
+    };
+
+    /**
+     * @brief 录像文件的封装格式。
+     *
+     * 普通 MP4 的索引 (moov) 要到 `av_write_trailer()` 才写入，断电或拔卡时整段录像无法播放。
+     * 两种流式格式在写入过程中始终是可播放的文件，重启后不需要修复：
+     * 每隔 `setFlushInterval()` 设定的时间强制一个关键帧，并把已写入的数据刷到存储介质上，
+     * 最多只丢失最后一个刷新周期的画面。
+     */
+    enum ContainerFormat {
+        ContainerMp4,           ///< 普通 MP4，文件尾写入 moov。
+        ContainerFragmentedMp4, ///< 分片 MP4 (frag_keyframe+empty_moov)，每个关键帧开始一个独立的 moof+mdat 分片 (默认)。
+        ContainerMpegTs         ///< MPEG-TS，SPS/PPS 随每个关键帧重复，文件可从任意关键帧开始解码。
+    };
     
     /**
      * @brief 析构函数
@@ -44,61 +93,347 @@ public:
     
     /**
      * @brief 开始一个新的录制会话。
-     * @param filePath 要保存的MP4视频文件的完整路径。
+     * @param filePath 要保存的视频文件的完整路径，扩展名应与 `fileSuffix(containerFormat())` 一致
+     *                 (封装格式由 `setContainerFormat()` 决定，不按扩展名猜测)。
      * @param width 视频帧的宽度 (像素)。
      * @param height 视频帧的高度 (像素)。
+     * @param inputFormat 通过 `addFrameToQueue()` 送入的原始帧像素格式。
+     *                    默认为 RGB24；直接送入摄像头借出的原始缓冲区时为 AV_PIX_FMT_RGB565LE、
+     *                    AV_PIX_FMT_YUYV422 或 AV_PIX_FMT_NV12 (这三种由 pixel_convert 内核直接转换)。
+     * @param inputCodec 送入数据的编码方式。AV_CODEC_ID_RAWVIDEO 表示原始像素 (按 inputFormat 解释)；
+     *                   AV_CODEC_ID_MJPEG 表示每帧是一张JPEG图像，先解码再转换为YUV420P，此时忽略 inputFormat。
+     * @param frameRate 摄像头的标称帧率，只作为编码器码率控制的提示；小于等于0时按 DEFAULT_FRAME_RATE。
+     *                  设置了更低的录制帧率 (`setRecordFrameRate()`) 时按录制帧率。
+     *                  每帧的显示时间戳取自采集时间戳，实际帧率变化 (或丢帧) 不会让回放变快或变慢。
      * @return 如果成功初始化FFmpeg编码器、打开输出文件并启动线程（如果尚未运行），则返回 true；
      *         如果已在录制或初始化失败，则返回 false。
+     *
+     * 上一次会话刚停止、录制线程仍在写文件尾时 (可能需要几秒) 不等待：记下请求并返回 true，
+     * 录制线程回到空闲后 (`sessionIdle()`) 在本对象所在的线程中开始，此时初始化失败通过 `recordError` 报告。
+     * 开始之前可以用 `cancelPendingSession()` 取消。
+     */
+    bool startRecording(const QString &filePath, int width, int height,
+                        AVPixelFormat inputFormat = AV_PIX_FMT_RGB24,
+                        AVCodecID inputCodec = AV_CODEC_ID_RAWVIDEO,
+                        int frameRate = 0);
+
+    /**
+     * @brief 开始待命录制：编码器持续工作，但只把编码结果放进预录缓冲区，不写文件。
+     *
+     * 参数同 `startRecording()`。之后每次 `beginEvent()` 打开一个事件文件，先写入缓冲区中事件前的画面
+     * (时长由 `setPreEventBuffer()` 设定)，`endEvent()` 关闭它并回到待命；`stopRecording()` 结束待命。
+     * @return 成功初始化编码器并启动线程返回 true；已在录制或初始化失败时返回 false。
+     *         上一次会话仍在收尾时与 `startRecording()` 相同，记下请求稍后开始。
+     */
+    bool startStandby(int width, int height,
+                      AVPixelFormat inputFormat = AV_PIX_FMT_RGB24,
+                      AVCodecID inputCodec = AV_CODEC_ID_RAWVIDEO,
+                      int frameRate = 0);
+
+    /**
+     * @brief 待命录制时开始一个事件：录制线程在下一个数据包处打开 filePath，先写入预录缓冲区，再继续写入实时画面。
+     * @param filePath 事件文件路径，扩展名规则同 `startRecording()`。
+     * @return 未处于待命录制或已有事件进行中时返回 false。
+     *
+     * 缓冲区为空 (例如刚进入待命) 时强制下一帧编码为 IDR，文件从它开始。
+     * 文件打开后 `segmentStartTime()` 为预录画面的开始时间；事件期间同样按设定时长自动分段。
+     */
+    bool beginEvent(const QString &filePath);
+
+    /**
+     * @brief 结束当前事件，录制线程在下一个数据包处写入文件尾并关闭文件，之后重新开始缓冲。
+     * @return 事件文件已打开时返回 true，此时 `getFilePath()` / `segmentStartTime()` 就是最后一段的文件和开始时间，
+     *         与 `stopRecording()` 一样不会为它发出 `segmentFinished`；事件文件尚未打开 (被取消) 或没有事件时返回 false。
+     */
+    bool endEvent();
+
+    /**
+     * @brief 当前录制会话是否为待命录制。线程安全。
+     */
+    bool isStandby() const;
+
+    /**
+     * @brief 是否有事件正在进行 (已 `beginEvent()` 且尚未 `endEvent()`)。线程安全。
+     */
+    bool isEventActive() const;
+
+    /**
+     * @brief 设置待命录制的预录缓冲区大小，从下一次 `startStandby()` 开始生效。
+     * @param seconds 事件文件至少包含的事件前时长 (秒)，小于等于0时不保留预录画面。默认为 DEFAULT_PRE_EVENT_SECONDS。
+     * @param maxBytes 缓冲区压缩数据的字节数上限，超出时即使不足设定时长也丢弃最旧的 GOP。
      */
-    bool startRecording(const QString &filePath, int width, int height);
+    void setPreEventBuffer(int seconds, int maxBytes = DEFAULT_PRE_EVENT_BYTES);
+
+    /**
+     * @brief 启用或禁用移动侦测，从下一次 `startRecording()` / `startStandby()` 开始生效。
+     * @param enable 为 true 时录制线程在每帧转换为 YUV420P 后分析其亮度平面 (默认禁用)。
+     * @param settings 阈值、保持时间和区域屏蔽，见 `MotionDetector::Settings`。
+     *
+     * 侦测只在录制会话期间进行，需要在未录制时侦测移动的调用者应使用待命录制。
+     */
+    void setMotionDetection(bool enable, const MotionDetector::Settings &settings = MotionDetector::Settings());
+
+    /**
+     * @brief 设置待命录制时画面静止期间的编码帧率分频，从下一次会话开始生效。
+     * @param divisor 静止、且没有事件文件打开时每 divisor 帧只编码一帧 (仍然逐帧做移动侦测)；
+     *                1 表示不降帧，小于1时忽略。默认为 DEFAULT_IDLE_FRAME_DIVISOR。只在启用移动侦测时起作用。
+     *
+     * 检测到移动后立即恢复全帧率，因此事件文件开头的预录画面帧率较低，事件本身不受影响。
+     */
+    void setIdleFrameDivisor(int divisor);
+
+    /**
+     * @brief 设置录制帧率，从下一次会话开始生效。
+     * @param fps 每秒最多录制的帧数；0 表示按采集帧率录制每一帧 (默认)，小于0时忽略。
+     *
+     * 低于采集帧率时在采集线程中按采集时间戳均匀抽帧，未选中的帧在复制入队之前就被跳过 (不计入丢帧)；
+     * 编码器的码率控制提示也按该帧率设置。与预览帧率无关，界面刷新快慢不影响录制。
+     */
+    void setRecordFrameRate(int fps);
+
+    /**
+     * @brief 延时录制参数。
+     */
+    struct TimeLapseSettings {
+        int intervalMs;         ///< 采样间隔 (毫秒)，例如每秒一帧 (1000，默认) 或每分钟一帧 (60000)。
+        bool intraOnly;         ///< 每个采样帧都编码为 IDR (文件稍大，回放可以定位到任意一帧)。默认 false。
+        bool fullRateOnMotion;  ///< 检测到移动期间恢复为正常录制帧率 (需要同时启用移动侦测)。默认 true。
+
+        // 用作本类成员函数的默认参数，不能使用默认成员初始化
+        TimeLapseSettings() : intervalMs(1000), intraOnly(false), fullRateOnMotion(true) {}
+    };
+
+    /**
+     * @brief 启用或禁用延时录制，从下一次会话开始生效。
+     * @param enable 为 true 时只录制按 `TimeLapseSettings::intervalMs` 采样的帧 (默认禁用)。
+     * @param settings 采样间隔、是否全部为关键帧以及移动时是否恢复全帧率。
+     *
+     * 采样在采集线程中按采集时间戳进行，采样之间的帧在复制和转换之前就被跳过 (不计入丢帧)。
+     * 每一帧的显示时间戳仍是真实的采集时间，文件时长、按时间定位和文件命名与普通录像一致，
+     * 回放时用倍速 (快进) 观看；编码器按正常帧率打开，每个采样帧的质量与正常录像相同。
+     * 没有全部为 IDR 时每 LAPSE_GOP_SAMPLES 个采样 (最多 LAPSE_MAX_GOP_MS) 一个关键帧，
+     * 流式封装断电时最多丢失一个关键帧间隔。
+     *
+     * 移动时恢复全帧率：采样之间另以不超过 LAPSE_PROBE_INTERVAL_MS 的间隔送入只做移动侦测、不编码的帧，
+     * 移动开始后在一两秒内切换为正常录制帧率 (切换处强制 IDR)，移动结束后回到采样。
+     */
+    void setTimeLapse(bool enable, const TimeLapseSettings &settings = TimeLapseSettings());
+
+    /**
+     * @brief 启用或禁用编码自适应控制，从下一次会话开始生效。
+     * @param enable 为 true 时录制线程按帧队列占用和每帧处理时间逐级降低目标码率和编码帧率，
+     *               压力消失后逐级恢复；启用移动侦测时，长时间静止的画面降低码率并拉长关键帧间隔 (默认禁用)。
+     * @param settings 阈值和时间常数，见 `RateController::Settings`。
+     *
+     * 码率只对能在运行中修改码率的编码器 (libx264) 生效，帧率分频和关键帧间隔对所有编码器生效。
+     * 编码线程数在编码器打开后不能修改：本次会话因算力不足降过级、且线程数少于 CPU 核数时，
+     * 下一次打开编码器时多用一个线程。
+     */
+    void setAdaptiveRateControl(bool enable, const RateController::Settings &settings = RateController::Settings());
+
+    /**
+     * @brief 启用或关闭低分辨率子码流，下一次录制 (或待命) 会话生效。
+     * @param enable 是否同时编码子码流 (默认关闭)。
+     * @param settings 子码流尺寸、帧率和码率。
+     *
+     * 子码流直接从转换好的 YUV420P 帧缩小得到，与主码流共用采集和色彩空间转换；
+     * 子码流编码器打开失败不影响主码流录制。
+     */
+    void setSubstream(bool enable, const SubstreamEncoder::Settings &settings = SubstreamEncoder::Settings());
+
+    /**
+     * @brief 子码流编码器：注册子码流的数据包消费者、获取缩略图。对象与录制线程同生命周期。
+     */
+    SubstreamEncoder *substream() { return &m_substream; }
+
+    /**
+     * @brief 移动侦测当前是否处于 "移动中" 状态。线程安全。
+     */
+    bool isMotionActive() const { return m_motionActive.loadAcquire() != 0; }
+
+    /**
+     * @brief 把 V4L2 像素格式映射为 `startRecording()` 的输入参数。
+     * @param v4l2PixelFormat 摄像头协商出的 FourCC (NV12 / YUYV / RGB565 / MJPEG)。
+     * @param inputFormat 输出原始帧像素格式 (MJPEG 时为 AV_PIX_FMT_NONE)。
+     * @param inputCodec 输出送入数据的编码方式。
+     * @return 支持该格式返回 true；否则返回 false。
+     */
+    static bool inputFromV4l2(unsigned int v4l2PixelFormat, AVPixelFormat *inputFormat, AVCodecID *inputCodec);
     
     /**
      * @brief 请求停止当前的录制会话。
      * 
      * 此方法设置内部标志以指示线程应停止录制，并唤醒线程（如果它正在等待）。
      * 实际的文件关闭和资源清理在线程的 `run()` 方法中异步完成。
-     * 如果当前未在录制，则此方法不执行任何操作。
+     * 如果当前未在录制，则此方法不执行任何操作；有等待开始的会话时取消它。
      */
     void stopRecording();
+
+    /**
+     * @brief 取消等待上一次会话收尾后才开始的会话 (见 `startRecording()`)。
+     * @return 有这样的会话时返回 true，它没有打开过任何文件；否则返回 false，不执行任何操作。
+     */
+    bool cancelPendingSession();
     
     /**
      * @brief 将一帧原始图像数据添加到待编码队列。
-     * @param frameData 指向包含原始图像数据（通常为RGB888格式）的缓冲区的指针。
-     *                  函数内部会复制此数据，调用者之后可以释放原始数据。
-     * @param size 图像数据的总字节大小。
+     * @param frameData 指向包含原始图像数据的缓冲区的指针，像素格式由 `startRecording()` 的
+     *                  inputFormat 指定 (可以直接是 v4l2_acquire_frame() 借出的缓冲区)。
+     *                  原始格式在函数内部直接转换为 YUV420P (MJPEG 复制压缩数据)，调用者之后可以立即归还/释放原始数据。
+     * @param size 图像数据的总字节大小 (MJPEG 为压缩数据长度)。
+     * @param stride 每行字节数 (NV12 为 Y/UV 平面的行跨度)。为0时按 size / height 推算，
+     *               以兼容驱动的行尾填充 (仅适用于单平面打包格式)。
+     * @param timestampUs 采集时间戳 (微秒，CLOCK_MONOTONIC，例如 `v4l2_frame::timestamp_us`)，
+     *                    用于计算显示时间戳。小于0时使用入队时刻。
      * @return 如果当前正在录制且帧数据有效，并且成功将帧（的副本）添加到队列，则返回 true；
-     *         否则（例如未在录制、数据无效或队列操作失败）返回 false。
+     *         否则（例如未在录制、数据无效、按录制帧率跳过或队列操作失败）返回 false。
+     */
+    bool addFrameToQueue(const unsigned char *frameData, int size, int stride = 0, long long timestampUs = -1);
+
+    /**
+     * @brief 设置帧队列容量 (帧数)，从下一次 `startRecording()` 开始生效。
+     * @param frames 最多排队等待编码的帧数，小于1时忽略。默认为 DEFAULT_QUEUE_CAPACITY。
      */
-    bool addFrameToQueue(const unsigned char *frameData, int size);
+    void setQueueCapacity(int frames);
+
+    /**
+     * @brief 设置帧队列满时的处理策略，立即生效。
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief 当前录制会话中因队列已满而丢弃的帧数 (`startRecording()` 时清零)。线程安全。
+     */
+    int droppedFrames() const;
+
+    /**
+     * @brief 当前录制会话中帧队列出现过的最大深度 (高水位)。线程安全。
+     */
+    int queueHighWaterMark() const;
+
+    /**
+     * @brief 本路流水线的计量 (各阶段耗时直方图、队列深度、丢帧、写入字节数、编码线程CPU)。
+     *        跨录制会话累计，可在任意线程中读取 (`PipelineMetrics::snapshot()`)。
+     */
+    PipelineMetrics *metrics() { return &m_metrics; }
+
+    /**
+     * @brief FrameSink 接口：由采集线程在每一帧到达时调用。
+     * @param frame 借出的原始帧。未在录制时直接忽略，否则转换 (MJPEG 复制) 到一个空闲帧槽放入待编码队列；
+     *              队列已满时按 `OverflowPolicy` 处理。
+     */
+    void consumeFrame(const v4l2_frame &frame) override;
     
     /**
      * @brief 查询当前是否正在进行录制。
      * @return 如果线程当前正在录制视频，则返回 true；否则返回 false。
      *         此方法是线程安全的。
      */
-    bool isRecording() const { return m_isRecording; }
+    bool isRecording() const { return m_state.loadAcquire() == StateRecording; }
     
     /**
      * @brief 获取当前正在录制或最后一次录制的视频文件的完整路径。
      * @return 包含文件路径的 QString。如果尚未开始过录制，可能返回空字符串。
-     *         此方法是线程安全的。
+     *         自动分段时由录制线程更新为当前分段的文件。此方法是线程安全的；
+     *         `stopRecording()` 返回后不会再分段，此时返回的就是最后一段的文件。
      */
-    QString getFilePath() const { return m_filePath; }
+    QString getFilePath() const;
+
+    /**
+     * @brief 获取当前 (或最后一个) 分段的开始时间，与 `getFilePath()` 同时更新。线程安全。
+     */
+    QDateTime segmentStartTime() const;
     
     /**
      * @brief 启用或禁用视频的自动分段录制功能。
      * @param enable 如果为 true，则启用自动分段；如果为 false，则禁用。
-     *               默认情况下，自动分段是启用的。
+     *               默认情况下，自动分段是启用的。下一次 `startRecording()` 时生效。
      */
     void setAutoSegmentation(bool enable);
     
     /**
-     * @brief 设置自动分段的时长（单位：分钟）。
+     * @brief 设置自动分段的时长（单位：秒）。
+     * @param seconds 分段时长，必须大于0。默认为 DEFAULT_SEGMENT_SECONDS (30分钟)。
+     *                下一次 `startRecording()` 时生效。
+     *
+     * 分段在录制线程内部完成：到达时长后强制下一帧编码为 IDR 帧，从该关键帧开始写入新文件，
+     * 编码器和转换器保持不变，两段之间不丢帧。时长按帧的显示时间戳计算，实际切换点落在其后的第一个关键帧。
+     */
+    void setSegmentDuration(int seconds);
+
+    /**
+     * @brief 设置自动分段的时长（单位：分钟），等价于 `setSegmentDuration(minutes * 60)`。
      * @param minutes 分段时长，单位为分钟。必须大于0。
-     *                默认时长为30分钟。
      */
     void setMaxRecordingMinutes(int minutes);
 
+    /**
+     * @brief 设置录像文件的封装格式，从下一次 `startRecording()` 开始生效。
+     */
+    void setContainerFormat(ContainerFormat format);
+
+    /**
+     * @brief 获取当前设置的封装格式。
+     */
+    ContainerFormat containerFormat() const;
+
+    /**
+     * @brief 封装格式对应的文件扩展名 (不含 "."): 两种 MP4 为 "mp4"，MPEG-TS 为 "ts"。
+     */
+    static QString fileSuffix(ContainerFormat format);
+
+    /**
+     * @brief 设置流式封装格式的刷新周期，从下一次 `startRecording()` 开始生效。
+     * @param milliseconds 关键帧间隔和数据落盘的周期 (毫秒)，小于等于0时忽略。默认为 DEFAULT_FLUSH_INTERVAL_MS。
+     *
+     * 周期越短，意外断电时丢失的画面越少，但关键帧更密 (文件变大) 且 `fdatasync()` 更频繁。
+     * 普通 MP4 不使用此设置。
+     */
+    void setFlushInterval(int milliseconds);
+
+    /**
+     * @brief 设置 H.264 编码器的候选顺序 (FFmpeg 编码器名称)，从下一次 `startRecording()` 开始生效。
+     * @param names 例如 {"h264_v4l2m2m", "libx264"}；为空时恢复默认顺序，见 `EncoderBackend::defaultPreference()`。
+     */
+    void setEncoderPreference(const QStringList &names);
+
+    /**
+     * @brief 设置软件编码器 (libx264) 的预设和线程数，从下一次 `startRecording()` 开始生效。硬件编码器忽略这两项。
+     * @param preset 例如 "ultrafast"、"veryfast"，为空时使用 "ultrafast"。
+     * @param threads 编码线程数，0 表示跟随 CPU 核数。
+     */
+    void setSoftwareEncoderOptions(const QString &preset, int threads);
+
+    /**
+     * @brief 获取最近一次录制实际使用的编码器名称 (例如 "h264_v4l2m2m" 或 "libx264")，尚未录制过时为空。
+     */
+    QString encoderName() const;
+
+    /**
+     * @brief 最近一次录制打开编码器后上下文的 `thread_count` (例如 libx264 实际创建的编码线程数)，尚未录制过时为0。
+     */
+    int encoderThreads() const;
+
+    /**
+     * @brief 注册一个已编码数据包的消费者，之后编码器输出的每个数据包都会在录制线程中回调其 `consumePacket()`。
+     * @param sink 消费者指针，调用者负责其生命周期 (销毁前需调用 `removePacketSink()`)。
+     *
+     * 编码器已打开时 (录制或待命期间注册) 立即以当前编码参数回调 `streamStarted()`。
+     * 只有录制会话 (普通录制或待命录制) 期间编码器才工作，需要持续推流的调用者应使用待命录制。
+     * 有消费者注册时静止画面不再降低编码帧率 (`setIdleFrameDivisor()`)，远程观看保持全帧率。
+     */
+    void addPacketSink(PacketSink *sink);
+
+    /**
+     * @brief 注销一个数据包消费者。返回后保证不会再回调该消费者。
+     */
+    void removePacketSink(PacketSink *sink);
+
+    /**
+     * @brief 请求尽快编码一个 IDR 帧 (例如新的远程观看者连接)。线程安全，多次请求合并为一次。
+     */
+    void requestKeyFrame();
+
 signals:
     /**
      * @brief 录制过程中发生错误时发出的信号。
@@ -108,80 +443,217 @@ signals:
     void recordError(const QString &errorMsg);
     
     /**
-     * @brief 当启用了自动分段且当前录制时长达到预设的最大值时发出的信号。
-     * @param filePath 当前已完成录制的视频分段的文件路径。
-     *                 接收此信号的对象（如 MonitorPage）通常会调用 `stopRecording()` 
-     *                 结束当前段，然后立即调用 `startRecording()` 开始新的分段。
+     * @brief 自动分段切换到新文件后发出的信号 (在录制线程中发出)。
+     * @param filePath 已写完文件尾并关闭的上一段视频文件路径，接收者可以安全地重命名它。
+     * @param startTime 该段的开始时间。
+     * @param endTime 该段的结束时间 (即新分段的开始时间)。
+     *
+     * 录制不会中断，接收者不需要调用 `stopRecording()` / `startRecording()`。
+     * 最后一段不发出此信号，由 `stopRecording()` 的调用者通过 `getFilePath()` 处理。
+     */
+    void segmentFinished(const QString &filePath, const QDateTime &startTime, const QDateTime &endTime);
+
+    /**
+     * @brief 一个录像文件写完文件尾并关闭后发出 (在录制线程中发出)。
+     * @param filePath 录制线程打开该文件时的路径；停止录制或结束事件时调用者可能已经把它重命名。
+     * @param bytes 文件大小 (字节)。
+     * @param keyFrames 文件中的关键帧数。
+     * @param motion 文件期间是否检测到移动 (未启用移动侦测时为 false)。
+     *
+     * 分段时先于对应的 `segmentFinished()` 发出。出错关闭 (没有写文件尾) 时也发出，bytes 为已写出的字节数。
      */
-    void recordingTimeReached30Minutes(const QString &filePath);
+    void fileClosed(const QString &filePath, qint64 bytes, int keyFrames, bool motion);
+
+    /**
+     * @brief 封装器打开一个新的录像文件后发出 (在录制线程中发出)。到对应的 `fileClosed()` 之前，
+     *        这个文件正在写入，存储清理不能删除它。
+     * @param filePath 文件路径。
+     */
+    void fileOpened(const QString &filePath);
+
+    /**
+     * @brief 封装器写出了新的数据 (在录制线程中发出，每个关键帧和关闭文件时各一次)。
+     * @param bytes 自上次报告以来写入当前文件的字节数。
+     *
+     * `StorageManager` 累计这些字节估算剩余空间，不需要反复 `QStorageInfo::refresh()`。
+     */
+    void bytesWritten(qint64 bytes);
+
+    /**
+     * @brief 移动侦测由静止变为移动时发出 (在录制线程中发出)。
+     */
+    void motionStarted();
+
+    /**
+     * @brief 移动侦测在最后一次移动后保持设定时间仍然静止时发出 (在录制线程中发出)。
+     *
+     * 录制会话结束时不发出此信号；之后的新会话从静止状态开始侦测。
+     */
+    void motionStopped();
+
+    /**
+     * @brief 一次录制会话结束、文件尾已写入、编码器已关闭后发出 (在录制线程中发出)。
+     *
+     * 本对象以排队连接接收它，开始上一次会话收尾期间请求的会话 (`startPendingSession()`)。
+     */
+    void sessionIdle();
 
 protected:
     /**
      * @brief QThread 的核心虚函数，线程启动后会执行此方法中的代码。
      * 
      * 包含一个主循环，该循环负责：
-     * - 从帧队列 `m_frameQueue` 中安全地取出待处理的帧数据。
-     * - 如果队列为空且不在录制状态，则等待下一次 `startRecording()` 或线程退出信号。
-     * - 如果队列为空但在录制状态，则等待新帧的到来。
-     * - 调用 `processFrame()` 对取出的帧进行编码和写入文件。
-     * - 在录制停止或线程退出时，调用 `cleanupRecorder()` 清理FFmpeg资源。
+     * - 从无锁帧队列 `m_frameRing` 中取出待处理的帧槽，调用 `processFrame()` 编码后归还 `m_freeFrames`。
+     * - 停止录制后先编码完队列中剩余的帧，再调用 `cleanupRecorder()` 写入文件尾，状态回到空闲。
+     * - 队列为空时在 `m_frameWaker` 上停放，直到新帧到达、录制状态变化或线程退出。
      */
     void run() override;
 
 private:
-    bool m_isRecording;       ///< 原子布尔标志，指示当前是否正在录制。由 `m_mutex` 保护。
-    bool m_shouldExit;        ///< 原子布尔标志，指示线程是否应准备退出其 `run()` 循环。由 `m_mutex` 保护。
+    /**
+     * @brief 录制状态 (保存在 `m_state` 中)。
+     */
+    enum RecorderState {
+        StateIdle = 0,      ///< 未录制，编码器已关闭。
+        StateRecording = 1, ///< 正在录制，采集线程向队列送帧。
+        StateStopping = 2   ///< 已请求停止，编码线程正在编码剩余的帧并写入文件尾。
+    };
+
+    QAtomicInt m_state;       ///< 录制状态 (RecorderState)。状态转换：startRecording() 空闲->录制，
+                              ///< stopRecording() 录制->停止中，编码线程收尾后 停止中->空闲。
+    QAtomicInt m_shouldExit;  ///< 线程是否应退出其 `run()` 循环 (由析构函数设置)。
+
+    /**
+     * @brief 上一次会话收尾期间请求的会话参数 (`startSession()` 的参数)。
+     */
+    struct PendingSession {
+        QString filePath;
+        int width = 0;
+        int height = 0;
+        AVPixelFormat inputFormat = AV_PIX_FMT_NONE;
+        AVCodecID inputCodec = AV_CODEC_ID_NONE;
+        int frameRate = 0;
+    };
+    bool m_sessionPending;           ///< 有等待收尾结束后开始的会话。由 `m_mutex` 保护。
+    PendingSession m_pendingSession; ///< 等待开始的会话参数。由 `m_mutex` 保护。
     QString m_filePath;       ///< 当前录制会话（或分段）的输出文件完整路径。由 `m_mutex` 保护。
     int m_frameCount;         ///< 当前录制会话（或分段）已成功编码并写入文件的帧数。
     int m_width;              ///< 输入视频帧的宽度 (像素)。在 `startRecording()` 时设置。
     int m_height;             ///< 输入视频帧的高度 (像素)。在 `startRecording()` 时设置。
+    AVPixelFormat m_inputFormat; ///< 输入帧的像素格式 (RGB24 / RGB565LE / YUYV422 / NV12 等)。在 `startRecording()` 时设置。
+    AVCodecID m_inputCodec;      ///< 输入数据的编码方式 (RAWVIDEO 或 MJPEG)。在 `startRecording()` 时设置。
+    int m_frameRate;             ///< 标称帧率，只用于编码器码率控制。在 `startRecording()` 时设置。
+    long long m_firstTimestampUs;///< 本段第一帧的采集时间戳 (微秒)，-1 表示尚未收到帧。显示时间戳相对于它计算。
+    int64_t m_lastPts;           ///< 上一帧的显示时间戳 (1/PTS_CLOCK_RATE 秒)，保证严格递增。
     
     // 线程同步原语
-    mutable QMutex m_mutex;   ///< 互斥锁，用于保护对 `m_isRecording`, `m_shouldExit`, `m_filePath` 等共享状态变量的访问。
-                              ///< `mutable` 允许在const成员函数（如 `isRecording()`）中锁定它。
-    QWaitCondition m_condition;///< 条件变量，与 `m_mutex` 或 `m_queueMutex` 配合使用，
-                              ///< 用于在帧队列为空或等待录制开始/停止时，使线程高效地挂起和被唤醒。
+    mutable QMutex m_mutex;   ///< 互斥锁，保护 `m_filePath`、编码器设置等由GUI线程修改的配置 (不在每帧路径上)。
+                              ///< `mutable` 允许在const成员函数（如 `encoderName()`）中锁定它。
     
     // 帧数据队列相关
     /**
-     * @brief 内部结构体，用于封装一帧原始图像数据及其大小。
-     * 
-     * 当帧数据从主线程传递到录制线程的队列时，会创建此结构的实例。
-     * 构造函数负责分配内存并复制传入的图像数据，确保数据的生命周期
-     * 由 `FrameData` 对象管理。析构函数负责释放分配的内存。
+     * @brief 帧槽中一帧的用途 (延时录制时由采集线程决定)。
+     */
+    enum FrameRole {
+        FrameNormal,      ///< 正常录制的帧。
+        FrameLapseSample, ///< 延时录制的采样帧：编码，但不受自适应控制和静止分频跳过。
+        FrameMotionProbe  ///< 延时录制两次采样之间只做移动侦测的帧，不编码。
+    };
+
+    /**
+     * @brief 内部结构体，一个预分配的帧槽。
+     *
+     * 所有帧槽在 `startRecording()` 中按分辨率和输入格式一次性分配 (`ensureFramePool()`)，
+     * 之后在空闲队列和待编码队列之间循环使用，稳态录制时不再分配或释放内存。
+     * 每个帧槽带一个 YUV420P 的 `AVFrame` (帧池，编码线程处理一帧时采集线程可以转换下一帧)：原始格式输入由采集线程直接转换进去，
+     * MJPEG 输入先把压缩数据复制进 `data`，由编码线程解码、转换。
+     * 偶尔出现大于预估值的帧 (较大的JPEG) 时该帧槽扩容一次。
      */
     struct FrameData {
-        unsigned char *data; ///< 指向存储原始图像数据的缓冲区的指针。
-        int size;            ///< `data` 缓冲区中图像数据的总字节大小。
-        
+        unsigned char *data; ///< 压缩数据 (MJPEG) 的缓冲区，原始格式输入时不使用。
+        int capacity;        ///< `data` 缓冲区的容量 (字节)。
+        int size;            ///< 当前保存的数据字节数 (已转换时为原始帧大小)，0 表示这一帧无效。
+        int stride;          ///< 每行字节数 (MJPEG 无意义)。
+        long long timestampUs; ///< 采集时间戳 (微秒，CLOCK_MONOTONIC)。
+        long long enqueueUs;   ///< 入队时刻 (微秒，CLOCK_MONOTONIC)，用于计量排队时间。
+        AVFrame *frame;        ///< 待编码的 YUV420P 图像 (本帧槽拥有)。编码器可能仍引用上一次的缓冲区，写入前先 `av_frame_make_writable()`。
+        bool converted;        ///< 采集线程已把图像转换进 `frame`；为 false 时 `data` 中是待解码的 MJPEG 数据。
+        FrameRole role;        ///< 这一帧的用途，由采集线程在入队前设置。
+
         /**
-         * @brief FrameData 的构造函数。
-         * @param src 指向要复制的原始图像数据的源缓冲区。
-         * @param s   源图像数据的字节大小。
+         * @brief 分配一个容量为 cap 字节的帧槽 (图像帧由 `ensureFramePool()` 分配)。
          */
-        FrameData(const unsigned char *src, int s) {
-            data = new unsigned char[s]; // 分配新内存
-            memcpy(data, src, s);        // 复制数据
-            size = s;                    // 保存大小
-        }
+        explicit FrameData(int cap) : data(new unsigned char[cap]), capacity(cap), size(0), stride(0), timestampUs(0), enqueueUs(0),
+                                      frame(nullptr), converted(false), role(FrameNormal) {}
+        ~FrameData() { delete[] data; av_frame_free(&frame); }
+
         /**
-         * @brief FrameData 的析构函数。
-         * 负责释放构造函数中为 `data` 分配的内存。
+         * @brief 把一帧数据复制进帧槽，容量不足时先扩容。
+         * @param src 源数据，s 为字节数，st 为每行字节数，ts 为采集时间戳。
          */
-        ~FrameData() {
-            delete[] data; // 释放内存
+        void assign(const unsigned char *src, int s, int st, long long ts) {
+            if (s > capacity) {
+                delete[] data;
+                data = new unsigned char[s];
+                capacity = s;
+            }
+            memcpy(data, src, s);
+            size = s;
+            stride = st;
+            timestampUs = ts;
+            converted = false;
         }
+
+    private:
+        FrameData(const FrameData &) = delete;
+        FrameData &operator=(const FrameData &) = delete;
     };
-    QQueue<FrameData*> m_frameQueue; ///< 存储指向 `FrameData` 对象的指针的队列。
-                                     ///< 这是生产者（`addFrameToQueue()`）和消费者（`run()`）之间的主要数据通道。
-    QMutex m_queueMutex;             ///< 专门用于保护对 `m_frameQueue` 访问的互斥锁。
-    
+    QVector<FrameData*> m_framePool;  ///< 所有帧槽 (拥有所有权)，数量为队列容量 + 1 (编码线程正在处理的一帧)。
+                                      ///< 只在录制状态为空闲时由 `ensureFramePool()` 修改。
+    SpscRing<FrameData*> m_frameRing; ///< 待编码帧队列：采集线程入队 (队列满时可窃取最旧一帧)，编码线程出队。
+    SpscRing<FrameData*> m_freeFrames;///< 空闲帧槽队列：编码线程归还，采集线程取用。
+    EventWaker m_frameWaker;          ///< 编码线程在队列为空时停放于此，新帧到达或状态变化时唤醒。
+    EventWaker m_slotWaker;           ///< BlockCapture 策略下采集线程等待空闲帧槽时停放于此。
+    QAtomicInt m_producerBusy;        ///< 采集线程正在 `addFrameToQueue()` 中时为1，`ensureFramePool()` 等它退出后才重建队列。
+    int m_queueCapacity;              ///< 当前队列容量 (帧)。
+    int m_requestedCapacity;          ///< `setQueueCapacity()` 设置的容量，下一次录制生效。由 `m_mutex` 保护。
+    QAtomicInt m_overflowPolicy;      ///< 队列已满时的处理策略 (OverflowPolicy)。
+    QAtomicInt m_droppedFrames;       ///< 本次录制丢弃的帧数 (只由采集线程累加)。
+    QAtomicInt m_queueHighWater;      ///< 本次录制队列深度的最大值 (只由采集线程更新)。
+    PipelineMetrics m_metrics;        ///< 流水线计量：采集阶段由采集线程记录，其余由录制线程记录。
+
+    static const int DEFAULT_QUEUE_CAPACITY = 8; ///< 默认队列容量 (帧)，30fps 采集时约0.27秒。
+    static const int BLOCK_TIMEOUT_MS = 100;     ///< BlockCapture 策略下采集线程最多等待的时间 (毫秒)。
+    static const int PTS_CLOCK_RATE = 90000;     ///< 编码器和视频流的时间基为 1/90000 秒 (与 MPEG-TS/RTP 一致)，可精确表示任意帧间隔。
+    static const int DEFAULT_FRAME_RATE = 30;    ///< 调用者未给出标称帧率时的默认值 (与 v4l2_params 的默认帧率一致)。
+    static const int DEFAULT_SEGMENT_SECONDS = 30 * 60; ///< 默认自动分段时长 (秒)。
+    static const int DEFAULT_FLUSH_INTERVAL_MS = 2000;  ///< 流式封装格式默认的关键帧/落盘周期 (毫秒)。
+    static const int DEFAULT_PRE_EVENT_SECONDS = 5;     ///< 默认预录时长 (秒)。
+    static const int DEFAULT_PRE_EVENT_BYTES = 4 * 1024 * 1024; ///< 默认预录缓冲区上限 (字节)，800 kbps 时约40秒。
+    static const int DEFAULT_IDLE_FRAME_DIVISOR = 3;    ///< 默认静止时的编码帧率分频 (30fps 降为10fps)。
+    static const int PARALLEL_CONVERT_MIN_PIXELS = 1280 * 720; ///< 每帧像素数不少于该值 (720p 及以上) 时分条带并行转换。
+    static const int LAPSE_GOP_SAMPLES = 30;           ///< 延时录制每多少个采样帧一个关键帧 (未要求全部为 IDR 时)。
+    static const int LAPSE_MAX_GOP_MS = 60000;         ///< 延时录制关键帧间隔的上限 (毫秒)，限制断电时丢失的时长。
+    static const int LAPSE_PROBE_INTERVAL_MS = 1000;   ///< 延时录制时送入移动侦测帧的最大间隔 (毫秒)。
+
     // FFmpeg 相关核心组件的指针
     AVFormatContext *m_formatContext; ///< FFmpeg 封装格式上下文。管理输出文件的格式（如MP4）和I/O操作。
-    AVCodecContext *m_codecContext;   ///< FFmpeg 编码器上下文。管理视频编码器（如H.264）的参数和状态。
-    SwsContext *m_swsContext;         ///< FFmpeg 图像转换上下文。用于将输入的像素格式（如RGB24）转换为编码器所需的格式（如YUV420P）。
-    AVFrame *m_frame;                 ///< FFmpeg AVFrame 对象。用于存储一帧待编码的原始（转换后为YUV）视频数据。
+    EncoderBackend m_encoder;         ///< H.264 编码器后端，负责探测/打开编码器并拥有编码器上下文。
+    QString m_encoderName;            ///< 最近一次录制使用的编码器名称。由 `m_mutex` 保护。
+    QString m_encoderPreset;          ///< 软件编码器的预设，为空时为 "ultrafast"。由 `m_mutex` 保护。
+    int m_encoderThreads;             ///< 软件编码器的线程数，0 表示跟随 CPU 核数。由 `m_mutex` 保护。
+    int m_adaptiveThreads;            ///< 自适应控制建议的线程数下限 (上次会话算力不足时增加)，0 表示不调整。由 `m_mutex` 保护。
+    int m_encoderThreadCount;         ///< 最近一次录制打开的编码器上下文的 `thread_count`。由 `m_mutex` 保护。
+    AVCodecContext *m_codecContext;   ///< FFmpeg 编码器上下文 (指向 `m_encoder` 拥有的上下文，不单独释放)。
+    SwsContext *m_swsContext;         ///< MJPEG 解码输出到 YUV420P 的转换上下文，解码出第一帧、得知解码器输出格式后才创建。
+    QVector<SwsContext *> m_swsSlices; ///< 其它原始格式 (如RGB24) 每个条带一个的 swscale 上下文，采集线程并行使用；
+                                      ///< RGB565 / YUYV / NV12 输入走 pixel_convert 内核，此时为空。
+    bool m_sessionProducerConvert;    ///< 本次会话由采集线程转换 (原始格式输入)。会话开始时设置，采集线程只读。
+    int m_convertSlices;              ///< 本次会话每帧转换拆分的条带数 (每条行数为偶数)，1 表示不拆分。
     AVPacket *m_packet;               ///< FFmpeg AVPacket 对象。用于存储一帧编码后的压缩视频数据。
+    AVCodecContext *m_decoderContext; ///< MJPEG 输入时的 JPEG 解码器上下文；其它输入为 nullptr。
+    AVFrame *m_decodedFrame;          ///< MJPEG 解码输出帧 (通常为 YUVJ422P/YUVJ420P)。
+    AVPacket *m_decodePacket;         ///< 指向队列中JPEG数据的解码输入包 (不拥有数据)。
     
     // 帧率和录制时间统计相关 (用于调试或信息显示)
     std::chrono::steady_clock::time_point m_startTime;    ///< 当前录制会话（或分段）的开始精确时间点。
@@ -190,9 +662,83 @@ private:
     double m_totalTime;     ///< 在一次完整的录制调用中，从第一帧到最后一帧处理所花费的总时间（秒）。
     
     // 视频自动分段功能相关
-    QTimer *m_segmentTimer;        ///< QTimer 对象，当启用自动分段时，用于定时触发分段信号。
-    bool m_autoSegmentation;       ///< 布尔标志，指示是否启用视频自动分段功能。
-    int m_maxRecordingMinutes;     ///< 自动分段的最大时长（单位：分钟）。
+    bool m_autoSegmentation;       ///< 布尔标志，指示是否启用视频自动分段功能。由 `m_mutex` 保护。
+    int m_segmentSeconds;          ///< 自动分段的时长（单位：秒）。由 `m_mutex` 保护。
+    QDateTime m_segmentStartTime;  ///< 当前分段的开始时间 (用于文件命名)。由 `m_mutex` 保护。
+    int64_t m_segmentLengthPts;    ///< 本次录制的分段时长 (1/PTS_CLOCK_RATE 秒)，0 表示不分段。只在录制线程中使用。
+    int64_t m_segmentStartPts;     ///< 当前分段第一帧的显示时间戳 (编码器时间基)。
+    int64_t m_rotatePts;           ///< 已强制为 IDR 的那一帧的显示时间戳；从不早于它的第一个关键帧包开始写入新文件。
+    bool m_rotatePending;          ///< 已到达分段时长，等待关键帧包以切换文件。
+    int64_t m_muxerTsOffset;       ///< 写入当前文件时从包时间戳中减去的偏移 (编码器时间基)，使每个文件从0开始。
+
+    // 封装格式相关
+    ContainerFormat m_containerFormat; ///< `setContainerFormat()` 设置的封装格式，下一次录制生效。由 `m_mutex` 保护。
+    int m_flushIntervalMs;         ///< `setFlushInterval()` 设置的刷新周期 (毫秒)。由 `m_mutex` 保护。
+    ContainerFormat m_sessionContainer; ///< 本次录制使用的封装格式 (`startRecording()` 时复制，录制线程只读)。
+    int64_t m_flushIntervalPts;    ///< 本次录制的刷新周期 (1/PTS_CLOCK_RATE 秒)，普通 MP4 为0。
+    int64_t m_lastFlushPts;        ///< 上一次落盘时数据包的显示时间戳 (编码器时间基)。
+    BufferedFileWriter m_fileWriter; ///< 当前文件的后写缓冲区和I/O线程，会话开始时启动、`cleanupRecorder()` 中停止。
+    QString m_muxerPath;           ///< 当前封装器打开的文件路径 (`fileClosed()` 报告)。只在录制线程中访问。
+    int m_fileKeyFrames;           ///< 当前文件已写入的关键帧数。只在录制线程中访问。
+    KeyFrameIndex m_fileIndex;     ///< 当前文件的关键帧索引，关闭文件时保存。只在录制线程中访问。
+    bool m_fileMotion;             ///< 当前文件期间是否检测到移动。只在录制线程中访问。
+    int64_t m_reportedBytes;       ///< 当前文件已通过 `bytesWritten()` 报告的字节数 (输出位置)。只在录制线程中访问。
+
+    // 待命录制 (预录缓冲区) 相关
+    bool m_standby;                ///< 本次录制为待命录制 (只在事件期间写文件)。由 `m_mutex` 保护，录制线程在会话期间只读。
+    int m_preEventSeconds;         ///< `setPreEventBuffer()` 设置的预录时长 (秒)。由 `m_mutex` 保护。
+    int m_preEventBytes;           ///< `setPreEventBuffer()` 设置的缓冲区上限 (字节)。由 `m_mutex` 保护。
+    PacketRing m_preEventRing;     ///< 预录缓冲区，只在录制线程中访问。
+    bool m_eventOpenPending;       ///< 已 `beginEvent()`，录制线程尚未打开事件文件。由 `m_mutex` 保护。
+    bool m_eventFileOpen;          ///< 事件文件已打开且尚未 `endEvent()`。由 `m_mutex` 保护。
+    bool m_eventClosePending;      ///< `endEvent()` 已请求关闭事件文件。由 `m_mutex` 保护。
+    QAtomicInt m_eventRequests;    ///< 有待处理的事件请求时为1，录制线程每个数据包只读取这一个原子变量。
+    bool m_forceKeyFrame;          ///< 下一帧强制编码为 IDR (事件开始时缓冲区为空)。只在录制线程中访问。
+
+    // 移动侦测相关
+    bool m_motionEnabled;          ///< `setMotionDetection()` 设置的开关，下一次会话生效。由 `m_mutex` 保护。
+    MotionDetector::Settings m_motionSettings; ///< `setMotionDetection()` 设置的侦测参数。由 `m_mutex` 保护。
+    int m_idleFrameDivisor;        ///< `setIdleFrameDivisor()` 设置的分频。由 `m_mutex` 保护。
+    bool m_sessionMotion;          ///< 本次会话是否做移动侦测 (会话开始时复制，录制线程只读)。
+    int m_sessionIdleDivisor;      ///< 本次会话静止时的编码帧率分频 (会话开始时复制，录制线程只读)。
+    int m_idleFrameCounter;        ///< 静止期间的帧计数，用于分频。只在录制线程中访问。
+
+    // 数据包分发相关
+    PacketFanout m_packetFanout;   ///< 主码流数据包的分发器 (消费者列表和编码参数)。
+    QAtomicInt m_keyFrameRequested; ///< `requestKeyFrame()` 设置，录制线程在下一帧消费。
+
+    // 子码流相关
+    bool m_substreamEnabled;       ///< `setSubstream()` 设置的开关，下一次会话生效。由 `m_mutex` 保护。
+    SubstreamEncoder::Settings m_substreamSettings; ///< `setSubstream()` 设置的参数。由 `m_mutex` 保护。
+    SubstreamEncoder m_substream;  ///< 子码流编码器，在会话开始时启动、`cleanupRecorder()` 中停止。
+
+    // 编码自适应控制相关
+    bool m_adaptiveEnabled;        ///< `setAdaptiveRateControl()` 设置的开关，下一次会话生效。由 `m_mutex` 保护。
+    RateController::Settings m_adaptiveSettings; ///< `setAdaptiveRateControl()` 设置的参数。由 `m_mutex` 保护。
+    bool m_sessionAdaptive;        ///< 本次会话是否做自适应控制 (会话开始时复制，录制线程只读)。
+    RateController m_rateController; ///< 自适应控制器，会话开始时配置，之后只在录制线程中访问。
+    int64_t m_sessionGopPts;       ///< 本次会话正常画面的关键帧间隔 (1/PTS_CLOCK_RATE 秒)，0 表示由编码器决定。
+    int64_t m_lastKeyPts;          ///< 最近一个关键帧 (强制或编码器自己插入) 的显示时间戳。只在录制线程中访问。
+    int m_sessionEncoderThreads;   ///< 本次会话软件编码器按指定值打开的线程数 (`EncoderBackend::threadCount()`)，不能由自适应控制增加时为0。只在录制线程中访问。
+
+    // 录制帧率相关
+    int m_recordFrameRate;         ///< `setRecordFrameRate()` 设置的录制帧率，0 表示不限。由 `m_mutex` 保护。
+    long long m_sessionFrameIntervalUs; ///< 本次会话的录制帧间隔 (微秒)，0 表示录制每一帧 (会话开始时设置，采集线程只读)。
+    long long m_nextFrameUs;       ///< 下一帧录制的最早采集时间戳 (微秒)，-1 表示下一帧直接录制。只在采集线程 (生产者) 中访问。
+
+    // 延时录制相关
+    bool m_timeLapseEnabled;       ///< `setTimeLapse()` 设置的开关，下一次会话生效。由 `m_mutex` 保护。
+    TimeLapseSettings m_timeLapseSettings; ///< `setTimeLapse()` 设置的参数。由 `m_mutex` 保护。
+    long long m_sessionLapseIntervalUs; ///< 本次会话的采样间隔 (微秒)，0 表示不做延时录制 (会话开始时设置，采集线程只读)。
+    long long m_sessionLapseProbeUs; ///< 本次会话采样期间送入帧的间隔 (微秒)：需要移动侦测时不超过 LAPSE_PROBE_INTERVAL_MS，否则等于采样间隔。
+    bool m_sessionLapseMotionSwitch; ///< 本次会话移动期间恢复全帧率 (会话开始时设置，采集线程只读)。
+    bool m_sessionLapseIntraOnly;  ///< 本次会话每个采样帧都为 IDR (会话开始时设置，录制线程只读)。
+    int64_t m_sessionLapseGopPts;  ///< 本次会话采样帧的关键帧间隔 (1/PTS_CLOCK_RATE 秒)。
+    long long m_nextSampleUs;      ///< 下一个采样帧的最早采集时间戳 (微秒)，-1 表示下一帧直接采样。只在采集线程中访问。
+    bool m_producerFullRate;       ///< 采集线程当前按全帧率送帧 (移动中)。只在采集线程中访问。
+    bool m_lastFrameSampled;       ///< 上一个编码的帧是采样帧，切换到全帧率时强制 IDR。只在录制线程中访问。
+    MotionDetector m_motionDetector; ///< 移动侦测器，只在录制线程中访问。
+    QAtomicInt m_motionActive;     ///< 移动侦测当前是否为 "移动中" (录制线程写，其它线程读)。
     mutable QMutex m_formatContextMutex; ///< 保护对m_formatContext的并发写入，主要用于av_interleaved_write_frame。
     
     // 私有辅助方法
@@ -210,15 +756,142 @@ private:
      * 包括刷新编码器、写入文件尾、关闭文件、释放各种上下文、帧和包。
      */
     void cleanupRecorder();
+
+    /**
+     * @brief 为已打开的编码器创建封装器：分配输出上下文、创建视频流、打开文件并写入文件头。
+     * @param filePath 输出文件路径，封装格式为本次录制的 `m_sessionContainer`。
+     * @param errorMsg 失败时输出错误描述。
+     * @return 成功返回 true；失败时已释放本次分配的封装器资源。
+     */
+    bool openMuxer(const QString &filePath, QString *errorMsg);
+
+    /**
+     * @brief 开始录制会话的公共实现。
+     * @param filePath 输出文件路径；为空时为待命录制，不打开文件。
+     */
+    bool startSession(const QString &filePath, int width, int height,
+                      AVPixelFormat inputFormat, AVCodecID inputCodec, int frameRate);
+
+    /**
+     * @brief 录制线程回到空闲后 (`sessionIdle()` 的排队连接) 开始等待中的会话。没有或已取消时不执行任何操作。
+     */
+    void startPendingSession();
+
+    /**
+     * @brief 待命录制：处理 `beginEvent()` / `endEvent()` 的请求 (在录制线程中、写入 `m_packet` 之前调用)。
+     * @return 事件文件打开或预录数据写入失败时返回 false (已通过 `recordError` 报告)。
+     *
+     * 关闭请求先于打开请求处理。打开事件文件时依次写入缓冲区中的全部数据包，文件时间戳从最旧的关键帧开始；
+     * 缓冲区为空且当前包不是关键帧时继续等待，并请求下一帧强制编码为 IDR。
+     */
+    bool handleEventRequests();
+
+    /**
+     * @brief 把一个编码器时间基的数据包写入当前文件：减去文件时间零点、换算到流时间基、写入，
+     *        流式封装时在关键帧处落盘。写入后释放 packet 的数据引用。
+     */
+    bool writePacket(AVPacket *packet);
+
+    /**
+     * @brief 流式封装：把封装器缓冲的数据交给I/O线程写入文件并 `fdatasync()` 到存储介质 (在录制线程中调用，不等待)。
+     * @param pts 触发刷新的数据包的显示时间戳 (编码器时间基)，作为下一个刷新周期的起点。
+     */
+    void flushOutput(int64_t pts);
+
+    /**
+     * @brief 通过 `bytesWritten()` 报告当前文件自上次报告以来新写出的字节数 (在录制线程中调用)。
+     */
+    void reportWrittenBytes();
+
+    /**
+     * @brief 应用自适应控制器新的决定：修改编码器码率，退出低运动模式时请求下一帧为 IDR (在录制线程中调用)。
+     * @param wasLowMotion 本次 `RateController::update()` 之前是否处于低运动模式。
+     */
+    void applyRateDecision(bool wasLowMotion);
+
+    /**
+     * @brief 写入文件尾 (可选) 并关闭、释放当前封装器。编码器保持打开。
+     * @param writeTrailer 为 true 时先调用 `av_write_trailer()`。
+     */
+    void closeMuxer(bool writeTrailer);
+
+    /**
+     * @brief 自动分段：关闭当前文件，从当前关键帧包开始写入新文件 (在录制线程中调用)。
+     * @return 新文件打开失败时返回 false (已通过 `recordError` 报告)。
+     *
+     * 录制已处于停止中时不切换，剩余的帧继续写入当前文件。
+     */
+    bool rotateSegment();
+
+    /**
+     * @brief 生成下一个分段的文件路径：与当前文件同一目录，文件名为 record_HHmmss + 原扩展名。
+     * @param now 新分段的开始时间。
+     *
+     * 录像目录按日期组织 (<根目录>/yyyyMMdd[/camN])，跨过零点时新分段放进新日期的目录。
+     */
+    QString nextSegmentPath(const QDateTime &now) const;
     
     /**
      * @brief 处理（编码并写入）单帧视频数据。
      * @param frameData 指向包含原始RGB图像数据的 `FrameData` 对象的指针。
      *                  函数处理完后不会释放 `frameData`，调用者（`run()`）负责。
+     * @return 编码并写入成功返回 true；否则返回 false。
      * 
-     * 此方法执行颜色空间转换 (RGB -> YUV)，设置帧时间戳，然后调用 `encodeFrame()`。
+     * 原始格式输入已由采集线程转换好；MJPEG 输入在这里解码并转换到帧槽的 `frame`。然后把图像提交给子码流，启用移动侦测时分析转换后的 Y 平面 (静止时可能跳过编码)，
+     * 设置帧时间戳，然后调用 `encodeFrame()`。
+     */
+    bool processFrame(FrameData *frameData);
+
+    /**
+     * @brief 按队列容量和单帧大小准备帧槽和两个队列 (在 `startRecording()` 中、录制状态为空闲时调用)。
+     * @param frameBytes 每个帧槽 `data` 缓冲区的字节数 (只有 MJPEG 输入需要，原始格式输入为0)。
+     * @param width 图像宽度，帧槽的 YUV420P 帧按此分配。
+     * @param height 图像高度。
+     * @return 图像帧分配失败时返回 false。
+     *
+     * 帧槽只增不减：数量不足时补齐，容量不足的缓冲区和尺寸不同的图像帧重新分配。
+     * 此时编码线程已收尾 (所有帧槽都已归还)，等采集线程离开 `addFrameToQueue()` 后即可安全重建队列。
+     */
+    bool ensureFramePool(int frameBytes, int width, int height);
+
+    /**
+     * @brief 采集线程：把一帧原始图像转换为帧槽中的 YUV420P 图像，`m_convertSlices` 大于1时分条带在 `SlicePool` 上并行。
+     * @param slot 采集线程刚取到的帧槽。
+     * @param src 原始图像 (V4L2 缓冲区)，stride 为每行字节数。
+     * @return 帧槽的图像帧无法写入时返回 false。
+     */
+    bool convertIntoFrame(FrameData *slot, const unsigned char *src, int stride);
+
+    /**
+     * @brief 第 slice 个条带的起始行和行数 (起始行为偶数，色度平面按一半行数对齐)。
+     */
+    void sliceRows(int slice, int *firstRow, int *rows) const;
+
+    /**
+     * @brief 编码线程处理完一帧后归还帧槽，并唤醒等待空闲帧槽的采集线程 (仅当它已停放)。
+     */
+    void releaseFrame(FrameData *frameData);
+
+    /**
+     * @brief 采集线程：队列未满时取一个空闲帧槽。
+     *
+     * 帧槽比队列容量多一个 (留给编码线程正在处理的帧)，因此必须先确认队列有空位，
+     * 否则第 capacity + 1 个帧槽会在编码线程取帧之前被取走，无法入队。
+     * @return 取到帧槽返回 true。
+     */
+    bool takeFreeFrame(FrameData *&slot);
+
+    /**
+     * @brief 编码线程：队列已取空且录制已停止时写入文件尾、释放编码器，状态回到空闲。
+     */
+    void finishSession();
+
+    /**
+     * @brief 解码一帧 MJPEG 数据并缩放/转换到帧槽的 `frame` (YUV420P)。
+     * @param frameData 包含一张完整JPEG图像的 `FrameData`。
+     * @return 成功返回 true；数据损坏 (USB 摄像头偶发) 时返回 false，调用者跳过该帧。
      */
-    void processFrame(const FrameData *frameData); // 改为 FrameData* 以避免不必要的拷贝，但注意生命周期管理
+    bool decodeMjpegFrame(FrameData *frameData);
     
     /**
      * @brief 将准备好的 AVFrame（包含YUV数据）发送给编码器，并处理输出的 AVPacket。
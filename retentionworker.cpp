@@ -0,0 +1,263 @@
+/**
+ * @file retentionworker.cpp
+ * @brief 录像淘汰线程 (RetentionWorker) 的实现文件。
+ *
+ * 每次只删除一个文件并在两次删除之间休眠：TF卡上删除一个几百MB的文件需要更新大量的分配表/位图，
+ * 连续删除一整天的文件时录制线程的写入会被长时间阻塞。
+ */
+
+#include "retentionworker.h"
+#include "recordingcatalog.h"
+#include "camerachannel.h"    // CameraChannel::thumbnailPath()
+#include "keyframeindex.h"    // KeyFrameIndex::indexPath()
+
+#include <QMutexLocker>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDebug>
+
+RetentionWorker::RetentionWorker(RecordingCatalog *catalog, QObject *parent)
+    : QThread(parent)
+    , m_catalog(catalog)
+    , m_requestedBytes(0)
+    , m_hasRequest(false)
+    , m_rescanRequested(false)
+    , m_stopRequested(false)
+    , m_bytesPerSecond(DEFAULT_BYTES_PER_SECOND)
+    , m_busy(0)
+{
+}
+
+RetentionWorker::~RetentionWorker()
+{
+    stopWorker();
+}
+
+void RetentionWorker::startWorker()
+{
+    if (isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = false;
+    }
+    start(QThread::LowPriority);
+}
+
+void RetentionWorker::stopWorker()
+{
+    if (!isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_condition.wakeOne();
+    }
+    wait();
+}
+
+void RetentionWorker::requestEviction(qint64 bytes)
+{
+    if (bytes <= 0) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_requestedBytes = bytes;
+    m_hasRequest = true;
+    m_busy.storeRelease(1);
+    m_condition.wakeOne();
+}
+
+void RetentionWorker::requestRescan()
+{
+    QMutexLocker locker(&m_mutex);
+    m_rescanRequested = true;
+    m_condition.wakeOne();
+}
+
+void RetentionWorker::setFileActive(const QString &filePath, bool active)
+{
+    const QString path = normalizedPath(filePath);
+    QMutexLocker locker(&m_mutex);
+    if (active) {
+        m_activeFiles.insert(path);
+    } else {
+        m_activeFiles.remove(path);
+    }
+}
+
+bool RetentionWorker::hasActiveFileUnder(const QString &dirPath) const
+{
+    const QString prefix = normalizedPath(dirPath) + "/";
+    QMutexLocker locker(&m_mutex);
+    for (const QString &path : m_activeFiles) {
+        if (path.startsWith(prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RetentionWorker::setRateLimit(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_bytesPerSecond = bytesPerSecond;
+}
+
+void RetentionWorker::run()
+{
+    forever {
+        qint64 remaining = 0;
+        bool rescan = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stopRequested && !m_hasRequest && !m_rescanRequested) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_stopRequested) {
+                break;
+            }
+            if (m_hasRequest) {
+                remaining = m_requestedBytes;
+                m_hasRequest = false;
+            } else {
+                rescan = true; // 淘汰请求优先，扫描留到没有淘汰请求时
+                m_rescanRequested = false;
+            }
+        }
+
+        if (rescan) {
+            // 录制已经开始：不登记 record_* 文件 (断电前未关闭的已由打开时的恢复扫描登记)
+            QElapsedTimer timer;
+            timer.start();
+            const int changes = m_catalog->rescan(QString(), false);
+            qInfo() << "RetentionWorker: 扫描整个存储目录用时" << timer.elapsed() << "ms，修正" << changes << "条索引记录";
+            continue;
+        }
+
+        qint64 freed = 0;
+        bool targetMet = false;
+        forever {
+            {
+                // 期间的新请求以调用者最新的计算为准 (已计入到目前为止释放的空间)
+                QMutexLocker locker(&m_mutex);
+                if (m_stopRequested) {
+                    break;
+                }
+                if (m_hasRequest) {
+                    remaining = m_requestedBytes;
+                    m_hasRequest = false;
+                }
+            }
+            if (remaining <= 0) {
+                targetMet = true;
+                break;
+            }
+            qint64 bytes = 0;
+            if (!evictOldest(&bytes)) {
+                qWarning() << "RetentionWorker: 没有可以删除的录像了，仍需释放" << remaining / (1024.0 * 1024.0) << "MB";
+                break;
+            }
+            freed += bytes;
+            remaining -= bytes;
+
+            // 按删除的字节数限速 (删除大文件时文件系统要更新的元数据更多)
+            qint64 bytesPerSecond = 0;
+            {
+                QMutexLocker locker(&m_mutex);
+                bytesPerSecond = m_bytesPerSecond;
+            }
+            qint64 pauseMs = bytesPerSecond > 0 ? bytes * 1000 / bytesPerSecond : 0;
+            pauseMs = qBound<qint64>(MIN_PAUSE_MS, pauseMs, MAX_PAUSE_MS);
+            if (!pause(static_cast<int>(pauseMs))) {
+                break;
+            }
+        }
+
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_hasRequest) {
+                m_busy.storeRelease(0);
+            }
+        }
+        qInfo() << "RetentionWorker: 本次删除" << freed / (1024.0 * 1024.0) << "MB" << (targetMet ? "" : "(未达到目标)");
+        emit evictionFinished(freed, targetMet);
+    }
+    m_busy.storeRelease(0);
+}
+
+bool RetentionWorker::evictOldest(qint64 *bytes)
+{
+    QString day;
+    const QVector<RecordingCatalog::Entry> entries = m_catalog->oldestDayEntries(&day);
+    if (day.isEmpty()) {
+        return false;
+    }
+    const QString dayPath = m_catalog->rootPath() + "/" + day;
+    for (const RecordingCatalog::Entry &entry : entries) {
+        const QString filePath = m_catalog->absolutePath(entry);
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_activeFiles.contains(normalizedPath(filePath))) {
+                continue; // 正在写入
+            }
+        }
+        QFile file(filePath);
+        if (file.exists() && !file.remove()) {
+            // 去掉索引记录，之后从更新的文件继续删除，不会一直卡在这个文件上
+            qWarning() << "RetentionWorker: 无法删除" << filePath << file.errorString();
+            m_catalog->removePath(filePath);
+            continue;
+        }
+        QFile::remove(CameraChannel::thumbnailPath(filePath));
+        QFile::remove(KeyFrameIndex::indexPath(filePath));
+        m_catalog->removePath(filePath);
+        *bytes = entry.bytes;
+        emit fileEvicted(filePath, entry.bytes);
+        removeDayIfEmpty(dayPath);
+        return true;
+    }
+
+    // 最早一天只剩下正在写入的文件 (只有一天的录像)：没有可以删除的了
+    return false;
+}
+
+void RetentionWorker::removeDayIfEmpty(const QString &dayPath)
+{
+    QStringList subdirs;
+    QVector<RecordingCatalog::Entry> entries;
+    m_catalog->listDir(dayPath, &subdirs, &entries);
+    if (!subdirs.isEmpty() || !entries.isEmpty() || hasActiveFileUnder(dayPath)) {
+        return;
+    }
+    // 只剩缩略图目录、空的 camN 目录和未登记的文件 (很小)
+    QDir dir(dayPath);
+    if (dir.removeRecursively()) {
+        qInfo() << "RetentionWorker: 已删除日期目录" << dayPath;
+    }
+}
+
+bool RetentionWorker::pause(int ms)
+{
+    // 新请求也会唤醒条件变量，睡够时间才返回，限速不受请求频率影响
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopRequested) {
+        const qint64 left = ms - timer.elapsed();
+        if (left <= 0) {
+            break;
+        }
+        m_condition.wait(&m_mutex, static_cast<unsigned long>(left));
+    }
+    return !m_stopRequested;
+}
+
+QString RetentionWorker::normalizedPath(const QString &path)
+{
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
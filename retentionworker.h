@@ -0,0 +1,149 @@
+#ifndef RETENTIONWORKER_H
+#define RETENTIONWORKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
+#include <QString>
+#include <QAtomicInt>
+
+class RecordingCatalog;
+
+/**
+ * @brief 录像淘汰线程 (RetentionWorker)
+ *
+ * 由 `StorageManager` 拥有，在自己的低优先级线程中按开始时间从最早的录像文件开始逐个删除，
+ * 直到释放的字节数达到请求的目标，而不是在GUI线程中一次删除一整天的目录：
+ * - 待删除的文件取自录像索引 (`RecordingCatalog::oldestDayEntries()`)，不遍历目录；
+ *   删除后同时删除缩略图并从索引中去掉，一天的录像删完后再删掉这一天剩下的目录 (缩略图目录、空的 camN 目录)。
+ * - 正在写入的文件 (`setFileActive()`) 永远不会被删除，包含正在写入的文件的日期目录也不会被整体删除。
+ * - 每删除一个文件后按文件大小休眠 (`setRateLimit()`)，TF卡的元数据更新不会挤占录制线程的写入。
+ * - `requestEviction()` 可以在任何线程调用，线程忙时只更新目标，不排队。
+ * - 上次没有正常关闭时，`requestRescan()` 在这个线程中扫描整个根目录 (`RecordingCatalog::rescan()`)，
+ *   在录制开始后进行，不阻塞启动；有淘汰请求时先淘汰。
+ */
+class RetentionWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param catalog 录像索引 (线程安全)，必须在本对象停止之前一直有效。
+     * @param parent 父对象指针
+     */
+    explicit RetentionWorker(RecordingCatalog *catalog, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止线程。
+     */
+    ~RetentionWorker();
+
+    /**
+     * @brief 启动淘汰线程 (低优先级)。已启动时无副作用。
+     */
+    void startWorker();
+
+    /**
+     * @brief 停止淘汰线程，正在删除的文件删完后返回。
+     */
+    void stopWorker();
+
+    /**
+     * @brief 请求 (再) 释放至少 bytes 字节。线程忙时以最新的请求为准。线程安全。
+     * @param bytes 需要释放的字节数 (调用者按当前剩余空间计算)，小于等于0时忽略。
+     */
+    void requestEviction(qint64 bytes);
+
+    /**
+     * @brief 请求在淘汰线程中扫描一次整个根目录，补上索引中缺少的文件 (不登记正在写入的 record_* 文件)。线程安全。
+     */
+    void requestRescan();
+
+    /**
+     * @brief 是否有尚未完成的淘汰请求。线程安全。
+     */
+    bool isBusy() const { return m_busy.loadAcquire() != 0; }
+
+    /**
+     * @brief 标记一个文件正在写入 (active 为 true) 或已关闭。正在写入的文件不会被删除。线程安全。
+     * @param filePath 文件的绝对路径。
+     */
+    void setFileActive(const QString &filePath, bool active);
+
+    /**
+     * @brief 目录 (及其子目录) 下是否有正在写入的文件。线程安全。
+     */
+    bool hasActiveFileUnder(const QString &dirPath) const;
+
+    /**
+     * @brief 设置删除速率上限：每删除一个文件后休眠 文件大小 / bytesPerSecond 秒 (至少 MIN_PAUSE_MS 毫秒)。
+     * @param bytesPerSecond 每秒最多删除的录像字节数，小于等于0时只保留最小间隔。默认为 DEFAULT_BYTES_PER_SECOND。
+     */
+    void setRateLimit(qint64 bytesPerSecond);
+
+signals:
+    /**
+     * @brief 删除了一个录像文件 (在淘汰线程中发出)。
+     * @param filePath 被删除文件的绝对路径。
+     * @param bytes 文件大小 (字节，取自索引)。
+     */
+    void fileEvicted(const QString &filePath, qint64 bytes);
+
+    /**
+     * @brief 一次淘汰结束 (在淘汰线程中发出)。
+     * @param freedBytes 本次删除的录像字节数。
+     * @param targetMet 是否达到了请求的目标；为 false 时已没有可以删除的录像。
+     */
+    void evictionFinished(qint64 freedBytes, bool targetMet);
+
+protected:
+    /**
+     * @brief 线程主循环：等待请求，然后逐个删除最早的录像文件直到达到目标；没有淘汰请求时进行扫描请求。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 删除一个最早的、不在写入中的录像文件 (无法删除的文件从索引中去掉，不再尝试)。
+     * @param bytes 输出删除的字节数。
+     * @return 没有可以删除的文件时返回 false。
+     */
+    bool evictOldest(qint64 *bytes);
+
+    /**
+     * @brief 一天的录像都已删除 (且没有正在写入的文件) 时删除这一天剩下的目录。
+     */
+    void removeDayIfEmpty(const QString &dayPath);
+
+    /**
+     * @brief 可被 `stopWorker()` 打断的休眠。
+     * @return 收到停止请求时返回 false。
+     */
+    bool pause(int ms);
+
+    /**
+     * @brief 规范化的绝对路径，用于比较正在写入的文件。
+     */
+    static QString normalizedPath(const QString &path);
+
+    static const qint64 DEFAULT_BYTES_PER_SECOND = 32 * 1024 * 1024; ///< 默认删除速率上限 (字节/秒)。
+    static const int MIN_PAUSE_MS = 50;    ///< 两次删除之间的最小间隔 (毫秒)。
+    static const int MAX_PAUSE_MS = 1000;  ///< 两次删除之间的最大间隔 (毫秒)，很大的文件也不让淘汰停顿太久。
+
+    RecordingCatalog *m_catalog;   ///< 录像索引。
+
+    mutable QMutex m_mutex;        ///< 保护以下成员。
+    QWaitCondition m_condition;    ///< 有新请求或停止时唤醒线程。
+    qint64 m_requestedBytes;       ///< 最新请求释放的字节数。
+    bool m_hasRequest;             ///< 有尚未取走的请求。
+    bool m_rescanRequested;        ///< 有尚未进行的扫描请求。
+    bool m_stopRequested;          ///< 停止请求。
+    QSet<QString> m_activeFiles;   ///< 正在写入的文件 (规范化的绝对路径)。
+    qint64 m_bytesPerSecond;       ///< 删除速率上限 (字节/秒)。
+
+    QAtomicInt m_busy;             ///< 有请求未完成时为1。
+};
+
+#endif // RETENTIONWORKER_H
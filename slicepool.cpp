@@ -0,0 +1,105 @@
+/**
+ * @file slicepool.cpp
+ * @brief 分片并行线程池 (SlicePool) 的实现文件。
+ */
+
+#include "slicepool.h"
+
+#include <QMutexLocker>
+
+SlicePool *SlicePool::instance()
+{
+    // 局部静态对象的初始化是线程安全的；程序退出时析构，等工作线程退出
+    static SlicePool pool(qBound(0, QThread::idealThreadCount() - 1, MAX_WORKERS));
+    return &pool;
+}
+
+SlicePool::SlicePool(int workers)
+    : m_exit(false)
+{
+    for (int i = 0; i < workers; ++i) {
+        Worker *worker = new Worker(this);
+        m_workers.append(worker);
+        worker->start();
+    }
+}
+
+SlicePool::~SlicePool()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_exit = true;
+    }
+    m_jobAvailable.wakeAll();
+    for (Worker *worker : m_workers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+int SlicePool::drain(Job *job)
+{
+    int finished = 0;
+    for (int i = job->next.fetchAndAddRelaxed(1); i < job->count; i = job->next.fetchAndAddRelaxed(1)) {
+        (*job->task)(i);
+        ++finished;
+    }
+    return finished;
+}
+
+void SlicePool::run(int count, const std::function<void(int)> &task)
+{
+    if (count <= 1 || m_workers.isEmpty()) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    Job job;
+    job.task = &task;
+    job.count = count;
+    job.next.store(0);
+    job.done = 0;
+    job.users = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_jobs.append(&job);
+    }
+    m_jobAvailable.wakeAll();
+
+    // 调用线程自己领取分片，工作线程都在忙时也能独自完成
+    const int finished = drain(&job);
+
+    QMutexLocker locker(&m_mutex);
+    m_jobs.removeOne(&job); // 分片已领完 (工作线程可能已移除)
+    job.done += finished;
+    // 等工作线程完成已领取的分片并离开本任务，之后 job 才能出栈
+    while (job.done < job.count || job.users > 0) {
+        m_jobDone.wait(&m_mutex);
+    }
+}
+
+void SlicePool::workerLoop()
+{
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        while (!m_exit && m_jobs.isEmpty()) {
+            m_jobAvailable.wait(&m_mutex);
+        }
+        if (m_exit) {
+            return;
+        }
+        Job *job = m_jobs.first();
+        job->users++;
+        locker.unlock();
+
+        const int finished = drain(job);
+
+        locker.relock();
+        m_jobs.removeOne(job); // 本线程领取失败说明分片已领完，不再分给其它工作线程
+        job->done += finished;
+        job->users--;
+        m_jobDone.wakeAll();
+    }
+}
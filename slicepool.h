@@ -0,0 +1,100 @@
+#ifndef SLICEPOOL_H
+#define SLICEPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QList>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief 分片并行的小线程池 (SlicePool)
+ *
+ * 把一帧的像素转换按水平条带拆成若干片，在几个常驻工作线程和调用线程上并行执行：
+ * - `run()` 把任务挂到共享的任务列表上并唤醒工作线程，调用线程自己也领取分片执行，
+ *   所有分片完成后才返回。分片通过原子计数领取，领取顺序不确定。
+ * - 多路摄像头的采集线程可以同时调用：工作线程按提交顺序帮忙，调用线程始终处理自己的任务，
+ *   工作线程都忙时退化为调用线程自己把所有分片做完，不会互相等待。
+ *
+ * 进程内共用一个实例 (`instance()`)，工作线程数为 CPU 核数减一 (最多 MAX_WORKERS 个)，单核时没有工作线程。
+ */
+class SlicePool
+{
+public:
+    static const int MAX_WORKERS = 3; ///< 工作线程数上限 (四核 ARM 上与调用线程合计占满四个核)。
+
+    /**
+     * @brief 进程内共用的线程池，第一次调用时创建。线程安全。
+     */
+    static SlicePool *instance();
+
+    /**
+     * @brief 析构函数，通知并等待所有工作线程退出。
+     */
+    ~SlicePool();
+
+    /**
+     * @brief 工作线程数 (不含调用线程)。
+     */
+    int workerCount() const { return m_workers.size(); }
+
+    /**
+     * @brief 并行执行 task(0) ~ task(count-1)，全部完成后返回。
+     * @param count 分片数，不大于1或没有工作线程时直接在调用线程中依次执行。
+     * @param task 分片任务，不同分片可能在不同线程中同时执行，必须只写入各自的区域。
+     */
+    void run(int count, const std::function<void(int)> &task);
+
+private:
+    /**
+     * @brief 一次 `run()` 调用，位于调用者的栈上，完成前不会出栈。
+     */
+    struct Job {
+        const std::function<void(int)> *task; ///< 分片任务。
+        int count;       ///< 分片数。
+        QAtomicInt next; ///< 下一个待领取的分片序号。
+        int done;        ///< 已完成的分片数。由 `m_mutex` 保护。
+        int users;       ///< 正在执行该任务分片的工作线程数。由 `m_mutex` 保护。
+    };
+
+    /**
+     * @brief 工作线程，只运行 `workerLoop()`。
+     */
+    class Worker : public QThread
+    {
+    public:
+        explicit Worker(SlicePool *pool) : m_pool(pool) {}
+
+    protected:
+        void run() override { m_pool->workerLoop(); }
+
+    private:
+        SlicePool *m_pool;
+    };
+
+    explicit SlicePool(int workers);
+    SlicePool(const SlicePool &) = delete;
+    SlicePool &operator=(const SlicePool &) = delete;
+
+    /**
+     * @brief 领取并执行任务的分片，直到分片领完。
+     * @return 本线程完成的分片数。
+     */
+    static int drain(Job *job);
+
+    /**
+     * @brief 工作线程主循环：等待任务，帮忙执行最早提交的任务。
+     */
+    void workerLoop();
+
+    QMutex m_mutex;               ///< 保护任务列表和任务的完成计数。
+    QWaitCondition m_jobAvailable;///< 有新任务或需要退出时唤醒工作线程。
+    QWaitCondition m_jobDone;     ///< 工作线程完成分片后唤醒等待的调用者。
+    QList<Job *> m_jobs;          ///< 还有分片未领取的任务，按提交顺序排列。由 `m_mutex` 保护。
+    bool m_exit;                  ///< 工作线程应退出。由 `m_mutex` 保护。
+    QVector<Worker *> m_workers;  ///< 工作线程。
+};
+
+#endif // SLICEPOOL_H
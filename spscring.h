@@ -0,0 +1,246 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <poll.h>        // poll
+#include <sys/eventfd.h> // eventfd
+#include <unistd.h>      // read, write, close
+
+/**
+ * @brief 单生产者/单消费者无锁环形队列 (SpscRing)
+ *
+ * 用于采集线程 (生产者) 和编码线程 (消费者) 之间传递帧槽指针等可平凡复制的小对象：
+ * - 头/尾索引分别位于独立的缓存行，生产者和消费者各自缓存对方的索引，减少缓存行来回迁移。
+ * - 索引单调递增，存储长度取不小于容量的2的幂，用掩码定位元素；逻辑容量仍是 `reset()` 指定的值。
+ * - 额外提供 `tryStealOldest()`：生产者在队列已满时取走最旧的元素 (丢弃最旧帧)。
+ *   出队和窃取都用 CAS 推进头索引，只有 CAS 成功的一方拿到元素，因此两者可以同时发生。
+ *
+ * `reset()` 不是线程安全的，只能在两端都不访问队列时调用。
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    SpscRing() : m_slots(nullptr), m_mask(0), m_capacity(0), m_head(0), m_cachedTail(0),
+                 m_tail(0), m_cachedHead(0) {}
+    ~SpscRing() { delete[] m_slots; }
+
+    /**
+     * @brief 清空队列并设置逻辑容量。
+     * @param capacity 最多容纳的元素个数 (>= 1)。
+     */
+    void reset(unsigned capacity)
+    {
+        unsigned size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        if (size != m_mask + 1 || !m_slots) {
+            delete[] m_slots;
+            m_slots = new std::atomic<T>[size];
+        }
+        m_mask = size - 1;
+        m_capacity = capacity;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedHead = 0;
+        m_cachedTail = 0;
+    }
+
+    unsigned capacity() const { return m_capacity; } ///< 逻辑容量。
+
+    /**
+     * @brief 生产者：追加一个元素。
+     * @return 队列已满时返回 false。
+     */
+    bool tryPush(const T &value)
+    {
+        const unsigned tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead >= m_capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire); // 消费者可能已取走元素
+            if (tail - m_cachedHead >= m_capacity) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask].store(value, std::memory_order_relaxed);
+        m_tail.store(tail + 1, std::memory_order_release); // 发布元素
+        return true;
+    }
+
+    /**
+     * @brief 消费者：取出最旧的元素。
+     * @return 队列为空时返回 false。
+     */
+    bool tryPop(T &value)
+    {
+        unsigned head = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            // 生产者窃取后头索引可能越过缓存的尾索引，因此按差值判断而不是判等
+            if (static_cast<int>(m_cachedTail - head) <= 0) {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cachedTail) {
+                    return false;
+                }
+            }
+            if (takeAt(head, value)) {
+                return true;
+            }
+            // 生产者刚窃取了这个元素，head 已更新为最新值，重试
+        }
+    }
+
+    /**
+     * @brief 生产者：队列已满时取走最旧的元素 (只能由生产者调用)。
+     * @return 队列为空时返回 false。
+     */
+    bool tryStealOldest(T &value)
+    {
+        unsigned head = m_head.load(std::memory_order_acquire);
+        const unsigned tail = m_tail.load(std::memory_order_relaxed); // 尾索引只由本线程修改
+        while (head != tail) {
+            if (takeAt(head, value)) {
+                m_cachedHead = head + 1;
+                return true;
+            }
+        }
+        return false; // 消费者已把队列取空
+    }
+
+    /**
+     * @brief 当前元素个数 (另一端并发修改时只是近似值)。
+     */
+    unsigned size() const
+    {
+        const unsigned head = m_head.load(std::memory_order_acquire); // 先读头索引，保证结果不会为负
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool isEmpty() const { return size() == 0; } ///< 队列是否为空 (近似值，同 `size()`)。
+
+private:
+    /**
+     * @brief 读取 head 处的元素并用 CAS 推进头索引；失败时 head 被更新为当前值。
+     *
+     * 元素以原子方式读取：CAS 失败说明该位置已被另一方取走 (之后可能被生产者重写)，读到的值直接丢弃。
+     */
+    bool takeAt(unsigned &head, T &value)
+    {
+        const T candidate = m_slots[head & m_mask].load(std::memory_order_relaxed);
+        if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            value = candidate;
+            return true;
+        }
+        return false;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // 用填充而不是 alignas 隔开缓存行：C++11 的 new 不保证超过 16 字节的对齐，
+    // 相隔 64 字节的两组成员无论起始地址如何都不会落在同一缓存行。
+    std::atomic<T> *m_slots;   ///< 元素存储 (长度为 m_mask + 1)。
+    unsigned m_mask;           ///< 存储长度 - 1。
+    unsigned m_capacity;       ///< 逻辑容量。
+    char m_padding0[64];       ///< 隔开只读成员和头索引。
+
+    std::atomic<unsigned> m_head; ///< 下一个出队位置 (消费者推进，生产者窃取时也会推进)。
+    unsigned m_cachedTail;        ///< 消费者缓存的尾索引。
+    char m_padding1[64];          ///< 隔开头索引和尾索引。
+
+    std::atomic<unsigned> m_tail; ///< 下一个入队位置 (仅生产者修改)。
+    unsigned m_cachedHead;        ///< 生产者缓存的头索引。
+    char m_padding2[64];          ///< 避免与后续成员共享缓存行。
+};
+
+/**
+ * @brief 基于 eventfd 的线程停放/唤醒器 (EventWaker)
+ *
+ * 只在等待方真正停放时才执行 `write()` 系统调用：
+ * 等待方先 `prepareWait()` 声明要停放，再检查一遍条件，条件仍不满足才 `wait()`；
+ * 通知方在发布数据后调用 `notify()`，只有看到停放标志时才写 eventfd。
+ * 两边的 seq_cst 栅栏保证"发布数据 / 声明停放"不会同时错过对方，不会丢失唤醒。
+ */
+class EventWaker
+{
+public:
+    EventWaker() : m_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), m_parked(0) {}
+    ~EventWaker()
+    {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    /**
+     * @brief 等待方：声明即将停放。之后必须再检查一次等待条件，然后调用 `wait()` 或 `cancelWait()`。
+     */
+    void prepareWait()
+    {
+        m_parked.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief 等待方：条件已满足，取消停放。
+     */
+    void cancelWait() { m_parked.store(0, std::memory_order_relaxed); }
+
+    /**
+     * @brief 等待方：停放直到被唤醒或超时。
+     * @param timeoutMs 超时时间 (毫秒)，-1 表示一直等待。
+     * @return 被唤醒返回 true，超时返回 false。
+     */
+    bool wait(int timeoutMs)
+    {
+        int ret;
+        if (m_fd >= 0) {
+            struct pollfd pfd = {m_fd, POLLIN, 0};
+            ret = poll(&pfd, 1, timeoutMs);
+            uint64_t counter;
+            if (ret > 0 && read(m_fd, &counter, sizeof(counter)) < 0) {
+                ret = 0;
+            }
+        } else {
+            // eventfd 不可用时退化为1ms轮询，调用者重新检查条件
+            poll(nullptr, 0, (timeoutMs < 0 || timeoutMs > 1) ? 1 : timeoutMs);
+            ret = 1;
+        }
+        m_parked.store(0, std::memory_order_relaxed);
+        return ret > 0;
+    }
+
+    /**
+     * @brief 通知方：数据已发布，等待方停放时唤醒它。
+     */
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_parked.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    /**
+     * @brief 无条件唤醒 (状态变化、退出等低频场景)。
+     */
+    void wake()
+    {
+        if (m_fd >= 0) {
+            const uint64_t one = 1;
+            if (write(m_fd, &one, sizeof(one)) < 0) {
+                // 计数器溢出 (EAGAIN) 时等待方本来就会被唤醒，忽略
+            }
+        }
+    }
+
+private:
+    EventWaker(const EventWaker &) = delete;
+    EventWaker &operator=(const EventWaker &) = delete;
+
+    int m_fd;                  ///< eventfd 文件描述符，创建失败时为-1。
+    std::atomic<int> m_parked; ///< 等待方是否已停放 (或即将停放)。
+};
+
+#endif // SPSCRING_H
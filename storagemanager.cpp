@@ -6,12 +6,16 @@
  * 主要职责包括：
  * - 监控指定存储路径（例如TF卡）的可用空间。
  * - 根据设定的最小可用空间百分比阈值，判断存储空间是否充足。
- * - 当检测到存储空间不足时，自动删除最早录制的视频文件（按天为单位的整个目录）。
+ * - 当检测到存储空间不足时，由后台淘汰线程 (`RetentionWorker`) 从最早录制的视频文件开始逐个删除。
+ * - 剩余空间由录制线程报告的写入字节数估算，不反复调用 `QStorageInfo::refresh()`。
  * - 提供手动和自动（定时）检查存储空间的功能。
  * - 通过信号 (`lowStorageSpace`, `cleanupCompleted`, `cleanupFailed`) 通知其他组件存储状态的变化和清理操作的结果。
+ * - 打开存储根目录下的录像索引 (`RecordingCatalog`)，清理时查询和更新索引，而不是遍历目录。
  */
 
 #include "storagemanager.h"
+#include "retentionworker.h" // 后台淘汰线程
+#include "recordingexporter.h" // 时间段导出线程
 
 #include <QDebug>        // QDebug 类，用于输出调试信息。
 #include <QFileInfo>     // QFileInfo 类，提供文件的元信息（如大小、类型等）。
@@ -33,6 +37,12 @@ StorageManager::StorageManager(const QString &storagePath, QObject *parent)
     , m_storagePath(storagePath)              // 初始化存储路径
     , m_minFreeSpacePercent(10)               // 初始化最小可用空间百分比阈值为10%
     , m_checkTimer(nullptr)                   // 初始化定时器指针为空
+    , m_retention(nullptr)                    // 初始化淘汰线程指针为空
+    , m_exporter(nullptr)
+    , m_totalBytes(0)                         // 尚未采样存储空间
+    , m_availableBytes(0)
+    , m_lowSpace(false)
+    , m_rescanPending(0)
 {
     // 创建用于自动检查存储空间的定时器
     m_checkTimer = new QTimer(this);                                        // 创建QTimer实例，this作为其父对象
@@ -47,6 +57,27 @@ StorageManager::StorageManager(const QString &storagePath, QObject *parent)
             // 此时可以考虑抛出异常或发出错误信号，因为存储管理器可能无法正常工作
         }
     }
+
+    // 打开录像索引 (上次没有正常关闭时只扫描最新的日期目录，之后不再在GUI线程中遍历目录)
+    m_catalog.open(m_storagePath);
+
+    // 后台淘汰线程：删除进度和结果排队回到本对象所在的线程
+    m_retention = new RetentionWorker(&m_catalog, this);
+    connect(m_retention, &RetentionWorker::fileEvicted, this, &StorageManager::onFileEvicted, Qt::QueuedConnection);
+    connect(m_retention, &RetentionWorker::evictionFinished, this, &StorageManager::onEvictionFinished, Qt::QueuedConnection);
+    m_retention->startWorker();
+    scheduleFullRescan();
+
+    // 导出线程：正在读取的来源文件不会被淘汰；导出到存储根目录下时从估算的剩余空间中扣除
+    m_exporter = new RecordingExporter(&m_catalog, this);
+    connect(m_exporter, &RecordingExporter::sourceOpened, this, &StorageManager::recordingFileOpened, Qt::DirectConnection);
+    connect(m_exporter, &RecordingExporter::sourceClosed, this, &StorageManager::recordingFileClosed, Qt::DirectConnection);
+    connect(m_exporter, &RecordingExporter::exportFinished, this,
+            [this](const QString &outputPath, qint64, qint64, qint64 bytes) {
+        if (outputPath.startsWith(m_storagePath + "/")) {
+            accountWrittenBytes(bytes);
+        }
+    }, Qt::QueuedConnection);
 }
 
 /**
@@ -62,6 +93,10 @@ StorageManager::~StorageManager()
         m_checkTimer->stop();
         qDebug() << "StorageManager: 自动检查定时器已在析构时停止。";
     }
+    // 导出线程和淘汰线程使用 m_catalog，必须在成员析构之前停止 (导出线程还会调用淘汰线程)
+    m_exporter->cancelExport();
+    m_exporter->wait();
+    m_retention->stopWorker();
     // m_checkTimer 作为 this 的子对象，会被Qt自动删除，无需显式 delete
 }
 
@@ -87,6 +122,13 @@ void StorageManager::setStoragePath(const QString &path)
             qWarning() << "StorageManager: 创建新的存储路径 " << m_storagePath << " 失败！";
         }
     }
+    m_exporter->cancelExport(); // 正在进行的导出读取的是旧根目录下的录像
+    m_exporter->wait();
+    m_retention->stopWorker(); // 淘汰线程不能在索引切换期间删除文件
+    m_catalog.open(m_storagePath); // 切换到新根目录下的索引 (旧索引写入正常关闭标记)
+    m_retention->startWorker();
+    scheduleFullRescan();
+    m_totalBytes = 0; // 下一次检查时重新采样
 }
 
 /**
@@ -136,7 +178,8 @@ int StorageManager::minFreeSpacePercent() const
  *         否则（空间不足、设备无效或未就绪），返回 false。
  * 
  * 此函数执行以下操作：
- * 1. 使用 `QStorageInfo` 获取指定存储路径的设备信息（总容量、可用容量）。
+ * 1. 尚未采样时使用 `QStorageInfo` 获取指定存储路径的设备信息（总容量、可用容量）；之后使用估算值
+ *    (采样值减去录制写入的字节数、加上淘汰释放的字节数)，不再每次刷新。
  * 2. 检查存储设备是否有效且已就绪。如果无效，则记录警告并返回 false。
  * 3. 计算可用空间的实际百分比。
  * 4. 如果可用百分比低于 `m_minFreeSpacePercent`，则发出 `lowStorageSpace` 信号，并返回 false。
@@ -144,39 +187,21 @@ int StorageManager::minFreeSpacePercent() const
  */
 bool StorageManager::checkStorageSpace()
 {
-    // 获取指定存储路径（例如 "/mnt/TFcard"）的存储设备信息
-    QStorageInfo storage(m_storagePath);
-    storage.refresh(); // 确保获取的是最新的存储信息
-    
-    // 检查存储设备是否有效且已准备好（例如，是否已挂载且可读写）
-    if (!storage.isValid() || !storage.isReady()) {
+    // 尚未采样 (或上次采样失败) 时获取存储设备信息
+    if (m_totalBytes <= 0 && !refreshStorageInfo()) {
         qWarning() << "StorageManager::checkStorageSpace: 存储设备无效或未就绪于路径: " << m_storagePath;
         // 在这种情况下，可以认为空间不足或无法确定，返回false
         emit lowStorageSpace(0, 0, 0.0); // 发送一个表示无效状态的信号
         return false;
     }
     
-    // 获取总字节数和可用字节数
-    qint64 availableBytes = storage.bytesAvailable();
-    qint64 totalBytes = storage.bytesTotal();
-    
-    // 计算可用空间百分比
-    // 必须确保 totalBytes 不为0，以避免除以零的错误
-    double availablePercent = 0.0;
-    if (totalBytes > 0) {
-        availablePercent = static_cast<double>(availableBytes) / totalBytes * 100.0;
-    } else {
-        // 如果总字节数为0（可能是无效的存储设备或路径），则认为可用百分比也为0
-        qWarning() << "StorageManager::checkStorageSpace: 获取到的总存储空间为0字节于路径: " << m_storagePath;
-        // 此时也应视为空间不足
-        emit lowStorageSpace(availableBytes, totalBytes, availablePercent);
-        return false;
-    }
+    // 计算可用空间百分比 (refreshStorageInfo() 保证 m_totalBytes 大于0)
+    const double availablePercent = static_cast<double>(m_availableBytes) / m_totalBytes * 100.0;
     
     qDebug() << QString("StorageManager - 空间信息 for '%1': 总容量: %2 MB, 可用: %3 MB, 可用百分比: %4% (阈值: %5%)")
                  .arg(m_storagePath)
-                 .arg(totalBytes / (1024.0 * 1024.0), 0, 'f', 2)       // 总容量MB，保留2位小数
-                 .arg(availableBytes / (1024.0 * 1024.0), 0, 'f', 2)    // 可用容量MB，保留2位小数
+                 .arg(m_totalBytes / (1024.0 * 1024.0), 0, 'f', 2)       // 总容量MB，保留2位小数
+                 .arg(m_availableBytes / (1024.0 * 1024.0), 0, 'f', 2)   // 可用容量MB，保留2位小数
                  .arg(availablePercent, 0, 'f', 1)                          // 可用百分比，保留1位小数
                  .arg(m_minFreeSpacePercent);
     
@@ -184,14 +209,164 @@ bool StorageManager::checkStorageSpace()
     if (availablePercent < m_minFreeSpacePercent) {
         qInfo() << "StorageManager::checkStorageSpace: 存储空间不足！可用 (" << availablePercent 
                 << ") 低于阈值 (" << m_minFreeSpacePercent << ").";
+        m_lowSpace = true;
         // 发出存储空间不足的信号，传递详细信息
-        emit lowStorageSpace(availableBytes, totalBytes, availablePercent);
+        emit lowStorageSpace(m_availableBytes, m_totalBytes, availablePercent);
         return false; // 空间不足
     }
     
+    m_lowSpace = false;
     return true; // 空间充足
 }
 
+/**
+ * @brief 请求后台淘汰最早的录像文件。
+ *
+ * 目标为可用空间达到总容量的 (`m_minFreeSpacePercent` + RETENTION_MARGIN_PERCENT)%，
+ * 只把还差的字节数交给淘汰线程，立即返回。空间已经足够时不做任何事。
+ */
+void StorageManager::requestCleanup()
+{
+    if (m_totalBytes <= 0 && !refreshStorageInfo()) {
+        return;
+    }
+    const int targetPercent = qMin(m_minFreeSpacePercent + RETENTION_MARGIN_PERCENT, 100);
+    const qint64 targetBytes = m_totalBytes / 100 * targetPercent;
+    const qint64 needed = targetBytes - m_availableBytes;
+    if (needed > 0) {
+        qInfo() << "StorageManager: 请求后台淘汰" << needed / (1024.0 * 1024.0) << "MB";
+        m_retention->requestEviction(needed);
+    }
+}
+
+/**
+ * @brief 是否有可以淘汰的录像。
+ * @return 索引中有已关闭的录像文件时返回 true。
+ */
+bool StorageManager::canFreeSpace() const
+{
+    return m_catalog.count() > 0;
+}
+
+/**
+ * @brief 录制线程写出了数据，从估算的可用空间中扣除。
+ * @param bytes 写出的字节数。
+ *
+ * 估算值刚低于阈值时发出一次 `lowStorageSpace`，之后每次写入都更新淘汰目标 (淘汰线程忙时只修改目标)。
+ */
+void StorageManager::accountWrittenBytes(qint64 bytes)
+{
+    if (m_totalBytes <= 0) {
+        return; // 尚未采样，下一次检查时采样值已包含这些写入
+    }
+    m_availableBytes -= bytes;
+    const double availablePercent = static_cast<double>(m_availableBytes) / m_totalBytes * 100.0;
+    if (availablePercent >= m_minFreeSpacePercent) {
+        return;
+    }
+    if (!m_lowSpace) {
+        m_lowSpace = true;
+        emit lowStorageSpace(m_availableBytes, m_totalBytes, availablePercent);
+    }
+    requestCleanup();
+}
+
+/**
+ * @brief 录制线程打开了一个录像文件，关闭之前淘汰线程不会删除它。线程安全。
+ */
+void StorageManager::recordingFileOpened(const QString &filePath)
+{
+    m_retention->setFileActive(filePath, true);
+    startPendingRescan(); // 录制已经开始，整个目录的扫描不再推迟开机到开始录制的时间
+}
+
+/**
+ * @brief 录制线程关闭了一个录像文件。线程安全。
+ */
+void StorageManager::recordingFileClosed(const QString &filePath)
+{
+    m_retention->setFileActive(filePath, false);
+}
+
+/**
+ * @brief 淘汰线程删除了一个文件，释放的空间加回估算值。
+ * @param filePath 被删除文件的绝对路径。
+ * @param bytes 文件大小。
+ */
+void StorageManager::onFileEvicted(const QString &filePath, qint64 bytes)
+{
+    m_availableBytes += bytes;
+    m_lastEvicted = filePath.mid(m_storagePath.size() + 1);
+}
+
+/**
+ * @brief 一次淘汰结束。
+ * @param freedBytes 本次删除的录像字节数。
+ * @param targetMet 是否达到目标。
+ *
+ * 重新采样一次剩余空间 (删除后实际释放的空间以簇为单位，与文件大小略有差别)，然后报告结果。
+ */
+void StorageManager::onEvictionFinished(qint64 freedBytes, bool targetMet)
+{
+    refreshStorageInfo();
+    if (m_totalBytes > 0) {
+        m_lowSpace = static_cast<double>(m_availableBytes) / m_totalBytes * 100.0 < m_minFreeSpacePercent;
+    }
+    if (freedBytes > 0) {
+        emit cleanupCompleted(m_lastEvicted, freedBytes);
+    }
+    if (!targetMet) {
+        emit cleanupFailed("没有可以删除的旧录像，存储空间仍然不足");
+    }
+}
+
+/**
+ * @brief 用 `QStorageInfo` 重新采样总容量和可用空间。
+ * @return 设备无效、未就绪或总容量为0时返回 false，此时 `m_totalBytes` 为0。
+ */
+bool StorageManager::refreshStorageInfo()
+{
+    // 获取指定存储路径（例如 "/mnt/TFcard"）的存储设备信息
+    QStorageInfo storage(m_storagePath);
+    storage.refresh(); // 确保获取的是最新的存储信息
+    
+    // 检查存储设备是否有效且已准备好（例如，是否已挂载且可读写）
+    if (!storage.isValid() || !storage.isReady() || storage.bytesTotal() <= 0) {
+        m_totalBytes = 0;
+        m_availableBytes = 0;
+        return false;
+    }
+    m_totalBytes = storage.bytesTotal();
+    m_availableBytes = storage.bytesAvailable();
+    return true;
+}
+
+/**
+ * @brief 索引需要扫描整个存储目录时 (上次没有正常关闭)，等到第一个录像文件打开后再交给淘汰线程，
+ *        一直没有开始录制时 RESCAN_DELAY_MS 毫秒后进行。
+ */
+void StorageManager::scheduleFullRescan()
+{
+    if (!m_catalog.needsFullRescan()) {
+        m_rescanPending.storeRelease(0);
+        return;
+    }
+    m_rescanPending.storeRelease(1);
+    QTimer::singleShot(RESCAN_DELAY_MS, this, [this]() {
+        startPendingRescan();
+    });
+}
+
+/**
+ * @brief 把等待中的扫描请求交给淘汰线程，录制线程 (第一个文件打开) 和定时器谁先到由谁交，只交一次。
+ */
+void StorageManager::startPendingRescan()
+{
+    if (m_rescanPending.testAndSetOrdered(1, 0)) {
+        m_retention->requestRescan();
+    }
+}
+
 /**
  * @brief 清理（删除）存储路径下按日期命名的目录中最早的一天。
  * @return 如果成功找到并删除了一个目录，则返回 true；
@@ -200,10 +375,10 @@ bool StorageManager::checkStorageSpace()
  * 此函数执行以下操作：
  * 1. 调用 `getOldestDateDir()` 获取存储路径下名称符合 "yyyyMMdd" 格式且日期最早的子目录名。
  * 2. 如果没有找到这样的目录，则发出 `cleanupFailed` 信号并返回 false。
- * 3. 如果找到目录，则构造该目录的完整路径，并调用 `getDirSize()` 计算其大小（用于报告）。
+ * 3. 如果找到目录，则构造该目录的完整路径，并从索引查询其中录像文件的总大小（用于报告，索引不可用时调用 `getDirSize()`）。
  * 4. 使用 `QDir::removeRecursively()` 尝试递归删除该目录及其所有内容。
- * 5. 如果删除成功，则记录日志，发出 `cleanupCompleted` 信号（包含被删目录名和释放的空间大小），并返回 true。
- * 6. 如果删除失败，则记录警告，发出 `cleanupFailed` 信号，并返回 false。
+ * 5. 如果删除成功，则从索引中删除该目录的记录，记录日志，发出 `cleanupCompleted` 信号（包含被删目录名和释放的空间大小），并返回 true。
+ * 6. 如果删除失败 (可能已删除一部分)，则重新扫描使索引与目录一致，记录警告，发出 `cleanupFailed` 信号，并返回 false。
  */
 bool StorageManager::cleanupOldestDay()
 {
@@ -225,8 +400,13 @@ bool StorageManager::cleanupOldestDay()
         return false;
     }
     
-    // 计算要删除目录的大小，以便在成功后报告释放了多少空间
-    qint64 dirSize = getDirSize(dirToRemove);
+    // 计算要删除目录的大小，以便在成功后报告释放了多少空间 (查询索引，不遍历目录)
+    if (m_retention->hasActiveFileUnder(dirToRemove.absolutePath())) {
+        qWarning() << "StorageManager::cleanupOldestDay: 目录中有正在写入的录像文件，不删除: " << dirToRemove.absolutePath();
+        emit cleanupFailed(QString("目录 %1 中有正在写入的录像文件").arg(dirToRemove.absolutePath()));
+        return false;
+    }
+    qint64 dirSize = m_catalog.isOpen() ? m_catalog.bytesUnder(dirToRemove.absolutePath()) : getDirSize(dirToRemove);
     
     qInfo() << "StorageManager: 准备删除最早的视频目录: " << dirToRemove.absolutePath() 
             << " (大小: " << dirSize / (1024.0*1024.0) << " MB)";
@@ -235,6 +415,8 @@ bool StorageManager::cleanupOldestDay()
     bool success = dirToRemove.removeRecursively();
     
     if (success) {
+        m_catalog.removePath(dirToRemove.absolutePath());
+        m_availableBytes += dirSize;
         qInfo() << "StorageManager: 已成功删除目录: " << dirToRemove.absolutePath() 
                 << ", 释放空间约: " << dirSize / (1024.0 * 1024.0) << " MB";
         // 发出清理完成信号，传递被删除的目录名（相对路径）和释放的字节数
@@ -242,6 +424,7 @@ bool StorageManager::cleanupOldestDay()
     } else {
         qWarning() << "StorageManager: 删除目录失败: " << dirToRemove.absolutePath() 
                    << " (错误可能与文件锁定、权限等有关)";
+        m_catalog.rescan(dirToRemove.absolutePath()); // 可能已删除了一部分文件 (目录中没有正在写入的文件)
         // 发出清理失败信号
         emit cleanupFailed(QString("删除目录 %1 失败").arg(dirToRemove.absolutePath()));
     }
@@ -291,32 +474,21 @@ void StorageManager::stopAutoCheck()
  * @brief 私有槽函数：执行一次存储空间的自动检查和可能的清理操作。
  * 
  * 此槽函数通常由 `m_checkTimer` 定时器触发，或在 `startAutoCheck()` 时被直接调用一次。
- * 它会调用 `checkStorageSpace()` 检查空间。如果发现空间不足，则调用 `cleanupOldestDay()`
- * 尝试清理最早一天的视频文件。清理后，会再次调用 `checkStorageSpace()` 确认空间是否已足够。
+ * 它会重新采样剩余空间并调用 `checkStorageSpace()` 检查空间。如果发现空间不足，则调用 `requestCleanup()`
+ * 让后台淘汰线程从最早的录像文件开始删除，不在本线程中等待。
  */
 void StorageManager::performAutoCheck()
 {
     qDebug() << "StorageManager::performAutoCheck: 开始执行存储空间自动检查...";
     
-    // 步骤1: 检查当前存储空间是否充足
+    // 步骤1: 重新采样一次剩余空间，纠正估算的误差 (其它程序写入、文件系统开销等)
+    refreshStorageInfo();
+    
+    // 步骤2: 检查当前存储空间是否充足
     if (!checkStorageSpace()) { // checkStorageSpace会在空间不足时发出lowStorageSpace信号
-        qInfo() << "StorageManager::performAutoCheck: 检测到存储空间不足，尝试清理最早一天的文件...";
-        // 步骤2: 如果空间不足，尝试清理最早一天的视频文件
-        bool cleaned = cleanupOldestDay(); // cleanupOldestDay会发出cleanupCompleted或cleanupFailed信号
-        
-        if (cleaned) {
-            qInfo() << "StorageManager::performAutoCheck: 清理操作已执行。将再次检查空间...";
-            // 步骤3: 清理后，再次检查存储空间是否已恢复到阈值以上
-            if (!checkStorageSpace()) {
-                qWarning() << "StorageManager::performAutoCheck: 清理后存储空间仍然不足！可能需要进一步清理或手动干预。";
-                // 此时可以考虑是否要再次触发清理，或者发出更严重的警告信号
-                // 例如，如果一次清理不解决问题，可能需要一个策略来决定是否连续清理多天
-            } else {
-                qInfo() << "StorageManager::performAutoCheck: 清理后存储空间已恢复正常。";
-            }
-        } else {
-            qWarning() << "StorageManager::performAutoCheck: 自动清理操作失败。存储空间仍然不足。";
-        }
+        // 步骤3: 如果空间不足，请求后台淘汰最早的录像文件 (结果通过 cleanupCompleted / cleanupFailed 信号通知)
+        qInfo() << "StorageManager::performAutoCheck: 检测到存储空间不足，请求后台淘汰最早的录像文件...";
+        requestCleanup();
     } else {
         qDebug() << "StorageManager::performAutoCheck: 存储空间充足，无需操作。";
     }
@@ -338,8 +510,9 @@ qint64 StorageManager::getDirSize(const QDir &dir)
     // QDir::Files: 包含文件
     // QDir::Dirs: 包含目录 (虽然我们只加文件大小，但需要遍历子目录以找到其中的文件)
     // QDir::NoDotAndDotDot: 排除特殊目录 "." (当前目录) 和 ".." (父目录)
+    // QDir::Hidden: 包含隐藏的缩略图目录 (.thumbs) 中的文件
     // QDirIterator::Subdirectories: 递归进入子目录进行遍历
-    QDirIterator it(dir.absolutePath(), QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    QDirIterator it(dir.absolutePath(), QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
     // 注意：上面的过滤器 QDir::Files | QDir::NoDotAndDotDot 若配合 QDirIterator::Subdirectories，
     // 迭代器本身可能不会直接列出子目录条目，而是直接递归进入并列出子目录中的文件。
     // 如果需要明确区分文件和目录，或者有其他处理逻辑，过滤器和迭代器选项需要仔细调整。
@@ -367,6 +540,13 @@ qint64 StorageManager::getDirSize(const QDir &dir)
  */
 QString StorageManager::getOldestDateDir()
 {
+    // 优先查询索引：有录像的最早日期目录，不需要列目录
+    const QString indexedDay = m_catalog.oldestDay();
+    if (!indexedDay.isEmpty()) {
+        return indexedDay;
+    }
+
+    // 索引不可用或没有录像 (例如只剩下空的日期目录)：退回列出根目录
     QDir storageDir(m_storagePath); // 创建QDir对象操作存储根路径
     
     // 获取存储根路径下的所有子目录名称列表
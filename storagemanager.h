@@ -5,6 +5,12 @@
 #include <QStorageInfo>
 #include <QDir>
 #include <QTimer>
+#include <QAtomicInt>
+
+#include "recordingcatalog.h" // 录像目录索引
+
+class RetentionWorker;
+class RecordingExporter;
 
 /**
  * @brief 存储管理类 (StorageManager)
@@ -18,8 +24,17 @@
  * - 设置和查询最小可用空间百分比阈值。
  * - 手动检查存储空间是否低于阈值。
  * - 自动（定时）检查存储空间。
- * - 当空间不足时，自动查找并删除包含最早录像数据的整个日期目录。
+ * - 当空间不足时，自动从最早的录像文件开始删除 (手动清理时删除最早的整个日期目录)。
  * - 通过信号通知外部组件关于存储空间状态（不足、清理完成、清理失败）。
+ * - 维护存储根目录下的录像索引 (`catalog()`)：录像文件关闭后由 `CameraChannel` 登记，
+ *   查找最早的日期目录、统计目录大小和历史浏览都查询索引，不再遍历TF卡。
+ * - 空间不足时由淘汰线程 (`RetentionWorker`) 在后台从最早的录像文件开始逐个删除，直到可用空间回到
+ *   阈值之上 RETENTION_MARGIN_PERCENT 个百分点 (`requestCleanup()`)，GUI线程和录制线程都不等待删除。
+ * - 剩余空间由一次 `QStorageInfo` 采样减去录制线程报告的写入字节数 (`accountWrittenBytes()`)、
+ *   加上淘汰释放的字节数估算，只在自动检查和每次淘汰结束时重新采样。
+ * - 时间段导出线程 (`exporter()`) 从索引查找来源文件，导出期间来源文件不会被淘汰。
+ * - 上次没有正常关闭时，打开索引只扫描最新的日期目录；整个存储目录的扫描在第一个录像文件打开后
+ *   (最迟 RESCAN_DELAY_MS 毫秒后) 交给淘汰线程，不推迟开机到开始录制的时间。
  */
 class StorageManager : public QObject
 {
@@ -68,20 +83,50 @@ public:
     int minFreeSpacePercent() const;
     
     /**
-     * @brief 手动检查当前存储路径下的存储空间是否充足。
+     * @brief 手动检查当前存储路径下的存储空间是否充足 (使用估算的剩余空间，不重新采样)。
      * @return 如果可用空间百分比大于或等于设定阈值，则返回 true；
      *         否则（空间不足、设备无效或未就绪）返回 false。
      *         如果空间不足，会发出 `lowStorageSpace` 信号。
      */
     bool checkStorageSpace();
+
+    /**
+     * @brief 请求后台淘汰：空间低于目标 (阈值加 RETENTION_MARGIN_PERCENT) 时让淘汰线程删除最早的录像文件，立即返回。
+     *
+     * 淘汰线程忙时只更新目标。每次淘汰结束后发出 `cleanupCompleted` 或 `cleanupFailed` 信号。
+     */
+    void requestCleanup();
+
+    /**
+     * @brief 是否有可以淘汰的录像 (索引中有已关闭的录像文件)。
+     */
+    bool canFreeSpace() const;
     
     /**
-     * @brief 手动触发清理操作：删除存储路径下按日期命名的目录中最早的一天。
+     * @brief 手动触发清理操作：同步删除存储路径下按日期命名的目录中最早的一天。
      * @return 如果成功找到并删除了一个目录，则返回 true；否则返回 false。
      *         操作结果会通过 `cleanupCompleted` 或 `cleanupFailed` 信号通知。
+     *
+     * 在调用线程中删除整个目录，可能需要几秒；自动清理使用 `requestCleanup()`。
+     * 目录中有正在写入的录像文件时不删除。
      */
     bool cleanupOldestDay();
     
+    /**
+     * @brief 录像目录索引，构造或 `setStoragePath()` 时打开 (上次没有正常关闭时扫描最新的日期目录)。
+     */
+    RecordingCatalog *catalog() { return &m_catalog; }
+
+    /**
+     * @brief 录像时间段导出线程 (子对象)，使用 `catalog()`。
+     */
+    RecordingExporter *exporter() const { return m_exporter; }
+
+    /**
+     * @brief 已登记的录像文件总大小 (字节)，查询索引，不遍历目录。
+     */
+    qint64 recordedBytes() const { return m_catalog.totalBytes(); }
+
     /**
      * @brief 启动存储空间的自动（定时）检查功能。
      * @param interval 自动检查的时间间隔，单位为毫秒。默认为 3,600,000 毫秒 (1小时)。
@@ -94,6 +139,24 @@ public:
      */
     void stopAutoCheck();
 
+public slots:
+    /**
+     * @brief 录制线程写出了 bytes 字节 (连接 `RecordingThread::bytesWritten`)，从估算的剩余空间中扣除；
+     *        剩余空间刚低于阈值时发出 `lowStorageSpace` 并请求后台淘汰。
+     */
+    void accountWrittenBytes(qint64 bytes);
+
+    /**
+     * @brief 录制线程打开了一个录像文件 (以 `Qt::DirectConnection` 连接 `RecordingThread::fileOpened`，线程安全)。
+     *        文件关闭之前不会被淘汰。第一次调用时开始后台扫描整个存储目录 (如果需要)。
+     */
+    void recordingFileOpened(const QString &filePath);
+
+    /**
+     * @brief 录制线程关闭了一个录像文件 (以 `Qt::DirectConnection` 连接 `RecordingThread::fileClosed`，线程安全)。
+     */
+    void recordingFileClosed(const QString &filePath);
+
 signals:
     /**
      * @brief 当检测到存储空间低于设定阈值时发出的信号。
@@ -104,9 +167,9 @@ signals:
     void lowStorageSpace(qint64 availableBytes, qint64 totalBytes, double percent);
     
     /**
-     * @brief 当自动清理操作成功删除一个旧目录后发出的信号。
-     * @param path 被成功清理的目录的相对路径名 (例如 "20230115")。
-     * @param freedBytes 通过删除该目录所释放的近似字节数。
+     * @brief 当清理操作成功删除旧录像后发出的信号。
+     * @param path 被清理的目录的相对路径名 (例如 "20230115")；后台淘汰时为最后删除的文件的相对路径。
+     * @param freedBytes 释放的近似字节数。
      */
     void cleanupCompleted(const QString &path, qint64 freedBytes);
     
@@ -121,28 +184,67 @@ private slots:
      * @brief 私有槽函数：执行一次存储空间的自动检查和可能的清理操作。
      * 
      * 此槽函数由 `m_checkTimer` 定时器周期性触发，或在 `startAutoCheck()` 时被直接调用一次。
-     * 它调用 `checkStorageSpace()`，如果空间不足，则调用 `cleanupOldestDay()`。
+     * 它重新采样剩余空间并调用 `checkStorageSpace()`，如果空间不足，则调用 `requestCleanup()`。
      */
     void performAutoCheck();
 
+    /**
+     * @brief 淘汰线程删除了一个文件 (排队连接)：把释放的字节加回估算的剩余空间。
+     */
+    void onFileEvicted(const QString &filePath, qint64 bytes);
+
+    /**
+     * @brief 一次淘汰结束 (排队连接)：重新采样剩余空间，发出 `cleanupCompleted` 或 `cleanupFailed`。
+     */
+    void onEvictionFinished(qint64 freedBytes, bool targetMet);
+
 private:
     QString m_storagePath;       ///< 存储管理的根路径字符串 (例如 "/mnt/TFcard")。
     int m_minFreeSpacePercent;   ///< 最小可用存储空间百分比阈值 (0-100)。
     QTimer *m_checkTimer;        ///< QTimer 对象，用于实现自动（定时）检查存储空间的功能。
+    RecordingCatalog m_catalog;  ///< 存储根目录下的录像索引。
+    RetentionWorker *m_retention; ///< 后台淘汰线程，使用 `m_catalog`，析构时先停止。
+    RecordingExporter *m_exporter; ///< 时间段导出线程，使用 `m_catalog`，析构时先停止。
+
+    // 剩余空间估算 (只在GUI线程中访问)
+    qint64 m_totalBytes;         ///< 存储设备总容量 (字节)，0 表示尚未采样或设备无效。
+    qint64 m_availableBytes;     ///< 估算的可用空间 (字节)。
+    bool m_lowSpace;             ///< 估算的可用空间低于阈值 (发出 `lowStorageSpace` 后置位，回到阈值以上清除)。
+    QString m_lastEvicted;       ///< 本次淘汰最后删除的文件的相对路径。
+    QAtomicInt m_rescanPending;  ///< 索引需要后台扫描整个存储目录，尚未交给淘汰线程时为1 (录制线程也会访问)。
+
+    static const int RETENTION_MARGIN_PERCENT = 2; ///< 淘汰到可用空间比阈值高出这么多个百分点，避免频繁触发。
+    static const int RESCAN_DELAY_MS = 60000;      ///< 一直没有开始录制时 (例如待命录制中没有事件)，打开索引后最迟这么久开始后台扫描。
     
     // 私有辅助方法
     /**
-     * @brief 计算指定目录的总大小（递归地包括所有子目录和文件）。
+     * @brief 计算指定目录的总大小（递归地包括所有子目录和文件）。索引不可用时使用。
      * @param dir 要计算大小的 QDir 对象。
      * @return 目录的总大小，单位为字节。
      */
     qint64 getDirSize(const QDir &dir);
     
     /**
-     * @brief 获取存储路径下符合 "yyyyMMdd" 命名格式且日期最早的子目录名。
+     * @brief 获取存储路径下符合 "yyyyMMdd" 命名格式且日期最早的子目录名 (优先查询索引)。
      * @return 如果找到，返回目录名 (例如 "20230115")；否则返回空 QString。
      */
     QString getOldestDateDir();
+
+    /**
+     * @brief 用 `QStorageInfo` 重新采样总容量和可用空间，覆盖估算值。
+     * @return 设备无效或未就绪时返回 false。
+     */
+    bool refreshStorageInfo();
+
+    /**
+     * @brief 打开索引后调用：索引需要扫描整个存储目录时，等待开始录制 (或 RESCAN_DELAY_MS 超时) 后交给淘汰线程。
+     */
+    void scheduleFullRescan();
+
+    /**
+     * @brief 把等待中的扫描请求交给淘汰线程 (只交一次)。线程安全。
+     */
+    void startPendingRescan();
 };
 
 #endif // STORAGEMANAGER_H
\ No newline at end of file
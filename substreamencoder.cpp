@@ -0,0 +1,332 @@
+/**
+ * @file substreamencoder.cpp
+ * @brief 低分辨率子码流编码器 (SubstreamEncoder) 的实现文件。
+ *
+ * 录制线程每个子码流帧只做一次块平均缩小 (320x240 时约为主码流转换开销的四分之一)，
+ * 编码、数据包分发在本对象的线程中进行。
+ */
+
+#include "substreamencoder.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+#include <utility>
+
+#include "pixel_convert.h"  // 整数倍块平均缩小 (SSE2 / NEON)
+
+namespace {
+
+/**
+ * @brief 分配一个 YUV420P 帧及其缓冲区。
+ */
+AVFrame *allocI420Frame(int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+} // namespace
+
+SubstreamEncoder::SubstreamEncoder(QObject *parent)
+    : QThread(parent)
+    , m_width(0)
+    , m_height(0)
+    , m_frameIntervalUs(0)
+    , m_packet(nullptr)
+    , m_workFrame(nullptr)
+    , m_pendingFrame(nullptr)
+    , m_currentFrame(nullptr)
+    , m_hasPending(false)
+    , m_hasImage(false)
+    , m_stopRequested(false)
+    , m_imageSws(nullptr)
+    , m_firstTimestampUs(-1)
+    , m_nextFrameUs(-1)
+    , m_lastPts(AV_NOPTS_VALUE)
+    , m_active(0)
+    , m_keyFrameRequested(0)
+    , m_droppedFrames(0)
+{
+    // 板载硬件编码单元通常只有一个，留给主码流；子码流默认用软件编码器，不可用时再尝试其它候选
+    QStringList names = EncoderBackend::defaultPreference();
+    names.removeAll(QString("libx264"));
+    names.prepend(QString("libx264"));
+    m_encoder.setPreference(names);
+}
+
+SubstreamEncoder::~SubstreamEncoder()
+{
+    stopEncoding();
+    freeFrames();
+    if (m_imageSws) {
+        sws_freeContext(m_imageSws);
+        m_imageSws = nullptr;
+    }
+}
+
+void SubstreamEncoder::setSettings(const Settings &settings)
+{
+    QMutexLocker locker(&m_mutex);
+    m_settings = settings;
+}
+
+void SubstreamEncoder::setEncoderPreference(const QStringList &names)
+{
+    m_encoder.setPreference(names); // 只在空闲时由调用者修改，下一次 startEncoding() 生效
+}
+
+bool SubstreamEncoder::startEncoding(int mainWidth, int mainHeight, QString *errorMsg)
+{
+    if (isActive() || m_encoder.context()) {
+        return false;
+    }
+
+    Settings settings;
+    {
+        QMutexLocker locker(&m_mutex);
+        settings = m_settings;
+    }
+
+    // 按2的幂缩小到不超过最大宽度 (640x480 -> 320x240，1280x720 -> 320x180)，
+    // 缩小倍数为整数，块平均不需要插值；尺寸保持偶数以便色度平面正好减半
+    int shift = 0;
+    while (shift < 3 && (mainWidth >> shift) > settings.maxWidth) {
+        shift++;
+    }
+    const int width = (mainWidth >> shift) & ~1;
+    const int height = (mainHeight >> shift) & ~1;
+    if (width < 16 || height < 16) {
+        if (errorMsg) {
+            *errorMsg = QString("子码流尺寸过小: %1x%2").arg(width).arg(height);
+        }
+        return false;
+    }
+    const int frameRate = qMax(1, settings.frameRate);
+
+    EncoderBackend::Settings encoderSettings;
+    encoderSettings.width = width;
+    encoderSettings.height = height;
+    encoderSettings.timeBase = AVRational{1, PTS_CLOCK_RATE};
+    encoderSettings.frameRate = AVRational{frameRate, 1};
+    encoderSettings.bitRate = settings.bitRate;
+    encoderSettings.gopSize = frameRate * qMax(1, settings.gopSeconds);
+    encoderSettings.globalHeader = false; // SPS/PPS 放在码流中，网络观看者从任意关键帧开始解码
+    encoderSettings.threads = 1;          // 已经在独立线程中编码，小尺寸帧再分线程只会增加延迟
+    if (!m_encoder.open(encoderSettings, errorMsg)) {
+        return false;
+    }
+
+    m_packet = av_packet_alloc();
+    {
+        // 编码线程未运行；锁只用于与 latestImage() 互斥
+        QMutexLocker locker(&m_mutex);
+        freeFrames();
+        m_workFrame = allocI420Frame(width, height);
+        m_pendingFrame = allocI420Frame(width, height);
+        m_currentFrame = allocI420Frame(width, height);
+        m_width = width;
+        m_height = height;
+        m_hasPending = false;
+        m_hasImage = false;
+        m_stopRequested = false;
+    }
+    if (!m_packet || !m_workFrame || !m_pendingFrame || !m_currentFrame) {
+        if (errorMsg) {
+            *errorMsg = QString("无法分配子码流帧缓冲区");
+        }
+        av_packet_free(&m_packet);
+        m_encoder.close();
+        return false;
+    }
+
+    m_frameIntervalUs = 1000000LL / frameRate;
+    m_firstTimestampUs = -1;
+    m_nextFrameUs = -1;
+    m_lastPts = AV_NOPTS_VALUE;
+    m_droppedFrames.store(0);
+    m_keyFrameRequested.store(0);
+    m_packetFanout.start(m_encoder.context());
+
+    qDebug() << "子码流:" << width << "x" << height << frameRate << "fps" << settings.bitRate << "bps"
+             << "编码器:" << m_encoder.name();
+
+    m_active.storeRelease(1); // 之后 submitFrame() 开始提交帧
+    start(QThread::LowPriority); // 子码流让位于采集和主码流
+    return true;
+}
+
+void SubstreamEncoder::stopEncoding()
+{
+    if (!m_encoder.context()) {
+        return; // 未启动
+    }
+    m_active.storeRelease(0);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_condition.wakeOne();
+    }
+    wait(); // 编码线程编码完信箱中的帧并刷新编码器后退出
+
+    m_packetFanout.stop();
+    av_packet_free(&m_packet);
+    m_encoder.close();
+    if (m_droppedFrames.load() > 0) {
+        qDebug() << "子码流跳过帧数:" << m_droppedFrames.load();
+    }
+}
+
+void SubstreamEncoder::submitFrame(const AVFrame *mainFrame, long long timestampUs)
+{
+    if (!m_active.loadAcquire() || !mainFrame) {
+        return;
+    }
+
+    // 按采集时间戳抽帧，允许四分之一帧间隔的提前量 (与采集线程的预览抽帧相同)
+    if (m_nextFrameUs >= 0 && timestampUs < m_nextFrameUs - m_frameIntervalUs / 4) {
+        return;
+    }
+    // 采集中断过 (超过一个间隔没有帧) 时从当前帧重新计时，否则按固定步长推进，平均帧率不漂移
+    if (m_nextFrameUs < 0 || timestampUs - m_nextFrameUs > m_frameIntervalUs) {
+        m_nextFrameUs = timestampUs + m_frameIntervalUs;
+    } else {
+        m_nextFrameUs += m_frameIntervalUs;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_hasPending) {
+            m_droppedFrames.fetchAndAddRelaxed(1); // 编码线程还没取走上一帧：跳过，不排队
+            return;
+        }
+    }
+
+    // 编码器可能仍引用这块缓冲区 (它曾经是 m_currentFrame)，写入前确保可写
+    if (av_frame_make_writable(m_workFrame) < 0) {
+        return;
+    }
+    pixconv_downscale_i420(mainFrame->data[0], mainFrame->linesize[0],
+                           mainFrame->data[1], mainFrame->linesize[1],
+                           mainFrame->data[2], mainFrame->linesize[2],
+                           mainFrame->width, mainFrame->height,
+                           m_workFrame->data[0], m_workFrame->linesize[0],
+                           m_workFrame->data[1], m_workFrame->linesize[1],
+                           m_workFrame->data[2], m_workFrame->linesize[2],
+                           m_width, m_height);
+
+    // 时间戳与主码流相同：相对第一帧的采集时间，换算到 1/90000 秒
+    if (m_firstTimestampUs < 0) {
+        m_firstTimestampUs = timestampUs;
+    }
+    int64_t pts = av_rescale_q(timestampUs - m_firstTimestampUs,
+                               AVRational{1, 1000000}, AVRational{1, PTS_CLOCK_RATE});
+    if (m_lastPts != AV_NOPTS_VALUE && pts <= m_lastPts) {
+        pts = m_lastPts + 1;
+    }
+    m_lastPts = pts;
+    m_workFrame->pts = pts;
+
+    QMutexLocker locker(&m_mutex);
+    std::swap(m_workFrame, m_pendingFrame);
+    m_hasPending = true;
+    m_condition.wakeOne();
+}
+
+void SubstreamEncoder::addPacketSink(PacketSink *sink)
+{
+    if (m_packetFanout.addSink(sink)) {
+        requestKeyFrame(); // 中途加入的消费者尽快从关键帧开始
+    }
+}
+
+void SubstreamEncoder::removePacketSink(PacketSink *sink)
+{
+    m_packetFanout.removeSink(sink);
+}
+
+bool SubstreamEncoder::latestImage(QImage *image)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!image || !m_hasImage || !m_currentFrame) {
+        return false;
+    }
+    // 编码线程只在锁内替换 m_currentFrame，编码期间它只被读取，可以同时转换
+    m_imageSws = sws_getCachedContext(m_imageSws, m_width, m_height, AV_PIX_FMT_YUV420P,
+                                      m_width, m_height, AV_PIX_FMT_RGB32,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!m_imageSws) {
+        return false;
+    }
+    QImage result(m_width, m_height, QImage::Format_RGB32);
+    uint8_t *dst[1] = {result.bits()};
+    int dstStrides[1] = {result.bytesPerLine()};
+    sws_scale(m_imageSws, m_currentFrame->data, m_currentFrame->linesize, 0, m_height, dst, dstStrides);
+    image->swap(result);
+    return true;
+}
+
+void SubstreamEncoder::run()
+{
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_hasPending && !m_stopRequested) {
+                m_condition.wait(&m_mutex);
+            }
+            if (!m_hasPending) {
+                break; // 已请求停止且信箱为空
+            }
+            std::swap(m_pendingFrame, m_currentFrame);
+            m_hasPending = false;
+            m_hasImage = true;
+        }
+
+        m_currentFrame->pict_type = AV_PICTURE_TYPE_NONE;
+        if (m_keyFrameRequested.loadAcquire() && m_keyFrameRequested.testAndSetOrdered(1, 0)) {
+            m_currentFrame->pict_type = AV_PICTURE_TYPE_I; // 新的远程观看者请求的 IDR
+        }
+        if (!encodeFrame(m_currentFrame)) {
+            m_active.storeRelease(0); // 编码器出错后不再接收帧，等 stopEncoding() 关闭
+            emit encodeError("子码流编码失败");
+            return;
+        }
+    }
+
+    encodeFrame(nullptr); // 刷新编码器，剩余的数据包照常分发
+}
+
+bool SubstreamEncoder::encodeFrame(AVFrame *frame)
+{
+    int ret = m_encoder.sendFrame(frame);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        return false;
+    }
+    for (;;) {
+        ret = m_encoder.receivePacket(m_packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        m_packetFanout.dispatch(m_packet);
+        av_packet_unref(m_packet);
+    }
+}
+
+void SubstreamEncoder::freeFrames()
+{
+    av_frame_free(&m_workFrame);
+    av_frame_free(&m_pendingFrame);
+    av_frame_free(&m_currentFrame);
+}
@@ -0,0 +1,190 @@
+#ifndef SUBSTREAMENCODER_H
+#define SUBSTREAMENCODER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QImage>
+
+#include "encoderbackend.h" // H.264 编码器后端 (子码流使用独立的编码器实例)
+#include "packetfanout.h"   // 子码流数据包分发给远程预览等消费者
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+/**
+ * @brief 低分辨率子码流编码器 (SubstreamEncoder)
+ *
+ * 与主码流录制同时编码一路小尺寸、低帧率、低码率的 H.264 子码流 (默认 320x240、5fps、约100kbps)，
+ * 供远程预览、缩略图等不需要全分辨率的场合使用：
+ * - 输入是录制线程已经转换好的主码流 YUV420P 帧 (`submitFrame()`)，只做一次按2的幂块平均缩小
+ *   (`pixconv_downscale_i420()`，2倍时为 SSE2 / NEON 内核)，不再重复色彩空间转换。
+ * - 按采集时间戳抽帧，子码流帧率以外的帧不做缩小。缩小后的帧通过单帧信箱交给本对象自己的线程编码，
+ *   使用独立的编码器实例：多核板子上主、子码流的软件编码在不同的核上并行，硬件编码器忙时子码流也不会阻塞录制。
+ *   编码线程跟不上时丢弃新帧而不排队。
+ * - 编码输出通过 `PacketFanout` 分发给已注册的 `PacketSink` (例如远程预览的 `NetworkStreamer`)。
+ * - `latestImage()` 把最近一帧子码流画面转换为 QImage，用于生成录像缩略图。
+ *
+ * 由 `RecordingThread` 在录制会话开始时 `startEncoding()`、结束时 `stopEncoding()`。
+ */
+class SubstreamEncoder : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 子码流参数，下一次 `startEncoding()` 生效。
+     */
+    struct Settings {
+        int maxWidth = 320;        ///< 最大宽度 (像素)：主码流宽度按2的幂缩小到不超过它。
+        int frameRate = 5;         ///< 子码流帧率 (fps)，不高于主码流的采集帧率。
+        int64_t bitRate = 100000;  ///< 目标比特率 (bps)。
+        int gopSeconds = 2;        ///< 关键帧间隔 (秒)，远程预览的新观看者最多等这么久看到画面。
+    };
+
+    explicit SubstreamEncoder(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止编码线程并释放编码器和帧缓冲区。
+     */
+    ~SubstreamEncoder();
+
+    /**
+     * @brief 设置子码流参数，下一次 `startEncoding()` 生效。
+     */
+    void setSettings(const Settings &settings);
+
+    /**
+     * @brief 设置候选编码器顺序，语义同 `EncoderBackend::setPreference()`。
+     *
+     * 默认为 libx264 优先：板载硬件编码器通常只有一个编码单元，留给主码流使用。
+     */
+    void setEncoderPreference(const QStringList &names);
+
+    /**
+     * @brief 按主码流尺寸打开子码流编码器并启动编码线程 (在开始录制的线程中调用)。
+     * @param mainWidth 主码流宽度 (像素)。
+     * @param mainHeight 主码流高度 (像素)。
+     * @param errorMsg 失败时输出错误描述，可为 nullptr。
+     * @return 成功返回 true；已在编码时返回 false。
+     */
+    bool startEncoding(int mainWidth, int mainHeight, QString *errorMsg = nullptr);
+
+    /**
+     * @brief 停止编码线程：编码完已提交的帧、刷新编码器并通知数据包消费者，然后关闭编码器。
+     *
+     * 最后一帧画面保留到下一次 `startEncoding()`，停止后仍可用 `latestImage()` 生成缩略图。未启动时调用无副作用。
+     */
+    void stopEncoding();
+
+    /**
+     * @brief 是否正在编码。线程安全。
+     */
+    bool isActive() const { return m_active.loadAcquire() != 0; }
+
+    /**
+     * @brief 子码流宽度 (像素)，未启动过时为0。
+     */
+    int width() const { return m_width; }
+
+    /**
+     * @brief 子码流高度 (像素)，未启动过时为0。
+     */
+    int height() const { return m_height; }
+
+    /**
+     * @brief 提交一帧主码流 YUV420P 图像 (在录制线程中调用，只读 mainFrame)。
+     * @param mainFrame 录制线程转换好的主码流帧，尺寸与 `startEncoding()` 的参数一致。
+     * @param timestampUs 采集时间戳 (微秒，CLOCK_MONOTONIC)。
+     *
+     * 未到子码流的下一帧时刻或编码线程仍有未取走的帧时直接返回，不做缩小。
+     */
+    void submitFrame(const AVFrame *mainFrame, long long timestampUs);
+
+    /**
+     * @brief 注册子码流数据包消费者，语义同 `RecordingThread::addPacketSink()`。
+     */
+    void addPacketSink(PacketSink *sink);
+
+    /**
+     * @brief 注销子码流数据包消费者，返回后不会再回调它。
+     */
+    void removePacketSink(PacketSink *sink);
+
+    /**
+     * @brief 请求子码流的下一帧编码为 IDR。线程安全。
+     */
+    void requestKeyFrame() { m_keyFrameRequested.storeRelease(1); }
+
+    /**
+     * @brief 把最近编码的一帧子码流画面转换为 RGB32 图像 (任意线程)。
+     * @param image 输出图像，尺寸为子码流尺寸。
+     * @return 还没有编码过任何一帧时返回 false。
+     */
+    bool latestImage(QImage *image);
+
+    /**
+     * @brief 本次编码因编码线程跟不上而跳过的帧数。线程安全。
+     */
+    int droppedFrames() const { return m_droppedFrames.load(); }
+
+signals:
+    /**
+     * @brief 子码流编码出错时发出 (主码流录制不受影响)。
+     * @param errorMsg 错误描述信息。
+     */
+    void encodeError(const QString &errorMsg);
+
+protected:
+    /**
+     * @brief 编码线程主循环：从信箱取帧编码，停止时刷新编码器。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 把一帧 (或 nullptr 表示刷新) 送入编码器，取出的数据包交给消费者。
+     * @return 编码出错返回 false。
+     */
+    bool encodeFrame(AVFrame *frame);
+
+    /**
+     * @brief 释放三个帧缓冲区。
+     */
+    void freeFrames();
+
+    static const int PTS_CLOCK_RATE = 90000; ///< 编码器时间基为 1/90000 秒，与主码流一致。
+
+    EncoderBackend m_encoder;      ///< 子码流独立的编码器实例。
+    Settings m_settings;           ///< `setSettings()` 设置的参数。由 `m_mutex` 保护。
+    int m_width;                   ///< 子码流宽度 (像素)。只在空闲时修改。
+    int m_height;                  ///< 子码流高度 (像素)。只在空闲时修改。
+    long long m_frameIntervalUs;   ///< 子码流帧间隔 (微秒)。只在空闲时修改。
+    PacketFanout m_packetFanout;   ///< 子码流数据包的分发器。
+    AVPacket *m_packet;            ///< 编码输出包，只在编码线程中访问。
+
+    mutable QMutex m_mutex;        ///< 保护信箱 (`m_pendingFrame` / `m_hasPending`)、`m_currentFrame` 和缩略图转换。
+    QWaitCondition m_condition;   ///< 信箱有新帧或请求停止时唤醒编码线程。
+    AVFrame *m_workFrame;          ///< 录制线程写入缩小结果的帧，只在录制线程中访问。
+    AVFrame *m_pendingFrame;       ///< 信箱：等待编码的帧。由 `m_mutex` 保护。
+    AVFrame *m_currentFrame;       ///< 正在编码或最近编码的帧 (编码线程写，`latestImage()` 在锁内读)。
+    bool m_hasPending;             ///< 信箱中有帧。由 `m_mutex` 保护。
+    bool m_hasImage;               ///< `m_currentFrame` 中有已编码的画面。由 `m_mutex` 保护。
+    bool m_stopRequested;          ///< 请求编码线程退出。由 `m_mutex` 保护。
+    SwsContext *m_imageSws;        ///< 缩略图 YUV420P -> RGB32 转换上下文。由 `m_mutex` 保护。
+
+    // 以下只在录制线程 (生产者) 中访问
+    long long m_firstTimestampUs;  ///< 第一帧的采集时间戳 (微秒)，-1 表示尚未收到帧。
+    long long m_nextFrameUs;       ///< 下一帧的最早采集时间戳 (微秒)，-1 表示下一帧直接编码。
+    int64_t m_lastPts;             ///< 上一帧的显示时间戳，保证严格递增。
+
+    QAtomicInt m_active;           ///< 正在编码时为1 (`submitFrame()` 只读取这一个原子变量)。
+    QAtomicInt m_keyFrameRequested;///< `requestKeyFrame()` 设置，编码线程在下一帧消费。
+    QAtomicInt m_droppedFrames;    ///< 本次编码跳过的帧数。
+};
+
+#endif // SUBSTREAMENCODER_H
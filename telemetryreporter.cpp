@@ -0,0 +1,247 @@
+/**
+ * @file telemetryreporter.cpp
+ * @brief 流水线计量定期汇报 (TelemetryReporter) 的实现文件。
+ */
+
+#include "telemetryreporter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStringList>
+#include <QDebug>
+
+#include <cstdio> // rename
+
+namespace {
+
+/**
+ * @brief 微秒换算为秒的文本 (Prometheus 的时间单位为秒)。
+ */
+QByteArray seconds(qint64 us)
+{
+    return QByteArray::number(us / 1000000.0, 'g', 9);
+}
+
+/**
+ * @brief 一个指标家族的 HELP 和 TYPE 行。
+ */
+void appendFamily(QByteArray &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+    out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+}
+
+/**
+ * @brief 一行样本：name{labels} value。
+ */
+void appendSample(QByteArray &out, const char *name, const QByteArray &labels, const QByteArray &value)
+{
+    out += name;
+    out += '{'; out += labels; out += "} ";
+    out += value;
+    out += '\n';
+}
+
+} // namespace
+
+TelemetryReporter::TelemetryReporter(QObject *parent)
+    : QObject(parent)
+    , m_dumpFailed(false)
+{
+    connect(&m_timer, &QTimer::timeout, this, &TelemetryReporter::sample);
+}
+
+void TelemetryReporter::addSource(int channel, PipelineMetrics *metrics)
+{
+    if (!metrics) {
+        return;
+    }
+    Source source;
+    source.channel = channel;
+    source.metrics = metrics;
+    m_sources.append(source);
+}
+
+void TelemetryReporter::clearSources()
+{
+    m_sources.clear();
+}
+
+void TelemetryReporter::setDumpPath(const QString &path)
+{
+    m_dumpPath = path;
+    m_dumpFailed = false;
+}
+
+void TelemetryReporter::start(int intervalMs)
+{
+    m_timer.start(qMax(100, intervalMs));
+}
+
+void TelemetryReporter::stop()
+{
+    m_timer.stop();
+}
+
+void TelemetryReporter::sample()
+{
+    QStringList lines;
+    for (Source &source : m_sources) {
+        const PipelineMetrics::Snapshot previous = source.current;
+        source.current = source.metrics->snapshot();
+        source.interval = source.current.since(previous);
+        source.intervalUs = source.current.timeUs - previous.timeUs;
+        if (source.hasPrevious) {
+            lines << overlayLine(source);
+        }
+        source.hasPrevious = true;
+    }
+    emit sampled(lines.join("\n"));
+
+    if (!m_dumpPath.isEmpty()) {
+        writeDump(dumpText());
+    }
+}
+
+QString TelemetryReporter::overlayLine(const Source &source)
+{
+    const PipelineMetrics::Snapshot &delta = source.interval;
+    const double elapsedS = qMax<qint64>(1, source.intervalUs) / 1000000.0;
+
+    // 各阶段最近一个周期的 p95 (毫秒)
+    static const char *const shortNames[PipelineMetrics::STAGE_COUNT] = {"cap", "que", "cvt", "enc", "wr", "all"};
+    QStringList stages;
+    for (int s = 0; s < PipelineMetrics::STAGE_COUNT; ++s) {
+        const PipelineMetrics::Stage stage = static_cast<PipelineMetrics::Stage>(s);
+        stages << QString("%1 %2").arg(shortNames[s])
+                  .arg(delta.percentileUs(stage, 0.95) / 1000.0, 0, 'f', 1);
+    }
+    QString line = QString("CAM%1 %2fps 队列 %3/%4 (峰值 %5) 丢帧 %6 | p95 ms: %7 | %8 KB/s")
+            .arg(source.channel)
+            .arg(delta.framesEncoded / elapsedS, 0, 'f', 1)
+            .arg(delta.queueDepth).arg(delta.queueCapacity).arg(delta.queueHighWater)
+            .arg(source.current.framesDropped)
+            .arg(stages.join(" "))
+            .arg(delta.bytesWritten / 1024.0 / elapsedS, 0, 'f', 0);
+    if (delta.encoderCpuUs >= 0) {
+        line += QString(" | CPU %1%").arg(100.0 * delta.encoderCpuUs / qMax<qint64>(1, source.intervalUs), 0, 'f', 0);
+    }
+    return line;
+}
+
+QByteArray TelemetryReporter::dumpText() const
+{
+    QByteArray out;
+    QList<QByteArray> channelLabels;
+    for (const Source &source : m_sources) {
+        channelLabels << "channel=\"" + QByteArray::number(source.channel) + "\"";
+    }
+
+    // 各阶段耗时直方图 (累计，桶按 le 上界累加)
+    appendFamily(out, "vs_stage_latency_seconds", "histogram",
+                 "Per-stage latency of the recording pipeline, from the V4L2 DQBUF timestamp.");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const PipelineMetrics::Snapshot &snap = m_sources.at(i).current;
+        for (int s = 0; s < PipelineMetrics::STAGE_COUNT; ++s) {
+            const QByteArray labels = channelLabels.at(i) + ",stage=\""
+                    + PipelineMetrics::stageName(static_cast<PipelineMetrics::Stage>(s)) + "\"";
+            quint64 cumulative = 0;
+            for (int b = 0; b < PipelineMetrics::BUCKET_COUNT; ++b) {
+                cumulative += snap.buckets[s][b];
+                const qint64 upper = PipelineMetrics::bucketUpperUs(b);
+                appendSample(out, "vs_stage_latency_seconds_bucket",
+                             labels + ",le=\"" + (upper >= 0 ? seconds(upper) : QByteArray("+Inf")) + "\"",
+                             QByteArray::number(cumulative));
+            }
+            appendSample(out, "vs_stage_latency_seconds_sum", labels, seconds(snap.sumUs[s]));
+            appendSample(out, "vs_stage_latency_seconds_count", labels, QByteArray::number(snap.samples[s]));
+        }
+    }
+
+    appendFamily(out, "vs_stage_latency_max_seconds", "gauge", "Maximum per-stage latency over the last report interval.");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        for (int s = 0; s < PipelineMetrics::STAGE_COUNT; ++s) {
+            appendSample(out, "vs_stage_latency_max_seconds",
+                         channelLabels.at(i) + ",stage=\"" + PipelineMetrics::stageName(static_cast<PipelineMetrics::Stage>(s)) + "\"",
+                         seconds(m_sources.at(i).current.maxUs[s]));
+        }
+    }
+
+    // 累计计数器
+    struct Counter { const char *name; const char *type; const char *help; };
+    static const Counter counters[] = {
+        {"vs_frames_queued_total", "counter", "Frames copied into the encoder queue."},
+        {"vs_frames_dropped_total", "counter", "Frames dropped because the encoder queue was full."},
+        {"vs_frames_encoded_total", "counter", "Frames submitted to the encoder."},
+        {"vs_bytes_written_total", "counter", "Bytes written to recording files."},
+        {"vs_queue_depth", "gauge", "Current encoder queue depth (frames)."},
+        {"vs_queue_high_water", "gauge", "Maximum encoder queue depth over the last report interval."},
+        {"vs_queue_capacity", "gauge", "Encoder queue capacity (frames)."},
+    };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); ++c) {
+        appendFamily(out, counters[c].name, counters[c].type, counters[c].help);
+        for (int i = 0; i < m_sources.size(); ++i) {
+            const PipelineMetrics::Snapshot &snap = m_sources.at(i).current;
+            const qint64 values[] = {snap.framesQueued, snap.framesDropped, snap.framesEncoded, snap.bytesWritten,
+                                     snap.queueDepth, snap.queueHighWater, snap.queueCapacity};
+            appendSample(out, counters[c].name, channelLabels.at(i), QByteArray::number(values[c]));
+        }
+    }
+
+    // 编码线程 CPU 时间 (编码线程未运行时不输出)
+    appendFamily(out, "vs_encoder_cpu_seconds_total", "counter", "CPU time consumed by the encoder thread.");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        if (m_sources.at(i).current.encoderCpuUs >= 0) {
+            appendSample(out, "vs_encoder_cpu_seconds_total", channelLabels.at(i), seconds(m_sources.at(i).current.encoderCpuUs));
+        }
+    }
+
+    // 最近一个周期的速率 (不能自己求速率的采集端直接使用)，第一次汇报时没有
+    appendFamily(out, "vs_encode_fps", "gauge", "Encoded frames per second over the last report interval.");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const Source &source = m_sources.at(i);
+        if (source.hasPrevious && source.intervalUs > 0) {
+            appendSample(out, "vs_encode_fps", channelLabels.at(i),
+                         QByteArray::number(source.interval.framesEncoded * 1000000.0 / source.intervalUs, 'f', 2));
+        }
+    }
+    appendFamily(out, "vs_write_bytes_per_second", "gauge", "Bytes written per second over the last report interval.");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const Source &source = m_sources.at(i);
+        if (source.hasPrevious && source.intervalUs > 0) {
+            appendSample(out, "vs_write_bytes_per_second", channelLabels.at(i),
+                         QByteArray::number(source.interval.bytesWritten * 1000000.0 / source.intervalUs, 'f', 0));
+        }
+    }
+    appendFamily(out, "vs_encoder_cpu_ratio", "gauge", "Encoder thread CPU usage over the last report interval (1 = one core).");
+    for (int i = 0; i < m_sources.size(); ++i) {
+        const Source &source = m_sources.at(i);
+        if (source.hasPrevious && source.intervalUs > 0 && source.interval.encoderCpuUs >= 0) {
+            appendSample(out, "vs_encoder_cpu_ratio", channelLabels.at(i),
+                         QByteArray::number(static_cast<double>(source.interval.encoderCpuUs) / source.intervalUs, 'f', 3));
+        }
+    }
+    return out;
+}
+
+bool TelemetryReporter::writeDump(const QByteArray &text)
+{
+    // 先写同一目录下的临时文件再 rename (原子替换)，采集端读到的总是完整的一份
+    const QString tmpPath = m_dumpPath + ".tmp";
+    QDir().mkpath(QFileInfo(m_dumpPath).absolutePath());
+    QFile tmp(tmpPath);
+    bool ok = tmp.open(QIODevice::WriteOnly | QIODevice::Truncate) && tmp.write(text) == text.size();
+    tmp.close();
+    if (ok) {
+        ok = ::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(m_dumpPath).constData()) == 0;
+    }
+    if (!ok) {
+        QFile::remove(tmpPath);
+        if (!m_dumpFailed) {
+            qWarning() << "TelemetryReporter: 无法写入计量文件" << m_dumpPath;
+        }
+    }
+    m_dumpFailed = !ok;
+    return ok;
+}
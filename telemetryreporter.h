@@ -0,0 +1,104 @@
+#ifndef TELEMETRYREPORTER_H
+#define TELEMETRYREPORTER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+#include <QString>
+
+#include "pipelinemetrics.h"
+
+/**
+ * @brief 流水线计量的定期汇报 (TelemetryReporter)
+ *
+ * 在 GUI 线程中按固定周期读取各路录制线程的 `PipelineMetrics`，求出最近一个周期的帧率、写入速率、
+ * 编码线程 CPU 占用和各阶段耗时的百分位数：
+ * - `sampled()` 信号带一段简短的文字 (每路一行)，供监控页面的叠加层显示；
+ * - 设置了导出路径时，把所有计量按 Prometheus 文本格式写入该文件 (先写临时文件再 rename，读取方
+ *   不会看到写了一半的内容)，供 node_exporter 的 textfile collector 等采集程序抓取。
+ * 直方图和计数器是从程序启动起的累计值 (求速率和区间分布由采集端完成)，另外导出最近一个周期的速率和最大值。
+ */
+class TelemetryReporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TelemetryReporter(QObject *parent = nullptr);
+
+    /**
+     * @brief 添加一路计量来源。metrics 须比本对象存活得更久 (或在其销毁前 `clearSources()`)。
+     * @param channel 通道序号 (导出时的 channel 标签)。
+     */
+    void addSource(int channel, PipelineMetrics *metrics);
+
+    /**
+     * @brief 移除所有来源。
+     */
+    void clearSources();
+
+    /**
+     * @brief 设置导出文件的路径，为空时不导出。
+     */
+    void setDumpPath(const QString &path);
+
+    /**
+     * @brief 开始定期汇报。
+     * @param intervalMs 周期 (毫秒)。
+     */
+    void start(int intervalMs = DEFAULT_INTERVAL_MS);
+
+    /**
+     * @brief 停止定期汇报。
+     */
+    void stop();
+
+signals:
+    /**
+     * @brief 完成一次汇报。
+     * @param overlayText 叠加层显示的文字 (每路一行)。
+     */
+    void sampled(const QString &overlayText);
+
+private slots:
+    /**
+     * @brief 读取所有来源，更新叠加层文字并导出。
+     */
+    void sample();
+
+private:
+    /**
+     * @brief 一路来源及其上一次读数。
+     */
+    struct Source {
+        int channel = 0;
+        PipelineMetrics *metrics = nullptr;
+        PipelineMetrics::Snapshot current;  ///< 本次读数。
+        PipelineMetrics::Snapshot interval; ///< 本次相对上一次的增量。
+        qint64 intervalUs = 0;              ///< 两次读数之间的时间 (微秒)。
+        bool hasPrevious = false;           ///< 是否已有上一次读数 (第一次汇报时增量无意义)。
+    };
+
+    /**
+     * @brief 一路的叠加层文字。
+     */
+    static QString overlayLine(const Source &source);
+
+    /**
+     * @brief 生成 Prometheus 文本格式的导出内容。
+     */
+    QByteArray dumpText() const;
+
+    /**
+     * @brief 把导出内容原子地写入 `m_dumpPath`。
+     */
+    bool writeDump(const QByteArray &text);
+
+    static const int DEFAULT_INTERVAL_MS = 1000; ///< 默认汇报周期 (毫秒)。
+
+    QTimer m_timer;          ///< 汇报定时器。
+    QList<Source> m_sources; ///< 各路来源。
+    QString m_dumpPath;      ///< 导出文件路径，为空时不导出。
+    bool m_dumpFailed;       ///< 上一次导出失败 (只在第一次失败时输出警告)。
+};
+
+#endif // TELEMETRYREPORTER_H
@@ -0,0 +1,251 @@
+/**
+ * @file timelineloader.cpp
+ * @brief 播放页后台关键帧解码线程 (TimelineLoader) 的实现文件。
+ *
+ * 每个请求只解码一个 I 帧：定位后跳过非关键帧的数据包，把第一个关键帧送入解码器并取出 (必要时排空)，
+ * 下一次定位前清空解码器。解码器只用一个线程，不引入帧级线程的延迟。
+ */
+
+#include "timelineloader.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+TimelineLoader::TimelineLoader(QObject *parent)
+    : QThread(parent)
+    , m_stopRequested(false)
+    , m_hasKeyFrame(false)
+    , m_keyFrameGeneration(0)
+    , m_stripGeneration(0)
+    , m_nextStripSlot(0)
+    , m_formatContext(nullptr)
+    , m_decoder(nullptr)
+    , m_streamIndex(-1)
+    , m_packet(nullptr)
+    , m_frame(nullptr)
+    , m_sws(nullptr)
+{
+}
+
+TimelineLoader::~TimelineLoader()
+{
+    stopLoader();
+}
+
+void TimelineLoader::startLoader()
+{
+    if (isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = false;
+    }
+    start(QThread::LowPriority);
+}
+
+void TimelineLoader::stopLoader()
+{
+    if (!isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_condition.wakeOne();
+    }
+    wait();
+}
+
+void TimelineLoader::requestStrip(int generation, const QString &videoPath,
+                                  const QVector<KeyFrameIndex::Entry> &frames, const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stripGeneration = generation;
+    m_stripPath = videoPath;
+    m_stripFrames = frames;
+    m_nextStripSlot = 0;
+    m_stripSize = size;
+    m_condition.wakeOne();
+}
+
+void TimelineLoader::requestKeyFrame(int generation, const QString &videoPath,
+                                     const KeyFrameIndex::Entry &frame, const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_keyFrameGeneration = generation;
+    m_keyFramePath = videoPath;
+    m_keyFrame = frame;
+    m_keyFrameSize = size;
+    m_hasKeyFrame = true;
+    m_condition.wakeOne();
+}
+
+void TimelineLoader::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_hasKeyFrame = false;
+    m_stripFrames.clear();
+    m_nextStripSlot = 0;
+}
+
+void TimelineLoader::run()
+{
+    m_packet = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    forever {
+        bool keyFrameRequest = false;
+        int generation = 0;
+        int slot = -1;
+        QString path;
+        KeyFrameIndex::Entry frame;
+        QSize size;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (!m_stopRequested && !m_hasKeyFrame && m_nextStripSlot >= m_stripFrames.size()) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_stopRequested) {
+                break;
+            }
+            if (m_hasKeyFrame) {
+                // 快进画面优先：用户正在看，缩略图条晚一点出现没有关系
+                keyFrameRequest = true;
+                generation = m_keyFrameGeneration;
+                path = m_keyFramePath;
+                frame = m_keyFrame;
+                size = m_keyFrameSize;
+                m_hasKeyFrame = false;
+            } else {
+                slot = m_nextStripSlot++;
+                generation = m_stripGeneration;
+                path = m_stripPath;
+                frame = m_stripFrames.at(slot);
+                size = m_stripSize;
+            }
+        }
+
+        QImage image;
+        qint64 decodedMs = frame.ptsMs;
+        if (m_packet && m_frame && openFile(path)) {
+            image = decodeKeyFrame(frame, size, &decodedMs);
+        }
+        if (keyFrameRequest) {
+            emit keyFrameReady(generation, frame.ptsMs, image);
+        } else if (!image.isNull()) {
+            emit stripFrameReady(generation, slot, decodedMs, image);
+        }
+    }
+    closeFile();
+    av_frame_free(&m_frame);
+    av_packet_free(&m_packet);
+}
+
+bool TimelineLoader::openFile(const QString &videoPath)
+{
+    if (m_formatContext && m_openPath == videoPath) {
+        return true;
+    }
+    closeFile();
+    if (avformat_open_input(&m_formatContext, videoPath.toLocal8Bit().constData(), nullptr, nullptr) < 0) {
+        m_formatContext = nullptr;
+        return false;
+    }
+    // 录像文件自带完整的流参数，不需要 avformat_find_stream_info() 预读
+    m_streamIndex = av_find_best_stream(m_formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    const AVCodec *codec = m_streamIndex >= 0
+            ? avcodec_find_decoder(m_formatContext->streams[m_streamIndex]->codecpar->codec_id) : nullptr;
+    if (codec) {
+        m_decoder = avcodec_alloc_context3(codec);
+    }
+    if (!m_decoder || avcodec_parameters_to_context(m_decoder, m_formatContext->streams[m_streamIndex]->codecpar) < 0) {
+        closeFile();
+        return false;
+    }
+    m_decoder->thread_count = 1; // 每次只解码一帧
+    if (avcodec_open2(m_decoder, codec, nullptr) < 0) {
+        qWarning() << "TimelineLoader: 无法打开解码器:" << videoPath;
+        closeFile();
+        return false;
+    }
+    m_openPath = videoPath;
+    return true;
+}
+
+void TimelineLoader::closeFile()
+{
+    sws_freeContext(m_sws);
+    m_sws = nullptr;
+    avcodec_free_context(&m_decoder);
+    avformat_close_input(&m_formatContext);
+    m_streamIndex = -1;
+    m_openPath.clear();
+}
+
+QImage TimelineLoader::decodeKeyFrame(const KeyFrameIndex::Entry &frame, const QSize &size, qint64 *decodedMs)
+{
+    AVStream *stream = m_formatContext->streams[m_streamIndex];
+    // 播放器的位置从文件的开始时间算起 (TS 封装会给时间戳加上固定的延迟)
+    const int64_t startTime = (m_formatContext->start_time != AV_NOPTS_VALUE) ? m_formatContext->start_time : 0;
+    int ret = -1;
+    if (frame.offset >= 0 && !(m_formatContext->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        ret = av_seek_frame(m_formatContext, -1, frame.offset, AVSEEK_FLAG_BYTE);
+    }
+    if (ret < 0) {
+        const int64_t target = av_rescale_q(frame.ptsMs * 1000 + startTime, AVRational{1, AV_TIME_BASE}, stream->time_base);
+        ret = av_seek_frame(m_formatContext, m_streamIndex, target, AVSEEK_FLAG_BACKWARD);
+    }
+    if (ret < 0) {
+        return QImage();
+    }
+    avcodec_flush_buffers(m_decoder); // 丢弃上一次定位留下的参考帧，同时退出排空状态
+
+    // 跳过定位点之后的非关键帧，只把第一个关键帧送入解码器
+    bool sent = false;
+    int64_t keyPts = AV_NOPTS_VALUE;
+    for (int i = 0; i < MAX_SEEK_PACKETS && !sent; ++i) {
+        if (av_read_frame(m_formatContext, m_packet) < 0) {
+            break;
+        }
+        if (m_packet->stream_index == m_streamIndex && (m_packet->flags & AV_PKT_FLAG_KEY)) {
+            keyPts = (m_packet->pts != AV_NOPTS_VALUE) ? m_packet->pts : m_packet->dts;
+            sent = avcodec_send_packet(m_decoder, m_packet) >= 0;
+        }
+        av_packet_unref(m_packet);
+    }
+    if (!sent) {
+        return QImage();
+    }
+    bool gotFrame = avcodec_receive_frame(m_decoder, m_frame) >= 0;
+    if (!gotFrame) {
+        avcodec_send_packet(m_decoder, nullptr); // 解码器有输出延迟：排空取出这一帧
+        gotFrame = avcodec_receive_frame(m_decoder, m_frame) >= 0;
+    }
+    if (!gotFrame || m_frame->width <= 0 || m_frame->height <= 0) {
+        return QImage();
+    }
+    if (decodedMs && keyPts != AV_NOPTS_VALUE) {
+        *decodedMs = av_rescale_q(keyPts, stream->time_base, AVRational{1, 1000}) - startTime / 1000;
+    }
+
+    const QSize target = QSize(m_frame->width, m_frame->height).scaled(size, Qt::KeepAspectRatio);
+    m_sws = sws_getCachedContext(m_sws, m_frame->width, m_frame->height, static_cast<AVPixelFormat>(m_frame->format),
+                                 target.width(), target.height(), AV_PIX_FMT_RGB32,
+                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+    QImage image;
+    if (m_sws) {
+        QImage scaled(target, QImage::Format_RGB32);
+        uint8_t *dst[1] = {scaled.bits()};
+        int dstStrides[1] = {scaled.bytesPerLine()};
+        sws_scale(m_sws, m_frame->data, m_frame->linesize, 0, m_frame->height, dst, dstStrides);
+        image.swap(scaled);
+    }
+    av_frame_unref(m_frame);
+    return image;
+}
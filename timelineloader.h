@@ -0,0 +1,135 @@
+#ifndef TIMELINELOADER_H
+#define TIMELINELOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QString>
+#include <QImage>
+#include <QSize>
+
+#include "keyframeindex.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+struct SwsContext;
+
+/**
+ * @brief 播放页的后台关键帧解码线程 (TimelineLoader)
+ *
+ * 由 `VideoPage` 拥有，在 `QMediaPlayer` 之外单独打开录像文件，只解码关键帧：
+ * - `requestStrip()`：进度条下方缩略图条的各个位置，每处定位到关键帧后只解码这一个 I 帧。
+ * - `requestKeyFrame()`：8 倍速 / 逐关键帧快进时要显示的下一个关键帧。只保留最新的一个请求，优先于缩略图条。
+ * 定位使用 `KeyFrameIndex` 记录的字节位置 (TS 等支持按字节定位的封装，不需要在文件中二分查找时间戳)，
+ * 否则按时间戳定位 (MP4 的样本表)。同一文件的连续请求复用已打开的解封装器和解码器。
+ * 结果带调用者的 generation 返回，切换文件后过期的结果由调用者丢弃。所有请求方法都是线程安全的。
+ */
+class TimelineLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineLoader(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止线程。
+     */
+    ~TimelineLoader();
+
+    /**
+     * @brief 启动解码线程 (低优先级)。已启动时无副作用。
+     */
+    void startLoader();
+
+    /**
+     * @brief 停止解码线程，正在解码的帧完成后返回，打开的文件随之关闭。
+     */
+    void stopLoader();
+
+    /**
+     * @brief 请求缩略图条，替换尚未完成的缩略图条请求。
+     * @param generation 调用者的播放编号，随结果返回。
+     * @param videoPath 录像文件路径。
+     * @param frames 各个位置要解码的关键帧 (offset 为 -1 时按时间定位)，第 i 个结果的 slot 为 i。
+     * @param size 缩略图的最大尺寸 (保持宽高比)。
+     */
+    void requestStrip(int generation, const QString &videoPath, const QVector<KeyFrameIndex::Entry> &frames, const QSize &size);
+
+    /**
+     * @brief 请求解码一个关键帧 (快进显示)，替换尚未开始的上一个请求。
+     */
+    void requestKeyFrame(int generation, const QString &videoPath, const KeyFrameIndex::Entry &frame, const QSize &size);
+
+    /**
+     * @brief 丢弃所有尚未完成的请求 (离开播放页或切换文件时调用)。
+     */
+    void cancel();
+
+signals:
+    /**
+     * @brief 缩略图条的一个位置已解码 (在解码线程中发出)。
+     * @param slot 在 `requestStrip()` 的 frames 中的下标。
+     * @param ptsMs 实际解码的关键帧时间 (毫秒)。
+     */
+    void stripFrameReady(int generation, int slot, qint64 ptsMs, const QImage &image);
+
+    /**
+     * @brief `requestKeyFrame()` 的关键帧已解码 (在解码线程中发出)，失败时 image 为空。
+     * @param ptsMs 请求的关键帧时间 (毫秒)。
+     */
+    void keyFrameReady(int generation, qint64 ptsMs, const QImage &image);
+
+protected:
+    /**
+     * @brief 线程主循环：先处理快进关键帧请求，再逐个处理缩略图条的位置。
+     */
+    void run() override;
+
+private:
+    /**
+     * @brief 打开录像文件和解码器 (已打开同一文件时直接返回)。
+     */
+    bool openFile(const QString &videoPath);
+
+    /**
+     * @brief 关闭已打开的文件和解码器。
+     */
+    void closeFile();
+
+    /**
+     * @brief 定位到一个关键帧并只解码这一帧，缩小到 size 以内。
+     * @param decodedMs 输出实际解码的帧时间 (毫秒)，可为 nullptr。
+     * @return 失败时返回空图像。
+     */
+    QImage decodeKeyFrame(const KeyFrameIndex::Entry &frame, const QSize &size, qint64 *decodedMs);
+
+    static const int MAX_SEEK_PACKETS = 256; ///< 定位后寻找关键帧时最多读取的数据包数。
+
+    QMutex m_mutex;                ///< 保护以下请求成员。
+    QWaitCondition m_condition;    ///< 有新请求或停止时唤醒线程。
+    bool m_stopRequested;          ///< 停止请求。
+    bool m_hasKeyFrame;            ///< 有尚未开始的快进关键帧请求。
+    int m_keyFrameGeneration;      ///< 快进请求的编号。
+    QString m_keyFramePath;        ///< 快进请求的文件。
+    KeyFrameIndex::Entry m_keyFrame; ///< 快进请求的关键帧。
+    QSize m_keyFrameSize;          ///< 快进请求的最大尺寸。
+    int m_stripGeneration;         ///< 缩略图条请求的编号。
+    QString m_stripPath;           ///< 缩略图条请求的文件。
+    QVector<KeyFrameIndex::Entry> m_stripFrames; ///< 缩略图条的各个位置。
+    int m_nextStripSlot;           ///< 下一个要解码的位置，等于 m_stripFrames.size() 时缩略图条已完成。
+    QSize m_stripSize;             ///< 缩略图的最大尺寸。
+
+    // 以下只在解码线程中访问
+    QString m_openPath;            ///< 已打开的文件，为空表示未打开。
+    AVFormatContext *m_formatContext; ///< 已打开文件的解封装上下文。
+    AVCodecContext *m_decoder;     ///< 视频解码器 (单线程，每帧之前清空)。
+    int m_streamIndex;             ///< 视频流下标。
+    AVPacket *m_packet;            ///< 读取用的数据包。
+    AVFrame *m_frame;              ///< 解码输出帧。
+    SwsContext *m_sws;             ///< 缩小并转换为 RGB32 的转换器 (尺寸不变时复用)。
+};
+
+#endif // TIMELINELOADER_H
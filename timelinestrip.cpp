@@ -0,0 +1,93 @@
+/**
+ * @file timelinestrip.cpp
+ * @brief 缩略图条 (TimelineStrip) 的实现文件。
+ */
+
+#include "timelinestrip.h"
+
+#include <QPainter>
+#include <QMouseEvent>
+
+TimelineStrip::TimelineStrip(QWidget *parent)
+    : QWidget(parent)
+    , m_durationMs(0)
+    , m_positionMs(0)
+{
+}
+
+void TimelineStrip::reset(int slotCount, qint64 durationMs)
+{
+    m_slots.clear();
+    m_slots.resize(slotCount);
+    m_durationMs = durationMs;
+    m_positionMs = 0;
+    update();
+}
+
+void TimelineStrip::setFrame(int slot, qint64 ptsMs, const QImage &image)
+{
+    if (slot < 0 || slot >= m_slots.size()) {
+        return;
+    }
+    m_slots[slot].pixmap = QPixmap::fromImage(image);
+    m_slots[slot].ptsMs = ptsMs;
+    update(slotRect(slot));
+}
+
+void TimelineStrip::setPosition(qint64 positionMs)
+{
+    if (positionMs == m_positionMs || m_durationMs <= 0) {
+        return;
+    }
+    m_positionMs = positionMs;
+    update();
+}
+
+QSize TimelineStrip::sizeHint() const
+{
+    return QSize(480, 48);
+}
+
+QRect TimelineStrip::slotRect(int slot) const
+{
+    if (m_slots.isEmpty()) {
+        return QRect();
+    }
+    const int left = width() * slot / m_slots.size();
+    const int right = width() * (slot + 1) / m_slots.size();
+    return QRect(left, 0, right - left, height());
+}
+
+void TimelineStrip::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    for (int i = 0; i < m_slots.size(); ++i) {
+        const QRect cell = slotRect(i).adjusted(1, 1, -1, -1);
+        const QPixmap &pixmap = m_slots.at(i).pixmap;
+        if (pixmap.isNull() || cell.isEmpty()) {
+            continue;
+        }
+        // 保持宽高比居中显示 (缩略图已按格的大小解码，这里只做少量缩放)
+        const QSize scaled = pixmap.size().scaled(cell.size(), Qt::KeepAspectRatio);
+        const QRect target(cell.x() + (cell.width() - scaled.width()) / 2,
+                           cell.y() + (cell.height() - scaled.height()) / 2,
+                           scaled.width(), scaled.height());
+        painter.drawPixmap(target, pixmap);
+    }
+    if (m_durationMs > 0) {
+        const int x = static_cast<int>(width() * qBound<qint64>(0, m_positionMs, m_durationMs) / m_durationMs);
+        painter.fillRect(QRect(x - 1, 0, 2, height()), Qt::white);
+    }
+}
+
+void TimelineStrip::mousePressEvent(QMouseEvent *event)
+{
+    if (m_slots.isEmpty() || m_durationMs <= 0 || width() <= 0) {
+        return;
+    }
+    const int x = qBound(0, event->pos().x(), width() - 1);
+    const int slot = x * m_slots.size() / width();
+    const qint64 ptsMs = m_slots.at(slot).ptsMs;
+    emit seekRequested(ptsMs >= 0 ? ptsMs : m_durationMs * x / width());
+}
@@ -0,0 +1,73 @@
+#ifndef TIMELINESTRIP_H
+#define TIMELINESTRIP_H
+
+#include <QWidget>
+#include <QVector>
+#include <QPixmap>
+
+/**
+ * @brief 进度条下方的缩略图条 (TimelineStrip)
+ *
+ * 把录像等分为若干格，每格显示该段中一个关键帧的缩略图 (由 `TimelineLoader` 在后台解码，
+ * 尚未解码的格显示为空白)，并用一条竖线标出当前播放位置。点击一格时发出 `seekRequested()`，
+ * 位置为该格缩略图对应的关键帧 (解码器直接从这个关键帧开始)，缩略图尚未加载时为点击处对应的时间。
+ */
+class TimelineStrip : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineStrip(QWidget *parent = nullptr);
+
+    /**
+     * @brief 清空所有缩略图 (切换录像时调用)。
+     * @param slotCount 格数，0 表示不显示任何格。
+     * @param durationMs 录像总时长 (毫秒)。
+     */
+    void reset(int slotCount, qint64 durationMs);
+
+    /**
+     * @brief 设置一格的缩略图。
+     * @param slot 格的下标。
+     * @param ptsMs 缩略图对应的关键帧时间 (毫秒)。
+     */
+    void setFrame(int slot, qint64 ptsMs, const QImage &image);
+
+    /**
+     * @brief 更新当前播放位置的标记。
+     */
+    void setPosition(qint64 positionMs);
+
+    QSize sizeHint() const override;
+
+signals:
+    /**
+     * @brief 用户点击了一格。
+     * @param positionMs 要定位到的位置 (毫秒)。
+     */
+    void seekRequested(qint64 positionMs);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    /**
+     * @brief 一格的缩略图。
+     */
+    struct Slot {
+        QPixmap pixmap;     ///< 缩略图，未加载时为空。
+        qint64 ptsMs = -1;  ///< 缩略图对应的关键帧时间，未加载时为 -1。
+    };
+
+    /**
+     * @brief 第 slot 格在控件中的矩形。
+     */
+    QRect slotRect(int slot) const;
+
+    QVector<Slot> m_slots;  ///< 各格的缩略图。
+    qint64 m_durationMs;    ///< 录像总时长。
+    qint64 m_positionMs;    ///< 当前播放位置。
+};
+
+#endif // TIMELINESTRIP_H
@@ -5,15 +5,23 @@
  * 本文件提供了对 Video4Linux2 (V4L2) API 的一层简单封装，
  * 用于简化摄像头视频数据的捕获流程。
  * 主要功能包括：
- * - 初始化摄像头设备 (打开设备、查询能力、设置格式、请求并映射缓冲区)。
+ * - 初始化摄像头设备 (打开设备、查询能力、协商并设置格式、请求并映射缓冲区)。
+ * - 在 NV12 / YUYV / RGB565 / MJPEG 中协商出流水线代价最低且能满足期望分辨率和帧率的格式。
  * - 开始和停止视频流的捕获。
  * - 获取捕获到的视频帧 (通常需要进行格式转换，例如从RGB565到RGB888)。
+ * - 以零拷贝方式借出/归还驱动的mmap缓冲区 (v4l2_acquire_frame / v4l2_release_frame)。
+ * - 通过 VIDIOC_EXPBUF 把每个缓冲区导出为 DMABUF fd，供硬件编码器等设备直接引用。
  * - 清理和释放相关资源。
+ *
+ * 每个摄像头的全部状态 (fd、缓冲区、格式、采集标志) 保存在独立的 `v4l2_ctx` 中，
+ * 多个摄像头可以在各自的线程中同时采集而互不影响。
+ * 原来的单摄像头接口 (v4l2_init / v4l2_get_frame / v4l2_cleanup 等) 操作一个静态默认上下文。
  */
 #include "v4l2_wrapper.h"
+#include "pixel_convert.h" // RGB565 -> RGB888 转换内核 (带SIMD运行时分派)
 
 #include <stdio.h>      // 标准输入输出库，用于 printf, fprintf, perror 等
-#include <stdlib.h>     // 标准库，用于 exit, malloc, free 等 (在此文件中未使用明显函数)
+#include <stdlib.h>     // 标准库，用于 calloc, free (分配采集上下文)
 #include <sys/types.h>  // 基本系统数据类型，例如用于 open, stat
 #include <sys/stat.h>   // 文件状态信息，用于 open
 #include <fcntl.h>      // 文件控制选项，用于 open
@@ -22,9 +30,11 @@
 #include <string.h>     // 字符串操作函数，例如 strcpy, strerror
 #include <errno.h>      // 系统错误号定义，用于 perror, strerror
 #include <sys/mman.h>   // 内存管理声明，用于 mmap, munmap
+#include <time.h>       // clock_gettime，驱动时间戳不可用时的后备时间源
 #include <linux/videodev2.h> // V4L2核心头文件，定义了所有V4L2相关的结构体、宏和常量
 
-#define FRAMEBUFFER_COUNT   3               // 定义帧缓冲区的数量。通常设置3-5个以保证流畅性。
+#define FRAMEBUFFER_COUNT   4               // 定义帧缓冲区的数量。通常设置3-5个以保证流畅性。
+                                            // 零拷贝借出时调用者会暂时占用一个缓冲区，因此比原来多准备一个。
 
 // 摄像头像素格式及其描述信息
 /**
@@ -44,61 +54,45 @@ typedef struct camera_format {
  * 用于存储通过 mmap 映射到用户空间的内核帧缓冲区的相关信息。
  */
 typedef struct cam_buf_info {
-    unsigned short *start;      /**< 指向映射到用户空间的帧缓冲区的起始地址。类型假设为RGB565，故为unsigned short*。 */
+    unsigned short *start;      /**< 指向映射到用户空间的帧缓冲区的起始地址 (历史上按RGB565声明为unsigned short*，实际格式见 frm_pixelformat)。 */
     unsigned long length;       /**< 帧缓冲区的长度 (字节数)。 */
+    int dmabuf_fd;              /**< VIDIOC_EXPBUF 导出的 DMABUF 文件描述符；驱动不支持导出时为-1。 */
 } cam_buf_info;
 
-static int v4l2_fd = -1;                // 摄像头设备文件描述符。初始化为-1表示未打开。
-static cam_buf_info buf_infos[FRAMEBUFFER_COUNT]; // 存储所有帧缓冲区信息的数组。
-static cam_fmt cam_fmts[10];            // 存储摄像头支持的像素格式的数组 (假设最多10种)。
-static int frm_width, frm_height;       // 存储实际设置的视频帧的宽度和高度 (像素)。
-static int is_capturing = 0;            // 标志位，指示当前是否正在进行视频采集 (0: 未采集, 1: 正在采集)。
+#define CAM_FMT_MAX         10              // 每个设备最多记录的像素格式数量。
+#define VIDEO_DEVICE_PROBE_MAX 16           // 枚举采集设备时探测的 /dev/videoN 节点数量。
 
-// RGB565转RGB888
 /**
- * @brief 将RGB565格式的像素数据转换为RGB888格式。
- * 
- * RGB565每个像素用16位表示 (R:5位, G:6位, B:5位)。
- * RGB888每个像素用24位表示 (R:8位, G:8位, B:8位)。
- * 此函数负责将输入的RGB565数据逐像素转换为RGB888格式并存入目标缓冲区。
- * 
- * @param src 指向源RGB565数据缓冲区的指针。
- * @param dst 指向目标RGB888数据缓冲区的指针 (调用者需确保空间足够，大小为 pixels * 3 字节)。
- * @param pixels 要转换的像素数量。
+ * @brief 单个摄像头的采集上下文。
+ *
+ * 原来以文件静态变量形式存在的设备状态全部收进此结构体，每次 `v4l2_open()` 分配一个。
  */
-static void rgb565_to_rgb888(unsigned short *src, unsigned char *dst, int pixels)
-{
-    int i;                          // 循环计数器
-    unsigned short rgb565_pixel;    // 存储当前处理的RGB565像素值
-    unsigned char r, g, b;          // 存储从RGB565提取出的R, G, B分量 (5或6位)
-    
-    for (i = 0; i < pixels; i++) {  // 遍历所有像素
-        rgb565_pixel = src[i];      // 获取当前RGB565像素
-        
-        // 从RGB565提取RGB分量
-        r = (rgb565_pixel >> 11) & 0x1F;        // 提取高5位作为R分量 (0x1F = 00011111b)
-        g = (rgb565_pixel >> 5) & 0x3F;         // 提取中间6位作为G分量 (0x3F = 00111111b)
-        b = rgb565_pixel & 0x1F;                // 提取低5位作为B分量 (0x1F = 00011111b)
-        
-        // 转换为RGB888 (通过位移和补位将5/6位分量扩展到8位)
-        // 一种常见的扩展方法是将高位复制到低位，以保持色彩的相对强度
-        // R分量: (r << 3) | (r >> 2)  => rrrrrrrr (将5位rrrrr扩展为rrrrr rrr)
-        // G分量: (g << 2) | (g >> 4)  => gggggggg (将6位gggggg扩展为gggggg gg)
-        // B分量: (b << 3) | (b >> 2)  => bbbbbbbb (将5位bbbbb扩展为bbbbb bbb)
-        dst[i*3 + 0] = (r << 3) | (r >> 2);  // R分量 (占3字节中的第1个字节)
-        dst[i*3 + 1] = (g << 2) | (g >> 4);  // G分量 (占3字节中的第2个字节)
-        dst[i*3 + 2] = (b << 3) | (b >> 2);  // B分量 (占3字节中的第3个字节)
-    }
-}
+struct v4l2_ctx {
+    int fd;                                 // 摄像头设备文件描述符。-1表示未打开。
+    char device[V4L2_DEVICE_PATH_MAX];      // 设备节点路径，用于日志。
+    v4l2_params params;                     // 打开时期望的采集参数 (已填充默认值)。
+    cam_buf_info buf_infos[FRAMEBUFFER_COUNT]; // 存储所有帧缓冲区信息的数组。
+    int buf_count;                          // 驱动实际分配的缓冲区数量 (VIDIOC_REQBUFS 返回值，不超过 FRAMEBUFFER_COUNT)。
+    cam_fmt cam_fmts[CAM_FMT_MAX];          // 存储摄像头支持的像素格式的数组。
+    int cam_fmt_count;                      // cam_fmts 中有效项的数量。
+    int frm_width, frm_height;              // 实际设置的视频帧的宽度和高度 (像素)。
+    unsigned int frm_bytesperline;          // 驱动返回的每行字节数 (行跨度)，可能大于紧凑排列的值；MJPEG 为0。
+    unsigned int frm_pixelformat;           // 驱动实际输出的像素格式。
+    int frm_fps;                            // 驱动实际生效的标称帧率。
+    int is_capturing;                       // 是否正在进行视频采集 (0: 未采集, 1: 正在采集)。
+    int buf_borrowed[FRAMEBUFFER_COUNT];    // 记录每个缓冲区当前是否已借出给调用者 (尚未QBUF归还)。
+};
+
+static v4l2_ctx *default_ctx = NULL;        // 兼容接口使用的默认上下文，由 v4l2_init() 创建。
 
 // 枚举摄像头支持的格式
 /**
  * @brief 使用 VIDIOC_ENUM_FMT ioctl 调用枚举摄像头支持的所有像素格式。
  * 
- * 将查询到的格式信息（描述字符串和像素格式ID）存储在全局的 `cam_fmts` 数组中。
- * 此函数通常在摄像头初始化时调用，以了解设备能力。
+ * 将查询到的格式信息（描述字符串和像素格式ID）存储在上下文的 `cam_fmts` 数组中，
+ * 供 `v4l2_negotiate_format()` 选择采集格式。
  */
-static void v4l2_enum_formats(void)
+static void v4l2_enum_formats(v4l2_ctx *ctx)
 {
     struct v4l2_fmtdesc fmtdesc = {0}; // V4L2格式描述结构体，用于与ioctl交互
 
@@ -107,12 +101,13 @@ static void v4l2_enum_formats(void)
     fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE; // 指定要枚举的是视频捕获类型的格式
     
     // 循环调用 VIDIOC_ENUM_FMT，直到ioctl返回错误 (通常表示没有更多格式)
-    while (0 == ioctl(v4l2_fd, VIDIOC_ENUM_FMT, &fmtdesc)) {
+    while (0 == ioctl(ctx->fd, VIDIOC_ENUM_FMT, &fmtdesc)) {
         // 成功获取到一个格式信息
-        if (fmtdesc.index < (sizeof(cam_fmts) / sizeof(cam_fmts[0]))) { // 检查数组边界
+        if (fmtdesc.index < (sizeof(ctx->cam_fmts) / sizeof(ctx->cam_fmts[0]))) { // 检查数组边界
             // 将枚举出来的格式以及描述信息存放在全局数组 `cam_fmts` 中
-            cam_fmts[fmtdesc.index].pixelformat = fmtdesc.pixelformat; // 存储像素格式ID
-            strcpy((char*)cam_fmts[fmtdesc.index].description, (char*)fmtdesc.description); // 存储格式描述
+            ctx->cam_fmts[fmtdesc.index].pixelformat = fmtdesc.pixelformat; // 存储像素格式ID
+            strcpy((char*)ctx->cam_fmts[fmtdesc.index].description, (char*)fmtdesc.description); // 存储格式描述
+            ctx->cam_fmt_count = (int)fmtdesc.index + 1;
         } else {
             // 如果支持的格式太多，超出数组大小，则停止枚举并打印警告
             fprintf(stderr, "Warning: Too many formats supported by camera, some were not stored.\n");
@@ -123,20 +118,226 @@ static void v4l2_enum_formats(void)
     // ioctl失败（非0返回值）通常意味着枚举结束或发生错误 (如EINVAL表示索引超出范围)
 }
 
+// 格式协商
+/**
+ * @brief 判断像素格式是否能被后续流水线 (预览 + 录制) 直接处理。
+ * @return 支持返回1，否则返回0。
+ */
+static int v4l2_format_supported(unsigned int pixelformat)
+{
+    switch (pixelformat) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_RGB565:
+    case V4L2_PIX_FMT_MJPEG:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 像素格式对流水线的代价排名，数值越小越优先。
+ *
+ * 编码器输入为 YUV420P：NV12 只需拆分UV平面，YUYV 只需解交织和色度垂直平均，
+ * RGB565 需要完整的色彩空间转换，MJPEG 需要整帧JPEG解码 (只有它能跑满分辨率/帧率时才值得选)。
+ */
+static int v4l2_format_rank(unsigned int pixelformat)
+{
+    switch (pixelformat) {
+    case V4L2_PIX_FMT_NV12:   return 0;
+    case V4L2_PIX_FMT_YUYV:   return 1;
+    case V4L2_PIX_FMT_RGB565: return 2;
+    case V4L2_PIX_FMT_MJPEG:  return 3;
+    default:                  return 4;
+    }
+}
+
+/**
+ * @brief 根据格式和宽度推算紧凑排列时的行跨度 (驱动返回 bytesperline 为0时使用)。
+ *
+ * NV12 的 Y 平面每像素1字节，UV 平面紧跟在 Y 平面之后且行跨度相同；MJPEG 没有行的概念，返回0。
+ */
+static unsigned int v4l2_default_bytesperline(unsigned int pixelformat, int width)
+{
+    switch (pixelformat) {
+    case V4L2_PIX_FMT_NV12:   return (unsigned int)width;
+    case V4L2_PIX_FMT_MJPEG:  return 0;
+    default:                  return (unsigned int)width * 2; // YUYV / RGB565
+    }
+}
+
+/**
+ * @brief 使用 VIDIOC_ENUM_FRAMESIZES 为指定格式选出最接近期望值的分辨率。
+ *
+ * - 离散尺寸：完全匹配优先；否则选面积最接近期望值的尺寸。
+ * - 步进/连续范围：把期望值限制在范围内并按步长对齐。
+ * - 驱动不支持枚举时直接沿用期望值，由 VIDIOC_S_FMT 调整。
+ *
+ * @param ctx 采集上下文。
+ * @param pixelformat 要查询的像素格式。
+ * @param width 输入期望宽度，输出选中的宽度。
+ * @param height 输入期望高度，输出选中的高度。
+ * @return 驱动枚举了尺寸返回1；驱动不支持枚举返回0。
+ */
+static int v4l2_pick_frame_size(v4l2_ctx *ctx, unsigned int pixelformat, int *width, int *height)
+{
+    struct v4l2_frmsizeenum fsize = {0}; // V4L2帧尺寸枚举结构体
+    const long want_area = (long)*width * *height;
+    long best_diff = -1; // 当前最佳尺寸与期望面积之差
+    int best_w = *width, best_h = *height;
+
+    fsize.pixel_format = pixelformat;
+    for (fsize.index = 0; 0 == ioctl(ctx->fd, VIDIOC_ENUM_FRAMESIZES, &fsize); fsize.index++) {
+        if (fsize.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+            // 步进或连续范围只有一项
+            const struct v4l2_frmsize_stepwise *sw = &fsize.stepwise;
+            unsigned int step_w = sw->step_width ? sw->step_width : 1;
+            unsigned int step_h = sw->step_height ? sw->step_height : 1;
+            unsigned int w = (unsigned int)*width, h = (unsigned int)*height;
+            if (w < sw->min_width)  w = sw->min_width;
+            if (w > sw->max_width)  w = sw->max_width;
+            if (h < sw->min_height) h = sw->min_height;
+            if (h > sw->max_height) h = sw->max_height;
+            *width = (int)(sw->min_width + (w - sw->min_width) / step_w * step_w);
+            *height = (int)(sw->min_height + (h - sw->min_height) / step_h * step_h);
+            return 1;
+        }
+
+        {
+            long area = (long)fsize.discrete.width * fsize.discrete.height;
+            long diff = area > want_area ? area - want_area : want_area - area;
+            if ((int)fsize.discrete.width == *width && (int)fsize.discrete.height == *height) {
+                return 1; // 完全匹配
+            }
+            if (best_diff < 0 || diff < best_diff) {
+                best_diff = diff;
+                best_w = (int)fsize.discrete.width;
+                best_h = (int)fsize.discrete.height;
+            }
+        }
+    }
+
+    if (best_diff < 0) {
+        return 0; // 驱动未实现 VIDIOC_ENUM_FRAMESIZES
+    }
+    *width = best_w;
+    *height = best_h;
+    return 1;
+}
+
+/**
+ * @brief 使用 VIDIOC_ENUM_FRAMEINTERVALS 查询指定格式和分辨率下的最高帧率。
+ * @return 最高帧率 (取整)；驱动不支持枚举时返回0，表示未知。
+ */
+static int v4l2_max_fps(v4l2_ctx *ctx, unsigned int pixelformat, int width, int height)
+{
+    struct v4l2_frmivalenum fival = {0}; // V4L2帧间隔枚举结构体
+    int best = 0;
+
+    fival.pixel_format = pixelformat;
+    fival.width = (unsigned int)width;
+    fival.height = (unsigned int)height;
+    for (fival.index = 0; 0 == ioctl(ctx->fd, VIDIOC_ENUM_FRAMEINTERVALS, &fival); fival.index++) {
+        // 帧率 = 1 / 帧间隔；步进/连续范围时最短间隔 (min) 对应最高帧率
+        const struct v4l2_fract *iv = (fival.type == V4L2_FRMIVAL_TYPE_DISCRETE)
+                                      ? &fival.discrete : &fival.stepwise.min;
+        if (iv->numerator > 0) {
+            int fps = (int)(iv->denominator / iv->numerator);
+            if (fps > best) best = fps;
+        }
+        if (fival.type != V4L2_FRMIVAL_TYPE_DISCRETE) {
+            break; // 范围只有一项
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 在设备支持的格式中选出代价最低、又能满足期望分辨率和帧率的组合。
+ *
+ * 对 `cam_fmts` 中每个流水线支持的格式，查询最接近期望值的分辨率和该分辨率下的最高帧率，
+ * 按以下规则打分 (分数相同时按 `v4l2_format_rank()` 的代价排名)：
+ * - 分辨率与期望值完全一致 +2；
+ * - 最高帧率不低于期望值 (或驱动无法告知) +1。
+ * 因此原生 YUV 能满足要求时总是优先；USB 摄像头在 720p/1080p 下 YUYV 往往只有 5~10fps，
+ * 此时 MJPEG 能满足帧率而胜出。调用者显式指定了像素格式时只在该格式内选择分辨率。
+ *
+ * 结果写入 `ctx->params` (width, height, pixelformat, fps)。
+ *
+ * @return 找到可用格式返回0；设备没有任何流水线支持的格式返回-1。
+ */
+static int v4l2_negotiate_format(v4l2_ctx *ctx)
+{
+    int best_score = -1, best_rank = 0;
+    int best_w = 0, best_h = 0, best_fps = 0;
+    unsigned int best_fmt = 0;
+    int i;
+
+    for (i = 0; i < ctx->cam_fmt_count; i++) {
+        unsigned int pf = ctx->cam_fmts[i].pixelformat;
+        int w = ctx->params.width, h = ctx->params.height;
+        int fps, score, rank;
+
+        if (!v4l2_format_supported(pf)) {
+            continue; // 流水线无法处理的格式 (例如 H264、GREY)
+        }
+        if (ctx->params.pixelformat && pf != ctx->params.pixelformat) {
+            continue; // 调用者指定了格式
+        }
+
+        v4l2_pick_frame_size(ctx, pf, &w, &h);
+        fps = v4l2_max_fps(ctx, pf, w, h);
+        score = (w == ctx->params.width && h == ctx->params.height) ? 2 : 0;
+        if (fps == 0 || fps >= ctx->params.fps) {
+            score += 1;
+        }
+        rank = v4l2_format_rank(pf);
+        printf("V4L2: %s candidate %c%c%c%c %dx%d max %d fps (score %d)\n", ctx->device,
+               pf & 0xFF, (pf >> 8) & 0xFF, (pf >> 16) & 0xFF, (pf >> 24) & 0xFF, w, h, fps, score);
+
+        if (score > best_score || (score == best_score && rank < best_rank)) {
+            best_score = score;
+            best_rank = rank;
+            best_fmt = pf;
+            best_w = w;
+            best_h = h;
+            best_fps = fps;
+        }
+    }
+
+    if (best_score < 0) {
+        if (ctx->cam_fmt_count == 0 && ctx->params.pixelformat) {
+            return 0; // 驱动不支持 VIDIOC_ENUM_FMT：直接尝试调用者指定的格式
+        }
+        fprintf(stderr, "Error: %s offers no usable pixel format (NV12/YUYV/RGB565/MJPEG)%s.\n",
+                ctx->device, ctx->params.pixelformat ? " matching the requested one" : "");
+        return -1;
+    }
+
+    ctx->params.pixelformat = best_fmt;
+    ctx->params.width = best_w;
+    ctx->params.height = best_h;
+    if (best_fps > 0 && best_fps < ctx->params.fps) {
+        ctx->params.fps = best_fps; // 不要求驱动提供它做不到的帧率
+    }
+    return 0;
+}
+
 // 设置视频格式
 /**
  * @brief 设置摄像头的视频捕获格式 (宽度、高度、像素格式) 和帧率。
  * 
- * 此函数尝试将摄像头配置为期望的参数（例如640x480, RGB565, 30fps）。
+ * 此函数把摄像头配置为 `v4l2_negotiate_format()` 选出的参数。
  * 它会：
  * 1. 设置宽度、高度和像素格式 (VIDIOC_S_FMT)。
- * 2. 验证设备是否成功接受了请求的像素格式。
- * 3. 获取实际应用的宽度和高度，并存储在全局变量 `frm_width`, `frm_height` 中。
+ * 2. 验证驱动返回的像素格式是流水线支持的格式 (驱动可能换成另一个支持的格式，此时照样接受)。
+ * 3. 获取实际应用的宽度、高度、行跨度和像素格式，并存储在上下文中。
  * 4. 尝试设置帧率 (VIDIOC_S_PARM)。
  * 
  * @return 成功返回0，失败返回-1。
  */
-static int v4l2_set_format(void)
+static int v4l2_set_format(v4l2_ctx *ctx)
 {
     struct v4l2_format fmt = {0};            // V4L2视频格式结构体，用于 VIDIOC_S_FMT 和 VIDIOC_G_FMT
     struct v4l2_streamparm streamparm = {0}; // V4L2流参数结构体，用于配置帧率等
@@ -144,55 +345,68 @@ static int v4l2_set_format(void)
     // 1. 设置帧格式
     fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE; // 指定为视频捕获类型
     // 设置期望的宽度、高度和像素格式
-    // 在此示例中，硬编码为 640x480 RGB565。实际应用中可能需要更灵活的配置。
-    fmt.fmt.pix.width       = 640;  // 期望的视频帧宽度 (像素)
-    fmt.fmt.pix.height      = 480; // 期望的视频帧高度 (像素)
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_RGB565;  // 期望的像素格式 (RGB565)
+    fmt.fmt.pix.width       = ctx->params.width;       // 期望的视频帧宽度 (像素)
+    fmt.fmt.pix.height      = ctx->params.height;      // 期望的视频帧高度 (像素)
+    fmt.fmt.pix.pixelformat = ctx->params.pixelformat; // 协商得到的像素格式
     // 其他字段 (如 field, bytesperline, sizeimage) 通常由驱动程序在S_FMT调用后填充或根据需要设置
     // fmt.fmt.pix.field       = V4L2_FIELD_INTERLACED; // 如果是隔行扫描，需要设置
 
     // 通过 ioctl VIDIOC_S_FMT 应用设置
-    if (0 > ioctl(v4l2_fd, VIDIOC_S_FMT, &fmt)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_S_FMT, &fmt)) {
         fprintf(stderr, "ioctl error: VIDIOC_S_FMT: %s\n", strerror(errno));
         return -1; // 设置格式失败
     }
 
     // 2. 验证像素格式
-    // 驱动可能不会完全接受请求的格式，而是选择一个最接近的。因此需要检查实际应用的格式。
-    // 在此示例中，我们严格要求RGB565。如果驱动不支持或改成了其他格式，则报错。
-    if (V4L2_PIX_FMT_RGB565 != fmt.fmt.pix.pixelformat) {
-        fprintf(stderr, "Error: the device does not support RGB565 format or it was changed by driver! Actual format: %c%c%c%c\n",
+    // 驱动可能不会完全接受请求的格式，而是选择一个最接近的。因此需要检查实际应用的格式：
+    // 只要仍是流水线能处理的格式就接受，否则报错。
+    if (!v4l2_format_supported(fmt.fmt.pix.pixelformat)) {
+        fprintf(stderr, "Error: %s changed the requested format to an unsupported one! Actual format: %c%c%c%c\n",
+                ctx->device,
                 fmt.fmt.pix.pixelformat & 0xFF, (fmt.fmt.pix.pixelformat >> 8) & 0xFF,
                 (fmt.fmt.pix.pixelformat >> 16) & 0xFF, (fmt.fmt.pix.pixelformat >> 24) & 0xFF);
-        return -1; // 像素格式不匹配
+        return -1; // 像素格式不可用
     }
 
     // 3. 获取并存储实际的帧宽度和高度
     // 即使像素格式匹配，宽度和高度也可能被驱动调整。
-    frm_width = fmt.fmt.pix.width;  // 从驱动返回的 `fmt` 结构中获取实际应用的宽度
-    frm_height = fmt.fmt.pix.height;// 获取实际应用的高度
-    printf("V4L2: Actual video frame size set to <%d x %d>\n", frm_width, frm_height);
-    // fmt.fmt.pix.bytesperline 和 fmt.fmt.pix.sizeimage 也会被驱动填充，可用于缓冲区大小计算
+    ctx->frm_width = fmt.fmt.pix.width;  // 从驱动返回的 `fmt` 结构中获取实际应用的宽度
+    ctx->frm_height = fmt.fmt.pix.height;// 获取实际应用的高度
+    // 驱动填充的行跨度，零拷贝读取时必须按此值逐行访问；个别驱动返回0，此时按紧凑排列处理
+    ctx->frm_pixelformat = fmt.fmt.pix.pixelformat;
+    ctx->frm_bytesperline = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline
+                                                     : v4l2_default_bytesperline(ctx->frm_pixelformat, ctx->frm_width);
+    printf("V4L2: %s actual video format %c%c%c%c <%d x %d>, bytesperline %u\n", ctx->device,
+           ctx->frm_pixelformat & 0xFF, (ctx->frm_pixelformat >> 8) & 0xFF,
+           (ctx->frm_pixelformat >> 16) & 0xFF, (ctx->frm_pixelformat >> 24) & 0xFF,
+           ctx->frm_width, ctx->frm_height, ctx->frm_bytesperline);
 
     // 4. 设置帧率 (可选，但推荐)
+    ctx->frm_fps = ctx->params.fps; // 驱动不支持读回帧率时按期望值记录
     // 首先获取当前的流参数
     streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE; // 指定为视频捕获类型
-    if (0 > ioctl(v4l2_fd, VIDIOC_G_PARM, &streamparm)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_G_PARM, &streamparm)) {
         // 获取流参数失败，可能不严重，可以继续，但帧率可能不是期望的
         fprintf(stderr, "Warning: ioctl VIDIOC_G_PARM failed: %s. Frame rate might not be configurable.\n", strerror(errno));
     } else {
         // 检查设备是否支持通过 timeperframe 设置帧率
         if (V4L2_CAP_TIMEPERFRAME & streamparm.parm.capture.capability) {
             streamparm.parm.capture.timeperframe.numerator = 1;      // 帧间隔的分子 (1)
-            streamparm.parm.capture.timeperframe.denominator = 30;   // 帧间隔的分母 (30)，即期望30 FPS
+            streamparm.parm.capture.timeperframe.denominator = ctx->params.fps; // 帧间隔的分母，即期望的FPS (默认30)
             // 通过 ioctl VIDIOC_S_PARM 应用设置
-            if (0 > ioctl(v4l2_fd, VIDIOC_S_PARM, &streamparm)) {
+            if (0 > ioctl(ctx->fd, VIDIOC_S_PARM, &streamparm)) {
                 fprintf(stderr, "ioctl error: VIDIOC_S_PARM to set frame rate: %s\n", strerror(errno));
-                // 设置帧率失败，不一定是致命错误，可以继续，但帧率可能不是30fps
+                // 设置帧率失败，不一定是致命错误，可以继续，但帧率可能不是期望值
             } else {
                  printf("V4L2: Attempted to set frame rate to %d/%d FPS.\n", 
                         streamparm.parm.capture.timeperframe.denominator, 
                         streamparm.parm.capture.timeperframe.numerator);
+                 // 驱动可能把帧率调整为它支持的值，以读回的 timeperframe 为准
+                 if (streamparm.parm.capture.timeperframe.numerator > 0
+                         && streamparm.parm.capture.timeperframe.denominator > 0) {
+                     ctx->frm_fps = (int)(streamparm.parm.capture.timeperframe.denominator
+                                          / streamparm.parm.capture.timeperframe.numerator);
+                 }
             }
         } else {
             // 设备不支持通过 timeperframe 设置帧率，可能支持其他方式或帧率固定
@@ -203,6 +417,30 @@ static int v4l2_set_format(void)
     return 0; // 格式设置成功（或主要部分成功）
 }
 
+/**
+ * @brief 使用 VIDIOC_EXPBUF 把第 index 个缓冲区导出为 DMABUF 文件描述符。
+ *
+ * 只读导出 (O_RDONLY)，带 O_CLOEXEC 防止泄漏到子进程。失败不算错误，fd 保持为-1，
+ * 仅在第一个缓冲区失败时打印一次提示。
+ */
+static void v4l2_export_buffer(v4l2_ctx *ctx, int index)
+{
+    struct v4l2_exportbuffer expbuf = {0}; // V4L2缓冲区导出结构体
+
+    expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = (unsigned int)index;
+    expbuf.flags = O_RDONLY | O_CLOEXEC;
+    if (0 > ioctl(ctx->fd, VIDIOC_EXPBUF, &expbuf)) {
+        if (index == 0) {
+            printf("V4L2: %s does not support VIDIOC_EXPBUF (%s), DMABUF export disabled.\n",
+                   ctx->device, strerror(errno));
+        }
+        ctx->buf_infos[index].dmabuf_fd = -1;
+        return;
+    }
+    ctx->buf_infos[index].dmabuf_fd = expbuf.fd;
+}
+
 // 初始化缓冲区
 /**
  * @brief 请求并映射V4L2视频捕获缓冲区。
@@ -210,17 +448,20 @@ static int v4l2_set_format(void)
  * 此函数执行以下步骤：
  * 1. 使用 VIDIOC_REQBUFS 请求指定数量的缓冲区 (FRAMEBUFFER_COUNT)。
  *    这些缓冲区由驱动在内核空间分配，用于存储捕获到的视频帧。
+ *    驱动可能分配更少，实际数量记录在 `ctx->buf_count` 中，后续所有循环和索引检查都以它为上限；
+ *    少于2个时无法一边采集一边借出帧，直接返回失败。
  * 2. 对每一个请求到的缓冲区：
  *    a. 使用 VIDIOC_QUERYBUF 查询该缓冲区的元数据 (如长度、在设备内存中的偏移量)。
  *    b. 使用 mmap 将该内核缓冲区映射到用户进程的地址空间，
  *       使得用户程序可以直接访问捕获到的视频数据，而无需数据拷贝。
- * 3. 将映射后的缓冲区的起始地址和长度存储在全局的 `buf_infos` 数组中。
+ * 3. 将映射后的缓冲区的起始地址和长度存储在上下文的 `buf_infos` 数组中。
+ * 4. 驱动支持时，用 `v4l2_export_buffer()` 把缓冲区导出为 DMABUF fd。
  * 
  * @note 内存映射 (V4L2_MEMORY_MMAP) 是V4L2中高效获取视频数据的常用方式。
  * 
  * @return 成功返回0，失败返回-1。
  */
-static int v4l2_init_buffer(void)
+static int v4l2_init_buffer(v4l2_ctx *ctx)
 {
     struct v4l2_requestbuffers reqbuf = {0}; // V4L2缓冲区请求结构体
     struct v4l2_buffer buf_query = {0};       // V4L2单个缓冲区信息结构体，用于 VIDIOC_QUERYBUF
@@ -231,46 +472,42 @@ static int v4l2_init_buffer(void)
     reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;  // 缓冲区类型为视频捕获
     reqbuf.memory = V4L2_MEMORY_MMAP;           // 指定内存模式为内存映射 (MMAP)
     
-    if (0 > ioctl(v4l2_fd, VIDIOC_REQBUFS, &reqbuf)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_REQBUFS, &reqbuf)) {
         fprintf(stderr, "ioctl error: VIDIOC_REQBUFS: %s\n", strerror(errno));
         return -1; // 请求缓冲区失败
     }
 
     // 驱动可能分配少于请求数量的缓冲区，检查实际分配的数量
+    if (reqbuf.count < 2) { // 至少需要2个：一个借给调用者时驱动仍有缓冲区可填
+        fprintf(stderr, "Error: VIDIOC_REQBUFS allocated only %u buffer(s) on %s, at least 2 are required.\n",
+                reqbuf.count, ctx->device);
+        return -1;
+    }
     if (reqbuf.count < FRAMEBUFFER_COUNT) {
-        // 如果驱动分配的缓冲区数量少于期望，可能无法正常工作或性能下降
-        fprintf(stderr, "Warning: VIDIOC_REQBUFS allocated fewer buffers (%d) than requested (%d).\n", 
+        // 缓冲区少于期望时仍可工作，只是更容易因处理不及时而丢帧
+        fprintf(stderr, "Warning: VIDIOC_REQBUFS allocated fewer buffers (%u) than requested (%d).\n",
                 reqbuf.count, FRAMEBUFFER_COUNT);
-        // 根据实际需求，这里可以决定是失败退出还是继续 (如果允许少于期望的缓冲区)
-        // 为简单起见，如果严格要求FRAMEBUFFER_COUNT个，则应该返回错误
-        // if (reqbuf.count < 2) { // 例如，至少需要2个才能正常工作
-        //    fprintf(stderr, "Error: Not enough buffers allocated by driver.\n");
-        //    return -1;
-        // }
-    }
-    // 注意：实际项目中，应使用 reqbuf.count 作为后续循环的上限，而不是 FRAMEBUFFER_COUNT
-    // 但为保持与原代码逻辑一致（使用全局FRAMEBUFFER_COUNT），这里不做修改，假设驱动总能满足请求。
-    // 更好的做法是：调整buf_infos数组大小或在循环中检查索引。
+    }
+    // 驱动偶尔会分配多于请求的数量，超出 buf_infos 数组的部分不使用
+    ctx->buf_count = reqbuf.count < FRAMEBUFFER_COUNT ? (int)reqbuf.count : FRAMEBUFFER_COUNT;
     
     // 2. 建立内存映射
     // 为每个已分配的缓冲区获取信息并进行内存映射
-    for (i = 0; i < FRAMEBUFFER_COUNT; i++) { // 理想情况下应为 for (i = 0; i < reqbuf.count; i++)
+    for (i = 0; i < ctx->buf_count; i++) {
         // 准备查询缓冲区信息
         buf_query.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         buf_query.memory = V4L2_MEMORY_MMAP;
         buf_query.index = i; // 要查询的缓冲区的索引
         
         // 使用 VIDIOC_QUERYBUF 获取缓冲区的物理地址信息 (主要是偏移量和长度)
-        if (0 > ioctl(v4l2_fd, VIDIOC_QUERYBUF, &buf_query)) {
+        if (0 > ioctl(ctx->fd, VIDIOC_QUERYBUF, &buf_query)) {
             fprintf(stderr, "ioctl error: VIDIOC_QUERYBUF for buffer %d: %s\n", i, strerror(errno));
-            // 如果一个缓冲区查询失败，可能需要回滚已映射的缓冲区并返回错误
-            // 为简单起见，这里直接返回错误
-            // TODO: 添加清理逻辑，munmap已映射的缓冲区
+            // 已映射的缓冲区由调用者的 v4l2_close() 统一解除映射
             return -1;
         }
         
         // 记录缓冲区长度
-        buf_infos[i].length = buf_query.length;
+        ctx->buf_infos[i].length = buf_query.length;
         
         // 将内核缓冲区映射到用户空间
         // mmap参数：
@@ -278,18 +515,22 @@ static int v4l2_init_buffer(void)
         //   buf_query.length: 映射区域的长度
         //   PROT_READ | PROT_WRITE: 映射区域可读可写
         //   MAP_SHARED: 对映射区域的修改对其他映射同一文件的进程可见，并且会写回到底层文件 (对设备文件意味着写回设备)
-        //   v4l2_fd: 设备文件描述符
+        //   ctx->fd: 设备文件描述符
         //   buf_query.m.offset: 缓冲区在设备内存中的偏移量 (从VIDIOC_QUERYBUF获得)
-        buf_infos[i].start = (unsigned short*)mmap(NULL, buf_query.length,
+        ctx->buf_infos[i].start = (unsigned short*)mmap(NULL, buf_query.length,
                                                 PROT_READ | PROT_WRITE, MAP_SHARED,
-                                                v4l2_fd, buf_query.m.offset);
-        if (MAP_FAILED == buf_infos[i].start) {
+                                                ctx->fd, buf_query.m.offset);
+        if (MAP_FAILED == ctx->buf_infos[i].start) {
             perror("mmap error");
-            // mmap失败，可能需要回滚其他已映射的缓冲区并返回错误
-            // TODO: 添加清理逻辑，munmap已映射的缓冲区
+            // mmap失败：标记为未映射，其他已映射的缓冲区由调用者的 v4l2_close() 统一解除映射
+            ctx->buf_infos[i].start = NULL;
             return -1;
         }
-        printf("V4L2: Buffer %d mapped at %p, length %lu\n", i, buf_infos[i].start, buf_infos[i].length);
+        printf("V4L2: Buffer %d mapped at %p, length %lu\n", i, ctx->buf_infos[i].start, ctx->buf_infos[i].length);
+
+        // 导出为 DMABUF (可选)：硬件编码器/显示等其它设备可以直接引用这块内存，不经过用户空间拷贝。
+        // 老驱动或非 videobuf2 驱动不支持 EXPBUF，此时保持-1，只使用 mmap 映射。
+        v4l2_export_buffer(ctx, i);
     }
     
     return 0; // 所有缓冲区初始化并映射成功
@@ -305,11 +546,11 @@ static int v4l2_init_buffer(void)
  *       这意味着告诉驱动这个缓冲区现在可用于填充捕获到的视频数据。
  * 2. 使用 VIDIOC_STREAMON 启动视频捕获过程。
  *    一旦启动，摄像头开始采集数据，并将数据填充到已排队的缓冲区中。
- * 3. 设置全局标志 `is_capturing` 为1。
+ * 3. 设置上下文的 `is_capturing` 标志为1。
  * 
  * @return 成功返回0，失败返回-1。如果失败，会尝试清理资源并返回。
  */
-static int v4l2_stream_on(void)
+static int v4l2_stream_on(v4l2_ctx *ctx)
 {
     struct v4l2_buffer qbuf = {0}; // V4L2缓冲区结构体，用于 VIDIOC_QBUF
     int i;                        // 循环计数器
@@ -319,24 +560,25 @@ static int v4l2_stream_on(void)
     qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     qbuf.memory = V4L2_MEMORY_MMAP;
     
-    for (i = 0; i < FRAMEBUFFER_COUNT; i++) { // 理想情况: for (i = 0; i < reqbuf.count from v4l2_init_buffer; i++)
+    for (i = 0; i < ctx->buf_count; i++) {
         qbuf.index = i; // 要排队的缓冲区的索引
-        if (0 > ioctl(v4l2_fd, VIDIOC_QBUF, &qbuf)) {
+        if (0 > ioctl(ctx->fd, VIDIOC_QBUF, &qbuf)) {
             fprintf(stderr, "ioctl error: VIDIOC_QBUF for buffer %d: %s\n", i, strerror(errno));
             ret = -1; // 标记失败
             goto cleanup_stream_on; // 跳转到清理逻辑
         }
+        ctx->buf_borrowed[i] = 0; // 重新开始采集时所有缓冲区都归驱动所有
     }
 
     // 2. 启动视频流
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (0 > ioctl(v4l2_fd, VIDIOC_STREAMON, &type)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_STREAMON, &type)) {
         fprintf(stderr, "ioctl error: VIDIOC_STREAMON: %s\n", strerror(errno));
         ret = -1; // 标记失败
         goto cleanup_stream_on; // 跳转到清理逻辑 (虽然此时已排队的缓冲区可能无法轻易取消)
     }
 
-    is_capturing = 1; // 设置采集标志为真
+    ctx->is_capturing = 1; // 设置采集标志为真
     printf("V4L2: Stream started successfully.\n");
     return 0; // 启动成功
 
@@ -350,7 +592,7 @@ cleanup_stream_on:
         // 更好的错误处理可能需要更细致的状态管理。
         
         // 尝试关闭视频流 (如果已经意外开启)
-        // ioctl(v4l2_fd, VIDIOC_STREAMOFF, &type); // 谨慎：如果STREAMON本身失败，此调用也可能失败或不必要
+        // ioctl(ctx->fd, VIDIOC_STREAMOFF, &type); // 谨慎：如果STREAMON本身失败，此调用也可能失败或不必要
         
         // 解除内存映射 (仅当映射成功且未在v4l2_cleanup中处理时)
         // 此处假设buf_infos是全局有效的，如果v4l2_init_buffer部分失败，这里可能不安全。
@@ -362,16 +604,16 @@ cleanup_stream_on:
         // 以下是原代码中的清理逻辑，如果在此处执行，需谨慎其副作用。
         /*
         for (int k = 0; k < FRAMEBUFFER_COUNT; k++) {
-            if (buf_infos[k].start && buf_infos[k].start != MAP_FAILED) { // 检查是否已映射
-                munmap(buf_infos[k].start, buf_infos[k].length);
-                buf_infos[k].start = MAP_FAILED; // 标记为已解除映射
+            if (ctx->buf_infos[k].start && ctx->buf_infos[k].start != MAP_FAILED) { // 检查是否已映射
+                munmap(ctx->buf_infos[k].start, ctx->buf_infos[k].length);
+                ctx->buf_infos[k].start = MAP_FAILED; // 标记为已解除映射
             }
         }
-        if (v4l2_fd >= 0) {
-            close(v4l2_fd);
-            v4l2_fd = -1;
+        if (ctx->fd >= 0) {
+            close(ctx->fd);
+            ctx->fd = -1;
         }
-        is_capturing = 0;
+        ctx->is_capturing = 0;
         */
         // 由于此函数是static的，错误应该向上传播，让公共API的调用者决定如何处理。
         // 原始的 goto cleanup 目标是空的，这暗示着清理责任可能在调用栈的更高层，
@@ -389,283 +631,575 @@ cleanup_stream_on:
  * 并将 `is_capturing` 标志置为0。
  * 如果未在捕获，则此函数不执行任何操作。
  */
-static void v4l2_stream_off(void)
+static void v4l2_stream_off(v4l2_ctx *ctx)
 {
-    if (!is_capturing) { // 如果当前未在采集，则直接返回
+    if (!ctx->is_capturing) { // 如果当前未在采集，则直接返回
         return;
     }
     
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (0 > ioctl(v4l2_fd, VIDIOC_STREAMOFF, &type)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_STREAMOFF, &type)) {
         // STREAMOFF 失败通常不常见，但如果发生，打印错误信息。
         // 此时设备状态可能不稳定，后续清理可能也受影响。
         fprintf(stderr, "ioctl error: VIDIOC_STREAMOFF: %s\n", strerror(errno));
     } else {
         printf("V4L2: Stream stopped successfully.\n");
     }
-    is_capturing = 0; // 更新采集状态标志
+    ctx->is_capturing = 0; // 更新采集状态标志
+    // STREAMOFF 会隐式地把所有缓冲区从驱动队列中移除，借出标志随之失效
+    memset(ctx->buf_borrowed, 0, sizeof(ctx->buf_borrowed));
 }
 
 // 公开API实现
 
-// 初始化摄像头
+// 枚举视频采集设备
 /**
- * @brief 初始化V4L2摄像头设备。
- * 
- * 这是V4L2封装层的主要入口点之一。它执行完整的摄像头初始化序列：
- * 1. 打开指定的摄像头设备文件 (例如 "/dev/video0")。
- * 2. 使用 VIDIOC_QUERYCAP 查询设备能力，并验证它是一个视频捕获设备。
- * 3. 调用 `v4l2_enum_formats()` 枚举设备支持的像素格式 (主要用于调试或动态格式选择)。
- * 4. 调用 `v4l2_set_format()` 设置期望的视频格式 (分辨率、像素格式、帧率)。
- * 5. 调用 `v4l2_init_buffer()` 请求并内存映射视频捕获缓冲区。
- * 
- * @param device 摄像头设备文件的路径字符串 (例如 "/dev/video0")。
- * @return 成功返回0，失败返回-1。如果失败，会尝试关闭已打开的设备文件描述符。
+ * @brief 探测 /dev/video0 ~ /dev/video15，返回可用于采集的设备节点。
+ *
+ * 对每个存在的节点执行 VIDIOC_QUERYCAP：如果驱动设置了 V4L2_CAP_DEVICE_CAPS，
+ * 则以 `device_caps` (本节点自身的能力) 为准，否则使用 `capabilities`。
+ * 只保留同时支持视频捕获和流式I/O的节点，这样可以跳过 UVC 摄像头附带的元数据节点。
+ *
+ * @param paths 输出数组，每项接收一个设备节点路径。
+ * @param max_devices 数组容量。
+ * @return 找到的设备数量。
  */
-int v4l2_init(const char *device)
+int v4l2_enum_capture_devices(char paths[][V4L2_DEVICE_PATH_MAX], int max_devices)
+{
+    int count = 0; // 已找到的设备数量
+    int i;         // 节点编号
+
+    if (!paths || max_devices <= 0) {
+        return 0;
+    }
+
+    for (i = 0; i < VIDEO_DEVICE_PROBE_MAX && count < max_devices; i++) {
+        char path[V4L2_DEVICE_PATH_MAX];
+        struct v4l2_capability cap = {0};
+        unsigned int caps;
+        int fd;
+
+        snprintf(path, sizeof(path), "/dev/video%d", i);
+        // 仅查询能力，非阻塞打开避免被正在使用的设备卡住
+        fd = open(path, O_RDWR | O_NONBLOCK);
+        if (0 > fd) {
+            continue; // 节点不存在或无权限
+        }
+        if (0 > ioctl(fd, VIDIOC_QUERYCAP, &cap)) {
+            close(fd);
+            continue;
+        }
+        close(fd);
+
+        caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+        if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+            continue; // 元数据节点、输出设备或编解码器
+        }
+
+        strncpy(paths[count], path, V4L2_DEVICE_PATH_MAX - 1);
+        paths[count][V4L2_DEVICE_PATH_MAX - 1] = '\0';
+        printf("V4L2: Found capture device %s (%s)\n", path, cap.card);
+        count++;
+    }
+    return count;
+}
+
+// 打开摄像头
+/**
+ * @brief 打开并初始化一个V4L2摄像头设备，返回其上下文。
+ *
+ * 执行完整的摄像头初始化序列：
+ * 1. 分配上下文并填充采集参数 (未指定的字段使用默认值)。
+ * 2. 打开指定的摄像头设备文件 (例如 "/dev/video0")。
+ * 3. 使用 VIDIOC_QUERYCAP 查询设备能力，并验证它是一个视频捕获设备。
+ * 4. 调用 `v4l2_enum_formats()` 枚举设备支持的像素格式，再由 `v4l2_negotiate_format()`
+ *    结合 VIDIOC_ENUM_FRAMESIZES / VIDIOC_ENUM_FRAMEINTERVALS 选出格式、分辨率和帧率。
+ * 5. 调用 `v4l2_set_format()` 设置协商出的视频格式。
+ * 6. 调用 `v4l2_init_buffer()` 请求并内存映射视频捕获缓冲区。
+ *
+ * @param device 摄像头设备文件的路径字符串。
+ * @param params 期望的采集参数，可为 NULL。
+ * @return 成功返回上下文；失败返回 NULL (已通过 `v4l2_close()` 释放已分配的资源)。
+ */
+v4l2_ctx *v4l2_open(const char *device, const v4l2_params *params)
 {
     struct v4l2_capability cap = {0}; // V4L2设备能力结构体
+    v4l2_ctx *ctx;                    // 新建的上下文
+    int i;                            // 循环计数器
+
+    if (!device) {
+        fprintf(stderr, "Error: v4l2_open called with NULL device.\n");
+        return NULL;
+    }
+
+    // 1. 分配上下文 (calloc 清零，所有缓冲区起始地址为NULL，表示未映射)
+    ctx = (v4l2_ctx *)calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        fprintf(stderr, "Error: out of memory allocating V4L2 context for %s.\n", device);
+        return NULL;
+    }
+    ctx->fd = -1;
+    for (i = 0; i < FRAMEBUFFER_COUNT; i++) {
+        ctx->buf_infos[i].dmabuf_fd = -1; // 尚未导出
+    }
+    strncpy(ctx->device, device, sizeof(ctx->device) - 1);
+    if (params) {
+        ctx->params = *params;
+    }
+    if (ctx->params.width <= 0)      ctx->params.width = 640;
+    if (ctx->params.height <= 0)     ctx->params.height = 480;
+    // pixelformat 为0表示自动协商，不再强制 RGB565
+    if (ctx->params.fps <= 0)        ctx->params.fps = 30;
 
-    // 1. 打开摄像头设备
+    // 2. 打开摄像头设备
     // O_RDWR: 以读写模式打开。对于V4L2，通常需要读写权限。
-    v4l2_fd = open(device, O_RDWR /* | O_NONBLOCK */); // O_NONBLOCK 可用于非阻塞操作，但ioctl通常是阻塞的
-    if (0 > v4l2_fd) { // open 返回-1表示失败
+    // O_NONBLOCK: VIDIOC_DQBUF 在没有已完成的帧时立即返回 EAGAIN 而不是阻塞，
+    // 等待新帧由调用者通过 poll() 在 v4l2_ctx_get_fd() 上完成 (见 CaptureThread)。
+    ctx->fd = open(device, O_RDWR | O_NONBLOCK);
+    if (0 > ctx->fd) { // open 返回-1表示失败
         fprintf(stderr, "open error for device %s: %s\n", device, strerror(errno));
-        return -1;
+        v4l2_close(ctx);
+        return NULL;
     }
 
-    // 2. 查询设备功能 (VIDIOC_QUERYCAP)
+    // 3. 查询设备功能 (VIDIOC_QUERYCAP)
     // 此调用获取设备的基本信息，如驱动名称、卡名称、总线信息以及支持的能力。
-    if (0 > ioctl(v4l2_fd, VIDIOC_QUERYCAP, &cap)) {
+    if (0 > ioctl(ctx->fd, VIDIOC_QUERYCAP, &cap)) {
         fprintf(stderr, "ioctl error: VIDIOC_QUERYCAP: %s\n", strerror(errno));
-        close(v4l2_fd); // 关闭已打开的文件描述符
-        v4l2_fd = -1;   // 重置文件描述符
-        return -1;
+        v4l2_close(ctx);
+        return NULL;
     }
     printf("V4L2: Device opened: %s (%s)\n", cap.card, cap.driver);
 
-    // 3. 判断是否是视频采集设备
+    // 判断是否是视频采集设备
     // 检查 `cap.capabilities` 标志位，确保设备支持视频捕获。
     if (!(V4L2_CAP_VIDEO_CAPTURE & cap.capabilities)) {
         fprintf(stderr, "Error: %s is not a video capture device! Capabilities: 0x%x\n", device, cap.capabilities);
-        close(v4l2_fd);
-        v4l2_fd = -1;
-        return -1;
+        v4l2_close(ctx);
+        return NULL;
     }
     // 还可以检查是否支持流式I/O (V4L2_CAP_STREAMING)，这对于MMAP是必需的。
     if (!(V4L2_CAP_STREAMING & cap.capabilities)) {
-         fprintf(stderr, "Error: %s does not support streaming I/O (required for MMAP)!\n", device);
-         close(v4l2_fd);
-         v4l2_fd = -1;
-         return -1;
+        fprintf(stderr, "Error: %s does not support streaming I/O (required for MMAP)!\n", device);
+        v4l2_close(ctx);
+        return NULL;
     }
 
-    // (可选) 枚举摄像头支持的格式 (主要用于信息展示或动态选择格式)
-    v4l2_enum_formats(); // 内部调用，填充 cam_fmts 数组
-    
-    // 4. 设置视频格式 (分辨率、像素格式、帧率)
-    if (0 > v4l2_set_format()) { // 内部调用，设置 frm_width, frm_height
+    // 4. 枚举摄像头支持的格式，并协商出代价最低的格式、分辨率和帧率
+    v4l2_enum_formats(ctx); // 填充 ctx->cam_fmts 数组
+    if (0 > v4l2_negotiate_format(ctx)) { // 结果写回 ctx->params
+        v4l2_close(ctx);
+        return NULL;
+    }
+
+    // 5. 设置视频格式 (分辨率、像素格式、帧率)
+    if (0 > v4l2_set_format(ctx)) { // 设置 ctx->frm_width, ctx->frm_height, ctx->frm_pixelformat
         // v4l2_set_format 内部已打印错误信息
-        close(v4l2_fd);
-        v4l2_fd = -1;
-        return -1;
+        v4l2_close(ctx);
+        return NULL;
     }
-    
-    // 5. 初始化缓冲区 (请求并映射)
-    if (0 > v4l2_init_buffer()) { // 内部调用，填充 buf_infos 数组
-        // v4l2_init_buffer 内部已打印错误信息
-        // 如果缓冲区初始化失败，需要munmap已经映射的部分 (v4l2_init_buffer应处理部分失败的清理)
-        // 然后关闭文件描述符
-        close(v4l2_fd);
-        v4l2_fd = -1;
-        return -1;
+
+    // 6. 初始化缓冲区 (请求并映射)
+    if (0 > v4l2_init_buffer(ctx)) { // 填充 ctx->buf_infos 数组
+        // v4l2_init_buffer 内部已打印错误信息，已映射的部分由 v4l2_close 解除映射
+        v4l2_close(ctx);
+        return NULL;
     }
-    
+
     printf("V4L2: Initialization successful for %s.\n", device);
-    return 0; // 初始化成功
+    return ctx; // 初始化成功
 }
 
 // 开始视频采集
 /**
  * @brief 开始V4L2视频捕获流。
- * 
+ *
  * 此函数是对内部静态函数 `v4l2_stream_on()` 的简单封装，
  * `v4l2_stream_on()` 负责将缓冲区排队并启动流。
- * 
+ *
  * @return 成功返回0，失败返回-1。
  */
-int v4l2_start_capture()
+int v4l2_ctx_start_capture(v4l2_ctx *ctx)
 {
-    if (v4l2_fd < 0) { // 检查设备是否已初始化
-        fprintf(stderr, "Error: v4l2_start_capture called before successful v4l2_init.\n");
+    if (!ctx || ctx->fd < 0) { // 检查设备是否已初始化
+        fprintf(stderr, "Error: v4l2_ctx_start_capture called before successful v4l2_open.\n");
         return -1;
     }
-    if (is_capturing) { // 检查是否已在采集
-        fprintf(stderr, "Warning: v4l2_start_capture called while already capturing.\n");
+    if (ctx->is_capturing) { // 检查是否已在采集
+        fprintf(stderr, "Warning: %s: start capture called while already capturing.\n", ctx->device);
         return 0; // 或者返回错误，取决于期望行为
     }
-    return v4l2_stream_on();
+    return v4l2_stream_on(ctx);
 }
 
 // 停止视频采集
 /**
  * @brief 停止V4L2视频捕获流。
- * 
+ *
  * 此函数是对内部静态函数 `v4l2_stream_off()` 的简单封装。
  */
-void v4l2_stop_capture()
+void v4l2_ctx_stop_capture(v4l2_ctx *ctx)
 {
-    if (v4l2_fd < 0) { // 检查设备是否已初始化
+    if (!ctx || ctx->fd < 0) { // 检查设备是否已初始化
         // 如果未初始化就调用stop，通常不执行任何操作或打印警告
         return;
     }
-    v4l2_stream_off();
+    v4l2_stream_off(ctx);
 }
 
-// 获取一帧RGB888格式的图像数据
+// 计算帧的采集时间戳
 /**
- * @brief 从V4L2捕获流中获取一帧视频数据，并将其转换为RGB888格式。
- * 
+ * @brief 返回出队缓冲区的采集时间戳 (微秒，CLOCK_MONOTONIC)。
+ *
+ * 大多数驱动在帧开始 (或结束) 传输时用 CLOCK_MONOTONIC 打时间戳，并在 flags 中标记
+ * V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC；这比出队时刻更准确，不受采集线程调度延迟的影响。
+ * 个别驱动不打时间戳或使用其它时钟 (COPY / UNKNOWN)，此时退回出队时刻的 CLOCK_MONOTONIC，
+ * 保证同一进程内所有通道的时间戳可以直接比较。
+ */
+static long long v4l2_frame_timestamp(const struct v4l2_buffer *buf)
+{
+    struct timespec now;
+
+    if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+            && (buf->timestamp.tv_sec != 0 || buf->timestamp.tv_usec != 0)) {
+        return (long long)buf->timestamp.tv_sec * 1000000LL + buf->timestamp.tv_usec;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+
+// 借出一帧原始图像数据 (零拷贝)
+/**
+ * @brief 从V4L2捕获流中取出一个已填充的缓冲区，并直接把mmap映射地址借给调用者。
+ *
  * 执行流程：
  * 1. 检查是否正在捕获以及输入参数是否有效。
  * 2. 使用 VIDIOC_DQBUF 从驱动的输出队列中取出一个已填充数据的缓冲区。
- *    此调用会阻塞，直到有可用的帧，或者如果以非阻塞模式打开设备且无可用帧，则返回EAGAIN。
- * 3. 如果成功获取到缓冲区 (包含RGB565数据)，调用 `rgb565_to_rgb888()` 将其转换为RGB888格式，
- *    存入用户提供的 `data` 缓冲区中。
- * 4. 将处理完的原始V4L2缓冲区使用 VIDIOC_QBUF 重新排队到驱动的输入队列，使其可被再次使用。
- * 5. 通过指针参数返回图像的实际宽度和高度。
- * 
- * @param data 指向用户分配的缓冲区的指针，用于存储转换后的RGB888图像数据。
- *             调用者必须确保此缓冲区足够大 (frm_width * frm_height * 3 字节)。
- * @param width 输出参数，指向一个int变量，用于接收图像的宽度 (像素)。
- * @param height 输出参数，指向一个int变量，用于接收图像的高度 (像素)。
- * @return 成功获取并转换一帧数据返回0；如果无数据可用 (EAGAIN) 或发生其他错误则返回-1。
+ *    阻塞模式下此调用会等待直到有可用帧；非阻塞模式下无帧时返回EAGAIN。
+ * 3. 不做任何格式转换或拷贝，把 `buf_infos[index]` 的起始地址、有效字节数、行跨度、
+ *    驱动帧序号和采集时间戳填入 `frame`。
+ * 4. 标记该缓冲区为"已借出"。调用者用完后必须调用 `v4l2_ctx_release_frame()` 归还，
+ *    否则驱动可用缓冲区会逐渐耗尽。
+ *
+ * @param ctx 采集上下文。
+ * @param frame 输出参数，接收借出帧的描述信息。
+ * @return 成功返回0；如果无数据可用 (EAGAIN) 或发生其他错误则返回-1。
  */
-int v4l2_get_frame(unsigned char *data, int *width, int *height)
+int v4l2_ctx_acquire_frame(v4l2_ctx *ctx, v4l2_frame *frame)
 {
-    struct v4l2_buffer dqbuf = {0}; // V4L2缓冲区结构体，用于 VIDIOC_DQBUF 和 VIDIOC_QBUF
-    
+    struct v4l2_buffer dqbuf = {0}; // V4L2缓冲区结构体，用于 VIDIOC_DQBUF
+
     // 1. 参数检查和状态检查
-    if (v4l2_fd < 0 || !is_capturing) { // 检查设备是否初始化并在采集中
-        // fprintf(stderr, "Error: v4l2_get_frame called when not capturing or not initialized.\n");
+    if (!ctx || ctx->fd < 0 || !ctx->is_capturing) { // 检查设备是否初始化并在采集中
         return -1;
     }
-    if (!data || !width || !height) { // 检查输出参数指针是否有效
-        fprintf(stderr, "Error: v4l2_get_frame called with NULL output parameters.\n");
+    if (!frame) { // 检查输出参数指针是否有效
+        fprintf(stderr, "Error: v4l2_ctx_acquire_frame called with NULL frame.\n");
         return -1;
     }
-    
-    // 2. 设置缓冲区类型以准备出队 (DQBUF)
+
+    // 2. 从驱动的输出队列中取出一个已填充数据的缓冲区
     dqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     dqbuf.memory = V4L2_MEMORY_MMAP;
-    
-    // 3. 从驱动的输出队列中取出一个已填充数据的缓冲区
-    // VIDIOC_DQBUF: Dequeue Buffer. 获取一个已填充数据的缓冲区。
-    // 此调用通常是阻塞的，直到一个缓冲区可用。
-    if (0 > ioctl(v4l2_fd, VIDIOC_DQBUF, &dqbuf)) {
-        if (errno == EAGAIN) { // 如果以非阻塞模式打开，并且当前没有可用的帧
-            // fprintf(stderr, "V4L2_GET_FRAME: VIDIOC_DQBUF: No data available (EAGAIN).\n");
+    if (0 > ioctl(ctx->fd, VIDIOC_DQBUF, &dqbuf)) {
+        if (errno == EAGAIN) { // 非阻塞模式下当前没有可用的帧
             return -1; // 没有数据可用，调用者应稍后重试
         }
-        // 其他错误
-        fprintf(stderr, "ioctl error: VIDIOC_DQBUF: %s\n", strerror(errno));
-        // 发生严重错误，可能需要停止捕获并清理
-        // v4l2_stop_capture(); // 或由调用者决定
+        fprintf(stderr, "ioctl error: VIDIOC_DQBUF on %s: %s\n", ctx->device, strerror(errno));
         return -1;
     }
-    // dqbuf.index 现在包含了刚出队的缓冲区的索引
-    // dqbuf.bytesused 包含了缓冲区中实际有效数据的字节数
-    
-    // 检查出队的缓冲区索引是否有效
-    if (dqbuf.index >= FRAMEBUFFER_COUNT) { // 理想情况: dqbuf.index >= reqbuf.count
+
+    // 检查出队的缓冲区索引和映射地址是否有效
+    if (dqbuf.index >= (unsigned int)ctx->buf_count || !ctx->buf_infos[dqbuf.index].start) {
         fprintf(stderr, "Error: VIDIOC_DQBUF returned invalid buffer index %d.\n", dqbuf.index);
-        // 这是一个严重错误，需要将缓冲区尝试重新入队（如果状态允许）或停止采集
-        // 简单处理：返回错误，后续可能需要手动QBUF这个非法索引的buffer或重启采集
+        if (dqbuf.index < (unsigned int)ctx->buf_count) {
+            ioctl(ctx->fd, VIDIOC_QBUF, &dqbuf); // 尝试归还缓冲区以避免驱动程序状态不一致
+        }
         return -1;
     }
 
-    // 4. 将捕获到的数据 (RGB565) 转换为RGB888格式
-    // buf_infos[dqbuf.index].start 是指向映射内存区域的指针 (包含RGB565数据)
-    // frm_width * frm_height 是总像素数
-    // data 是用户提供的输出缓冲区 (用于RGB888数据)
-    if (buf_infos[dqbuf.index].start) { // 确保缓冲区指针有效
-        rgb565_to_rgb888(buf_infos[dqbuf.index].start, data, frm_width * frm_height);
-    } else {
-        fprintf(stderr, "Error: Buffer %d for DQBUF has NULL start pointer.\n", dqbuf.index);
-        // 尝试将此（可能损坏的）缓冲区重新入队以避免驱动程序状态不一致
-        ioctl(v4l2_fd, VIDIOC_QBUF, &dqbuf); // 即使转换失败，也要尝试归还缓冲区
+    // 3. 填充借出帧信息 (指针直接指向内核映射的缓冲区，无拷贝)
+    frame->data = ctx->buf_infos[dqbuf.index].start;
+    frame->bytesused = dqbuf.bytesused ? dqbuf.bytesused : (unsigned int)ctx->buf_infos[dqbuf.index].length;
+    frame->bytesperline = ctx->frm_bytesperline;
+    frame->width = ctx->frm_width;
+    frame->height = ctx->frm_height;
+    frame->pixelformat = ctx->frm_pixelformat;
+    frame->sequence = dqbuf.sequence;
+    frame->timestamp_us = v4l2_frame_timestamp(&dqbuf);
+    frame->index = (int)dqbuf.index;
+    frame->dmabuf_fd = ctx->buf_infos[dqbuf.index].dmabuf_fd;
+
+    // 4. 标记为已借出
+    ctx->buf_borrowed[dqbuf.index] = 1;
+    return 0;
+}
+
+// 归还一帧借出的图像数据
+/**
+ * @brief 将 `v4l2_ctx_acquire_frame()` 借出的缓冲区重新放入驱动的输入队列 (QBUF)。
+ *
+ * 归还后 `frame->data` 指向的内存随时可能被驱动覆盖，调用者不得再访问。
+ * 重复归还同一帧、或在停止采集后归还，都会被安全地忽略。
+ *
+ * @param ctx 借出该帧的采集上下文。
+ * @param frame 由 `v4l2_ctx_acquire_frame()` 填充的帧描述。
+ * @return 成功返回0；参数无效或 QBUF 失败返回-1。
+ */
+int v4l2_ctx_release_frame(v4l2_ctx *ctx, v4l2_frame *frame)
+{
+    struct v4l2_buffer qbuf = {0}; // V4L2缓冲区结构体，用于 VIDIOC_QBUF
+
+    if (!ctx || !frame || frame->index < 0 || frame->index >= ctx->buf_count) {
         return -1;
     }
-    
-    // 5. 返回图像尺寸 (这些是在v4l2_set_format时确定的)
-    *width = frm_width;
-    *height = frm_height;
-    
-    // 6. 将处理完的缓冲区重新放入驱动的输入队列 (QBUF)
-    // VIDIOC_QBUF: Queue Buffer. 将缓冲区归还给驱动，使其可被再次用于填充数据。
-    // 必须在处理完数据后尽快将缓冲区归还，否则驱动最终会用完所有缓冲区而停止采集。
-    // dqbuf 结构体在DQBUF调用后仍然包含正确的index, type, memory等信息，可以直接用于QBUF。
-    if (0 > ioctl(v4l2_fd, VIDIOC_QBUF, &dqbuf)) {
-        fprintf(stderr, "ioctl error: VIDIOC_QBUF for buffer %d after processing: %s\n", dqbuf.index, strerror(errno));
-        // QBUF失败是严重问题，可能导致驱动停止工作或资源泄漏
-        // 可能需要停止捕获并进行更彻底的清理
+    if (ctx->fd < 0 || !ctx->is_capturing || !ctx->buf_borrowed[frame->index]) {
+        // 已停止采集 (STREAMOFF 已回收全部缓冲区) 或重复归还，无需再 QBUF
+        frame->index = -1;
+        frame->data = NULL;
+        return 0;
+    }
+
+    qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    qbuf.memory = V4L2_MEMORY_MMAP;
+    qbuf.index = (unsigned int)frame->index;
+    if (0 > ioctl(ctx->fd, VIDIOC_QBUF, &qbuf)) {
+        fprintf(stderr, "ioctl error: VIDIOC_QBUF for buffer %d after processing: %s\n", frame->index, strerror(errno));
         return -1;
     }
-    
-    return 0; // 成功获取并处理一帧
+    ctx->buf_borrowed[frame->index] = 0;
+    frame->index = -1;
+    frame->data = NULL;
+    return 0;
 }
 
-// 清理资源
+// 获取一帧RGB888格式的图像数据
 /**
- * @brief 清理所有V4L2相关的资源。
- * 
- * 此函数应在程序退出前或不再需要摄像头时调用。
+ * @brief 从V4L2捕获流中获取一帧视频数据，并将其转换为RGB888格式。
+ *
+ * 内部通过 `v4l2_ctx_acquire_frame()` 借出缓冲区，
+ * 调用 `pixconv_rgb565_to_rgb888()` 转换到用户提供的 `data` 缓冲区后立即归还。
+ * 只需要原始数据的调用者应直接使用借出/归还接口以避免这次整帧转换和拷贝。
+ * 仅在协商结果为 RGB565 时可用，其它格式返回-1。
+ *
+ * @param ctx 采集上下文。
+ * @param data 指向用户分配的缓冲区的指针，用于存储转换后的RGB888图像数据。
+ *             调用者必须确保此缓冲区足够大 (宽度 * 高度 * 3 字节)。
+ * @param width 输出参数，指向一个int变量，用于接收图像的宽度 (像素)。
+ * @param height 输出参数，指向一个int变量，用于接收图像的高度 (像素)。
+ * @return 成功获取并转换一帧数据返回0；如果无数据可用 (EAGAIN) 或发生其他错误则返回-1。
+ */
+int v4l2_ctx_get_frame(v4l2_ctx *ctx, unsigned char *data, int *width, int *height)
+{
+    v4l2_frame frame; // 借出的原始帧
+    int row;          // 行计数器
+
+    if (!data || !width || !height) { // 检查输出参数指针是否有效
+        fprintf(stderr, "Error: v4l2_get_frame called with NULL output parameters.\n");
+        return -1;
+    }
+    if (ctx && ctx->frm_pixelformat != V4L2_PIX_FMT_RGB565) {
+        fprintf(stderr, "Error: v4l2_get_frame only supports RGB565 capture, use v4l2_acquire_frame instead.\n");
+        return -1;
+    }
+    if (0 > v4l2_ctx_acquire_frame(ctx, &frame)) {
+        return -1;
+    }
+
+    // 按行转换，兼容驱动在行尾添加填充字节的情况
+    for (row = 0; row < frame.height; row++) {
+        pixconv_rgb565_to_rgb888((const uint16_t *)((const unsigned char *)frame.data + (size_t)row * frame.bytesperline),
+                         data + (size_t)row * frame.width * 3, frame.width);
+    }
+    *width = frame.width;
+    *height = frame.height;
+
+    return v4l2_ctx_release_frame(ctx, &frame);
+}
+
+// 获取设备文件描述符
+/**
+ * @brief 获取上下文中打开的摄像头设备文件描述符。
+ *
+ * 设备以 O_NONBLOCK 方式打开，调用者可以在此 fd 上 poll()/select() 等待 POLLIN，
+ * 然后调用 `v4l2_ctx_acquire_frame()` 取出已完成的帧。调用者不得自行关闭此 fd。
+ *
+ * @return 设备已打开时返回文件描述符；否则返回-1。
+ */
+int v4l2_ctx_get_fd(const v4l2_ctx *ctx)
+{
+    return ctx ? ctx->fd : -1;
+}
+
+// 查询实际格式
+/**
+ * @brief 返回 `v4l2_set_format()` 中驱动实际接受的宽度、高度和像素格式。
+ *
+ * @return 成功返回0；ctx 无效返回-1。
+ */
+int v4l2_ctx_get_format(const v4l2_ctx *ctx, int *width, int *height, unsigned int *pixelformat)
+{
+    if (!ctx || ctx->fd < 0) {
+        return -1;
+    }
+    if (width)       *width = ctx->frm_width;
+    if (height)      *height = ctx->frm_height;
+    if (pixelformat) *pixelformat = ctx->frm_pixelformat;
+    return 0;
+}
+
+// 获取实际生效的帧率
+/**
+ * @brief 返回 `v4l2_set_format()` 中驱动读回的标称帧率。
+ *
+ * @return 帧率 (fps)；ctx 无效返回-1。
+ */
+int v4l2_ctx_get_fps(const v4l2_ctx *ctx)
+{
+    if (!ctx || ctx->fd < 0) {
+        return -1;
+    }
+    return ctx->frm_fps;
+}
+
+// 获取设备路径
+/**
+ * @brief 返回打开上下文时传入的设备节点路径。
+ */
+const char *v4l2_ctx_device(const v4l2_ctx *ctx)
+{
+    return ctx ? ctx->device : "";
+}
+
+// 关闭摄像头
+/**
+ * @brief 清理一个上下文的所有V4L2相关资源并释放上下文。
+ *
  * 它执行以下操作：
- * 1. 调用 `v4l2_stop_capture()` 停止视频流 (如果正在运行)。
- * 2. 对于每一个映射的缓冲区，调用 `munmap()` 解除其内存映射。
- * 3. 关闭打开的摄像头设备文件描述符 `v4l2_fd`。
- * 4. 重置相关全局变量 (如 `v4l2_fd`, `is_capturing`)。
+ * 1. 调用 `v4l2_ctx_stop_capture()` 停止视频流 (如果正在运行)。
+ * 2. 对于每一个映射的缓冲区，调用 `munmap()` 解除其内存映射 (包括初始化中途失败时已映射的部分)，
+ *    并关闭导出的 DMABUF fd (已经引用它的其它设备仍持有自己的引用，不受影响)。
+ * 3. 关闭打开的摄像头设备文件描述符。
+ * 4. 释放上下文内存。
  */
-void v4l2_cleanup()
+void v4l2_close(v4l2_ctx *ctx)
 {
     int i; // 循环计数器
 
+    if (!ctx) {
+        return;
+    }
+
     // 1. 停止视频采集 (如果正在进行)
-    // v4l2_stop_capture() 内部会检查 is_capturing 和 v4l2_fd
-    v4l2_stop_capture();
-    
+    // v4l2_ctx_stop_capture() 内部会检查 is_capturing 和 fd
+    v4l2_ctx_stop_capture(ctx);
+
     // 2. 解除内存映射
-    // 只有当设备已成功打开 (v4l2_fd >=0) 且缓冲区已映射时才需要解除映射
-    if (v4l2_fd >= 0) { // 隐含了 v4l2_init 可能已成功执行到映射步骤
-        for (i = 0; i < FRAMEBUFFER_COUNT; i++) { // 理想情况: for (i = 0; i < reqbuf.count; i++)
-            // 检查 buf_infos[i].start 是否有效且非 MAP_FAILED (mmap失败的返回值)
-            // MAP_FAILED通常是 (void *)-1，但直接与NULL比较在原代码中是常见的简化
-            // 更安全的检查是 buf_infos[i].start && buf_infos[i].start != MAP_FAILED
-            if (buf_infos[i].start != NULL && buf_infos[i].start != MAP_FAILED) {
-                if (0 > munmap(buf_infos[i].start, buf_infos[i].length)) {
-                    // munmap 失败通常不常见，但如果发生，打印错误
-                    fprintf(stderr, "munmap error for buffer %d: %s\n", i, strerror(errno));
-                }
-                buf_infos[i].start = NULL; // 标记为已解除映射 (或 MAP_FAILED)
-                buf_infos[i].length = 0;
+    for (i = 0; i < ctx->buf_count; i++) {
+        // 上下文由 calloc 分配，未映射的缓冲区起始地址为NULL；mmap失败时也已重置为NULL
+        if (ctx->buf_infos[i].start != NULL && ctx->buf_infos[i].start != MAP_FAILED) {
+            if (0 > munmap(ctx->buf_infos[i].start, ctx->buf_infos[i].length)) {
+                // munmap 失败通常不常见，但如果发生，打印错误
+                fprintf(stderr, "munmap error for buffer %d: %s\n", i, strerror(errno));
             }
+            ctx->buf_infos[i].start = NULL;
+            ctx->buf_infos[i].length = 0;
+        }
+        if (ctx->buf_infos[i].dmabuf_fd >= 0) {
+            close(ctx->buf_infos[i].dmabuf_fd);
+            ctx->buf_infos[i].dmabuf_fd = -1;
         }
     }
-    
+
     // 3. 关闭设备文件描述符
-    if (v4l2_fd >= 0) { // 检查文件描述符是否有效 (即设备已打开)
-        if (0 > close(v4l2_fd)) {
-            fprintf(stderr, "close error for V4L2 device: %s\n", strerror(errno));
+    if (ctx->fd >= 0) { // 检查文件描述符是否有效 (即设备已打开)
+        if (0 > close(ctx->fd)) {
+            fprintf(stderr, "close error for V4L2 device %s: %s\n", ctx->device, strerror(errno));
         }
-        v4l2_fd = -1; // 重置文件描述符，表示设备已关闭
+        ctx->fd = -1;
     }
 
-    // 重置其他状态变量 (可选，但良好实践)
-    is_capturing = 0;
-    frm_width = 0;
-    frm_height = 0;
-    // cam_fmts 和 buf_infos 的内容不需要显式清除，因为它们是静态分配的，
-    // 并且在下一次成功的v4l2_init中会被重新填充。
+    printf("V4L2: Cleanup completed for %s.\n", ctx->device);
+    // 4. 释放上下文
+    free(ctx);
+}
+
+// 兼容接口实现 (操作默认上下文)
+
+/**
+ * @brief 初始化V4L2摄像头设备 (默认上下文)。
+ *
+ * 等价于以默认参数调用 `v4l2_open()`。如果默认上下文已经打开，先关闭它，
+ * 避免重复初始化时泄漏文件描述符和映射。
+ *
+ * @param device 摄像头设备文件的路径字符串 (例如 "/dev/video0")。
+ * @return 成功返回0，失败返回-1。
+ */
+int v4l2_init(const char *device)
+{
+    if (default_ctx) {
+        v4l2_close(default_ctx);
+        default_ctx = NULL;
+    }
+    default_ctx = v4l2_open(device, NULL);
+    return default_ctx ? 0 : -1;
+}
+
+/**
+ * @brief 开始默认上下文的视频捕获流。
+ * @return 成功返回0，失败返回-1。
+ */
+int v4l2_start_capture()
+{
+    return v4l2_ctx_start_capture(default_ctx);
+}
+
+/**
+ * @brief 停止默认上下文的视频捕获流。
+ */
+void v4l2_stop_capture()
+{
+    v4l2_ctx_stop_capture(default_ctx);
+}
+
+/**
+ * @brief 从默认上下文借出一帧原始图像数据 (零拷贝)。
+ */
+int v4l2_acquire_frame(v4l2_frame *frame)
+{
+    return v4l2_ctx_acquire_frame(default_ctx, frame);
+}
+
+/**
+ * @brief 把借出的缓冲区归还给默认上下文。
+ */
+int v4l2_release_frame(v4l2_frame *frame)
+{
+    return v4l2_ctx_release_frame(default_ctx, frame);
+}
+
+/**
+ * @brief 从默认上下文获取一帧RGB888格式的图像数据。
+ */
+int v4l2_get_frame(unsigned char *data, int *width, int *height)
+{
+    return v4l2_ctx_get_frame(default_ctx, data, width, height);
+}
 
-    printf("V4L2: Cleanup completed.\n");
+/**
+ * @brief 获取默认上下文的设备文件描述符。
+ */
+int v4l2_get_fd(void)
+{
+    return v4l2_ctx_get_fd(default_ctx);
+}
+
+/**
+ * @brief 清理默认上下文的所有V4L2相关资源。
+ */
+void v4l2_cleanup()
+{
+    v4l2_close(default_ctx);
+    default_ctx = NULL;
 }
@@ -1,10 +1,17 @@
 /**
  * @file v4l2_wrapper.h
  * @brief V4L2 功能封装层的头文件
- * 
+ *
  * 此头文件声明了与 Video4Linux2 (V4L2) 摄像头交互的C函数接口。
  * 这些函数封装了V4L2的复杂性，提供了一个更简单的API来初始化摄像头、
  * 开始/停止视频捕获、获取视频帧以及清理资源。
+ *
+ * 接口分为两组：
+ * - 上下文接口 (`v4l2_open()` / `v4l2_ctx_*()` / `v4l2_close()`)：每个摄像头一个独立的
+ *   `v4l2_ctx`，互不共享状态，多个摄像头可以在各自的线程中同时采集。
+ * - 兼容接口 (`v4l2_init()` / `v4l2_get_frame()` / `v4l2_cleanup()` 等)：操作内部的一个
+ *   默认上下文，行为与原来的单摄像头接口一致。
+ *
  * 设计为纯C接口，以便于C和C++项目调用。
  */
 #ifndef V4L2_WRAPPER_H
@@ -15,12 +22,152 @@
 extern "C" { // "C" linkage specification for C++ compilers
 #endif
 
+#define V4L2_DEVICE_PATH_MAX 32 ///< 设备节点路径的最大长度 (例如 "/dev/video0")。
+
+/**
+ * @brief 描述一帧从驱动借出的原始视频数据 (零拷贝)。
+ *
+ * 由 `v4l2_acquire_frame()` 填充。`data` 直接指向内核mmap映射的帧缓冲区，
+ * 在调用 `v4l2_release_frame()` 归还之前一直有效，归还后不得再访问。
+ */
+typedef struct v4l2_frame {
+    const void *data;          /**< 指向帧缓冲区起始地址，像素格式为驱动输出格式 (见 pixelformat)。 */
+    unsigned int bytesused;    /**< 缓冲区中有效数据的字节数。 */
+    unsigned int bytesperline; /**< 每行的字节数 (行跨度)，可能大于 width * 每像素字节数。 */
+    int width;                 /**< 图像宽度 (像素)。 */
+    int height;                /**< 图像高度 (像素)。 */
+    unsigned int pixelformat;  /**< V4L2像素格式四字符码 (FourCC)，例如 V4L2_PIX_FMT_RGB565。 */
+    unsigned int sequence;     /**< 驱动给出的帧序号，可用于检测丢帧。 */
+    long long timestamp_us;    /**< 采集时间戳 (微秒，CLOCK_MONOTONIC)。优先使用驱动在 DQBUF 中给出的时间戳；
+                                    驱动的时间戳不是单调时钟或为0时，退回出队时刻的 CLOCK_MONOTONIC。 */
+    int index;                 /**< 内部缓冲区索引，归还时使用，调用者不应修改。 */
+    int dmabuf_fd;             /**< 该缓冲区导出的 DMABUF fd (VIDIOC_EXPBUF)，驱动不支持时为-1。
+                                    归上下文所有，调用者不得关闭；需要在归还后继续引用时应自行 dup()。 */
+} v4l2_frame;
+
+/**
+ * @brief 打开摄像头时期望的采集参数。
+ *
+ * `v4l2_open()` 会在设备支持的 NV12 / YUYV / RGB565 / MJPEG 格式中协商：
+ * 优先选能满足期望分辨率和帧率、且转换为编码器 YUV420P 代价最低的格式
+ * (NV12 > YUYV > RGB565 > MJPEG)，分辨率取驱动枚举的尺寸中最接近期望值的一个。
+ * 实际生效的值通过 `v4l2_ctx_get_format()` 查询。
+ * 字段为0时使用默认值 (640x480, 自动选择格式, 30fps)。
+ */
+typedef struct v4l2_params {
+    int width;                 /**< 期望的图像宽度 (像素)。 */
+    int height;                /**< 期望的图像高度 (像素)。 */
+    unsigned int pixelformat;  /**< 指定的像素格式 FourCC (NV12/YUYV/RGB565/MJPEG)，0 表示自动协商。 */
+    int fps;                   /**< 期望的帧率。超过驱动在该分辨率下的上限时降到上限；驱动不支持设置帧率时忽略。 */
+} v4l2_params;
+
+/**
+ * @brief 单个摄像头的采集上下文 (不透明类型)。
+ *
+ * 保存设备文件描述符、映射的缓冲区、实际格式和采集状态。
+ * 同一个上下文不可在多个线程中并发调用；不同上下文之间完全独立。
+ */
+typedef struct v4l2_ctx v4l2_ctx;
+
+/**
+ * @brief 枚举系统中可用的视频采集设备。
+ *
+ * 依次探测 /dev/video0 ~ /dev/video15，只保留支持视频捕获和流式I/O的节点
+ * (跳过UVC元数据节点、编解码器等不能采集图像的设备)。
+ *
+ * @param paths 输出数组，每项接收一个设备节点路径。
+ * @param max_devices 数组容量，最多返回这么多个设备。
+ * @return 找到的设备数量 (0 ~ max_devices)。
+ */
+int v4l2_enum_capture_devices(char paths[][V4L2_DEVICE_PATH_MAX], int max_devices);
+
+/**
+ * @brief 打开并初始化一个摄像头，返回其采集上下文。
+ *
+ * 以非阻塞方式打开设备，查询其能力，协商并设置视频格式（分辨率、像素格式、帧率），
+ * 并初始化用于视频捕获的内存映射缓冲区。
+ *
+ * @param device 摄像头设备文件的路径 (例如 "/dev/video1")。
+ * @param params 期望的采集参数，传 NULL 使用默认值。
+ * @return 成功返回新的上下文 (用 `v4l2_close()` 释放)；失败返回 NULL，且已释放所有资源。
+ */
+v4l2_ctx *v4l2_open(const char *device, const v4l2_params *params);
+
+/**
+ * @brief 开始视频采集 (把所有缓冲区排入驱动队列并启动视频流)。
+ * @return 成功时返回0；发生错误时返回-1。
+ */
+int v4l2_ctx_start_capture(v4l2_ctx *ctx);
+
+/**
+ * @brief 停止视频采集。之前借出但尚未归还的帧全部失效。
+ */
+void v4l2_ctx_stop_capture(v4l2_ctx *ctx);
+
+/**
+ * @brief 从指定摄像头借出一帧原始图像数据 (零拷贝)，语义同 `v4l2_acquire_frame()`。
+ * @return 成功时返回0；如果暂时没有数据可用或发生错误时返回-1。
+ */
+int v4l2_ctx_acquire_frame(v4l2_ctx *ctx, v4l2_frame *frame);
+
+/**
+ * @brief 归还 `v4l2_ctx_acquire_frame()` 借出的缓冲区，语义同 `v4l2_release_frame()`。
+ * @return 成功时返回0；发生错误时返回-1。
+ */
+int v4l2_ctx_release_frame(v4l2_ctx *ctx, v4l2_frame *frame);
+
+/**
+ * @brief 从指定摄像头获取一帧RGB888格式的图像数据，语义同 `v4l2_get_frame()`。
+ * @return 成功时返回0；如果暂时没有数据可用、发生错误或协商格式不是 RGB565 时返回-1。
+ */
+int v4l2_ctx_get_frame(v4l2_ctx *ctx, unsigned char *data, int *width, int *height);
+
+/**
+ * @brief 获取指定摄像头的文件描述符，用于 poll()/select() 等待新帧。调用者不得关闭此 fd。
+ * @return 文件描述符；ctx 无效或设备未打开时返回-1。
+ */
+int v4l2_ctx_get_fd(const v4l2_ctx *ctx);
+
+/**
+ * @brief 查询驱动实际生效的采集格式。
+ *
+ * @param ctx 采集上下文。
+ * @param width 输出图像宽度 (像素)，可为 NULL。
+ * @param height 输出图像高度 (像素)，可为 NULL。
+ * @param pixelformat 输出像素格式 FourCC，可为 NULL。
+ * @return 成功时返回0；ctx 无效时返回-1。
+ */
+int v4l2_ctx_get_format(const v4l2_ctx *ctx, int *width, int *height, unsigned int *pixelformat);
+
+/**
+ * @brief 查询驱动实际生效的标称帧率 (VIDIOC_S_PARM 之后读回的 timeperframe)。
+ *
+ * 只作为编码器码率控制的提示；实际帧间隔以每帧的 `timestamp_us` 为准。
+ * @return 帧率 (fps)；驱动不支持设置帧率时返回期望值；ctx 无效时返回-1。
+ */
+int v4l2_ctx_get_fps(const v4l2_ctx *ctx);
+
+/**
+ * @brief 获取上下文对应的设备节点路径 (例如 "/dev/video1")，主要用于日志。
+ * @return 设备路径字符串；ctx 为 NULL 时返回空字符串。
+ */
+const char *v4l2_ctx_device(const v4l2_ctx *ctx);
+
+/**
+ * @brief 停止采集，解除缓冲区映射，关闭设备并释放上下文。ctx 为 NULL 时不做任何事。
+ */
+void v4l2_close(v4l2_ctx *ctx);
+
+/* --------------------------------------------------------------------------
+ * 兼容接口：以下函数操作内部的默认上下文，供只使用一个摄像头的代码调用。
+ * -------------------------------------------------------------------------- */
+
 /**
  * @brief 初始化摄像头设备。
- * 
+ *
  * 打开指定的摄像头设备，查询其能力，设置视频格式（分辨率、像素格式、帧率），
  * 并初始化用于视频捕获的内存映射缓冲区。
- * 
+ *
  * @param device 字符串，表示摄像头设备文件的路径 (例如 "/dev/video0")。
  * @return 成功时返回0；发生错误时返回-1。
  */
@@ -28,27 +175,27 @@ int v4l2_init(const char *device);
 
 /**
  * @brief 开始视频采集流程。
- * 
+ *
  * 将所有先前初始化的缓冲区排入驱动程序的队列，并启动视频流。
  * 此函数必须在 `v4l2_init` 成功调用之后才能调用。
- * 
+ *
  * @return 成功时返回0；发生错误时返回-1。
  */
 int v4l2_start_capture();
 
 /**
  * @brief 停止视频采集流程。
- * 
+ *
  * 停止视频流。此函数之后，`v4l2_get_frame` 将不再返回新的数据。
  */
 void v4l2_stop_capture();
 
 /**
  * @brief 获取一帧RGB888格式的图像数据。
- * 
- * 从摄像头捕获流中取出一帧数据，该数据通常是摄像头原始格式（例如RGB565或YUYV），
- * 然后将其转换为RGB888格式，并存入用户提供的缓冲区。
- * 
+ *
+ * 从摄像头捕获流中取出一帧RGB565原始数据，将其转换为RGB888格式，并存入用户提供的缓冲区。
+ * 协商得到其它格式 (YUYV/NV12/MJPEG) 时返回-1，此时应使用 `v4l2_acquire_frame()`。
+ *
  * @param data 指向用户分配的缓冲区的指针，用于存储转换后的RGB888图像数据。
  *             调用者必须确保此缓冲区足够大以容纳一帧图像 (宽度 * 高度 * 3字节)。
  * @param width 指向int类型变量的指针，函数将通过此指针返回捕获图像的实际宽度 (像素)。
@@ -58,9 +205,39 @@ void v4l2_stop_capture();
  */
 int v4l2_get_frame(unsigned char *data, int *width, int *height);
 
+/**
+ * @brief 借出一帧原始图像数据 (零拷贝)。
+ *
+ * 从驱动队列中取出一个已填充的缓冲区，不做格式转换和拷贝，
+ * 直接把映射地址、行跨度、帧序号和采集时间戳填入 `frame`。
+ * 调用者处理完后必须调用 `v4l2_release_frame()` 归还缓冲区。
+ *
+ * @param frame 指向 v4l2_frame 结构体的指针，用于接收借出帧的信息。
+ * @return 成功时返回0；如果暂时没有数据可用或发生错误时返回-1。
+ */
+int v4l2_acquire_frame(v4l2_frame *frame);
+
+/**
+ * @brief 归还 `v4l2_acquire_frame()` 借出的缓冲区，使驱动可以再次填充它。
+ *
+ * @param frame 由 `v4l2_acquire_frame()` 填充的帧描述。归还后其 data 被置为NULL。
+ * @return 成功时返回0；发生错误时返回-1。
+ */
+int v4l2_release_frame(v4l2_frame *frame);
+
+/**
+ * @brief 获取摄像头设备的文件描述符，用于 poll()/select() 等待新帧。
+ *
+ * 设备以非阻塞方式打开：没有已完成帧时 `v4l2_acquire_frame()` 立即返回-1，
+ * 调用者应在此 fd 上等待 POLLIN 后再借出帧。调用者不得关闭此 fd。
+ *
+ * @return 设备已打开时返回文件描述符；否则返回-1。
+ */
+int v4l2_get_fd(void);
+
 /**
  * @brief 清理所有已分配的V4L2相关资源。
- * 
+ *
  * 包括停止视频流（如果正在运行），解除所有缓冲区的内存映射，
  * 并关闭打开的摄像头设备文件描述符。
  * 此函数应在程序不再需要使用摄像头时调用，以避免资源泄漏。
@@ -71,4 +248,4 @@ void v4l2_cleanup();
 } // extern "C"
 #endif
 
-#endif // V4L2_WRAPPER_H
\ No newline at end of file
+#endif // V4L2_WRAPPER_H
@@ -20,20 +20,76 @@ SOURCES += \
     mainwindow.cpp \
     homepage.cpp \
     monitorpage.cpp \
+    previewwidget.cpp \
+    capturethread.cpp \
+    camerachannel.cpp \
     historypage.cpp \
     videopage.cpp \
     recordingthread.cpp \
+    packetfanout.cpp \
+    networkstreamer.cpp \
+    substreamencoder.cpp \
+    recordingcatalog.cpp \
+    retentionworker.cpp \
+    bufferedfilewriter.cpp \
+    recordinglistmodel.cpp \
+    historyloader.cpp \
+    keyframeindex.cpp \
+    timelineloader.cpp \
+    timelinestrip.cpp \
+    pipelinemetrics.cpp \
+    telemetryreporter.cpp \
+    ratecontroller.cpp \
+    slicepool.cpp \
+    monitorservice.cpp \
+    monitorconfig.cpp \
+    headlessrecorder.cpp \
+    recordingexporter.cpp \
+    packetring.cpp \
+    motiondetector.cpp \
+    encoderbackend.cpp \
     storagemanager.cpp \
+    pixel_convert.c \
     v4l2_wrapper.c
 
 HEADERS += \
     mainwindow.h \
     homepage.h \
     monitorpage.h \
+    previewwidget.h \
+    previewframe.h \
+    capturethread.h \
+    camerachannel.h \
+    framesink.h \
     historypage.h \
     videopage.h \
     recordingthread.h \
+    packetsink.h \
+    packetfanout.h \
+    networkstreamer.h \
+    substreamencoder.h \
+    recordingcatalog.h \
+    retentionworker.h \
+    bufferedfilewriter.h \
+    recordinglistmodel.h \
+    historyloader.h \
+    keyframeindex.h \
+    timelineloader.h \
+    timelinestrip.h \
+    pipelinemetrics.h \
+    telemetryreporter.h \
+    ratecontroller.h \
+    slicepool.h \
+    monitorservice.h \
+    monitorconfig.h \
+    headlessrecorder.h \
+    recordingexporter.h \
+    packetring.h \
+    motiondetector.h \
+    encoderbackend.h \
+    spscring.h \
     storagemanager.h \
+    pixel_convert.h \
     v4l2_wrapper.h
 
 FORMS += \
@@ -46,7 +102,7 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 # 添加Linux下需要的库
 unix {
-    LIBS += -lv4l2
+    LIBS += -lv4l2 -lpthread
     
     # 添加FFmpeg相关库
     LIBS += -lavformat -lavcodec -lavutil -lswscale -lswresample
@@ -56,5 +112,10 @@ unix {
     # PKGCONFIG += libavformat libavcodec libavutil libswscale libswresample
 }
 
+# pixel_convert.c 的 NEON 内核需要编译器启用 NEON：AArch64 默认开启；
+# ARMv7 (如 STM32MP157) 的交叉编译工具链通常已带 -mfpu=neon-vfpv4，若没有可在此处添加
+# QMAKE_CFLAGS += -mfpu=neon-vfpv4 -mfloat-abi=hard
+# x86 上的 SSE2/AVX2 内核通过函数级 target 属性编译，运行时检测 CPU 后选用，无需额外参数。
+
 RESOURCES += \
     res.qrc
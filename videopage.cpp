@@ -10,10 +10,17 @@
  * - 在视频播放界面提供返回到历史记录页面的导航功能。
  * - (可选特性) 显示与当前播放视频位于同一目录下的其他视频文件列表，并允许用户切换播放。
  * - (可选特性) 提供一个可切换显示/隐藏状态的侧边栏用于展示同目录视频列表。
+ * - 按录制时保存的关键帧索引吸附和限频拖动定位，显示关键帧缩略图条，只解码关键帧快进。
+ * - 同目录录像连续播放 (备用播放器预先打开下一个文件)。
+ * - 标记开始和结束位置，在后台导出这一时间段的录像 (转封装，可以跨越多个文件)。
  */
 
 #include "videopage.h"
 #include "mainwindow.h" // 包含主窗口头文件，用于页面切换和交互
+#include "recordingcatalog.h" // 录像索引，用于列出同目录的录像
+#include "timelineloader.h"   // 后台关键帧解码线程
+#include "timelinestrip.h"    // 关键帧缩略图条
+#include "recordingexporter.h" // 时间段导出线程
 
 #include <QVBoxLayout>     // Qt布局类，用于垂直排列控件
 #include <QHBoxLayout>     // Qt布局类，用于水平排列控件
@@ -22,6 +29,10 @@
 #include <QFileInfo>       // Qt文件信息类，用于获取文件的属性（如路径、名称、目录）
 #include <QIcon>           // Qt图标类，用于在按钮等控件上显示图标
 #include <QTime>           // Qt时间处理类，用于格式化和显示时间
+#include <QHideEvent>
+#include <QDateTime>
+#include <QMessageBox>
+#include <algorithm>
 
 /**
  * @brief VideoPage 类的构造函数。
@@ -36,6 +47,7 @@ VideoPage::VideoPage(MainWindow *parent)
     : QWidget(parent)                         // 调用父类QWidget的构造函数，并设置父对象
     , m_mainWindow(parent)                    // 初始化主窗口指针
     , m_mediaPlayer(nullptr)                  // 初始化媒体播放器指针为空
+    , m_nextPlayer(nullptr)                   // 初始化备用播放器指针为空
     , m_videoWidget(nullptr)                  // 初始化视频显示控件指针为空
     , m_positionSlider(nullptr)               // 初始化播放进度条指针为空
     , m_durationLabel(nullptr)                // 初始化时长标签指针为空
@@ -45,8 +57,30 @@ VideoPage::VideoPage(MainWindow *parent)
     , m_videoListWidget(nullptr)              // 初始化视频文件列表控件指针为空
     , m_toggleListButton(nullptr)             // 初始化切换列表显示按钮指针为空
     , m_videoListContainer(nullptr)           // 初始化视频列表容器控件指针为空
+    , m_speedButton(nullptr)
+    , m_exportButton(nullptr)
+    , m_timelineStrip(nullptr)
+    , m_trickPlayLabel(nullptr)
+    , m_timelineLoader(nullptr)
+    , m_seekTimer(nullptr)
+    , m_trickPlayTimer(nullptr)
     , m_isVideoListVisible(false)             // 初始化视频列表可见状态为false (隐藏)
     , m_currentVideoDir("")                  // 初始化当前视频目录路径为空字符串
+    , m_catalog(nullptr)                      // 未设置录像索引时列出目录
+    , m_generation(0)
+    , m_stripRequested(false)
+    , m_lastSeekMs(-1)
+    , m_pendingSeekMs(0)
+    , m_speed(SpeedNormal)
+    , m_trickPlaying(false)
+    , m_trickFramePending(false)
+    , m_trickFrame(-1)
+    , m_trickPositionMs(0)
+    , m_trickTargetMs(0)
+    , m_exporter(nullptr)
+    , m_exportMarkMs(-1)
+    , m_exporting(false)
+    , m_exportCancelled(false)
 {
     setupUI(); // 调用UI设置函数，构建界面
 }
@@ -86,11 +120,25 @@ void VideoPage::setupUI()
     // 注意: 最小高度已在 style.qss 文件中通过 #m_videoWidget { min-height: 400px; } 设置
     
     m_mediaPlayer->setVideoOutput(m_videoWidget); // 将 QVideoWidget 设置为 QMediaPlayer 的视频输出目标
+    // 备用播放器：不连接视频控件，只预先打开下一个文件 (解析文件头)，切换时才接管视频控件
+    m_nextPlayer = new QMediaPlayer(this);
+    m_nextPlayer->setMuted(true);
+
+    // 快进画面：叠在视频控件上方，只在快进时显示
+    m_trickPlayLabel = new QLabel();
+    m_trickPlayLabel->setObjectName("m_trickPlayLabel");
+    m_trickPlayLabel->setAlignment(Qt::AlignCenter);
+    m_trickPlayLabel->setMinimumSize(1, 1); // 显示的图像不撑大视频区域
     
     // 2. 播放控制条：进度条和时间标签
     m_positionSlider = new QSlider(Qt::Horizontal); // 创建水平 QSlider 作为播放进度条
     m_positionSlider->setRange(0, 0);               // 初始范围设为0-0，在加载视频后更新
     
+    // 进度条下方的关键帧缩略图条
+    m_timelineStrip = new TimelineStrip();
+    m_timelineStrip->setObjectName("m_timelineStrip");
+    m_timelineStrip->setFixedHeight(m_timelineStrip->sizeHint().height());
+
     m_durationLabel = new QLabel("00:00 / 00:00"); // 创建 QLabel 用于显示播放时间和总时长
     m_durationLabel->setAlignment(Qt::AlignCenter); // 设置文本居中对齐
     
@@ -105,6 +153,13 @@ void VideoPage::setupUI()
     m_stopButton->setIcon(QIcon(":/images/stop.png"));    // 从资源文件设置图标
     m_stopButton->setIconSize(QSize(32, 32));       // 设置图标大小
     m_stopButton->setToolTip(tr("停止"));            // 设置鼠标悬停提示
+
+    m_speedButton = new QPushButton("1x");          // 创建播放速度按钮
+    m_speedButton->setToolTip(tr("播放速度"));
+
+    m_exportButton = new QPushButton(tr("导出"));   // 创建时间段导出按钮 (设置导出线程后才可用)
+    m_exportButton->setEnabled(false);
+    clearExportMark();
     
     // (返回按钮稍后会放置在视频覆盖层上)
     m_backButton = new QPushButton();               // 创建返回按钮 (实际布局位置不同)
@@ -119,10 +174,14 @@ void VideoPage::setupUI()
     m_playPauseButton->setObjectName("m_playPauseButton");
     m_stopButton->setObjectName("m_stopButton");
     m_backButton->setObjectName("m_backButton"); // 虽然布局位置不同，但仍可设置对象名
+    m_speedButton->setObjectName("m_speedButton");
+    m_exportButton->setObjectName("m_exportButton");
     
     // 将播放/暂停和停止按钮添加到 controlLayout
     controlLayout->addWidget(m_playPauseButton);
     controlLayout->addWidget(m_stopButton);
+    controlLayout->addWidget(m_speedButton);
+    controlLayout->addWidget(m_exportButton);
     
     // --- 中间：视频显示区 (包含视频本身和可选的右侧列表) --- 
     QHBoxLayout *videoAndListLayout = new QHBoxLayout(); // 创建水平布局容纳视频区和列表切换部分
@@ -170,7 +229,9 @@ void VideoPage::setupUI()
     QStackedLayout *stackedLayout = new QStackedLayout();
     stackedLayout->setStackingMode(QStackedLayout::StackAll); // 设置堆叠模式为 StackAll，使所有控件可见 (上层透明则下层可见)
     stackedLayout->addWidget(m_videoWidget);  // 先添加视频控件 (在底层)
+    stackedLayout->addWidget(m_trickPlayLabel); // 快进画面 (在视频控件之上)
     stackedLayout->addWidget(overlayWidget);  // 再添加覆盖层 (在顶层)
+    m_trickPlayLabel->hide();
     
     // 将堆叠布局放入一个新的容器QWidget (stackContainer)，然后将此容器添加到 videoAndListLayout
     QWidget *stackContainer = new QWidget();
@@ -186,6 +247,7 @@ void VideoPage::setupUI()
     // --- 组装视频播放器区域的垂直布局 (videoLayout) --- 
     videoLayout->addLayout(videoAndListLayout, 1); // 添加包含视频和列表的水平布局 (设置拉伸因子为1，使其优先占据垂直空间)
     videoLayout->addWidget(m_positionSlider);      // 在视频下方添加进度条
+    videoLayout->addWidget(m_timelineStrip);       // 进度条下方是关键帧缩略图条
     videoLayout->addWidget(m_durationLabel);       // 在进度条下方添加时间标签
     videoLayout->addLayout(controlLayout);         // 在最下方添加播放控制按钮布局
     
@@ -201,10 +263,32 @@ void VideoPage::setupUI()
     connect(m_backButton, &QPushButton::clicked, m_mainWindow, &MainWindow::returnFromVideoPage);
     // 进度条的 sliderMoved 信号 (用户拖动滑块时) 连接到 setVideoPosition 槽函数
     connect(m_positionSlider, &QSlider::sliderMoved, this, &VideoPage::setVideoPosition);
-    // QMediaPlayer 的 positionChanged 信号 (播放位置改变时) 连接到 videoPositionChanged 槽函数
-    connect(m_mediaPlayer, &QMediaPlayer::positionChanged, this, &VideoPage::videoPositionChanged);
-    // QMediaPlayer 的 durationChanged 信号 (视频总时长确定或改变时) 连接到 videoDurationChanged 槽函数
-    connect(m_mediaPlayer, &QMediaPlayer::durationChanged, this, &VideoPage::videoDurationChanged);
+    // 松开滑块时定位到最终位置
+    connect(m_positionSlider, &QSlider::sliderReleased, this, &VideoPage::onSliderReleased);
+    // 两个播放器的位置、时长和媒体状态信号 (只处理正在播放的一个)
+    connectPlayer(m_mediaPlayer);
+    connectPlayer(m_nextPlayer);
+    // 速度按钮
+    connect(m_speedButton, &QPushButton::clicked, this, &VideoPage::cycleSpeed);
+    // 导出按钮
+    connect(m_exportButton, &QPushButton::clicked, this, &VideoPage::onExportClicked);
+    // 点击缩略图条定位
+    connect(m_timelineStrip, &TimelineStrip::seekRequested, this, &VideoPage::seekTo);
+
+    // 拖动定位限频和快进节拍
+    m_seekTimer = new QTimer(this);
+    m_seekTimer->setSingleShot(true);
+    m_seekTimer->setInterval(SEEK_THROTTLE_MS);
+    connect(m_seekTimer, &QTimer::timeout, this, &VideoPage::onSeekTimeout);
+    m_trickPlayTimer = new QTimer(this);
+    m_trickPlayTimer->setInterval(TRICK_TICK_MS);
+    connect(m_trickPlayTimer, &QTimer::timeout, this, &VideoPage::onTrickPlayTick);
+
+    // 后台关键帧解码线程：结果排队到GUI线程
+    m_timelineLoader = new TimelineLoader(this);
+    connect(m_timelineLoader, &TimelineLoader::keyFrameReady, this, &VideoPage::onKeyFrameReady);
+    connect(m_timelineLoader, &TimelineLoader::stripFrameReady, this, &VideoPage::onStripFrameReady);
+    m_timelineLoader->startLoader();
     // 视频列表控件的 itemDoubleClicked 信号 (列表项被双击时) 连接到 videoItemDoubleClicked 槽函数
     connect(m_videoListWidget, &QListWidget::itemDoubleClicked, this, &VideoPage::videoItemDoubleClicked);
     // 切换列表显示按钮的 clicked 信号连接到一个 lambda 表达式，用于处理列表的显示/隐藏逻辑
@@ -238,24 +322,17 @@ void VideoPage::setupUI()
  * @param filePath 要播放的视频文件的完整路径。
  * 
  * 此函数执行以下操作：
- * 1. 使用 QMediaPlayer 加载并开始播放指定的视频文件。
- * 2. 更新播放/暂停按钮的图标为"暂停"状态。
- * 3. 清空当前的视频文件列表 (`m_videoListWidget`)。
- * 4. 获取当前播放视频所在的目录。
- * 5. 将此目录路径保存到 `m_currentVideoDir` 成员变量。
- * 6. 更新视频列表的标题，显示为当前目录的名称。
- * 7. 扫描该目录下的所有 MP4 文件。
- * 8. 将扫描到的MP4文件添加到 `m_videoListWidget` 中，并为每个列表项设置图标和文件路径数据。
- * 9. 如果列表中的某个文件是当前正在播放的视频，则将其设为选中状态并滚动到可视区域。
+ * 1. 清空当前的视频文件列表 (`m_videoListWidget`)。
+ * 2. 获取当前播放视频所在的目录。
+ * 3. 将此目录路径保存到 `m_currentVideoDir` 成员变量。
+ * 4. 更新视频列表的标题，显示为当前目录的名称。
+ * 5. 查询该目录下的所有录像文件 (文件已记入录像索引时查询索引，否则扫描目录)。
+ * 6. 将扫描到的MP4文件添加到 `m_videoListWidget` 中，并为每个列表项设置图标和文件路径数据。
+ * 7. 调用 `openFile()` 开始播放 (在列表中选中该文件，预先打开列表中的下一个文件)。
  */
 void VideoPage::playVideo(const QString &filePath)
 {
-    // 1. 设置媒体源并开始播放
-    m_mediaPlayer->setMedia(QUrl::fromLocalFile(filePath)); // 从本地文件路径创建QUrl作为媒体源
-    m_mediaPlayer->play();                                  // 开始播放
-    m_playPauseButton->setIcon(QIcon(":/images/pause.png")); // 更新按钮图标为"暂停"
-    
-    // 2. 更新同目录视频列表
+    // 1. 更新同目录视频列表 (连续播放按列表顺序取下一个文件，因此先于播放)
     m_videoListWidget->clear(); // 清空现有列表项
     
     // 获取当前视频文件的信息和所在目录
@@ -270,28 +347,37 @@ void VideoPage::playVideo(const QString &filePath)
         listTitle->setText(videoDir.dirName() + tr(" 目录视频列表")); // 设置标题文本
     }
     
-    // 定义文件过滤器，只查找.mp4文件 (不区分大小写)
-    QStringList filters;
-    filters << "*.mp4" << "*.MP4";
-    // 获取目录中所有符合条件的视频文件信息列表，按名称排序
-    QFileInfoList videoFiles = videoDir.entryInfoList(filters, QDir::Files, QDir::Name);
+    // 同目录的录像文件路径 (按名称排序)：当前文件已记入录像索引时查询索引，否则扫描目录
+    QStringList videoPaths;
+    if (m_catalog && m_catalog->findFile(filePath, nullptr)) {
+        QVector<RecordingCatalog::Entry> entries;
+        m_catalog->listDir(m_currentVideoDir, nullptr, &entries);
+        for (const RecordingCatalog::Entry &entry : entries) {
+            videoPaths << m_catalog->absolutePath(entry);
+        }
+    } else {
+        // 定义文件过滤器，只查找录像文件 .mp4 / .ts (不区分大小写)
+        QStringList filters;
+        filters << "*.mp4" << "*.MP4" << "*.ts" << "*.TS";
+        // 获取目录中所有符合条件的视频文件信息列表，按名称排序
+        QFileInfoList videoFiles = videoDir.entryInfoList(filters, QDir::Files, QDir::Name);
+        for (const QFileInfo &videoFileInfo : videoFiles) {
+            videoPaths << videoFileInfo.absoluteFilePath();
+        }
+    }
     
     // 遍历找到的视频文件，添加到列表控件中
-    for (const QFileInfo &videoFileInfo : videoFiles) {
-        QString displayName = videoFileInfo.fileName(); // 获取文件名作为显示名称
+    for (const QString &videoPath : videoPaths) {
+        QString displayName = QFileInfo(videoPath).fileName(); // 获取文件名作为显示名称
         // 创建列表项，设置图标 (来自资源) 和显示名称
         QListWidgetItem *item = new QListWidgetItem(QIcon(":/images/mp4.png"), displayName);
         // 将视频文件的完整路径存储在列表项的 UserRole 数据中，方便后续引用
-        item->setData(Qt::UserRole, videoFileInfo.absoluteFilePath());
-        
-        // 如果当前列表项对应的是正在播放的视频文件，则将其设为选中状态，并确保其可见
-        if (videoFileInfo.absoluteFilePath() == filePath) {
-            item->setSelected(true);
-            m_videoListWidget->scrollToItem(item, QAbstractItemView::EnsureVisible); // 滚动到该项
-        }
-        
+        item->setData(Qt::UserRole, videoPath);
         m_videoListWidget->addItem(item); // 将创建的列表项添加到视频列表控件
     }
+
+    // 2. 开始播放
+    openFile(filePath);
 }
 
 /**
@@ -303,6 +389,18 @@ void VideoPage::playVideo(const QString &filePath)
  */
 void VideoPage::playPauseVideo()
 {
+    if (m_trickPlaying) {
+        // 快进中：暂停/继续快进的节拍，播放器保持暂停
+        if (m_trickPlayTimer->isActive()) {
+            m_trickPlayTimer->stop();
+            m_playPauseButton->setIcon(QIcon(":/images/playback.png"));
+        } else {
+            m_trickClock.start();
+            m_trickPlayTimer->start();
+            m_playPauseButton->setIcon(QIcon(":/images/pause.png"));
+        }
+        return;
+    }
     if (m_mediaPlayer->state() == QMediaPlayer::PlayingState) { // 如果正在播放
         m_mediaPlayer->pause();                                  // 暂停播放
         m_playPauseButton->setIcon(QIcon(":/images/playback.png")); // 更新图标为"播放"
@@ -315,10 +413,11 @@ void VideoPage::playPauseVideo()
 /**
  * @brief 槽函数：处理停止按钮的点击事件。
  * 
- * 调用 `m_mediaPlayer->stop()` 停止视频播放，并将播放/暂停按钮的图标恢复为"播放"状态。
+ * 结束快进并恢复 1x 速度，调用 `m_mediaPlayer->stop()` 停止视频播放，并将播放/暂停按钮的图标恢复为"播放"状态。
  */
 void VideoPage::stopVideo()
 {
+    resetSpeed();
     m_mediaPlayer->stop(); // 停止播放
     m_playPauseButton->setIcon(QIcon(":/images/playback.png")); // 更新图标为"播放"
 }
@@ -327,12 +426,61 @@ void VideoPage::stopVideo()
  * @brief 槽函数：处理播放进度条的拖动事件 (`sliderMoved`)。
  * @param position 用户通过拖动滑块选择的新的播放位置 (单位：毫秒)。
  * 
- * 当用户拖动进度条滑块时，此函数被调用。它将 QMediaPlayer 的播放位置
- * 设置为用户指定的新位置。
+ * 当用户拖动进度条滑块时，此函数被调用。每次 `setPosition()` 都会让解码器重新定位，
+ * 在TF卡上很慢，因此这里只定位到吸附的关键帧 (解码器不需要从上一个关键帧解码到目标位置)，
+ * 并且最多每 SEEK_THROTTLE_MS 定位一次；时间标签始终显示滑块的位置。
  */
 void VideoPage::setVideoPosition(int position)
 {
-    m_mediaPlayer->setPosition(position); // 设置播放器的播放位置
+    m_pendingSeekMs = snapToKeyFrame(position);
+    updateTimeLabel(position, m_mediaPlayer->duration());
+    if (!m_seekTimer->isActive() && m_pendingSeekMs != m_lastSeekMs) {
+        m_lastSeekMs = m_pendingSeekMs;
+        seekTo(m_pendingSeekMs);
+        m_seekTimer->start(); // 限频：到期时拖动位置有变化才再次定位
+    }
+}
+
+void VideoPage::onSeekTimeout()
+{
+    if (m_positionSlider->isSliderDown() && m_pendingSeekMs != m_lastSeekMs) {
+        m_lastSeekMs = m_pendingSeekMs;
+        seekTo(m_pendingSeekMs);
+        m_seekTimer->start();
+    }
+}
+
+void VideoPage::onSliderReleased()
+{
+    m_seekTimer->stop();
+    const qint64 target = snapToKeyFrame(m_positionSlider->value());
+    if (target != m_lastSeekMs) {
+        seekTo(target);
+    }
+    m_positionSlider->setValue(target);
+    m_lastSeekMs = -1; // 下一次拖动重新开始
+}
+
+qint64 VideoPage::snapToKeyFrame(qint64 positionMs) const
+{
+    const int index = m_keyFrames.nearestIndex(positionMs);
+    return (index < 0) ? positionMs : m_keyFrames.at(index).ptsMs;
+}
+
+void VideoPage::seekTo(qint64 positionMs)
+{
+    m_timelineStrip->setPosition(positionMs);
+    if (m_trickPlaying) {
+        // 快进中：立即显示这个位置的关键帧，并从这里继续快进
+        m_trickTargetMs = positionMs;
+        m_trickClock.start();
+        const int frame = m_keyFrames.floorIndex(positionMs);
+        if (frame >= 0) {
+            requestTrickFrame(frame);
+        }
+        return;
+    }
+    m_mediaPlayer->setPosition(positionMs); // 设置播放器的播放位置
 }
 
 /**
@@ -347,13 +495,17 @@ void VideoPage::setVideoPosition(int position)
  */
 void VideoPage::videoPositionChanged(qint64 position)
 {
-    // 只有当用户没有拖动滑块时，才更新滑块位置 (避免冲突)
-    if (!m_positionSlider->isSliderDown()) {
-        m_positionSlider->setValue(position); // 更新进度条滑块的值
+    // 只有当用户没有拖动滑块时，才更新滑块位置和时间标签 (拖动时显示滑块的位置)
+    if (m_positionSlider->isSliderDown()) {
+        return;
     }
-    
-    // 更新时间显示标签
-    qint64 duration = m_mediaPlayer->duration(); // 获取视频总时长
+    m_positionSlider->setValue(position); // 更新进度条滑块的值
+    m_timelineStrip->setPosition(position);
+    updateTimeLabel(position, m_mediaPlayer->duration());
+}
+
+void VideoPage::updateTimeLabel(qint64 position, qint64 duration)
+{
     // 将毫秒转换为QTime对象，方便格式化
     QTime currentTime((position / 3600000) % 60, (position / 60000) % 60, (position / 1000) % 60);
     QTime totalTime((duration / 3600000) % 60, (duration / 60000) % 60, (duration / 1000) % 60);
@@ -379,16 +531,9 @@ void VideoPage::videoDurationChanged(qint64 duration)
 {
     m_positionSlider->setRange(0, duration); // 设置进度条的范围为 0 到 总时长
     
-    // 更新时间显示标签 (与videoPositionChanged中的逻辑类似，但基于新的总时长)
-    qint64 currentPosition = m_mediaPlayer->position(); // 获取当前播放位置
-    QTime currentTime((currentPosition / 3600000) % 60, (currentPosition / 60000) % 60, (currentPosition / 1000) % 60);
-    QTime totalTime((duration / 3600000) % 60, (duration / 60000) % 60, (duration / 1000) % 60);
-    
-    QString timeFormat = "mm:ss";
-    if (duration > 3600000) {
-        timeFormat = "hh:mm:ss";
-    }
-    m_durationLabel->setText(currentTime.toString(timeFormat) + " / " + totalTime.toString(timeFormat));
+    // 更新时间显示标签 (基于新的总时长)
+    updateTimeLabel(m_trickPlaying ? m_trickPositionMs : m_mediaPlayer->position(), duration);
+    requestStrip(duration); // 总时长确定后才能等分缩略图条
 }
 
 /**
@@ -399,10 +544,7 @@ void VideoPage::videoDurationChanged(qint64 duration)
  * 它会：
  * 1. 检查 `item` 是否有效。
  * 2. 从被双击的列表项中获取存储的视频文件完整路径 (之前通过 `setData(Qt::UserRole, ...)` 设置)。
- * 3. 停止当前正在播放的视频 (`m_mediaPlayer->stop()`)。
- * 4. 将 QMediaPlayer 的媒体源设置为新选中的视频文件。
- * 5. 开始播放新的视频 (`m_mediaPlayer->play()`)。
- * 6. 更新播放/暂停按钮的图标为"暂停"状态。
+ * 3. 调用 `openFile()` 停止当前播放、打开并播放新选中的视频文件 (速度恢复为 1x)。
  */
 void VideoPage::videoItemDoubleClicked(QListWidgetItem *item)
 {
@@ -413,13 +555,7 @@ void VideoPage::videoItemDoubleClicked(QListWidgetItem *item)
     
     if (filePath.isEmpty()) return; // 如果路径为空，则不执行任何操作
 
-    // 停止当前播放
-    m_mediaPlayer->stop();
-    
-    // 设置新的媒体源并开始播放
-    m_mediaPlayer->setMedia(QUrl::fromLocalFile(filePath));
-    m_mediaPlayer->play();
-    m_playPauseButton->setIcon(QIcon(":/images/pause.png")); // 更新图标为"暂停"
+    openFile(filePath);
 }
 
 /**
@@ -430,4 +566,403 @@ void VideoPage::videoItemDoubleClicked(QListWidgetItem *item)
 QString VideoPage::getCurrentVideoDir() const
 {
     return m_currentVideoDir; // 返回存储的当前视频目录路径
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 设置录像索引。
+ * @param catalog 录像索引，为 nullptr 时列出目录。
+ */
+void VideoPage::setCatalog(const RecordingCatalog *catalog)
+{
+    m_catalog = catalog;
+}
+
+void VideoPage::setExporter(RecordingExporter *exporter, const QString &exportDir)
+{
+    m_exporter = exporter;
+    m_exportDir = exportDir;
+    m_exportButton->setEnabled(m_exporter != nullptr);
+    if (m_exporter) {
+        // 进度和结果在导出线程中发出，排队到GUI线程
+        connect(m_exporter, &RecordingExporter::exportProgress, this, [this](int percent) {
+            if (m_exporting) {
+                m_exportButton->setText(tr("导出 %1%").arg(percent));
+            }
+        });
+        connect(m_exporter, &RecordingExporter::exportFinished, this, &VideoPage::onExportFinished);
+        connect(m_exporter, &RecordingExporter::exportFailed, this, &VideoPage::onExportFailed);
+    }
+}
+
+void VideoPage::connectPlayer(QMediaPlayer *player)
+{
+    // 备用播放器预先打开文件时也会发出时长等信号，交换之前忽略
+    connect(player, &QMediaPlayer::positionChanged, this, [this, player](qint64 position) {
+        if (player == m_mediaPlayer && !m_trickPlaying) {
+            videoPositionChanged(position);
+        }
+    });
+    connect(player, &QMediaPlayer::durationChanged, this, [this, player](qint64 duration) {
+        if (player == m_mediaPlayer) {
+            videoDurationChanged(duration);
+        }
+    });
+    connect(player, &QMediaPlayer::mediaStatusChanged, this, [this, player](QMediaPlayer::MediaStatus status) {
+        if (player != m_mediaPlayer || status != QMediaPlayer::EndOfMedia || m_trickPlaying) {
+            return;
+        }
+        // 当前文件播放完：接着播放列表中的下一个文件
+        if (!switchToNextFile()) {
+            m_playPauseButton->setIcon(QIcon(":/images/playback.png"));
+        }
+    });
+}
+
+void VideoPage::openFile(const QString &filePath)
+{
+    resetSpeed();
+    m_mediaPlayer->stop();
+    resetTimeline(filePath);
+    m_mediaPlayer->setMedia(QUrl::fromLocalFile(filePath)); // 从本地文件路径创建QUrl作为媒体源
+    m_mediaPlayer->play();                                  // 开始播放
+    m_playPauseButton->setIcon(QIcon(":/images/pause.png")); // 更新按钮图标为"暂停"
+    preloadNextFile();
+}
+
+bool VideoPage::switchToNextFile()
+{
+    if (m_nextFile.isEmpty() || m_nextPlayer->mediaStatus() == QMediaPlayer::InvalidMedia
+            || m_nextPlayer->mediaStatus() == QMediaPlayer::NoMedia) {
+        return false;
+    }
+    // 视频控件交给已打开下一个文件的备用播放器，原来的播放器成为新的备用播放器
+    m_mediaPlayer->setVideoOutput(static_cast<QVideoWidget *>(nullptr));
+    std::swap(m_mediaPlayer, m_nextPlayer);
+    m_mediaPlayer->setVideoOutput(m_videoWidget);
+    m_mediaPlayer->setMuted(false);
+    m_nextPlayer->setMuted(true);
+    m_nextPlayer->stop();
+
+    const bool trickPlaying = m_trickPlaying;
+    resetTimeline(m_nextFile);
+    if (!trickPlaying) {
+        m_mediaPlayer->play();
+    }
+    videoDurationChanged(m_mediaPlayer->duration()); // 预先打开时的时长信号已被忽略
+    applySpeed(m_speed); // 新文件可能没有关键帧索引：快进退回播放器的倍速
+    preloadNextFile();
+    return true;
+}
+
+void VideoPage::resetTimeline(const QString &filePath)
+{
+    ++m_generation; // 上一个文件尚未返回的缩略图和快进画面作废
+    m_timelineLoader->cancel();
+    m_currentFile = filePath;
+    m_keyFrames.load(KeyFrameIndex::indexPath(filePath)); // 没有索引文件时为空
+    m_stripRequested = false;
+    m_timelineStrip->reset(0, 0);
+    m_lastSeekMs = -1;
+    m_trickFramePending = false;
+    m_trickFrame = -1;
+    m_trickPositionMs = 0;
+    m_trickTargetMs = 0;
+    m_trickClock.start();
+
+    // 在同目录视频列表中选中这个文件，并确保其可见
+    for (int row = 0; row < m_videoListWidget->count(); ++row) {
+        QListWidgetItem *item = m_videoListWidget->item(row);
+        if (item->data(Qt::UserRole).toString() == filePath) {
+            m_videoListWidget->setCurrentItem(item);
+            m_videoListWidget->scrollToItem(item, QAbstractItemView::EnsureVisible); // 滚动到该项
+            break;
+        }
+    }
+}
+
+void VideoPage::preloadNextFile()
+{
+    m_nextFile.clear();
+    for (int row = 0; row + 1 < m_videoListWidget->count(); ++row) {
+        if (m_videoListWidget->item(row)->data(Qt::UserRole).toString() == m_currentFile) {
+            m_nextFile = m_videoListWidget->item(row + 1)->data(Qt::UserRole).toString();
+            break;
+        }
+    }
+    m_nextPlayer->stop();
+    // 设置媒体源即打开文件并解析文件头；不连接视频控件、不开始播放
+    m_nextPlayer->setMedia(m_nextFile.isEmpty() ? QMediaContent() : QMediaContent(QUrl::fromLocalFile(m_nextFile)));
+}
+
+void VideoPage::requestStrip(qint64 duration)
+{
+    if (m_stripRequested || duration <= 0 || m_currentFile.isEmpty()) {
+        return;
+    }
+    m_stripRequested = true;
+    // 每格取该段中点之前最近的关键帧；没有索引时按时间定位 (解码器同样定位到之前的关键帧)
+    QVector<KeyFrameIndex::Entry> frames;
+    frames.reserve(STRIP_SLOTS);
+    for (int i = 0; i < STRIP_SLOTS; ++i) {
+        const qint64 middle = duration * (2 * i + 1) / (2 * STRIP_SLOTS);
+        if (m_keyFrames.isEmpty()) {
+            KeyFrameIndex::Entry entry;
+            entry.ptsMs = middle;
+            frames.append(entry);
+        } else {
+            frames.append(m_keyFrames.at(m_keyFrames.floorIndex(middle)));
+        }
+    }
+    m_timelineStrip->reset(STRIP_SLOTS, duration);
+    // 页面尚未布局时 (刚切换到播放页) 按建议尺寸解码
+    const int stripWidth = m_timelineStrip->width() >= STRIP_SLOTS ? m_timelineStrip->width() : m_timelineStrip->sizeHint().width();
+    const QSize cellSize(stripWidth / STRIP_SLOTS, m_timelineStrip->sizeHint().height());
+    m_timelineLoader->requestStrip(m_generation, m_currentFile, frames, cellSize);
+}
+
+void VideoPage::onStripFrameReady(int generation, int slot, qint64 ptsMs, const QImage &image)
+{
+    if (generation == m_generation) {
+        m_timelineStrip->setFrame(slot, ptsMs, image);
+    }
+}
+
+void VideoPage::cycleSpeed()
+{
+    switch (m_speed) {
+    case SpeedNormal:
+        applySpeed(SpeedDouble);
+        break;
+    case SpeedDouble:
+        applySpeed(SpeedFast);
+        break;
+    case SpeedFast:
+        applySpeed(SpeedKeyFrames);
+        break;
+    case SpeedKeyFrames:
+        applySpeed(SpeedNormal);
+        break;
+    }
+}
+
+void VideoPage::applySpeed(PlaybackSpeed speed)
+{
+    m_speed = speed;
+    static const char *const labels[] = {"1x", "2x", "8x", "I帧"};
+    m_speedButton->setText(labels[speed]);
+
+    const bool keyFramesOnly = (speed == SpeedFast || speed == SpeedKeyFrames);
+    if (keyFramesOnly && !m_keyFrames.isEmpty()) {
+        if (!m_trickPlaying) {
+            enterTrickPlay();
+        }
+        return;
+    }
+    if (m_trickPlaying) {
+        leaveTrickPlay(m_trickPlayTimer->isActive());
+    }
+    // 2x 以及没有关键帧索引时的快进：播放器完整解码
+    m_mediaPlayer->setPlaybackRate(speed == SpeedNormal ? 1.0 : (speed == SpeedDouble ? 2.0 : TRICK_FAST_RATE));
+}
+
+void VideoPage::resetSpeed()
+{
+    if (m_trickPlaying) {
+        leaveTrickPlay(false);
+    }
+    m_speed = SpeedNormal;
+    m_speedButton->setText("1x");
+    m_mediaPlayer->setPlaybackRate(1.0);
+}
+
+void VideoPage::enterTrickPlay()
+{
+    m_mediaPlayer->pause();
+    m_mediaPlayer->setPlaybackRate(1.0);
+    m_trickPlaying = true;
+    m_trickPositionMs = m_mediaPlayer->position();
+    m_trickTargetMs = m_trickPositionMs;
+    m_trickFrame = m_keyFrames.floorIndex(m_trickPositionMs) - 1; // 第一个节拍显示当前位置的关键帧
+    m_trickFramePending = false;
+    m_trickPlayLabel->clear();
+    m_trickPlayLabel->show();
+    m_trickPlayLabel->raise();
+    m_backButton->parentWidget()->raise(); // 返回按钮所在的覆盖层保持在最上面
+    m_trickClock.start();
+    m_trickPlayTimer->start();
+    m_playPauseButton->setIcon(QIcon(":/images/pause.png"));
+}
+
+void VideoPage::leaveTrickPlay(bool resume)
+{
+    m_trickPlaying = false;
+    m_trickPlayTimer->stop();
+    m_trickFramePending = false;
+    m_trickPlayLabel->hide();
+    m_trickPlayLabel->clear();
+    m_mediaPlayer->setPosition(m_trickPositionMs); // 从最后显示的关键帧继续
+    if (resume) {
+        m_mediaPlayer->play();
+        m_playPauseButton->setIcon(QIcon(":/images/pause.png"));
+    } else {
+        m_playPauseButton->setIcon(QIcon(":/images/playback.png"));
+    }
+}
+
+void VideoPage::requestTrickFrame(int frame)
+{
+    m_trickFrame = frame;
+    m_trickFramePending = true;
+    m_timelineLoader->requestKeyFrame(m_generation, m_currentFile, m_keyFrames.at(frame), m_trickPlayLabel->size());
+}
+
+void VideoPage::onTrickPlayTick()
+{
+    if (m_trickFramePending) {
+        return; // 上一帧还没解码完 (TF卡慢时自动降低显示帧率，8 倍速的目标时间照常推进)
+    }
+    const qint64 elapsed = m_trickClock.restart();
+    int frame;
+    bool atEnd;
+    if (m_speed == SpeedKeyFrames) {
+        frame = m_trickFrame + 1;
+        atEnd = frame >= m_keyFrames.size();
+    } else {
+        m_trickTargetMs += elapsed * TRICK_FAST_RATE;
+        frame = m_keyFrames.floorIndex(m_trickTargetMs);
+        const qint64 duration = m_mediaPlayer->duration() > 0 ? m_mediaPlayer->duration()
+                                                              : m_keyFrames.at(m_keyFrames.size() - 1).ptsMs;
+        atEnd = m_trickTargetMs >= duration;
+    }
+    if (atEnd) {
+        // 当前文件快进完：接着快进下一个文件，没有下一个文件时停在最后一个关键帧
+        if (!switchToNextFile()) {
+            resetSpeed();
+        }
+        return;
+    }
+    if (frame > m_trickFrame) {
+        requestTrickFrame(frame);
+    }
+}
+
+void VideoPage::onKeyFrameReady(int generation, qint64 ptsMs, const QImage &image)
+{
+    if (generation != m_generation || !m_trickPlaying) {
+        return; // 已切换文件或已结束快进
+    }
+    m_trickFramePending = false;
+    if (!image.isNull()) {
+        m_trickPlayLabel->setPixmap(QPixmap::fromImage(image));
+    }
+    m_trickPositionMs = ptsMs;
+    if (!m_positionSlider->isSliderDown()) {
+        m_positionSlider->setValue(ptsMs);
+        updateTimeLabel(ptsMs, m_mediaPlayer->duration());
+    }
+    m_timelineStrip->setPosition(ptsMs);
+}
+
+void VideoPage::hideEvent(QHideEvent *event)
+{
+    resetSpeed();
+    m_timelineLoader->cancel();
+    clearExportMark(); // 正在进行的导出不受影响
+    QWidget::hideEvent(event);
+}
+
+bool VideoPage::currentRecordingTime(QString *cameraDir, qint64 *timeMs) const
+{
+    RecordingCatalog::Entry entry;
+    if (!m_catalog || m_currentFile.isEmpty() || !m_catalog->findFile(m_currentFile, &entry)) {
+        return false;
+    }
+    // 相对路径为 "yyyyMMdd/camN/文件" (多摄像头) 或 "yyyyMMdd/文件"
+    const QStringList parts = entry.path.split('/');
+    *cameraDir = (parts.size() > 2) ? parts.at(1) : QString();
+    *timeMs = entry.startMs + (m_trickPlaying ? m_trickPositionMs : m_mediaPlayer->position());
+    return true;
+}
+
+void VideoPage::clearExportMark()
+{
+    m_exportMarkMs = -1;
+    m_exportCameraDir.clear();
+    if (!m_exporting) {
+        m_exportButton->setText(tr("导出"));
+        m_exportButton->setToolTip(tr("标记导出的开始位置"));
+    }
+}
+
+/**
+ * @brief 导出按钮。
+ *
+ * 第一次点击标记开始位置；第二次点击导出标记与当前位置之间的时间段 (先后顺序不限，
+ * 期间可以切换到同一摄像头的其它文件)；导出期间点击则中止。文件名为 [camN_]开始-结束.扩展名，
+ * 与来源录像使用相同的封装格式。
+ */
+void VideoPage::onExportClicked()
+{
+    if (!m_exporter) {
+        return;
+    }
+    if (m_exporting) {
+        m_exportCancelled = true;
+        m_exporter->cancelExport();
+        return;
+    }
+
+    QString cameraDir;
+    qint64 timeMs = 0;
+    if (!currentRecordingTime(&cameraDir, &timeMs)) {
+        QMessageBox::information(this, tr("导出"), tr("当前录像尚未保存到录像索引，无法按时间段导出。"));
+        return;
+    }
+    if (m_exportMarkMs < 0 || cameraDir != m_exportCameraDir || timeMs == m_exportMarkMs) {
+        // 标记开始位置 (切换到其它摄像头的录像后重新标记)
+        m_exportMarkMs = timeMs;
+        m_exportCameraDir = cameraDir;
+        m_exportButton->setText(tr("导出至此"));
+        m_exportButton->setToolTip(tr("已标记开始位置 %1，再次点击导出到当前位置")
+                                   .arg(QDateTime::fromMSecsSinceEpoch(timeMs).toString("yyyy-MM-dd HH:mm:ss")));
+        return;
+    }
+
+    const qint64 startMs = qMin(m_exportMarkMs, timeMs);
+    const qint64 endMs = qMax(m_exportMarkMs, timeMs);
+    const QString fileName = QString("%1%2-%3.%4")
+            .arg(cameraDir.isEmpty() ? QString() : cameraDir + "_")
+            .arg(QDateTime::fromMSecsSinceEpoch(startMs).toString("yyyyMMdd_HHmmss"))
+            .arg(QDateTime::fromMSecsSinceEpoch(endMs).toString("HHmmss"))
+            .arg(QFileInfo(m_currentFile).suffix());
+    if (!m_exporter->startExport(cameraDir, startMs, endMs, m_exportDir + "/" + fileName)) {
+        QMessageBox::warning(this, tr("导出失败"), tr("已有导出正在进行。"));
+        return;
+    }
+    m_exporting = true;
+    m_exportCancelled = false;
+    clearExportMark();
+    m_exportButton->setText(tr("导出 0%"));
+    m_exportButton->setToolTip(tr("正在导出，点击中止"));
+}
+
+void VideoPage::onExportFinished(const QString &outputPath, qint64 startMs, qint64 endMs, qint64 bytes)
+{
+    m_exporting = false;
+    clearExportMark();
+    QMessageBox::information(this, tr("导出完成"),
+                             tr("已导出 %1 至 %2 的录像 (%3 MB):\n%4")
+                             .arg(QDateTime::fromMSecsSinceEpoch(startMs).toString("yyyy-MM-dd HH:mm:ss"))
+                             .arg(QDateTime::fromMSecsSinceEpoch(endMs).toString("HH:mm:ss"))
+                             .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1)
+                             .arg(outputPath));
+}
+
+void VideoPage::onExportFailed(const QString &errorMsg)
+{
+    m_exporting = false;
+    clearExportMark();
+    if (!m_exportCancelled) {
+        QMessageBox::warning(this, tr("导出失败"), errorMsg);
+    }
+}
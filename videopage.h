@@ -8,7 +8,10 @@
  * 
  * 主要特性包括：
  * - 播放指定的视频文件。
- * - 提供播放控制接口（播放/暂停、停止、跳转）。
+ * - 提供播放控制接口（播放/暂停、停止、跳转）。拖动进度条时吸附到关键帧并限制定位频率。
+ * - 进度条下方的关键帧缩略图条，2 倍速播放，以及只解码关键帧的 8 倍速 / 逐关键帧快进。
+ * - 同目录录像连续播放：预先打开列表中的下一个文件，当前文件结束时直接切换。
+ * - 时间段导出：标记开始位置，播放 (或切换文件) 到结束位置后导出这一段 (可以跨越多个录像文件)。
  * - 显示视频播放进度和时间信息。
  * - (可选) 展示与当前视频同目录的其他视频文件列表，并允许切换。
  * - 提供返回到上一页（通常是历史记录页面）的导航。
@@ -23,13 +26,20 @@
 #include <QMediaPlayer>  // QMediaPlayer 类，用于媒体播放的核心功能
 #include <QVideoWidget>  // QVideoWidget 类，用于显示 QMediaPlayer 播放的视频内容
 #include <QListWidget>   // QListWidget 类，用于显示项目列表 (此处用于显示同目录视频文件)
-#include <QTimer>        // QTimer 类 (虽然在此头文件中未直接作为成员变量声明，但在.cpp中可能用于UI更新等)
+#include <QTimer>        // QTimer 类，用于限制拖动时的定位频率和快进的节拍
+#include <QElapsedTimer> // 8 倍速快进的时间基准
+
+#include "keyframeindex.h" // 录像的关键帧索引
 
 // 前向声明 (Forward Declarations)
 // 用于声明类名，使得可以在不知道这些类的完整定义的情况下使用它们的指针或引用。
 // 这有助于减少编译依赖，避免头文件之间的循环包含问题。
 class MainWindow;        // 主窗口类，VideoPage 是其子页面之一，需要访问主窗口进行页面切换。
 class QListWidgetItem;   // QListWidget 中的列表项类，在槽函数参数中用到。
+class RecordingCatalog;  // 录像索引 (StorageManager 维护)，用于列出同目录的录像。
+class RecordingExporter; // 时间段导出线程 (StorageManager 拥有)。
+class TimelineLoader;    // 后台关键帧解码线程 (缩略图条、快进画面)。
+class TimelineStrip;     // 进度条下方的缩略图条。
 
 /**
  * @brief 视频播放页面类 (VideoPage)
@@ -37,6 +47,16 @@ class QListWidgetItem;   // QListWidget 中的列表项类，在槽函数参数
  * 继承自 QWidget，提供了视频播放的用户界面和控制逻辑。
  * 使用 QMediaPlayer 处理媒体播放，QVideoWidget 显示视频，
  * 并包含各种按钮、滑块和标签来与用户交互。
+ *
+ * 录制线程为每个录像文件保存了关键帧索引 (`KeyFrameIndex`)，播放页用它：
+ * - 拖动进度条时只定位到最近的关键帧，并且最多每 SEEK_THROTTLE_MS 定位一次，松开时定位到最终的关键帧；
+ * - 在进度条下方显示 STRIP_SLOTS 个关键帧缩略图 (`TimelineLoader` 后台只解码 I 帧)，点击即定位；
+ * - 8 倍速和逐关键帧快进时暂停 `QMediaPlayer`，由 `TimelineLoader` 逐个解码关键帧显示在视频上方。
+ * 没有索引的文件 (正在录制或升级前的录像) 按原位置定位，快进退回 `QMediaPlayer` 的倍速播放。
+ * 两个 `QMediaPlayer` 轮流使用：正在播放的一个连接视频控件，另一个预先打开列表中的下一个文件。
+ *
+ * 导出按钮第一次点击时记下当前位置的录制时间 (索引记录的开始时间 + 播放位置)，第二次点击时由
+ * `RecordingExporter` 在后台把两次点击之间的时间段转封装为一个文件，按钮显示进度，导出期间再点击则中止。
  */
 class VideoPage : public QWidget
 {
@@ -87,9 +107,16 @@ public slots: // 公共槽函数，可以从其他对象（如按钮点击、播
      * @param position 用户通过进度条选择的新的播放位置 (单位：毫秒)。
      *
      * 当用户拖动播放进度条时，由此信号 `QSlider::sliderMoved` 触发调用。
+     * 有关键帧索引时吸附到最近的关键帧；拖动过程中最多每 SEEK_THROTTLE_MS 定位一次，
+     * 吸附到的关键帧没有变化时不定位。
      */
     void setVideoPosition(int position);
 
+    /**
+     * @brief 槽函数：切换播放速度 (1x -> 2x -> 8x -> 关键帧 -> 1x)，由速度按钮触发。
+     */
+    void cycleSpeed();
+
     /**
      * @brief 槽函数：处理 QMediaPlayer 播放位置变化事件。
      * @param position 当前 QMediaPlayer 的播放位置 (单位：毫秒)。
@@ -124,11 +151,173 @@ public slots: // 公共槽函数，可以从其他对象（如按钮点击、播
      */
     QString getCurrentVideoDir() const;
 
+    /**
+     * @brief 设置录像索引。设置后同目录视频列表从索引查询，不读取TF卡目录。
+     * @param catalog 录像索引 (由 StorageManager 拥有)，为 nullptr 时列出目录。
+     */
+    void setCatalog(const RecordingCatalog *catalog);
+
+    /**
+     * @brief 设置时间段导出线程。未设置时导出按钮不可用。
+     * @param exporter 导出线程 (由 StorageManager 拥有)，须同时设置录像索引。
+     * @param exportDir 导出文件的保存目录。
+     */
+    void setExporter(RecordingExporter *exporter, const QString &exportDir);
+
+protected:
+    /**
+     * @brief 离开播放页时结束快进并丢弃尚未完成的解码请求。
+     */
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    /**
+     * @brief 进度条松开：定位到最终位置吸附的关键帧。
+     */
+    void onSliderReleased();
+
+    /**
+     * @brief 拖动定位的限频计时器到期：拖动中吸附的关键帧有变化时再定位一次。
+     */
+    void onSeekTimeout();
+
+    /**
+     * @brief 8 倍速 / 逐关键帧快进的节拍：上一帧已显示时请求下一个要显示的关键帧。
+     */
+    void onTrickPlayTick();
+
+    /**
+     * @brief 快进的关键帧已解码 (排队连接)：显示在视频上方并更新进度。
+     */
+    void onKeyFrameReady(int generation, qint64 ptsMs, const QImage &image);
+
+    /**
+     * @brief 缩略图条的一格已解码 (排队连接)。
+     */
+    void onStripFrameReady(int generation, int slot, qint64 ptsMs, const QImage &image);
+
+    /**
+     * @brief 导出按钮：标记开始位置 / 导出标记到当前位置的时间段 / 中止正在进行的导出。
+     */
+    void onExportClicked();
+
+    /**
+     * @brief 导出完成 (排队连接)：恢复导出按钮并提示导出的文件。
+     */
+    void onExportFinished(const QString &outputPath, qint64 startMs, qint64 endMs, qint64 bytes);
+
+    /**
+     * @brief 导出失败或被中止 (排队连接)：恢复导出按钮，不是用户中止时提示原因。
+     */
+    void onExportFailed(const QString &errorMsg);
+
+private:
+    /**
+     * @brief 播放速度。
+     */
+    enum PlaybackSpeed {
+        SpeedNormal,    ///< 正常播放。
+        SpeedDouble,    ///< 2 倍速 (`QMediaPlayer` 完整解码)。
+        SpeedFast,      ///< 8 倍速，只解码关键帧。
+        SpeedKeyFrames  ///< 逐个显示关键帧 (每 TRICK_TICK_MS 一个)。
+    };
+
+    /**
+     * @brief 连接一个播放器的信号，只处理当前正在播放的播放器发出的信号。
+     */
+    void connectPlayer(QMediaPlayer *player);
+
+    /**
+     * @brief 在当前播放器中打开并播放一个文件 (用户选择的文件)，速度恢复为 1x，预先打开下一个文件。
+     */
+    void openFile(const QString &filePath);
+
+    /**
+     * @brief 当前文件结束：切换到已预先打开的下一个文件继续播放 (保持当前速度)。
+     * @return 没有下一个文件或下一个文件无法打开时返回 false。
+     */
+    bool switchToNextFile();
+
+    /**
+     * @brief 当前文件改变后重置关键帧索引、缩略图条和快进状态，在列表中选中该文件。
+     */
+    void resetTimeline(const QString &filePath);
+
+    /**
+     * @brief 在备用播放器中预先打开列表中当前文件的下一个文件。
+     */
+    void preloadNextFile();
+
+    /**
+     * @brief 按录像总时长请求缩略图条 (每个文件一次)。
+     */
+    void requestStrip(qint64 duration);
+
+    /**
+     * @brief 与 positionMs 最接近的关键帧时间，没有关键帧索引时原样返回。
+     */
+    qint64 snapToKeyFrame(qint64 positionMs) const;
+
+    /**
+     * @brief 定位到 positionMs (快进中时从这里继续快进)。
+     */
+    void seekTo(qint64 positionMs);
+
+    /**
+     * @brief 应用播放速度：8x / 关键帧模式在有关键帧索引时进入只解码关键帧的快进，否则使用播放器的倍速。
+     */
+    void applySpeed(PlaybackSpeed speed);
+
+    /**
+     * @brief 恢复 1x 速度 (停止、离开页面、用户选择新文件时)，不改变播放/暂停状态。
+     */
+    void resetSpeed();
+
+    /**
+     * @brief 进入只解码关键帧的快进：暂停播放器，从当前位置的关键帧开始。
+     */
+    void enterTrickPlay();
+
+    /**
+     * @brief 结束快进：播放器定位到最后显示的关键帧。
+     * @param resume 是否继续播放。
+     */
+    void leaveTrickPlay(bool resume);
+
+    /**
+     * @brief 请求解码索引中第 frame 个关键帧用于快进显示。
+     */
+    void requestTrickFrame(int frame);
+
+    /**
+     * @brief 更新时间显示标签 ("当前时间 / 总时长")。
+     */
+    void updateTimeLabel(qint64 position, qint64 duration);
+
+    /**
+     * @brief 当前播放位置的录制时间和所属摄像头的子目录。
+     * @param cameraDir 输出日期目录下的摄像头子目录名，单摄像头布局时为空字符串。
+     * @param timeMs 输出录制时间 (自 1970 年起的毫秒数)。
+     * @return 当前文件不在录像索引中 (正在录制或未登记) 时返回 false。
+     */
+    bool currentRecordingTime(QString *cameraDir, qint64 *timeMs) const;
+
+    /**
+     * @brief 清除导出的开始标记，导出按钮恢复初始状态 (不影响正在进行的导出)。
+     */
+    void clearExportMark();
+
+    static const int SEEK_THROTTLE_MS = 250;  ///< 拖动进度条时两次定位的最小间隔 (毫秒)。
+    static const int STRIP_SLOTS = 10;        ///< 缩略图条的格数。
+    static const int TRICK_TICK_MS = 100;     ///< 快进的节拍 (毫秒)，逐关键帧模式每个节拍显示一个关键帧。
+    static const int TRICK_FAST_RATE = 8;     ///< 快进倍速。
+
 private: // 私有成员变量，仅供 VideoPage 类内部访问
     MainWindow *m_mainWindow;  ///< 指向主窗口 (MainWindow) 实例的指针，用于页面导航等。
     
     // --- UI 组件指针 --- 
-    QMediaPlayer *m_mediaPlayer;       ///< Qt的多媒体播放器核心对象，负责视频的解码和播放控制。
+    QMediaPlayer *m_mediaPlayer;       ///< Qt的多媒体播放器核心对象，负责视频的解码和播放控制 (当前正在播放、连接视频控件的一个)。
+    QMediaPlayer *m_nextPlayer;        ///< 备用播放器，预先打开列表中的下一个文件，当前文件结束时与 m_mediaPlayer 交换。
     QVideoWidget *m_videoWidget;       ///< Qt的视频显示控件，用于渲染 QMediaPlayer 输出的视频帧。
     QSlider *m_positionSlider;         ///< 水平滑动条，用作视频播放进度条，允许用户查看和调整播放位置。
     QLabel *m_durationLabel;           ///< 文本标签，用于显示视频的当前播放时间和总时长 (例如 "01:23 / 05:40")。
@@ -138,10 +327,38 @@ private: // 私有成员变量，仅供 VideoPage 类内部访问
     QListWidget *m_videoListWidget;    ///< 列表控件，用于显示与当前播放视频同目录下的其他MP4视频文件。
     QPushButton *m_toggleListButton;   ///< 按钮，用于显示或隐藏旁边的 `m_videoListWidget`。
     QWidget *m_videoListContainer;     ///< QWidget容器，用于容纳 `m_videoListWidget` 及其标题，方便整体显示/隐藏。
+    QPushButton *m_speedButton;        ///< 按钮，切换播放速度。
+    QPushButton *m_exportButton;       ///< 按钮，标记导出开始位置 / 导出 / 显示进度并中止导出。
+    TimelineStrip *m_timelineStrip;    ///< 进度条下方的关键帧缩略图条。
+    QLabel *m_trickPlayLabel;          ///< 快进时叠在视频上方显示解码出的关键帧。
+    TimelineLoader *m_timelineLoader;  ///< 后台关键帧解码线程 (子对象)。
+    QTimer *m_seekTimer;               ///< 拖动进度条时的定位限频计时器 (单次)。
+    QTimer *m_trickPlayTimer;          ///< 快进节拍计时器。
     
     // --- 状态变量 --- 
     bool m_isVideoListVisible;         ///< 布尔标志，指示同目录视频列表当前是否可见。
     QString m_currentVideoDir;         ///< 字符串，存储当前正在播放的视频文件所在的完整目录路径。
+    const RecordingCatalog *m_catalog; ///< 录像索引，可为 nullptr。
+    QString m_currentFile;             ///< 正在播放的文件。
+    QString m_nextFile;                ///< 备用播放器预先打开的文件，为空表示没有下一个文件。
+    KeyFrameIndex m_keyFrames;         ///< 正在播放的文件的关键帧索引 (没有索引文件时为空)。
+    int m_generation;                  ///< 播放编号，每次切换文件加一，用于丢弃过期的解码结果。
+    bool m_stripRequested;             ///< 当前文件已请求缩略图条。
+    qint64 m_lastSeekMs;               ///< 拖动中最近一次定位的位置，-1 表示本次拖动尚未定位。
+    qint64 m_pendingSeekMs;            ///< 拖动中最新的吸附位置。
+    PlaybackSpeed m_speed;             ///< 当前播放速度。
+    bool m_trickPlaying;               ///< 正在只解码关键帧快进 (播放器已暂停)。
+    bool m_trickFramePending;          ///< 已请求、尚未返回的快进关键帧。
+    int m_trickFrame;                  ///< 最近请求的关键帧在索引中的下标。
+    qint64 m_trickPositionMs;          ///< 最近显示的关键帧的时间 (结束快进时播放器从这里继续)。
+    qint64 m_trickTargetMs;            ///< 8 倍速快进的目标时间，按实际经过的时间推进。
+    QElapsedTimer m_trickClock;        ///< 8 倍速快进上一次推进目标时间的时刻。
+    RecordingExporter *m_exporter;     ///< 时间段导出线程，可为 nullptr。
+    QString m_exportDir;               ///< 导出文件的保存目录。
+    qint64 m_exportMarkMs;             ///< 导出开始标记的录制时间，-1 表示未标记。
+    QString m_exportCameraDir;         ///< 标记开始位置时播放的摄像头子目录。
+    bool m_exporting;                  ///< 已开始导出，尚未收到完成或失败。
+    bool m_exportCancelled;            ///< 用户中止了正在进行的导出 (失败时不再提示)。
 };
 
 #endif // VIDEOPAGE_H